@@ -0,0 +1,139 @@
+#pragma once
+
+#include <QtNodes/NodeData>
+#include <QtNodes/NodeDelegateModel>
+
+#include <memory>
+#include <vector>
+
+using QtNodes::NodeData;
+using QtNodes::NodeDataType;
+using QtNodes::NodeDelegateModel;
+using QtNodes::PortIndex;
+using QtNodes::PortType;
+using QtNodes::TypedNodeData;
+
+class BenchData : public TypedNodeData<BenchData>
+{
+public:
+    explicit BenchData(double const value = 0.0)
+        : _value(value)
+    {}
+
+    NodeDataType type() const override { return NodeDataType{"bench", "Bench"}; }
+
+    double value() const { return _value; }
+
+private:
+    double _value;
+};
+
+/// Sums its inputs plus one and forwards the result, so every update
+/// propagates through the whole graph.
+class BenchModel : public NodeDelegateModel
+{
+    Q_OBJECT
+
+public:
+    explicit BenchModel(unsigned int const inputs)
+        : _inputs(inputs, 0.0)
+    {}
+
+    unsigned int nPorts(PortType const portType) const override
+    {
+        switch (portType) {
+        case PortType::In:
+            return static_cast<unsigned int>(_inputs.size());
+        case PortType::Out:
+            return 1;
+        default:
+            return 0;
+        }
+    }
+
+    NodeDataType dataType(PortType, PortIndex) const override { return BenchData().type(); }
+
+    std::shared_ptr<NodeData> outData(PortIndex) override { return _result; }
+
+    void setInData(std::shared_ptr<NodeData> data, PortIndex const portIndex) override
+    {
+        auto const number = QtNodes::nodeDataCast<BenchData>(data);
+
+        _inputs[portIndex] = number ? number->value() : 0.0;
+
+        double sum = 1.0;
+
+        for (double const input : _inputs) {
+            sum += input;
+        }
+
+        _result = std::make_shared<BenchData>(sum);
+
+        Q_EMIT dataUpdated(0);
+    }
+
+    QWidget *embeddedWidget() override { return nullptr; }
+
+    /// Starts a propagation from a node without inputs.
+    void emitValue(double const value)
+    {
+        _result = std::make_shared<BenchData>(value);
+
+        Q_EMIT dataUpdated(0);
+    }
+
+private:
+    std::vector<double> _inputs;
+
+    std::shared_ptr<BenchData> _result;
+};
+
+class BenchSource : public BenchModel
+{
+    Q_OBJECT
+
+public:
+    BenchSource()
+        : BenchModel(0)
+    {}
+
+    static QString Name() { return QStringLiteral("BenchSource"); }
+
+    QString caption() const override { return Name(); }
+
+    QString name() const override { return Name(); }
+};
+
+class BenchPass : public BenchModel
+{
+    Q_OBJECT
+
+public:
+    BenchPass()
+        : BenchModel(1)
+    {}
+
+    static QString Name() { return QStringLiteral("BenchPass"); }
+
+    QString caption() const override { return Name(); }
+
+    QString name() const override { return Name(); }
+};
+
+class BenchMerge : public BenchModel
+{
+    Q_OBJECT
+
+public:
+    static constexpr unsigned int Inputs = 8;
+
+    BenchMerge()
+        : BenchModel(Inputs)
+    {}
+
+    static QString Name() { return QStringLiteral("BenchMerge"); }
+
+    QString caption() const override { return Name(); }
+
+    QString name() const override { return Name(); }
+};
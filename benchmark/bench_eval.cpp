@@ -0,0 +1,456 @@
+#include "AdditionModel.hpp"
+#include "NumberDisplayDataModel.hpp"
+#include "NumberSourceDataModel.hpp"
+#include "SubtractionModel.hpp"
+
+#include <QtNodes/DataFlowGraphModel>
+#include <QtNodes/NodeDelegateModelRegistry>
+#include <QtNodes/SceneJson>
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QTextStream>
+#include <QtWidgets/QApplication>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+using QtNodes::appendConnectionJson;
+using QtNodes::ConnectionId;
+using QtNodes::DataFlowGraphModel;
+using QtNodes::NodeDelegateModelRegistry;
+using QtNodes::NodeDelegateProfiler;
+using QtNodes::NodeId;
+
+namespace {
+
+std::shared_ptr<NodeDelegateModelRegistry> registerDataModels()
+{
+    auto ret = std::make_shared<NodeDelegateModelRegistry>();
+    ret->registerModel<NumberSourceDataModel>("Sources");
+
+    ret->registerModel<NumberDisplayDataModel>("Displays");
+
+    ret->registerModel<AdditionModel>("Operators");
+
+    ret->registerModel<SubtractionModel>("Operators");
+
+    return ret;
+}
+
+/// Scene JSON of calculator nodes, built the way `save()` writes it.
+/**
+ * Node ids count from 0; every scene starts with its source node and ends
+ * with its display node.
+ */
+class SceneBuilder
+{
+public:
+    explicit SceneBuilder(QString kind)
+        : _kind(std::move(kind))
+    {}
+
+    NodeId addNode(QString const &modelName)
+    {
+        NodeId const nodeId = static_cast<NodeId>(_nodes.size());
+
+        QJsonObject internalData;
+        internalData["model-name"] = modelName;
+
+        QJsonObject position;
+        position["x"] = 0.0;
+        position["y"] = 0.0;
+
+        QJsonObject node;
+        node["id"] = static_cast<qint64>(nodeId);
+        node["internal-data"] = internalData;
+        node["position"] = position;
+
+        _nodes.append(node);
+
+        return nodeId;
+    }
+
+    void connect(NodeId const outNodeId, NodeId const inNodeId, PortIndex const inPortIndex)
+    {
+        appendConnectionJson(_connections, ConnectionId{outNodeId, 0, inNodeId, inPortIndex});
+    }
+
+    QString const &kind() const { return _kind; }
+
+    QJsonObject scene() const
+    {
+        QJsonObject json;
+        json["nodes"] = _nodes;
+        json["connections"] = _connections;
+
+        return json;
+    }
+
+private:
+    QString _kind;
+
+    QJsonArray _nodes;
+
+    QJsonArray _connections;
+};
+
+/// Source followed by `nodes` additions of the previous result and the source.
+SceneBuilder chainScene(std::size_t const nodes)
+{
+    SceneBuilder scene("chain");
+
+    NodeId const source = scene.addNode("NumberSource");
+    NodeId previous = source;
+
+    for (std::size_t i = 0; i < nodes; ++i) {
+        NodeId const addition = scene.addNode("Addition");
+
+        scene.connect(previous, addition, 0);
+        scene.connect(source, addition, 1);
+
+        previous = addition;
+    }
+
+    scene.connect(previous, scene.addNode("Result"), 0);
+
+    return scene;
+}
+
+/// One source feeding both inputs of `nodes` additions, the first one displayed.
+SceneBuilder fanOutScene(std::size_t const nodes)
+{
+    SceneBuilder scene("fanout");
+
+    NodeId const source = scene.addNode("NumberSource");
+    NodeId first = source;
+
+    for (std::size_t i = 0; i < nodes; ++i) {
+        NodeId const addition = scene.addNode("Addition");
+
+        scene.connect(source, addition, 0);
+        scene.connect(source, addition, 1);
+
+        if (i == 0)
+            first = addition;
+    }
+
+    scene.connect(first, scene.addNode("Result"), 0);
+
+    return scene;
+}
+
+/// Diamonds in a row: the sum and difference of the previous result and the source, summed.
+SceneBuilder diamondScene(std::size_t const nodes)
+{
+    SceneBuilder scene("diamond");
+
+    NodeId const source = scene.addNode("NumberSource");
+    NodeId previous = source;
+
+    for (std::size_t i = 0; i < std::max<std::size_t>(1, nodes / 3); ++i) {
+        NodeId const sum = scene.addNode("Addition");
+        NodeId const difference = scene.addNode("Subtraction");
+        NodeId const join = scene.addNode("Addition");
+
+        scene.connect(previous, sum, 0);
+        scene.connect(source, sum, 1);
+        scene.connect(previous, difference, 0);
+        scene.connect(source, difference, 1);
+        scene.connect(sum, join, 0);
+        scene.connect(difference, join, 1);
+
+        previous = join;
+    }
+
+    scene.connect(previous, scene.addNode("Result"), 0);
+
+    return scene;
+}
+
+/// Sums the reported calls per delegate and entry point.
+class CountingProfiler : public NodeDelegateProfiler
+{
+public:
+    void record(QString const &delegateName,
+                Call const call,
+                PortIndex const portIndex,
+                std::int64_t const nanoseconds) override
+    {
+        Q_UNUSED(portIndex);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        Total &total = _totals[std::make_tuple(delegateName, static_cast<int>(call))];
+        ++total.calls;
+        total.nanoseconds += nanoseconds;
+    }
+
+    std::uint64_t calls(Call const call) const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        std::uint64_t sum = 0;
+
+        for (auto const &entry : _totals) {
+            if (std::get<1>(entry.first) == static_cast<int>(call))
+                sum += entry.second.calls;
+        }
+
+        return sum;
+    }
+
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _totals.clear();
+    }
+
+    QJsonArray results() const
+    {
+        static char const *const callNames[] = {"setInData", "outData", "compute"};
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        QJsonArray results;
+
+        for (auto const &entry : _totals) {
+            Total const &total = entry.second;
+
+            QJsonObject json;
+            json["delegate"] = std::get<0>(entry.first);
+            json["call"] = QString::fromLatin1(callNames[std::get<1>(entry.first)]);
+            json["calls"] = static_cast<double>(total.calls);
+            json["total_ms"] = total.nanoseconds / 1e6;
+            json["mean_us"] = total.calls > 0 ? total.nanoseconds / 1e3 / total.calls : 0.0;
+
+            results.append(json);
+        }
+
+        return results;
+    }
+
+private:
+    struct Total
+    {
+        std::uint64_t calls = 0;
+        std::int64_t nanoseconds = 0;
+    };
+
+    mutable std::mutex _mutex;
+
+    std::map<std::tuple<QString, int>, Total> _totals;
+};
+
+struct Mode
+{
+    QString name;
+    DataFlowGraphModel::PropagationMode propagation;
+    bool parallel;
+};
+
+/// Pushes `values` numbers through the scene, `repeat` times, and reports the fastest run.
+QJsonObject run(SceneBuilder const &builder,
+                Mode const &mode,
+                std::size_t const values,
+                int const repeat,
+                CountingProfiler *profiler)
+{
+    DataFlowGraphModel model(registerDataModels());
+
+    model.setPropagationMode(mode.propagation);
+    model.setParallelEvaluation(mode.parallel);
+    model.load(builder.scene());
+
+    std::unordered_set<NodeId> const nodeIds = model.allNodeIds();
+
+    NodeId const sourceId = 0;
+    NodeId const displayId = static_cast<NodeId>(nodeIds.size() - 1);
+
+    auto *source = model.delegateModel<NumberSourceDataModel>(sourceId);
+    auto *display = model.delegateModel<NumberDisplayDataModel>(displayId);
+
+    if (!source || !display)
+        return QJsonObject();
+
+    if (profiler) {
+        for (NodeId const nodeId : nodeIds) {
+            model.delegateModel<NodeDelegateModel>(nodeId)->setProfiler(profiler);
+        }
+    }
+
+    std::vector<double> ms;
+
+    for (int r = 0; r < repeat; ++r) {
+        if (profiler)
+            profiler->reset();
+
+        QElapsedTimer timer;
+        timer.start();
+
+        for (std::size_t v = 0; v < values; ++v) {
+            source->setNumber(static_cast<double>(v % 16));
+
+            model.processPendingPropagation();
+        }
+
+        ms.push_back(timer.nsecsElapsed() / 1e6);
+    }
+
+    std::sort(ms.begin(), ms.end());
+
+    double const seconds = std::max(ms.front(), 1e-3) / 1e3;
+
+    QJsonObject json;
+    json["graph"] = builder.kind();
+    json["mode"] = mode.name;
+    json["nodes"] = static_cast<double>(nodeIds.size());
+    json["values"] = static_cast<double>(values);
+    json["iterations"] = static_cast<int>(ms.size());
+    json["min_ms"] = ms.front();
+    json["median_ms"] = ms[ms.size() / 2];
+    json["mean_ms"] = std::accumulate(ms.begin(), ms.end(), 0.0) / ms.size();
+    json["values_per_second"] = values / seconds;
+    json["result"] = display->number();
+
+    // The counts of the last run, which is not necessarily the fastest one.
+    if (profiler) {
+        json["set_in_data_per_second"] = profiler->calls(NodeDelegateProfiler::Call::SetInData)
+                                         / seconds;
+        json["profile"] = profiler->results();
+    }
+
+    return json;
+}
+
+} // namespace
+
+/**
+ * Measures how many values per second flow from a source through chains,
+ * fan-outs and diamonds of calculator nodes, and prints the results as JSON.
+ *
+ *   bench_eval --graph all --mode all --nodes 300 --values 2000 --profile
+ *
+ * Every value is set on the source and flushed with
+ * `processPendingPropagation()` before the next one. With `--profile` each
+ * delegate reports to a NodeDelegateProfiler and the results list the calls
+ * and time per delegate type and entry point; the timing then includes the
+ * cost of the profiler itself.
+ */
+int main(int argc, char *argv[])
+{
+    // The calculator delegates are widgets, even without a display.
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks the evaluation throughput of QtNodes.");
+    parser.addHelpOption();
+
+    QCommandLineOption graphOption("graph", "chain, fanout, diamond or all.", "kind", "all");
+    QCommandLineOption modeOption("mode", "immediate, scheduled, parallel or all.", "mode", "all");
+    QCommandLineOption nodesOption("nodes", "Number of operator nodes.", "count", "300");
+    QCommandLineOption valuesOption("values", "Values pushed through the graph per run.", "count", "1000");
+    QCommandLineOption repeatOption("repeat", "Runs per graph and mode.", "count", "5");
+    QCommandLineOption profileOption("profile", "Profiles the delegate calls.");
+    QCommandLineOption outputOption("output", "File for the JSON results.", "file");
+
+    parser.addOption(graphOption);
+    parser.addOption(modeOption);
+    parser.addOption(nodesOption);
+    parser.addOption(valuesOption);
+    parser.addOption(repeatOption);
+    parser.addOption(profileOption);
+    parser.addOption(outputOption);
+    parser.process(app);
+
+    std::size_t const nodes = std::max<std::size_t>(1, parser.value(nodesOption).toULongLong());
+    std::size_t const values = std::max<std::size_t>(1, parser.value(valuesOption).toULongLong());
+    int const repeat = std::max(1, parser.value(repeatOption).toInt());
+
+    QString const kind = parser.value(graphOption);
+
+    std::vector<SceneBuilder> scenes;
+
+    if (kind == "chain" || kind == "all")
+        scenes.push_back(chainScene(nodes));
+
+    if (kind == "fanout" || kind == "all")
+        scenes.push_back(fanOutScene(nodes));
+
+    if (kind == "diamond" || kind == "all")
+        scenes.push_back(diamondScene(nodes));
+
+    using PropagationMode = DataFlowGraphModel::PropagationMode;
+
+    QString const modeName = parser.value(modeOption);
+
+    std::vector<Mode> modes;
+
+    if (modeName == "immediate" || modeName == "all")
+        modes.push_back(Mode{"immediate", PropagationMode::Immediate, false});
+
+    if (modeName == "scheduled" || modeName == "all")
+        modes.push_back(Mode{"scheduled", PropagationMode::Scheduled, false});
+
+    if (modeName == "parallel" || modeName == "all")
+        modes.push_back(Mode{"parallel", PropagationMode::Scheduled, true});
+
+    if (scenes.empty() || modes.empty())
+        parser.showHelp(1);
+
+    CountingProfiler profiler;
+
+    QJsonArray benchmarks;
+
+    for (SceneBuilder const &scene : scenes) {
+        for (Mode const &mode : modes) {
+            QJsonObject const result = run(scene,
+                                           mode,
+                                           values,
+                                           repeat,
+                                           parser.isSet(profileOption) ? &profiler : nullptr);
+
+            if (result.isEmpty()) {
+                qCritical() << "Cannot build the" << scene.kind() << "graph";
+                return 1;
+            }
+
+            benchmarks.append(result);
+        }
+    }
+
+    QJsonObject report;
+    report["benchmarks"] = benchmarks;
+    report["qtVersion"] = QString::fromLatin1(qVersion());
+
+    QByteArray const json = QJsonDocument(report).toJson();
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+
+        if (!file.open(QIODevice::WriteOnly)) {
+            qCritical() << "Cannot write" << file.fileName();
+            return 1;
+        }
+
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+
+    return 0;
+}
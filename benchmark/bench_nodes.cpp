@@ -0,0 +1,651 @@
+#include "BenchModels.hpp"
+
+#include <QtNodes/DataFlowGraphModel>
+#include <QtNodes/DataFlowGraphicsScene>
+#include <QtNodes/DenseGraphModel>
+#include <QtNodes/FlatHashMap>
+#include <QtNodes/LayeredLayout>
+#include <QtNodes/NodeDelegateModelRegistry>
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QTextStream>
+#include <QtWidgets/QApplication>
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+using QtNodes::ConnectionId;
+using QtNodes::DataFlowGraphicsScene;
+using QtNodes::DataFlowGraphModel;
+using QtNodes::DenseGraphModel;
+using QtNodes::LayeredLayout;
+using QtNodes::NodeDelegateModelRegistry;
+using QtNodes::NodeId;
+
+namespace {
+
+/// Nodes and edges by index into `nodeTypes`; ids are assigned on build.
+struct GraphSpec
+{
+    QString kind;
+    std::vector<QString> nodeTypes;
+
+    struct Edge
+    {
+        std::size_t from;
+        std::size_t to;
+        PortIndex inPortIndex;
+    };
+
+    std::vector<Edge> edges;
+};
+
+std::shared_ptr<NodeDelegateModelRegistry> registerDataModels()
+{
+    auto ret = std::make_shared<NodeDelegateModelRegistry>();
+
+    ret->registerModel<BenchSource>("Bench");
+
+    ret->registerModel<BenchPass>("Bench");
+
+    ret->registerModel<BenchMerge>("Bench");
+
+    return ret;
+}
+
+/// Source followed by `nodes - 1` pass-through nodes in a row.
+GraphSpec chainGraph(std::size_t const nodes)
+{
+    GraphSpec spec;
+    spec.kind = "chain";
+    spec.nodeTypes.push_back(BenchSource::Name());
+
+    for (std::size_t i = 1; i < nodes; ++i) {
+        spec.nodeTypes.push_back(BenchPass::Name());
+        spec.edges.push_back(GraphSpec::Edge{i - 1, i, 0});
+    }
+
+    return spec;
+}
+
+/// One source feeding all the other nodes.
+GraphSpec fanOutGraph(std::size_t const nodes)
+{
+    GraphSpec spec;
+    spec.kind = "fanout";
+    spec.nodeTypes.push_back(BenchSource::Name());
+
+    for (std::size_t i = 1; i < nodes; ++i) {
+        spec.nodeTypes.push_back(BenchPass::Name());
+        spec.edges.push_back(GraphSpec::Edge{0, i, 0});
+    }
+
+    return spec;
+}
+
+/// Up to `edges` random forward edges; a node takes at most `BenchMerge::Inputs`.
+GraphSpec randomDag(std::size_t const nodes, std::size_t const edges, unsigned int const seed)
+{
+    GraphSpec spec;
+    spec.kind = "dag";
+    spec.nodeTypes.push_back(BenchSource::Name());
+
+    for (std::size_t i = 1; i < nodes; ++i) {
+        spec.nodeTypes.push_back(BenchMerge::Name());
+    }
+
+    if (nodes < 2)
+        return spec;
+
+    std::vector<PortIndex> usedPorts(nodes, 0);
+
+    std::mt19937 random(seed);
+
+    std::size_t const capacity = (nodes - 1) * BenchMerge::Inputs;
+
+    for (std::size_t e = 0; e < std::min(edges, capacity); ++e) {
+        // Gives up on a few edges of nearly full graphs rather than looping.
+        for (int attempt = 0; attempt < 16; ++attempt) {
+            std::size_t const to = 1 + random() % (nodes - 1);
+
+            if (usedPorts[to] >= BenchMerge::Inputs)
+                continue;
+
+            std::size_t const from = random() % to;
+
+            spec.edges.push_back(GraphSpec::Edge{from, to, usedPorts[to]++});
+            break;
+        }
+    }
+
+    return spec;
+}
+
+/// Layers of `width` nodes, each wired to every node of the previous layer.
+GraphSpec meshGraph(std::size_t const nodes, std::size_t const width)
+{
+    GraphSpec spec;
+    spec.kind = "mesh";
+
+    for (std::size_t i = 0; i < nodes; ++i) {
+        bool const first = i < width;
+
+        spec.nodeTypes.push_back(first ? BenchSource::Name() : BenchMerge::Name());
+
+        if (first)
+            continue;
+
+        std::size_t const layerStart = i - i % width;
+
+        for (std::size_t j = 0; j < width; ++j) {
+            spec.edges.push_back(
+                GraphSpec::Edge{layerStart - width + j, i, static_cast<PortIndex>(j)});
+        }
+    }
+
+    return spec;
+}
+
+/// The `ConnectionId` hash before `connectionIdHash()`, for comparison.
+struct CombinedConnectionIdHash
+{
+    std::size_t operator()(ConnectionId const &id) const
+    {
+        std::size_t h = 0;
+        hash_combine(h, id.outNodeId, id.outPortIndex, id.inNodeId, id.inPortIndex);
+        return h;
+    }
+};
+
+struct Measurement
+{
+    QString name;
+    std::vector<double> milliseconds;
+};
+
+class Bench
+{
+public:
+    Bench(GraphSpec spec, int const repeat)
+        : _spec(std::move(spec))
+        , _repeat(repeat)
+        , _registry(registerDataModels())
+    {}
+
+    void run()
+    {
+        for (int r = 0; r < _repeat; ++r) {
+            runOnce();
+        }
+    }
+
+    /// Fastest repetition of `name`, the least noisy for comparisons.
+    double fastest(QString const &name) const
+    {
+        for (Measurement const &measurement : _measurements) {
+            if (measurement.name == name)
+                return *std::min_element(measurement.milliseconds.begin(),
+                                         measurement.milliseconds.end());
+        }
+
+        return 0.0;
+    }
+
+    QJsonArray results()
+    {
+        QJsonArray results;
+
+        for (Measurement &measurement : _measurements) {
+            std::vector<double> &ms = measurement.milliseconds;
+            std::sort(ms.begin(), ms.end());
+
+            QJsonObject json;
+            json["graph"] = _spec.kind;
+            json["nodes"] = static_cast<double>(_spec.nodeTypes.size());
+            json["edges"] = static_cast<double>(_spec.edges.size());
+            json["name"] = measurement.name;
+            json["iterations"] = static_cast<int>(ms.size());
+            json["min_ms"] = ms.front();
+            json["median_ms"] = ms[ms.size() / 2];
+            json["mean_ms"] = std::accumulate(ms.begin(), ms.end(), 0.0) / ms.size();
+
+            results.append(json);
+        }
+
+        return results;
+    }
+
+private:
+    void measure(QString const &name, std::function<void()> const &body)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        body();
+
+        double const ms = timer.nsecsElapsed() / 1e6;
+
+        auto it = std::find_if(_measurements.begin(),
+                               _measurements.end(),
+                               [&](Measurement const &m) { return m.name == name; });
+
+        if (it == _measurements.end())
+            _measurements.push_back(Measurement{name, {ms}});
+        else
+            it->milliseconds.push_back(ms);
+    }
+
+    /// Fills an empty model with the graph, without timing it.
+    void build(DataFlowGraphModel &model, std::vector<NodeId> &ids) const
+    {
+        ids.clear();
+
+        for (QString const &type : _spec.nodeTypes) {
+            ids.push_back(model.addNode(type));
+        }
+
+        for (auto const &edge : _spec.edges) {
+            model.addConnection(ConnectionId{ids[edge.from], 0, ids[edge.to], edge.inPortIndex});
+        }
+
+        model.processPendingPropagation();
+    }
+
+    void runOnce()
+    {
+        DataFlowGraphModel model(_registry);
+
+        // Scheduled propagation flushes in topological order; immediate
+        // propagation would recurse once per node of a chain.
+        model.setPropagationMode(DataFlowGraphModel::PropagationMode::Scheduled);
+
+        std::vector<NodeId> ids;
+        ids.reserve(_spec.nodeTypes.size());
+
+        measure("addNode", [&]() {
+            for (QString const &type : _spec.nodeTypes) {
+                ids.push_back(model.addNode(type));
+            }
+        });
+
+        measure("addConnection", [&]() {
+            for (auto const &edge : _spec.edges) {
+                model.addConnection(ConnectionId{ids[edge.from], 0, ids[edge.to], edge.inPortIndex});
+            }
+        });
+
+        model.processPendingPropagation();
+
+        measure("connections", [&]() {
+            std::size_t count = 0;
+
+            for (NodeId const nodeId : ids) {
+                count += model.connections(nodeId, PortType::Out, 0).size();
+            }
+
+            // Keeps the loop from being optimized away.
+            if (count != _spec.edges.size())
+                qWarning() << "Unexpected connection count" << count;
+        });
+
+        // One input port per node, lookups whose results do not grow with E.
+        measure("inConnections", [&]() {
+            std::size_t count = 0;
+
+            for (int pass = 0; pass < 100; ++pass) {
+                for (NodeId const nodeId : ids) {
+                    count += model.connections(nodeId, PortType::In, 0).size();
+                }
+            }
+
+            if (count > 100 * ids.size())
+                qWarning() << "Unexpected connection count" << count;
+        });
+
+        measure("propagate", [&]() {
+            for (std::size_t i = 0; i < ids.size(); ++i) {
+                if (_spec.nodeTypes[i] == BenchSource::Name())
+                    model.delegateModel<BenchModel>(ids[i])->emitValue(double(i));
+            }
+
+            model.processPendingPropagation();
+        });
+
+        QJsonObject saved;
+
+        measure("save", [&]() { saved = model.save(); });
+
+        measure("load", [&]() {
+            DataFlowGraphModel loaded(_registry);
+            loaded.load(saved);
+        });
+
+        {
+            std::unique_ptr<DataFlowGraphicsScene> scene;
+
+            measure("scenePopulate", [&]() {
+                scene = std::make_unique<DataFlowGraphicsScene>(model);
+            });
+
+            measure("clearScene", [&]() { scene->clearScene(); });
+        }
+
+        // `clearScene()` emptied the model; rebuild it for the deletion.
+        build(model, ids);
+
+        measure("deleteNode", [&]() {
+            for (NodeId const nodeId : ids) {
+                model.deleteNode(nodeId);
+            }
+        });
+
+        build(model, ids);
+
+        {
+            DataFlowGraphicsScene scene(model);
+
+            measure("sceneDeleteNode", [&]() {
+                for (NodeId const nodeId : ids) {
+                    model.deleteNode(nodeId);
+                }
+            });
+        }
+
+        runDense();
+
+        std::vector<ConnectionId> connectionIds;
+        connectionIds.reserve(_spec.edges.size());
+
+        // Sequential ids as the models hand them out.
+        for (auto const &edge : _spec.edges) {
+            connectionIds.push_back(ConnectionId{static_cast<NodeId>(edge.from),
+                                                 0,
+                                                 static_cast<NodeId>(edge.to),
+                                                 edge.inPortIndex});
+        }
+
+        runConnectionSet<std::unordered_set<ConnectionId, CombinedConnectionIdHash>>(
+            "connectionSet/stdCombined", connectionIds);
+        runConnectionSet<std::unordered_set<ConnectionId>>("connectionSet/std", connectionIds);
+        runConnectionSet<FlatHashSet<ConnectionId>>("connectionSet/flat", connectionIds);
+    }
+
+    /// The container operations of `_connectivity` on their own.
+    template<typename Set>
+    void runConnectionSet(QString const &prefix, std::vector<ConnectionId> const &connectionIds)
+    {
+        Set set;
+
+        measure(prefix + "/insert", [&]() {
+            for (ConnectionId const &connectionId : connectionIds) {
+                set.insert(connectionId);
+            }
+        });
+
+        measure(prefix + "/find", [&]() {
+            std::size_t found = 0;
+
+            for (int pass = 0; pass < 10; ++pass) {
+                for (ConnectionId const &connectionId : connectionIds) {
+                    found += set.find(connectionId) != set.end() ? 1 : 0;
+                }
+            }
+
+            if (found != 10 * set.size())
+                qWarning() << "Unexpected lookup count" << found;
+        });
+
+        measure(prefix + "/iterate", [&]() {
+            std::size_t count = 0;
+
+            for (int pass = 0; pass < 10; ++pass) {
+                for (ConnectionId const &connectionId : set) {
+                    count += connectionId.inPortIndex != InvalidPortIndex ? 1 : 0;
+                }
+            }
+
+            if (count != 10 * set.size())
+                qWarning() << "Unexpected iteration count" << count;
+        });
+
+        measure(prefix + "/erase", [&]() {
+            for (ConnectionId const &connectionId : connectionIds) {
+                set.erase(connectionId);
+            }
+        });
+    }
+
+    /// The same structure in the plain model, the baseline without delegates.
+    void runDense()
+    {
+        DenseGraphModel model;
+
+        std::vector<NodeId> ids;
+
+        measure("dense/addNodes", [&]() {
+            ids = model.addNodes(_spec.nodeTypes.size(), QString(), BenchMerge::Inputs, 1);
+        });
+
+        measure("dense/addConnection", [&]() {
+            for (auto const &edge : _spec.edges) {
+                model.addConnection(ConnectionId{ids[edge.from], 0, ids[edge.to], edge.inPortIndex});
+            }
+        });
+
+        measure("dense/connections", [&]() {
+            std::size_t count = 0;
+
+            for (NodeId const nodeId : ids) {
+                count += model.connectionCount(nodeId, PortType::Out, 0);
+            }
+
+            if (count != _spec.edges.size())
+                qWarning() << "Unexpected connection count" << count;
+        });
+
+        measure("dense/inConnections", [&]() {
+            std::size_t count = 0;
+
+            for (int pass = 0; pass < 100; ++pass) {
+                for (NodeId const nodeId : ids) {
+                    count += model.connections(nodeId, PortType::In, 0).size();
+                }
+            }
+
+            if (count > 100 * ids.size())
+                qWarning() << "Unexpected connection count" << count;
+        });
+
+        measure("dense/layout", [&]() {
+            LayeredLayout layout;
+            layout.apply(model);
+        });
+
+        QJsonObject saved;
+
+        measure("dense/save", [&]() { saved = model.save(); });
+
+        measure("dense/load", [&]() {
+            DenseGraphModel loaded;
+            loaded.load(saved);
+        });
+
+        measure("dense/deleteNode", [&]() {
+            for (NodeId const nodeId : ids) {
+                model.deleteNode(nodeId);
+            }
+        });
+    }
+
+private:
+    GraphSpec _spec;
+
+    int _repeat;
+
+    std::shared_ptr<NodeDelegateModelRegistry> _registry;
+
+    std::vector<Measurement> _measurements;
+};
+
+/// How much slower `name` may get on the larger graph.
+struct Bound
+{
+    char const *name;
+    double maximumRatio;
+};
+
+/**
+ * Runs a random DAG with E and 2E edges and fails when an operation grows
+ * faster than its bound, catching accidental quadratic scans. Deleting is
+ * linear in N + E, so at most about twice as slow; the input lookups must
+ * not depend on E at all. The bounds leave room for timing noise.
+ */
+int checkComplexity(std::size_t const nodes, int const repeat, unsigned int const seed)
+{
+    std::size_t const edges = (nodes - 1) * BenchMerge::Inputs / 2;
+
+    Bench small(randomDag(nodes, edges / 2, seed), repeat);
+    Bench large(randomDag(nodes, edges, seed), repeat);
+
+    small.run();
+    large.run();
+
+    Bound const bounds[] = {{"deleteNode", 2.5}, {"sceneDeleteNode", 2.5}, {"inConnections", 1.5}};
+
+    int failures = 0;
+
+    for (Bound const &bound : bounds) {
+        double const before = small.fastest(bound.name);
+        double const after = large.fastest(bound.name);
+
+        // Below the timer resolution there is nothing to compare.
+        double const ratio = after / std::max(before, 1e-3);
+
+        bool const ok = ratio <= bound.maximumRatio;
+
+        QTextStream(stdout) << (ok ? "ok   " : "FAIL ") << bound.name << ": " << before
+                            << " ms -> " << after << " ms, x" << ratio << " (at most x"
+                            << bound.maximumRatio << ")\n";
+
+        if (!ok)
+            ++failures;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
+
+} // namespace
+
+/**
+ * Times the model and scene operations on generated graphs and prints the
+ * results as JSON.
+ *
+ *   bench_nodes --graph all --nodes 10000 --edges 40000 --repeat 5 --output bench.json
+ *
+ * With `--check` it instead compares a graph against one with twice the
+ * edges and exits with 1 when an operation scales worse than expected.
+ */
+int main(int argc, char *argv[])
+{
+    // Scenes need a GUI application but no display.
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks QtNodes on synthetic graphs.");
+    parser.addHelpOption();
+
+    QCommandLineOption graphOption("graph", "chain, fanout, dag, mesh or all.", "kind", "all");
+    QCommandLineOption nodesOption("nodes", "Number of nodes.", "count", "1000");
+    QCommandLineOption edgesOption("edges", "Number of edges of the random DAG.", "count", "4000");
+    QCommandLineOption widthOption("width", "Layer width of the mesh, at most 8.", "count", "8");
+    QCommandLineOption repeatOption("repeat", "Runs per graph.", "count", "5");
+    QCommandLineOption seedOption("seed", "Seed of the random DAG.", "value", "1");
+    QCommandLineOption outputOption("output", "File for the JSON results.", "file");
+    QCommandLineOption checkOption("check", "Checks the complexity bounds instead.");
+
+    parser.addOption(graphOption);
+    parser.addOption(nodesOption);
+    parser.addOption(edgesOption);
+    parser.addOption(widthOption);
+    parser.addOption(repeatOption);
+    parser.addOption(seedOption);
+    parser.addOption(outputOption);
+    parser.addOption(checkOption);
+    parser.process(app);
+
+    std::size_t const nodes = parser.value(nodesOption).toULongLong();
+    std::size_t const edges = parser.value(edgesOption).toULongLong();
+    std::size_t const width = std::max<std::size_t>(1,
+                                                    std::min<std::size_t>(BenchMerge::Inputs,
+                                                                          parser.value(widthOption)
+                                                                              .toULongLong()));
+    int const repeat = std::max(1, parser.value(repeatOption).toInt());
+    unsigned int const seed = parser.value(seedOption).toUInt();
+
+    if (parser.isSet(checkOption))
+        return checkComplexity(std::max<std::size_t>(2, nodes), repeat, seed);
+
+    QString const kind = parser.value(graphOption);
+
+    std::vector<GraphSpec> specs;
+
+    if (kind == "chain" || kind == "all")
+        specs.push_back(chainGraph(nodes));
+
+    if (kind == "fanout" || kind == "all")
+        specs.push_back(fanOutGraph(nodes));
+
+    if (kind == "dag" || kind == "all")
+        specs.push_back(randomDag(nodes, edges, seed));
+
+    if (kind == "mesh" || kind == "all")
+        specs.push_back(meshGraph(nodes, width));
+
+    if (specs.empty())
+        parser.showHelp(1);
+
+    QJsonArray benchmarks;
+
+    for (GraphSpec &spec : specs) {
+        Bench bench(std::move(spec), repeat);
+        bench.run();
+
+        for (QJsonValue const result : bench.results()) {
+            benchmarks.append(result);
+        }
+    }
+
+    QJsonObject report;
+    report["benchmarks"] = benchmarks;
+    report["qtVersion"] = QString::fromLatin1(qVersion());
+
+    QByteArray const json = QJsonDocument(report).toJson();
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+
+        if (!file.open(QIODevice::WriteOnly)) {
+            qCritical() << "Cannot write" << file.fileName();
+            return 1;
+        }
+
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+
+    return 0;
+}
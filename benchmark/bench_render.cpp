@@ -0,0 +1,318 @@
+#include "BenchModels.hpp"
+
+#include <QtNodes/DataFlowGraphModel>
+#include <QtNodes/DataFlowGraphicsScene>
+#include <QtNodes/DefaultNodePainter>
+#include <QtNodes/GraphicsView>
+#include <QtNodes/NodeDelegateModelRegistry>
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QTextStream>
+#include <QtGui/QImage>
+#include <QtGui/QPainter>
+#include <QtWidgets/QApplication>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <vector>
+
+using QtNodes::BasicGraphicsScene;
+using QtNodes::ConnectionId;
+using QtNodes::DataFlowGraphicsScene;
+using QtNodes::DataFlowGraphModel;
+using QtNodes::DefaultNodePainter;
+using QtNodes::GraphicsView;
+using QtNodes::NodeDelegateModelRegistry;
+using QtNodes::NodeId;
+using QtNodes::NodeRole;
+using QtNodes::PaintStatistics;
+
+namespace {
+
+std::shared_ptr<NodeDelegateModelRegistry> registerDataModels()
+{
+    auto ret = std::make_shared<NodeDelegateModelRegistry>();
+
+    ret->registerModel<BenchSource>("Bench");
+
+    ret->registerModel<BenchMerge>("Bench");
+
+    return ret;
+}
+
+/// Node painters to compare, an entry per `--node-painter` value.
+std::map<QString, std::function<std::unique_ptr<QtNodes::AbstractNodePainter>()>> nodePainters()
+{
+    return {{"default", []() { return std::make_unique<DefaultNodePainter>(); }}};
+}
+
+/**
+ * A grid of nodes `rows` high; every node past the first column
+ * reads its own row and the next one of the previous column. The grid
+ * follows the orientation so that connections run along the data flow.
+ */
+void populate(DataFlowGraphModel &model,
+              std::size_t const nodes,
+              std::size_t const rows,
+              Qt::Orientation const orientation)
+{
+    std::vector<NodeId> ids;
+    ids.reserve(nodes);
+
+    for (std::size_t i = 0; i < nodes; ++i) {
+        std::size_t const column = i / rows;
+        std::size_t const row = i % rows;
+
+        NodeId const nodeId = model.addNode(column == 0 ? BenchSource::Name()
+                                                        : BenchMerge::Name());
+
+        QPointF const along(column * 300.0, row * 260.0);
+
+        model.setNodeData(nodeId,
+                          NodeRole::Position,
+                          orientation == Qt::Horizontal ? along
+                                                        : QPointF(along.y() * 1.6, along.x()));
+
+        ids.push_back(nodeId);
+
+        if (column == 0)
+            continue;
+
+        std::size_t const previous = i - rows;
+        std::size_t const neighbour = (column - 1) * rows + (row + 1) % rows;
+
+        model.addConnection(ConnectionId{ids[previous], 0, nodeId, 0});
+
+        if (rows > 1 && neighbour < ids.size())
+            model.addConnection(ConnectionId{ids[neighbour], 0, nodeId, 1});
+    }
+}
+
+struct Options
+{
+    std::size_t nodes;
+    std::size_t rows;
+    int frames;
+    QSize size;
+    std::vector<double> zooms;
+    std::vector<Qt::Orientation> orientations;
+    QString nodePainter;
+    BasicGraphicsScene::NodeShadowMode shadowMode;
+    bool renderCache;
+    bool batching;
+};
+
+QString orientationName(Qt::Orientation const orientation)
+{
+    return orientation == Qt::Horizontal ? QStringLiteral("horizontal")
+                                         : QStringLiteral("vertical");
+}
+
+/// Renders `frames` frames of the centered view at each zoom level.
+QJsonArray run(Options const &options, Qt::Orientation const orientation)
+{
+    DataFlowGraphModel model(registerDataModels());
+
+    DataFlowGraphicsScene scene(model);
+    scene.setOrientation(orientation);
+    scene.setNodePainter(nodePainters().at(options.nodePainter)());
+    scene.setNodeShadowMode(options.shadowMode);
+    scene.setNodeRenderCacheEnabled(options.renderCache);
+    scene.setConnectionBatching(options.batching);
+
+    populate(model, options.nodes, options.rows, orientation);
+
+    GraphicsView view(&scene);
+    view.setScaleRange(0, 0);
+    view.resize(options.size);
+    view.show();
+
+    QApplication::processEvents();
+
+    QRectF const itemsRect = scene.itemsBoundingRect();
+
+    QImage image(view.viewport()->size(), QImage::Format_ARGB32_Premultiplied);
+
+    QJsonArray results;
+
+    for (double const zoom : options.zooms) {
+        view.setupScale(zoom);
+        view.centerOn(itemsRect.center());
+
+        QApplication::processEvents();
+
+        PaintStatistics statistics;
+
+        auto renderFrame = [&]() {
+            PaintStatistics::Activation activation(&statistics);
+
+            statistics.beginFrame();
+
+            QPainter painter(&image);
+            view.render(&painter, QRectF(image.rect()), view.viewport()->rect());
+            painter.end();
+
+            statistics.endFrame();
+        };
+
+        // Fills the caches painters keep between frames.
+        renderFrame();
+        statistics.reset();
+
+        for (int f = 0; f < options.frames; ++f) {
+            renderFrame();
+        }
+
+        QJsonObject json = statistics.toJson();
+        json.remove("lastFrame");
+
+        json["orientation"] = orientationName(orientation);
+        json["zoom"] = zoom;
+        json["nodes"] = static_cast<double>(options.nodes);
+        json["visibleItems"] = view.items(view.viewport()->rect()).size();
+
+        QJsonObject perFrame;
+
+        for (int c = 0; c < PaintStatistics::CategoryCount; ++c) {
+            auto const category = static_cast<PaintStatistics::Category>(c);
+
+            double const ms = statistics.total(category).nanoseconds / 1e6;
+
+            perFrame[PaintStatistics::categoryName(category)] = ms / options.frames;
+        }
+
+        json["msPerFrame"] = perFrame;
+        json["memory"] = scene.memoryReport().toJson();
+
+        results.append(json);
+    }
+
+    return results;
+}
+
+} // namespace
+
+/**
+ * Renders a generated scene offscreen at several zoom levels and prints the
+ * frame times, split by painter, as JSON.
+ *
+ *   bench_render --nodes 2000 --zoom 0.25,0.5,1,2 --orientation both --output render.json
+ */
+int main(int argc, char *argv[])
+{
+    // Renders into images, no display needed.
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks the QtNodes painters offscreen.");
+    parser.addHelpOption();
+
+    QCommandLineOption nodesOption("nodes", "Number of nodes.", "count", "1000");
+    QCommandLineOption rowsOption("rows", "Nodes per column of the grid.", "count", "25");
+    QCommandLineOption framesOption("frames", "Timed frames per zoom level.", "count", "20");
+    QCommandLineOption sizeOption("size", "Viewport size.", "WxH", "1920x1080");
+    QCommandLineOption zoomOption("zoom", "Comma separated zoom levels.", "list", "0.1,0.25,0.5,1,2");
+    QCommandLineOption orientationOption("orientation",
+                                         "horizontal, vertical or both.",
+                                         "name",
+                                         "both");
+    QCommandLineOption painterOption("node-painter", "Node painter, default.", "name", "default");
+    QCommandLineOption shadowOption("shadow", "effect, texture or none.", "mode", "effect");
+    QCommandLineOption renderCacheOption("render-cache", "Caches node renderings.");
+    QCommandLineOption batchingOption("batching", "Batches connection drawing.");
+    QCommandLineOption outputOption("output", "File for the JSON results.", "file");
+
+    parser.addOption(nodesOption);
+    parser.addOption(rowsOption);
+    parser.addOption(framesOption);
+    parser.addOption(sizeOption);
+    parser.addOption(zoomOption);
+    parser.addOption(orientationOption);
+    parser.addOption(painterOption);
+    parser.addOption(shadowOption);
+    parser.addOption(renderCacheOption);
+    parser.addOption(batchingOption);
+    parser.addOption(outputOption);
+    parser.process(app);
+
+    Options options;
+    options.nodes = parser.value(nodesOption).toULongLong();
+    options.rows = std::max<std::size_t>(1, parser.value(rowsOption).toULongLong());
+    options.frames = std::max(1, parser.value(framesOption).toInt());
+    options.nodePainter = parser.value(painterOption);
+    options.renderCache = parser.isSet(renderCacheOption);
+    options.batching = parser.isSet(batchingOption);
+
+    QStringList const size = parser.value(sizeOption).split('x');
+
+    options.size = size.size() == 2 ? QSize(size[0].toInt(), size[1].toInt()) : QSize();
+
+    for (QString const &zoom : parser.value(zoomOption).split(',')) {
+        double const value = zoom.toDouble();
+
+        if (value > 0)
+            options.zooms.push_back(value);
+    }
+
+    QString const orientation = parser.value(orientationOption);
+
+    if (orientation == "horizontal" || orientation == "both")
+        options.orientations.push_back(Qt::Horizontal);
+
+    if (orientation == "vertical" || orientation == "both")
+        options.orientations.push_back(Qt::Vertical);
+
+    QString const shadow = parser.value(shadowOption);
+
+    if (shadow == "texture")
+        options.shadowMode = BasicGraphicsScene::NodeShadowMode::Texture;
+    else if (shadow == "none")
+        options.shadowMode = BasicGraphicsScene::NodeShadowMode::None;
+    else
+        options.shadowMode = BasicGraphicsScene::NodeShadowMode::Effect;
+
+    if (options.zooms.empty() || options.orientations.empty() || options.size.isEmpty()
+        || nodePainters().count(options.nodePainter) == 0)
+        parser.showHelp(1);
+
+    QJsonArray benchmarks;
+
+    for (Qt::Orientation const o : options.orientations) {
+        for (QJsonValue const result : run(options, o)) {
+            benchmarks.append(result);
+        }
+    }
+
+    QJsonObject report;
+    report["benchmarks"] = benchmarks;
+    report["qtVersion"] = QString::fromLatin1(qVersion());
+    report["renderCache"] = options.renderCache;
+    report["batching"] = options.batching;
+    report["shadow"] = shadow;
+
+    QByteArray const json = QJsonDocument(report).toJson();
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+
+        if (!file.open(QIODevice::WriteOnly)) {
+            qCritical() << "Cannot write" << file.fileName();
+            return 1;
+        }
+
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+
+    return 0;
+}
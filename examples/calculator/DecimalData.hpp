@@ -2,12 +2,25 @@
 
 #include <QtNodes/NodeData>
 
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
 using QtNodes::NodeData;
 using QtNodes::NodeDataType;
+using QtNodes::TypedNodeData;
 
 /// The class can potentially incapsulate any user data which
 /// need to be transferred within the Node Editor graph
-class DecimalData : public NodeData
+/**
+ * Besides a single number it can carry a whole column of them, so that a
+ * batch of rows goes through the graph in one propagation. The values are
+ * contiguous and shared by all copies, and a single number behaves as a
+ * column of one.
+ */
+class DecimalData : public TypedNodeData<DecimalData>
 {
 public:
     DecimalData()
@@ -18,12 +31,57 @@ public:
         : _number(number)
     {}
 
+    explicit DecimalData(std::vector<double> column)
+        : _number(0.0)
+        , _column(std::make_shared<std::vector<double> const>(std::move(column)))
+    {
+        if (!_column->empty())
+            _number = _column->front();
+    }
+
     NodeDataType type() const override { return NodeDataType{"decimal", "Decimal"}; }
 
+    bool hasContentHash() const override { return true; }
+
+    std::size_t contentHash() const override
+    {
+        if (!_column)
+            return std::hash<double>()(_number);
+
+        std::size_t hash = _column->size();
+
+        for (double const value : *_column) {
+            hash ^= std::hash<double>()(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        }
+
+        return hash;
+    }
+
+    std::size_t memoryUsage() const override
+    {
+        return _column ? _column->capacity() * sizeof(double) : 0;
+    }
+
+    /// The first value of a column.
     double number() const { return _number; }
 
-    QString numberAsText() const { return QString::number(_number, 'f'); }
+    bool isColumn() const { return _column != nullptr; }
+
+    std::size_t size() const { return _column ? _column->size() : 1; }
+
+    /// `size()` contiguous values.
+    double const *values() const { return _column ? _column->data() : &_number; }
+
+    QString numberAsText() const
+    {
+        if (_column && _column->size() != 1)
+            return QStringLiteral("%1 values").arg(_column->size());
+
+        return QString::number(_number, 'f');
+    }
 
 private:
     double _number;
+
+    std::shared_ptr<std::vector<double> const> _column;
 };
@@ -55,14 +55,15 @@ private:
         auto n1 = _number1.lock();
         auto n2 = _number2.lock();
 
-        if (n2 && (n2->number() == 0.0)) {
+        // Zeros within a column give infinities, as a vectorized loop cannot stop.
+        if (n2 && !n2->isColumn() && (n2->number() == 0.0)) {
             //modelValidationState = NodeValidationState::Error;
             //modelValidationError = QStringLiteral("Division by zero error");
             _result.reset();
         } else if (n1 && n2) {
             //modelValidationState = NodeValidationState::Valid;
             //modelValidationError = QString();
-            _result = std::make_shared<DecimalData>(n1->number() / n2->number());
+            _result = combine(*n1, *n2, std::divides<double>());
         } else {
             //modelValidationState = NodeValidationState::Warning;
             //modelValidationError = QStringLiteral("Missing or incorrect inputs");
@@ -1,24 +1,32 @@
 #pragma once
 
-#include <QtNodes/NodeDelegateModel>
+#include "DecimalData.hpp"
+
+#include <QtNodes/StaticNodeDelegateModel>
 
 #include <QtCore/QJsonObject>
 #include <QtCore/QObject>
 #include <QtWidgets/QLabel>
 
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
-class DecimalData;
-
+using QtNodes::Inputs;
 using QtNodes::NodeData;
 using QtNodes::NodeDataType;
 using QtNodes::NodeDelegateModel;
+using QtNodes::Outputs;
 using QtNodes::PortIndex;
 using QtNodes::PortType;
+using QtNodes::StaticNodeDelegateModel;
 
 /// The model dictates the number of inputs and outputs for the Node.
 /// In this example it has no logic.
-class MathOperationDataModel : public NodeDelegateModel
+class MathOperationDataModel
+    : public StaticNodeDelegateModel<MathOperationDataModel,
+                                     Inputs<DecimalData, DecimalData>,
+                                     Outputs<DecimalData>>
 {
     Q_OBJECT
 
@@ -26,22 +34,69 @@ public:
     ~MathOperationDataModel() = default;
 
 public:
-    unsigned int nPorts(PortType portType) const override;
-
-    NodeDataType dataType(PortType portType, PortIndex portIndex) const override;
-
     std::shared_ptr<NodeData> outData(PortIndex port) override;
 
-    void setInData(std::shared_ptr<NodeData> data, PortIndex portIndex) override;
+    void setTypedInData(std::shared_ptr<DecimalData const> data, PortIndex portIndex);
 
     QWidget *embeddedWidget() override { return nullptr; }
 
+    bool recyclable() const override { return true; }
+
+    void prepareForReuse() override;
+
+    /// The result follows from the inputs alone.
+    bool releasable() const override { return true; }
+
+    void releaseData() override { prepareForReuse(); }
+
 protected:
     virtual void compute() = 0;
 
+    /// Applies `op` to the values of both inputs pairwise.
+    /**
+   * A single number is combined with every value of a column, two columns
+   * up to the length of the shorter one. Each case has its own plain loop
+   * over contiguous values, which the compiler vectorizes.
+   */
+    template<typename Operation>
+    static std::shared_ptr<DecimalData> combine(DecimalData const &lhs,
+                                                DecimalData const &rhs,
+                                                Operation op)
+    {
+        if (!lhs.isColumn() && !rhs.isColumn())
+            return std::make_shared<DecimalData>(op(lhs.number(), rhs.number()));
+
+        double const *a = lhs.values();
+        double const *b = rhs.values();
+
+        std::size_t const count = !lhs.isColumn()   ? rhs.size()
+                                  : !rhs.isColumn() ? lhs.size()
+                                                    : std::min(lhs.size(), rhs.size());
+
+        std::vector<double> result(count);
+        double *out = result.data();
+
+        if (!lhs.isColumn()) {
+            double const x = a[0];
+
+            for (std::size_t i = 0; i < count; ++i)
+                out[i] = op(x, b[i]);
+        } else if (!rhs.isColumn()) {
+            double const y = b[0];
+
+            for (std::size_t i = 0; i < count; ++i)
+                out[i] = op(a[i], y);
+        } else {
+            for (std::size_t i = 0; i < count; ++i)
+                out[i] = op(a[i], b[i]);
+        }
+
+        return std::make_shared<DecimalData>(std::move(result));
+    }
+
 protected:
-    std::weak_ptr<DecimalData> _number1;
-    std::weak_ptr<DecimalData> _number2;
+    std::weak_ptr<DecimalData const> _number1;
+    std::weak_ptr<DecimalData const> _number2;
 
     std::shared_ptr<DecimalData> _result;
 };
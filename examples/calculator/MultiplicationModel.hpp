@@ -32,7 +32,7 @@ private:
         if (n1 && n2) {
             //modelValidationState = NodeValidationState::Valid;
             //modelValidationError = QString();
-            _result = std::make_shared<DecimalData>(n1->number() * n2->number());
+            _result = combine(*n1, *n2, std::multiplies<double>());
         } else {
             //modelValidationState = NodeValidationState::Warning;
             //modelValidationError = QStringLiteral("Missing or incorrect inputs");
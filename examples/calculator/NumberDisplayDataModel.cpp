@@ -38,11 +38,13 @@ std::shared_ptr<NodeData> NumberDisplayDataModel::outData(PortIndex)
 
 void NumberDisplayDataModel::setInData(std::shared_ptr<NodeData> data, PortIndex portIndex)
 {
-    _numberData = std::dynamic_pointer_cast<DecimalData>(data);
+    _numberData = QtNodes::nodeDataCast<DecimalData>(data);
 
     if (!_label)
         return;
 
+    QSize const size = _label->size();
+
     if (_numberData) {
         _label->setText(_numberData->numberAsText());
     } else {
@@ -50,6 +52,9 @@ void NumberDisplayDataModel::setInData(std::shared_ptr<NodeData> data, PortIndex
     }
 
     _label->adjustSize();
+
+    if (_label->size() != size)
+        Q_EMIT embeddedWidgetSizeUpdated();
 }
 
 QWidget *NumberDisplayDataModel::embeddedWidget()
@@ -66,6 +66,8 @@ void NumberSourceDataModel::onTextEdited(QString const &str)
     if (ok) {
         _number = std::make_shared<DecimalData>(number);
 
+        Q_EMIT internalDataChanged();
+
         Q_EMIT dataUpdated(0);
 
     } else {
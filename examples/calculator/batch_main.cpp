@@ -0,0 +1,211 @@
+#include "AdditionModel.hpp"
+#include "DecimalData.hpp"
+#include "DivisionModel.hpp"
+#include "MultiplicationModel.hpp"
+#include "NumberDisplayDataModel.hpp"
+#include "NumberSourceDataModel.hpp"
+#include "SubtractionModel.hpp"
+
+#include <QtNodes/BatchEvaluator>
+#include <QtNodes/NodeDelegateModelRegistry>
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+
+#include <algorithm>
+#include <exception>
+#include <vector>
+
+using QtNodes::BatchEvaluator;
+using QtNodes::NodeDelegateModelRegistry;
+using QtNodes::NodeId;
+using QtNodes::PortType;
+
+static std::shared_ptr<NodeDelegateModelRegistry> registerDataModels()
+{
+    auto ret = std::make_shared<NodeDelegateModelRegistry>();
+    ret->registerModel<NumberSourceDataModel>("Sources");
+
+    ret->registerModel<NumberDisplayDataModel>("Displays");
+
+    ret->registerModel<AdditionModel>("Operators");
+
+    ret->registerModel<SubtractionModel>("Operators");
+
+    ret->registerModel<MultiplicationModel>("Operators");
+
+    ret->registerModel<DivisionModel>("Operators");
+
+    return ret;
+}
+
+static QStringList splitFields(QString const &text, QChar const separator)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    return text.split(separator, Qt::SkipEmptyParts);
+#else
+    return text.split(separator, QString::SkipEmptyParts);
+#endif
+}
+
+/// Parses a comma separated list of node ids into ports of the given type.
+static std::vector<BatchEvaluator::Port> parsePorts(QString const &list, PortType const portType)
+{
+    std::vector<BatchEvaluator::Port> ports;
+
+    for (QString const &id : splitFields(list, ',')) {
+        ports.push_back(BatchEvaluator::Port{static_cast<NodeId>(id.toUInt()), portType, 0});
+    }
+
+    return ports;
+}
+
+/**
+ * Evaluates a scene saved by the `calculator` example for every line of
+ * the standard input.
+ *
+ *   batch_calculator scene.flow --inputs 0,3 --outputs 2 < numbers.txt
+ *
+ * Each line holds one number per input node; they replace the values of the
+ * source nodes. The numbers reaching the output nodes are printed one line
+ * per input line, empty fields stand for missing data.
+ *
+ * With `--columns` the lines are gathered into one column per input node
+ * and the graph is evaluated once, the operators processing whole columns.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Evaluates a calculator scene for many inputs.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("scene", "Scene file saved by the calculator example.");
+
+    QCommandLineOption inputsOption("inputs", "Ids of the source nodes.", "ids");
+    QCommandLineOption outputsOption("outputs", "Ids of the display nodes.", "ids");
+    QCommandLineOption threadsOption("threads", "Number of worker threads.", "count", "0");
+    QCommandLineOption columnsOption("columns", "Evaluate all lines at once as columns.");
+
+    parser.addOption(inputsOption);
+    parser.addOption(outputsOption);
+    parser.addOption(threadsOption);
+    parser.addOption(columnsOption);
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1)
+        parser.showHelp(1);
+
+    QFile file(parser.positionalArguments().first());
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCritical() << "Cannot open" << file.fileName();
+        return 1;
+    }
+
+    QJsonObject const scene = QJsonDocument::fromJson(file.readAll()).object();
+
+    BatchEvaluator evaluator(registerDataModels(), scene);
+    evaluator.setInputPorts(parsePorts(parser.value(inputsOption), PortType::Out));
+    evaluator.setOutputPorts(parsePorts(parser.value(outputsOption), PortType::In));
+    evaluator.setThreadCount(parser.value(threadsOption).toUInt());
+
+    bool const columnar = parser.isSet(columnsOption);
+
+    std::vector<BatchEvaluator::Values> inputSets;
+
+    std::vector<std::vector<double>> columns;
+    std::size_t rows = 0;
+
+    QTextStream in(stdin);
+
+    while (!in.atEnd()) {
+        QString const line = in.readLine().trimmed();
+
+        if (line.isEmpty())
+            continue;
+
+        QStringList const fields = splitFields(line, ' ');
+
+        if (columnar) {
+            columns.resize(std::max(columns.size(), static_cast<std::size_t>(fields.size())));
+
+            for (int i = 0; i < fields.size(); ++i) {
+                columns[i].resize(rows, 0.0);
+                columns[i].push_back(fields[i].toDouble());
+            }
+
+            ++rows;
+            continue;
+        }
+
+        BatchEvaluator::Values values;
+
+        for (QString const &field : fields) {
+            values.push_back(std::make_shared<DecimalData>(field.toDouble()));
+        }
+
+        inputSets.push_back(std::move(values));
+    }
+
+    if (columnar) {
+        BatchEvaluator::Values values;
+
+        for (auto &column : columns) {
+            column.resize(rows, 0.0);
+            values.push_back(std::make_shared<DecimalData>(std::move(column)));
+        }
+
+        inputSets.push_back(std::move(values));
+    }
+
+    std::vector<BatchEvaluator::Values> results;
+
+    try {
+        results = evaluator.run(inputSets);
+    } catch (std::exception const &e) {
+        qCritical() << "Evaluation failed:" << e.what();
+        return 1;
+    }
+
+    QTextStream out(stdout);
+
+    if (columnar && !results.empty()) {
+        for (std::size_t row = 0; row < rows; ++row) {
+            QStringList fields;
+
+            for (auto const &data : results.front()) {
+                auto const number = QtNodes::nodeDataCast<DecimalData>(data);
+
+                // A single value stands for the whole column.
+                if (number && (!number->isColumn() || row < number->size())) {
+                    double const value = number->values()[number->isColumn() ? row : 0];
+                    fields << QString::number(value, 'f');
+                } else {
+                    fields << QString();
+                }
+            }
+
+            out << fields.join(' ') << '\n';
+        }
+
+        return 0;
+    }
+
+    for (auto const &outputs : results) {
+        QStringList fields;
+
+        for (auto const &data : outputs) {
+            auto const number = QtNodes::nodeDataCast<DecimalData>(data);
+            fields << (number ? number->numberAsText() : QString());
+        }
+
+        out << fields.join(' ') << '\n';
+    }
+
+    return 0;
+}
@@ -265,6 +265,20 @@ bool DynamicPortsModel::deleteConnection(ConnectionId const connectionId)
     return disconnected;
 }
 
+void DynamicPortsModel::remapConnections(ConnectionRemap const &remap)
+{
+    // All old addresses go first, a shifted one may equal another's old one.
+    for (auto const &entry : remap) {
+        _connectivity.erase(entry.first);
+    }
+
+    for (auto const &entry : remap) {
+        _connectivity.insert(entry.second);
+    }
+
+    Q_EMIT connectionsRemapped(remap);
+}
+
 bool DynamicPortsModel::deleteNode(NodeId const nodeId)
 {
     // Delete connections to this node first.
@@ -78,6 +78,8 @@ public:
 
     bool deleteConnection(ConnectionId const connectionId) override;
 
+    void remapConnections(ConnectionRemap const &remap) override;
+
     bool deleteNode(NodeId const nodeId) override;
 
     QJsonObject saveNode(NodeId const) const override;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QtCore/QObject>
+#include <QtWidgets/QWidget>
 
 #include <QtNodes/NodeData>
 #include <QtNodes/NodeDelegateModel>
@@ -6,20 +6,34 @@
 #include <QtWidgets/QFileDialog>
 
 ImageLoaderModel::ImageLoaderModel()
-    : _label(new QLabel("Double click to load image"))
+    : _label(nullptr)
+{}
+
+QWidget *ImageLoaderModel::embeddedWidget()
 {
-    _label->setAlignment(Qt::AlignVCenter | Qt::AlignHCenter);
+    if (!_label) {
+        _label = new QLabel("Double click to load image");
+
+        _label->setAlignment(Qt::AlignVCenter | Qt::AlignHCenter);
+
+        QFont f = _label->font();
+        f.setBold(true);
+        f.setItalic(true);
 
-    QFont f = _label->font();
-    f.setBold(true);
-    f.setItalic(true);
+        _label->setFont(f);
 
-    _label->setFont(f);
+        _label->setMinimumSize(200, 200);
+        _label->setMaximumSize(500, 300);
 
-    _label->setMinimumSize(200, 200);
-    _label->setMaximumSize(500, 300);
+        _label->installEventFilter(this);
 
-    _label->installEventFilter(this);
+        connect(&_preview,
+                &ImagePreview::previewReady,
+                this,
+                &ImageLoaderModel::updatePreview);
+    }
+
+    return _label;
 }
 
 unsigned int ImageLoaderModel::nPorts(PortType portType) const
@@ -44,25 +58,28 @@ unsigned int ImageLoaderModel::nPorts(PortType portType) const
 bool ImageLoaderModel::eventFilter(QObject *object, QEvent *event)
 {
     if (object == _label) {
-        int w = _label->width();
-        int h = _label->height();
-
         if (event->type() == QEvent::MouseButtonPress) {
             QString fileName = QFileDialog::getOpenFileName(nullptr,
                                                             tr("Open Image"),
                                                             QDir::homePath(),
                                                             tr("Image Files (*.png *.jpg *.bmp)"));
 
-            _pixmap = QPixmap(fileName);
+            QImage const image(fileName);
 
-            _label->setPixmap(_pixmap.scaled(w, h, Qt::KeepAspectRatio));
+            _image = image.isNull() ? nullptr : std::make_shared<TiledImageData>(image);
+
+            if (_image)
+                _preview.setImage(_image);
+            else
+                _preview.clear();
+
+            updatePreview();
 
             Q_EMIT dataUpdated(0);
 
             return true;
         } else if (event->type() == QEvent::Resize) {
-            if (!_pixmap.isNull())
-                _label->setPixmap(_pixmap.scaled(w, h, Qt::KeepAspectRatio));
+            updatePreview();
         }
     }
 
@@ -71,10 +88,16 @@ bool ImageLoaderModel::eventFilter(QObject *object, QEvent *event)
 
 NodeDataType ImageLoaderModel::dataType(PortType const, PortIndex const) const
 {
-    return PixmapData().type();
+    return TiledImageData::staticType();
 }
 
 std::shared_ptr<NodeData> ImageLoaderModel::outData(PortIndex)
 {
-    return std::make_shared<PixmapData>(_pixmap);
+    return _image;
+}
+
+void ImageLoaderModel::updatePreview()
+{
+    if (_image)
+        _label->setPixmap(QPixmap::fromImage(_preview.preview(_label->size())));
 }
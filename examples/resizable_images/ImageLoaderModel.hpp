@@ -5,16 +5,18 @@
 #include <QtCore/QObject>
 #include <QtWidgets/QLabel>
 
+#include <QtNodes/ImagePreview>
 #include <QtNodes/NodeDelegateModel>
 #include <QtNodes/NodeDelegateModelRegistry>
+#include <QtNodes/TiledImageData>
 
-#include "PixmapData.hpp"
-
+using QtNodes::ImagePreview;
 using QtNodes::NodeData;
 using QtNodes::NodeDataType;
 using QtNodes::NodeDelegateModel;
 using QtNodes::PortIndex;
 using QtNodes::PortType;
+using QtNodes::TiledImageData;
 
 /// The model dictates the number of inputs and outputs for the Node.
 /// In this example it has no logic.
@@ -43,15 +45,23 @@ public:
 
     void setInData(std::shared_ptr<NodeData>, PortIndex const portIndex) override {}
 
-    QWidget *embeddedWidget() override { return _label; }
+    QWidget *embeddedWidget() override;
+
+    /// The minimum size of the label, which the node starts with.
+    QSize embeddedWidgetSizeHint() const override { return QSize(200, 200); }
 
     bool resizable() const override { return true; }
 
 protected:
     bool eventFilter(QObject *object, QEvent *event) override;
 
+private:
+    void updatePreview();
+
 private:
     QLabel *_label;
 
-    QPixmap _pixmap;
+    ImagePreview _preview;
+
+    std::shared_ptr<TiledImageData> _image;
 };
@@ -1,7 +1,5 @@
 #include "ImageShowModel.hpp"
 
-#include "PixmapData.hpp"
-
 #include <QtNodes/NodeDelegateModelRegistry>
 
 #include <QtCore/QDir>
@@ -22,6 +20,8 @@ ImageShowModel::ImageShowModel()
     _label->setMinimumSize(200, 200);
 
     _label->installEventFilter(this);
+
+    connect(&_preview, &ImagePreview::previewReady, this, &ImageShowModel::updatePreview);
 }
 
 unsigned int ImageShowModel::nPorts(PortType portType) const
@@ -45,45 +45,38 @@ unsigned int ImageShowModel::nPorts(PortType portType) const
 
 bool ImageShowModel::eventFilter(QObject *object, QEvent *event)
 {
-    if (object == _label) {
-        int w = _label->width();
-        int h = _label->height();
-
-        if (event->type() == QEvent::Resize) {
-            auto d = std::dynamic_pointer_cast<PixmapData>(_nodeData);
-            if (d) {
-                _label->setPixmap(d->pixmap().scaled(w, h, Qt::KeepAspectRatio));
-            }
-        }
-    }
+    if (object == _label && event->type() == QEvent::Resize)
+        updatePreview();
 
     return false;
 }
 
 NodeDataType ImageShowModel::dataType(PortType const, PortIndex const) const
 {
-    return PixmapData().type();
+    return TiledImageData::staticType();
 }
 
 std::shared_ptr<NodeData> ImageShowModel::outData(PortIndex)
 {
-    return _nodeData;
+    return _image;
 }
 
 void ImageShowModel::setInData(std::shared_ptr<NodeData> nodeData, PortIndex const)
 {
-    _nodeData = nodeData;
-
-    if (_nodeData) {
-        auto d = std::dynamic_pointer_cast<PixmapData>(_nodeData);
+    _image = QtNodes::nodeDataCast<TiledImageData>(nodeData);
 
-        int w = _label->width();
-        int h = _label->height();
+    if (_image)
+        _preview.setImage(_image);
+    else
+        _preview.clear();
 
-        _label->setPixmap(d->pixmap().scaled(w, h, Qt::KeepAspectRatio));
-    } else {
-        _label->setPixmap(QPixmap());
-    }
+    updatePreview();
 
     Q_EMIT dataUpdated(0);
 }
+
+void ImageShowModel::updatePreview()
+{
+    // Scaled on a worker from the tiles of a level close to the label size.
+    _label->setPixmap(QPixmap::fromImage(_preview.preview(_label->size())));
+}
@@ -5,14 +5,18 @@
 #include <QtCore/QObject>
 #include <QtWidgets/QLabel>
 
+#include <QtNodes/ImagePreview>
 #include <QtNodes/NodeDelegateModel>
 #include <QtNodes/NodeDelegateModelRegistry>
+#include <QtNodes/TiledImageData>
 
+using QtNodes::ImagePreview;
 using QtNodes::NodeData;
 using QtNodes::NodeDataType;
 using QtNodes::NodeDelegateModel;
 using QtNodes::PortIndex;
 using QtNodes::PortType;
+using QtNodes::TiledImageData;
 
 /// The model dictates the number of inputs and outputs for the Node.
 /// In this example it has no logic.
@@ -48,8 +52,14 @@ public:
 protected:
     bool eventFilter(QObject *object, QEvent *event) override;
 
+private:
+    /// Shows the level of the image matching the label size.
+    void updatePreview();
+
 private:
     QLabel *_label;
 
-    std::shared_ptr<NodeData> _nodeData;
+    ImagePreview _preview;
+
+    std::shared_ptr<TiledImageData> _image;
 };
@@ -110,6 +110,14 @@ QVariant SimpleGraphModel::nodeData(NodeId nodeId, NodeRole role) const
         result = style.toJson().toVariantMap();
     } break;
 
+    case NodeRole::StylePtr:
+        result = QVariant::fromValue(StyleCollection::sharedNodeStyle());
+        break;
+
+    case NodeRole::Computing:
+        result = false;
+        break;
+
     case NodeRole::InternalData:
         break;
 
@@ -124,6 +132,15 @@ QVariant SimpleGraphModel::nodeData(NodeId nodeId, NodeRole role) const
     case NodeRole::Widget:
         result = QVariant();
         break;
+
+    case NodeRole::WidgetSizeHint:
+        break;
+
+    case NodeRole::ComputeTime:
+        break;
+
+    case NodeRole::LayoutKey:
+        break;
     }
 
     return result;
@@ -158,6 +175,12 @@ bool SimpleGraphModel::setNodeData(NodeId nodeId, NodeRole role, QVariant value)
     case NodeRole::Style:
         break;
 
+    case NodeRole::StylePtr:
+        break;
+
+    case NodeRole::Computing:
+        break;
+
     case NodeRole::InternalData:
         break;
 
@@ -169,6 +192,15 @@ bool SimpleGraphModel::setNodeData(NodeId nodeId, NodeRole role, QVariant value)
 
     case NodeRole::Widget:
         break;
+
+    case NodeRole::WidgetSizeHint:
+        break;
+
+    case NodeRole::ComputeTime:
+        break;
+
+    case NodeRole::LayoutKey:
+        break;
     }
 
     return result;
@@ -203,6 +235,14 @@ QVariant SimpleGraphModel::portData(NodeId nodeId,
             return QString::fromUtf8("Port Out");
 
         break;
+
+    case PortRole::DataTypeId:
+        return QVariant();
+        break;
+
+    case PortRole::Required:
+        return QVariant();
+        break;
     }
 
     return QVariant();
@@ -46,6 +46,11 @@ void TextDisplayDataModel::setInData(std::shared_ptr<NodeData> data, PortIndex c
         _inputText = "";
     }
 
+    QSize const size = _label->size();
+
     _label->setText(_inputText);
     _label->adjustSize();
+
+    if (_label->size() != size)
+        Q_EMIT embeddedWidgetSizeUpdated();
 }
@@ -2,14 +2,59 @@
 
 #include <QPainter>
 
+#include <utility>
+
+#include "Definitions.hpp"
 #include "Export.hpp"
+#include "StyleCollection.hpp"
 
 class QPainter;
 
 namespace QtNodes {
 
+class AbstractGraphModel;
 class ConnectionGraphicsObject;
 
+/// What painting a connection takes when there is no ConnectionGraphicsObject.
+/**
+ * All points are in the coordinates of the painter.
+ */
+struct ConnectionPaintContext
+{
+    AbstractGraphModel const &model;
+
+    ConnectionId connectionId;
+
+    QPointF out;
+
+    QPointF in;
+
+    /// Control points of the cubic from `out` to `in`.
+    std::pair<QPointF, QPointF> c1c2;
+
+    /// The cubic, or the route of a `ConnectionRouter`.
+    QPainterPath const &path;
+
+    bool selected = false;
+
+    bool hovered = false;
+
+    /// Invalid for the colors of the style.
+    QColor color;
+
+    QString label;
+
+    QRectF labelRect;
+
+    /// Styles of the scene or exporter, `nullptr` for those of `StyleCollection`.
+    StyleContext const *styles = nullptr;
+
+    StyleContext const &styleContext() const
+    {
+        return styles ? *styles : StyleCollection::current();
+    }
+};
+
 /// Class enables custom painting for connections.
 class NODE_EDITOR_PUBLIC AbstractConnectionPainter
 {
@@ -22,5 +67,13 @@ public:
     virtual void paint(QPainter *painter, ConnectionGraphicsObject const &cgo) const = 0;
 
     virtual QPainterPath getPainterStroke(ConnectionGraphicsObject const &cgo) const = 0;
+
+    /// Paints a connection without a graphics object, as `GraphImageExporter` does.
+    /**
+     * The painter may belong to a worker thread painting a `QImage`. The
+     * default implementation strokes the path with the normal color of the
+     * connection style.
+     */
+    virtual void paintHeadless(QPainter *painter, ConnectionPaintContext const &context) const;
 };
 } // namespace QtNodes
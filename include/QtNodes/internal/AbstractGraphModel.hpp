@@ -2,18 +2,53 @@
 
 #include "Export.hpp"
 
+#include <functional>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include <QtCore/QJsonObject>
 #include <QtCore/QObject>
+#include <QtCore/QPointF>
+#include <QtCore/QSize>
 #include <QtCore/QVariant>
 
 #include "ConnectionIdHash.hpp"
 #include "Definitions.hpp"
+#include "GraphSnapshot.hpp"
 
 namespace QtNodes {
 
+/// Old and new address of connections moved to other port indices.
+using ConnectionRemap = std::vector<std::pair<ConnectionId, ConnectionId>>;
+
+/**
+ * Net structural changes collected between `AbstractGraphModel::beginBatch()`
+ * and the matching `endBatch()`.
+ *
+ * Items created and deleted inside the same batch do not appear at all.
+ */
+struct NODE_EDITOR_CORE_PUBLIC GraphChangeSet
+{
+    std::unordered_set<NodeId> createdNodes;
+    std::unordered_set<NodeId> deletedNodes;
+    std::unordered_set<NodeId> updatedNodes;
+    std::unordered_set<NodeId> movedNodes;
+
+    std::unordered_set<ConnectionId> createdConnections;
+    std::unordered_set<ConnectionId> deletedConnections;
+
+    /// `modelReset` was emitted inside the batch; listeners should rebuild.
+    bool reset = false;
+
+    bool empty() const;
+
+    std::size_t size() const;
+
+    void clear();
+};
+
 /**
  * The central class in the Model-View approach. It delivers all kinds
  * of information from the backing user data structures that represent
@@ -24,13 +59,39 @@ namespace QtNodes {
  *   - NodeId
  *   - ConnectionId
  */
-class NODE_EDITOR_PUBLIC AbstractGraphModel : public QObject
+class NODE_EDITOR_CORE_PUBLIC AbstractGraphModel : public QObject
 {
     Q_OBJECT
 public:
+    /// Callback type used by the non-allocating connection iteration API.
+    using ConnectionVisitor = std::function<void(ConnectionId const &)>;
+
+    /// Callback type of `forEachNodeGeometry()`.
+    using NodeGeometryVisitor = std::function<void(NodeId, QPointF const &, QSize const &)>;
+
+public:
+    AbstractGraphModel(QObject *parent = nullptr);
+
     /// Generates a new unique NodeId.
     virtual NodeId newNodeId() = 0;
 
+    /// Generates `count` consecutive unique ids at once and returns the first.
+    /**
+   * For bulk construction, e.g. pasting, instead of one `newNodeId()` per
+   * node. The default calls `newNodeId()` `count` times and throws
+   * std::logic_error if the ids are not consecutive; models counting their
+   * ids up override it with a single addition. Returns `InvalidNodeId` for
+   * `count == 0`.
+   */
+    virtual NodeId reserveNodeIds(std::size_t const count);
+
+    /// Capacity hint before adding about `nodes` nodes and `connections` connections.
+    /**
+   * Lets the model grow its tables once instead of rehashing along the way.
+   * Does nothing by default.
+   */
+    virtual void reserve(std::size_t const nodes, std::size_t const connections);
+
     /// @brief Returns the full set of unique Node Ids.
     /**
    * Model creator is responsible for generating unique `unsigned int`
@@ -55,6 +116,40 @@ public:
                                                          PortIndex index) const
         = 0;
 
+    /// Calls `visitor` for every connection attached to the given port.
+    /**
+   * Unlike `connections()` the function does not build a temporary set.
+   * The default implementation falls back to `connections()`; models
+   * keeping their own adjacency tables should override it.
+   *
+   * The visitor must not add or remove connections while iterating.
+   */
+    virtual void forEachConnection(NodeId nodeId,
+                                   PortType portType,
+                                   PortIndex index,
+                                   ConnectionVisitor const &visitor) const;
+
+    /// Calls `visitor` for every input and output connection of `nodeId`.
+    /**
+   * The default implementation falls back to `allConnectionIds()`.
+   * The visitor must not add or remove connections while iterating.
+   */
+    virtual void forEachNodeConnection(NodeId nodeId, ConnectionVisitor const &visitor) const;
+
+    /// Calls `visitor` once for every connection of the graph.
+    /**
+   * Used to populate scenes in one pass. The default implementation walks
+   * `allNodeIds()` with `forEachNodeConnection()` and skips incoming
+   * connections. The visitor must not add or remove connections.
+   */
+    virtual void forEachGraphConnection(ConnectionVisitor const &visitor) const;
+
+    /// Number of connections attached to the given port.
+    /**
+   * The default implementation falls back to `connections()`.
+   */
+    virtual std::size_t connectionCount(NodeId nodeId, PortType portType, PortIndex index) const;
+
     /// Checks if two nodes with the given `connectionId` are connected.
     virtual bool connectionExists(ConnectionId const connectionId) const = 0;
 
@@ -111,6 +206,26 @@ public:
         return nodeData(nodeId, role).value<T>();
     }
 
+    /// Calls `visitor` with the position and size of every node.
+    /**
+   * Culling, layouts and snapshots read all geometry in one pass instead of
+   * two boxed `nodeData()` calls per node. The default implementation walks
+   * `allNodeIds()` with `nodeData()`; models keeping the geometry in their
+   * own tables should override it. The visitor must not modify the model.
+   */
+    virtual void forEachNodeGeometry(NodeGeometryVisitor const &visitor) const;
+
+    /// Writes the position of `nodeIds[i]` to `positions[i]`.
+    /**
+   * `positions` is resized to `nodeIds`; unknown nodes get a null point.
+   * The default implementation calls `nodeData(NodeRole::Position)`.
+   */
+    virtual void nodePositions(std::vector<NodeId> const &nodeIds,
+                               std::vector<QPointF> &positions) const;
+
+    /// Writes the size of `nodeIds[i]` to `sizes[i]`, like `nodePositions()`.
+    virtual void nodeSizes(std::vector<NodeId> const &nodeIds, std::vector<QSize> &sizes) const;
+
     virtual NodeFlags nodeFlags(NodeId nodeId) const
     {
         Q_UNUSED(nodeId);
@@ -125,6 +240,23 @@ public:
    */
     virtual bool setNodeData(NodeId nodeId, NodeRole role, QVariant value) = 0;
 
+    /// Shifts the positions of all `nodeIds` by `delta`.
+    /**
+   * The default implementation calls `setNodeData(NodeRole::Position)` for
+   * every node. Models may override it to update all positions at once and
+   * emit a single `nodePositionsUpdated` signal instead of one
+   * `nodePositionUpdated` per node.
+   */
+    virtual void moveNodes(std::vector<NodeId> const &nodeIds, QPointF const &delta);
+
+    /// Sets the positions of many nodes, e.g. from an automatic layout.
+    /**
+   * The default implementation calls `setNodeData(NodeRole::Position)` for
+   * every node inside one transaction. Models may override it to emit a
+   * single `nodePositionsUpdated` signal, like `moveNodes()`.
+   */
+    virtual void setNodePositions(std::vector<std::pair<NodeId, QPointF>> const &positions);
+
     /// @brief Returns port-related data for requested NodeRole.
     /**
    * @returns Port Data Type, Port Data, Connection Policy, Port
@@ -143,6 +275,13 @@ public:
         return portData(nodeId, portType, index, role).value<T>();
     }
 
+    /// @returns the interned data type handle of the port.
+    /**
+   * Uses `PortRole::DataTypeId` when the model provides it and falls back
+   * to interning `PortRole::DataType` otherwise.
+   */
+    NodeDataTypeId portDataTypeId(NodeId nodeId, PortType portType, PortIndex index) const;
+
     virtual bool setPortData(NodeId nodeId,
                              PortType portType,
                              PortIndex index,
@@ -152,8 +291,40 @@ public:
 
     virtual bool deleteConnection(ConnectionId const connectionId) = 0;
 
+    /// Deletes the existing ones of `connectionIds` inside one transaction.
+    /**
+   * The default implementation calls `deleteConnection()` for each of them.
+   * Models may override it to update their tables once.
+   */
+    virtual void deleteConnections(std::vector<ConnectionId> const &connectionIds);
+
+    /// Moves connections to other ports of the same nodes, e.g. after ports were inserted.
+    /**
+   * The default implementation deletes every old and then adds every new
+   * connection. Models storing connections themselves should rewrite them
+   * in place, propagate no data and emit `connectionsRemapped` once; the
+   * delegates are expected to have moved the data of the ports along.
+   */
+    virtual void remapConnections(ConnectionRemap const &remap);
+
     virtual bool deleteNode(NodeId const nodeId) = 0;
 
+    /// Deletes the nodes and their connections inside one transaction.
+    /**
+   * The default implementation calls `deleteNode()` for each of them.
+   * Models may override it to drop all attached connections in one pass and
+   * skip updating nodes that are about to go as well.
+   */
+    virtual void deleteNodes(std::vector<NodeId> const &nodeIds);
+
+    /// Deletes all nodes and connections.
+    /**
+   * The default implementation passes all nodes to `deleteNodes()`. Models
+   * may override it to drop their tables at once and emit `modelReset`
+   * instead of the per-item signals.
+   */
+    virtual void clear();
+
     /**
    * Reimplement the function if you want to store/restore the node's
    * inner state during undo/redo node deletion operations.
@@ -188,6 +359,7 @@ public:
     /**
    * Function clears connections attached to the ports that are scheduled to be
    * deleted. It must be called right before the model removes its old port data.
+   * The connections of the ports behind are remapped in `portsDeleted()`.
    *
    * @param nodeId Defines the node to be modified
    * @param portType Is either PortType::In or PortType::Out
@@ -220,16 +392,43 @@ public:
                                 PortIndex const last);
 
     /**
-   * Function re-creates the connections that were shifted during the port
-   * insertion. After that the node is updated.
+   * Function remaps the connections that were shifted during the port
+   * insertion, see `remapConnections()`. After that the node is updated.
    */
     void portsInserted();
 
+public:
+    /// Opens a batch of modifications; calls may be nested.
+    /**
+   * While a batch is open the model keeps emitting its usual per-item
+   * signals, but records them into a GraphChangeSet as well. Listeners such
+   * as BasicGraphicsScene may ignore the per-item signals while
+   * `batchInProgress()` is `true` and apply the change set afterwards.
+   */
+    void beginBatch();
+
+    /// Closes the batch; the outermost call emits `batchFinished`.
+    void endBatch();
+
+    bool batchInProgress() const { return _batchDepth > 0; }
+
+public:
+    /// An immutable copy of the graph for readers on other threads.
+    /**
+   * Must be called on the thread owning the model. The tables are rebuilt
+   * lazily after the model signals a change of the nodes or connections;
+   * node sizes are read at that point, as set by the scene geometry.
+   */
+    GraphSnapshot snapshot() const;
+
 Q_SIGNALS:
     void connectionCreated(ConnectionId const connectionId);
 
     void connectionDeleted(ConnectionId const connectionId);
 
+    /// Emitted by `remapConnections()` overrides instead of deletions and creations.
+    void connectionsRemapped(ConnectionRemap const &remap);
+
     void nodeCreated(NodeId const nodeId);
 
     void nodeDeleted(NodeId const nodeId);
@@ -240,10 +439,49 @@ Q_SIGNALS:
 
     void nodePositionUpdated(NodeId const nodeId);
 
+    /// Coalesced position notification emitted by batched `moveNodes` calls.
+    void nodePositionsUpdated(std::vector<NodeId> const &nodeIds);
+
     void modelReset();
 
+    /// Emitted by the outermost `beginBatch()`.
+    void batchStarted();
+
+    /// Emitted by the outermost `endBatch()` with the collected changes.
+    void batchFinished(GraphChangeSet const &changes);
+
+private:
+    /// Addresses of the connections behind ports being inserted or deleted.
+    ConnectionRemap _shiftedByDynamicPortsConnections;
+
+    unsigned int _batchDepth;
+
+    GraphChangeSet _batchChanges;
+
+    /// Tables of the latest snapshot, reset when they go stale.
+    mutable std::shared_ptr<GraphSnapshot::NodeTable const> _snapshotNodes;
+
+    mutable std::shared_ptr<GraphSnapshot::ConnectionTable const> _snapshotConnections;
+};
+
+/// RAII helper opening a batch on construction and closing it on destruction.
+class NODE_EDITOR_CORE_PUBLIC GraphTransaction
+{
+public:
+    explicit GraphTransaction(AbstractGraphModel &model)
+        : _model(model)
+    {
+        _model.beginBatch();
+    }
+
+    ~GraphTransaction() { _model.endBatch(); }
+
+    GraphTransaction(GraphTransaction const &) = delete;
+
+    GraphTransaction &operator=(GraphTransaction const &) = delete;
+
 private:
-    std::vector<ConnectionId> _shiftedByDynamicPortsConnections;
+    AbstractGraphModel &_model;
 };
 
 } // namespace QtNodes
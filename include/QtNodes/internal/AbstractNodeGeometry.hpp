@@ -2,11 +2,21 @@
 
 #include "Definitions.hpp"
 #include "Export.hpp"
+#include "StyleContext.hpp"
+
+#include <QtCore/QtGlobal>
 
 #include <QRectF>
 #include <QSize>
 #include <QTransform>
 
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class QWidget;
+
 namespace QtNodes {
 
 class AbstractGraphModel;
@@ -72,8 +82,89 @@ public:
 
     virtual QRect resizeHandleRect(NodeId const nodeId) const = 0;
 
+    /// Drops the cached layout of a node, after `nodeUpdated` or a change of its ports.
+    void invalidateLayout(NodeId const nodeId) const;
+
+    void invalidateLayouts() const;
+
+    /// Measures with the styles of `context`, `nullptr` for those of `StyleCollection`.
+    /**
+   * A geometry holding its own context may measure on a worker thread, e.g.
+   * for a background layout, while the application switches its theme.
+   * Drops all the cached layouts.
+   */
+    void setStyleContext(std::shared_ptr<StyleContext const> context);
+
+    StyleContext const &styleContext() const;
+
+    /// Identifies everything but the node itself that a measured size depends on.
+    /**
+   * `recomputeSize()` stores it as `NodeRole::LayoutKey` next to the size,
+   * so that a size saved with the scene is only trusted under the same
+   * conditions. The default hashes the application font, the node style of
+   * `styleContext()` and the geometry class. Never `0`.
+   */
+    virtual quint64 layoutKey() const;
+
+    /// Keeps the size the model restored if it was measured under `layoutKey()`.
+    /**
+   * @returns `false` when the node has to be measured with `recomputeSize()`.
+   */
+    bool restoreSavedSize(NodeId const nodeId) const;
+
+protected:
+    /**
+   * What a geometry works out once per node instead of on every call from
+   * painters and connections. Measurements stay until `invalidateLayout()`,
+   * positions are placed again when the node size changes.
+   *
+   * The arrays are indexed by `PortType::In` and `PortType::Out`.
+   */
+    struct NodeLayout
+    {
+        QRectF captionRect;
+        std::array<std::vector<QRectF>, 2> portTextRects;
+        std::array<unsigned int, 2> portTextAdvance{{0, 0}};
+
+        /// The size the positions below were placed for.
+        QSize size;
+        bool placed = false;
+
+        QPointF captionPosition;
+        QPointF widgetPosition;
+        std::array<std::vector<QPointF>, 2> portPositions;
+        std::array<std::vector<QPointF>, 2> portTextPositions;
+    };
+
+    /// The cached layout, measured if needed but maybe not placed.
+    NodeLayout &measuredLayout(NodeId const nodeId) const;
+
+    /// The cached layout, placed for the current node size.
+    NodeLayout const &layout(NodeId const nodeId) const;
+
+    /// Fills the measurements of a new layout.
+    virtual void measureLayout(NodeId const, NodeLayout &) const {}
+
+    /// Fills the positions for `layout.size`.
+    virtual void placeLayout(NodeId const, NodeLayout &) const {}
+
+    /// Size of the embedded widget or its `NodeRole::WidgetSizeHint`, invalid without one.
+    QSize widgetSize(NodeId const nodeId) const;
+
+    /// `nullptr` without a widget and while the model only gives its size hint.
+    QWidget *createdWidget(NodeId const nodeId) const;
+
 protected:
     AbstractGraphModel &_graphModel;
+
+private:
+    mutable std::unordered_map<NodeId, NodeLayout> _layouts;
+
+    std::shared_ptr<StyleContext const> _styleContext;
+
+    /// `layoutKey()` of the default implementation and the style revision it was hashed for.
+    mutable quint64 _layoutKey = 0;
+    mutable unsigned int _layoutKeyRevision = 0;
 };
 
 } // namespace QtNodes
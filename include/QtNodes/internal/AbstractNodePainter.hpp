@@ -2,14 +2,57 @@
 
 #include <QPainter>
 
+#include "AbstractGraphModel.hpp"
+#include "Definitions.hpp"
 #include "Export.hpp"
+#include "NodeState.hpp"
+#include "StyleCollection.hpp"
 
 class QPainter;
 
 namespace QtNodes {
 
+class AbstractGraphModel;
+class AbstractNodeGeometry;
 class NodeGraphicsObject;
 class NodeDataModel;
+class NodeStyle;
+
+/// What painting a node takes when there is no NodeGraphicsObject.
+struct NodePaintContext
+{
+    AbstractGraphModel &model;
+
+    AbstractNodeGeometry &geometry;
+
+    NodeId nodeId;
+
+    NodeStyle const &style;
+
+    bool selected = false;
+
+    bool hovered = false;
+
+    /// Milliseconds of `NodeRole::ComputeTime` painted fully red, `0` for no heat map.
+    double heatScale = 0.0;
+
+    /// Styles of the scene or exporter, `nullptr` for those of `StyleCollection`.
+    StyleContext const *styles = nullptr;
+
+    StyleContext const &styleContext() const
+    {
+        return styles ? *styles : StyleCollection::current();
+    }
+
+    /// Connection counts of the graphics object, `nullptr` to ask the model.
+    NodeState const *state = nullptr;
+
+    std::size_t connectionCount(PortType portType, PortIndex index) const
+    {
+        return state ? state->connectionCount(portType, index)
+                     : model.connectionCount(nodeId, portType, index);
+    }
+};
 
 /// Class enables custom painting.
 class NODE_EDITOR_PUBLIC AbstractNodePainter
@@ -25,5 +68,13 @@ public:
    * `NodeGraphicsObject::graphModel()`
    */
     virtual void paint(QPainter *painter, NodeGraphicsObject &ngo) const = 0;
+
+    /// Paints a node without a graphics object, as `GraphImageExporter` does.
+    /**
+   * The painter is in node coordinates, like for `paint()`, and may belong
+   * to a worker thread painting a `QImage`. The default implementation
+   * draws the node rectangle in the colors of the style.
+   */
+    virtual void paintHeadless(QPainter *painter, NodePaintContext const &context) const;
 };
 } // namespace QtNodes
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "Definitions.hpp"
+#include "Export.hpp"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QJsonObject>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QThreadPool>
+#include <QtCore/QTimer>
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+namespace QtNodes {
+
+class DataFlowGraphModel;
+
+/**
+ * Autosaves a `DataFlowGraphModel` as a snapshot plus an append-only journal.
+ *
+ * Every change the model signals becomes one line of compact JSON in
+ * `journalFileName()`: nodes added or removed, moves, connections and
+ * `internal-data` changes reported by `NodeDelegateModel::internalDataChanged()`.
+ * Records are buffered and appended every `flushInterval()` ms; moves and
+ * data changes of a node between two flushes collapse into one record.
+ *
+ * The journal also keeps the saved JSON of every node, updated record by
+ * record. A compaction hands an implicitly shared copy of it to a worker
+ * thread, which writes `snapshotFileName()` in the `save()` layout, and the
+ * journal then restarts with the records past the snapshot. Delegates are
+ * only asked for `save()` of the nodes that changed.
+ *
+ * After a crash `recover()` loads the snapshot and replays the journal.
+ */
+class NODE_EDITOR_CORE_PUBLIC AutosaveJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Captures the model once and journals into `directory`, which must exist.
+    /**
+   * Call `recover()` before, the first compaction replaces what an earlier
+   * session left. Records are numbered on from the ones in `directory`, so
+   * its autosave stays consistent until then.
+   */
+    AutosaveJournal(DataFlowGraphModel &model, QString const &directory, QObject *parent = nullptr);
+
+    /// Flushes the buffered records and waits for a running compaction.
+    ~AutosaveJournal() override;
+
+    static QString snapshotFileName(QString const &directory);
+
+    static QString journalFileName(QString const &directory);
+
+    /// Restores the autosave of `directory` into an empty model.
+    /**
+   * A truncated last record, as left by a crash, ends the replay.
+   * @returns `false` if `directory` holds no autosave.
+   * @throws std::logic_error for unregistered delegate models, as `load()`.
+   */
+    static bool recover(DataFlowGraphModel &model, QString const &directory);
+
+public:
+    QString directory() const { return _directory; }
+
+    int flushInterval() const { return _flushTimer.interval(); }
+
+    void setFlushInterval(int const milliseconds);
+
+    /// Records appended since the last compaction that make `flush()` compact.
+    std::size_t compactionThreshold() const { return _compactionThreshold; }
+
+    /// `0` compacts only on explicit `compact()` calls.
+    void setCompactionThreshold(std::size_t const records);
+
+    /// Appends the buffered records to the journal file.
+    bool flush();
+
+    /// Starts writing a snapshot on the worker thread, unless one is running.
+    void compact();
+
+    bool compactionInProgress() const { return _compacting; }
+
+    /// Blocks until the running compaction, if any, has finished.
+    void waitForCompaction();
+
+Q_SIGNALS:
+    void compacted(bool const ok);
+
+private:
+    void capture();
+
+    void append(QJsonObject record);
+
+    /// Writes the nodes created since the previous record.
+    /**
+   * The model loads the delegate after announcing the node, so the node
+   * is only saved once another change, a flush or the end of the model
+   * batch follows.
+   */
+    void writeCreatedNodes();
+
+    void writeCoalescedUpdates();
+
+    /// Appends `_buffer` to the journal file.
+    bool writeBuffer();
+
+    void onCompactionFinished(bool const ok);
+
+    bool openJournal();
+
+private:
+    DataFlowGraphModel &_model;
+
+    QString _directory;
+
+    QFile _journal;
+
+    QTimer _flushTimer;
+
+    std::size_t _compactionThreshold;
+
+    std::uint64_t _sequence;
+
+    /// Records not yet written to the file.
+    QByteArray _buffer;
+
+    std::size_t _recordsSinceCompaction;
+
+    bool _compacting;
+
+    /// Last record contained in the snapshot being written.
+    std::uint64_t _compactionSequence;
+
+    /// Lines past the snapshot being written, they make up the next journal.
+    QByteArray _sinceCompaction;
+
+    std::vector<NodeId> _createdNodes;
+
+    /// Records of an open model batch, written after its created nodes.
+    std::vector<QJsonObject> _batchRecords;
+
+    std::unordered_set<NodeId> _movedNodes;
+
+    std::unordered_set<NodeId> _changedNodes;
+
+    /// `saveNode()` of every node, shared with the compaction.
+    QHash<NodeId, QJsonObject> _nodes;
+
+    std::set<ConnectionId> _connections;
+
+    /// Runs the compactions one at a time.
+    QThreadPool _pool;
+};
+
+} // namespace QtNodes
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QtCore/QHash>
 #include <QtCore/QUuid>
 #include <QtWidgets/QGraphicsScene>
 #include <QtWidgets/QMenu>
@@ -8,14 +9,21 @@
 #include <memory>
 #include <tuple>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "AbstractGraphModel.hpp"
 #include "AbstractNodeGeometry.hpp"
 #include "ConnectionIdHash.hpp"
+#include "ConnectionRouter.hpp"
 #include "Definitions.hpp"
 #include "Export.hpp"
+#include "FlatHashMap.hpp"
+#include "MemoryReport.hpp"
 
 #include "QUuidStdHash.hpp"
+#include "SceneSpatialIndex.hpp"
+#include "StyleContext.hpp"
 
 #include "fcpdrc/cesgrouprecord.h"
 #include "qdebug.h"
@@ -27,6 +35,7 @@
 #include <QTableWidgetItem>
 #include <utility>
 
+class QStringListModel;
 class QUndoStack;
 
 namespace QtNodes {
@@ -34,9 +43,13 @@ namespace QtNodes {
 class AbstractConnectionPainter;
 class AbstractGraphModel;
 class AbstractNodePainter;
+class ConnectionBatchLayer;
 class ConnectionGraphicsObject;
+class ConnectionPicker;
 class NodeGraphicsObject;
 class NodeStyle;
+class SharedSceneCache;
+class TemplatePicker;
 
 /// An instance of QGraphicsScene, holds connections and nodes.
 class NODE_EDITOR_PUBLIC BasicGraphicsScene : public QGraphicsScene
@@ -68,10 +81,69 @@ public:
 
     QUndoStack &undoStack();
 
+    /// Limits the memory held by the undo history, `0` means unlimited.
+    /**
+   * When the snapshots of the commands exceed `bytes`, the oldest ones are
+   * compressed first. If that is not enough, the oldest commands are
+   * evicted and can no longer be undone. Defaults to 64 MiB.
+   */
+    void setUndoMemoryBudget(std::size_t const bytes);
+
+    std::size_t undoMemoryBudget() const { return _undoMemoryBudget; }
+
+    /// @returns the approximate bytes held by the commands of the undo stack.
+    std::size_t undoMemoryUsage() const;
+
+    /// Approximate memory of the graphics objects, widgets, labels and undo history.
+    /**
+   * Embedded widgets are estimated by their object sizes plus an ARGB32
+   * backing image of their size.
+   */
+    virtual MemoryReport memoryReport() const;
+
+    /// Adds the templates and indexes their column headers.
+    /**
+   * Records repeating the headers of an earlier one are skipped. A header
+   * found in several records keeps the first record and its color.
+   */
     void getRecordTemplates(std::vector<FcpDRC::cesgrouprecord> inputRecordVector);
 
+    /// Forgets the template of the connection and closes the picker if it is open for it.
     void removeDialog(ConnectionId const connectionId);
 
+    /// Stores the template of a connection, colors it and labels it.
+    void setConnectionTemplate(ConnectionId const connectionId, QString const &templateName);
+
+    /// Assigns one template to many connections.
+    /**
+   * Colors and labels are applied in one pass; the touched area is
+   * repainted once and `modified` is emitted once.
+   */
+    void setConnectionTemplates(std::unordered_set<ConnectionId> const &connectionIds,
+                                QString const &templateName);
+
+    /// A copy of `selectedConnectionIds()`.
+    std::unordered_set<ConnectionId> selectedConnections() const;
+
+    /// Nodes whose graphics objects are selected.
+    /**
+   * Maintained by the graphics objects as they are selected and deselected,
+   * unlike `selectedItems()` nothing is collected or cast on the call.
+   */
+    std::unordered_set<NodeId> const &selectedNodeIds() const { return _selectedNodeIds; }
+
+    /// Connections whose graphics objects are selected.
+    std::unordered_set<ConnectionId> const &selectedConnectionIds() const
+    {
+        return _selectedConnectionIds;
+    }
+
+    /// Called by the node graphics objects when their selection changes.
+    void updateNodeSelection(NodeId const nodeId, bool const selected);
+
+    /// Called by the connection graphics objects when their selection changes.
+    void updateConnectionSelection(ConnectionId const connectionId, bool const selected);
+
     void addTextUnderConnection(ConnectionId connectionId, const QString& templateText);
 
     struct ConnectionInfo {
@@ -85,23 +157,21 @@ public:
 
     std::vector<ConnectionInfo> getConnections() const;
 
-    const std::map<ConnectionId, std::pair<std::unique_ptr<QDialog>, QString>>& getDialogs() const {
-            return _dialogs;
-        }
-
-    QColor getColorForHeader(const QString &header) const {
-        for (const auto &headerRecord : m_record) {
-            QStringList headers = headerRecord.getColumnHeaders();
-            QList<QColor> colors = headerRecord.getColumnColors();
-            for (int i = 0; i < headers.size(); ++i) {
-                if (headers[i] == header) {
-                    return colors[i]; // Возвращаем цвет, связанный с заголовком
-                }
-            }
-        }
-        return QColor(); // Возвращаем пустой цвет, если не найден
+    /// Fills `connections`, reusing its storage, instead of returning a new vector.
+    void getConnections(std::vector<ConnectionInfo> &connections) const;
+
+    /// Template names chosen per connection.
+    std::map<ConnectionId, QString> const &connectionTemplates() const
+    {
+        return _connectionTemplates;
     }
 
+    /// @returns an invalid color for an unknown header.
+    QColor getColorForHeader(const QString &header) const;
+
+    /// @returns the record holding `header`, or `nullptr`.
+    FcpDRC::cesgrouprecord const *recordForHeader(QString const &header) const;
+
     QColor connectionColor;
 
 public:
@@ -124,9 +194,67 @@ public:
    */
     void resetDraftConnection();
 
-    /// Deletes all the nodes. Connections are removed automatically.
+    /// `AbstractGraphModel::connectionPossible()` for completions of the draft connection.
+    /**
+   * Painters ask for every port of the hovered node on each repaint; the
+   * answers are kept until the draft connection goes away or a connection
+   * or node changes.
+   */
+    bool draftConnectionPossible(ConnectionId const connectionId) const;
+
+    /// Draws the draft connection in the scene foreground instead of as an item.
+    /**
+   * Moving the loose end then only repaints the area of the curve and of a
+   * ring around the nearest port it could attach to, without geometry
+   * changes of the item or repaints of the hovered node. Applies from the
+   * next draft connection. Off by default.
+   */
+    void setDraftConnectionOverlay(bool const enabled) { _draftConnectionOverlay = enabled; }
+
+    bool draftConnectionOverlay() const { return _draftConnectionOverlay; }
+
+    /// Repaints the overlay after the loose end of an overlaid draft moved.
+    void updateDraftOverlay();
+
+    /// Draws the hover feedback of nodes and connections in the scene foreground.
+    /**
+   * The items then paint as if never hovered. Entering or leaving a node
+   * repaints thin strips along its outline instead of the node with its
+   * shadow, widget and ports, and a node is only raised while another one
+   * overlaps it. A connection repaints strips along its curve instead of its
+   * bounding rect, which may span the whole view. Off by default.
+   */
+    void setHoverOverlay(bool const enabled);
+
+    bool hoverOverlay() const { return _hoverOverlay; }
+
+    /// Follows the hover state or the geometry of `ngo` in the overlay.
+    void updateHoverOverlay(NodeGraphicsObject const &ngo);
+
+    /// Follows the hover state or the curve of `cgo` in the overlay.
+    void updateHoverOverlay(ConnectionGraphicsObject const &cgo);
+
+    /// Empties the model through `AbstractGraphModel::clear()`.
     void clearScene();
 
+    /// Capacity hint before inserting about `nodes` nodes and `connections` connections.
+    /**
+   * Reserves the item tables of the scene and forwards the hint to
+   * `AbstractGraphModel::reserve()`.
+   */
+    void reserve(std::size_t const nodes, std::size_t const connections);
+
+    /// Moves the nodes of the current drag session by `delta`.
+    /**
+   * The first call opens the session and captures the selected nodes once.
+   * Later calls only update positions; no undo command is created until
+   * `finishNodeDrag()`.
+   */
+    void dragSelectedNodes(QPointF const &delta);
+
+    /// Closes the drag session and pushes a single MoveNodeCommand.
+    void finishNodeDrag();
+
 public:
     /// @returns NodeGraphicsObject associated with the given nodeId.
     /**
@@ -142,8 +270,262 @@ public:
 
     Qt::Orientation orientation() const { return _orientation; }
 
+    /**
+   * @returns `true` while the scene applies a batched position update.
+   * Nodes skip their own `moveConnections()` then, the scene moves every
+   * affected connection once afterwards.
+   */
+    bool batchMoveInProgress() const { return _batchMoveInProgress; }
+
     void setOrientation(Qt::Orientation const orientation);
 
+    /// Lays out all nodes, or only `nodeIds`, with a `LayeredLayout`.
+    /**
+   * The layers follow the orientation of the scene and the node sizes come
+   * from the scene geometry.
+   */
+    void autoLayout(std::unordered_set<NodeId> const &nodeIds = {});
+
+public:
+    /// How the scene looks up items by position.
+    enum class SpatialIndexMode {
+        NoIndex,    ///< Linear scans (default), cheapest for small scenes.
+        BspTree,    ///< QGraphicsScene BSP tree; also speeds up painting and rubber band.
+        UniformGrid ///< Incremental grid of node and connection bounds, cheap to update on drags.
+    };
+
+    /// Selects the indexing strategy. `cellSize` is only used by `UniformGrid`.
+    void setSpatialIndexMode(SpatialIndexMode const mode, qreal const cellSize = 256.0);
+
+    SpatialIndexMode spatialIndexMode() const { return _spatialIndexMode; }
+
+    /// @returns the topmost node whose shape contains `scenePoint`, or `nullptr`.
+    NodeGraphicsObject *nodeAt(QPointF const &scenePoint, QTransform const &viewTransform);
+
+    /// @returns nodes whose scene bounding rectangles intersect `sceneRect`.
+    std::vector<NodeGraphicsObject *> nodesInRect(QRectF const &sceneRect);
+
+    /// @returns connections whose scene bounding rectangles intersect `sceneRect`.
+    std::vector<ConnectionGraphicsObject *> connectionsInRect(QRectF const &sceneRect);
+
+    /// Refreshes the grid entry and the content bounds of the node.
+    /**
+   * The grid is only maintained while `UniformGrid` is active.
+   */
+    void updateSpatialIndex(NodeGraphicsObject const &ngo);
+
+    /// Refreshes the grid entry of the connection and its cubic in the connection picker.
+    /**
+   * The grid is only maintained while `UniformGrid` is active.
+   */
+    void updateSpatialIndex(ConnectionGraphicsObject const &cgo);
+
+public:
+    /// Brings a hovered node to the front, the previously raised one goes back.
+    /**
+   * Only one node is raised at a time, so nothing else needs to be looked
+   * up to restore the stacking order.
+   */
+    void raiseNode(NodeId const nodeId);
+
+    /// Puts the node back if it is the raised one.
+    void lowerNode(NodeId const nodeId);
+
+public:
+    /// Creates graphics objects only for the items around the visible area.
+    /**
+   * Nodes are looked up by their model position and size in a grid of their
+   * own. Objects are created for the nodes within half a viewport of
+   * `visibleSceneRect()` and released once they are a full viewport away,
+   * so panning back and forth does not rebuild them. A connection has an
+   * object while one of its nodes has. When more than
+   * `virtualizedNodeLimit()` nodes are in view, the unselected ones are
+   * released and the scene paints the node density per grid cell instead.
+   *
+   * Meant for a single view, which reports its area through
+   * `setVisibleSceneRect()`; `GraphicsView` does so automatically.
+   */
+    void setVirtualized(bool const virtualized);
+
+    bool virtualized() const { return _virtualized; }
+
+    /// Bounds of all nodes, virtualized ones included, rounded out to a 64 unit grid.
+    /**
+   * Maintained as nodes are created, moved, resized and deleted, so asking
+   * is free. The scene rect grows along with it; `fitSceneRectToContent()`
+   * also shrinks it.
+   */
+    QRectF contentBounds() const { return _contentBounds.bounds(); }
+
+    /// Sets the scene rect to `contentBounds()`.
+    void fitSceneRectToContent();
+
+    /// The area shown by the view, reported by `GraphicsView` as it scrolls and zooms.
+    void setVisibleSceneRect(QRectF const &rect);
+
+    QRectF visibleSceneRect() const { return _visibleSceneRect; }
+
+    void setVirtualizedNodeLimit(std::size_t const limit);
+
+    std::size_t virtualizedNodeLimit() const { return _virtualizedNodeLimit; }
+
+    /// Number of node and of connection objects kept for reuse; 512 by default.
+    /**
+   * Objects of deleted or virtualized-away items are recycled, see
+   * `NodeGraphicsObject::recycle()`, and bound to the next item created
+   * instead of allocating, which keeps resets, undoing mass deletions and
+   * scrolling a virtualized scene off the allocator. `0` disables pooling.
+   */
+    void setGraphicsObjectPoolCapacity(std::size_t const capacity);
+
+    std::size_t graphicsObjectPoolCapacity() const { return _graphicsObjectPoolCapacity; }
+
+public:
+    /// Paints every node once into an image and blits it afterwards.
+    /**
+   * The image is kept per node and repainted when the size, selection,
+   * hover, style revision, connected ports, computing flag or the device
+   * scale change, and whenever the model reports the node updated. Nodes
+   * reacting to a dragged connection or being resized are painted
+   * directly. Off by default.
+   */
+    void setNodeRenderCacheEnabled(bool const enabled);
+
+    bool nodeRenderCacheEnabled() const { return _nodeRenderCacheEnabled; }
+
+    /// Takes node layouts and rendered node images from `cache`, `nullptr` to stop.
+    /**
+   * `nodeGeometry()` then returns the geometry of the cache for the scene
+   * orientation, and with `setNodeRenderCacheEnabled()` images of nodes
+   * painted by another scene of the cache are blitted as they are. All the
+   * graphics objects are rebuilt.
+   *
+   * @throws std::invalid_argument when `cache` belongs to another model.
+   */
+    void setSharedCache(std::shared_ptr<SharedSceneCache> cache);
+
+    std::shared_ptr<SharedSceneCache> const &sharedCache() const { return _sharedCache; }
+
+    /// Paints and measures with the styles of `context`, `nullptr` for those of `StyleCollection`.
+    /**
+   * Lets scenes of one application show different themes, and a theme
+   * change swap one immutable context for another. Rebuilds all the
+   * graphics objects. The node styles of the context replace only the
+   * default style, nodes with a style of their own keep it.
+   */
+    void setStyleContext(std::shared_ptr<StyleContext const> context);
+
+    /// The context of the scene, or the current one of `StyleCollection`.
+    StyleContext const &styleContext() const;
+
+    /// Draws embedded widgets from a snapshot while their node is idle.
+    /**
+   * A node only embeds its widget into a `QGraphicsProxyWidget` while it
+   * is hovered or the widget has the focus; otherwise the proxy is removed
+   * and a grabbed image of the widget is painted in its place. The image
+   * is grabbed again after the node was updated or received data. Off by
+   * default.
+   */
+    void setWidgetSnapshotsEnabled(bool const enabled);
+
+    bool widgetSnapshotsEnabled() const { return _widgetSnapshotsEnabled; }
+
+public:
+    /// How node shadows are drawn.
+    enum class NodeShadowMode {
+        Effect,  ///< A `QGraphicsDropShadowEffect` per node (default), blurs on every repaint.
+        Texture, ///< The node painter stretches a shared pre-blurred texture.
+        None     ///< No shadows, for large scenes.
+    };
+
+    void setNodeShadowMode(NodeShadowMode const mode);
+
+    NodeShadowMode nodeShadowMode() const { return _nodeShadowMode; }
+
+    /// Paints a halo around every node, colored by its `NodeRole::ComputeTime`.
+    /**
+   * Fast nodes glow green, turning red at `milliseconds` and beyond. `0`,
+   * the default, paints no halos; nodes of models without the role have
+   * none either.
+   */
+    void setComputeHeatScale(double const milliseconds);
+
+    double computeHeatScale() const { return _computeHeatScale; }
+
+public:
+    /// When a `nodeUpdated` notification reaches the node graphics object.
+    enum class NodeUpdatePolicy {
+        Immediate, ///< Relayout and repaint inside the slot (default).
+        EventLoop, ///< Collect the nodes and relayout each once on the next event loop iteration.
+        Frame      ///< Like `EventLoop`, but at most once per `NodeUpdateFrameInterval` ms.
+    };
+
+    static constexpr int NodeUpdateFrameInterval = 16;
+
+    /// Switching back to `Immediate` applies the pending updates first.
+    void setNodeUpdatePolicy(NodeUpdatePolicy const policy);
+
+    NodeUpdatePolicy nodeUpdatePolicy() const { return _nodeUpdatePolicy; }
+
+    /// Relayouts the nodes whose updates are still queued.
+    /**
+   * Called automatically by the queued policies; call it directly when the
+   * node geometry is needed synchronously.
+   */
+    void processPendingNodeUpdates();
+
+public:
+    /// Draws the plain connections through one `ConnectionBatchLayer`.
+    /**
+   * The connection items stay for hit testing, hovering and selection and
+   * only paint while they differ from a plain line. Off by default.
+   */
+    void setConnectionBatching(bool const enabled);
+
+    bool connectionBatching() const { return _connectionBatchLayer != nullptr; }
+
+    /// @returns `nullptr` unless connection batching is enabled.
+    ConnectionBatchLayer *connectionBatchLayer() const { return _connectionBatchLayer; }
+
+    /// Hit tests the plain connections through one `ConnectionPicker`.
+    /**
+   * The connection items then answer `contains()` from the picker instead
+   * of their stroked shape, whatever the connection painter strokes. Routed
+   * and draft connections keep using their shape. Off by default.
+   */
+    void setConnectionPicking(bool const enabled);
+
+    bool connectionPicking() const { return _connectionPicker != nullptr; }
+
+    /// @returns `nullptr` unless connection picking is enabled.
+    ConnectionPicker const *connectionPicker() const { return _connectionPicker.get(); }
+
+    /// @returns the connection nearest to `scenePoint` within the picking tolerance, or `nullptr`.
+    /**
+   * Without connection picking, the topmost connection whose shape contains
+   * the point.
+   */
+    ConnectionGraphicsObject *connectionAt(QPointF const &scenePoint,
+                                           QTransform const &viewTransform = QTransform());
+
+    /// Routes the connections around the nodes with a `ConnectionRouter`.
+    /**
+   * Routes are computed on worker threads; until a connection has one for
+   * its current ends it is drawn as the usual cubic. Off by default.
+   */
+    void setConnectionRouting(bool const enabled,
+                              ConnectionRouter::Style const style
+                              = ConnectionRouter::Style::Orthogonal);
+
+    bool connectionRouting() const { return _connectionRouter != nullptr; }
+
+    /// @returns `nullptr` unless connection routing is enabled.
+    ConnectionRouter *connectionRouter() const { return _connectionRouter; }
+
+protected:
+    /// Paints the aggregated node density of a virtualized scene and the overlays.
+    void drawForeground(QPainter *painter, QRectF const &rect) override;
+
 public:
     /// Can @return an instance of the scene context menu in subclass.
     /**
@@ -173,6 +555,8 @@ Q_SIGNALS:
     /// Signal allows showing custom context menu upon clicking a node.
     void nodeContextMenu(NodeId const nodeId, QPointF const pos);
 
+    void visibleSceneRectChanged(QRectF const &rect);
+
 private:
     /// @brief Creates Node and Connection graphics objects.
     /**
@@ -185,6 +569,60 @@ private:
     /// Redraws adjacent nodes for given `connectionId`
     void updateAttachedNodes(ConnectionId const connectionId, PortType const portType);
 
+    /// Re-inserts every graphics object into the grid index.
+    void rebuildSpatialIndex();
+
+    /// Stores the cubic of an unrouted connection in the picker, drops a routed one.
+    void updateConnectionPicker(ConnectionGraphicsObject const &cgo);
+
+    void drawNodeDensity(QPainter *painter, QRectF const &rect);
+
+    void drawDraftOverlay(QPainter *painter, QRectF const &rect);
+
+    /// Repaints the last overlay area and forgets it, before the draft goes away.
+    void clearDraftOverlay();
+
+    void drawHoverOverlay(QPainter *painter, QRectF const &rect);
+
+    /// Hands `_styleContext` to the geometries the scene measures with.
+    void updateGeometryStyles();
+
+    /// Compresses, then evicts, the oldest undo commands until the budget is met.
+    void enforceUndoMemoryBudget();
+
+    /// Model position and size, the latter estimated for nodes never shown.
+    QRectF modelNodeRect(NodeId const nodeId) const;
+
+    static QRectF modelNodeRect(QPointF const &pos, QSize size);
+
+    /// Records the scene rectangle of the node, growing the scene rect if needed.
+    void updateContentBounds(NodeId const nodeId, QRectF const &rect);
+
+    /// Creates and releases graphics objects for the current visible area.
+    void updateVirtualizedItems();
+
+    /// Also creates or re-attaches the node connections when virtualized.
+    void createNodeGraphicsObject(NodeId const nodeId);
+
+    /// Drops the node object and the connections left without any node object.
+    void releaseNodeGraphicsObject(NodeId const nodeId);
+
+    ConnectionGraphicsObject &createConnectionGraphicsObject(ConnectionId const connectionId);
+
+    using UniqueNodeGraphicsObject = std::unique_ptr<NodeGraphicsObject>;
+
+    using UniqueConnectionGraphicsObject = std::unique_ptr<ConnectionGraphicsObject>;
+
+    /// Takes an object from the pool if there is one.
+    UniqueNodeGraphicsObject makeNodeGraphicsObject(NodeId const nodeId);
+
+    UniqueConnectionGraphicsObject makeConnectionGraphicsObject(ConnectionId const connectionId);
+
+    /// Returns the object to the pool, or destroys it if the pool is full.
+    void recycleGraphicsObject(UniqueNodeGraphicsObject object);
+
+    void recycleGraphicsObject(UniqueConnectionGraphicsObject object);
+
 public Q_SLOTS:
     /// Slot called when the `connectionId` is erased form the AbstractGraphModel.
     void onConnectionDeleted(ConnectionId const connectionId);
@@ -192,6 +630,10 @@ public Q_SLOTS:
     /// Slot called when the `connectionId` is created in the AbstractGraphModel.
     void onConnectionCreated(ConnectionId const connectionId);
 
+    /// Re-keys the graphics objects and templates of the remapped connections.
+    void onConnectionsRemapped(ConnectionRemap const &remap);
+
+    /// Shows the shared template picker for a connection.
     void openDialog(ConnectionId const connectionId);
 
     void onNodeDeleted(NodeId const nodeId);
@@ -200,42 +642,198 @@ public Q_SLOTS:
 
     void onNodePositionUpdated(NodeId const nodeId);
 
+    /// Repositions all the nodes and then moves each affected connection once.
+    void onNodePositionsUpdated(std::vector<NodeId> const &nodeIds);
+
+    /// Relayouts the node: size, ports, embedded widget and connections.
     void onNodeUpdated(NodeId const nodeId);
 
+    /// Repaints the node only, for changes that keep its geometry.
+    /**
+   * Displayed data does not move ports or connections. Delegates whose
+   * widget or caption changes size with the data emit
+   * `NodeDelegateModel::embeddedWidgetSizeUpdated()`, which reaches
+   * `onNodeUpdated()`.
+   */
+    void onNodeDataChanged(NodeId const nodeId);
+
+    void onNodeFlagsUpdated(NodeId const nodeId);
+
     void onNodeClicked(NodeId const nodeId);
 
     void onModelReset();
 
+    /// Applies the net changes of a closed model batch, emits `modified` once.
+    /**
+   * While a batch is open the per-item slots above do nothing, so graphics
+   * objects for the new nodes and connections only appear in `endBatch()`.
+   * A batch is expected to be opened and closed without returning to the
+   * event loop in between.
+   */
+    void onBatchFinished(GraphChangeSet const &changes);
+
+private:
+    /// Relayouts and repaints the graphics object of an updated node.
+    void applyNodeUpdate(NodeId const nodeId);
+
+    void scheduleNodeUpdates();
+
 private:
     AbstractGraphModel &_graphModel;
 
-    using UniqueNodeGraphicsObject = std::unique_ptr<NodeGraphicsObject>;
+    /// Declared before the graphics objects, which deselect themselves when destroyed.
+    std::unordered_set<NodeId> _selectedNodeIds;
 
-    using UniqueConnectionGraphicsObject = std::unique_ptr<ConnectionGraphicsObject>;
+    std::unordered_set<ConnectionId> _selectedConnectionIds;
 
     std::unordered_map<NodeId, UniqueNodeGraphicsObject> _nodeGraphicsObjects;
 
-    std::unordered_map<ConnectionId, UniqueConnectionGraphicsObject> _connectionGraphicsObjects;
+    FlatHashMap<ConnectionId, UniqueConnectionGraphicsObject> _connectionGraphicsObjects;
+
+    /// Recycled objects, outside of the scene.
+    std::vector<UniqueNodeGraphicsObject> _nodeObjectPool;
+
+    std::vector<UniqueConnectionGraphicsObject> _connectionObjectPool;
+
+    std::size_t _graphicsObjectPoolCapacity;
 
     std::unique_ptr<ConnectionGraphicsObject> _draftConnection;
 
+    mutable std::unordered_map<ConnectionId, bool> _draftCompatibility;
+
+    bool _draftConnectionOverlay;
+
+    /// Scene area painted by the overlay, repainted when it moves.
+    QRectF _draftOverlayRect;
+
+    /// Port the loose end would attach to, drawn as a ring.
+    struct DraftHighlight
+    {
+        bool valid = false;
+        bool possible = false;
+        QPointF center;
+    };
+
+    DraftHighlight _draftHighlight;
+
+    bool _hoverOverlay;
+
+    NodeId _overlayNode;
+
+    ConnectionId _overlayConnection;
+
+    /// Scene strips painted for `_overlayNode` and `_overlayConnection`.
+    std::vector<QRectF> _overlayNodeStrips;
+
+    std::vector<QRectF> _overlayConnectionStrips;
+
     std::unique_ptr<AbstractNodeGeometry> _nodeGeometry;
 
+    /// Replaces `_nodeGeometry` while set.
+    std::shared_ptr<SharedSceneCache> _sharedCache;
+
+    std::shared_ptr<StyleContext const> _styleContext;
+
     std::unique_ptr<AbstractNodePainter> _nodePainter;
 
     std::unique_ptr<AbstractConnectionPainter> _connectionPainter;
 
     bool _nodeDrag;
 
+    bool _batchMoveInProgress;
+
+    /// Set while `onBatchFinished` replays a change set; silences `modified`.
+    bool _applyingBatch;
+
+    /// Nodes updated through `onNodeUpdated` while a model batch was open
+    /// or a queued `NodeUpdatePolicy` waits for its flush.
+    std::unordered_set<NodeId> _deferredNodeUpdates;
+
+    NodeUpdatePolicy _nodeUpdatePolicy;
+
+    bool _nodeUpdatesScheduled;
+
+    /// Nodes captured when a drag starts and the accumulated offset.
+    struct NodeDragSession
+    {
+        bool active = false;
+        std::unordered_set<NodeId> nodeSet;
+        std::vector<NodeId> nodes;
+        QPointF totalDelta;
+    };
+
+    NodeDragSession _dragSession;
+
+    /// Scratch set reused between batched moves to avoid reallocations.
+    std::unordered_set<ConnectionId> _batchMovedConnections;
+
     QUndoStack *_undoStack;
 
+    std::size_t _undoMemoryBudget;
+
+    bool _virtualized;
+
+    /// Set while the visible area holds more than `_virtualizedNodeLimit` nodes.
+    bool _aggregated;
+
+    std::size_t _virtualizedNodeLimit;
+
+    QRectF _visibleSceneRect;
+
+    /// Model bounds of every node, maintained while virtualized.
+    UniformGridIndex<NodeId> _modelNodeIndex;
+
+    OccupancyBounds<NodeId> _contentBounds;
+
+    /// The scene rect set from `_contentBounds`, which only grows between fits.
+    QRectF _contentSceneRect;
+
+    bool _nodeRenderCacheEnabled;
+
+    bool _widgetSnapshotsEnabled;
+
+    NodeShadowMode _nodeShadowMode;
+
+    double _computeHeatScale;
+
+    /// Owned by the QGraphicsScene while batching is enabled.
+    ConnectionBatchLayer *_connectionBatchLayer;
+
+    std::unique_ptr<ConnectionPicker> _connectionPicker;
+
+    /// A child of the scene while routing is enabled.
+    ConnectionRouter *_connectionRouter;
+
+    /// Node with a raised z-value, see `raiseNode()`.
+    NodeId _raisedNode;
+
     Qt::Orientation _orientation;
 
-    QMap<ConnectionId, QGraphicsTextItem*> _textItems; // Хранение текстовых элементов
+    SpatialIndexMode _spatialIndexMode;
+
+    UniformGridIndex<NodeId> _nodeIndex;
+
+    UniformGridIndex<ConnectionId> _connectionIndex;
 
     std::vector<FcpDRC::cesgrouprecord> m_record;
 
-    std::map<ConnectionId, std::pair<std::unique_ptr<QDialog>, QString>> _dialogs;
+    struct HeaderEntry
+    {
+        QColor color;
+        std::size_t record; ///< Index into `m_record`.
+    };
+
+    QHash<QString, HeaderEntry> _headerIndex;
+
+    std::map<ConnectionId, QString> _connectionTemplates;
+
+    /// Every indexed header once, shared by the picker.
+    QStringListModel *_templateHeaders;
+
+    /// Made on first use, reused for every connection.
+    std::unique_ptr<TemplatePicker> _templatePicker;
+
+    ConnectionId _templatePickerConnection;
 };
 
 } // namespace QtNodes
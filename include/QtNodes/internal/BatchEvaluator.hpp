@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Definitions.hpp"
+#include "Export.hpp"
+#include "NodeData.hpp"
+
+#include <QtCore/QJsonObject>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace QtNodes {
+
+class DataFlowGraphModel;
+class NodeDelegateModelRegistry;
+
+/**
+ * Evaluates a saved data flow scene for many input sets without a GUI.
+ *
+ * Every worker thread loads its own DataFlowGraphModel from the scene, so
+ * the delegates never see concurrent calls. For each input set the values
+ * are injected at the input ports, the graph is flushed synchronously and
+ * the values at the output ports are collected.
+ *
+ * Limitations: asynchronous `computeJob()`s need an event loop and are not
+ * awaited, and delegates must not create widgets outside of
+ * `embeddedWidget()`.
+ */
+class NODE_EDITOR_CORE_PUBLIC BatchEvaluator
+{
+public:
+    /// A node port used as batch input or output.
+    /**
+   * An input at an `Out` port replaces the output of a source node; an
+   * input at an `In` port is delivered as if it came from a connection.
+   * An output at an `In` port reads the data of its first connection.
+   */
+    struct Port
+    {
+        NodeId nodeId;
+        PortType portType;
+        PortIndex portIndex;
+    };
+
+    /// One value per input, respectively output, port.
+    using Values = std::vector<std::shared_ptr<NodeData>>;
+
+public:
+    BatchEvaluator(std::shared_ptr<NodeDelegateModelRegistry> registry, QJsonObject scene);
+
+    void setInputPorts(std::vector<Port> ports) { _inputPorts = std::move(ports); }
+
+    void setOutputPorts(std::vector<Port> ports) { _outputPorts = std::move(ports); }
+
+    /// `0` uses the hardware concurrency.
+    void setThreadCount(unsigned int const count) { _threadCount = count; }
+
+public:
+    /// Evaluates every input set, @returns the outputs in the same order.
+    /**
+   * Blocks until all sets are done. The first exception thrown while
+   * loading or evaluating is rethrown once the workers have stopped.
+   */
+    std::vector<Values> run(std::vector<Values> const &inputSets) const;
+
+public:
+    /// Injects `inputs[i]` at `ports[i]` of `model` as `run()` does, without flushing.
+    static void applyInputs(DataFlowGraphModel &model,
+                            std::vector<Port> const &ports,
+                            Values const &inputs);
+
+    /// Reads the value at every port of `model` as `run()` does.
+    static Values readOutputs(DataFlowGraphModel const &model, std::vector<Port> const &ports);
+
+private:
+    std::shared_ptr<NodeDelegateModelRegistry> _registry;
+
+    QJsonObject _scene;
+
+    std::vector<Port> _inputPorts;
+
+    std::vector<Port> _outputPorts;
+
+    unsigned int _threadCount;
+};
+
+} // namespace QtNodes
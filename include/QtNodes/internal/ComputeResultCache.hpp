@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Definitions.hpp"
+#include "Export.hpp"
+#include "NodeData.hpp"
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace QtNodes {
+
+/**
+ * Bounded least-recently-used map from (node, input hashes) to the outputs
+ * a deterministic delegate computed for them.
+ *
+ * An input hash is the `NodeData::contentHash()` of the data present at an
+ * input port, or `EmptyInputHash` for a port without data.
+ */
+class NODE_EDITOR_CORE_PUBLIC ComputeResultCache
+{
+public:
+    using Results = std::vector<std::shared_ptr<NodeData>>;
+
+    using InputHashes = std::vector<std::size_t>;
+
+    /// Stands for an input port without data.
+    static constexpr std::size_t EmptyInputHash = static_cast<std::size_t>(0x9e3779b97f4a7c15ull);
+
+public:
+    explicit ComputeResultCache(std::size_t capacity = 256);
+
+    std::size_t capacity() const { return _capacity; }
+
+    /// Evicts the oldest entries if needed; `0` disables the cache.
+    void setCapacity(std::size_t const capacity);
+
+    std::size_t size() const { return _entries.size(); }
+
+    /// Approximate bytes of the entries and the index, without the cached data itself.
+    std::size_t memoryUsage() const;
+
+    /// @returns the cached outputs and marks them as recently used, `nullptr` on a miss.
+    Results const *find(NodeId const nodeId, InputHashes const &inputHashes);
+
+    /// Stores `results`, replacing an entry with the same key.
+    void insert(NodeId const nodeId, InputHashes inputHashes, Results results);
+
+    /// Drops all the entries of a node, e.g. when it is deleted.
+    void removeNode(NodeId const nodeId);
+
+    void clear();
+
+private:
+    struct Entry
+    {
+        NodeId nodeId;
+        InputHashes inputHashes;
+        Results results;
+    };
+
+    static std::size_t keyOf(NodeId const nodeId, InputHashes const &inputHashes);
+
+    void evict();
+
+private:
+    std::size_t _capacity;
+
+    /// Most recently used first.
+    std::list<Entry> _entries;
+
+    /// Combined key of an entry. Colliding keys share one slot, the newest wins.
+    std::unordered_map<std::size_t, std::list<Entry>::iterator> _index;
+};
+
+} // namespace QtNodes
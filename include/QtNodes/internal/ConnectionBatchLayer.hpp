@@ -0,0 +1,101 @@
+#pragma once
+
+#include <QtCore/QLineF>
+#include <QtCore/QVector>
+#include <QtGui/QPen>
+#include <QtWidgets/QGraphicsItem>
+
+#include "ConnectionIdHash.hpp"
+#include "Definitions.hpp"
+#include "Export.hpp"
+
+#include <unordered_map>
+#include <unordered_set>
+
+namespace QtNodes {
+
+class BasicGraphicsScene;
+class ConnectionGraphicsObject;
+
+/**
+ * Scene wide item drawing the plain connections in a few batched calls.
+ *
+ * Each connection is tessellated once into line segments, again only after
+ * its `ConnectionGraphicsObject::move()` or removal, and the segments of all
+ * connections sharing a pen are drawn with one `drawLines()`. Connections
+ * that are hovered, selected, being drafted or converting between data types
+ * are still painted by their own item, see `batchable()`.
+ *
+ * The layer ignores the connection painter of the scene.
+ */
+class NODE_EDITOR_PUBLIC ConnectionBatchLayer : public QGraphicsItem
+{
+public:
+    enum { Type = UserType + 3 };
+
+    int type() const override { return Type; }
+
+    /// Segments per cubic at full detail.
+    static constexpr int CubicSegments = 24;
+
+public:
+    explicit ConnectionBatchLayer(BasicGraphicsScene &scene);
+
+    /// @returns `true` if the layer draws the connection instead of its item.
+    static bool batchable(ConnectionGraphicsObject const &cgo);
+
+    /// Schedules the connection for re-tessellation and repaints its area.
+    /**
+   * `cgo` is `nullptr` when the graphics object goes away; the entry is
+   * dropped on the next paint.
+   */
+    void markDirty(ConnectionId const connectionId, ConnectionGraphicsObject const *cgo);
+
+    /// Re-tessellates every connection, e.g. after a style change.
+    void markAllDirty();
+
+    QRectF boundingRect() const override;
+
+    /// Empty, the layer never takes mouse events or hides items from `itemAt()`.
+    QPainterPath shape() const override;
+
+    void paint(QPainter *painter,
+               QStyleOptionGraphicsItem const *option,
+               QWidget *widget = nullptr) override;
+
+private:
+    struct Entry
+    {
+        QVector<QLineF> segments;
+        QLineF straight;
+        QRectF bounds;
+        QRgb color;
+    };
+
+    /// Everything drawn with one pen.
+    struct Batch
+    {
+        QVector<QLineF> segments;
+        QVector<QLineF> straight;
+    };
+
+    /// Applies the pending changes, regroups the batches if there were any.
+    void rebuild();
+
+    static Entry tessellate(ConnectionGraphicsObject const &cgo);
+
+private:
+    BasicGraphicsScene &_scene;
+
+    std::unordered_map<ConnectionId, Entry> _entries;
+
+    std::unordered_set<ConnectionId> _dirty;
+
+    std::unordered_map<QRgb, Batch> _batches;
+
+    QRectF _bounds;
+
+    unsigned int _styleRevision;
+};
+
+} // namespace QtNodes
@@ -3,6 +3,8 @@
 #include <utility>
 
 #include <QtCore/QUuid>
+#include <QtGui/QFont>
+#include <QtGui/QPainterPath>
 #include <QtWidgets/QGraphicsObject>
 
 #include "ConnectionState.hpp"
@@ -29,7 +31,16 @@ public:
 public:
     ConnectionGraphicsObject(BasicGraphicsScene &scene, ConnectionId const connectionId);
 
-    ~ConnectionGraphicsObject() = default;
+    ~ConnectionGraphicsObject() override;
+
+    /// Detaches from the connection and the scene to wait in the scene's object pool.
+    /**
+   * Signal connections are cut, color and label are cleared.
+   */
+    void recycle();
+
+    /// Binds a recycled object to `connectionId`, as if it was constructed for it.
+    void reuse(BasicGraphicsScene &scene, ConnectionId const connectionId);
 
 public:
     AbstractGraphModel &graphModel() const;
@@ -38,18 +49,60 @@ public:
 
     ConnectionId const &connectionId() const;
 
+    /// Follows a connection remapped to other ports and moves the ends there.
+    /**
+   * The scene re-keys its own tables, see `AbstractGraphModel::connectionsRemapped`.
+   */
+    void setConnectionId(ConnectionId const &connectionId);
+
     QRectF boundingRect() const override;
 
     QPainterPath shape() const override;
 
+    /// Asks the connection picker of the scene if it has the connection, else tests `shape()`.
+    bool contains(QPointF const &point) const override;
+
     QPointF const &endPoint(PortType portType) const;
 
     QPointF out() const { return _out; }
 
     QPointF in() const { return _in; }
 
+    /// Control points of the cubic, cached until one of the ends moves.
     std::pair<QPointF, QPointF> pointsC1C2() const;
 
+    /// Control points of the cubic between two port positions of a scene in `orientation`.
+    static std::pair<QPointF, QPointF> pointsC1C2(QPointF const &out,
+                                                  QPointF const &in,
+                                                  Qt::Orientation const orientation);
+
+    /// Cubic spline from `out()` to `in()`, cached with the control points.
+    /**
+   * With connection routing enabled it is the route found for the current
+   * ends instead, see `routed()`.
+   */
+    QPainterPath const &cubicPath() const;
+
+    /// `true` if `cubicPath()` is a route of the scene's `ConnectionRouter`.
+    bool routed() const;
+
+    /// Picks up a new route of the scene's router, or that it was dropped.
+    void updateRoute();
+
+    /// Leaves the painting of a draft connection to the scene foreground.
+    /**
+   * The item then has empty bounds and never paints, so moving its loose
+   * end does not touch the scene index. See
+   * `BasicGraphicsScene::setDraftConnectionOverlay()`.
+   */
+    void setOverlaid(bool const overlaid);
+
+    bool overlaid() const { return _overlaid; }
+
+    /// Bounds of what the connection painter draws, also while overlaid.
+    QRectF paintBounds() const;
+
+    /// Repositions one end; drops the cached geometry if the point changed.
     void setEndPoint(PortType portType, QPointF const &point);
 
     /// Updates the position of both ends
@@ -60,9 +113,19 @@ public:
     ConnectionState &connectionState();
 
     // Метод для установки цвета соединения
-        void setConnectionColor(const QColor& color) { connectionColor = color; }
+        void setConnectionColor(const QColor& color);
         QColor getConnectionColor() const { return connectionColor; }
 
+    /// Text drawn by the connection painter under the `in()` end, empty for none.
+    void setLabel(QString const &label);
+
+    QString const &label() const { return _label; }
+
+    /// Where the label goes in item coordinates, empty without a label.
+    QRectF labelRect() const;
+
+    static QFont const &labelFont();
+
 Q_SIGNALS:
     void doubleClicked(); // Сигнал двойного клика
 
@@ -83,6 +146,8 @@ protected:
 
     void hoverLeaveEvent(QGraphicsSceneHoverEvent *event) override;
 
+    QVariant itemChange(GraphicsItemChange change, QVariant const &value) override;
+
     // Переопределение метода для двойного клика
     void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) override {
         Q_EMIT doubleClicked(); // Генерируем сигнал
@@ -90,15 +155,35 @@ protected:
     }
 
 private:
+    /// Adds the item to the scene and places it for `_connectionId`.
+    void initialize(BasicGraphicsScene &scene);
+
     void initializePosition();
 
     void addGraphicsEffect();
 
-    std::pair<QPointF, QPointF> pointsC1C2Horizontal() const;
+    static std::pair<QPointF, QPointF> pointsC1C2Horizontal(QPointF const &out, QPointF const &in);
 
-    std::pair<QPointF, QPointF> pointsC1C2Vertical() const;
+    static std::pair<QPointF, QPointF> pointsC1C2Vertical(QPointF const &out, QPointF const &in);
+
+    /// Recomputes control points, cubic path and bounds if they are stale.
+    void updateGeometryCache() const;
 
 private:
+    /// Geometry derived from the two end points.
+    struct GeometryCache
+    {
+        bool valid = false;
+        bool strokeValid = false;
+        bool routed = false;
+
+        std::pair<QPointF, QPointF> c1c2;
+        QPainterPath cubic;
+        QPainterPath stroke;
+        QRectF bounds;
+        QRectF label;
+    };
+
     ConnectionId _connectionId;
 
     AbstractGraphModel &_graphModel;
@@ -108,7 +193,13 @@ private:
     mutable QPointF _out;
     mutable QPointF _in;
 
+    mutable GeometryCache _geometry;
+
     QColor connectionColor;
+
+    QString _label;
+
+    bool _overlaid;
 };
 
 } // namespace QtNodes
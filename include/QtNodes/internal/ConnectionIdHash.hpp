@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
 
 #include "Definitions.hpp"
@@ -17,15 +18,41 @@ inline void hash_combine(std::size_t &seed, const T &v, Rest... rest)
     hash_combine(seed, rest...);
 }
 
+namespace QtNodes {
+
+/// 64-bit hash of the packed connection ends.
+/**
+ * Each end packs into 64 bits and both are mixed with the splitmix64
+ * finalizer, so ids of sequential nodes and ports differ in all bits;
+ * `hash_combine` left them clustered in a few low bits.
+ */
+inline std::uint64_t connectionIdHash(ConnectionId const &id)
+{
+    std::uint64_t const out = (static_cast<std::uint64_t>(id.outNodeId) << 32)
+                              | static_cast<std::uint64_t>(id.outPortIndex);
+    std::uint64_t const in = (static_cast<std::uint64_t>(id.inNodeId) << 32)
+                             | static_cast<std::uint64_t>(id.inPortIndex);
+
+    std::uint64_t x = out ^ (in * 0x9e3779b97f4a7c15ull);
+
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+
+    return x;
+}
+
+} // namespace QtNodes
+
 namespace std {
 template<>
 struct hash<QtNodes::ConnectionId>
 {
     inline std::size_t operator()(QtNodes::ConnectionId const &id) const
     {
-        std::size_t h = 0;
-        hash_combine(h, id.outNodeId, id.outPortIndex, id.inNodeId, id.inPortIndex);
-        return h;
+        return static_cast<std::size_t>(QtNodes::connectionIdHash(id));
     }
 };
 
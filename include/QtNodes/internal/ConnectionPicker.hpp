@@ -0,0 +1,108 @@
+#pragma once
+
+#include <QtCore/QPointF>
+
+#include "ConnectionIdHash.hpp"
+#include "Definitions.hpp"
+#include "Export.hpp"
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace QtNodes {
+
+/**
+ * Scene wide hit testing of the plain connection cubics without QPainterPath.
+ *
+ * The polynomial coefficients and the control point bounds of all cubics
+ * are kept in one array per component, padded to whole blocks of four, and
+ * a query tests a block of curves at once with SSE2 where available: the
+ * bounds first, then the distance to each of the `CurveSegments` chords.
+ * The curves within `tolerance()` of the last queried point are remembered,
+ * so the hover and click tests of all candidate items at one mouse position
+ * share a single pass.
+ *
+ * Only the unrouted connections of a scene are stored, see
+ * `BasicGraphicsScene::setConnectionPicking()`.
+ */
+class NODE_EDITOR_PUBLIC ConnectionPicker
+{
+public:
+    /// Chords per cubic, as in the stroke of the default connection painter.
+    static constexpr int CurveSegments = 20;
+
+public:
+    ConnectionPicker();
+
+    /// Distance from the curve still counting as a hit, 5 by default.
+    void setTolerance(qreal const tolerance);
+
+    qreal tolerance() const { return _tolerance; }
+
+    /// Stores the cubic of the connection in scene coordinates, replacing the previous one.
+    void insert(ConnectionId const &connectionId,
+                QPointF const &out,
+                QPointF const &c1,
+                QPointF const &c2,
+                QPointF const &in);
+
+    void remove(ConnectionId const &connectionId);
+
+    void clear();
+
+    std::size_t size() const { return _ids.size(); }
+
+    bool contains(ConnectionId const &connectionId) const
+    {
+        return _slots.find(connectionId) != _slots.end();
+    }
+
+    /// The stored connection nearest to `scenePoint` within the tolerance.
+    /**
+   * @returns `false` and leaves `connectionId` alone when there is none.
+   */
+    bool pick(QPointF const &scenePoint, ConnectionId &connectionId) const;
+
+    /// `true` if the stored connection passes within the tolerance of `scenePoint`.
+    bool hits(ConnectionId const &connectionId, QPointF const &scenePoint) const;
+
+private:
+    /// Fills `_hits` for `scenePoint` unless it was the last point queried.
+    void scan(QPointF const &scenePoint) const;
+
+    /// Squared distances of the four curves of a block, infinite outside the bounds.
+    void scanBlock(std::size_t const first, float const px, float const py, float *result) const;
+
+private:
+    qreal _tolerance;
+
+    std::vector<ConnectionId> _ids;
+
+    std::unordered_map<ConnectionId, std::size_t> _slots;
+
+    /// `p(t) = ((a t + b) t + c) t + d`, one entry per slot and padding.
+    std::vector<float> _ax;
+    std::vector<float> _ay;
+    std::vector<float> _bx;
+    std::vector<float> _by;
+    std::vector<float> _cx;
+    std::vector<float> _cy;
+    std::vector<float> _dx;
+    std::vector<float> _dy;
+
+    /// Bounds of the control points, which contain the curve.
+    std::vector<float> _minX;
+    std::vector<float> _minY;
+    std::vector<float> _maxX;
+    std::vector<float> _maxY;
+
+    mutable bool _scanned;
+
+    mutable QPointF _scannedPoint;
+
+    /// Squared distances of the curves hit at `_scannedPoint`.
+    mutable std::unordered_map<ConnectionId, float> _hits;
+};
+
+} // namespace QtNodes
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "ConnectionIdHash.hpp"
+#include "Definitions.hpp"
+#include "Export.hpp"
+#include "NodeDelegateModel.hpp"
+#include "SceneSpatialIndex.hpp"
+
+#include <QtCore/QObject>
+#include <QtCore/QPointF>
+#include <QtCore/QRectF>
+#include <QtCore/QThreadPool>
+#include <QtGui/QPainterPath>
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace QtNodes {
+
+class BasicGraphicsScene;
+struct GraphChangeSet;
+
+/**
+ * Routes the connections of a scene around the nodes on worker threads.
+ *
+ * The router keeps the node rectangles from the model positions and the
+ * scene geometry in a grid index. A route is searched on a coarse grid
+ * around both ends, with the inflated node rectangles as obstacles and a
+ * penalty for every bend, and drawn as an orthogonal polyline or with
+ * rounded corners.
+ *
+ * Only the connections of changed nodes and those whose routes cross the
+ * old or new rectangle of such a node are routed again. At most one round
+ * runs at a time; changes arriving meanwhile are collected for the next
+ * one, so dragging never waits for the router. Until its new route arrives
+ * a connection whose ends moved is drawn as the usual cubic.
+ *
+ * Enabled with `BasicGraphicsScene::setConnectionRouting()`.
+ */
+class NODE_EDITOR_PUBLIC ConnectionRouter : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Style {
+        Orthogonal, ///< Horizontal and vertical segments only.
+        Spline      ///< The same route with rounded corners.
+    };
+
+public:
+    ConnectionRouter(BasicGraphicsScene &scene, Style const style = Style::Orthogonal);
+
+    /// Cancels the rounds in flight, their results are dropped.
+    ~ConnectionRouter() override;
+
+    Style style() const { return _style; }
+
+    /// Routes all connections again in the new style.
+    void setStyle(Style const style);
+
+    /// The route of the connection in scene coordinates.
+    /**
+   * @returns `nullptr` without a route or if it was computed for other end
+   * points than `out` and `in`.
+   */
+    QPainterPath const *route(ConnectionId const &connectionId,
+                              QPointF const &out,
+                              QPointF const &in) const;
+
+    /// Forgets all routes and the node rectangles and routes every connection again.
+    void rerouteAll();
+
+    /// `true` while a round is computed.
+    bool busy() const { return _pendingChunks > 0; }
+
+Q_SIGNALS:
+    /// Emitted on the thread of the scene after new routes were stored.
+    void routesUpdated();
+
+public:
+    /// A connection to route, in scene coordinates.
+    struct Request
+    {
+        ConnectionId connectionId;
+        QPointF out;
+        QPointF in;
+    };
+
+    /// Node rectangles, shared with the rounds in flight.
+    using Obstacles = UniformGridIndex<NodeId>;
+
+private:
+    struct Route
+    {
+        QPointF out;
+        QPointF in;
+
+        /// Corners from `out` to `in`, every segment horizontal or vertical.
+        std::vector<QPointF> points;
+
+        QPainterPath path;
+    };
+
+    struct Result
+    {
+        ConnectionId connectionId;
+
+        /// Without points no route was found.
+        Route route;
+    };
+
+    void connectModel();
+
+    bool batching() const;
+
+    void onNodeChanged(NodeId const nodeId);
+
+    void onConnectionCreated(ConnectionId const connectionId);
+
+    void onConnectionDeleted(ConnectionId const connectionId);
+
+    void onBatchFinished(GraphChangeSet const &changes);
+
+    /// Marks the connections whose routes cross `rect` for routing.
+    void markCorridor(QRectF const &rect);
+
+    /// A copy of the obstacles if a round still reads them.
+    Obstacles &writableObstacles();
+
+    QRectF nodeRect(NodeId const nodeId) const;
+
+    void schedule();
+
+    void startRound();
+
+    void onResults(std::uint64_t const generation, std::vector<Result> const &results);
+
+    QPointF portPosition(ConnectionId const &connectionId, PortType const portType) const;
+
+    /// Stores the route, or drops it without points, and refreshes the connection item.
+    void setRoute(ConnectionId const &connectionId, Route route);
+
+private:
+    BasicGraphicsScene &_scene;
+
+    Style _style;
+
+    std::shared_ptr<Obstacles> _obstacles;
+
+    std::unordered_map<ConnectionId, Route> _routes;
+
+    /// Bounds of the stored routes.
+    UniformGridIndex<ConnectionId> _routeIndex;
+
+    std::unordered_set<NodeId> _changedNodes;
+
+    std::unordered_set<ConnectionId> _dirtyConnections;
+
+    bool _scheduled;
+
+    std::size_t _pendingChunks;
+
+    /// Bumped by `rerouteAll()`, results of older rounds are dropped.
+    std::uint64_t _generation;
+
+    CancellationToken _roundToken;
+
+    QThreadPool _pool;
+};
+
+} // namespace QtNodes
@@ -50,6 +50,13 @@ public:
 
     void resetLastHoveredNode();
 
+    /// Back to the state of a new connection, for a recycled graphics object.
+    void reset()
+    {
+        _hovered = false;
+        _lastHoveredNode = InvalidNodeId;
+    }
+
 private:
     ConnectionGraphicsObject &_cgo;
 
@@ -2,18 +2,23 @@
 
 #include <QtGui/QColor>
 
+#include "Definitions.hpp"
 #include "Export.hpp"
 #include "Style.hpp"
 
 namespace QtNodes {
 
-class NODE_EDITOR_PUBLIC ConnectionStyle : public Style
+class NODE_EDITOR_CORE_PUBLIC ConnectionStyle : public Style
 {
 public:
+    /// A copy of the default style, parsed once from the resources.
     ConnectionStyle();
 
+    /// The default style with the values of `jsonText` applied.
     ConnectionStyle(QString jsonText);
 
+    ConnectionStyle(QJsonObject const &json);
+
     ~ConnectionStyle() = default;
 
 public:
@@ -28,6 +33,7 @@ public:
     QColor constructionColor() const;
     QColor normalColor() const;
     QColor normalColor(QString typeId) const;
+    QColor normalColor(NodeDataTypeId typeId) const;
     QColor selectedColor() const;
     QColor selectedHaloColor() const;
     QColor hoveredColor() const;
@@ -36,6 +42,12 @@ public:
     float constructionLineWidth() const;
     float pointDiameter() const;
 
+    /// Levels of detail (`QStyleOptionGraphicsItem::levelOfDetailFromTransform`)
+    /// below which `DefaultConnectionPainter` simplifies; `0` disables a tier.
+    float detailsLevelOfDetail() const;  ///< Halos, end points and converter icons go.
+    float polylineLevelOfDetail() const; ///< The cubic becomes a short polyline.
+    float straightLevelOfDetail() const; ///< A single straight line.
+
     bool useDataDefinedColors() const;
 
 private:
@@ -49,6 +61,13 @@ private:
     float ConstructionLineWidth;
     float PointDiameter;
 
+    float DetailsLevelOfDetail;
+    float PolylineLevelOfDetail;
+    float StraightLevelOfDetail;
+
     bool UseDataDefinedColors;
+
+private:
+    static ConnectionStyle const &defaultStyle();
 };
 } // namespace QtNodes
@@ -1,7 +1,11 @@
 #pragma once
 
 #include "AbstractGraphModel.hpp"
+#include "ComputeResultCache.hpp"
 #include "ConnectionIdUtils.hpp"
+#include "FlatHashMap.hpp"
+#include "MemoryReport.hpp"
+#include "MpscRingBuffer.hpp"
 #include "NodeDelegateModelRegistry.hpp"
 #include "Serializable.hpp"
 #include "StyleCollection.hpp"
@@ -9,12 +13,32 @@
 #include "Export.hpp"
 
 #include <QJsonObject>
+#include <QtCore/QByteArray>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QIODevice>
+#include <QtCore/QJsonArray>
+#include <QtCore/QTemporaryFile>
+#include <QtCore/QThreadPool>
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <list>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+class QDataStream;
 
 namespace QtNodes {
 
-class NODE_EDITOR_PUBLIC DataFlowGraphModel : public AbstractGraphModel, public Serializable
+class PropagationTracer;
+class WorkStealingExecutor;
+
+class NODE_EDITOR_CORE_PUBLIC DataFlowGraphModel : public AbstractGraphModel, public Serializable
 {
     Q_OBJECT
 
@@ -25,11 +49,303 @@ public:
         QPointF pos;
     };
 
+    /// Defines when the output data of a node reaches the connected inputs.
+    enum class PropagationMode {
+        /// Data is pushed downstream recursively from inside `dataUpdated`.
+        Immediate,
+
+        /// Updated output ports are only marked dirty. A flush delivers them
+        /// in topological order, so every node passes its outputs downstream
+        /// once per flush no matter how many paths lead to it.
+        Scheduled
+    };
+
+    /// Recent evaluation cost of a node, see `setNodeStatisticsEnabled()`.
+    struct NodeStatistics
+    {
+        /// `setInData()` calls and finished asynchronous computations.
+        std::uint64_t evaluations = 0;
+
+        /// Latest evaluation; the propagation to downstream nodes is not included.
+        double lastMilliseconds = 0.0;
+
+        /// Exponential moving average of `lastMilliseconds`.
+        double averageMilliseconds = 0.0;
+
+        /// Exponential moving average of the evaluation frequency.
+        double evaluationsPerSecond = 0.0;
+    };
+
 public:
     DataFlowGraphModel(std::shared_ptr<NodeDelegateModelRegistry> registry);
 
+    /// Waits for the asynchronous computations still running.
+    ~DataFlowGraphModel() override;
+
     std::shared_ptr<NodeDelegateModelRegistry> dataModelRegistry() { return _registry; }
 
+    PropagationMode propagationMode() const { return _propagationMode; }
+
+    /// Switching back to `Immediate` flushes the pending updates first.
+    void setPropagationMode(PropagationMode const mode);
+
+    /// Delivers all pending output updates in `Scheduled` mode.
+    /**
+   * The flush is queued automatically on the event loop; call the function
+   * directly when the results are needed synchronously, e.g. headless runs.
+   */
+    void processPendingPropagation();
+
+    int propagationBudget() const { return _propagationBudget; }
+
+    /// Splits the queued flushes of `Scheduled` mode into slices of `milliseconds`.
+    /**
+   * A slice delivers the dirty nodes in topological order until the budget
+   * is spent, then yields to the event loop and goes on in the next slice,
+   * so long cascades through delegates bound to the GUI thread no longer
+   * freeze the interface. `propagationProgress()` follows every slice. The
+   * budget is checked between nodes; one slow delegate still overruns it.
+   * `0`, the default, flushes in one go. Direct calls of
+   * `processPendingPropagation()` and parallel evaluation are not sliced.
+   */
+    void setPropagationBudget(int const milliseconds) { _propagationBudget = milliseconds; }
+
+    /// Flushes deliver `nodeIds` and everything upstream of them first.
+    /**
+   * The rest of the affected nodes follows in topological order, so with a
+   * `propagationBudget()` the results shown on screen arrive in the first
+   * slices and offscreen branches finish later. Views pass the nodes they
+   * show, see `DataFlowGraphicsScene::setVisibleFirstEvaluation()`.
+   */
+    void setPriorityNodes(std::unordered_set<NodeId> nodeIds);
+
+    std::unordered_set<NodeId> const &priorityNodes() const { return _priorityNodes; }
+
+    bool parallelEvaluation() const { return _parallelEvaluation; }
+
+    /// @returns the latest asynchronous compute generation of the node, 0 if none.
+    std::uint64_t computeGeneration(NodeId const nodeId) const;
+
+    /// Evaluates independent branches concurrently in `processPendingPropagation()`.
+    /**
+   * Each flush runs the affected nodes on a work-stealing executor; a node
+   * starts once every upstream node of the flush has finished. Delegates
+   * not reporting `NodeDelegateModel::threadSafe()` still run on the
+   * calling thread. Has no effect in `Immediate` mode.
+   */
+    void setParallelEvaluation(bool const enabled) { _parallelEvaluation = enabled; }
+
+    bool parallelSerialization() const { return _parallelSerialization; }
+
+    /// Runs the delegates' `save()` and `load()` in `save()` and `load()` on worker threads.
+    /**
+   * Only delegates reporting `NodeDelegateModel::threadSafeSerialization()`
+   * leave the calling thread. Nodes are still created, and every signal
+   * emitted, on the calling thread, and the output keeps the node order.
+   * `load()` then restores the delegates directly instead of calling
+   * `loadNode()` per node.
+   */
+    void setParallelSerialization(bool const enabled) { _parallelSerialization = enabled; }
+
+    bool lazyInternalData() const { return _lazyInternalData; }
+
+    /// Defers `NodeDelegateModel::load()` in `load()` and `loadNode()`.
+    /**
+   * The delegate is still created, for its ports and caption, but its
+   * `internal-data` object stays as read until the model needs the loaded
+   * delegate: an evaluation, its data, the ports of a delegate without a
+   * port table, its embedded widget. Type, caption, geometry and style are
+   * answered without it, so a scene shows nodes without widgets undecoded;
+   * a caption that changes on decoding is followed by `nodeUpdated()`. The
+   * internal data of nodes never decoded is saved back exactly as it was
+   * loaded. Off by default; `loadBinaryFile()` always loads this way.
+   */
+    void setLazyInternalData(bool const enabled) { _lazyInternalData = enabled; }
+
+    bool saveNodeSizes() const { return _saveNodeSizes; }
+
+    /// Writes the measured size of every node into `save()` and `saveNode()`.
+    /**
+   * The size is stored along with the `NodeRole::LayoutKey` the geometry
+   * measured it under. On load the scene takes the size as is while the key
+   * still matches, instead of measuring the caption and every port label of
+   * the node again. Off by default.
+   */
+    void setSaveNodeSizes(bool const enabled);
+
+    bool incrementalSave() const { return _incrementalSave; }
+
+    /// Keeps the `saveNode()` JSON of every node and reuses it until the node changes.
+    /**
+   * `save()` and `saveNode()` then only call `NodeDelegateModel::save()` for
+   * nodes that emitted `dataUpdated`, `internalDataChanged` or were updated
+   * through the model since they were last saved, and only rewrite the
+   * position of nodes that merely moved. The connection array is kept until
+   * the topology changes. Delegates whose saved state changes silently, e.g.
+   * through their widget, must emit `internalDataChanged` for this to stay
+   * exact. Off by default.
+   */
+    void setIncrementalSave(bool const enabled);
+
+    bool compactJson() const { return _compactJson; }
+
+    /// Writes the compact layout of SceneJson.hpp from `save()` and `saveNode()`.
+    /**
+   * Connections become one flat integer array and positions `[x, y]`.
+   * `load()` and `loadNode()` read both layouts whatever the setting, so
+   * only consumers outside the library need to know it. Off by default.
+   */
+    void setCompactJson(bool const enabled);
+
+    /// Evaluates `nodeIds` as one task of parallel evaluation.
+    /**
+   * The members of a unit run one after the other, in propagation order, on
+   * a single worker, which saves the scheduling of many small tasks. Units
+   * connected to themselves through outside nodes cannot run as one task;
+   * the flush then falls back to a task per node. A node belongs to one
+   * unit at most, an empty `nodeIds` removes the unit. Used by
+   * GroupedGraphModel for its collapsed groups.
+   */
+    void setEvaluationUnit(NodeId const unitId, std::unordered_set<NodeId> const &nodeIds);
+
+    /// Replaces the output of a port and propagates it like `dataUpdated`.
+    /**
+   * The delegate is bypassed: `data` stays the port's output until the
+   * delegate reports new data itself. Used to feed source nodes from
+   * outside, e.g. by BatchEvaluator.
+   */
+    void setOutPortData(NodeId const nodeId,
+                        PortIndex const portIndex,
+                        std::shared_ptr<NodeData> data);
+
+    /// Passes the outputs of `nodeId` downstream at most once per `milliseconds`.
+    /**
+   * Updates arriving sooner are held back and their ports delivered when
+   * the interval has passed, each once with its latest data no matter how
+   * often it changed meanwhile. Meant for sources updating far more often
+   * than anyone looks, such as sensor feeds. `0`, the default, delivers
+   * per propagation mode. Not saved with the node.
+   */
+    void setNodeUpdateInterval(NodeId const nodeId, int const milliseconds);
+
+    int nodeUpdateInterval(NodeId const nodeId) const;
+
+    /// Cached output of the port, same as `portData(..., PortRole::Data)` without the QVariant.
+    std::shared_ptr<NodeData> outPortData(NodeId const nodeId, PortIndex const portIndex) const;
+
+    /// Maximum number of results remembered for deterministic delegates.
+    std::size_t resultCacheCapacity() const { return _resultCache.capacity(); }
+
+    /// `0` disables the result cache.
+    void setResultCacheCapacity(std::size_t const capacity);
+
+    bool releaseIntermediateData() const { return _releaseIntermediateData; }
+
+    /// Lets releasable nodes drop their data once all their consumers have run.
+    /**
+   * Applies to nodes whose delegate reports `NodeDelegateModel::releasable()`
+   * and which feed at least one connection. Sinks, priority nodes and nodes
+   * with a computation running keep their data. Delivered nodes stay
+   * resident while their outputs fit into `intermediateMemoryBudget()`, the
+   * least recently delivered are released first.
+   *
+   * Reading an output of a released node, or delivering new data to it,
+   * restores the node on demand: from its spill file if it has one, see
+   * `setSpillThreshold()`, otherwise by feeding it its inputs again, which
+   * restores released upstream nodes in turn. Off by default.
+   */
+    void setReleaseIntermediateData(bool const enabled);
+
+    std::size_t intermediateMemoryBudget() const { return _intermediateMemoryBudget; }
+
+    /// Bytes of intermediate outputs kept resident, by `NodeData::memoryUsage()`.
+    /**
+   * `0`, the default, releases every intermediate node as soon as its
+   * consumers have run.
+   */
+    void setIntermediateMemoryBudget(std::size_t const bytes);
+
+    double spillThreshold() const { return _spillThreshold; }
+
+    /// Writes the outputs of released nodes slower than `milliseconds` to disk.
+    /**
+   * A spilled node is restored by reading its outputs back instead of
+   * evaluating it and its upstream again. The average of `nodeStatistics()`
+   * decides, so node statistics must be enabled. Outputs are encoded with
+   * NodeDataCodec; nodes with an unregistered output type are not spilled.
+   * The temporary files go with their node or new data. Negative, the
+   * default, disables spilling.
+   */
+    void setSpillThreshold(double const milliseconds) { _spillThreshold = milliseconds; }
+
+    /// Deleted recyclable delegates kept per model name for new nodes.
+    /**
+   * Every delegate the model drops goes through the pool: deleted nodes,
+   * `clear()` before a reload, and nodes replaced by loading over their id.
+   */
+    std::size_t delegatePoolCapacity() const { return _delegatePoolCapacity; }
+
+    /// `0` disables recycling and frees the pooled delegates.
+    void setDelegatePoolCapacity(std::size_t const capacity);
+
+    /// Approximate memory of the node and connection tables, caches and delegates.
+    MemoryReport memoryReport() const;
+
+    /// Nodes whose delegate has the model name `type`, in no particular order.
+    /**
+   * The vector is maintained by the model and changes with the next node
+   * added or deleted; copy it before modifying the graph.
+   */
+    std::vector<NodeId> const &nodesOfType(QString const &type) const;
+
+    bool captionIndexEnabled() const { return _captionIndexEnabled; }
+
+    /// Keeps the case folded captions of all nodes sorted for the caption queries.
+    /**
+   * Off by default, the queries then scan the captions of the delegates.
+   * Captions are read again on `nodeCreated`, `nodeUpdated` and
+   * `nodeInternalDataChanged`; delegates changing their caption otherwise
+   * are not seen.
+   */
+    void setCaptionIndexEnabled(bool const enabled);
+
+    /// Nodes whose caption equals `caption`, ignoring case.
+    std::vector<NodeId> nodesWithCaption(QString const &caption) const;
+
+    /// Nodes whose caption starts with `prefix`, ignoring case, ordered by caption.
+    std::vector<NodeId> nodesWithCaptionPrefix(QString const &prefix,
+                                               std::size_t const limit
+                                               = std::numeric_limits<std::size_t>::max()) const;
+
+    /// Worker pool running the jobs of `NodeDelegateModel::computeJob()`.
+    QThreadPool &computePool() { return _computePool; }
+
+    bool nodeStatisticsEnabled() const { return _nodeStatisticsEnabled; }
+
+    /// Times every evaluation into rolling per-node `NodeStatistics`.
+    /**
+   * A `setInData()` call counts its own time only, an asynchronous
+   * computation the time from its start to its results. The average also
+   * answers `NodeRole::ComputeTime`, which the scene can paint as a heat
+   * map. Costs two clock reads per `setInData()`. Disabling drops the
+   * collected statistics.
+   */
+    void setNodeStatisticsEnabled(bool const enabled);
+
+    /// Empty statistics for unknown nodes or while disabled.
+    NodeStatistics nodeStatistics(NodeId const nodeId) const;
+
+    void resetNodeStatistics();
+
+    /// Records the propagation into `tracer`, `nullptr` stops tracing.
+    /**
+   * The tracer is not owned and must outlive the model or be reset first.
+   * Change it only while no flush or computation is running.
+   */
+    void setPropagationTracer(PropagationTracer *tracer) { _tracer = tracer; }
+
+    PropagationTracer *propagationTracer() const { return _tracer; }
+
 public:
     std::unordered_set<NodeId> allNodeIds() const override;
 
@@ -39,10 +355,26 @@ public:
                                                  PortType portType,
                                                  PortIndex portIndex) const override;
 
+    void forEachConnection(NodeId nodeId,
+                           PortType portType,
+                           PortIndex portIndex,
+                           ConnectionVisitor const &visitor) const override;
+
+    void forEachNodeConnection(NodeId nodeId, ConnectionVisitor const &visitor) const override;
+
+    void forEachGraphConnection(ConnectionVisitor const &visitor) const override;
+
+    std::size_t connectionCount(NodeId nodeId,
+                                PortType portType,
+                                PortIndex portIndex) const override;
+
     bool connectionExists(ConnectionId const connectionId) const override;
 
+    void reserve(std::size_t const nodes, std::size_t const connections) override;
+
     NodeId addNode(QString const nodeType) override;
 
+    /// Also rejects connections that would close a cycle.
     bool connectionPossible(ConnectionId const connectionId) const override;
 
     void addConnection(ConnectionId const connectionId) override;
@@ -51,10 +383,22 @@ public:
 
     QVariant nodeData(NodeId nodeId, NodeRole role) const override;
 
+    /// Reads the node records directly, without touching lazily loaded data.
+    void forEachNodeGeometry(NodeGeometryVisitor const &visitor) const override;
+
+    void nodePositions(std::vector<NodeId> const &nodeIds,
+                       std::vector<QPointF> &positions) const override;
+
+    void nodeSizes(std::vector<NodeId> const &nodeIds, std::vector<QSize> &sizes) const override;
+
     NodeFlags nodeFlags(NodeId nodeId) const override;
 
     bool setNodeData(NodeId nodeId, NodeRole role, QVariant value) override;
 
+    void moveNodes(std::vector<NodeId> const &nodeIds, QPointF const &delta) override;
+
+    void setNodePositions(std::vector<std::pair<NodeId, QPointF>> const &positions) override;
+
     QVariant portData(NodeId nodeId,
                       PortType portType,
                       PortIndex portIndex,
@@ -68,16 +412,76 @@ public:
 
     bool deleteConnection(ConnectionId const connectionId) override;
 
+    /// Drops the connections at once, then empties each input that lost one.
+    void deleteConnections(std::vector<ConnectionId> const &connectionIds) override;
+
+    /// Rewrites the connections in place; no data is propagated.
+    void remapConnections(ConnectionRemap const &remap) override;
+
     bool deleteNode(NodeId const nodeId) override;
 
+    /// Drops all attached connections at once, then the nodes.
+    /**
+   * Empty data is only propagated to the inputs of the remaining nodes, and
+   * only their delegates hear of the deleted connections.
+   */
+    void deleteNodes(std::vector<NodeId> const &nodeIds) override;
+
+    /// Drops all records and connections at once and emits `modelReset`.
+    /**
+   * Nothing is propagated and no delegate hears of its connections going.
+   */
+    void clear() override;
+
     QJsonObject saveNode(NodeId const) const override;
 
     QJsonObject save() const override;
 
     void loadNode(QJsonObject const &nodeJson) override;
 
+    /// Restores a whole graph in one model batch.
+    /**
+   * All nodes and connections are inserted first without sending any data
+   * through the new connections. A single pass in topological order then
+   * delivers the outputs, and the scene builds its graphics objects once
+   * when the batch closes.
+   */
     void load(QJsonObject const &json) override;
 
+    /// Writes the graph in the versioned binary layout (`*.flowb` files).
+    /**
+   * The stream is a QDataStream (big endian) with the layout
+   *
+   *   quint32 magic, quint16 version,
+   *   quint32 node count, per node: quint32 id, double x, double y,
+   *   QString model name (since version 2) and a QByteArray with the
+   *   compact JSON of `NodeDelegateModel::save()`,
+   *   quint32 connection count, per connection: four quint32 values
+   *   (out node, out port, in node, in port).
+   *
+   * The delegate stays an opaque blob, so nodes keep using their JSON hooks.
+   */
+    bool saveBinary(QIODevice &device) const;
+
+    /// Restores a graph written by `saveBinary()` the same way `load()` does.
+    /**
+   * @returns `false` for an unknown header or a truncated stream. Unknown
+   * delegate models throw as in `loadNode()`.
+   */
+    bool loadBinary(QIODevice &device);
+
+    /// Memory-maps `fileName` and restores the binary scene from the mapping.
+    /**
+   * Only the node and connection tables are decoded while loading. The
+   * internal data of every node is kept as a raw blob and handed to
+   * `NodeDelegateModel::load()` the first time the model touches that node.
+   * Falls back to buffered reading when the file cannot be mapped.
+   */
+    bool loadBinaryFile(QString const &fileName);
+
+    /// @returns `true` if `header` starts with the binary scene magic.
+    static bool isBinaryScene(QByteArray const &header);
+
     /**
    * Fetches the NodeDelegateModel for the given `nodeId` and tries to cast the
    * stored pointer to the given type
@@ -85,11 +489,11 @@ public:
     template<typename NodeDelegateModelType>
     NodeDelegateModelType *delegateModel(NodeId const nodeId)
     {
-        auto it = _models.find(nodeId);
-        if (it == _models.end())
+        NodeRecord const *record = findNode(nodeId);
+        if (!record)
             return nullptr;
 
-        auto model = dynamic_cast<NodeDelegateModelType *>(it->second.get());
+        auto model = dynamic_cast<NodeDelegateModelType *>(record->model.get());
 
         return model;
     }
@@ -97,13 +501,408 @@ public:
 Q_SIGNALS:
     void inPortDataWasSet(NodeId const, PortType const, PortIndex const);
 
+    /// Forwards `NodeDelegateModel::internalDataChanged()`.
+    void nodeInternalDataChanged(NodeId const nodeId);
+
+    /// A slice of a budgeted flush ended, see `setPropagationBudget()`.
+    /**
+   * `remaining` counts the nodes of the flush not visited yet, `0` once the
+   * flush is done.
+   */
+    void propagationProgress(std::size_t const delivered, std::size_t const remaining);
+
 private:
+    struct OutDataCacheEntry
+    {
+        bool valid = false;
+        std::shared_ptr<NodeData> data;
+    };
+
+    /// Everything the model stores per node, kept contiguously in `_nodes`.
+    struct NodeRecord
+    {
+        NodeId id;
+        std::unique_ptr<NodeDelegateModel> model;
+        NodeGeometryData geometry;
+
+        /// Model name and position of the node in `_nodesByType`.
+        QString typeName;
+        std::size_t typeSlot = 0;
+
+        /// Not yet decoded internal data (compact JSON) of a lazily loaded node.
+        mutable QByteArray pendingInternalData;
+
+        /// Not yet loaded internal data of a node restored with `lazyInternalData()`.
+        mutable QJsonObject pendingInternalObject;
+
+        bool hasPendingData() const
+        {
+            return !pendingInternalData.isEmpty() || !pendingInternalObject.isEmpty();
+        }
+
+        /// Set by the first `NodeRole::Widget` read, ends the size hint.
+        mutable bool widgetRequested = false;
+
+        /// `NodeRole::LayoutKey` the current size was measured under, `0` if unknown.
+        quint64 layoutKey = 0;
+
+        /// The size comes from a saved scene and was not measured yet.
+        bool sizeRestored = false;
+
+        /// Asynchronous computations started and not yet delivered.
+        unsigned int computeJobs = 0;
+
+        /// Bumped by every compute request; older results are stale.
+        std::uint64_t computeGeneration = 0;
+
+        /// Token of the latest generation.
+        CancellationToken computeToken;
+
+        /// Last `outData()` of every output port, shared by all the consumers.
+        mutable std::vector<OutDataCacheEntry> outDataCache;
+
+        /// The delegate dropped its data, see `setReleaseIntermediateData()`.
+        mutable bool released = false;
+
+        /// `saveNode()` JSON as last saved, empty when the internal data changed since.
+        mutable QJsonObject savedJson;
+
+        /// Only the position or size of `savedJson` is outdated.
+        mutable bool savedGeometryOutdated = false;
+
+        /// Position of the node in `ExecutionPlan::order`, valid with the plan.
+        mutable std::size_t planSlot = 0;
+
+        /// Rank in the incrementally maintained topological order.
+        std::uint64_t topologicalRank = 0;
+
+        /// Content hash per input port; deterministic nodes only.
+        ComputeResultCache::InputHashes inputHashes;
+
+        /// Ports whose data provides no content hash.
+        std::vector<bool> unhashableInputs;
+
+        /// Set if the latest generation stores its results under `computeInputHashes`.
+        bool memoizeCompute = false;
+
+        ComputeResultCache::InputHashes computeInputHashes;
+
+        NodeStatistics statistics;
+
+        /// `_statisticsClock` time of the latest evaluation and compute start.
+        std::int64_t lastEvaluation = -1;
+        std::int64_t computeStart = 0;
+    };
+
+    /// Topology compiled into flat arrays, rebuilt after structural changes.
+    /**
+   * Nodes are addressed by their slot, i.e. their position in `order`.
+   * The fan-out and input tables are stored per slot as ranges
+   * `[begin[slot], begin[slot + 1])` into one shared array each.
+   */
+    struct ExecutionPlan
+    {
+        struct Fanout
+        {
+            PortIndex outPortIndex;
+            std::size_t targetsBegin;
+            std::size_t targetsEnd;
+        };
+
+        struct Target
+        {
+            NodeId nodeId;
+            std::size_t slot;
+
+            /// Position of the receiver in `_nodes`.
+            std::size_t nodeIndex;
+
+            PortIndex inPortIndex;
+
+            /// Registered converter between the two port types, `nullptr` if they match.
+            NodeDelegateModelRegistry::TypeConverter const *converter;
+        };
+
+        struct Input
+        {
+            std::size_t sourceSlot;
+            PortIndex outPortIndex;
+            PortIndex inPortIndex;
+        };
+
+        /// `_topologyRevision` the plan was compiled for.
+        std::uint64_t revision = 0;
+
+        /// `NodeDelegateModelRegistry::revision()` the converters were resolved at.
+        std::uint64_t registryRevision = 0;
+
+        /// Topological order; nodes on cycles are appended in arbitrary order.
+        std::vector<NodeId> order;
+
+        std::vector<std::size_t> fanoutBegin;
+        std::vector<Fanout> fanouts;
+        std::vector<Target> targets;
+
+        std::vector<std::size_t> inputBegin;
+        std::vector<Input> inputs;
+    };
+
     NodeId newNodeId() override { return _nextNodeId++; }
 
+    NodeId reserveNodeIds(std::size_t const count) override;
+
+    /// @returns the record of `nodeId` or `nullptr`; never inserts.
+    /**
+   * Decodes the pending internal data first, so the returned delegate is
+   * always fully loaded.
+   */
+    NodeRecord *findNode(NodeId const nodeId);
+
+    NodeRecord const *findNode(NodeId const nodeId) const;
+
+    /// Same as `findNode()`, but leaves pending internal data untouched.
+    NodeRecord const *peekNode(NodeId const nodeId) const;
+
+    NodeRecord *peekNode(NodeId const nodeId);
+
+    /// The registered converter `connectionId` applies, `nullptr` for matching port types.
+    NodeDelegateModelRegistry::TypeConverter const *connectionConverter(
+        ConnectionId const connectionId) const;
+
+    /// @returns `true` if `connectionId` would close a cycle.
+    /**
+   * While the order is intact only nodes ranked between the two endpoints
+   * are visited, and a connection following the order is accepted at once.
+   */
+    bool createsCycle(ConnectionId const connectionId) const;
+
+    /// Repairs the topological ranks after `connectionId` was added (Pearce-Kelly).
+    /**
+   * A connection closing a cycle, e.g. from an old scene file, cannot be
+   * ordered; it is kept in `_unorderedConnections` instead.
+   */
+    void updateTopologicalOrder(ConnectionId const connectionId);
+
+    /// Hands the pending internal data of `record` to its delegate.
+    void decodePendingData(NodeRecord const &record) const;
+
+    /// The pending internal data of `record` as saved, without loading the delegate.
+    static QJsonObject pendingData(NodeRecord const &record);
+
+    /// @returns the cached `outData(portIndex)`, pulling it from the delegate once.
+    std::shared_ptr<NodeData> cachedOutData(NodeRecord const &record, PortIndex const portIndex) const;
+
+    /// Reads the spilled outputs back or feeds the released node its inputs again.
+    void restoreReleasedData(NodeRecord const &record) const;
+
+    /// Hands the current upstream outputs to all connected inputs but `except`.
+    /**
+   * No data is propagated; released upstream nodes are restored first.
+   */
+    void refeedInputs(NodeRecord const &record, PortIndex const except) const;
+
+    /// Fills the output cache of `record` from its spill file.
+    bool loadSpill(NodeRecord const &record) const;
+
+    /// Writes the outputs of `record` to a new spill file, if all types are encodable.
+    bool spillOutputs(NodeRecord const &record);
+
+    /// Puts the nodes delivered since the last call under the memory budget.
+    void retainDeliveredNodes();
+
+    /// Releases the least recently delivered nodes until the budget is met.
+    void releaseOverBudget();
+
+    void releaseNodeData(NodeRecord &record);
+
+    /// Drops the budget entry and the spill file of a node.
+    void forgetIntermediate(NodeId const nodeId);
+
+    /// Drops one cached output, or all of them for `InvalidPortIndex`.
+    /**
+   * Called on `dataUpdated`, `dataInvalidated`, port changes and new input
+   * data. Safe during a parallel flush: it only touches the node's record.
+   */
+    void invalidateOutData(NodeId const nodeId, PortIndex const portIndex = InvalidPortIndex);
+
+    NodeRecord &insertNode(NodeId const nodeId, std::unique_ptr<NodeDelegateModel> model);
+
+    /// Takes a recycled delegate from the pool, or creates one with the registry.
+    std::unique_ptr<NodeDelegateModel> createDelegate(QString const &modelName);
+
+    /// Wires the signals of the delegate of `nodeId` to the model.
+    void connectDelegate(NodeId const nodeId, NodeDelegateModel &model);
+
+    /// Forwards the computing signals of a delegate to the tracer.
+    void connectTracing(NodeId const nodeId, NodeDelegateModel &model);
+
+    /// Pools the delegate of a deleted node if it is recyclable, destroys it otherwise.
+    void recycleDelegate(std::unique_ptr<NodeDelegateModel> model);
+
+    /// @returns the plan of the current topology, compiling it if outdated.
+    ExecutionPlan const &executionPlan() const;
+
+    /// Called on every change of nodes, connections or ports.
+    void invalidateExecutionPlan() { ++_topologyRevision; }
+
+    /// Swap-removes the record, keeping `_nodes` dense.
+    void removeNode(NodeId const nodeId);
+
+    /// Adds the node to `_nodesByType` under the name of its delegate.
+    void indexNodeType(NodeRecord &record);
+
+    /// Removes the node from `_nodesByType` and the caption index.
+    void unindexNode(NodeRecord const &record);
+
+    /// Reads the caption of the node into the caption index, if enabled.
+    void updateCaptionIndex(NodeId const nodeId) const;
+
+    /// The `saveNode()` JSON of `record`, kept when `incrementalSave()` is on.
+    /**
+   * `internalData` is the delegate's `save()` if the caller has it already.
+   */
+    QJsonObject cachedNodeJson(NodeRecord const &record, QJsonObject const *internalData) const;
+
+    /// Drops the cached JSON of a node whose internal data may have changed.
+    void invalidateSavedNode(NodeId const nodeId);
+
+    /// `saveNode()` around already saved internal data.
+    QJsonObject nodeJson(NodeRecord const &record, QJsonObject const &internalData) const;
+
+    /// Takes the saved size of `nodeJson` over if it has a layout key.
+    void restoreSize(NodeId const nodeId, QJsonObject const &nodeJson);
+
+    /// Internal data of every node in `_nodes` order, on the executor if enabled.
+    std::vector<QJsonObject> saveInternalData() const;
+
+    /// Restores the nodes of `load()`, then loads the delegates on the executor.
+    void loadInParallel(QJsonArray const &nodesJsonArray);
+
+    /// Shared part of `loadNode()` and `loadBinary()`; the delegate is not loaded yet.
+    /**
+   * @throws std::logic_error when `modelName` is not registered.
+   */
+    NodeDelegateModel *restoreNode(NodeId const restoredNodeId,
+                                   QPointF const &pos,
+                                   QString const &modelName);
+
+    bool readBinary(QDataStream &in);
+
+    /// Runs `body` inside a batch with deferred propagation, then flushes once.
+    void bulkLoad(std::function<void()> const &body);
+
     void sendConnectionCreation(ConnectionId const connectionId);
 
     void sendConnectionDeletion(ConnectionId const connectionId);
 
+    /// Removes the existing connections from the tables and emits their deletion.
+    /**
+   * Delegates of `deletedNodes` are not notified.
+   * @returns the inputs of the other nodes that lost a connection, each once.
+   */
+    std::vector<std::pair<NodeId, PortIndex>> removeConnections(
+        std::vector<ConnectionId> const &connectionIds,
+        std::unordered_set<NodeId> const &deletedNodes);
+
+    /// Cleans up the tables and the delegate of a node without connections.
+    void releaseNode(NodeId const nodeId);
+
+    /// Registers the connection in the per-port and per-node adjacency tables.
+    void indexConnection(ConnectionId const connectionId);
+
+    /// Removes the connection from the adjacency tables.
+    void unindexConnection(ConnectionId const connectionId);
+
+    /// Delivers the port now or marks it dirty, depending on the propagation mode.
+    void propagateOutPort(NodeId const nodeId, PortIndex const portIndex);
+
+    /// Holds the port back if its node was delivered less than its update interval ago.
+    bool throttleOutPort(NodeId const nodeId, PortIndex const portIndex);
+
+    /// Propagates the ports held back by `throttleOutPort()`.
+    void releaseThrottledPorts(NodeId const nodeId);
+
+    /// Sets the data of the given output port on all connected inputs.
+    /**
+   * Walks the fan-out list of the execution plan, no connection lookups.
+   */
+    void deliverOutPortData(NodeId const nodeId, PortIndex const portIndex);
+
+    /// Adds an evaluation of `duration` ns that began at `start` to the statistics.
+    void recordEvaluation(NodeRecord &record,
+                          std::int64_t const start,
+                          std::int64_t const duration);
+
+    /// Internal propagation path: hands `data` to the delegate without a QVariant.
+    /**
+   * `setPortData(In, Data)` unwraps its QVariant and ends up here as well.
+   */
+    void deliverInData(NodeId const nodeId,
+                       PortIndex const portIndex,
+                       std::shared_ptr<NodeData> const &data);
+
+    void deliverInData(NodeRecord &record,
+                       PortIndex const portIndex,
+                       std::shared_ptr<NodeData> const &data);
+
+    /// Queues a flush within `propagationBudget()` unless one is already queued.
+    void schedulePropagation();
+
+    /// Delivers the dirty ports until they are clean or `budget` ms have passed.
+    void flushPropagation(int const budget);
+
+    /// Topological order of the dirty nodes and everything downstream of them.
+    /**
+   * The priority nodes and their upstream come first, each part ordered.
+   */
+    std::vector<NodeId> propagationOrder() const;
+
+    /// Parallel counterpart of the delivery loop in `processPendingPropagation()`.
+    void propagateInParallel(std::vector<NodeId> const &order);
+
+    /// Runs the delegate's `computeJob()` on `_computePool`.
+    /**
+   * Deterministic delegates are first looked up in `_resultCache`; a hit
+   * delivers the remembered results synchronously.
+   */
+    void startCompute(NodeId const nodeId);
+
+    /// Records the content hash of new input data of a deterministic node.
+    void updateInputHash(NodeRecord &record,
+                         PortIndex const portIndex,
+                         std::shared_ptr<NodeData> const &data);
+
+    /// Pads the input hashes to the current number of input ports.
+    void resizeInputHashes(NodeRecord &record, std::size_t const size);
+
+    /// Forgets the remembered results and input hashes of a node whose ports changed.
+    void resetResultCache(NodeId const nodeId);
+
+    /// Hands the results back to the delegate and propagates them.
+    /**
+   * Results of a superseded `generation` only clear the busy state.
+   */
+    void onComputeFinished(NodeId const nodeId,
+                           std::uint64_t const generation,
+                           NodeDelegateModel::ComputeResults const &results);
+
+    struct CompletedCompute
+    {
+        NodeId nodeId = InvalidNodeId;
+        std::uint64_t generation = 0;
+        NodeDelegateModel::ComputeResults results;
+    };
+
+    /// Queues the results of a finished job, on the worker thread.
+    /**
+   * Only the first result since the last drain posts an event to the model
+   * thread, so a burst of finished jobs costs one event instead of one each.
+   */
+    void postComputeResult(CompletedCompute completed);
+
+    /// Delivers every queued result through `onComputeFinished()` in one graph batch.
+    void drainComputeResults();
+
 private Q_SLOTS:
     /**
    * Fuction is called in three cases:
@@ -125,11 +924,171 @@ private:
 
     NodeId _nextNodeId;
 
-    std::unordered_map<NodeId, std::unique_ptr<NodeDelegateModel>> _models;
+    /// Dense node storage; iteration order is arbitrary but cache friendly.
+    std::vector<NodeRecord> _nodes;
+
+    /// Position of every node inside `_nodes`.
+    FlatHashMap<NodeId, std::size_t> _nodeIndex;
+
+    FlatHashSet<ConnectionId> _connectivity;
+
+    using PortKey = std::tuple<NodeId, PortType, PortIndex>;
+
+    /// Adjacency index: connections attached to a given node port.
+    std::unordered_map<PortKey, std::unordered_set<ConnectionId>> _portConnections;
+
+    /// Adjacency index: all input and output connections of a given node.
+    std::unordered_map<NodeId, std::unordered_set<ConnectionId>> _nodeConnections;
+
+    std::unordered_map<QString, std::vector<NodeId>> _nodesByType;
+
+    bool _captionIndexEnabled;
+
+    using CaptionIndex = std::multimap<QString, NodeId>;
+
+    /// Case folded captions, updated from const paths decoding pending data.
+    mutable CaptionIndex _captionIndex;
+
+    mutable std::unordered_map<NodeId, CaptionIndex::iterator> _captionEntries;
+
+    /// Interned port data types, filled lazily and dropped when ports change.
+    struct PortTypeIds
+    {
+        std::vector<NodeDataTypeId> in;
+        std::vector<NodeDataTypeId> out;
+    };
+
+    mutable std::unordered_map<NodeId, PortTypeIds> _portTypeIds;
+
+    /// Next free rank of the incremental topological order.
+    std::uint64_t _nextTopologicalRank;
+
+    /// Connections against the topological order, i.e. closing cycles.
+    std::unordered_set<ConnectionId> _unorderedConnections;
+
+    /// Bumped by `invalidateExecutionPlan()`.
+    std::uint64_t _topologyRevision;
+
+    mutable ExecutionPlan _plan;
+
+    PropagationMode _propagationMode;
+
+    /// Output ports updated since the last flush in `Scheduled` mode.
+    std::unordered_map<NodeId, std::unordered_set<PortIndex>> _dirtyOutPorts;
+
+    bool _propagationScheduled;
+
+    bool _propagating;
+
+    /// Milliseconds per queued flush, `0` for no limit.
+    int _propagationBudget;
+
+    std::unordered_set<NodeId> _priorityNodes;
+
+    /// Set by `load()`: connections only mark their source ports dirty.
+    bool _bulkLoading;
+
+    QThreadPool _computePool;
+
+    /// Finished jobs waiting for the model thread.
+    MpscRingBuffer<CompletedCompute> _completedComputes;
+
+    /// Results not fitting into `_completedComputes`, a rare slow path.
+    std::vector<CompletedCompute> _computeOverflow;
+
+    std::mutex _computeOverflowMutex;
+
+    /// Set while a drain event is posted and not yet running.
+    std::atomic<bool> _computeDrainScheduled;
+
+    ComputeResultCache _resultCache;
+
+    std::size_t _delegatePoolCapacity;
+
+    std::unordered_map<QString, std::vector<std::unique_ptr<NodeDelegateModel>>> _delegatePool;
+
+    bool _parallelEvaluation;
+
+    bool _parallelSerialization;
+
+    bool _lazyInternalData;
+
+    bool _saveNodeSizes;
+
+    bool _incrementalSave;
+
+    bool _compactJson;
+
+    /// Connection array of the last `save()`, valid for `_savedConnectionsRevision`.
+    mutable QJsonArray _savedConnections;
+
+    mutable std::uint64_t _savedConnectionsRevision;
+
+    /// See `setNodeUpdateInterval()`.
+    struct UpdateThrottle
+    {
+        int interval = 0;
+
+        /// `_updateClock` time of the last delivery.
+        qint64 lastDelivery = 0;
+
+        /// Ports waiting for the release timer, latest data wins.
+        std::unordered_set<PortIndex> heldPorts;
+    };
+
+    std::unordered_map<NodeId, UpdateThrottle> _updateThrottles;
+
+    QElapsedTimer _updateClock;
+
+    /// Member node -> its evaluation unit.
+    std::unordered_map<NodeId, NodeId> _evaluationUnits;
+
+    /// Set while `propagateInParallel()` runs; `_dirtyOutPorts` is then
+    /// guarded by `_dirtyMutex`.
+    bool _parallelPass;
+
+    std::mutex _dirtyMutex;
+
+    /// Made on first use by parallel evaluation or serialization.
+    mutable std::unique_ptr<WorkStealingExecutor> _executor;
+
+    PropagationTracer *_tracer;
+
+    bool _nodeStatisticsEnabled;
+
+    QElapsedTimer _statisticsClock;
+
+    /// Time spent in `setInData()` calls nested in the one being timed.
+    std::int64_t _nestedEvaluationTime;
+
+    bool _releaseIntermediateData;
+
+    std::size_t _intermediateMemoryBudget;
+
+    double _spillThreshold;
+
+    /// Nesting of `deliverOutPortData()`; delivered nodes are retained at depth 0.
+    int _deliveryDepth;
+
+    std::vector<NodeId> _deliveredNodes;
+
+    /// Intermediate nodes holding their data, least recently delivered first.
+    std::list<NodeId> _retainedOrder;
+
+    struct RetainedNode
+    {
+        std::list<NodeId>::iterator position;
+        std::size_t bytes;
+    };
+
+    std::unordered_map<NodeId, RetainedNode> _retainedNodes;
+
+    std::size_t _retainedBytes;
 
-    std::unordered_set<ConnectionId> _connectivity;
+    /// Set while released nodes are fed again; their updates are not propagated.
+    mutable int _restoringData;
 
-    mutable std::unordered_map<NodeId, NodeGeometryData> _nodeGeometryData;
+    std::unordered_map<NodeId, std::unique_ptr<QTemporaryFile>> _spills;
 };
 
 } // namespace QtNodes
@@ -4,8 +4,16 @@
 #include "DataFlowGraphModel.hpp"
 #include "Export.hpp"
 
+#include <cstdint>
+#include <memory>
+
+class QStandardItemModel;
+
 namespace QtNodes {
 
+class ModelSearchIndex;
+class NodeDelegateModelRegistry;
+
 /// @brief An advanced scene working with data-propagating graphs.
 /**
  * The class represents a scene that existed in v2.x but built wit the
@@ -17,14 +25,27 @@ class NODE_EDITOR_PUBLIC DataFlowGraphicsScene : public BasicGraphicsScene
 public:
     DataFlowGraphicsScene(DataFlowGraphModel &graphModel, QObject *parent = nullptr);
 
-    ~DataFlowGraphicsScene() = default;
+    ~DataFlowGraphicsScene();
 
 public:
     std::vector<NodeId> selectedNodes() const;
 
+    /// Makes the model evaluate the nodes in view, and their inputs, first.
+    /**
+   * The nodes in `visibleSceneRect()` become the priority nodes of the
+   * model whenever the view scrolls or zooms, see
+   * `DataFlowGraphModel::setPriorityNodes()`. Off by default.
+   */
+    void setVisibleFirstEvaluation(bool const enabled);
+
+    bool visibleFirstEvaluation() const { return _visibleFirstEvaluation; }
+
 public:
     QMenu *createSceneMenu(QPointF const scenePos) override;
 
+    /// Adds the entries of the graph model under `model/`.
+    MemoryReport memoryReport() const override;
+
 public Q_SLOTS:
     bool save() const;
 
@@ -33,8 +54,29 @@ public Q_SLOTS:
 Q_SIGNALS:
     void sceneLoaded();
 
+private:
+    /// Rebuilds the cached menu model and search index if the registry changed.
+    void updateMenuModel();
+
+    void updatePriorityNodes();
+
 private:
     DataFlowGraphModel &_graphModel;
+
+    /// Category tree shared by every scene menu, see `updateMenuModel()`.
+    /**
+   * Open menus hold on to the model and index they were built with, a
+   * registry change only replaces them for the next menu.
+   */
+    std::shared_ptr<QStandardItemModel> _menuModel;
+
+    std::shared_ptr<ModelSearchIndex const> _menuIndex;
+
+    NodeDelegateModelRegistry const *_menuRegistry = nullptr;
+
+    std::uint64_t _menuRevision = 0;
+
+    bool _visibleFirstEvaluation = false;
 };
 
 } // namespace QtNodes
@@ -1,9 +1,16 @@
 #pragma once
 
+#include <QtGui/QImage>
 #include <QtGui/QPainter>
 #include <QtGui/QPainterPath>
+#include <QtGui/QPen>
+#include <QtGui/QPixmap>
+#include <QtGui/QPolygonF>
+
+#include <unordered_map>
 
 #include "AbstractConnectionPainter.hpp"
+#include "ConnectionIdHash.hpp"
 #include "Definitions.hpp"
 
 namespace QtNodes {
@@ -11,19 +18,109 @@ namespace QtNodes {
 class ConnectionGeometry;
 class ConnectionGraphicsObject;
 
+/**
+ * Draws connections with a level of detail taken from the painter
+ * transform: connections smaller than a pixel on screen are skipped and the
+ * thresholds of `ConnectionStyle` drop decorations, then curvature.
+ */
 class DefaultConnectionPainter : public AbstractConnectionPainter
 {
 public:
     void paint(QPainter *painter, ConnectionGraphicsObject const &cgo) const override;
     QPainterPath getPainterStroke(ConnectionGraphicsObject const &cgo) const override;
+
+    /// Same as `paint()` for a complete connection, the converter icon included.
+    void paintHeadless(QPainter *painter, ConnectionPaintContext const &context) const override;
 private:
-    QPainterPath cubicPath(ConnectionGraphicsObject const &connection) const;
+    /// `cgo` is null when painting headless.
+    void paintLayers(QPainter *painter,
+                     ConnectionPaintContext const &context,
+                     qreal lod,
+                     ConnectionGraphicsObject const *cgo) const;
+
+    QPainterPath const &cubicPath(ConnectionGraphicsObject const &connection) const;
     void drawSketchLine(QPainter *painter, ConnectionGraphicsObject const &cgo) const;
-    void drawHoveredOrSelected(QPainter *painter, ConnectionGraphicsObject const &cgo) const;
-    void drawNormalLine(QPainter *painter, ConnectionGraphicsObject const &cgo) const;
+    void drawHoveredOrSelected(QPainter *painter, ConnectionPaintContext const &context) const;
+    /// `lod` selects the cubic, a polyline or a straight line, see `ConnectionStyle`.
+    /**
+     * `headless` draws the converter icon from a QImage, which is safe
+     * outside the GUI thread.
+     */
+    void drawNormalLine(QPainter *painter,
+                        ConnectionPaintContext const &context,
+                        qreal lod,
+                        bool headless) const;
+
+    void drawLabel(QPainter *painter, ConnectionPaintContext const &context) const;
+
+    /// `segments + 1` points of the cubic, evaluated directly from its control points.
+    static QPolygonF flattenCubic(ConnectionPaintContext const &context, unsigned int segments);
+
+    /// Even number of segments keeping the flattened cubic smooth at `lod`.
+    /**
+   * About one segment per `8` pixels of the control polygon on screen, which
+   * bounds the curve from above, between `4` and `64`.
+   */
+    static unsigned int cubicSegments(ConnectionPaintContext const &context, qreal const lod);
 #ifdef NODE_DEBUG_DRAWING
     void debugDrawing(QPainter *painter, ConnectionGraphicsObject const &cgo) const;
 #endif
+
+private:
+    /// Everything that decides how a normal connection line looks.
+    struct PenKey
+    {
+        NodeDataTypeId outType;
+        NodeDataTypeId inType;
+        bool selected;
+        bool hasCustomColor;
+        QRgb customColor;
+
+        bool operator==(PenKey const &other) const
+        {
+            return outType == other.outType && inType == other.inType
+                   && selected == other.selected && hasCustomColor == other.hasCustomColor
+                   && customColor == other.customColor;
+        }
+    };
+
+    struct PenKeyHash
+    {
+        std::size_t operator()(PenKey const &key) const
+        {
+            std::size_t h = 0;
+            hash_combine(h, key.outType, key.inType, key.selected, key.customColor);
+            return h;
+        }
+    };
+
+    struct CachedPens
+    {
+        QPen out;
+        QPen in;
+        bool converter; ///< Types differ, line is split and the converter icon drawn.
+    };
+
+    /// Returns the pens for the connection, creating them on first use.
+    CachedPens const &cachedPens(ConnectionPaintContext const &context) const;
+
+    QPixmap const &converterPixmap() const;
+
+    QImage const &converterImage() const;
+
+    /// Drops the cache when painting with other styles than it was filled for.
+    void validateCache(StyleContext const &styles) const;
+
+private:
+    mutable std::unordered_map<PenKey, CachedPens, PenKeyHash> _penCache;
+
+    mutable QPixmap _converterPixmap;
+
+    mutable QImage _converterImage;
+
+    mutable unsigned int _styleRevision = 0;
+
+    mutable bool _cacheValid = false;
 };
 
 } // namespace QtNodes
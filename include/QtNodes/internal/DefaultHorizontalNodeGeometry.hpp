@@ -35,7 +35,25 @@ public:
 
     QRect resizeHandleRect(NodeId const nodeId) const override;
 
+protected:
+    void measureLayout(NodeId const nodeId, NodeLayout &layout) const override;
+
+    void placeLayout(NodeId const nodeId, NodeLayout &layout) const override;
+
 private:
+    /// Works for indices past the measured ports too.
+    QPointF placePort(NodeLayout const &layout,
+                      PortType const portType,
+                      PortIndex const portIndex) const;
+
+    QPointF placePortText(NodeId const nodeId,
+                          NodeLayout const &layout,
+                          PortType const portType,
+                          PortIndex const portIndex,
+                          QRectF const &textRect) const;
+
+    QRectF measureCaptionRect(NodeId const nodeId) const;
+
     QRectF portTextRect(NodeId const nodeId,
                         PortType const portType,
                         PortIndex const portIndex) const;
@@ -54,6 +72,10 @@ private:
     unsigned int _portSpasing;
     mutable QFontMetrics _fontMetrics;
     mutable QFontMetrics _boldFontMetrics;
+
+    /// Labels are measured through `TextCache` with these.
+    QFont _font;
+    QFont _boldFont;
 };
 
 } // namespace QtNodes
@@ -1,10 +1,13 @@
 #pragma once
 
 #include <QtGui/QPainter>
+#include <QtGui/QPixmap>
 
 #include "AbstractNodePainter.hpp"
 #include "Definitions.hpp"
 
+#include <unordered_map>
+
 namespace QtNodes {
 
 class BasicGraphicsScene;
@@ -14,21 +17,87 @@ class NodeGraphicsObject;
 class NodeState;
 
 /// @ Lightweight class incapsulating paint code.
+/**
+ * The level of detail of the painter transform picks what is drawn, with
+ * the thresholds of `NodeStyle`: everything, everything but the texts, a
+ * flat outlined box or a plain filled box.
+ *
+ * With `BasicGraphicsScene::NodeShadowMode::Texture` the shadow is a
+ * blurred rounded rectangle rendered once per color and stretched around
+ * each node as a nine-slice.
+ */
 class NODE_EDITOR_PUBLIC DefaultNodePainter : public AbstractNodePainter
 {
 public:
     void paint(QPainter *painter, NodeGraphicsObject &ngo) const override;
 
+    /// Same as `paint()` without the shadow texture and the drag feedback.
+    void paintHeadless(QPainter *painter, NodePaintContext const &context) const override;
+
+    /// Pre-blurred shadow, kept within the node bounding rectangle.
+    void drawNodeShadow(QPainter *painter, NodeGraphicsObject &ngo) const;
+
     void drawNodeRect(QPainter *painter, NodeGraphicsObject &ngo) const;
 
+    void drawNodeRect(QPainter *painter, NodePaintContext const &context) const;
+
+    /// Single color box with a cosmetic outline, no gradient or rounding.
+    void drawFlatNodeRect(QPainter *painter, NodeGraphicsObject &ngo) const;
+
+    void drawFlatNodeRect(QPainter *painter, NodePaintContext const &context) const;
+
+    /// Filled box without outline for the most distant zoom levels.
+    void drawNodeDot(QPainter *painter, NodeGraphicsObject &ngo) const;
+
+    void drawNodeDot(QPainter *painter, NodePaintContext const &context) const;
+
+    /// Port points, grown or shrunk near a draft connection looking for a port.
     void drawConnectionPoints(QPainter *painter, NodeGraphicsObject &ngo) const;
 
+    void drawConnectionPoints(QPainter *painter, NodePaintContext const &context) const;
+
     void drawFilledConnectionPoints(QPainter *painter, NodeGraphicsObject &ngo) const;
 
+    void drawFilledConnectionPoints(QPainter *painter, NodePaintContext const &context) const;
+
     void drawNodeCaption(QPainter *painter, NodeGraphicsObject &ngo) const;
 
+    void drawNodeCaption(QPainter *painter, NodePaintContext const &context) const;
+
     void drawEntryLabels(QPainter *painter, NodeGraphicsObject &ngo) const;
 
+    void drawEntryLabels(QPainter *painter, NodePaintContext const &context) const;
+
     void drawResizeRect(QPainter *painter, NodeGraphicsObject &ngo) const;
+
+    void drawResizeRect(QPainter *painter, NodePaintContext const &context) const;
+
+    /// Halo showing the compute time, see `BasicGraphicsScene::setComputeHeatScale()`.
+    void drawComputeHeat(QPainter *painter, NodeGraphicsObject &ngo) const;
+
+    void drawComputeHeat(QPainter *painter, NodePaintContext const &context) const;
+
+    /// Dashed outline shown while `NodeRole::Computing` is set.
+    void drawComputingState(QPainter *painter, NodeGraphicsObject &ngo) const;
+
+    void drawComputingState(QPainter *painter, NodePaintContext const &context) const;
+
+private:
+    static NodePaintContext paintContext(NodeGraphicsObject &ngo);
+
+    /// `ngo` is null when painting headless.
+    void paintLayers(QPainter *painter,
+                     NodePaintContext const &context,
+                     NodeGraphicsObject *ngo) const;
+
+    void drawPortPoints(QPainter *painter,
+                        NodePaintContext const &context,
+                        NodeGraphicsObject *ngo) const;
+
+    QPixmap const &shadowTexture(QColor const &color) const;
+
+private:
+    /// Shadow textures by RGBA color, shared by all the nodes of the scene.
+    mutable std::unordered_map<QRgb, QPixmap> _shadowTextures;
 };
 } // namespace QtNodes
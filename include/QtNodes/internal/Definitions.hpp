@@ -14,25 +14,30 @@
 
 namespace QtNodes {
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-NODE_EDITOR_PUBLIC Q_NAMESPACE
+NODE_EDITOR_CORE_PUBLIC Q_NAMESPACE
 #else
-Q_NAMESPACE_EXPORT(NODE_EDITOR_PUBLIC)
+Q_NAMESPACE_EXPORT(NODE_EDITOR_CORE_PUBLIC)
 #endif
 
     /**
  * Constants used for fetching QVariant data from GraphModel.
  */
     enum class NodeRole {
-        Type = 0,           ///< Type of the current node, usually a string.
-        Position = 1,       ///< `QPointF` positon of the node on the scene.
-        Size = 2,           ///< `QSize` for resizable nodes.
-        CaptionVisible = 3, ///< `bool` for caption visibility.
-        Caption = 4,        ///< `QString` for node caption.
-        Style = 5,          ///< Custom NodeStyle as QJsonDocument
-        InternalData = 6,   ///< Node-stecific user data as QJsonObject
-        InPortCount = 7,    ///< `unsigned int`
-        OutPortCount = 9,   ///< `unsigned int`
-        Widget = 10,        ///< Optional `QWidget*` or `nullptr`
+        Type = 0,            ///< Type of the current node, usually a string.
+        Position = 1,        ///< `QPointF` positon of the node on the scene.
+        Size = 2,            ///< `QSize` for resizable nodes.
+        CaptionVisible = 3,  ///< `bool` for caption visibility.
+        Caption = 4,         ///< `QString` for node caption.
+        Style = 5,           ///< Custom NodeStyle as QJsonDocument
+        InternalData = 6,    ///< Node-stecific user data as QJsonObject
+        InPortCount = 7,     ///< `unsigned int`
+        OutPortCount = 9,    ///< `unsigned int`
+        Widget = 10,         ///< Optional `QWidget*` stored as `QObject*`, or `nullptr`
+        StylePtr = 11,       ///< Optional `std::shared_ptr<NodeStyle const>`, faster than `Style`
+        Computing = 12,      ///< `bool`, an asynchronous computation is in flight.
+        WidgetSizeHint = 13, ///< `QSize` of a widget not created yet, invalid otherwise.
+        ComputeTime = 14,    ///< Optional `double`, recent milliseconds per evaluation.
+        LayoutKey = 15,      ///< Optional `quint64` the saved size was measured under.
     };
 Q_ENUM_NS(NodeRole)
 
@@ -58,6 +63,8 @@ enum class PortRole {
     ConnectionPolicyRole = 2, ///< `enum` ConnectionPolicyRole
     CaptionVisible = 3,       ///< `bool` for caption visibility.
     Caption = 4,              ///< `QString` for port caption.
+    DataTypeId = 5,           ///< Optional interned `NodeDataTypeId` of the port data type.
+    Required = 6,             ///< Optional `bool`, the input must be connected.
 };
 Q_ENUM_NS(PortRole)
 
@@ -93,6 +100,12 @@ using NodeId = unsigned int;
 
 static constexpr NodeId InvalidNodeId = std::numeric_limits<NodeId>::max();
 
+/// Interned handle of a `NodeDataType::id`, see NodeDataTypeRegistry.
+using NodeDataTypeId = unsigned int;
+
+/// Handle of the empty type id.
+static constexpr NodeDataTypeId InvalidNodeDataTypeId = 0;
+
 /**
  * A unique connection identificator that stores
  * out `NodeId`, out `PortIndex`, in `NodeId`, in `PortIndex`
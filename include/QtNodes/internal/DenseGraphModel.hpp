@@ -0,0 +1,249 @@
+#pragma once
+
+#include "AbstractGraphModel.hpp"
+#include "Export.hpp"
+#include "FlatHashMap.hpp"
+#include "MemoryReport.hpp"
+
+#include <QtCore/QJsonObject>
+#include <QtCore/QPointF>
+#include <QtCore/QSize>
+#include <QtCore/QString>
+
+#include <cstddef>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace QtNodes {
+
+/**
+ * A plain graph model for large graphs without data propagation.
+ *
+ * Nodes are stored as columns indexed by a dense row: ids, types, captions,
+ * positions, sizes and port counts, each in a vector of its own. Connections
+ * live in a hash set, so `connectionExists()` is O(1), and in compressed
+ * adjacency arrays sorted by node and port, which are rebuilt lazily. The
+ * connections added and deleted since the last rebuild are kept aside until
+ * they outnumber half of the arrays, so editing does not rebuild every time.
+ *
+ * New nodes get one input and one output port. Inputs take one connection,
+ * outputs any number. Subclasses usually override `nodeData()` and
+ * `portData()` for their own roles and call the base for the rest.
+ *
+ * The batch functions open a `GraphTransaction`, change the tables once and
+ * emit the usual per-item signals afterwards.
+ */
+class NODE_EDITOR_CORE_PUBLIC DenseGraphModel : public AbstractGraphModel
+{
+    Q_OBJECT
+
+public:
+    explicit DenseGraphModel(QObject *parent = nullptr);
+
+    ~DenseGraphModel() override;
+
+    /// Reserves the node columns and the connection table for that many more rows.
+    void reserve(std::size_t const nodes, std::size_t const connections) override;
+
+    std::size_t nodeCount() const { return _ids.size(); }
+
+    std::size_t graphConnectionCount() const { return _connections.size(); }
+
+    /// Adds `count` nodes of `nodeType` with the given number of ports.
+    std::vector<NodeId> addNodes(std::size_t const count,
+                                 QString const &nodeType = QString(),
+                                 unsigned int const inPorts = 1,
+                                 unsigned int const outPorts = 1);
+
+    /// Adds the connections that do not exist yet, without checking them.
+    void addConnections(std::vector<ConnectionId> const &connectionIds);
+
+    void deleteConnections(std::vector<ConnectionId> const &connectionIds) override;
+
+    /// Deletes the nodes and all connections attached to them.
+    void deleteNodes(std::vector<NodeId> const &nodeIds) override;
+
+    /// Empties all columns and tables and emits `modelReset`.
+    void clear() override;
+
+    QJsonObject save() const;
+
+    void load(QJsonObject const &json);
+
+    /// Approximate memory of the node columns and connection tables.
+    MemoryReport memoryReport() const;
+
+public:
+    NodeId newNodeId() override { return _nextNodeId++; }
+
+    NodeId reserveNodeIds(std::size_t const count) override;
+
+    std::unordered_set<NodeId> allNodeIds() const override;
+
+    std::unordered_set<ConnectionId> allConnectionIds(NodeId const nodeId) const override;
+
+    std::unordered_set<ConnectionId> connections(NodeId nodeId,
+                                                 PortType portType,
+                                                 PortIndex portIndex) const override;
+
+    void forEachConnection(NodeId nodeId,
+                           PortType portType,
+                           PortIndex portIndex,
+                           ConnectionVisitor const &visitor) const override;
+
+    void forEachNodeConnection(NodeId nodeId, ConnectionVisitor const &visitor) const override;
+
+    void forEachGraphConnection(ConnectionVisitor const &visitor) const override;
+
+    std::size_t connectionCount(NodeId nodeId,
+                                PortType portType,
+                                PortIndex portIndex) const override;
+
+    bool connectionExists(ConnectionId const connectionId) const override;
+
+    NodeId addNode(QString const nodeType = QString()) override;
+
+    /// Both ports exist, the nodes differ and the input is still free.
+    bool connectionPossible(ConnectionId const connectionId) const override;
+
+    void addConnection(ConnectionId const connectionId) override;
+
+    bool nodeExists(NodeId const nodeId) const override;
+
+    QVariant nodeData(NodeId nodeId, NodeRole role) const override;
+
+    /// Walks the position and size columns.
+    void forEachNodeGeometry(NodeGeometryVisitor const &visitor) const override;
+
+    void nodePositions(std::vector<NodeId> const &nodeIds,
+                       std::vector<QPointF> &positions) const override;
+
+    void nodeSizes(std::vector<NodeId> const &nodeIds, std::vector<QSize> &sizes) const override;
+
+    /// Position, size, caption and port counts can be set.
+    /**
+   * Changing a port count goes through `portsAboutToBeDeleted()` or
+   * `portsAboutToBeInserted()`, ports are added and removed at the end.
+   */
+    bool setNodeData(NodeId nodeId, NodeRole role, QVariant value) override;
+
+    void moveNodes(std::vector<NodeId> const &nodeIds, QPointF const &delta) override;
+
+    void setNodePositions(std::vector<std::pair<NodeId, QPointF>> const &positions) override;
+
+    QVariant portData(NodeId nodeId,
+                      PortType portType,
+                      PortIndex portIndex,
+                      PortRole role) const override;
+
+    bool setPortData(NodeId nodeId,
+                     PortType portType,
+                     PortIndex portIndex,
+                     QVariant const &value,
+                     PortRole role = PortRole::Data) override;
+
+    bool deleteConnection(ConnectionId const connectionId) override;
+
+    /// Rewrites the connections in place.
+    void remapConnections(ConnectionRemap const &remap) override;
+
+    bool deleteNode(NodeId const nodeId) override;
+
+    QJsonObject saveNode(NodeId const nodeId) const override;
+
+    void loadNode(QJsonObject const &nodeJson) override;
+
+protected:
+    /// Row of `nodeId` in the node columns, `InvalidRow` for unknown nodes.
+    /**
+   * Rows change when nodes are deleted: the last node moves into the row of
+   * the deleted one.
+   */
+    std::size_t nodeRow(NodeId const nodeId) const;
+
+    static constexpr std::size_t InvalidRow = std::numeric_limits<std::size_t>::max();
+
+private:
+    std::size_t appendRow(NodeId const nodeId,
+                          QString const &nodeType,
+                          unsigned int const inPorts,
+                          unsigned int const outPorts);
+
+    void removeRow(std::size_t const row);
+
+    /// Table updates of `addConnection()` and `deleteConnection()`, without signals.
+    bool insertConnection(ConnectionId const &connectionId);
+
+    bool eraseConnection(ConnectionId const &connectionId);
+
+    bool setPortCount(NodeId const nodeId, PortType const portType, unsigned int const count);
+
+    /// Calls `visitor` for the connections of a port, or of all ports for `InvalidPortIndex`.
+    void visit(NodeId const nodeId,
+               PortType const portType,
+               PortIndex const portIndex,
+               ConnectionVisitor const &visitor) const;
+
+    /// Marks the adjacency arrays stale and drops the changes kept aside.
+    void invalidateAdjacency();
+
+    void updateAdjacency() const;
+
+    /// Rebuilds when the changes kept aside outgrow the arrays.
+    void limitPendingChanges();
+
+private:
+    NodeId _nextNodeId;
+
+    /// Node columns by row.
+    std::vector<NodeId> _ids;
+
+    std::vector<QString> _types;
+
+    std::vector<QString> _captions;
+
+    std::vector<QPointF> _positions;
+
+    std::vector<QSize> _sizes;
+
+    std::vector<unsigned int> _inPortCounts;
+
+    std::vector<unsigned int> _outPortCounts;
+
+    /// Range of the row in the adjacency arrays, `InvalidRow` for nodes added since.
+    mutable std::vector<std::size_t> _adjacencySlots;
+
+    std::unordered_map<NodeId, std::size_t> _rows;
+
+    FlatHashSet<ConnectionId> _connections;
+
+    /// Connections in compressed sparse rows.
+    /**
+   * `first[slot]` to `first[slot + 1]` are the connections of a node sorted
+   * by port index, once by the output and once by the input end.
+   */
+    struct Adjacency
+    {
+        std::vector<std::size_t> outFirst;
+        std::vector<ConnectionId> out;
+
+        std::vector<std::size_t> inFirst;
+        std::vector<ConnectionId> in;
+    };
+
+    mutable Adjacency _adjacency;
+
+    mutable bool _adjacencyStale;
+
+    /// Connections added since the rebuild, by the node of either end.
+    mutable std::unordered_map<NodeId, std::vector<ConnectionId>> _addedConnections;
+
+    mutable std::size_t _addedCount;
+
+    /// Connections still in the arrays although deleted.
+    mutable std::unordered_set<ConnectionId> _deletedConnections;
+};
+
+} // namespace QtNodes
@@ -46,3 +46,14 @@
 #error "Choose whether to link against shared or static."
 #endif
 #endif
+
+// Symbols of the QtNodesCore library, which the widget layer imports.
+#if defined(NODE_EDITOR_SHARED) && !defined(NODE_EDITOR_STATIC)
+#ifdef NODE_EDITOR_CORE_EXPORTS
+#define NODE_EDITOR_CORE_PUBLIC NODE_EDITOR_EXPORT
+#else
+#define NODE_EDITOR_CORE_PUBLIC NODE_EDITOR_IMPORT
+#endif
+#else
+#define NODE_EDITOR_CORE_PUBLIC
+#endif
@@ -0,0 +1,485 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace QtNodes {
+
+namespace detail {
+
+/**
+ * Open-addressing hash table with linear probing, the storage of
+ * FlatHashSet and FlatHashMap.
+ *
+ * All elements live in one array next to one control byte each, so a
+ * lookup touches one or two cache lines and an insertion allocates only
+ * when the table grows. The hash is multiplied by the 64-bit golden ratio
+ * before probing, which spreads even identity hashes of sequential ids.
+ *
+ * Erasing leaves a tombstone: iterators to other elements stay valid and
+ * erasing while iterating is safe. Insertions may rehash and invalidate
+ * all iterators and references.
+ */
+template<typename Value, typename Key, typename KeyOf, typename Hash, typename KeyEqual>
+class FlatHashTable
+{
+public:
+    using key_type = Key;
+    using value_type = Value;
+    using size_type = std::size_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+
+    template<bool Const>
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename FlatHashTable::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, value_type const *, value_type *>;
+        using reference = std::conditional_t<Const, value_type const &, value_type &>;
+
+        using Table = std::conditional_t<Const, FlatHashTable const, FlatHashTable>;
+
+        Iterator() = default;
+
+        Iterator(Table *table, size_type const index)
+            : _table(table)
+            , _index(index)
+        {}
+
+        /// Iterators convert to const iterators.
+        template<bool OtherConst, typename = std::enable_if_t<Const && !OtherConst>>
+        Iterator(Iterator<OtherConst> const &other)
+            : _table(other._table)
+            , _index(other._index)
+        {}
+
+        reference operator*() const { return _table->_slots[_index].value; }
+
+        pointer operator->() const { return &_table->_slots[_index].value; }
+
+        Iterator &operator++()
+        {
+            _index = _table->nextFull(_index + 1);
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(Iterator const &other) const { return _index == other._index; }
+
+        bool operator!=(Iterator const &other) const { return _index != other._index; }
+
+    private:
+        template<bool>
+        friend class Iterator;
+
+        friend class FlatHashTable;
+
+        Table *_table = nullptr;
+        size_type _index = 0;
+    };
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+public:
+    FlatHashTable() = default;
+
+    FlatHashTable(FlatHashTable const &other)
+    {
+        reserve(other._size);
+
+        for (value_type const &value : other) {
+            insertUnique(value);
+        }
+    }
+
+    FlatHashTable(FlatHashTable &&other) noexcept { swap(other); }
+
+    FlatHashTable &operator=(FlatHashTable other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+
+    ~FlatHashTable() { destroyAll(); }
+
+    void swap(FlatHashTable &other) noexcept
+    {
+        std::swap(_slots, other._slots);
+        std::swap(_control, other._control);
+        std::swap(_capacity, other._capacity);
+        std::swap(_size, other._size);
+        std::swap(_tombstones, other._tombstones);
+        std::swap(_shift, other._shift);
+    }
+
+public:
+    iterator begin() { return iterator(this, nextFull(0)); }
+
+    iterator end() { return iterator(this, _capacity); }
+
+    const_iterator begin() const { return const_iterator(this, nextFull(0)); }
+
+    const_iterator end() const { return const_iterator(this, _capacity); }
+
+    const_iterator cbegin() const { return begin(); }
+
+    const_iterator cend() const { return end(); }
+
+    bool empty() const { return _size == 0; }
+
+    size_type size() const { return _size; }
+
+    /// Number of slots, for the memory estimates of MemoryReport.
+    size_type bucket_count() const { return _capacity; }
+
+    /// Destroys all elements and keeps the slots.
+    void clear()
+    {
+        for (size_type i = 0; i < _capacity; ++i) {
+            if (_control[i] == Full)
+                _slots[i].value.~value_type();
+
+            _control[i] = Empty;
+        }
+
+        _size = 0;
+        _tombstones = 0;
+    }
+
+    /// Makes room for `count` elements without rehashing.
+    void reserve(size_type const count)
+    {
+        size_type capacity = MinCapacity;
+
+        while (capacity * MaxLoadNumerator / MaxLoadDenominator < count) {
+            capacity *= 2;
+        }
+
+        if (capacity > _capacity)
+            rehash(capacity);
+    }
+
+    iterator find(key_type const &key) { return iterator(this, findIndex(key)); }
+
+    const_iterator find(key_type const &key) const
+    {
+        return const_iterator(this, findIndex(key));
+    }
+
+    size_type count(key_type const &key) const { return findIndex(key) != _capacity ? 1 : 0; }
+
+    bool contains(key_type const &key) const { return findIndex(key) != _capacity; }
+
+    std::pair<iterator, bool> insert(value_type const &value)
+    {
+        return emplaceWithKey(KeyOf()(value), value);
+    }
+
+    std::pair<iterator, bool> insert(value_type &&value)
+    {
+        key_type const key = KeyOf()(value);
+
+        return emplaceWithKey(key, std::move(value));
+    }
+
+    template<typename InputIt>
+    void insert(InputIt first, InputIt last)
+    {
+        for (; first != last; ++first) {
+            insert(*first);
+        }
+    }
+
+    /// @returns the iterator following `position`.
+    iterator erase(const_iterator position)
+    {
+        size_type const index = position._index;
+
+        _slots[index].value.~value_type();
+        _control[index] = Deleted;
+
+        --_size;
+        ++_tombstones;
+
+        return iterator(this, nextFull(index + 1));
+    }
+
+    size_type erase(key_type const &key)
+    {
+        size_type const index = findIndex(key);
+
+        if (index == _capacity)
+            return 0;
+
+        erase(const_iterator(this, index));
+        return 1;
+    }
+
+protected:
+    /// Inserts `key` constructed from `args` unless it is present.
+    template<typename... Args>
+    std::pair<iterator, bool> emplaceWithKey(key_type const &key, Args &&...args)
+    {
+        size_type const existing = findIndex(key);
+
+        if (existing != _capacity)
+            return {iterator(this, existing), false};
+
+        growIfNeeded();
+
+        size_type const index = freeSlot(key);
+
+        if (_control[index] == Deleted)
+            --_tombstones;
+
+        ::new (static_cast<void *>(&_slots[index].value)) value_type(std::forward<Args>(args)...);
+        _control[index] = Full;
+
+        ++_size;
+
+        return {iterator(this, index), true};
+    }
+
+private:
+    enum Control : std::uint8_t { Empty = 0, Full = 1, Deleted = 2 };
+
+    static constexpr size_type MinCapacity = 16;
+
+    /// Probing sequences get long beyond 3/4 load, tombstones included.
+    static constexpr size_type MaxLoadNumerator = 3;
+    static constexpr size_type MaxLoadDenominator = 4;
+
+    union Slot {
+        Slot() {}
+
+        ~Slot() {}
+
+        value_type value;
+    };
+
+    size_type home(key_type const &key) const
+    {
+        auto const h = static_cast<std::uint64_t>(Hash()(key));
+
+        return static_cast<size_type>((h * 0x9e3779b97f4a7c15ull) >> _shift);
+    }
+
+    /// Index of `key`, `_capacity` if it is absent.
+    size_type findIndex(key_type const &key) const
+    {
+        if (_size == 0)
+            return _capacity;
+
+        size_type const mask = _capacity - 1;
+
+        for (size_type index = home(key);; index = (index + 1) & mask) {
+            std::uint8_t const control = _control[index];
+
+            if (control == Empty)
+                return _capacity;
+
+            if (control == Full && KeyEqual()(KeyOf()(_slots[index].value), key))
+                return index;
+        }
+    }
+
+    /// First empty or deleted slot of the probing sequence of `key`.
+    size_type freeSlot(key_type const &key) const
+    {
+        size_type const mask = _capacity - 1;
+
+        size_type index = home(key);
+
+        while (_control[index] == Full) {
+            index = (index + 1) & mask;
+        }
+
+        return index;
+    }
+
+    size_type nextFull(size_type index) const
+    {
+        while (index < _capacity && _control[index] != Full) {
+            ++index;
+        }
+
+        return index;
+    }
+
+    void growIfNeeded()
+    {
+        if ((_size + _tombstones + 1) * MaxLoadDenominator <= _capacity * MaxLoadNumerator)
+            return;
+
+        // Mostly tombstones: cleaning up in place is enough.
+        bool const crowded = (_size + 1) * 2 * MaxLoadDenominator > _capacity * MaxLoadNumerator;
+
+        rehash(_capacity == 0 ? MinCapacity : (crowded ? _capacity * 2 : _capacity));
+    }
+
+    void rehash(size_type const capacity)
+    {
+        std::unique_ptr<Slot[]> slots(new Slot[capacity]);
+        std::unique_ptr<std::uint8_t[]> control(new std::uint8_t[capacity]());
+
+        std::swap(slots, _slots);
+        std::swap(control, _control);
+
+        size_type const oldCapacity = _capacity;
+
+        _capacity = capacity;
+        _size = 0;
+        _tombstones = 0;
+
+        _shift = 64;
+        for (size_type c = capacity; c > 1; c /= 2) {
+            --_shift;
+        }
+
+        for (size_type i = 0; i < oldCapacity; ++i) {
+            if (control[i] != Full)
+                continue;
+
+            value_type &value = slots[i].value;
+
+            size_type const index = freeSlot(KeyOf()(value));
+
+            ::new (static_cast<void *>(&_slots[index].value)) value_type(std::move(value));
+            _control[index] = Full;
+            ++_size;
+
+            value.~value_type();
+        }
+    }
+
+    /// Inserts a value known to be absent, as when copying.
+    void insertUnique(value_type const &value)
+    {
+        growIfNeeded();
+
+        size_type const index = freeSlot(KeyOf()(value));
+
+        ::new (static_cast<void *>(&_slots[index].value)) value_type(value);
+        _control[index] = Full;
+        ++_size;
+    }
+
+    void destroyAll()
+    {
+        if (!std::is_trivially_destructible<value_type>::value) {
+            for (size_type i = 0; i < _capacity; ++i) {
+                if (_control[i] == Full)
+                    _slots[i].value.~value_type();
+            }
+        }
+    }
+
+private:
+    std::unique_ptr<Slot[]> _slots;
+
+    std::unique_ptr<std::uint8_t[]> _control;
+
+    size_type _capacity = 0;
+
+    size_type _size = 0;
+
+    size_type _tombstones = 0;
+
+    /// `64 - log2(_capacity)`, keeps the high bits of the mixed hash.
+    unsigned int _shift = 64;
+};
+
+struct IdentityKey
+{
+    template<typename T>
+    T const &operator()(T const &value) const
+    {
+        return value;
+    }
+};
+
+struct PairFirstKey
+{
+    template<typename Pair>
+    typename Pair::first_type const &operator()(Pair const &value) const
+    {
+        return value.first;
+    }
+};
+
+} // namespace detail
+
+/// Drop-in for `std::unordered_set` of small keys, see `detail::FlatHashTable`.
+template<typename Key, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class FlatHashSet : public detail::FlatHashTable<Key, Key, detail::IdentityKey, Hash, KeyEqual>
+{
+    using Base = detail::FlatHashTable<Key, Key, detail::IdentityKey, Hash, KeyEqual>;
+
+public:
+    using Base::Base;
+
+    template<typename... Args>
+    std::pair<typename Base::iterator, bool> emplace(Args &&...args)
+    {
+        return Base::insert(Key(std::forward<Args>(args)...));
+    }
+};
+
+/// Drop-in for `std::unordered_map` with small keys, see `detail::FlatHashTable`.
+/**
+ * Unlike `std::unordered_map`, references to values do not survive an
+ * insertion that grows the table.
+ */
+template<typename Key,
+         typename T,
+         typename Hash = std::hash<Key>,
+         typename KeyEqual = std::equal_to<Key>>
+class FlatHashMap : public detail::FlatHashTable<std::pair<Key const, T>,
+                                                 Key,
+                                                 detail::PairFirstKey,
+                                                 Hash,
+                                                 KeyEqual>
+{
+    using Base = detail::
+        FlatHashTable<std::pair<Key const, T>, Key, detail::PairFirstKey, Hash, KeyEqual>;
+
+public:
+    using mapped_type = T;
+
+    using Base::Base;
+
+    template<typename... Args>
+    std::pair<typename Base::iterator, bool> try_emplace(Key const &key, Args &&...args)
+    {
+        return Base::emplaceWithKey(key,
+                                    std::piecewise_construct,
+                                    std::forward_as_tuple(key),
+                                    std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+
+    template<typename M>
+    std::pair<typename Base::iterator, bool> emplace(Key const &key, M &&value)
+    {
+        return try_emplace(key, std::forward<M>(value));
+    }
+
+    T &operator[](Key const &key) { return try_emplace(key).first->second; }
+};
+
+} // namespace QtNodes
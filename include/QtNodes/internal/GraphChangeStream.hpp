@@ -0,0 +1,156 @@
+#pragma once
+
+#include "Definitions.hpp"
+#include "Export.hpp"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QObject>
+#include <QtCore/QPointF>
+
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace QtNodes {
+
+class AbstractGraphModel;
+
+/// One entry of a `GraphChangeStream` packet.
+struct NODE_EDITOR_CORE_PUBLIC GraphChange
+{
+    enum class Type : quint8 {
+        Reset = 0,        ///< Clears the replica, a snapshot follows.
+        CreateNode,       ///< `data` is the compact JSON of `saveNode()`.
+        DeleteNode,       ///< `nodeId` only.
+        MoveNodes,        ///< `positions` of any number of nodes.
+        CreateConnection, ///< `connectionId` only.
+        DeleteConnection, ///< `connectionId` only.
+        InternalData      ///< `data` is the compact JSON of `NodeRole::InternalData`.
+    };
+
+    Type type = Type::Reset;
+
+    NodeId nodeId = InvalidNodeId;
+
+    ConnectionId connectionId{InvalidNodeId, InvalidPortIndex, InvalidNodeId, InvalidPortIndex};
+
+    /// Opaque to the stream, only the replica model interprets it.
+    QByteArray data;
+
+    std::vector<std::pair<NodeId, QPointF>> positions;
+};
+
+/**
+ * Records the changes of a model as compact binary packets for replicas.
+ *
+ * A remote or collaborative view holds its own `AbstractGraphModel` and
+ * keeps it in sync by applying the packets of the original model, so the
+ * traffic grows with the edits and not with the size of the graph:
+ *
+ * ```
+ * GraphChangeStream stream(model);
+ *
+ * connect(&stream, &GraphChangeStream::changesPending, [&]() {
+ *     QTimer::singleShot(20, [&]() { socket.write(stream.takePacket()); });
+ * });
+ *
+ * // On the other side, after `snapshotPacket()` for a late joiner:
+ * GraphChangeStream::apply(replica, packet);
+ * ```
+ *
+ * Moves and internal-data changes of a node until the next `takePacket()`
+ * collapse into one entry, and all moves of a packet share one `MoveNodes`
+ * entry. Internal data is only sent when its bytes changed. Changes made
+ * during a model batch are held back until the batch ends, so a packet
+ * never carries half of a batch.
+ */
+class NODE_EDITOR_CORE_PUBLIC GraphChangeStream : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Starts recording the changes of `model` made from now on.
+    GraphChangeStream(AbstractGraphModel &model, QObject *parent = nullptr);
+
+    ~GraphChangeStream() override;
+
+public:
+    /// Whether `takePacket()` has anything to send.
+    bool hasPendingChanges() const;
+
+    /// Encodes and clears the changes recorded so far.
+    /**
+   * @returns an empty array if nothing changed or a batch is open.
+   */
+    QByteArray takePacket();
+
+    /// A `Reset` followed by the whole graph, which brings a new replica up to date.
+    /**
+   * Pending changes stay pending, the replica applies them like everyone else.
+   */
+    QByteArray snapshotPacket() const;
+
+public:
+    static QByteArray encode(std::vector<GraphChange> const &changes);
+
+    /// @returns `false` for a foreign or truncated packet, leaving `changes` empty.
+    static bool decode(QByteArray const &packet, std::vector<GraphChange> &changes);
+
+    /// Applies the changes to `replica` in one batch.
+    /**
+   * Nodes are restored with `loadNode()` and internal data is handed to
+   * `setNodeData()` with `NodeRole::InternalData`. Changes that no longer
+   * fit the replica, such as connections to missing nodes, are skipped.
+   */
+    static void apply(AbstractGraphModel &replica, std::vector<GraphChange> const &changes);
+
+    /// @returns `false`, applying nothing, if the packet cannot be decoded.
+    static bool apply(AbstractGraphModel &replica, QByteArray const &packet);
+
+Q_SIGNALS:
+    /// The first change since the last `takePacket()` was recorded.
+    void changesPending();
+
+private:
+    std::vector<GraphChange> snapshotChanges() const;
+
+    void append(GraphChange change);
+
+    /// Records the nodes created since the previous change.
+    /**
+   * The model may load the delegate after announcing the node, so the node
+   * is only saved once another change, a packet or the end of the model
+   * batch follows.
+   */
+    void writeCreatedNodes();
+
+    void writeCoalescedUpdates();
+
+    /// Compact JSON of `NodeRole::InternalData`, empty if the model has none.
+    QByteArray internalData(NodeId const nodeId) const;
+
+    void notifyPending();
+
+private:
+    AbstractGraphModel &_model;
+
+    std::vector<GraphChange> _changes;
+
+    std::vector<NodeId> _createdNodes;
+
+    /// Changes of an open model batch, recorded after its created nodes.
+    std::vector<GraphChange> _batchChanges;
+
+    std::unordered_set<NodeId> _movedNodes;
+
+    std::unordered_set<NodeId> _changedNodes;
+
+    /// Hash of the internal data each node was last sent with.
+    std::unordered_map<NodeId, std::size_t> _sentData;
+
+    bool _pendingSignalled;
+};
+
+} // namespace QtNodes
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "ConnectionIdHash.hpp"
+#include "Definitions.hpp"
+#include "Export.hpp"
+#include "GraphChangeStream.hpp"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QPointF>
+#include <QtCore/QString>
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace QtNodes {
+
+class AbstractGraphModel;
+
+/**
+ * Structural diff and three-way merge of graphs, by node id.
+ *
+ * Graphs are compared as `State`s taken from a model or from the JSON of
+ * `save()`, e.g. three revisions of a project under version control. A
+ * node is matched by its id and compared by type, position and a hash of
+ * its internal data, so the work is a few hash lookups per node and
+ * connection, whatever the nesting of the JSON.
+ *
+ * The results are `GraphChange` lists as recorded by GraphChangeStream:
+ * `GraphChangeStream::apply()` turns the first state into the second, and
+ * a pair of opposite diffs makes an ApplyChangesCommand for the undo stack.
+ */
+class NODE_EDITOR_CORE_PUBLIC GraphDiff
+{
+public:
+    /// The compared part of a graph.
+    class NODE_EDITOR_CORE_PUBLIC State
+    {
+    public:
+        struct Node
+        {
+            QString type;
+
+            QPointF position;
+
+            /// Compact JSON of `NodeRole::InternalData`, and its hash.
+            QByteArray content;
+
+            uint contentHash = 0;
+
+            /// The `saveNode()` JSON, restored when the node has to be created.
+            QJsonObject json;
+        };
+
+    public:
+        /// Reads every node with `saveNode()` and every connection.
+        static State capture(AbstractGraphModel const &model);
+
+        /// Reads the `{"nodes": [...], "connections": [...]}` JSON of `save()`.
+        static State fromJson(QJsonObject const &sceneJson);
+
+        /// Adds or replaces a node from its `saveNode()` JSON; the type defaults to the model name.
+        void insertNode(QJsonObject const &nodeJson, QString type = QString());
+
+        void insertConnection(ConnectionId const &connectionId) { connections.insert(connectionId); }
+
+    public:
+        std::unordered_map<NodeId, Node> nodes;
+
+        std::unordered_set<ConnectionId> connections;
+    };
+
+    struct Conflict
+    {
+        enum class Kind {
+            Content,          ///< Both changed the type or internal data of the node.
+            Position,         ///< Both moved the node to different places.
+            ModifiedDeleted,  ///< Ours changed the node, theirs deleted it.
+            DeletedModified,  ///< Ours deleted the node, theirs changed it.
+            AddedBoth,        ///< Both added different nodes with the same id.
+            Connection        ///< A new connection lost a node, or both sides connected its input.
+        };
+
+        Kind kind;
+
+        NodeId nodeId = InvalidNodeId;
+
+        ConnectionId connectionId{InvalidNodeId, InvalidPortIndex, InvalidNodeId, InvalidPortIndex};
+    };
+
+    struct MergeResult
+    {
+        /// Turns `ours` into the merged graph.
+        std::vector<GraphChange> changes;
+
+        /// Every conflict is resolved in favor of `ours`.
+        std::vector<Conflict> conflicts;
+    };
+
+public:
+    /// The changes turning `from` into `to`.
+    /**
+   * Connections are deleted first, then nodes; nodes are created, updated
+   * and moved, then connections created. A node whose type changed is
+   * deleted and created again. Ids are in ascending order within each part,
+   * so equal inputs give equal outputs.
+   */
+    static std::vector<GraphChange> diff(State const &from, State const &to);
+
+    /// Merges the changes from `base` to `theirs` into `ours`.
+    static MergeResult merge(State const &base, State const &ours, State const &theirs);
+
+    /// The merged graph itself, e.g. to diff it against other states.
+    static State mergedState(State const &base,
+                             State const &ours,
+                             State const &theirs,
+                             std::vector<Conflict> *conflicts = nullptr);
+};
+
+} // namespace QtNodes
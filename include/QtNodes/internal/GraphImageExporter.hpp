@@ -0,0 +1,128 @@
+#pragma once
+
+#include "Definitions.hpp"
+#include "Export.hpp"
+#include "StyleContext.hpp"
+
+#include <QtCore/QRectF>
+#include <QtGui/QColor>
+#include <QtGui/QImage>
+
+#include <memory>
+
+class QPainter;
+
+namespace QtNodes {
+
+class AbstractConnectionPainter;
+class AbstractGraphModel;
+class AbstractNodeGeometry;
+class AbstractNodePainter;
+
+/**
+ * Paints a graph model into an image or any other paint device, no scene needed.
+ *
+ * Nodes and connections are painted straight from the model and the node
+ * geometry with `AbstractNodePainter::paintHeadless()` and
+ * `AbstractConnectionPainter::paintHeadless()`. No graphics items, embedded
+ * widgets or shadow effects are created, which makes thumbnails of many
+ * files far cheaper than populating a `BasicGraphicsScene` and rendering it.
+ * SVG files come from a `QPainter` on a `QSvgGenerator`:
+ *
+ * ```
+ * DataFlowGraphModel model(registry);
+ * model.load(json);
+ *
+ * DefaultHorizontalNodeGeometry geometry(model);
+ * GraphImageExporter exporter(model, geometry);
+ *
+ * exporter.toImage(2.0).save("graph.png");
+ *
+ * QSvgGenerator svg;
+ * svg.setFileName("graph.svg");
+ * svg.setViewBox(exporter.sceneRect());
+ *
+ * QPainter painter(&svg);
+ * exporter.render(&painter);
+ * ```
+ *
+ * Exporters of different models may run in parallel on worker threads,
+ * each with its own geometry and painters. Measuring the nodes there must
+ * not create widgets: delegates with embedded widgets have to report their
+ * size with `NodeDelegateModel::embeddedWidgetSizeHint()`. The exporter
+ * paints with the `StyleContext` current when it was created, so a theme
+ * change on the main thread does not reach an export halfway through.
+ */
+class NODE_EDITOR_PUBLIC GraphImageExporter
+{
+public:
+    /// Measures the nodes, see `measureNodes()`.
+    GraphImageExporter(AbstractGraphModel &model,
+                       AbstractNodeGeometry &geometry,
+                       Qt::Orientation const orientation = Qt::Horizontal);
+
+    ~GraphImageExporter();
+
+    void setNodePainter(std::unique_ptr<AbstractNodePainter> newPainter);
+
+    void setConnectionPainter(std::unique_ptr<AbstractConnectionPainter> newPainter);
+
+    /// Paints with `context`, `nullptr` for the current one of `StyleCollection`.
+    /**
+   * Resets the background color to the one of the context. The geometry is
+   * not changed, see `AbstractNodeGeometry::setStyleContext()`.
+   */
+    void setStyleContext(std::shared_ptr<StyleContext const> context);
+
+    StyleContext const &styleContext() const { return *_styleContext; }
+
+    /// Space around the nodes in `sceneRect()`, in scene units.
+    void setMargin(qreal const margin) { _margin = margin; }
+
+    qreal margin() const { return _margin; }
+
+    /// Fills `sceneRect()` before painting; a transparent color leaves it empty.
+    /**
+   * Defaults to the background of the `GraphicsViewStyle`.
+   */
+    void setBackgroundColor(QColor const &color) { _backgroundColor = color; }
+
+    QColor backgroundColor() const { return _backgroundColor; }
+
+    /// Recomputes the sizes of all nodes, as a scene does when creating its items.
+    /**
+   * Call it again after nodes have been added or changed.
+   */
+    void measureNodes();
+
+    /// Bounds of all nodes plus the margin, in scene coordinates.
+    QRectF sceneRect() const;
+
+    /// Paints the background, the connections and the nodes in scene coordinates.
+    void render(QPainter *painter) const;
+
+    /// Paints `sceneRect()` scaled into `target`, keeping the aspect ratio.
+    void render(QPainter *painter, QRectF const &target) const;
+
+    /// The scene rectangle at `scale` device pixels per scene unit.
+    QImage toImage(qreal const scale = 1.0) const;
+
+private:
+    AbstractGraphModel &_model;
+
+    AbstractNodeGeometry &_geometry;
+
+    Qt::Orientation _orientation;
+
+    std::unique_ptr<AbstractNodePainter> _nodePainter;
+
+    std::unique_ptr<AbstractConnectionPainter> _connectionPainter;
+
+    std::shared_ptr<StyleContext const> _styleContext;
+
+    qreal _margin = 20.0;
+
+    QColor _backgroundColor;
+};
+
+} // namespace QtNodes
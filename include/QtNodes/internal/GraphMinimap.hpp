@@ -0,0 +1,127 @@
+#pragma once
+
+#include "Definitions.hpp"
+#include "Export.hpp"
+#include "SceneSpatialIndex.hpp"
+
+#include <QtCore/QMetaObject>
+#include <QtCore/QPointer>
+#include <QtCore/QRectF>
+#include <QtGui/QColor>
+#include <QtGui/QImage>
+#include <QtGui/QRegion>
+#include <QtGui/QTransform>
+#include <QtWidgets/QWidget>
+
+#include <functional>
+#include <vector>
+
+namespace QtNodes {
+
+class BasicGraphicsScene;
+class GraphicsView;
+struct GraphChangeSet;
+
+/**
+ * An overview of the scene shown by a `GraphicsView`, for navigating large graphs.
+ *
+ * Nodes are drawn as plain rectangles from their model positions and
+ * `AbstractNodeGeometry::size()` into a cached image. No graphics items are
+ * created, so the nodes a virtualized scene has released show up as well.
+ *
+ * Creating, moving and deleting nodes only repaints the parts of the image
+ * they covered. The whole image is drawn again when the widget is resized,
+ * the model is reset or a node leaves the area shown so far.
+ *
+ * The visible area of the view is framed on top of the image; clicking or
+ * dragging centers the view on that point.
+ */
+class NODE_EDITOR_PUBLIC GraphMinimap : public QWidget
+{
+    Q_OBJECT
+
+public:
+    using NodeColor = std::function<QColor(NodeId)>;
+
+    explicit GraphMinimap(QWidget *parent = nullptr);
+
+    ~GraphMinimap() override;
+
+    /// Follows `view` and its scene; call it again when the view gets another scene.
+    void setView(GraphicsView *view);
+
+    GraphicsView *view() const { return _view; }
+
+    /// Fill of the node rectangles, `NodeStyle::GradientColor1` for all by default.
+    /**
+   * Called for every node drawn, so it should not do more than a lookup.
+   */
+    void setNodeColor(NodeColor nodeColor);
+
+    QSize sizeHint() const override;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+    void resizeEvent(QResizeEvent *event) override;
+
+    void mousePressEvent(QMouseEvent *event) override;
+
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+    /// Repaints the frame when the viewport of the view is resized.
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    bool batching() const;
+
+    /// Reads the rectangles of all nodes and draws the image again.
+    void reindex();
+
+    /// Stores the current rectangle of the node, the old and the new one get repainted.
+    void updateNode(NodeId const nodeId);
+
+    void removeNode(NodeId const nodeId);
+
+    void applyChanges(GraphChangeSet const &changes);
+
+    void markDirty(QRectF const &sceneRect);
+
+    /// Fits the node bounds into the widget and draws the whole image.
+    void renderAll();
+
+    /// Draws the nodes within `area`, in widget coordinates.
+    void render(QRect const &area);
+
+    void centerView(QPoint const &position);
+
+private:
+    QPointer<GraphicsView> _view;
+
+    QPointer<BasicGraphicsScene> _scene;
+
+    std::vector<QMetaObject::Connection> _connections;
+
+    NodeColor _nodeColor;
+
+    /// Scene rectangles of the nodes.
+    UniformGridIndex<NodeId> _index;
+
+    /// Union of the node rectangles since the last `reindex()`.
+    QRectF _bounds;
+
+    /// Scene area covered by the image.
+    QRectF _shownRect;
+
+    /// Maps `_shownRect` onto the widget.
+    QTransform _toWidget;
+
+    QImage _image;
+
+    bool _imageStale;
+
+    /// Widget areas to repaint before the next frame.
+    QRegion _dirty;
+};
+
+} // namespace QtNodes
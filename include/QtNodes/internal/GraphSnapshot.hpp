@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Definitions.hpp"
+#include "Export.hpp"
+
+#include <QtCore/QPointF>
+#include <QtCore/QSize>
+#include <QtCore/QString>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace QtNodes {
+
+class AbstractGraphModel;
+
+/**
+ * An immutable copy of the graph topology, node types and geometry.
+ *
+ * Snapshots come from `AbstractGraphModel::snapshot()` on the thread owning
+ * the model. They share their node and connection tables with the model
+ * until it changes them, so taking one without intermediate edits is free,
+ * and a move only rebuilds the node table. A snapshot is never modified;
+ * any number of threads may read and copy it without locking.
+ */
+class NODE_EDITOR_CORE_PUBLIC GraphSnapshot
+{
+public:
+    struct Node
+    {
+        NodeId id;
+        QString type;
+        QPointF position;
+        QSize size;
+    };
+
+    /// Nodes sorted by id.
+    struct NodeTable
+    {
+        std::vector<Node> nodes;
+    };
+
+    struct ConnectionTable
+    {
+        /// Sorted by `ConnectionId::operator<`, i.e. grouped by output node.
+        std::vector<ConnectionId> byOutNode;
+
+        /// The same connections grouped by input node.
+        std::vector<ConnectionId> byInNode;
+    };
+
+    using ConnectionRange = std::pair<std::vector<ConnectionId>::const_iterator,
+                                      std::vector<ConnectionId>::const_iterator>;
+
+public:
+    /// An empty graph.
+    GraphSnapshot();
+
+    GraphSnapshot(std::shared_ptr<NodeTable const> nodes,
+                  std::shared_ptr<ConnectionTable const> connections);
+
+    /// Reads a full node table from `model`.
+    static std::shared_ptr<NodeTable const> makeNodeTable(AbstractGraphModel const &model);
+
+    /// Reads a full connection table from `model`.
+    static std::shared_ptr<ConnectionTable const> makeConnectionTable(
+        AbstractGraphModel const &model);
+
+public:
+    std::vector<Node> const &nodes() const { return _nodes->nodes; }
+
+    /// All connections, sorted.
+    std::vector<ConnectionId> const &connections() const { return _connections->byOutNode; }
+
+    bool nodeExists(NodeId const nodeId) const { return node(nodeId) != nullptr; }
+
+    /// @returns `nullptr` for an unknown node.
+    Node const *node(NodeId const nodeId) const;
+
+    bool connectionExists(ConnectionId const connectionId) const;
+
+    /// Connections leaving `nodeId` (`PortType::Out`) or entering it (`PortType::In`).
+    ConnectionRange connections(NodeId const nodeId, PortType const portType) const;
+
+    /// The tables are shared by every copy; equal pointers mean equal contents.
+    std::shared_ptr<NodeTable const> const &nodeTable() const { return _nodes; }
+
+    std::shared_ptr<ConnectionTable const> const &connectionTable() const { return _connections; }
+
+private:
+    std::shared_ptr<NodeTable const> _nodes;
+
+    std::shared_ptr<ConnectionTable const> _connections;
+};
+
+} // namespace QtNodes
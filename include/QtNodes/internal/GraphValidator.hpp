@@ -0,0 +1,149 @@
+#pragma once
+
+#include "Definitions.hpp"
+#include "Export.hpp"
+#include "GraphSnapshot.hpp"
+
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QThreadPool>
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace QtNodes {
+
+class AbstractGraphModel;
+
+/**
+ * Checks a whole graph for problems on worker threads.
+ *
+ * `start()` takes a `GraphSnapshot` and the port tables of all nodes on the
+ * thread owning the model, which is all the editor waits for. Worker tasks
+ * then check chunks of connections and nodes in parallel and report what
+ * they find through `diagnosticsFound()` as each chunk completes:
+ *
+ * - connections to missing nodes or ports, and between different data types;
+ * - ports with `ConnectionPolicy::One` holding several connections, as
+ *   left by merging graphs;
+ * - inputs reporting `PortRole::Required` without a connection;
+ * - cycles, once per set of nodes depending on each other.
+ *
+ * Port tables of delegates with static ports (see
+ * `NodeDelegateModel::portTable()`) are read once per delegate type.
+ */
+class NODE_EDITOR_CORE_PUBLIC GraphValidator : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Diagnostic
+    {
+        enum class Kind {
+            DanglingConnection,
+            TypeMismatch,
+            PolicyViolation,
+            MissingInput,
+            Cycle
+        };
+
+        Kind kind = Kind::DanglingConnection;
+
+        /// The node at fault; the input node for connections.
+        NodeId nodeId = InvalidNodeId;
+
+        PortType portType = PortType::None;
+
+        PortIndex portIndex = InvalidPortIndex;
+
+        /// Set for connection diagnostics only.
+        ConnectionId connectionId{InvalidNodeId, InvalidPortIndex, InvalidNodeId, InvalidPortIndex};
+
+        /// Other members of the cycle, `nodeId` included.
+        std::vector<NodeId> cycle;
+
+        QString message;
+    };
+
+    struct PortInfo
+    {
+        NodeDataTypeId typeId = InvalidNodeDataTypeId;
+        ConnectionPolicy policy = ConnectionPolicy::One;
+        bool required = false;
+    };
+
+    struct NodePorts
+    {
+        std::vector<PortInfo> in;
+        std::vector<PortInfo> out;
+
+        std::vector<PortInfo> const &ports(PortType const portType) const
+        {
+            return portType == PortType::In ? in : out;
+        }
+    };
+
+    /// Port tables per node; nodes of one static delegate type share theirs.
+    using PortTables = std::unordered_map<NodeId, std::shared_ptr<NodePorts const>>;
+
+public:
+    GraphValidator(AbstractGraphModel const &model, QObject *parent = nullptr);
+
+    /// Cancels the running validation and waits for its tasks.
+    ~GraphValidator() override;
+
+    /// Connections or nodes checked by one task.
+    std::size_t chunkSize() const { return _chunkSize; }
+
+    void setChunkSize(std::size_t const items) { _chunkSize = items > 0 ? items : 1; }
+
+    /// Starts validating the current graph, cancelling the run in progress.
+    void start();
+
+    /// Drops the results still to come; `finished()` is not emitted.
+    void cancel();
+
+    bool isRunning() const { return _pendingChunks > 0; }
+
+    /// Everything reported by the current or latest run so far.
+    std::vector<Diagnostic> const &diagnostics() const { return _diagnostics; }
+
+public:
+    /// Reads the ports of every node of `model`, on its thread.
+    static PortTables capturePorts(AbstractGraphModel const &model, GraphSnapshot const &snapshot);
+
+    /// The whole validation on the calling thread, for tools and tests.
+    static std::vector<Diagnostic> validate(GraphSnapshot const &snapshot,
+                                            PortTables const &ports);
+
+Q_SIGNALS:
+    /// Results of one chunk of the current run.
+    void diagnosticsFound(std::vector<QtNodes::GraphValidator::Diagnostic> const &diagnostics);
+
+    /// The last chunk of the run has reported.
+    void finished();
+
+private:
+    struct Job;
+
+    void onChunkFinished(std::shared_ptr<Job const> const &job,
+                         std::vector<Diagnostic> diagnostics);
+
+private:
+    AbstractGraphModel const &_model;
+
+    std::size_t _chunkSize;
+
+    /// The current run, chunks of older ones are ignored.
+    std::shared_ptr<Job const> _job;
+
+    std::size_t _pendingChunks;
+
+    std::vector<Diagnostic> _diagnostics;
+
+    QThreadPool _pool;
+};
+
+} // namespace QtNodes
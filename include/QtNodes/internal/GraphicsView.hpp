@@ -1,8 +1,13 @@
 #pragma once
 
+#include <QtGui/QPixmap>
 #include <QtWidgets/QGraphicsView>
 
 #include "Export.hpp"
+#include "PaintStatistics.hpp"
+
+#include <cstdint>
+#include <memory>
 
 namespace QtNodes {
 
@@ -21,6 +26,30 @@ public:
         double maximum = 0;
     };
 
+    /// How the viewport update mode is chosen.
+    enum class ViewportUpdatePolicy {
+        Fixed,   ///< Keeps the mode set with `setViewportUpdateMode()` (default).
+        Adaptive ///< Picks smart or full updates from the dirty area of the last frame.
+    };
+
+    /// Counters of the adaptive policy, reset with `resetViewportUpdateStatistics()`.
+    struct ViewportUpdateStatistics
+    {
+        /// Scene change notifications, roughly one per painted frame.
+        std::uint64_t frames = 0;
+
+        /// Frames after which a full viewport update was chosen.
+        std::uint64_t fullUpdateFrames = 0;
+
+        /// Dirty share of the viewport in the last frame, 0 to 1.
+        double lastCoverage = 0;
+
+        int lastDirtyRectCount = 0;
+
+        /// Exponential moving average of `lastCoverage`.
+        double averageCoverage = 0;
+    };
+
 public:
     GraphicsView(QWidget *parent = Q_NULLPTR);
     GraphicsView(BasicGraphicsScene *scene, QWidget *parent = Q_NULLPTR);
@@ -43,6 +72,51 @@ public:
 
     double getScale() const;
 
+    /// Renders through a `QOpenGLWidget` viewport instead of the raster engine.
+    /**
+   * The whole viewport is repainted on every update, which is what the GPU
+   * is good at and avoids tracking dirty regions of thousands of items.
+   * `samples` sets the multisampling of the surface. Off by default.
+   */
+    void setOpenGLViewport(bool const enabled, int const samples = 4);
+
+    bool openGLViewport() const;
+
+    /// With `Adaptive`, a frame dirtying more than half of the viewport, or
+    /// many scattered rectangles, makes the next one a full update; smaller
+    /// changes go back to smart updates. The OpenGL viewport always updates fully.
+    void setViewportUpdatePolicy(ViewportUpdatePolicy const policy);
+
+    ViewportUpdatePolicy viewportUpdatePolicy() const { return _viewportUpdatePolicy; }
+
+    ViewportUpdateStatistics const &viewportUpdateStatistics() const
+    {
+        return _viewportUpdateStatistics;
+    }
+
+    void resetViewportUpdateStatistics();
+
+    /// Collects frame times and paint counts, see `PaintStatistics`.
+    /**
+   * Disabling drops the collected data. The overlay prints the summary of
+   * the last frame in the top left corner of the viewport.
+   */
+    void setPaintStatisticsEnabled(bool const enabled, bool const overlay = false);
+
+    /// @returns `nullptr` unless statistics are enabled.
+    PaintStatistics const *paintStatistics() const { return _paintStatistics.get(); }
+
+    bool paintStatisticsOverlay() const { return _paintStatisticsOverlay; }
+
+    /// Colors the nodes by compute time, red from one 60 Hz frame on.
+    /**
+   * Sets `BasicGraphicsScene::setComputeHeatScale()` and turns on the node
+   * statistics of a `DataFlowGraphModel`. Disabling leaves the statistics on.
+   */
+    void setComputeHeatMapEnabled(bool const enabled);
+
+    bool computeHeatMapEnabled() const;
+
 public Q_SLOTS:
     void scaleUp();
 
@@ -74,16 +148,37 @@ protected:
 
     void mouseMoveEvent(QMouseEvent *event) override;
 
+    /// Fills the area with a tiled grid brush, a few draw calls at any zoom.
     void drawBackground(QPainter *painter, const QRectF &r) override;
 
+    /// Draws the paint statistics overlay on top of the scene.
+    void drawForeground(QPainter *painter, const QRectF &r) override;
+
+    /// Activates the paint statistics of the view and times its frames.
+    bool viewportEvent(QEvent *event) override;
+
     void showEvent(QShowEvent *event) override;
 
+    void resizeEvent(QResizeEvent *event) override;
+
+    void scrollContentsBy(int dx, int dy) override;
+
 protected:
     BasicGraphicsScene *nodeScene();
 
     /// Computes scene position for pasting the copied/duplicated node groups.
     QPointF scenePastePosition();
 
+    /// Reports the visible scene area to a virtualized scene.
+    void updateVisibleSceneRect();
+
+    /// Measures the changed scene areas and picks the next update mode.
+    void onSceneChanged(QList<QRectF> const &region);
+
+private:
+    /// One coarse grid cell, rendered again when the device scale or the style changes.
+    QPixmap const &gridTile(qreal const deviceScale);
+
 private:
     QAction *_clearSelectionAction = nullptr;
     QAction *_deleteSelectionAction = nullptr;
@@ -91,7 +186,20 @@ private:
     QAction *_copySelectionAction = nullptr;
     QAction *_pasteAction = nullptr;
 
-    QPointF _clickPos;
+    /// Viewport position of the last right-button pan step.
+    QPoint _panPos;
     ScaleRange _scaleRange;
+
+    QPixmap _gridTile;
+    qreal _gridTileScale = 0.0;
+    unsigned int _gridTileStyleRevision = 0;
+
+    ViewportUpdatePolicy _viewportUpdatePolicy = ViewportUpdatePolicy::Fixed;
+    ViewportUpdateStatistics _viewportUpdateStatistics;
+    QMetaObject::Connection _sceneChangedConnection;
+
+    std::unique_ptr<PaintStatistics> _paintStatistics;
+    bool _paintStatisticsOverlay = false;
+    QRect _paintStatisticsOverlayRect;
 };
 } // namespace QtNodes
@@ -7,13 +7,16 @@
 
 namespace QtNodes {
 
-class NODE_EDITOR_PUBLIC GraphicsViewStyle : public Style
+class NODE_EDITOR_CORE_PUBLIC GraphicsViewStyle : public Style
 {
 public:
+    /// A copy of the default style, parsed once from the resources.
     GraphicsViewStyle();
 
     GraphicsViewStyle(QString jsonText);
 
+    GraphicsViewStyle(QJsonObject const &json);
+
     ~GraphicsViewStyle() = default;
 
 public:
@@ -28,5 +31,8 @@ public:
     QColor BackgroundColor;
     QColor FineGridColor;
     QColor CoarseGridColor;
+
+private:
+    static GraphicsViewStyle const &defaultStyle();
 };
 } // namespace QtNodes
@@ -0,0 +1,249 @@
+#pragma once
+
+#include "AbstractGraphModel.hpp"
+#include "Export.hpp"
+
+#include <QtCore/QJsonObject>
+#include <QtCore/QPointF>
+#include <QtCore/QSize>
+#include <QtCore/QString>
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace QtNodes {
+
+/**
+ * A view of another graph model in which node groups collapse into one node.
+ *
+ * A scene built on the grouped model sees a collapsed group as a single node
+ * whose ports are the member ports connected across the group boundary. The
+ * members and the connections among them are hidden, so the scene creates no
+ * graphics objects for them at all; connections to the outside attach to the
+ * ports of the group. Everything else is forwarded to the source model,
+ * which keeps the flat graph and does the actual work.
+ *
+ * Over a `DataFlowGraphModel` every collapsed group is also registered as an
+ * evaluation unit, see `DataFlowGraphModel::setEvaluationUnit()`.
+ *
+ * ```
+ * GroupedGraphModel grouped(dataFlowModel);
+ * BasicGraphicsScene scene(grouped);
+ *
+ * NodeId const groupId = grouped.collapse(scene.selectedNodeIds(), "Filter chain");
+ * grouped.expand(groupId);
+ * ```
+ *
+ * The group ports are fixed when collapsing. Connecting another member port
+ * in the source appends a port; the port of a deleted member stays as an
+ * empty slot until the group is expanded, so no connection is renumbered.
+ * Groups are a state of this view: the source saves the flat graph.
+ */
+class NODE_EDITOR_CORE_PUBLIC GroupedGraphModel : public AbstractGraphModel
+{
+    Q_OBJECT
+
+public:
+    explicit GroupedGraphModel(AbstractGraphModel &sourceModel, QObject *parent = nullptr);
+
+    ~GroupedGraphModel() override;
+
+    AbstractGraphModel &sourceModel() { return _source; }
+
+    /// Hides `nodeIds` behind a new group node placed at their top left corner.
+    /**
+   * Unknown nodes, hidden nodes and groups are skipped.
+   * @returns the id of the group, `InvalidNodeId` if no node was left.
+   */
+    NodeId collapse(std::unordered_set<NodeId> const &nodeIds, QString const &caption = QString());
+
+    /// Shows the members of the group again, moved along with the group.
+    /**
+   * @returns the former members, empty for an unknown group.
+   */
+    std::unordered_set<NodeId> expand(NodeId const groupId);
+
+    bool isGroup(NodeId const nodeId) const { return _groups.count(nodeId) > 0; }
+
+    /// @returns an empty set for nodes that are not groups.
+    std::unordered_set<NodeId> groupMembers(NodeId const groupId) const;
+
+    /// The group hiding the source node, `InvalidNodeId` if it is visible.
+    NodeId groupOf(NodeId const sourceNodeId) const;
+
+    /// The source port behind a port of the grouped model.
+    /**
+   * Ports of visible nodes map to themselves; an empty slot of a group
+   * maps to `InvalidNodeId`.
+   */
+    std::pair<NodeId, PortIndex> sourcePort(NodeId const nodeId,
+                                            PortType const portType,
+                                            PortIndex const portIndex) const;
+
+public:
+    NodeId newNodeId() override;
+
+    NodeId reserveNodeIds(std::size_t const count) override;
+
+    void reserve(std::size_t const nodes, std::size_t const connections) override;
+
+    std::unordered_set<NodeId> allNodeIds() const override;
+
+    std::unordered_set<ConnectionId> allConnectionIds(NodeId const nodeId) const override;
+
+    std::unordered_set<ConnectionId> connections(NodeId nodeId,
+                                                 PortType portType,
+                                                 PortIndex portIndex) const override;
+
+    bool connectionExists(ConnectionId const connectionId) const override;
+
+    NodeId addNode(QString const nodeType = QString()) override;
+
+    bool connectionPossible(ConnectionId const connectionId) const override;
+
+    bool detachPossible(ConnectionId const connectionId) const override;
+
+    void addConnection(ConnectionId const connectionId) override;
+
+    bool nodeExists(NodeId const nodeId) const override;
+
+    /// Groups report their caption, position, size and port counts.
+    /**
+   * A group is computing while one of its members is.
+   */
+    QVariant nodeData(NodeId nodeId, NodeRole role) const override;
+
+    NodeFlags nodeFlags(NodeId nodeId) const override;
+
+    /// Groups store their position, size and caption.
+    bool setNodeData(NodeId nodeId, NodeRole role, QVariant value) override;
+
+    /// Moves the groups here and passes the other nodes on in one call.
+    void moveNodes(std::vector<NodeId> const &nodeIds, QPointF const &delta) override;
+
+    void setNodePositions(std::vector<std::pair<NodeId, QPointF>> const &positions) override;
+
+    QVariant portData(NodeId nodeId,
+                      PortType portType,
+                      PortIndex portIndex,
+                      PortRole role) const override;
+
+    bool setPortData(NodeId nodeId,
+                     PortType portType,
+                     PortIndex portIndex,
+                     QVariant const &value,
+                     PortRole role = PortRole::Data) override;
+
+    bool deleteConnection(ConnectionId const connectionId) override;
+
+    /// Deleting a group deletes its members.
+    bool deleteNode(NodeId const nodeId) override;
+
+    /// A group is saved with its members, their connections and its ports.
+    QJsonObject saveNode(NodeId const nodeId) const override;
+
+    /// Restores a group saved by `saveNode()`, collapsed, or a plain node.
+    /**
+   * Members whose ids are taken in the source, as for pasted copies, get
+   * new ids.
+   */
+    void loadNode(QJsonObject const &nodeJson) override;
+
+private:
+    /// A member port behind a port of a group.
+    struct PortRef
+    {
+        NodeId nodeId;
+        PortIndex portIndex;
+    };
+
+    struct Group
+    {
+        QString caption;
+
+        QPointF position;
+
+        /// Top left corner of the members when collapsing.
+        QPointF origin;
+
+        QSize size;
+
+        std::unordered_set<NodeId> members;
+
+        /// Indexed by the ports of the group; deleted members leave `InvalidNodeId`.
+        std::vector<PortRef> inPorts;
+
+        std::vector<PortRef> outPorts;
+
+        /// Member port key -> port of the group.
+        std::unordered_map<std::uint64_t, PortIndex> inPortIndex;
+
+        std::unordered_map<std::uint64_t, PortIndex> outPortIndex;
+
+        std::vector<PortRef> &ports(PortType const portType)
+        {
+            return portType == PortType::In ? inPorts : outPorts;
+        }
+
+        std::vector<PortRef> const &ports(PortType const portType) const
+        {
+            return portType == PortType::In ? inPorts : outPorts;
+        }
+
+        /// @returns `InvalidPortIndex` if the member port has no port of the group.
+        PortIndex find(PortType const portType, NodeId const nodeId, PortIndex const index) const;
+
+        /// @returns the port of the group, appended if missing.
+        PortIndex add(PortType const portType, NodeId const nodeId, PortIndex const index);
+    };
+
+    void connectSource();
+
+    Group *findGroup(NodeId const nodeId);
+
+    Group const *findGroup(NodeId const nodeId) const;
+
+    /// Appends the group ports a new source connection needs, the groups get updated.
+    void addGroupPorts(ConnectionId const &sourceId);
+
+    /// The connection as seen here, `false` if it is inside a group or has no group port.
+    bool toGrouped(ConnectionId const &sourceId, ConnectionId &groupedId) const;
+
+    /// @returns `false` if an end is hidden or an empty group slot.
+    bool toSource(ConnectionId const &groupedId, ConnectionId &sourceId) const;
+
+    /// Calls `visitor` with the grouped ids of the visible connections of a source port.
+    /**
+   * `PortType::None` visits all connections of the node.
+   */
+    void visitSource(NodeId const sourceNodeId,
+                     PortType const portType,
+                     PortIndex const portIndex,
+                     ConnectionVisitor const &visitor) const;
+
+    void onSourceNodeDeleted(NodeId const nodeId);
+
+    void onSourceConnectionCreated(ConnectionId const connectionId);
+
+    void onSourceConnectionDeleted(ConnectionId const connectionId);
+
+    void onSourceConnectionsRemapped(ConnectionRemap const &remap);
+
+    void onSourceReset();
+
+    /// Registers the group with a `DataFlowGraphModel` source, empty members remove it.
+    void updateEvaluationUnit(NodeId const groupId);
+
+private:
+    AbstractGraphModel &_source;
+
+    std::unordered_map<NodeId, Group> _groups;
+
+    /// Hidden source node -> its group.
+    std::unordered_map<NodeId, NodeId> _groupOf;
+};
+
+} // namespace QtNodes
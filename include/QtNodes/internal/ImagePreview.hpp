@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Export.hpp"
+#include "NodeDelegateModel.hpp"
+#include "TiledImageData.hpp"
+
+#include <QtCore/QCache>
+#include <QtCore/QObject>
+#include <QtCore/QPair>
+#include <QtCore/QSize>
+#include <QtGui/QImage>
+
+#include <cstdint>
+#include <memory>
+
+namespace QtNodes {
+
+/**
+ * Scales the image of a preview delegate on a worker thread.
+ *
+ * `preview(label->size())` returns a finished preview of that size from the
+ * cache, or else starts scaling it and returns the last preview stretched to
+ * the size with a watermark. `previewReady()` follows once the scaled image
+ * is there. A request for another size cancels the one in flight, so
+ * resizing a node only scales for the size it ends up with.
+ *
+ * ```
+ * connect(&_preview, &ImagePreview::previewReady, _label, [this]() {
+ *     _label->setPixmap(QPixmap::fromImage(_preview.preview(_label->size())));
+ * });
+ * ```
+ */
+class NODE_EDITOR_CORE_PUBLIC ImagePreview : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ImagePreview(QObject *parent = nullptr);
+
+    /// Cancels the scaling in flight, its result is dropped.
+    ~ImagePreview() override;
+
+    /// Previews `image`, empties the cache.
+    void setImage(QImage const &image);
+
+    /// Previews `image` from the level `TiledImageData::thumbnail()` picks.
+    void setImage(std::shared_ptr<TiledImageData const> image);
+
+    void clear();
+
+    /// The preview fitting into `target` with the aspect ratio kept.
+    /**
+   * Never blocks on the scaling: without a cached preview of `target` the
+   * previous preview is stretched and watermarked, or a watermark alone is
+   * returned. A null image means there is nothing to preview.
+   */
+    QImage preview(QSize const &target);
+
+    bool pending() const { return _pendingTarget.isValid(); }
+
+    /// Number of sizes kept, `8` by default.
+    void setCacheSize(int const previews) { _cache.setMaxCost(previews); }
+
+Q_SIGNALS:
+    void previewReady(QSize const target);
+
+private:
+    using SizeKey = QPair<int, int>;
+
+    void request(QSize const &target);
+
+    void onScaled(std::uint64_t const generation, QSize const target, QImage const &image);
+
+    QImage placeholder(QSize const &target) const;
+
+private:
+    QImage _image;
+
+    std::shared_ptr<TiledImageData const> _tiledImage;
+
+    /// Bumped by every new image, results of older ones are dropped.
+    std::uint64_t _generation;
+
+    QSize _pendingTarget;
+
+    CancellationToken _pendingToken;
+
+    QCache<SizeKey, QImage> _cache;
+
+    QImage _lastPreview;
+};
+
+} // namespace QtNodes
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "Definitions.hpp"
+#include "Export.hpp"
+#include "GraphSnapshot.hpp"
+
+#include <QtCore/QPointF>
+#include <QtCore/QSize>
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace QtNodes {
+
+class AbstractGraphModel;
+class WorkStealingExecutor;
+
+/**
+ * Automatic layered (Sugiyama-style) layout of a graph.
+ *
+ * Cycles are broken by reversing the back edges of a depth-first search,
+ * nodes are put into layers by the longest path from the sources and
+ * connections spanning several layers get a chain of dummy nodes. Barycenter
+ * sweeps order every layer to reduce crossings, balancing sweeps move the
+ * nodes towards their neighbours. Unconnected parts are laid out side by
+ * side. Within a layer the work is split across the cores.
+ *
+ * The layout reads a `GraphSnapshot`, so `compute()` may run on any thread;
+ * one instance computes one layout at a time. The result keeps the top left
+ * corner of the nodes laid out in place.
+ *
+ * ```
+ * LayeredLayout layout;
+ * layout.apply(model);
+ * ```
+ */
+class NODE_EDITOR_CORE_PUBLIC LayeredLayout
+{
+public:
+    struct Options
+    {
+        /// `Qt::Horizontal` puts the layers side by side, data flows to the right.
+        Qt::Orientation orientation = Qt::Horizontal;
+
+        double layerSpacing = 80.0;
+
+        /// Gap between two nodes of a layer.
+        double nodeSpacing = 30.0;
+
+        /// Gap between unconnected parts of the graph.
+        double componentSpacing = 80.0;
+
+        /// Down and up passes of the crossing reduction and of the balancing each.
+        unsigned int sweeps = 4;
+
+        /// `0` uses the hardware concurrency, `1` only the calling thread.
+        unsigned int threads = 0;
+    };
+
+    using Positions = std::vector<std::pair<NodeId, QPointF>>;
+
+public:
+    explicit LayeredLayout(Options const &options = Options());
+
+    ~LayeredLayout();
+
+    LayeredLayout(LayeredLayout const &) = delete;
+
+    LayeredLayout &operator=(LayeredLayout const &) = delete;
+
+public:
+    Options const &options() const { return _options; }
+
+    void setOptions(Options const &options);
+
+    /// Sizes used instead of those of the snapshot, e.g. from `AbstractNodeGeometry::size()`.
+    void setNodeSizes(std::unordered_map<NodeId, QSize> sizes) { _sizes = std::move(sizes); }
+
+    /// New positions of all nodes.
+    Positions compute(GraphSnapshot const &snapshot);
+
+    /// New positions of `nodeIds`, laid out with the connections among them.
+    /**
+   * For re-laying out an edited part of the graph: the other nodes do not
+   * move and the part keeps its top left corner.
+   */
+    Positions compute(GraphSnapshot const &snapshot, std::unordered_set<NodeId> const &nodeIds);
+
+    /// Lays out all nodes, or only `nodeIds`, and sets the positions in one batch.
+    void apply(AbstractGraphModel &model, std::unordered_set<NodeId> const &nodeIds = {});
+
+private:
+    Positions layout(GraphSnapshot const &snapshot,
+                     std::vector<GraphSnapshot::Node const *> const &nodes);
+
+    QSize nodeSize(GraphSnapshot::Node const &node) const;
+
+    /// `nullptr` for a single thread.
+    WorkStealingExecutor *executor();
+
+private:
+    Options _options;
+
+    std::unordered_map<NodeId, QSize> _sizes;
+
+    std::unique_ptr<WorkStealingExecutor> _executor;
+};
+
+} // namespace QtNodes
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Export.hpp"
+
+#include <QtCore/QJsonObject>
+#include <QtCore/QString>
+
+#include <cstddef>
+#include <vector>
+
+namespace QtNodes {
+
+/**
+ * Approximate memory held by a model or scene, split into named entries.
+ *
+ * The sizes are estimates from container sizes and capacities plus what
+ * delegates report through `NodeDelegateModel::memoryUsage()`; allocator
+ * overhead and memory owned by Qt internals are not included.
+ */
+struct NODE_EDITOR_CORE_PUBLIC MemoryReport
+{
+    struct Entry
+    {
+        QString name;
+
+        /// Number of items, e.g. nodes or widgets.
+        std::size_t count;
+
+        std::size_t bytes;
+    };
+
+    std::vector<Entry> entries;
+
+    void add(QString const &name, std::size_t const count, std::size_t const bytes);
+
+    /// Adds the entries of `other` named `prefix/<name>`.
+    void append(QString const &prefix, MemoryReport const &other);
+
+    std::size_t totalBytes() const;
+
+    /// `{"total": bytes, "entries": {name: {"count": n, "bytes": b}}}`.
+    QJsonObject toJson() const;
+
+public:
+    /// Element storage of a vector-like container.
+    template<typename Container>
+    static std::size_t vectorBytes(Container const &c)
+    {
+        return c.capacity() * sizeof(typename Container::value_type);
+    }
+
+    /// Buckets plus one node per element of a std hash container.
+    template<typename Container>
+    static std::size_t hashBytes(Container const &c)
+    {
+        return c.bucket_count() * sizeof(void *)
+               + c.size() * (sizeof(typename Container::value_type) + 2 * sizeof(void *));
+    }
+
+    /// One slot plus one control byte per bucket of a FlatHashSet or FlatHashMap.
+    template<typename Container>
+    static std::size_t flatHashBytes(Container const &c)
+    {
+        return c.bucket_count() * (sizeof(typename Container::value_type) + 1);
+    }
+};
+
+} // namespace QtNodes
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Export.hpp"
+
+#include <QtCore/QString>
+
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace QtNodes {
+
+class NodeDelegateModelRegistry;
+
+/**
+ * Searchable snapshot of the models of a registry, built once per
+ * registry revision.
+ *
+ * Matches are ranked: name prefixes first, then prefixes of the words in
+ * the name (split at spaces, punctuation and camel case), then substrings
+ * and finally fuzzy subsequences. The two prefix classes are answered by
+ * binary search; only the fuzzy classes scan the entries.
+ */
+class NODE_EDITOR_CORE_PUBLIC ModelSearchIndex
+{
+public:
+    struct Entry
+    {
+        QString name;
+        QString caption;
+        QString category;
+    };
+
+public:
+    ModelSearchIndex() = default;
+
+    explicit ModelSearchIndex(NodeDelegateModelRegistry const &registry);
+
+    /// Sorted by category, then by name.
+    std::vector<Entry> const &entries() const { return _entries; }
+
+    /// @returns indices into `entries()`, best matches first; an empty
+    /// `text` matches every entry in `entries()` order.
+    std::vector<std::size_t> search(QString const &text,
+                                    std::size_t const limit
+                                    = std::numeric_limits<std::size_t>::max()) const;
+
+private:
+    /// Case folded names, parallel to `_entries`.
+    std::vector<QString> _keys;
+
+    std::vector<Entry> _entries;
+
+    /// Entry indices sorted by key.
+    std::vector<std::size_t> _byKey;
+
+    /// Folded name suffixes starting at a word boundary, sorted.
+    std::vector<std::pair<QString, std::size_t>> _words;
+};
+
+} // namespace QtNodes
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace QtNodes {
+
+/**
+ * Bounded lock-free queue for many producer threads and one consumer.
+ *
+ * Every cell carries a sequence number telling whether it is free for the
+ * producer of a given position or filled for the consumer, after Dmitry
+ * Vyukov's bounded queue. A push is one compare-and-swap on the write
+ * position, a pop touches no shared counter at all. Neither allocates.
+ *
+ * `tryPush()` fails when the buffer is full instead of waiting for the
+ * consumer, which may be blocked on the producers.
+ */
+template<typename T>
+class MpscRingBuffer
+{
+public:
+    /// `capacity` is rounded up to a power of two.
+    explicit MpscRingBuffer(std::size_t capacity = 1024)
+    {
+        std::size_t size = 2;
+
+        while (size < capacity)
+            size *= 2;
+
+        _mask = size - 1;
+        _cells.reset(new Cell[size]);
+
+        for (std::size_t i = 0; i < size; ++i)
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpscRingBuffer(MpscRingBuffer const &) = delete;
+
+    MpscRingBuffer &operator=(MpscRingBuffer const &) = delete;
+
+    std::size_t capacity() const { return _mask + 1; }
+
+    /// Any thread; `value` is left untouched when the buffer is full.
+    bool tryPush(T &&value)
+    {
+        std::size_t pos = _writePos.load(std::memory_order_relaxed);
+
+        Cell *cell = nullptr;
+
+        for (;;) {
+            cell = &_cells[pos & _mask];
+
+            std::size_t const sequence = cell->sequence.load(std::memory_order_acquire);
+
+            auto const diff = static_cast<std::intptr_t>(sequence - pos);
+
+            if (diff == 0) {
+                if (_writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _writePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    /// The consumer thread only.
+    bool tryPop(T &value)
+    {
+        Cell &cell = _cells[_readPos & _mask];
+
+        std::size_t const sequence = cell.sequence.load(std::memory_order_acquire);
+
+        if (sequence != _readPos + 1)
+            return false;
+
+        value = std::move(cell.value);
+
+        // Payloads are released here, not when the cell is reused.
+        cell.value = T();
+        cell.sequence.store(_readPos + _mask + 1, std::memory_order_release);
+
+        ++_readPos;
+
+        return true;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> _cells;
+
+    std::size_t _mask;
+
+    /// Apart from the consumer's position, producers hammer it.
+    alignas(64) std::atomic<std::size_t> _writePos{0};
+
+    alignas(64) std::size_t _readPos = 0;
+};
+
+} // namespace QtNodes
@@ -1,10 +1,13 @@
 #pragma once
 
+#include <cstddef>
 #include <memory>
+#include <type_traits>
 
 #include <QtCore/QObject>
 #include <QtCore/QString>
 
+#include "Definitions.hpp"
 #include "Export.hpp"
 
 namespace QtNodes {
@@ -13,10 +16,13 @@ namespace QtNodes {
  * `id` represents an internal unique data type for the given port.
  * `name` is a normal text description.
  */
-struct NODE_EDITOR_PUBLIC NodeDataType
+struct NODE_EDITOR_CORE_PUBLIC NodeDataType
 {
     QString id;
     QString name;
+
+    /// Interned integer handle of `id`, cheap to compare and hash.
+    NodeDataTypeId typeId() const;
 };
 
 /**
@@ -24,11 +30,18 @@ struct NODE_EDITOR_PUBLIC NodeDataType
  * @param type is used for comparing the types
  * The actual data is stored in subtypes
  */
-class NODE_EDITOR_PUBLIC NodeData
+class NODE_EDITOR_CORE_PUBLIC NodeData
 {
 public:
+    NodeData()
+        : _typeTag(nullptr)
+    {}
+
     virtual ~NodeData() = default;
 
+    /// Identifies the concrete class for `nodeDataCast`; `nullptr` if untagged.
+    void const *typeTag() const { return _typeTag; }
+
     virtual bool sameType(NodeData const &nodeData) const
     {
         return (this->type().id == nodeData.type().id);
@@ -36,8 +49,92 @@ public:
 
     /// Type for inner use
     virtual NodeDataType type() const = 0;
+
+    /// Opt-in for the result cache of deterministic delegates.
+    /**
+   * Return `true` together with a `contentHash()` that is equal for equal
+   * contents. Unhashable inputs disable the cache for the receiving node.
+   */
+    virtual bool hasContentHash() const { return false; }
+
+    virtual std::size_t contentHash() const { return 0; }
+
+    /// Approximate bytes of the payload, e.g. an image, `0` by default.
+    /**
+   * Counted against `DataFlowGraphModel::intermediateMemoryBudget()`.
+   */
+    virtual std::size_t memoryUsage() const { return 0; }
+
+protected:
+    explicit NodeData(void const *typeTag)
+        : _typeTag(typeTag)
+    {}
+
+private:
+    void const *_typeTag;
+};
+
+/**
+ * Optional base for NodeData subtypes, tagging every instance with its class.
+ *
+ * ```
+ * class DecimalData : public TypedNodeData<DecimalData> { ... };
+ * ```
+ *
+ * Receivers then downcast with `nodeDataCast<DecimalData>(data)`, which is a
+ * pointer comparison instead of a `dynamic_cast`.
+ */
+template<typename Derived>
+class TypedNodeData : public NodeData
+{
+public:
+    static void const *staticTypeTag()
+    {
+        static char const anchor = 0;
+        return &anchor;
+    }
+
+protected:
+    TypedNodeData()
+        : NodeData(staticTypeTag())
+    {}
 };
 
+namespace detail {
+
+template<typename T>
+void const *staticTypeTagOf(std::true_type)
+{
+    return T::staticTypeTag();
+}
+
+template<typename T>
+void const *staticTypeTagOf(std::false_type)
+{
+    return nullptr;
+}
+
+} // namespace detail
+
+/// Downcasts `data` using the type tag, falls back to `dynamic_pointer_cast`.
+/**
+ * The fallback covers untagged types, classes derived from a tagged one and
+ * tags duplicated across shared library boundaries.
+ */
+template<typename T>
+std::shared_ptr<T> nodeDataCast(std::shared_ptr<NodeData> const &data)
+{
+    if (!data)
+        return nullptr;
+
+    void const *tag = detail::staticTypeTagOf<T>(std::is_base_of<TypedNodeData<T>, T>());
+
+    if (tag != nullptr && data->typeTag() == tag)
+        return std::static_pointer_cast<T>(data);
+
+    return std::dynamic_pointer_cast<T>(data);
+}
+
 } // namespace QtNodes
 Q_DECLARE_METATYPE(QtNodes::NodeDataType)
 Q_DECLARE_METATYPE(std::shared_ptr<QtNodes::NodeData>)
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Export.hpp"
+#include "NodeData.hpp"
+#include "QStringStdHash.hpp"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace QtNodes {
+
+/**
+ * Process-wide table turning NodeData into bytes and back, by `NodeDataType::id`.
+ *
+ * Used wherever data leaves the process, e.g. between the partitions of a
+ * PartitionedEvaluator. Every process taking part registers the same types.
+ */
+class NODE_EDITOR_CORE_PUBLIC NodeDataCodec
+{
+public:
+    using Encoder = std::function<QByteArray(NodeData const &)>;
+
+    /// Receives a view that is only valid during the call; keep a copy, not the array.
+    using Decoder = std::function<std::shared_ptr<NodeData>(QByteArray const &)>;
+
+public:
+    /// Replaces the functions of `typeId` if it was registered before.
+    static void registerType(QString const &typeId, Encoder encoder, Decoder decoder);
+
+    static bool contains(QString const &typeId);
+
+    /// @throws std::logic_error when the type of `data` is not registered.
+    static QByteArray encode(NodeData const &data);
+
+    /// @throws std::logic_error when `typeId` is not registered.
+    static std::shared_ptr<NodeData> decode(QString const &typeId, QByteArray const &bytes);
+
+private:
+    NodeDataCodec() = default;
+
+    static NodeDataCodec &instance();
+
+private:
+    struct Functions
+    {
+        Encoder encoder;
+        Decoder decoder;
+    };
+
+    mutable std::mutex _mutex;
+
+    std::unordered_map<QString, Functions> _functions;
+};
+
+} // namespace QtNodes
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QtCore/QString>
+#include <QtGui/QColor>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "Definitions.hpp"
+#include "Export.hpp"
+#include "QStringStdHash.hpp"
+
+namespace QtNodes {
+
+/**
+ * Process-wide table interning `NodeDataType::id` strings into small
+ * integer handles.
+ *
+ * Handles are dense and never reused, so they can index plain arrays. The
+ * per-type connection color is computed once at interning time.
+ * The empty type id always maps to `InvalidNodeDataTypeId`.
+ *
+ * Only registering a new type takes a lock. Entries live in fixed blocks
+ * that never move and are published by the entry count, so `color()` and
+ * `typeIdString()` read them lock-free while painting, and every thread
+ * remembers the ids it has interned before.
+ */
+class NODE_EDITOR_CORE_PUBLIC NodeDataTypeRegistry
+{
+public:
+    /// @returns a stable handle for `typeId`, registering it when needed.
+    static NodeDataTypeId intern(QString const &typeId);
+
+    /// @returns the string a handle was created from.
+    static QString typeIdString(NodeDataTypeId const id);
+
+    /// @returns the data-defined connection color of the type.
+    static QColor color(NodeDataTypeId const id);
+
+    /// @returns the number of registered types including the invalid one.
+    static std::size_t size();
+
+private:
+    NodeDataTypeRegistry();
+
+    NodeDataTypeRegistry(NodeDataTypeRegistry const &) = delete;
+
+    NodeDataTypeRegistry &operator=(NodeDataTypeRegistry const &) = delete;
+
+    static NodeDataTypeRegistry &instance();
+
+    static QColor computeColor(QString const &typeId);
+
+    /// Appends the entry of a new type; `_mutex` must be held.
+    NodeDataTypeId append(QString const &typeId);
+
+private:
+    struct Entry
+    {
+        QString typeId;
+        QColor color;
+    };
+
+    static constexpr std::size_t BlockBits = 8;
+    static constexpr std::size_t BlockSize = std::size_t(1) << BlockBits;
+    static constexpr std::size_t MaxBlocks = 4096;
+
+    /// Guards `_ids` and the allocation of blocks.
+    std::mutex _mutex;
+
+    std::unordered_map<QString, NodeDataTypeId> _ids;
+
+    std::unique_ptr<Entry[]> _blocks[MaxBlocks];
+
+    /// Number of published entries, which never change afterwards.
+    std::atomic<std::size_t> _size;
+};
+
+} // namespace QtNodes
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <vector>
 
-#include <QtWidgets/QWidget>
+#include <QtCore/QObject>
+#include <QtCore/QSize>
 
 #include "Definitions.hpp"
 #include "Export.hpp"
@@ -12,15 +18,110 @@
 
 namespace QtNodes {
 
+class NodeDelegateModel;
 class StyleCollection;
 
+/// Data type and connection policy of one port, see `NodeDelegateModel::portTable()`.
+struct PortSpec
+{
+    NodeDataType type;
+
+    /// Interned `type.id`.
+    NodeDataTypeId typeId;
+
+    ConnectionPolicy policy;
+
+    /// `TypedNodeData::staticTypeTag()` of the declared class, `nullptr` if untagged.
+    void const *typeTag;
+};
+
+/// Ports of a delegate type that never change.
+struct PortTable
+{
+    std::vector<PortSpec> in;
+    std::vector<PortSpec> out;
+
+    std::vector<PortSpec> const &ports(PortType const portType) const
+    {
+        return portType == PortType::In ? in : out;
+    }
+};
+
+/// Cooperative cancellation flag shared by the graph model and a running job.
+/**
+ * Copies refer to the same flag. Long jobs should poll `isCancelled()` and
+ * return early; their results are dropped anyway once superseded.
+ */
+class CancellationToken
+{
+public:
+    CancellationToken()
+        : _cancelled(std::make_shared<std::atomic<bool>>(false))
+    {}
+
+    bool isCancelled() const { return _cancelled->load(std::memory_order_relaxed); }
+
+    void cancel() const { _cancelled->store(true, std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> _cancelled;
+};
+
+/// Receives the time delegates spend in their entry points, see `NodeDelegateModel::setProfiler()`.
+/**
+ * DataFlowGraphModel reports every `setInData()` and `outData()` call it
+ * makes on a profiled delegate, and every job of `computeJob()` it runs for
+ * one. A `setInData()` time includes whatever the delegate triggered by
+ * emitting `dataUpdated` within the call, i.e. the cascade downstream in
+ * `PropagationMode::Immediate`. Jobs and parallel evaluation report from
+ * worker threads, `record()` must be thread safe for them.
+ */
+class NODE_EDITOR_CORE_PUBLIC NodeDelegateProfiler
+{
+public:
+    enum class Call {
+        SetInData, ///< `portIndex` is the input port.
+        OutData,   ///< `portIndex` is the output port.
+        Compute    ///< The run of a job on its worker, `portIndex` is invalid.
+    };
+
+    /// Times a scope for the profiler of `delegate`, reads no clock without one.
+    class NODE_EDITOR_CORE_PUBLIC Scope
+    {
+    public:
+        Scope(NodeDelegateModel const *delegate, Call const call, PortIndex const portIndex);
+
+        ~Scope();
+
+        Scope(Scope const &) = delete;
+        Scope &operator=(Scope const &) = delete;
+
+    private:
+        NodeDelegateModel const *_delegate;
+        NodeDelegateProfiler *_profiler;
+        Call _call;
+        PortIndex _portIndex;
+        std::chrono::steady_clock::time_point _start;
+    };
+
+public:
+    virtual ~NodeDelegateProfiler() = default;
+
+    /// `delegateName` is the `NodeDelegateModel::name()` of the timed delegate.
+    virtual void record(QString const &delegateName,
+                        Call const call,
+                        PortIndex const portIndex,
+                        std::int64_t const nanoseconds)
+        = 0;
+};
+
 /**
  * The class wraps Node-specific data operations and propagates it to
  * the nesting DataFlowGraphModel which is a subclass of
  * AbstractGraphModel.
  * This class is the same what has been called NodeDataModel before v3.
  */
-class NODE_EDITOR_PUBLIC NodeDelegateModel : public QObject, public Serializable
+class NODE_EDITOR_CORE_PUBLIC NodeDelegateModel : public QObject, public Serializable
 {
     Q_OBJECT
 
@@ -57,10 +158,36 @@ public:
 public:
     virtual ConnectionPolicy portConnectionPolicy(PortType, PortIndex) const;
 
+    /// Whether the node cannot work without a connection to the input, `false` by default.
+    /**
+   * Answers `PortRole::Required`; reported by GraphValidator.
+   */
+    virtual bool inputRequired(PortIndex const) const { return false; }
+
+    /// Ports shared by all delegates of the type, `nullptr` if they may change.
+    /**
+   * When set, the graph model reads port counts, data types and connection
+   * policies from the table instead of calling the virtual functions above.
+   * Set by StaticNodeDelegateModel.
+   */
+    PortTable const *portTable() const { return _portTable; }
+
+    /// The style of this node, `StyleCollection::nodeStyle()` unless customized.
     NodeStyle const &nodeStyle() const;
 
+    /// Shared immutable style; nodes without a custom style all return the same pointer.
+    std::shared_ptr<NodeStyle const> sharedNodeStyle() const;
+
+    /// Gives this node its own copy of `style`.
     void setNodeStyle(NodeStyle const &style);
 
+    /// Shares `style` with other nodes, `nullptr` returns to the default style.
+    /**
+   * Delegates customizing many nodes the same way should create the style
+   * once and hand the pointer to all of them.
+   */
+    void setSharedNodeStyle(std::shared_ptr<NodeStyle const> style);
+
 public:
     virtual void setInData(std::shared_ptr<NodeData> nodeData, PortIndex const portIndex) = 0;
 
@@ -75,11 +202,133 @@ public:
    * to call the non-static `Model::name()`. If the embedded widget is
    * allocated in the constructor but not actually embedded into some
    * QGraphicsProxyWidget, we'll gonna have a dangling pointer.
+   *
+   * The widget is passed on as `QObject *` to keep QtNodesCore free of
+   * QtWidgets; overrides keep returning `QWidget *` or a subclass.
    */
-    virtual QWidget *embeddedWidget() = 0;
+    virtual QObject *embeddedWidget() = 0;
+
+    /// Size of the embedded widget before `embeddedWidget()` was called.
+    /**
+   * A valid size lets the scene lay the node out without the widget and
+   * create it only once the node is painted in a view. The default invalid
+   * size makes the widget be created as soon as the node is measured.
+   * Delegates without a widget may keep the default.
+   */
+    virtual QSize embeddedWidgetSizeHint() const { return QSize(); }
 
     virtual bool resizable() const { return false; }
 
+public:
+    /// Outputs of an asynchronous computation, indexed by output port.
+    using ComputeResults = std::vector<std::shared_ptr<NodeData>>;
+
+    /// Self-contained piece of work executed on a worker thread.
+    /**
+   * The token is cancelled as soon as a newer computation of the same node
+   * is requested or the node is deleted.
+   */
+    using ComputeJob = std::function<ComputeResults(CancellationToken const &)>;
+
+    /// Opt-in asynchronous computation.
+    /**
+   * Called on the model thread after `requestCompute()`. The returned job
+   * must only capture copies of its inputs, e.g. the `shared_ptr<NodeData>`
+   * received in `setInData()`, and must never touch the delegate or its
+   * widgets. An empty job means there is nothing to compute.
+   *
+   * Every request starts a new generation of the node; only the results of
+   * the latest generation reach `setComputeResults()`.
+   */
+    virtual ComputeJob computeJob() { return ComputeJob(); }
+
+    /// Receives the outputs of a finished job on the model thread.
+    /**
+   * `outData()` is expected to return them afterwards; the graph model then
+   * propagates every port present in `results`.
+   */
+    virtual void setComputeResults(ComputeResults const &results) { Q_UNUSED(results); }
+
+    /// Capability flag for the parallel evaluation of DataFlowGraphModel.
+    /**
+   * Return `true` if `setInData()` and `outData()` may be called from a
+   * worker thread, concurrently with other delegates. Such a delegate must
+   * not touch its widgets there and may only emit `dataUpdated`.
+   */
+    virtual bool threadSafe() const { return false; }
+
+    /// Declares `computeJob()` a pure function of the current inputs.
+    /**
+   * The graph model then remembers the results per combination of input
+   * hashes (see `NodeData::contentHash()`) and hands a repeated combination
+   * straight to `setComputeResults()` without running the job.
+   */
+    virtual bool deterministic() const { return false; }
+
+    /// Capability flag for the parallel serialization of DataFlowGraphModel.
+    /**
+   * Return `true` if `save()` and `load()` may run on a worker thread,
+   * concurrently with other delegates. `load()` must neither touch widgets
+   * nor emit signals there; the embedded widget is created afterwards.
+   */
+    virtual bool threadSafeSerialization() const { return false; }
+
+    /// Approximate bytes of the delegate's own payload, e.g. lookup tables or images.
+    /**
+   * Summed up by `DataFlowGraphModel::memoryReport()`; `0` by default.
+   */
+    virtual std::size_t memoryUsage() const { return 0; }
+
+    /// Opt-in for `DataFlowGraphModel::setReleaseIntermediateData()`.
+    /**
+   * Return `true` if `releaseData()` may drop every input and output the
+   * delegate holds, and feeding the same inputs again through `setInData()`
+   * restores the same outputs synchronously. Delegates with state beyond
+   * their inputs, or computing through `computeJob()`, keep the default.
+   */
+    virtual bool releasable() const { return false; }
+
+    /// Drops the held inputs and outputs; `outData()` may return `nullptr` afterwards.
+    virtual void releaseData() {}
+
+    NodeDelegateProfiler *profiler() const { return _profiler; }
+
+    /// Times the calls of the graph model into this delegate, `nullptr` stops it.
+    /**
+   * The profiler is not owned and must outlive the delegate as well as its
+   * running compute jobs. Unprofiled delegates cost one pointer test per call.
+   */
+    void setProfiler(NodeDelegateProfiler *profiler) { _profiler = profiler; }
+
+public:
+    /// Copy of the delegate for `NodeDelegateModelRegistry::registerPrototype()`.
+    /**
+   * Must be safe to call concurrently when the registry is shared between
+   * threads, e.g. by BatchEvaluator. `nullptr` means cloning is unsupported.
+   */
+    virtual std::unique_ptr<NodeDelegateModel> clone() const { return nullptr; }
+
+    /// Allows DataFlowGraphModel to keep the deleted delegate for reuse.
+    /**
+   * A recyclable delegate must not rely on its embedded widget surviving
+   * the node: the scene deletes the widget together with the node, so keep
+   * it in a QPointer or provide no widget at all.
+   */
+    virtual bool recyclable() const { return false; }
+
+    /// Restores the freshly constructed state before the delegate is reused.
+    virtual void prepareForReuse() {}
+
+protected:
+    /// Asks the graph model to run `computeJob()` on its worker pool.
+    /**
+   * Typically called from `setInData()` instead of computing in place.
+   */
+    void requestCompute() { Q_EMIT computeRequested(); }
+
+    /// The table must outlive the delegate and match its virtual port functions.
+    void setPortTable(PortTable const *table) { _portTable = table; }
+
 public Q_SLOTS:
 
     virtual void inputConnectionCreated(ConnectionId const &) {}
@@ -102,12 +351,20 @@ Q_SIGNALS:
 
     void computingFinished();
 
+    /// @see requestCompute()
+    void computeRequested();
+
+    /// Makes the scene relayout the node, emit when the widget or caption changes size.
     void embeddedWidgetSizeUpdated();
 
+    /// Emit when the result of `save()` changed, e.g. after a user edit.
+    void internalDataChanged();
+
     /// Call this function before deleting the data associated with ports.
     /**
    * The function notifies the Graph Model and makes it remove and recompute the
-   * affected connection addresses.
+   * affected connection addresses. Connections of the ports behind are moved
+   * without `setInData()` calls, shift the stored input data along.
    */
     void portsAboutToBeDeleted(PortType const portType, PortIndex const first, PortIndex const last);
 
@@ -117,7 +374,8 @@ Q_SIGNALS:
     /// Call this function before inserting the data associated with ports.
     /**
    * The function notifies the Graph Model and makes it recompute the affected
-   * connection addresses.
+   * connection addresses. As for deletions, the stored input data of the
+   * shifted ports has to be moved by the delegate.
    */
     void portsAboutToBeInserted(PortType const portType,
                                 PortIndex const first,
@@ -127,7 +385,12 @@ Q_SIGNALS:
     void portsInserted();
 
 private:
-    NodeStyle _nodeStyle;
+    /// `nullptr` while the node follows the default style.
+    std::shared_ptr<NodeStyle const> _nodeStyle;
+
+    PortTable const *_portTable;
+
+    NodeDelegateProfiler *_profiler;
 };
 
 } // namespace QtNodes
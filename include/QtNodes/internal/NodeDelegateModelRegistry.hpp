@@ -7,6 +7,7 @@
 
 #include <QtCore/QString>
 
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <set>
@@ -17,17 +18,56 @@
 
 namespace QtNodes {
 
+/// What the registry knows about a model without instantiating it.
+struct NodeDelegateModelDescriptor
+{
+    /// Unique model name, the key passed to `NodeDelegateModelRegistry::create()`.
+    QString name;
+
+    QString caption;
+
+    QString category;
+
+    std::vector<NodeDataType> inPorts;
+
+    std::vector<NodeDataType> outPorts;
+};
+
 /// Class uses map for storing models (name, model)
-class NODE_EDITOR_PUBLIC NodeDelegateModelRegistry
+/**
+ * A model class can describe itself through static members, in which case
+ * `registerModel<ModelType>()` never creates an instance:
+ *
+ * - `static NodeDelegateModelDescriptor Descriptor();` provides everything,
+ * - `static QString Name();` provides only the name, used as caption too.
+ *
+ * Otherwise one instance is created at registration to read `name()`,
+ * `caption()` and the ports.
+ */
+class NODE_EDITOR_CORE_PUBLIC NodeDelegateModelRegistry
 {
 public:
     using RegistryItemPtr = std::unique_ptr<NodeDelegateModel>;
     using RegistryItemCreator = std::function<RegistryItemPtr()>;
     using RegisteredModelCreatorsMap = std::unordered_map<QString, RegistryItemCreator>;
     using RegisteredModelsCategoryMap = std::unordered_map<QString, QString>;
+    using RegisteredModelDescriptorsMap = std::unordered_map<QString, NodeDelegateModelDescriptor>;
     using CategoriesSet = std::set<QString>;
 
-    //using RegisteredTypeConvertersMap = std::map<TypeConverterId, TypeConverter>;
+    /// Entry point of a node plugin library, see `registerPluginManifest()`.
+    /**
+   * Returns a new model owned by the caller, `nullptr` for unknown names.
+   */
+    using PluginModelFactory = NodeDelegateModel *(*) (char const *modelName);
+
+    /// Name under which plugins export their `PluginModelFactory` with C linkage.
+    static constexpr char const *PluginFactorySymbol = "qtnodes_create_model";
+
+    /// Turns the data of one type into the data of another, never called with `nullptr`.
+    using TypeConverter = std::function<std::shared_ptr<NodeData>(std::shared_ptr<NodeData>)>;
+
+    /// Converters keyed by the packed `(out, in)` type ids, see `typeConverterKey()`.
+    using RegisteredTypeConvertersMap = std::unordered_map<std::uint64_t, TypeConverter>;
 
     NodeDelegateModelRegistry() = default;
     ~NodeDelegateModelRegistry() = default;
@@ -43,14 +83,30 @@ public:
     template<typename ModelType>
     void registerModel(RegistryItemCreator creator, QString const &category = "Nodes")
     {
-        QString const name = computeName<ModelType>(HasStaticMethodName<ModelType>{}, creator);
-        if (!_registeredItemCreators.count(name)) {
-            _registeredItemCreators[name] = std::move(creator);
-            _categories.insert(category);
-            _registeredModelsCategory[name] = category;
-        }
+        NodeDelegateModelDescriptor descriptor
+            = computeDescriptor<ModelType>(HasStaticMethodDescriptor<ModelType>{},
+                                           HasStaticMethodName<ModelType>{},
+                                           creator);
+        descriptor.category = category;
+
+        registerModel(std::move(descriptor), std::move(creator));
     }
 
+    /// Registers a model by its descriptor alone; `creator` runs on `create()` only.
+    /**
+   * Suited for plugins that list their models up front and load the code
+   * on first use. An empty `descriptor.category` files the model under "Nodes".
+   */
+    void registerModel(NodeDelegateModelDescriptor descriptor, RegistryItemCreator creator);
+
+    /// Registers a configured instance; `create()` returns its `clone()`s.
+    /**
+   * Skips the constructor of the model for every new node, e.g. building a
+   * custom style. The prototype must implement `NodeDelegateModel::clone()`.
+   */
+    void registerPrototype(std::unique_ptr<NodeDelegateModel> prototype,
+                           QString const &category = "Nodes");
+
     template<typename ModelType>
     void registerModel(QString const &category = "Nodes")
     {
@@ -58,6 +114,44 @@ public:
         registerModel<ModelType>(std::move(creator), category);
     }
 
+    /// Registers a model of a plugin library, which is loaded by the first `create()`.
+    /**
+   * The library is opened with `QLibrary` and has to export
+   * `PluginFactorySymbol`. It stays loaded once opened, and models of the
+   * same library share one handle. If it cannot be loaded, `create()`
+   * returns `nullptr` and a warning names the library.
+   */
+    void registerPluginModel(NodeDelegateModelDescriptor descriptor, QString const &libraryPath);
+
+    /// Registers the models a JSON manifest lists, without loading their library.
+    /**
+   * ```
+   * {
+   *   "library": "libmathnodes.so",
+   *   "models": [
+   *     {
+   *       "name": "Addition",
+   *       "caption": "Addition",
+   *       "category": "Operators",
+   *       "in": [{"id": "decimal", "name": "Decimal"}, {"id": "decimal", "name": "Decimal"}],
+   *       "out": [{"id": "decimal", "name": "Decimal"}]
+   *     }
+   *   ]
+   * }
+   * ```
+   *
+   * A relative library path is relative to the manifest. The library exports
+   *
+   * ```
+   * extern "C" QtNodes::NodeDelegateModel *qtnodes_create_model(char const *modelName);
+   * ```
+   *
+   * Startup then only reads the manifests, whatever the size of the catalogue.
+   *
+   * @returns the number of models registered, `0` if the manifest cannot be read.
+   */
+    std::size_t registerPluginManifest(QString const &fileName);
+
 #if 0
   template<typename ModelType>
   void
@@ -83,17 +177,21 @@ public:
   {
     registerModel(std::forward<ModelCreator>(creator), category);
   }
-
-
-  void
-  registerTypeConverter(TypeConverterId const& id,
-                        TypeConverter          typeConverter)
-  {
-    _registeredTypeConverters[id] = std::move(typeConverter);
-  }
-
 #endif
 
+    /// Lets outputs of type `from` connect to inputs of type `to` without a converter node.
+    /**
+   * `DataFlowGraphModel::connectionPossible()` accepts such connections and
+   * the model converts the data on the way to the input, as a step of the
+   * propagation instead of a node of its own. Converters may run on worker
+   * threads with `PropagationMode::Parallel` and must not touch shared state.
+   *
+   * Replaces the converter registered for the same pair before.
+   */
+    void registerTypeConverter(NodeDataType const &from,
+                               NodeDataType const &to,
+                               TypeConverter converter);
+
     std::unique_ptr<NodeDelegateModel> create(QString const &modelName);
 
     RegisteredModelCreatorsMap const &registeredModelCreators() const;
@@ -102,11 +200,37 @@ public:
 
     CategoriesSet const &categories() const;
 
-#if 0
-  TypeConverter
-  getTypeConverter(NodeDataType const& d1,
-                   NodeDataType const& d2) const;
-#endif
+    RegisteredModelDescriptorsMap const &registeredModelDescriptors() const;
+
+    /// @returns `nullptr` if `modelName` is not registered.
+    NodeDelegateModelDescriptor const *descriptor(QString const &modelName) const;
+
+    /// Changes whenever a model or converter is registered, so views can cache what they build from it.
+    std::uint64_t revision() const { return _revision; }
+
+    /// @returns `nullptr` if no converter from `from` to `to` is registered.
+    TypeConverter const *typeConverter(NodeDataTypeId const from, NodeDataTypeId const to) const
+    {
+        if (_registeredTypeConverters.empty())
+            return nullptr;
+
+        auto it = _registeredTypeConverters.find(typeConverterKey(from, to));
+
+        return it != _registeredTypeConverters.end() ? &it->second : nullptr;
+    }
+
+    /// @returns an empty function if no converter from `from` to `to` is registered.
+    TypeConverter getTypeConverter(NodeDataType const &from, NodeDataType const &to) const;
+
+    RegisteredTypeConvertersMap const &registeredTypeConverters() const
+    {
+        return _registeredTypeConverters;
+    }
+
+    static std::uint64_t typeConverterKey(NodeDataTypeId const from, NodeDataTypeId const to)
+    {
+        return (static_cast<std::uint64_t>(from) << 32) | static_cast<std::uint64_t>(to);
+    }
 
 private:
     RegisteredModelsCategoryMap _registeredModelsCategory;
@@ -115,9 +239,17 @@ private:
 
     RegisteredModelCreatorsMap _registeredItemCreators;
 
-#if 0
-  RegisteredTypeConvertersMap _registeredTypeConverters;
-#endif
+    RegisteredModelDescriptorsMap _registeredDescriptors;
+
+    struct PluginLibrary;
+
+    /// Plugin libraries by absolute path, resolved on the first `create()`.
+    std::unordered_map<QString, std::shared_ptr<PluginLibrary>> _pluginLibraries;
+
+    std::uint64_t _revision = 0;
+
+    /// Entries are never erased, so pointers to converters stay valid.
+    RegisteredTypeConvertersMap _registeredTypeConverters;
 
 private:
     // If the registered ModelType class has the static member method
@@ -134,18 +266,48 @@ private:
         : std::true_type
     {};
 
+    template<typename T, typename = void>
+    struct HasStaticMethodDescriptor : std::false_type
+    {};
+
+    template<typename T>
+    struct HasStaticMethodDescriptor<
+        T,
+        typename std::enable_if<
+            std::is_same<decltype(T::Descriptor()), NodeDelegateModelDescriptor>::value>::type>
+        : std::true_type
+    {};
+
+    template<typename ModelType, typename HasName>
+    static NodeDelegateModelDescriptor computeDescriptor(std::true_type,
+                                                         HasName,
+                                                         RegistryItemCreator const &)
+    {
+        return ModelType::Descriptor();
+    }
+
     template<typename ModelType>
-    static QString computeName(std::true_type, RegistryItemCreator const &)
+    static NodeDelegateModelDescriptor computeDescriptor(std::false_type,
+                                                         std::true_type,
+                                                         RegistryItemCreator const &)
     {
-        return ModelType::Name();
+        NodeDelegateModelDescriptor descriptor;
+        descriptor.name = ModelType::Name();
+        descriptor.caption = descriptor.name;
+        return descriptor;
     }
 
     template<typename ModelType>
-    static QString computeName(std::false_type, RegistryItemCreator const &creator)
+    static NodeDelegateModelDescriptor computeDescriptor(std::false_type,
+                                                         std::false_type,
+                                                         RegistryItemCreator const &creator)
     {
-        return creator()->name();
+        return describe(*creator());
     }
 
+    /// Reads the descriptor from a live instance.
+    static NodeDelegateModelDescriptor describe(NodeDelegateModel const &model);
+
     template<typename T>
     struct UnwrapUniquePtr
     {
@@ -1,9 +1,15 @@
 #pragma once
 
+#include <QtCore/QPointer>
 #include <QtCore/QUuid>
+#include <QtGui/QPixmap>
 #include <QtWidgets/QGraphicsObject>
 
 #include "NodeState.hpp"
+#include "NodeStyle.hpp"
+#include "SharedSceneCache.hpp"
+
+#include <memory>
 
 class QGraphicsProxyWidget;
 
@@ -24,7 +30,16 @@ public:
 public:
     NodeGraphicsObject(BasicGraphicsScene &scene, NodeId node);
 
-    ~NodeGraphicsObject() override = default;
+    ~NodeGraphicsObject() override;
+
+    /// Detaches from the node and the scene to wait in the scene's object pool.
+    /**
+   * The embedded widget goes as on destruction, signal connections are cut.
+   */
+    void recycle();
+
+    /// Binds a recycled object to `nodeId`, as if it was constructed for it.
+    void reuse(BasicGraphicsScene &scene, NodeId const nodeId);
 
 public:
     AbstractGraphModel &graphModel() const;
@@ -39,6 +54,16 @@ public:
 
     NodeState const &nodeState() const { return _nodeState; }
 
+    /// Style used to paint the node.
+    /**
+   * The style is fetched from the model once and cached. It is refreshed
+   * after `updateNodeStyle()` or when the style context of the scene changes.
+   */
+    NodeStyle const &nodeStyle() const;
+
+    /// Drops the cached style; the next `nodeStyle()` call re-reads it.
+    void updateNodeStyle();
+
     QRectF boundingRect() const override;
 
     void setGeometryChanged();
@@ -52,6 +77,28 @@ public:
 
     void updateQWidgetEmbedPos();
 
+    /// Drops the rendered image kept while the scene caches node rendering.
+    void invalidateRenderCache();
+
+    /// Bytes of the rendered image and the widget snapshot.
+    std::size_t renderCacheBytes() const;
+
+    /// `nullptr` for delegates without a widget and for snapshotted widgets.
+    QGraphicsProxyWidget const *proxyWidget() const { return _proxyWidget; }
+
+    /// Embeds or snapshots the widget after `BasicGraphicsScene::widgetSnapshotsEnabled()`.
+    /**
+   * The widget stays embedded while the node is hovered or focused, while
+   * it has the focus or grabs the mouse and while a popup is open.
+   */
+    void updateWidgetActivation();
+
+    /// Attaches or removes the drop shadow effect after the scene shadow mode.
+    void updateShadow();
+
+    /// Applies the `NodeFlag::Locked` flag of the model to the item flags.
+    void setLockedState();
+
 protected:
     void paint(QPainter *painter,
                QStyleOptionGraphicsItem const *option,
@@ -73,12 +120,43 @@ protected:
 
     void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) override;
 
+    void focusInEvent(QFocusEvent *event) override;
+
+    void focusOutEvent(QFocusEvent *event) override;
+
+    /// Watches the proxy for the widget losing the focus.
+    bool sceneEventFilter(QGraphicsItem *watched, QEvent *event) override;
+
     void contextMenuEvent(QGraphicsSceneContextMenuEvent *event) override;
 
 private:
-    void embedQWidget();
+    /// Adds the item to the scene and sets it up for `_nodeId`.
+    void initialize(BasicGraphicsScene &scene);
 
-    void setLockedState();
+    /// A widget is always measured, `sizeRestored` only spares the node without one.
+    void embedQWidget(bool const sizeRestored = false);
+
+    /// Embeds the widget of a delegate with a size hint after the first paint.
+    void embedDeferredWidget();
+
+    /// Grabs the widget and removes the proxy, the widget stays with the delegate.
+    void deactivateWidget();
+
+    /// Checks the activation once control is back in the event loop.
+    void scheduleWidgetActivation();
+
+    /// Draws the snapshot of a widget without proxy, grabbing it if needed.
+    void paintWidgetSnapshot(QPainter *painter);
+
+    NodeRenderKey renderCacheKey(QSizeF const &size, qreal const scale) const;
+
+    /// Paints the node into `_renderCache` when the key changed and blits it.
+    /**
+   * With a `SharedSceneCache` an image another scene painted under the same
+   * key is taken instead, and a new one is handed to the cache.
+   */
+    /// @returns `false` if the node must be painted directly.
+    bool paintCached(QPainter *painter);
 
 private:
     NodeId _nodeId;
@@ -89,5 +167,27 @@ private:
 
     // either nullptr or owned by parent QGraphicsItem
     QGraphicsProxyWidget *_proxyWidget;
+
+    /// The delegate widget while it is drawn from `_widgetSnapshot`.
+    QPointer<QWidget> _inactiveWidget;
+
+    QPixmap _widgetSnapshot;
+
+    /// The layout uses `NodeRole::WidgetSizeHint`, the widget is not created yet.
+    bool _widgetDeferred;
+
+    /// The resize cursor is set, see `hoverMoveEvent()`.
+    bool _resizeCursor;
+
+    mutable std::shared_ptr<NodeStyle const> _nodeStyle;
+
+    mutable unsigned int _nodeStyleRevision;
+
+    QPixmap _renderCache;
+
+    NodeRenderKey _renderCacheKey;
+
+    /// Bumped by `recycle()`; deferred calls for an earlier node do nothing.
+    unsigned int _generation;
 };
 } // namespace QtNodes
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <unordered_map>
 #include <vector>
 
@@ -18,6 +19,11 @@ class ConnectionGraphicsObject;
 class NodeGraphicsObject;
 
 /// Stores bool for hovering connections and resizing flag.
+/**
+ * Also keeps the number of connections of every port, so painting a node
+ * does not ask the model about its connectivity. The scene updates the
+ * counts as connections come and go.
+ */
 class NODE_EDITOR_PUBLIC NodeState
 {
 public:
@@ -38,6 +44,21 @@ public:
 
     void resetConnectionForReaction();
 
+    /// `0` for ports the state has not been told about.
+    std::size_t connectionCount(PortType portType, PortIndex index) const;
+
+    /// One bit per connected port, inputs first; ports past the 64th share bits.
+    quint64 connectedPortsMask() const;
+
+    /// Reads the connections of every port from the model.
+    void updateConnectionCounts();
+
+    /// Reads the connections of one port from the model.
+    void updateConnectionCount(PortType portType, PortIndex index);
+
+    /// Back to the state of a new node, for a recycled graphics object.
+    void reset();
+
 private:
     NodeGraphicsObject &_ngo;
 
@@ -48,5 +69,9 @@ private:
     // QPointer tracks the QObject inside and is automatically cleared
     // when the object is destroyed.
     QPointer<ConnectionGraphicsObject const> _connectionForReaction;
+
+    std::vector<std::size_t> _inConnectionCounts;
+
+    std::vector<std::size_t> _outConnectionCounts;
 };
 } // namespace QtNodes
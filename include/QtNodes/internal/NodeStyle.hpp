@@ -1,15 +1,19 @@
 #pragma once
 
+#include <QtCore/QMetaType>
 #include <QtGui/QColor>
 
+#include <memory>
+
 #include "Export.hpp"
 #include "Style.hpp"
 
 namespace QtNodes {
 
-class NODE_EDITOR_PUBLIC NodeStyle : public Style
+class NODE_EDITOR_CORE_PUBLIC NodeStyle : public Style
 {
 public:
+    /// A copy of the default style, parsed once from the resources.
     NodeStyle();
 
     NodeStyle(QString jsonText);
@@ -49,5 +53,16 @@ public:
     float ConnectionPointDiameter;
 
     float Opacity;
+
+    /// Levels of detail (`QStyleOptionGraphicsItem::levelOfDetailFromTransform`)
+    /// below which `DefaultNodePainter` simplifies nodes. `0` disables a tier.
+    float LabelsLevelOfDetail; ///< Caption and port labels are dropped.
+    float FlatLevelOfDetail;   ///< A flat box without ports replaces the gradient.
+    float DotLevelOfDetail;    ///< A plain filled rectangle, no outline.
+
+private:
+    static NodeStyle const &defaultStyle();
 };
 } // namespace QtNodes
+
+Q_DECLARE_METATYPE(std::shared_ptr<QtNodes::NodeStyle const>)
@@ -0,0 +1,284 @@
+#pragma once
+
+#include "AbstractGraphModel.hpp"
+#include "Export.hpp"
+#include "MemoryReport.hpp"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QPointF>
+#include <QtCore/QRectF>
+#include <QtCore/QSize>
+#include <QtCore/QString>
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class QFile;
+
+namespace QtNodes {
+
+/**
+ * A plain graph model keeping most of the graph in a scratch file on disk.
+ *
+ * Only the positions and sizes of the nodes stay in memory, so culling,
+ * `forEachNodeGeometry()` and a virtualized BasicGraphicsScene never touch
+ * the disk. Everything else lives in pages of `NodesPerPage` consecutive
+ * node ids: type, caption, port counts, the connections by either end and
+ * the saved internal data. At most `residentPageLimit()` pages are held in
+ * memory; the least recently used one is written back when another page is
+ * read. A page grown past its place in the file moves to the end, with room
+ * to grow, so the file stays within a small factor of the live data.
+ *
+ * `prefetch()` reads the pages around an area ahead of the scene, e.g. when
+ * connected to `BasicGraphicsScene::visibleSceneRectChanged`, and
+ * `prefetchNodes()` those of an evaluation frontier.
+ *
+ * Nodes behave as in DenseGraphModel: one input and one output port when
+ * created, inputs take one connection, outputs any number. The scratch file
+ * is not a save format, `save()` and `load()` use the JSON of DenseGraphModel
+ * with the internal data of every node.
+ *
+ * @throws std::runtime_error from any function reading a page when the
+ * scratch file cannot be created, read or written.
+ */
+class NODE_EDITOR_CORE_PUBLIC PagedGraphModel : public AbstractGraphModel
+{
+    Q_OBJECT
+
+public:
+    static constexpr std::size_t NodesPerPage = 256;
+
+public:
+    /// The scratch file is created in `storageDirectory`, the temporary directory if empty.
+    explicit PagedGraphModel(QString const &storageDirectory = QString(),
+                             QObject *parent = nullptr);
+
+    ~PagedGraphModel() override;
+
+    /// Pages held in memory, 1024 by default, at least 2.
+    void setResidentPageLimit(std::size_t const pages);
+
+    std::size_t residentPageLimit() const { return _residentPageLimit; }
+
+    std::size_t residentPageCount() const { return _pages.size(); }
+
+    std::size_t nodeCount() const { return _nodeCount; }
+
+    std::size_t graphConnectionCount() const { return _connectionCount; }
+
+    /// Writes every changed page to the scratch file, keeping them in memory.
+    void flush();
+
+    /// Empties the model and the scratch file and emits `modelReset`.
+    void clear() override;
+
+    QJsonObject save() const;
+
+    void load(QJsonObject const &json);
+
+    /// Resident columns and pages, and the size of the scratch file.
+    MemoryReport memoryReport() const;
+
+public Q_SLOTS:
+    /// Reads the pages of the nodes within `rect`, nearest to its center first.
+    /**
+   * Stops at half the resident limit, so the pages read do not push each
+   * other out.
+   */
+    void prefetch(QRectF const &rect);
+
+    /// Reads the pages of `nodeIds`, e.g. the next nodes to evaluate.
+    void prefetchNodes(std::vector<NodeId> const &nodeIds);
+
+public:
+    NodeId newNodeId() override { return _nextNodeId++; }
+
+    NodeId reserveNodeIds(std::size_t const count) override;
+
+    std::unordered_set<NodeId> allNodeIds() const override;
+
+    std::unordered_set<ConnectionId> allConnectionIds(NodeId const nodeId) const override;
+
+    std::unordered_set<ConnectionId> connections(NodeId nodeId,
+                                                 PortType portType,
+                                                 PortIndex portIndex) const override;
+
+    void forEachConnection(NodeId nodeId,
+                           PortType portType,
+                           PortIndex portIndex,
+                           ConnectionVisitor const &visitor) const override;
+
+    void forEachNodeConnection(NodeId nodeId, ConnectionVisitor const &visitor) const override;
+
+    /// Reads every page holding nodes once.
+    void forEachGraphConnection(ConnectionVisitor const &visitor) const override;
+
+    std::size_t connectionCount(NodeId nodeId,
+                                PortType portType,
+                                PortIndex portIndex) const override;
+
+    bool connectionExists(ConnectionId const connectionId) const override;
+
+    NodeId addNode(QString const nodeType = QString()) override;
+
+    /// Both ports exist, the nodes differ and the input is still free.
+    bool connectionPossible(ConnectionId const connectionId) const override;
+
+    void addConnection(ConnectionId const connectionId) override;
+
+    bool nodeExists(NodeId const nodeId) const override;
+
+    QVariant nodeData(NodeId nodeId, NodeRole role) const override;
+
+    /// Walks the resident position and size columns.
+    void forEachNodeGeometry(NodeGeometryVisitor const &visitor) const override;
+
+    void nodePositions(std::vector<NodeId> const &nodeIds,
+                       std::vector<QPointF> &positions) const override;
+
+    void nodeSizes(std::vector<NodeId> const &nodeIds, std::vector<QSize> &sizes) const override;
+
+    /// Position, size, caption, internal data and port counts can be set.
+    bool setNodeData(NodeId nodeId, NodeRole role, QVariant value) override;
+
+    void moveNodes(std::vector<NodeId> const &nodeIds, QPointF const &delta) override;
+
+    void setNodePositions(std::vector<std::pair<NodeId, QPointF>> const &positions) override;
+
+    QVariant portData(NodeId nodeId,
+                      PortType portType,
+                      PortIndex portIndex,
+                      PortRole role) const override;
+
+    bool setPortData(NodeId nodeId,
+                     PortType portType,
+                     PortIndex portIndex,
+                     QVariant const &value,
+                     PortRole role = PortRole::Data) override;
+
+    bool deleteConnection(ConnectionId const connectionId) override;
+
+    /// Rewrites the connections in place.
+    void remapConnections(ConnectionRemap const &remap) override;
+
+    bool deleteNode(NodeId const nodeId) override;
+
+    QJsonObject saveNode(NodeId const nodeId) const override;
+
+    void loadNode(QJsonObject const &nodeJson) override;
+
+private:
+    /// The paged part of a node.
+    struct NodeEntry
+    {
+        QString type;
+
+        QString caption;
+
+        unsigned int inPorts = 1;
+
+        unsigned int outPorts = 1;
+
+        /// Connections by their output, respectively input, end at this node.
+        std::vector<ConnectionId> out;
+
+        std::vector<ConnectionId> in;
+
+        /// Compact JSON of the internal data, empty if none was set.
+        QByteArray internalData;
+    };
+
+    struct Page
+    {
+        std::vector<NodeEntry> entries;
+
+        bool dirty = false;
+
+        std::list<std::size_t>::iterator lru;
+    };
+
+    /// Place of a page in the scratch file, `size` 0 for pages never written.
+    struct PageExtent
+    {
+        qint64 offset = 0;
+        qint64 size = 0;
+        qint64 capacity = 0;
+    };
+
+    static std::size_t pageOf(NodeId const nodeId) { return nodeId / NodesPerPage; }
+
+    /// Reads the page if needed and marks it most recently used.
+    /**
+   * The reference is only valid until the next page is read; callers copy
+   * what they need before calling out.
+   */
+    Page &page(std::size_t const pageIndex) const;
+
+    NodeEntry const &entry(NodeId const nodeId) const;
+
+    /// Marks the page of the node changed.
+    NodeEntry &writableEntry(NodeId const nodeId);
+
+    void evict() const;
+
+    void writePage(std::size_t const pageIndex, Page &page) const;
+
+    /// Connections of one port, or of all ports for `InvalidPortIndex`, copied out of the page.
+    std::vector<ConnectionId> portConnections(NodeId const nodeId,
+                                              PortType const portType,
+                                              PortIndex const portIndex) const;
+
+    void insertNode(NodeId const nodeId, QString const &nodeType);
+
+    void removeNode(NodeId const nodeId);
+
+    /// Table updates of `addConnection()` and `deleteConnection()`, without signals.
+    bool insertConnection(ConnectionId const &connectionId);
+
+    bool eraseConnection(ConnectionId const &connectionId);
+
+    bool setPortCount(NodeId const nodeId, PortType const portType, unsigned int const count);
+
+    /// Model rectangle of the node, at least one unit wide and high.
+    QRectF nodeRect(NodeId const nodeId) const;
+
+    /// Grows the bounds of the page of `nodeId` to its rectangle.
+    void updatePageBounds(NodeId const nodeId);
+
+private:
+    NodeId _nextNodeId;
+
+    std::size_t _nodeCount;
+
+    std::size_t _connectionCount;
+
+    /// Resident columns by node id.
+    std::vector<bool> _exists;
+
+    std::vector<QPointF> _positions;
+
+    std::vector<QSize> _sizes;
+
+    /// Bounds of the nodes of every page, only growing until the page is written.
+    mutable std::vector<QRectF> _pageBounds;
+
+    std::unique_ptr<QFile> _file;
+
+    mutable std::vector<PageExtent> _extents;
+
+    mutable qint64 _fileEnd;
+
+    mutable std::unordered_map<std::size_t, Page> _pages;
+
+    /// Resident page indices, most recently used first.
+    mutable std::list<std::size_t> _lru;
+
+    std::size_t _residentPageLimit;
+};
+
+} // namespace QtNodes
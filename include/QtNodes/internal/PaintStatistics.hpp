@@ -0,0 +1,128 @@
+#pragma once
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QJsonObject>
+#include <QtCore/QStringList>
+
+#include "Export.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace QtNodes {
+
+/**
+ * Frame times and per-frame counts of the expensive calls of a view.
+ *
+ * A `GraphicsView` with statistics enabled activates its collector while it
+ * handles viewport events; the instrumented calls open a `Scope` that times
+ * them for the active collector and costs a null check otherwise.
+ */
+class NODE_EDITOR_PUBLIC PaintStatistics
+{
+public:
+    enum Category {
+        NodePaint,
+        ConnectionPaint,
+        Background,
+        Shape, ///< `shape()` for painting, hit tests and collisions.
+        CategoryCount
+    };
+
+    struct Counter
+    {
+        std::uint64_t calls = 0;
+        std::int64_t nanoseconds = 0;
+    };
+
+    /// Times one call for the active collector, if any.
+    class NODE_EDITOR_PUBLIC Scope
+    {
+    public:
+        explicit Scope(Category const category);
+
+        ~Scope();
+
+        Scope(Scope const &) = delete;
+        Scope &operator=(Scope const &) = delete;
+
+    private:
+        PaintStatistics *_statistics;
+        Category _category;
+        QElapsedTimer _timer;
+    };
+
+    /// Makes a collector the active one of the calling thread for its lifetime.
+    class NODE_EDITOR_PUBLIC Activation
+    {
+    public:
+        explicit Activation(PaintStatistics *statistics);
+
+        ~Activation();
+
+        Activation(Activation const &) = delete;
+        Activation &operator=(Activation const &) = delete;
+
+    private:
+        PaintStatistics *_previous;
+    };
+
+    /// Frames kept for the rate and the percentiles.
+    static constexpr std::size_t History = 240;
+
+public:
+    PaintStatistics();
+
+    static PaintStatistics *active();
+
+    void beginFrame();
+
+    void endFrame();
+
+    std::uint64_t frameCount() const { return _frames; }
+
+    /// Over the kept frames, `0` before the second one.
+    double framesPerSecond() const;
+
+    /// Frame time in milliseconds below which `percentile` (0 to 100) of the kept frames are.
+    double frameTimePercentile(double const percentile) const;
+
+    /// Counts of the last finished frame.
+    Counter const &lastFrame(Category const category) const { return _lastFrame[category]; }
+
+    /// Counts since the last `reset()`.
+    Counter const &total(Category const category) const { return _total[category]; }
+
+    void reset();
+
+    static QString categoryName(Category const category);
+
+    QJsonObject toJson() const;
+
+    /// A few lines for an overlay.
+    QStringList summary() const;
+
+private:
+    void add(Category const category, std::int64_t const nanoseconds);
+
+private:
+    using Counters = std::array<Counter, CategoryCount>;
+
+    Counters _frame;
+    Counters _lastFrame;
+    Counters _total;
+
+    QElapsedTimer _clock;
+
+    std::int64_t _frameStart;
+
+    std::uint64_t _frames;
+
+    /// Rings of `History` entries, indexed by `_frames`.
+    std::vector<double> _frameTimes;
+    std::vector<std::int64_t> _frameStarts;
+};
+
+} // namespace QtNodes
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "BatchEvaluator.hpp"
+#include "Definitions.hpp"
+#include "Export.hpp"
+
+#include <QtCore/QJsonObject>
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace QtNodes {
+
+class DataFlowGraphModel;
+class NodeDelegateModelRegistry;
+
+/// One part of a partitioned scene and the ports its data crosses the cuts at.
+struct PartitionSpec
+{
+    /// The nodes of the partition and the connections between them, as `save()` writes.
+    QJsonObject scene;
+
+    /// Ports receiving values: the caller's inputs, then the inputs behind cut connections.
+    std::vector<BatchEvaluator::Port> inputs;
+
+    /// Ports whose values are read: the caller's outputs, then the sources of cut connections.
+    std::vector<BatchEvaluator::Port> outputs;
+};
+
+/**
+ * Runs the partitions of a PartitionedEvaluator somewhere.
+ *
+ * All calls come from the thread running the evaluator. `post()` must not
+ * wait for the evaluation, so partitions posted together run concurrently;
+ * `wait()` collects the outputs of the last post.
+ */
+class NODE_EDITOR_CORE_PUBLIC PartitionTransport
+{
+public:
+    virtual ~PartitionTransport() = default;
+
+    /// Prepares one worker per partition, replacing the workers of a previous call.
+    virtual void open(std::vector<PartitionSpec> const &partitions) = 0;
+
+    /// Sends one value per input port of the partition.
+    virtual void post(std::size_t const partition, BatchEvaluator::Values const &inputs) = 0;
+
+    /// @returns one value per output port; throws what went wrong in the worker.
+    virtual BatchEvaluator::Values wait(std::size_t const partition) = 0;
+};
+
+/**
+ * Keeps every partition in a DataFlowGraphModel of its own thread.
+ *
+ * Values cross the cuts as the same `std::shared_ptr<NodeData>`, nothing is
+ * copied or serialized.
+ */
+class NODE_EDITOR_CORE_PUBLIC LocalPartitionTransport : public PartitionTransport
+{
+public:
+    explicit LocalPartitionTransport(std::shared_ptr<NodeDelegateModelRegistry> registry);
+
+    /// Stops the worker threads.
+    ~LocalPartitionTransport() override;
+
+    void open(std::vector<PartitionSpec> const &partitions) override;
+
+    void post(std::size_t const partition, BatchEvaluator::Values const &inputs) override;
+
+    BatchEvaluator::Values wait(std::size_t const partition) override;
+
+private:
+    class Worker;
+
+    std::shared_ptr<NodeDelegateModelRegistry> _registry;
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+};
+
+/**
+ * Evaluates a data flow scene split into partitions along cut connections.
+ *
+ * The nodes are ordered topologically, keeping chains together, and the
+ * order is cut into `partitionCount` runs of about equal size, so every
+ * cut connection leads to a later partition. A run evaluates the partitions
+ * whose upstream partitions are done together through the transport, then
+ * hands the values at the cuts on to the partitions behind them.
+ *
+ * Ports are those of BatchEvaluator, by the node ids of the whole scene.
+ * The scene must be free of cycles.
+ */
+class NODE_EDITOR_CORE_PUBLIC PartitionedEvaluator
+{
+public:
+    /// @throws std::logic_error if the scene has a cycle.
+    PartitionedEvaluator(QJsonObject scene, std::size_t const partitionCount);
+
+    /// Partitions `model.save()`; `collect()` writes the outputs back into `model`.
+    /**
+   * Runs on a LocalPartitionTransport with the registry of `model` until
+   * another transport is set.
+   */
+    PartitionedEvaluator(DataFlowGraphModel &model, std::size_t const partitionCount);
+
+    void setTransport(std::shared_ptr<PartitionTransport> transport);
+
+    void setInputPorts(std::vector<BatchEvaluator::Port> ports);
+
+    void setOutputPorts(std::vector<BatchEvaluator::Port> ports);
+
+public:
+    std::size_t partitionCount() const { return _nodes.size(); }
+
+    /// The node ids of every partition, in topological order.
+    std::vector<std::vector<NodeId>> const &partitions() const { return _nodes; }
+
+    /// Connections between different partitions.
+    std::vector<ConnectionId> const &cutConnections() const { return _cuts; }
+
+    /// Evaluates one input set, @returns one value per output port.
+    /**
+   * Opens the transport on the first call and after the ports changed.
+   * Rethrows what the transport throws.
+   */
+    BatchEvaluator::Values run(BatchEvaluator::Values const &inputs);
+
+    /// Injects `outputs` at the output ports of the model passed to the constructor.
+    /**
+   * Values of `Out` ports replace the port's output, those of `In` ports
+   * are delivered as if they came from a connection; the model propagates
+   * them as usual.
+   */
+    void collect(BatchEvaluator::Values const &outputs);
+
+private:
+    void split(std::size_t const partitionCount);
+
+    /// Builds the specs and the routes of the cut values.
+    void prepare();
+
+private:
+    QJsonObject _scene;
+
+    DataFlowGraphModel *_model;
+
+    std::shared_ptr<PartitionTransport> _transport;
+
+    std::vector<BatchEvaluator::Port> _inputPorts;
+
+    std::vector<BatchEvaluator::Port> _outputPorts;
+
+    std::vector<std::vector<NodeId>> _nodes;
+
+    std::unordered_map<NodeId, std::size_t> _partitionOf;
+
+    std::vector<ConnectionId> _cuts;
+
+    bool _prepared;
+
+    std::vector<PartitionSpec> _specs;
+
+    /// Where a caller's input goes: partition and input slot.
+    std::vector<std::pair<std::size_t, std::size_t>> _inputRoutes;
+
+    /// Where a caller's output comes from: partition and output slot.
+    std::vector<std::pair<std::size_t, std::size_t>> _outputRoutes;
+
+    /// A value crossing a cut: from an output slot to an input slot.
+    struct CutRoute
+    {
+        std::size_t fromPartition;
+        std::size_t fromSlot;
+        std::size_t toPartition;
+        std::size_t toSlot;
+    };
+
+    std::vector<CutRoute> _cutRoutes;
+};
+
+} // namespace QtNodes
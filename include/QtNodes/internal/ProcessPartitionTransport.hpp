@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Export.hpp"
+#include "PartitionedEvaluator.hpp"
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace QtNodes {
+
+class NodeDelegateModelRegistry;
+
+/**
+ * Runs every partition in a worker process of its own.
+ *
+ * A worker is any program calling `PartitionWorker::exec()`; it talks to the
+ * coordinator over its standard input and output, so a program such as
+ * `ssh` starting the worker on another host works the same. Values are
+ * turned into bytes by NodeDataCodec, which both sides register the same
+ * types with.
+ *
+ * For workers on the same machine the bytes go through a shared memory
+ * segment per partition, written by the coordinator before a post and by
+ * the worker before its answer, and decoded in place. Values not fitting
+ * the segment, and all values once shared memory is turned off, travel
+ * inline with the messages.
+ *
+ * @throws std::runtime_error from `open()` and `wait()` when a worker cannot
+ * be started, fails or stops answering.
+ */
+class NODE_EDITOR_CORE_PUBLIC ProcessPartitionTransport : public PartitionTransport
+{
+public:
+    /// Every partition runs `program` with `arguments`.
+    explicit ProcessPartitionTransport(QString program, QStringList arguments = QStringList());
+
+    /// Closes the input of the workers and waits for them to exit.
+    ~ProcessPartitionTransport() override;
+
+    /// On by default; turn it off for workers on other hosts. Applies from the next `open()`.
+    void setSharedMemory(bool const enabled) { _sharedMemory = enabled; }
+
+    bool sharedMemory() const { return _sharedMemory; }
+
+    /// Bytes of the segment of every partition, 16 MiB by default.
+    void setSharedMemorySize(std::size_t const bytes) { _sharedMemorySize = bytes; }
+
+    std::size_t sharedMemorySize() const { return _sharedMemorySize; }
+
+    /// Milliseconds to wait for a worker to start or answer, -1 for no limit (the default).
+    void setTimeout(int const milliseconds) { _timeout = milliseconds; }
+
+    int timeout() const { return _timeout; }
+
+public:
+    void open(std::vector<PartitionSpec> const &partitions) override;
+
+    void post(std::size_t const partition, BatchEvaluator::Values const &inputs) override;
+
+    BatchEvaluator::Values wait(std::size_t const partition) override;
+
+private:
+    struct Worker;
+
+    QString _program;
+
+    QStringList _arguments;
+
+    bool _sharedMemory;
+
+    std::size_t _sharedMemorySize;
+
+    int _timeout;
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+};
+
+/// The worker side of ProcessPartitionTransport.
+class NODE_EDITOR_CORE_PUBLIC PartitionWorker
+{
+public:
+    /// Serves a coordinator over standard input and output until the input closes.
+    /**
+   * Call it from `main()` once the QCoreApplication exists and the data types
+   * are registered with NodeDataCodec. Errors of the partition are sent to
+   * the coordinator and do not end the loop.
+   *
+   * @returns the exit code for `main()`.
+   */
+    static int exec(std::shared_ptr<NodeDelegateModelRegistry> registry);
+};
+
+} // namespace QtNodes
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "Export.hpp"
+#include "NodeDelegateModel.hpp"
+
+#include <QtCore/QJsonObject>
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+#include <QtCore/QRectF>
+#include <QtCore/QString>
+#include <QtCore/QThreadPool>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace QtNodes {
+
+class BasicGraphicsScene;
+class DataFlowGraphModel;
+
+/**
+ * Loads a project file into a DataFlowGraphModel without blocking the GUI.
+ *
+ * The file is read and parsed on a worker thread, which also orders the
+ * nodes by their distance to the area the scene shows. The graph is then
+ * restored on the thread of the model in chunks, one `load()` batch per
+ * event loop turn, each sized to stay within `frameBudget()`. A connection
+ * comes with the chunk holding the later of its two nodes, so the visible
+ * part of the graph is complete first while the scene keeps painting.
+ *
+ * Delegates are loaded by the model as in `DataFlowGraphModel::load()`,
+ * on worker threads where `parallelSerialization()` and the delegates
+ * allow it. Binary scenes are restored in a single step by
+ * `DataFlowGraphModel::loadBinaryFile()`, which defers the delegates anyway.
+ */
+class NODE_EDITOR_PUBLIC ProjectLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// `scene` only tells which area to restore first and may be `nullptr`.
+    ProjectLoader(DataFlowGraphModel &model,
+                  BasicGraphicsScene const *scene = nullptr,
+                  QObject *parent = nullptr);
+
+    /// Cancels a running load.
+    ~ProjectLoader() override;
+
+    /// Milliseconds of restoring per event loop turn, 8 by default.
+    void setFrameBudget(int const milliseconds) { _frameBudget = milliseconds; }
+
+    int frameBudget() const { return _frameBudget; }
+
+    /// Starts loading `fileName`, cancelling a load still running.
+    /**
+   * The graph of the model is cleared once the file has been parsed, so it
+   * stays as it was while reading fails or is cancelled.
+   */
+    void start(QString const &fileName);
+
+    /// Stops the load; a partly restored graph is cleared.
+    void cancel();
+
+    /// `true` from `start()` until one of the final signals.
+    bool running() const { return _running; }
+
+Q_SIGNALS:
+    /// Nodes and connections restored so far, out of `total`.
+    void progress(std::size_t restored, std::size_t total);
+
+    void finished();
+
+    void cancelled();
+
+    /// The file could not be read or holds an unknown delegate model.
+    /**
+   * A graph restored in part is cleared, one not yet touched is kept.
+   */
+    void failed(QString const &reason);
+
+public:
+    /// The parsed file in restoring order, built on the worker.
+    struct Parsed
+    {
+        bool binary = false;
+
+        QString error;
+
+        std::vector<QJsonObject> nodes;
+
+        /// Connections by the position of their later node in `nodes`.
+        std::vector<std::pair<std::size_t, ConnectionId>> connections;
+    };
+
+private:
+    void onParsed(std::uint64_t const generation, std::shared_ptr<Parsed> parsed);
+
+    /// Restores the next chunk and schedules the one after it.
+    void restoreChunk();
+
+    void fail(QString const &reason);
+
+private:
+    DataFlowGraphModel &_model;
+
+    QPointer<BasicGraphicsScene const> _scene;
+
+    int _frameBudget;
+
+    bool _running;
+
+    QString _fileName;
+
+    /// Bumped by `start()` and `cancel()`, older parse results are dropped.
+    std::uint64_t _generation;
+
+    CancellationToken _parseToken;
+
+    std::shared_ptr<Parsed> _parsed;
+
+    std::size_t _nextNode;
+
+    std::size_t _nextConnection;
+
+    /// Nodes per chunk, adapted to the time the last chunk took.
+    std::size_t _chunkSize;
+
+    QThreadPool _pool;
+};
+
+} // namespace QtNodes
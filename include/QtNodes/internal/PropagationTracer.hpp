@@ -0,0 +1,125 @@
+#pragma once
+
+#include "Definitions.hpp"
+#include "Export.hpp"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QJsonObject>
+#include <QtCore/QString>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace QtNodes {
+
+class NodeDelegateModel;
+
+/**
+ * Records what a `DataFlowGraphModel` propagation touched.
+ *
+ * Spans cover the delivery of an output port, every `setInData()` call and
+ * whole scheduled flushes; the asynchronous computations between
+ * `computingStarted` and `computingFinished` are recorded as async events.
+ * Recording is thread safe, parallel flushes report their worker threads.
+ *
+ * `toChromeTrace()` produces the Trace Event Format read by
+ * chrome://tracing and Perfetto.
+ */
+class NODE_EDITOR_CORE_PUBLIC PropagationTracer
+{
+public:
+    enum class Phase {
+        Complete,   ///< A span with a duration.
+        AsyncBegin, ///< Start of a computation, matched by node id.
+        AsyncEnd
+    };
+
+    struct Event
+    {
+        Phase phase;
+        char const *name;
+        NodeId nodeId;
+        QString typeName;
+        PortType portType;
+        PortIndex portIndex;
+
+        /// Nanoseconds since the tracer was created.
+        std::int64_t start;
+        std::int64_t duration;
+
+        /// Small per-tracer number of the recording thread.
+        int thread;
+    };
+
+    /// Times a scope for a tracer, does nothing for `nullptr`.
+    /**
+   * The delegate type name is only looked up when tracing; `name` must be
+   * a string literal.
+   */
+    class NODE_EDITOR_CORE_PUBLIC Span
+    {
+    public:
+        Span(PropagationTracer *tracer,
+             char const *name,
+             NodeId const nodeId = InvalidNodeId,
+             NodeDelegateModel const *delegate = nullptr,
+             PortType const portType = PortType::None,
+             PortIndex const portIndex = InvalidPortIndex);
+
+        ~Span();
+
+        Span(Span const &) = delete;
+        Span &operator=(Span const &) = delete;
+
+    private:
+        PropagationTracer *_tracer;
+        Event _event;
+    };
+
+public:
+    /// Events past `capacity` are counted in `droppedEvents()` instead.
+    explicit PropagationTracer(std::size_t const capacity = 1000000);
+
+    std::int64_t now() const { return _clock.nsecsElapsed(); }
+
+    void record(Event event);
+
+    /// Records an async begin or end for `delegate` of node `nodeId`.
+    void recordAsync(Phase const phase,
+                     char const *name,
+                     NodeId const nodeId,
+                     NodeDelegateModel const *delegate);
+
+    /// A copy, safe while other threads record.
+    std::vector<Event> events() const;
+
+    std::size_t droppedEvents() const;
+
+    void clear();
+
+    QJsonObject toChromeTrace() const;
+
+    bool writeChromeTrace(QString const &fileName) const;
+
+private:
+    int threadNumber();
+
+private:
+    std::size_t _capacity;
+
+    QElapsedTimer _clock;
+
+    mutable std::mutex _mutex;
+
+    std::vector<Event> _events;
+
+    std::size_t _dropped;
+
+    std::unordered_map<std::thread::id, int> _threads;
+};
+
+} // namespace QtNodes
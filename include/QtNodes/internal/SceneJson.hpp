@@ -0,0 +1,109 @@
+#pragma once
+
+#include "ConnectionIdUtils.hpp"
+#include "Definitions.hpp"
+
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QJsonValue>
+#include <QtCore/QPointF>
+
+#include <vector>
+
+namespace QtNodes {
+
+/*
+ * The two layouts of the scene JSON.
+ *
+ * By default every connection is an object with four named keys, see
+ * `toJson(ConnectionId)`, and every position is `{"x": ..., "y": ...}`.
+ * The compact layout writes all connections of a scene as one flat array
+ * of integers, four per connection in the order `outNodeId, outPortIndex,
+ * inNodeId, inPortIndex`, and positions as `[x, y]`. The key strings are
+ * most of the bytes and of the parsing of a large scene. Readers take
+ * either layout, the type of the values tells them apart.
+ */
+
+inline QJsonValue pointToJson(QPointF const &point, bool const compact = false)
+{
+    if (compact)
+        return QJsonArray{point.x(), point.y()};
+
+    QJsonObject pointJson;
+    pointJson["x"] = point.x();
+    pointJson["y"] = point.y();
+
+    return pointJson;
+}
+
+/// Reads `[x, y]` as well as `{"x": ..., "y": ...}`.
+inline QPointF pointFromJson(QJsonValue const &pointJson)
+{
+    if (pointJson.isArray()) {
+        QJsonArray const array = pointJson.toArray();
+
+        return QPointF(array.at(0).toDouble(), array.at(1).toDouble());
+    }
+
+    QJsonObject const object = pointJson.toObject();
+
+    return QPointF(object["x"].toDouble(), object["y"].toDouble());
+}
+
+inline void appendConnectionJson(QJsonArray &connectionsJson,
+                                 ConnectionId const &connectionId,
+                                 bool const compact = false)
+{
+    if (!compact) {
+        connectionsJson.append(toJson(connectionId));
+        return;
+    }
+
+    connectionsJson.append(static_cast<qint64>(connectionId.outNodeId));
+    connectionsJson.append(static_cast<qint64>(connectionId.outPortIndex));
+    connectionsJson.append(static_cast<qint64>(connectionId.inNodeId));
+    connectionsJson.append(static_cast<qint64>(connectionId.inPortIndex));
+}
+
+/// Calls `function(ConnectionId)` for every connection of either layout.
+template<typename Function>
+void forEachConnectionJson(QJsonArray const &connectionsJson, Function &&function)
+{
+    if (connectionsJson.isEmpty())
+        return;
+
+    if (!connectionsJson.first().isDouble()) {
+        for (QJsonValue const connectionJson : connectionsJson) {
+            function(fromJson(connectionJson.toObject()));
+        }
+
+        return;
+    }
+
+    // A truncated last tuple is ignored.
+    for (int i = 0; i + 3 < connectionsJson.size(); i += 4) {
+        ConnectionId const connectionId{
+            static_cast<NodeId>(connectionsJson.at(i).toInt(InvalidNodeId)),
+            static_cast<PortIndex>(connectionsJson.at(i + 1).toInt(InvalidPortIndex)),
+            static_cast<NodeId>(connectionsJson.at(i + 2).toInt(InvalidNodeId)),
+            static_cast<PortIndex>(connectionsJson.at(i + 3).toInt(InvalidPortIndex))};
+
+        function(connectionId);
+    }
+}
+
+inline std::vector<ConnectionId> connectionsFromJson(QJsonArray const &connectionsJson)
+{
+    std::vector<ConnectionId> connectionIds;
+
+    bool const compact = !connectionsJson.isEmpty() && connectionsJson.first().isDouble();
+    connectionIds.reserve(compact ? connectionsJson.size() / 4 : connectionsJson.size());
+
+    forEachConnectionJson(connectionsJson, [&connectionIds](ConnectionId const &connectionId) {
+        connectionIds.push_back(connectionId);
+    });
+
+    return connectionIds;
+}
+
+} // namespace QtNodes
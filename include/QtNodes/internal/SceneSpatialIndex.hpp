@@ -0,0 +1,342 @@
+#pragma once
+
+#include <QtCore/QRectF>
+#include <QtCore/QtGlobal>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace QtNodes {
+
+/**
+ * Uniform grid over scene rectangles, used by BasicGraphicsScene for hit
+ * testing when `SpatialIndexMode::UniformGrid` is enabled.
+ *
+ * Each key is stored in every cell its rectangle overlaps. Moving a key
+ * within the cells it already occupies only rewrites the stored rectangle,
+ * so dragging a node does not touch the cell tables at all in most frames.
+ */
+template<typename Key>
+class UniformGridIndex
+{
+public:
+    explicit UniformGridIndex(qreal cellSize = 256.0)
+        : _cellSize(cellSize > 0.0 ? cellSize : 256.0)
+    {}
+
+public:
+    qreal cellSize() const { return _cellSize; }
+
+    /// Changes the cell size; drops all the stored keys.
+    void setCellSize(qreal cellSize)
+    {
+        _cellSize = cellSize > 0.0 ? cellSize : 256.0;
+        clear();
+    }
+
+    void clear()
+    {
+        _entries.clear();
+        _cells.clear();
+    }
+
+    bool empty() const { return _entries.empty(); }
+
+    std::size_t size() const { return _entries.size(); }
+
+    /// The stored rectangle of `key`, `nullptr` for unknown keys.
+    QRectF const *rect(Key const &key) const
+    {
+        auto it = _entries.find(key);
+
+        return it != _entries.end() ? &it->second.rect : nullptr;
+    }
+
+    /// Inserts `key` or updates its rectangle if the key is already known.
+    void insert(Key const &key, QRectF const &rect)
+    {
+        CellRange const range = cellRange(rect);
+
+        auto it = _entries.find(key);
+
+        if (it != _entries.end()) {
+            it->second.rect = rect;
+
+            if (it->second.range == range)
+                return;
+
+            removeFromCells(key, it->second.range);
+            it->second.range = range;
+        } else {
+            _entries.emplace(key, Entry{rect, range});
+        }
+
+        for (int y = range.y0; y <= range.y1; ++y) {
+            for (int x = range.x0; x <= range.x1; ++x) {
+                _cells[cellKey(x, y)].push_back(key);
+            }
+        }
+    }
+
+    void remove(Key const &key)
+    {
+        auto it = _entries.find(key);
+
+        if (it == _entries.end())
+            return;
+
+        removeFromCells(key, it->second.range);
+
+        _entries.erase(it);
+    }
+
+    /// Calls `visitor(key, rect)` once for every key intersecting `rect`.
+    template<typename Visitor>
+    void query(QRectF const &rect, Visitor &&visitor) const
+    {
+        CellRange const range = cellRange(rect);
+
+        for (int y = range.y0; y <= range.y1; ++y) {
+            for (int x = range.x0; x <= range.x1; ++x) {
+                auto cellIt = _cells.find(cellKey(x, y));
+
+                if (cellIt == _cells.end())
+                    continue;
+
+                for (Key const &key : cellIt->second) {
+                    Entry const &entry = _entries.at(key);
+
+                    // A key spanning several cells is reported only from the
+                    // first cell shared by the key and the query.
+                    int const firstX = std::max(entry.range.x0, range.x0);
+                    int const firstY = std::max(entry.range.y0, range.y0);
+
+                    if (firstX != x || firstY != y)
+                        continue;
+
+                    if (entry.rect.intersects(rect) || rect.contains(entry.rect.topLeft()))
+                        visitor(key, entry.rect);
+                }
+            }
+        }
+    }
+
+    /// Calls `visitor(key, rect)` for every key whose rectangle contains `point`.
+    template<typename Visitor>
+    void query(QPointF const &point, Visitor &&visitor) const
+    {
+        auto cellIt = _cells.find(cellKey(cellCoord(point.x()), cellCoord(point.y())));
+
+        if (cellIt == _cells.end())
+            return;
+
+        for (Key const &key : cellIt->second) {
+            Entry const &entry = _entries.at(key);
+
+            if (entry.rect.contains(point))
+                visitor(key, entry.rect);
+        }
+    }
+
+private:
+    struct CellRange
+    {
+        int x0;
+        int y0;
+        int x1;
+        int y1;
+
+        bool operator==(CellRange const &other) const
+        {
+            return x0 == other.x0 && y0 == other.y0 && x1 == other.x1 && y1 == other.y1;
+        }
+    };
+
+    struct Entry
+    {
+        QRectF rect;
+        CellRange range;
+    };
+
+    int cellCoord(qreal v) const { return static_cast<int>(std::floor(v / _cellSize)); }
+
+    CellRange cellRange(QRectF const &rect) const
+    {
+        QRectF const r = rect.normalized();
+
+        return CellRange{cellCoord(r.left()),
+                         cellCoord(r.top()),
+                         cellCoord(r.right()),
+                         cellCoord(r.bottom())};
+    }
+
+    static qint64 cellKey(int x, int y)
+    {
+        return (static_cast<qint64>(x) << 32) | static_cast<quint32>(y);
+    }
+
+    void removeFromCells(Key const &key, CellRange const &range)
+    {
+        for (int y = range.y0; y <= range.y1; ++y) {
+            for (int x = range.x0; x <= range.x1; ++x) {
+                auto cellIt = _cells.find(cellKey(x, y));
+
+                if (cellIt == _cells.end())
+                    continue;
+
+                auto &keys = cellIt->second;
+                auto keyIt = std::find(keys.begin(), keys.end(), key);
+
+                if (keyIt != keys.end()) {
+                    *keyIt = keys.back();
+                    keys.pop_back();
+                }
+
+                if (keys.empty())
+                    _cells.erase(cellIt);
+            }
+        }
+    }
+
+private:
+    qreal _cellSize;
+
+    std::unordered_map<Key, Entry> _entries;
+
+    std::unordered_map<qint64, std::vector<Key>> _cells;
+};
+
+/**
+ * Bounds of a set of rectangles, maintained as they are inserted, moved and removed.
+ *
+ * Every rectangle counts towards the grid column of its left and right edge
+ * and the row of its top and bottom edge. `bounds()` spans the outermost
+ * occupied columns and rows, so it is exact up to one cell on each side, and
+ * removing the outermost rectangle only drops a count instead of scanning
+ * the others. A move within the same cells changes nothing.
+ */
+template<typename Key>
+class OccupancyBounds
+{
+public:
+    explicit OccupancyBounds(qreal cellSize = 64.0)
+        : _cellSize(cellSize > 0.0 ? cellSize : 64.0)
+    {}
+
+public:
+    qreal cellSize() const { return _cellSize; }
+
+    void clear()
+    {
+        _entries.clear();
+        _left.clear();
+        _top.clear();
+        _right.clear();
+        _bottom.clear();
+    }
+
+    bool empty() const { return _entries.empty(); }
+
+    /// Inserts `key` or moves it to `rect`.
+    void insert(Key const &key, QRectF const &rect)
+    {
+        QRectF const r = rect.normalized();
+
+        Cells const cells{cellCoord(r.left()),
+                          cellCoord(r.top()),
+                          cellCoord(r.right()),
+                          cellCoord(r.bottom())};
+
+        auto it = _entries.find(key);
+
+        if (it != _entries.end()) {
+            if (it->second == cells)
+                return;
+
+            drop(it->second);
+            it->second = cells;
+        } else {
+            _entries.emplace(key, cells);
+        }
+
+        ++_left[cells.x0];
+        ++_top[cells.y0];
+        ++_right[cells.x1];
+        ++_bottom[cells.y1];
+    }
+
+    void remove(Key const &key)
+    {
+        auto it = _entries.find(key);
+
+        if (it == _entries.end())
+            return;
+
+        drop(it->second);
+
+        _entries.erase(it);
+    }
+
+    /// The occupied cells, a null rectangle when empty.
+    QRectF bounds() const
+    {
+        if (_entries.empty())
+            return QRectF();
+
+        qreal const left = _left.begin()->first * _cellSize;
+        qreal const top = _top.begin()->first * _cellSize;
+        qreal const right = (_right.rbegin()->first + 1) * _cellSize;
+        qreal const bottom = (_bottom.rbegin()->first + 1) * _cellSize;
+
+        return QRectF(left, top, right - left, bottom - top);
+    }
+
+private:
+    struct Cells
+    {
+        int x0;
+        int y0;
+        int x1;
+        int y1;
+
+        bool operator==(Cells const &other) const
+        {
+            return x0 == other.x0 && y0 == other.y0 && x1 == other.x1 && y1 == other.y1;
+        }
+    };
+
+    using Counts = std::map<int, std::size_t>;
+
+    int cellCoord(qreal v) const { return static_cast<int>(std::floor(v / _cellSize)); }
+
+    static void drop(Counts &counts, int const cell)
+    {
+        auto it = counts.find(cell);
+
+        if (it != counts.end() && --it->second == 0)
+            counts.erase(it);
+    }
+
+    void drop(Cells const &cells)
+    {
+        drop(_left, cells.x0);
+        drop(_top, cells.y0);
+        drop(_right, cells.x1);
+        drop(_bottom, cells.y1);
+    }
+
+private:
+    qreal _cellSize;
+
+    std::unordered_map<Key, Cells> _entries;
+
+    Counts _left;
+    Counts _top;
+    Counts _right;
+    Counts _bottom;
+};
+
+} // namespace QtNodes
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Definitions.hpp"
+#include "Export.hpp"
+
+#include <QtCore/QObject>
+#include <QtCore/QSizeF>
+#include <QtGui/QPixmap>
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace QtNodes {
+
+class AbstractGraphModel;
+class AbstractNodeGeometry;
+
+/// Everything besides the model data a rendered node image depends on.
+struct NODE_EDITOR_PUBLIC NodeRenderKey
+{
+    QSizeF size;
+    qreal scale = 0.0;
+    unsigned int styleRevision = 0;
+    quint64 connectedPorts = 0;
+    bool selected = false;
+    bool hovered = false;
+    bool computing = false;
+
+    /// Settings of the painting scene, images are shared between equal ones.
+    std::size_t painterType = 0;
+    int shadowMode = 0;
+    int orientation = 0;
+    double computeHeatScale = 0.0;
+
+    bool operator==(NodeRenderKey const &other) const;
+};
+
+/**
+ * Node layouts and rendered node images shared by the scenes of one model.
+ *
+ * A model shown in several views gets a `BasicGraphicsScene` per view,
+ * each measuring and painting every node on its own. Scenes given the same
+ * cache with `BasicGraphicsScene::setSharedCache()` use one geometry per
+ * orientation instead, and blit the images of nodes another scene already
+ * painted with the same key. Label measurements are shared anyway through
+ * `TextCache`.
+ *
+ * ```
+ * auto cache = std::make_shared<SharedSceneCache>(model);
+ *
+ * editorScene->setSharedCache(cache);
+ * detailScene->setSharedCache(cache);
+ * ```
+ *
+ * Images are only kept for scenes with `setNodeRenderCacheEnabled()`.
+ */
+class NODE_EDITOR_PUBLIC SharedSceneCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Images kept per node, e.g. for views at different zoom levels.
+    static constexpr std::size_t ImagesPerNode = 4;
+
+    explicit SharedSceneCache(AbstractGraphModel &graphModel, QObject *parent = nullptr);
+
+    ~SharedSceneCache() override;
+
+    AbstractGraphModel &graphModel() const { return _graphModel; }
+
+    /// The default geometry for `orientation`, created on first use.
+    AbstractNodeGeometry &nodeGeometry(Qt::Orientation const orientation);
+
+    /// @returns a null pixmap if no scene painted the node under `key` yet.
+    QPixmap nodeImage(NodeId const nodeId, NodeRenderKey const &key);
+
+    /// Keeps `image`, dropping the least recently used image of the node if needed.
+    void insertNodeImage(NodeId const nodeId, NodeRenderKey const &key, QPixmap const &image);
+
+    /// Drops the images of the node, after any change of its content.
+    void invalidateNode(NodeId const nodeId);
+
+    void clear();
+
+    std::size_t imageCount() const;
+
+    std::size_t imageBytes() const;
+
+private:
+    using Images = std::vector<std::pair<NodeRenderKey, QPixmap>>;
+
+    AbstractGraphModel &_graphModel;
+
+    /// Indexed by `Qt::Horizontal - 1` and `Qt::Vertical - 1`.
+    std::array<std::unique_ptr<AbstractNodeGeometry>, 2> _geometries;
+
+    /// Most recently used first.
+    std::unordered_map<NodeId, Images> _images;
+};
+
+} // namespace QtNodes
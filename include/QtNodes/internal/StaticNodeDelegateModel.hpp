@@ -0,0 +1,150 @@
+#pragma once
+
+#include "NodeDelegateModel.hpp"
+
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace QtNodes {
+
+/// Data types of the input ports of a StaticNodeDelegateModel, in port order.
+template<typename... DataTypes>
+struct Inputs
+{};
+
+/// Data types of the output ports of a StaticNodeDelegateModel, in port order.
+template<typename... DataTypes>
+struct Outputs
+{};
+
+template<typename Derived, typename InputList, typename OutputList>
+class StaticNodeDelegateModel;
+
+/**
+ * Base for delegates whose ports are known at compile time.
+ *
+ * ```
+ * class AdditionModel
+ *     : public StaticNodeDelegateModel<AdditionModel,
+ *                                      Inputs<DecimalData, DecimalData>,
+ *                                      Outputs<DecimalData>>
+ * { ... };
+ * ```
+ *
+ * The port table is built once per `Derived`, constructing every listed
+ * `NodeData` type a single time for its `type()`. The graph model reads the
+ * table directly, see `NodeDelegateModel::portTable()`, so painting and
+ * connecting no longer build temporary data objects or call the port
+ * functions per query. They are `final` here to keep the table truthful.
+ *
+ * Inputs accept one connection and outputs many. `Derived` may change that
+ * with a public `static void describePorts(PortTable &table)`, called once
+ * while building the table. Port captions stay virtual.
+ *
+ * Inputs arrive already cast to the declared type: `setInData()` is final
+ * and calls `Derived::setTypedInData()` with a `std::shared_ptr<T const>`,
+ * one overload per input type, public or accessible to this base:
+ *
+ * ```
+ * void setTypedInData(std::shared_ptr<DecimalData const> data, PortIndex portIndex);
+ * ```
+ *
+ * For TypedNodeData classes the cast is a comparison of type tags, see
+ * `nodeDataCast()`; connections between ports declaring different tagged
+ * classes are refused by `DataFlowGraphModel::connectionPossible()`, so the
+ * tags match for every value delivered. Empty or mismatching data arrives
+ * as `nullptr`.
+ */
+template<typename Derived, typename... InTypes, typename... OutTypes>
+class StaticNodeDelegateModel<Derived, Inputs<InTypes...>, Outputs<OutTypes...>>
+    : public NodeDelegateModel
+{
+public:
+    static constexpr unsigned int InPortCount = sizeof...(InTypes);
+
+    static constexpr unsigned int OutPortCount = sizeof...(OutTypes);
+
+    static PortTable const &staticPortTable()
+    {
+        static PortTable const table = makePortTable();
+        return table;
+    }
+
+public:
+    unsigned int nPorts(PortType portType) const final
+    {
+        return static_cast<unsigned int>(staticPortTable().ports(portType).size());
+    }
+
+    NodeDataType dataType(PortType portType, PortIndex portIndex) const final
+    {
+        std::vector<PortSpec> const &ports = staticPortTable().ports(portType);
+
+        return portIndex < ports.size() ? ports[portIndex].type : NodeDataType();
+    }
+
+    ConnectionPolicy portConnectionPolicy(PortType portType, PortIndex portIndex) const final
+    {
+        std::vector<PortSpec> const &ports = staticPortTable().ports(portType);
+
+        if (portIndex < ports.size())
+            return ports[portIndex].policy;
+
+        return NodeDelegateModel::portConnectionPolicy(portType, portIndex);
+    }
+
+    /// Casts `nodeData` to the type declared for the port.
+    void setInData(std::shared_ptr<NodeData> nodeData, PortIndex const portIndex) final
+    {
+        // One entry more keeps the array valid for nodes without inputs.
+        static InputSetter const setters[] = {&setTypedInput<InTypes>..., nullptr};
+
+        if (portIndex < InPortCount)
+            setters[portIndex](static_cast<Derived &>(*this), nodeData, portIndex);
+    }
+
+    /// Default of the hook `Derived` may hide.
+    static void describePorts(PortTable &table) { Q_UNUSED(table); }
+
+protected:
+    StaticNodeDelegateModel() { setPortTable(&staticPortTable()); }
+
+private:
+    using InputSetter = void (*)(Derived &, std::shared_ptr<NodeData> const &, PortIndex);
+
+    template<typename DataType>
+    static void setTypedInput(Derived &model,
+                              std::shared_ptr<NodeData> const &nodeData,
+                              PortIndex const portIndex)
+    {
+        std::shared_ptr<DataType const> data = nodeDataCast<DataType>(nodeData);
+
+        model.setTypedInData(std::move(data), portIndex);
+    }
+
+    template<typename DataType>
+    static PortSpec makePortSpec(ConnectionPolicy const policy)
+    {
+        NodeDataType type = DataType().type();
+        NodeDataTypeId const typeId = type.typeId();
+
+        void const *typeTag = detail::staticTypeTagOf<DataType>(
+            std::is_base_of<TypedNodeData<DataType>, DataType>());
+
+        return PortSpec{std::move(type), typeId, policy, typeTag};
+    }
+
+    static PortTable makePortTable()
+    {
+        PortTable table;
+        table.in = {makePortSpec<InTypes>(ConnectionPolicy::One)...};
+        table.out = {makePortSpec<OutTypes>(ConnectionPolicy::Many)...};
+
+        Derived::describePorts(table);
+
+        return table;
+    }
+};
+
+} // namespace QtNodes
@@ -5,10 +5,21 @@
 #include "ConnectionStyle.hpp"
 #include "GraphicsViewStyle.hpp"
 #include "NodeStyle.hpp"
+#include "StyleContext.hpp"
+
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace QtNodes {
 
-class NODE_EDITOR_PUBLIC StyleCollection
+/// The process-wide `StyleContext`, used wherever no other context is attached.
+/**
+ * Reading the current context is safe from any thread. A setter swaps in a
+ * new context instead of changing the current one, and contexts once
+ * current are kept until exit, so references returned here stay valid.
+ */
+class NODE_EDITOR_CORE_PUBLIC StyleCollection
 {
 public:
     static NodeStyle const &nodeStyle();
@@ -17,6 +28,22 @@ public:
 
     static GraphicsViewStyle const &flowViewStyle();
 
+    /// Shared immutable copy of the current node style.
+    /**
+   * The pointer stays the same until `setNodeStyle` is called, so it can
+   * be handed out to many nodes without copying the style.
+   */
+    static std::shared_ptr<NodeStyle const> sharedNodeStyle();
+
+    /// Changes every time any of the styles is replaced, the `revision()` of `current()`.
+    static unsigned int revision();
+
+    /// The current context, to be held by work that must not see a theme change halfway.
+    static std::shared_ptr<StyleContext const> context();
+
+    /// The current context without taking a reference.
+    static StyleContext const &current();
+
 public:
     static void setNodeStyle(NodeStyle);
 
@@ -24,8 +51,11 @@ public:
 
     static void setGraphicsViewStyle(GraphicsViewStyle);
 
+    /// Replaces all the styles at once.
+    static void setContext(std::shared_ptr<StyleContext const> context);
+
 private:
-    StyleCollection() = default;
+    StyleCollection();
 
     StyleCollection(StyleCollection const &) = delete;
 
@@ -33,11 +63,17 @@ private:
 
     static StyleCollection &instance();
 
+    /// Makes `context` current, to be called with `_mutex` held.
+    void swap(std::shared_ptr<StyleContext const> context);
+
 private:
-    NodeStyle _nodeStyle;
+    /// Read and written through `std::atomic_load()` and `std::atomic_store()`.
+    std::shared_ptr<StyleContext const> _context;
 
-    ConnectionStyle _connectionStyle;
+    /// Serializes the setters, which read the context they replace.
+    std::mutex _mutex;
 
-    GraphicsViewStyle _flowViewStyle;
+    /// Contexts no longer current, see the class description.
+    std::vector<std::shared_ptr<StyleContext const>> _retired;
 };
 } // namespace QtNodes
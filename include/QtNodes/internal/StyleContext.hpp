@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Export.hpp"
+
+#include "ConnectionStyle.hpp"
+#include "GraphicsViewStyle.hpp"
+#include "NodeStyle.hpp"
+
+#include <memory>
+
+namespace QtNodes {
+
+/**
+ * An immutable set of node, connection and view styles.
+ *
+ * Contexts are shared through `std::shared_ptr<StyleContext const>` and
+ * never change once created, so any thread may read one it holds, e.g. an
+ * export or a layout on a worker. A theme change creates a new context and
+ * swaps it in, see `StyleCollection::setContext()` and
+ * `BasicGraphicsScene::setStyleContext()`.
+ *
+ * Every context gets a `revision()` of its own, which caches of painted
+ * content key on instead of comparing styles.
+ */
+class NODE_EDITOR_CORE_PUBLIC StyleContext
+{
+public:
+    /// The default styles.
+    StyleContext();
+
+    StyleContext(NodeStyle nodeStyle, ConnectionStyle connectionStyle, GraphicsViewStyle viewStyle);
+
+    NodeStyle const &nodeStyle() const { return *_nodeStyle; }
+
+    /// The node style for `NodeRole::StylePtr` of nodes without a style of their own.
+    std::shared_ptr<NodeStyle const> const &sharedNodeStyle() const { return _nodeStyle; }
+
+    ConnectionStyle const &connectionStyle() const { return _connectionStyle; }
+
+    GraphicsViewStyle const &viewStyle() const { return _viewStyle; }
+
+    /// Unique among all the contexts of the process.
+    unsigned int revision() const { return _revision; }
+
+    /// Copies with one of the styles replaced.
+    std::shared_ptr<StyleContext const> withNodeStyle(NodeStyle nodeStyle) const;
+
+    std::shared_ptr<StyleContext const> withConnectionStyle(ConnectionStyle connectionStyle) const;
+
+    std::shared_ptr<StyleContext const> withViewStyle(GraphicsViewStyle viewStyle) const;
+
+private:
+    /// Keeps `sharedNodeStyle()` when another style is replaced.
+    StyleContext(std::shared_ptr<NodeStyle const> nodeStyle,
+                 ConnectionStyle connectionStyle,
+                 GraphicsViewStyle viewStyle);
+
+private:
+    std::shared_ptr<NodeStyle const> _nodeStyle;
+
+    ConnectionStyle _connectionStyle;
+
+    GraphicsViewStyle _viewStyle;
+
+    unsigned int _revision;
+};
+
+} // namespace QtNodes
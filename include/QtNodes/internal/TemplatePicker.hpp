@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QtWidgets/QDialog>
+
+#include "Export.hpp"
+
+class QAbstractItemModel;
+class QLineEdit;
+class QListView;
+class QSortFilterProxyModel;
+
+namespace QtNodes {
+
+/**
+ * Filterable list of the template names a connection can be given.
+ *
+ * A scene keeps one picker over one shared list of the record headers and
+ * reuses it for every connection, see `BasicGraphicsScene::openDialog()`.
+ */
+class NODE_EDITOR_PUBLIC TemplatePicker : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit TemplatePicker(QAbstractItemModel *templates, QWidget *parent = nullptr);
+
+    /// Clears the filter and selects `current` if it is listed.
+    void reset(QString const &current);
+
+    /// @returns an empty string when nothing is selected.
+    QString selectedTemplate() const;
+
+private:
+    QLineEdit *_filter;
+
+    QSortFilterProxyModel *_filteredTemplates;
+
+    QListView *_list;
+};
+
+} // namespace QtNodes
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QtCore/QHash>
+#include <QtCore/QRect>
+#include <QtCore/QString>
+#include <QtGui/QFont>
+#include <QtGui/QFontMetrics>
+#include <QtGui/QStaticText>
+
+#include "Export.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace QtNodes {
+
+/**
+ * Measurements and prepared `QStaticText` of label strings, per font.
+ *
+ * Node captions and port labels repeat the same few strings, type names
+ * above all, so geometries and painters measure and lay them out once here
+ * instead of on every resize and paint. Every thread has a cache of its
+ * own, so headless exports may measure and paint on worker threads.
+ */
+class NODE_EDITOR_PUBLIC TextCache
+{
+public:
+    /// Strings kept per font before its entries are dropped.
+    static constexpr std::size_t Capacity = 4096;
+
+    /// The cache the default geometries and painters share on this thread.
+    static TextCache &instance();
+
+    int horizontalAdvance(QFont const &font, QString const &text);
+
+    /// Same as `QFontMetrics::boundingRect()` for one line of text.
+    QRect boundingRect(QFont const &font, QString const &text);
+
+    int ascent(QFont const &font);
+
+    /// Line height of `font`.
+    int height(QFont const &font);
+
+    /// Plain text for `QPainter::drawStaticText()` with `font` set on the painter.
+    QStaticText const &staticText(QFont const &font, QString const &text);
+
+    void clear();
+
+private:
+    struct Entry
+    {
+        int advance = 0;
+        QRect boundingRect;
+
+        /// Laid out on the first `staticText()` call only.
+        QStaticText staticText;
+        bool prepared = false;
+    };
+
+    struct FontEntry
+    {
+        explicit FontEntry(QFont const &f)
+            : font(f)
+            , metrics(f)
+        {}
+
+        QFont font;
+        QFontMetrics metrics;
+        QHash<QString, Entry> entries;
+    };
+
+    FontEntry &fontEntry(QFont const &font);
+
+    Entry &measured(FontEntry &fontEntry, QString const &text);
+
+private:
+    /// Few fonts are in use, a linear search beats hashing `QFont::key()`.
+    std::vector<std::unique_ptr<FontEntry>> _fonts;
+};
+
+} // namespace QtNodes
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Export.hpp"
+#include "NodeData.hpp"
+
+#include <QtCore/QRect>
+#include <QtCore/QSize>
+#include <QtGui/QImage>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace QtNodes {
+
+/**
+ * Image passed between nodes as a pyramid of tiles read on demand.
+ *
+ * Receivers ask for a region at a resolution level instead of the whole
+ * image: level `0` is the full resolution, every further level halves
+ * both dimensions. A preview only reads the few tiles of a coarse level,
+ * e.g. `thumbnail(label->size())`.
+ *
+ * The pixels come from a `Source`, which only has to provide the levels it
+ * has natively; the coarser ones are downscaled from the level below and
+ * kept in a tile cache shared by all copies of the data. Filters stream by
+ * wrapping the upstream data in a `Source` of their own that reads the
+ * regions it is asked for from upstream.
+ *
+ * Reading is thread safe, so threadSafe() delegates may read on workers.
+ */
+class NODE_EDITOR_CORE_PUBLIC TiledImageData : public TypedNodeData<TiledImageData>
+{
+public:
+    /// Produces the pixels of `TiledImageData`, called from any reading thread.
+    class Source
+    {
+    public:
+        virtual ~Source() = default;
+
+        /// Size of level `0`.
+        virtual QSize size() const = 0;
+
+        /// Levels `read()` serves itself, at least `1`.
+        virtual int levelCount() const { return 1; }
+
+        /// Pixels of `rect`, given and returned in pixels of `level`.
+        virtual QImage read(QRect const &rect, int const level) const = 0;
+    };
+
+    /// Edge length of a tile, in pixels of its level.
+    static constexpr int TileSize = 256;
+
+public:
+    explicit TiledImageData(std::shared_ptr<Source const> source);
+
+    /// Serves an image already in memory, without copying it.
+    explicit TiledImageData(QImage const &image);
+
+    /// The type of every instance, for the ports of delegates.
+    static NodeDataType staticType() { return NodeDataType{"tiled-image", "Image"}; }
+
+    NodeDataType type() const override { return staticType(); }
+
+public:
+    QSize size() const;
+
+    /// Levels down to the one fitting a single tile.
+    int levelCount() const;
+
+    QSize levelSize(int const level) const;
+
+    /// Coarsest level still at least as large as `target` in both directions.
+    int levelFor(QSize const &target) const;
+
+    /// Pixels of `rect`, in pixels of `level`, assembled from cached tiles.
+    /**
+   * The rectangle is clipped to the level; an empty image is returned if
+   * nothing remains.
+   */
+    QImage region(QRect const &rect, int const level) const;
+
+    /// The whole image at `levelFor(target)`, still to be scaled to `target`.
+    QImage thumbnail(QSize const &target) const;
+
+    /// Bytes the tile cache of all images may hold, 64 MiB by default.
+    static void setTileCacheLimit(std::size_t const bytes);
+
+private:
+    QImage tile(int const level, int const column, int const row) const;
+
+    QRect levelRect(int const level) const { return QRect(QPoint(0, 0), levelSize(level)); }
+
+private:
+    std::shared_ptr<Source const> _source;
+
+    /// Identifies the tiles of this data and its copies in the cache.
+    std::uint64_t _cacheId;
+};
+
+} // namespace QtNodes
@@ -1,18 +1,140 @@
 #pragma once
 
 #include "Definitions.hpp"
+#include "GraphChangeStream.hpp"
 
 #include <QUndoCommand>
+#include <QtCore/QByteArray>
 #include <QtCore/QJsonObject>
 #include <QtCore/QPointF>
 
+#include <cstddef>
 #include <unordered_set>
+#include <vector>
+
+class QDataStream;
 
 namespace QtNodes {
 
+class AbstractGraphModel;
 class BasicGraphicsScene;
 
-class CreateCommand : public QUndoCommand
+/// Compact record of the nodes and connections a command removes or inserts.
+/**
+ * A node is kept as its id, its position and an opaque blob with the
+ * compact JSON of the rest of `AbstractGraphModel::saveNode()`. Connections
+ * are plain ids.
+ */
+class SceneSnapshot
+{
+public:
+    void addNode(AbstractGraphModel const &graphModel, NodeId const nodeId);
+
+    /// Takes a node in the `saveNode()` format.
+    void addNode(QJsonObject nodeJson);
+
+    /// Duplicates are not detected.
+    void addConnection(ConnectionId const connectionId);
+
+    /// Takes the `{"nodes": [...], "connections": [...]}` clipboard JSON.
+    void addItems(QJsonObject const &sceneJson);
+
+    bool empty() const { return _nodes.empty() && _connections.empty(); }
+
+    std::size_t nodeCount() const { return _nodes.size(); }
+
+    /// Replaces the node ids with a block of `AbstractGraphModel::reserveNodeIds()`, e.g. for pasting.
+    void assignNewNodeIds(AbstractGraphModel &graphModel);
+
+    void translate(QPointF const &offset);
+
+    QPointF averagePosition() const;
+
+    /// Recreates the nodes, then the connections, and selects them.
+    /**
+   * Items are inserted in model batches of `InsertBatchSize`, so the scene
+   * builds the graphics objects of each batch at once.
+   */
+    void insert(BasicGraphicsScene *scene) const;
+
+    static constexpr std::size_t InsertBatchSize = 1024;
+
+    /// Deletes the connections, then the nodes.
+    void remove(AbstractGraphModel &graphModel) const;
+
+    /// Approximate heap and object size in bytes.
+    std::size_t memoryUsage() const;
+
+    /// Compresses the node blobs in place; they are inflated on `insert()`.
+    void compress();
+
+    bool compressed() const { return _compressed; }
+
+    void clear();
+
+    /// Binary clipboard layout, see `write()`.
+    static bool isBinary(QByteArray const &data);
+
+    /// Writes the snapshot as a QDataStream (big endian) with the layout
+    /**
+   *   quint32 magic, quint16 version,
+   *   quint32 node count, per node: quint32 id, double x, double y and the
+   *   uncompressed QByteArray blob,
+   *   quint32 connection count, per connection: four quint32 values.
+   */
+    QByteArray toBinary() const;
+
+    /// @returns `false` for an unknown header or a truncated stream.
+    bool fromBinary(QByteArray const &data);
+
+    /// The clipboard JSON accepted by `addItems()`.
+    QJsonObject toJson() const;
+
+private:
+    struct Node
+    {
+        NodeId id;
+        QPointF position;
+        QByteArray blob;
+    };
+
+    QJsonObject nodeJson(Node const &node) const;
+
+private:
+    std::vector<Node> _nodes;
+
+    std::vector<ConnectionId> _connections;
+
+    bool _compressed = false;
+};
+
+/**
+ * Base of the commands keeping a `SceneSnapshot`, whose memory is accounted
+ * against the undo budget of the scene (see
+ * `BasicGraphicsScene::setUndoMemoryBudget()`).
+ */
+class SnapshotCommand : public QUndoCommand
+{
+public:
+    std::size_t memoryUsage() const;
+
+    /// Shrinks the snapshot, the command stays undoable.
+    void compress();
+
+    bool compressed() const { return _snapshot.compressed(); }
+
+    /// Drops the snapshot and marks the command obsolete.
+    /**
+   * QUndoStack then skips and deletes the command instead of undoing it.
+   * Must only be called together with all the older commands of the stack.
+   */
+    void evict();
+
+protected:
+    SceneSnapshot _snapshot;
+};
+
+class CreateCommand : public SnapshotCommand
 {
 public:
     CreateCommand(BasicGraphicsScene *scene, QString const name, QPointF const &mouseScenePos);
@@ -23,14 +145,13 @@ public:
 private:
     BasicGraphicsScene *_scene;
     NodeId _nodeId;
-    QJsonObject _sceneJson;
 };
 
 /**
  * Selected scene objects are serialized and then removed from the scene.
  * The deleted elements could be restored in `undo`.
  */
-class DeleteCommand : public QUndoCommand
+class DeleteCommand : public SnapshotCommand
 {
 public:
     DeleteCommand(BasicGraphicsScene *scene);
@@ -40,16 +161,21 @@ public:
 
 private:
     BasicGraphicsScene *_scene;
-    QJsonObject _sceneJson;
 };
 
+/**
+ * Puts the selected nodes and the connections between them on the
+ * clipboard as `application/qt-nodes-graph` in the binary layout of
+ * `SceneSnapshot::toBinary()`. The JSON text form is only built when
+ * another application asks for `text/plain`.
+ */
 class CopyCommand : public QUndoCommand
 {
 public:
     CopyCommand(BasicGraphicsScene *scene);
 };
 
-class PasteCommand : public QUndoCommand
+class PasteCommand : public SnapshotCommand
 {
 public:
     PasteCommand(BasicGraphicsScene *scene, QPointF const &mouseScenePos);
@@ -58,13 +184,26 @@ public:
     void redo() override;
 
 private:
-    QJsonObject takeSceneJsonFromClipboard();
-    QJsonObject makeNewNodeIdsInScene(QJsonObject const &sceneJson);
+    BasicGraphicsScene *_scene;
+    QPointF const &_mouseScenePos;
+};
+
+/**
+ * Copies the selected nodes and the connections between them straight
+ * into the scene, centered at `scenePos`. Unlike a `CopyCommand` followed
+ * by a `PasteCommand` it leaves the clipboard alone and never serializes
+ * the whole selection to text.
+ */
+class DuplicateCommand : public SnapshotCommand
+{
+public:
+    DuplicateCommand(BasicGraphicsScene *scene, QPointF const &scenePos);
+
+    void undo() override;
+    void redo() override;
 
 private:
     BasicGraphicsScene *_scene;
-    QPointF const &_mouseScenePos;
-    QJsonObject _newSceneJson;
 };
 
 class DisconnectCommand : public QUndoCommand
@@ -100,6 +239,16 @@ class MoveNodeCommand : public QUndoCommand
 public:
     MoveNodeCommand(BasicGraphicsScene *scene, QPointF const &diff);
 
+    /**
+   * Records a move of `nodes` by `diff` that has already been applied to
+   * the model, e.g. by a finished drag session. The first `redo()` called
+   * by QUndoStack::push is skipped.
+   */
+    MoveNodeCommand(BasicGraphicsScene *scene,
+                    std::unordered_set<NodeId> nodes,
+                    QPointF const &diff,
+                    bool alreadyApplied);
+
     void undo() override;
     void redo() override;
 
@@ -117,7 +266,33 @@ public:
 private:
     BasicGraphicsScene *_scene;
     std::unordered_set<NodeId> _selectedNodes;
+    std::vector<NodeId> _nodes;
     QPointF _diff;
+    bool _skipRedo;
+};
+
+/// Applies a list of `GraphChange`s through `GraphChangeStream::apply()`, and another on undo.
+/**
+ * Made from two opposite `GraphDiff::diff()`s, e.g. for a merge or a
+ * revision restored from version control.
+ */
+class ApplyChangesCommand : public QUndoCommand
+{
+public:
+    /// With `alreadyApplied` the first `redo()` called by QUndoStack::push is skipped.
+    ApplyChangesCommand(BasicGraphicsScene *scene,
+                        std::vector<GraphChange> redoChanges,
+                        std::vector<GraphChange> undoChanges,
+                        bool alreadyApplied = false);
+
+    void undo() override;
+    void redo() override;
+
+private:
+    BasicGraphicsScene *_scene;
+    std::vector<GraphChange> _redoChanges;
+    std::vector<GraphChange> _undoChanges;
+    bool _skipRedo;
 };
 
 } // namespace QtNodes
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Export.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace QtNodes {
+
+/**
+ * Runs a dependency graph of tasks on a fixed set of worker threads.
+ *
+ * Every worker owns a deque: it pushes the tasks it makes ready to the
+ * back and pops from the back, idle workers steal from the front of the
+ * other deques. Tasks flagged `mainThreadOnly` are executed only by the
+ * thread calling `run()`, which also helps with the other tasks while it
+ * waits.
+ */
+class NODE_EDITOR_CORE_PUBLIC WorkStealingExecutor
+{
+public:
+    struct Task
+    {
+        std::function<void()> run;
+
+        /// Indices of the tasks waiting for this one.
+        std::vector<std::size_t> successors;
+
+        /// Number of predecessors; every predecessor lists this task once per edge.
+        unsigned int dependencies = 0;
+
+        /// Must run on the thread calling `WorkStealingExecutor::run()`.
+        bool mainThreadOnly = false;
+    };
+
+public:
+    /// `workerCount == 0` uses one thread less than the hardware concurrency.
+    explicit WorkStealingExecutor(unsigned int workerCount = 0);
+
+    ~WorkStealingExecutor();
+
+    WorkStealingExecutor(WorkStealingExecutor const &) = delete;
+
+    WorkStealingExecutor &operator=(WorkStealingExecutor const &) = delete;
+
+public:
+    unsigned int workerCount() const { return static_cast<unsigned int>(_workers.size()); }
+
+    /// Executes all `tasks` and returns when the last one finished.
+    /**
+   * The dependency graph must be acyclic. The first exception thrown by a
+   * task is rethrown here after all the remaining tasks have run.
+   */
+    void run(std::vector<Task> &tasks);
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+    };
+
+    void workerLoop(std::size_t workerIndex);
+
+    /// Pops from the own queue, then steals; @returns false if nothing was found.
+    bool acquireTask(std::size_t queueIndex, std::size_t &taskIndex);
+
+    void execute(std::size_t queueIndex, std::size_t taskIndex);
+
+    void push(std::size_t queueIndex, std::size_t taskIndex);
+
+    void wakeUp();
+
+private:
+    std::vector<std::thread> _workers;
+
+    /// One queue per worker plus the last one reserved for the calling thread.
+    std::vector<std::unique_ptr<Queue>> _queues;
+
+    std::mutex _waitMutex;
+    std::condition_variable _wake;
+
+    /// Bumped on every push, lets a waiting thread detect work it raced with.
+    unsigned long long _epoch;
+
+    bool _stop;
+
+    // State of the current `run()`.
+    std::vector<Task> *_tasks;
+    std::unique_ptr<std::atomic<unsigned int>[]> _remainingDependencies;
+    std::atomic<std::size_t> _pending;
+    std::atomic<std::size_t> _nextQueue;
+
+    std::mutex _errorMutex;
+    std::exception_ptr _error;
+};
+
+} // namespace QtNodes
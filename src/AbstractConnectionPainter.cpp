@@ -0,0 +1,22 @@
+#include "AbstractConnectionPainter.hpp"
+
+#include "AbstractGraphModel.hpp"
+#include "StyleCollection.hpp"
+
+namespace QtNodes {
+
+void AbstractConnectionPainter::paintHeadless(QPainter *painter,
+                                              ConnectionPaintContext const &context) const
+{
+    auto const &connectionStyle = context.styleContext().connectionStyle();
+
+    QPen pen(context.color.isValid() ? context.color : connectionStyle.normalColor(),
+             connectionStyle.lineWidth());
+
+    painter->setPen(pen);
+    painter->setBrush(Qt::NoBrush);
+
+    painter->drawPath(context.path);
+}
+
+} // namespace QtNodes
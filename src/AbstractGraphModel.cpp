@@ -2,8 +2,313 @@
 
 #include <QtNodes/ConnectionIdUtils>
 
+#include "NodeData.hpp"
+
+#include <stdexcept>
+
 namespace QtNodes {
 
+bool GraphChangeSet::empty() const
+{
+    return size() == 0 && !reset;
+}
+
+std::size_t GraphChangeSet::size() const
+{
+    return createdNodes.size() + deletedNodes.size() + updatedNodes.size() + movedNodes.size()
+           + createdConnections.size() + deletedConnections.size();
+}
+
+void GraphChangeSet::clear()
+{
+    createdNodes.clear();
+    deletedNodes.clear();
+    updatedNodes.clear();
+    movedNodes.clear();
+    createdConnections.clear();
+    deletedConnections.clear();
+    reset = false;
+}
+
+AbstractGraphModel::AbstractGraphModel(QObject *parent)
+    : QObject(parent)
+    , _batchDepth(0)
+{
+    // The model records its own notifications while a batch is open.
+
+    connect(this, &AbstractGraphModel::nodeCreated, this, [this](NodeId const nodeId) {
+        if (batchInProgress())
+            _batchChanges.createdNodes.insert(nodeId);
+    });
+
+    connect(this, &AbstractGraphModel::nodeDeleted, this, [this](NodeId const nodeId) {
+        if (!batchInProgress())
+            return;
+
+        _batchChanges.updatedNodes.erase(nodeId);
+        _batchChanges.movedNodes.erase(nodeId);
+
+        if (_batchChanges.createdNodes.erase(nodeId) == 0)
+            _batchChanges.deletedNodes.insert(nodeId);
+    });
+
+    connect(this, &AbstractGraphModel::nodeUpdated, this, [this](NodeId const nodeId) {
+        if (batchInProgress() && _batchChanges.createdNodes.count(nodeId) == 0)
+            _batchChanges.updatedNodes.insert(nodeId);
+    });
+
+    auto recordMove = [this](NodeId const nodeId) {
+        if (_batchChanges.createdNodes.count(nodeId) == 0)
+            _batchChanges.movedNodes.insert(nodeId);
+    };
+
+    connect(this, &AbstractGraphModel::nodePositionUpdated, this, [this, recordMove](NodeId nodeId) {
+        if (batchInProgress())
+            recordMove(nodeId);
+    });
+
+    connect(this,
+            &AbstractGraphModel::nodePositionsUpdated,
+            this,
+            [this, recordMove](std::vector<NodeId> const &nodeIds) {
+                if (!batchInProgress())
+                    return;
+
+                for (NodeId const nodeId : nodeIds) {
+                    recordMove(nodeId);
+                }
+            });
+
+    connect(this, &AbstractGraphModel::connectionCreated, this, [this](ConnectionId const cid) {
+        if (batchInProgress())
+            _batchChanges.createdConnections.insert(cid);
+    });
+
+    connect(this, &AbstractGraphModel::connectionDeleted, this, [this](ConnectionId const cid) {
+        if (!batchInProgress())
+            return;
+
+        if (_batchChanges.createdConnections.erase(cid) == 0)
+            _batchChanges.deletedConnections.insert(cid);
+    });
+
+    connect(this,
+            &AbstractGraphModel::connectionsRemapped,
+            this,
+            [this](ConnectionRemap const &remap) {
+                if (!batchInProgress())
+                    return;
+
+                // Listeners of the batch see a deletion and a creation.
+                for (auto const &shift : remap) {
+                    if (_batchChanges.createdConnections.erase(shift.first) == 0)
+                        _batchChanges.deletedConnections.insert(shift.first);
+
+                    _batchChanges.createdConnections.insert(shift.second);
+                }
+            });
+
+    connect(this, &AbstractGraphModel::modelReset, this, [this]() {
+        if (batchInProgress())
+            _batchChanges.reset = true;
+    });
+
+    // Snapshot tables the next snapshot() has to rebuild.
+
+    auto dropNodes = [this]() { _snapshotNodes.reset(); };
+
+    auto dropConnections = [this]() { _snapshotConnections.reset(); };
+
+    connect(this, &AbstractGraphModel::nodeCreated, this, dropNodes);
+    connect(this, &AbstractGraphModel::nodeDeleted, this, dropNodes);
+    connect(this, &AbstractGraphModel::nodeUpdated, this, dropNodes);
+    connect(this, &AbstractGraphModel::nodePositionUpdated, this, dropNodes);
+    connect(this, &AbstractGraphModel::nodePositionsUpdated, this, dropNodes);
+    connect(this, &AbstractGraphModel::connectionCreated, this, dropConnections);
+    connect(this, &AbstractGraphModel::connectionDeleted, this, dropConnections);
+    connect(this, &AbstractGraphModel::connectionsRemapped, this, dropConnections);
+
+    connect(this, &AbstractGraphModel::modelReset, this, [dropNodes, dropConnections]() {
+        dropNodes();
+        dropConnections();
+    });
+}
+
+GraphSnapshot AbstractGraphModel::snapshot() const
+{
+    if (!_snapshotNodes)
+        _snapshotNodes = GraphSnapshot::makeNodeTable(*this);
+
+    if (!_snapshotConnections)
+        _snapshotConnections = GraphSnapshot::makeConnectionTable(*this);
+
+    return GraphSnapshot(_snapshotNodes, _snapshotConnections);
+}
+
+void AbstractGraphModel::beginBatch()
+{
+    if (_batchDepth++ == 0) {
+        _batchChanges.clear();
+
+        Q_EMIT batchStarted();
+    }
+}
+
+void AbstractGraphModel::endBatch()
+{
+    if (_batchDepth == 0)
+        return;
+
+    if (--_batchDepth == 0) {
+        GraphChangeSet changes = std::move(_batchChanges);
+        _batchChanges.clear();
+
+        Q_EMIT batchFinished(changes);
+    }
+}
+
+void AbstractGraphModel::forEachConnection(NodeId nodeId,
+                                           PortType portType,
+                                           PortIndex index,
+                                           ConnectionVisitor const &visitor) const
+{
+    for (auto const &cid : connections(nodeId, portType, index)) {
+        visitor(cid);
+    }
+}
+
+void AbstractGraphModel::forEachNodeConnection(NodeId nodeId,
+                                               ConnectionVisitor const &visitor) const
+{
+    for (auto const &cid : allConnectionIds(nodeId)) {
+        visitor(cid);
+    }
+}
+
+void AbstractGraphModel::forEachGraphConnection(ConnectionVisitor const &visitor) const
+{
+    for (NodeId const nodeId : allNodeIds()) {
+        forEachNodeConnection(nodeId, [nodeId, &visitor](ConnectionId const &cid) {
+            if (cid.outNodeId == nodeId)
+                visitor(cid);
+        });
+    }
+}
+
+void AbstractGraphModel::forEachNodeGeometry(NodeGeometryVisitor const &visitor) const
+{
+    for (NodeId const nodeId : allNodeIds()) {
+        visitor(nodeId,
+                nodeData<QPointF>(nodeId, NodeRole::Position),
+                nodeData<QSize>(nodeId, NodeRole::Size));
+    }
+}
+
+void AbstractGraphModel::nodePositions(std::vector<NodeId> const &nodeIds,
+                                       std::vector<QPointF> &positions) const
+{
+    positions.resize(nodeIds.size());
+
+    for (std::size_t i = 0; i < nodeIds.size(); ++i) {
+        positions[i] = nodeData<QPointF>(nodeIds[i], NodeRole::Position);
+    }
+}
+
+void AbstractGraphModel::nodeSizes(std::vector<NodeId> const &nodeIds,
+                                   std::vector<QSize> &sizes) const
+{
+    sizes.resize(nodeIds.size());
+
+    for (std::size_t i = 0; i < nodeIds.size(); ++i) {
+        sizes[i] = nodeData<QSize>(nodeIds[i], NodeRole::Size);
+    }
+}
+
+void AbstractGraphModel::moveNodes(std::vector<NodeId> const &nodeIds, QPointF const &delta)
+{
+    for (NodeId const nodeId : nodeIds) {
+        QPointF const pos = nodeData<QPointF>(nodeId, NodeRole::Position);
+
+        setNodeData(nodeId, NodeRole::Position, pos + delta);
+    }
+}
+
+void AbstractGraphModel::setNodePositions(
+    std::vector<std::pair<NodeId, QPointF>> const &positions)
+{
+    GraphTransaction transaction(*this);
+
+    for (auto const &position : positions) {
+        setNodeData(position.first, NodeRole::Position, position.second);
+    }
+}
+
+void AbstractGraphModel::deleteConnections(std::vector<ConnectionId> const &connectionIds)
+{
+    GraphTransaction transaction(*this);
+
+    for (ConnectionId const &connectionId : connectionIds) {
+        deleteConnection(connectionId);
+    }
+}
+
+void AbstractGraphModel::deleteNodes(std::vector<NodeId> const &nodeIds)
+{
+    GraphTransaction transaction(*this);
+
+    for (NodeId const nodeId : nodeIds) {
+        if (nodeExists(nodeId))
+            deleteNode(nodeId);
+    }
+}
+
+void AbstractGraphModel::clear()
+{
+    auto const nodeIds = allNodeIds();
+
+    deleteNodes(std::vector<NodeId>(nodeIds.begin(), nodeIds.end()));
+}
+
+NodeId AbstractGraphModel::reserveNodeIds(std::size_t const count)
+{
+    if (count == 0)
+        return InvalidNodeId;
+
+    NodeId const first = newNodeId();
+
+    for (std::size_t i = 1; i < count; ++i) {
+        if (newNodeId() != first + static_cast<NodeId>(i))
+            throw std::logic_error("The model does not generate consecutive node ids");
+    }
+
+    return first;
+}
+
+void AbstractGraphModel::reserve(std::size_t const nodes, std::size_t const connections)
+{
+    Q_UNUSED(nodes);
+    Q_UNUSED(connections);
+}
+
+NodeDataTypeId AbstractGraphModel::portDataTypeId(NodeId nodeId,
+                                                  PortType portType,
+                                                  PortIndex index) const
+{
+    QVariant const typeId = portData(nodeId, portType, index, PortRole::DataTypeId);
+
+    if (typeId.isValid())
+        return typeId.value<NodeDataTypeId>();
+
+    return portData<NodeDataType>(nodeId, portType, index, PortRole::DataType).typeId();
+}
+
+std::size_t AbstractGraphModel::connectionCount(NodeId nodeId,
+                                                PortType portType,
+                                                PortIndex index) const
+{
+    return connections(nodeId, portType, index).size();
+}
+
 void AbstractGraphModel::portsAboutToBeDeleted(NodeId const nodeId,
                                                PortType const portType,
                                                PortIndex const first,
@@ -42,20 +347,18 @@ void AbstractGraphModel::portsAboutToBeDeleted(NodeId const nodeId,
 
             c = makeCompleteConnectionId(c, nodeId, portIndex - nRemovedPorts);
 
-            _shiftedByDynamicPortsConnections.push_back(c);
-
-            deleteConnection(connectionId);
+            _shiftedByDynamicPortsConnections.emplace_back(connectionId, c);
         }
     }
 }
 
 void AbstractGraphModel::portsDeleted()
 {
-    for (auto const connectionId : _shiftedByDynamicPortsConnections) {
-        addConnection(connectionId);
-    }
-
+    ConnectionRemap const remap = std::move(_shiftedByDynamicPortsConnections);
     _shiftedByDynamicPortsConnections.clear();
+
+    if (!remap.empty())
+        remapConnections(remap);
 }
 
 void AbstractGraphModel::portsAboutToBeInserted(NodeId const nodeId,
@@ -86,20 +389,30 @@ void AbstractGraphModel::portsAboutToBeInserted(NodeId const nodeId,
 
             c = makeCompleteConnectionId(c, nodeId, portIndex + nNewPorts);
 
-            _shiftedByDynamicPortsConnections.push_back(c);
-
-            deleteConnection(connectionId);
+            _shiftedByDynamicPortsConnections.emplace_back(connectionId, c);
         }
     }
 }
 
 void AbstractGraphModel::portsInserted()
 {
-    for (auto const connectionId : _shiftedByDynamicPortsConnections) {
-        addConnection(connectionId);
+    ConnectionRemap const remap = std::move(_shiftedByDynamicPortsConnections);
+    _shiftedByDynamicPortsConnections.clear();
+
+    if (!remap.empty())
+        remapConnections(remap);
+}
+
+void AbstractGraphModel::remapConnections(ConnectionRemap const &remap)
+{
+    // All deletions first, a shifted connection may take the place of another one.
+    for (auto const &shift : remap) {
+        deleteConnection(shift.first);
     }
 
-    _shiftedByDynamicPortsConnections.clear();
+    for (auto const &shift : remap) {
+        addConnection(shift.second);
+    }
 }
 
 } // namespace QtNodes
@@ -3,9 +3,15 @@
 #include "AbstractGraphModel.hpp"
 #include "StyleCollection.hpp"
 
+#include <QtCore/QJsonDocument>
+#include <QtGui/QFont>
+
 #include <QMargins>
+#include <QWidget>
 
 #include <cmath>
+#include <typeinfo>
+#include <utility>
 
 namespace QtNodes {
 
@@ -15,6 +21,86 @@ AbstractNodeGeometry::AbstractNodeGeometry(AbstractGraphModel &graphModel)
     //
 }
 
+QSize AbstractNodeGeometry::widgetSize(NodeId const nodeId) const
+{
+    QSize const hint = _graphModel.nodeData<QSize>(nodeId, NodeRole::WidgetSizeHint);
+
+    if (hint.isValid())
+        return hint;
+
+    if (auto w = _graphModel.nodeData<QWidget *>(nodeId, NodeRole::Widget))
+        return w->size();
+
+    return QSize();
+}
+
+QWidget *AbstractNodeGeometry::createdWidget(NodeId const nodeId) const
+{
+    if (_graphModel.nodeData<QSize>(nodeId, NodeRole::WidgetSizeHint).isValid())
+        return nullptr;
+
+    return _graphModel.nodeData<QWidget *>(nodeId, NodeRole::Widget);
+}
+
+void AbstractNodeGeometry::setStyleContext(std::shared_ptr<StyleContext const> context)
+{
+    _styleContext = std::move(context);
+
+    _layoutKey = 0;
+
+    invalidateLayouts();
+}
+
+StyleContext const &AbstractNodeGeometry::styleContext() const
+{
+    return _styleContext ? *_styleContext : StyleCollection::current();
+}
+
+quint64 AbstractNodeGeometry::layoutKey() const
+{
+    StyleContext const &styles = styleContext();
+
+    unsigned int const revision = styles.revision();
+
+    if (_layoutKey != 0 && _layoutKeyRevision == revision)
+        return _layoutKey;
+
+    QByteArray input = QFont().toString().toUtf8();
+    input += QJsonDocument(styles.nodeStyle().toJson()).toJson(QJsonDocument::Compact);
+    input += typeid(*this).name();
+
+    // FNV-1a, stable across runs unlike `qHash()`.
+    quint64 key = 14695981039346656037ull;
+
+    for (char const byte : input) {
+        key ^= static_cast<unsigned char>(byte);
+        key *= 1099511628211ull;
+    }
+
+    _layoutKey = key != 0 ? key : 1;
+    _layoutKeyRevision = revision;
+
+    return _layoutKey;
+}
+
+bool AbstractNodeGeometry::restoreSavedSize(NodeId const nodeId) const
+{
+    QVariant const saved = _graphModel.nodeData(nodeId, NodeRole::LayoutKey);
+
+    if (!saved.isValid())
+        return false;
+
+    quint64 const key = layoutKey();
+
+    if (saved.value<quint64>() != key)
+        return false;
+
+    // Confirms the size, which is no longer reported as a saved one.
+    _graphModel.setNodeData(nodeId, NodeRole::LayoutKey, key);
+
+    return true;
+}
+
 QRectF AbstractNodeGeometry::boundingRect(NodeId const nodeId) const
 {
     QSize s = size(nodeId);
@@ -45,7 +131,7 @@ PortIndex AbstractNodeGeometry::checkPortHit(NodeId const nodeId,
                                              PortType const portType,
                                              QPointF const nodePoint) const
 {
-    auto const &nodeStyle = StyleCollection::nodeStyle();
+    auto const &nodeStyle = styleContext().nodeStyle();
 
     PortIndex result = InvalidPortIndex;
 
@@ -74,4 +160,43 @@ PortIndex AbstractNodeGeometry::checkPortHit(NodeId const nodeId,
     return result;
 }
 
+void AbstractNodeGeometry::invalidateLayout(NodeId const nodeId) const
+{
+    _layouts.erase(nodeId);
+}
+
+void AbstractNodeGeometry::invalidateLayouts() const
+{
+    _layouts.clear();
+}
+
+AbstractNodeGeometry::NodeLayout &AbstractNodeGeometry::measuredLayout(NodeId const nodeId) const
+{
+    auto it = _layouts.find(nodeId);
+
+    if (it == _layouts.end()) {
+        it = _layouts.emplace(nodeId, NodeLayout()).first;
+
+        measureLayout(nodeId, it->second);
+    }
+
+    return it->second;
+}
+
+AbstractNodeGeometry::NodeLayout const &AbstractNodeGeometry::layout(NodeId const nodeId) const
+{
+    NodeLayout &result = measuredLayout(nodeId);
+
+    QSize const size = _graphModel.nodeData<QSize>(nodeId, NodeRole::Size);
+
+    if (!result.placed || result.size != size) {
+        result.size = size;
+        result.placed = true;
+
+        placeLayout(nodeId, result);
+    }
+
+    return result;
+}
+
 } // namespace QtNodes
@@ -0,0 +1,23 @@
+#include "AbstractNodePainter.hpp"
+
+#include "AbstractNodeGeometry.hpp"
+#include "NodeStyle.hpp"
+
+namespace QtNodes {
+
+void AbstractNodePainter::paintHeadless(QPainter *painter, NodePaintContext const &context) const
+{
+    QSize const size = context.geometry.size(context.nodeId);
+
+    NodeStyle const &nodeStyle = context.style;
+
+    QPen pen(context.selected ? nodeStyle.SelectedBoundaryColor : nodeStyle.NormalBoundaryColor,
+             nodeStyle.PenWidth);
+
+    painter->setPen(pen);
+    painter->setBrush(nodeStyle.GradientColor1);
+
+    painter->drawRect(QRectF(0, 0, size.width(), size.height()));
+}
+
+} // namespace QtNodes
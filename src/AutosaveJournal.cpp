@@ -0,0 +1,584 @@
+#include "AutosaveJournal.hpp"
+
+#include "ConnectionIdUtils.hpp"
+#include "DataFlowGraphModel.hpp"
+#include "NodeDelegateModel.hpp"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QRunnable>
+#include <QtCore/QSaveFile>
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+namespace QtNodes {
+
+namespace {
+
+/// Last journal sequence contained in a snapshot.
+QString const SequenceKey = QStringLiteral("journal-sequence");
+
+/// Writes a snapshot from the copied node and connection tables.
+class CompactionTask : public QRunnable
+{
+public:
+    using Done = std::function<void(bool)>;
+
+    CompactionTask(QString fileName,
+                   QHash<NodeId, QJsonObject> nodes,
+                   std::vector<ConnectionId> connections,
+                   std::uint64_t const sequence,
+                   Done done)
+        : _fileName(std::move(fileName))
+        , _nodes(std::move(nodes))
+        , _connections(std::move(connections))
+        , _sequence(sequence)
+        , _done(std::move(done))
+    {}
+
+    void run() override
+    {
+        std::vector<NodeId> ids;
+        ids.reserve(static_cast<std::size_t>(_nodes.size()));
+
+        for (auto it = _nodes.cbegin(); it != _nodes.cend(); ++it) {
+            ids.push_back(it.key());
+        }
+
+        std::sort(ids.begin(), ids.end());
+
+        QJsonArray nodesJson;
+
+        for (NodeId const nodeId : ids) {
+            nodesJson.append(_nodes.value(nodeId));
+        }
+
+        QJsonArray connectionsJson;
+
+        for (ConnectionId const &connectionId : _connections) {
+            connectionsJson.append(toJson(connectionId));
+        }
+
+        QJsonObject sceneJson;
+        sceneJson["nodes"] = nodesJson;
+        sceneJson["connections"] = connectionsJson;
+        sceneJson[SequenceKey] = static_cast<qint64>(_sequence);
+
+        QSaveFile file(_fileName);
+
+        bool const ok = file.open(QIODevice::WriteOnly)
+                        && file.write(QJsonDocument(sceneJson).toJson(QJsonDocument::Compact)) >= 0
+                        && file.commit();
+
+        _done(ok);
+    }
+
+private:
+    QString _fileName;
+    QHash<NodeId, QJsonObject> _nodes;
+    std::vector<ConnectionId> _connections;
+    std::uint64_t _sequence;
+    Done _done;
+};
+
+/// Calls `visitor` for every complete record of a journal file.
+void readJournal(QString const &fileName, std::function<void(QJsonObject const &)> const &visitor)
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    while (!file.atEnd()) {
+        QByteArray const line = file.readLine();
+
+        QJsonParseError error;
+        QJsonDocument const document = QJsonDocument::fromJson(line, &error);
+
+        // The tail written while crashing.
+        if (error.error != QJsonParseError::NoError || !document.isObject())
+            return;
+
+        visitor(document.object());
+    }
+}
+
+QJsonObject readSnapshot(QString const &fileName)
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly))
+        return QJsonObject();
+
+    return QJsonDocument::fromJson(file.readAll()).object();
+}
+
+QJsonObject positionJson(QPointF const &pos)
+{
+    QJsonObject posJson;
+    posJson["x"] = pos.x();
+    posJson["y"] = pos.y();
+
+    return posJson;
+}
+
+} // namespace
+
+AutosaveJournal::AutosaveJournal(DataFlowGraphModel &model,
+                                 QString const &directory,
+                                 QObject *parent)
+    : QObject(parent)
+    , _model(model)
+    , _directory(directory)
+    , _compactionThreshold(10000)
+    , _sequence(0)
+    , _recordsSinceCompaction(0)
+    , _compacting(false)
+    , _compactionSequence(0)
+{
+    _pool.setMaxThreadCount(1);
+
+    QString const journalName = journalFileName(_directory);
+
+    if (QFile::exists(journalName)) {
+        readJournal(journalName, [this](QJsonObject const &record) {
+            std::uint64_t const sequence = record["seq"].toVariant().toULongLong();
+
+            _sequence = std::max(_sequence, sequence);
+        });
+    } else {
+        _sequence = readSnapshot(snapshotFileName(_directory))[SequenceKey]
+                        .toVariant()
+                        .toULongLong();
+    }
+
+    openJournal();
+
+    capture();
+
+    connect(&_model, &AbstractGraphModel::nodeCreated, this, [this](NodeId const nodeId) {
+        writeCreatedNodes();
+
+        _createdNodes.push_back(nodeId);
+    });
+
+    connect(&_model, &AbstractGraphModel::nodeDeleted, this, [this](NodeId const nodeId) {
+        _movedNodes.erase(nodeId);
+        _changedNodes.erase(nodeId);
+
+        auto created = std::find(_createdNodes.begin(), _createdNodes.end(), nodeId);
+
+        // Never written, nothing to undo in the journal.
+        if (created != _createdNodes.end()) {
+            _createdNodes.erase(created);
+            return;
+        }
+
+        if (_nodes.remove(nodeId) == 0)
+            return;
+
+        QJsonObject record;
+        record["op"] = QStringLiteral("remove-node");
+        record["id"] = static_cast<qint64>(nodeId);
+
+        append(std::move(record));
+    });
+
+    connect(&_model, &AbstractGraphModel::nodePositionUpdated, this, [this](NodeId const nodeId) {
+        _movedNodes.insert(nodeId);
+    });
+
+    connect(&_model,
+            &AbstractGraphModel::nodePositionsUpdated,
+            this,
+            [this](std::vector<NodeId> const &nodeIds) {
+                _movedNodes.insert(nodeIds.begin(), nodeIds.end());
+            });
+
+    connect(&_model,
+            &DataFlowGraphModel::nodeInternalDataChanged,
+            this,
+            [this](NodeId const nodeId) { _changedNodes.insert(nodeId); });
+
+    connect(&_model,
+            &AbstractGraphModel::connectionCreated,
+            this,
+            [this](ConnectionId const connectionId) {
+                _connections.insert(connectionId);
+
+                QJsonObject record;
+                record["op"] = QStringLiteral("add-connection");
+                record["connection"] = toJson(connectionId);
+
+                append(std::move(record));
+            });
+
+    connect(&_model,
+            &AbstractGraphModel::connectionDeleted,
+            this,
+            [this](ConnectionId const connectionId) {
+                if (_connections.erase(connectionId) == 0)
+                    return;
+
+                QJsonObject record;
+                record["op"] = QStringLiteral("remove-connection");
+                record["connection"] = toJson(connectionId);
+
+                append(std::move(record));
+            });
+
+    connect(&_model,
+            &AbstractGraphModel::connectionsRemapped,
+            this,
+            [this](ConnectionRemap const &remap) {
+                for (auto const &entry : remap) {
+                    if (_connections.erase(entry.first) == 0)
+                        continue;
+
+                    QJsonObject record;
+                    record["op"] = QStringLiteral("remove-connection");
+                    record["connection"] = toJson(entry.first);
+
+                    append(std::move(record));
+                }
+
+                for (auto const &entry : remap) {
+                    _connections.insert(entry.second);
+
+                    QJsonObject record;
+                    record["op"] = QStringLiteral("add-connection");
+                    record["connection"] = toJson(entry.second);
+
+                    append(std::move(record));
+                }
+            });
+
+    connect(&_model, &AbstractGraphModel::batchFinished, this, [this](GraphChangeSet const &) {
+        writeCreatedNodes();
+
+        std::vector<QJsonObject> records = std::move(_batchRecords);
+        _batchRecords.clear();
+
+        for (QJsonObject &record : records) {
+            append(std::move(record));
+        }
+    });
+
+    connect(&_model, &AbstractGraphModel::modelReset, this, [this]() {
+        flush();
+        capture();
+        compact();
+    });
+
+    connect(&_flushTimer, &QTimer::timeout, this, [this]() { flush(); });
+
+    _flushTimer.start(1000);
+
+    // The first snapshot replaces whatever an earlier session left.
+    compact();
+}
+
+AutosaveJournal::~AutosaveJournal()
+{
+    flush();
+
+    _pool.waitForDone();
+}
+
+QString AutosaveJournal::snapshotFileName(QString const &directory)
+{
+    return QDir(directory).filePath(QStringLiteral("autosave.json"));
+}
+
+QString AutosaveJournal::journalFileName(QString const &directory)
+{
+    return QDir(directory).filePath(QStringLiteral("autosave.journal"));
+}
+
+bool AutosaveJournal::recover(DataFlowGraphModel &model, QString const &directory)
+{
+    QString const snapshotName = snapshotFileName(directory);
+    QString const journalName = journalFileName(directory);
+
+    if (!QFile::exists(snapshotName) && !QFile::exists(journalName))
+        return false;
+
+    QJsonObject const snapshot = readSnapshot(snapshotName);
+
+    model.load(snapshot);
+
+    std::uint64_t const sequence = snapshot[SequenceKey].toVariant().toULongLong();
+
+    GraphTransaction transaction(model);
+
+    readJournal(journalName, [&](QJsonObject const &record) {
+        if (record["seq"].toVariant().toULongLong() <= sequence)
+            return;
+
+        QString const op = record["op"].toString();
+
+        if (op == "add-node") {
+            QJsonObject const nodeJson = record["node"].toObject();
+
+            if (!model.nodeExists(static_cast<NodeId>(nodeJson["id"].toInt())))
+                model.loadNode(nodeJson);
+        } else if (op == "remove-node") {
+            model.deleteNode(static_cast<NodeId>(record["id"].toInt()));
+        } else if (op == "move-node") {
+            QJsonObject const posJson = record["position"].toObject();
+
+            model.setNodeData(static_cast<NodeId>(record["id"].toInt()),
+                              NodeRole::Position,
+                              QPointF(posJson["x"].toDouble(), posJson["y"].toDouble()));
+        } else if (op == "node-data") {
+            auto delegate = model.delegateModel<NodeDelegateModel>(
+                static_cast<NodeId>(record["id"].toInt()));
+
+            if (delegate)
+                delegate->load(record["internal-data"].toObject());
+        } else if (op == "add-connection") {
+            ConnectionId const connectionId = fromJson(record["connection"].toObject());
+
+            if (!model.connectionExists(connectionId))
+                model.addConnection(connectionId);
+        } else if (op == "remove-connection") {
+            model.deleteConnection(fromJson(record["connection"].toObject()));
+        }
+    });
+
+    return true;
+}
+
+void AutosaveJournal::setFlushInterval(int const milliseconds)
+{
+    _flushTimer.setInterval(milliseconds);
+}
+
+void AutosaveJournal::setCompactionThreshold(std::size_t const records)
+{
+    _compactionThreshold = records;
+}
+
+bool AutosaveJournal::flush()
+{
+    // The batch end writes them.
+    if (_model.batchInProgress())
+        return true;
+
+    writeCreatedNodes();
+    writeCoalescedUpdates();
+
+    bool const ok = writeBuffer();
+
+    if (_compactionThreshold > 0 && _recordsSinceCompaction >= _compactionThreshold)
+        compact();
+
+    return ok;
+}
+
+bool AutosaveJournal::writeBuffer()
+{
+    if (_buffer.isEmpty())
+        return true;
+
+    bool const ok = _journal.isOpen() && _journal.write(_buffer) == _buffer.size()
+                    && _journal.flush();
+
+    _buffer.clear();
+
+    return ok;
+}
+
+void AutosaveJournal::compact()
+{
+    if (_compacting || _model.batchInProgress())
+        return;
+
+    writeCreatedNodes();
+    writeCoalescedUpdates();
+    writeBuffer();
+
+    _compacting = true;
+    _compactionSequence = _sequence;
+    _sinceCompaction.clear();
+
+    _pool.start(new CompactionTask(snapshotFileName(_directory),
+                                   _nodes,
+                                   std::vector<ConnectionId>(_connections.begin(),
+                                                             _connections.end()),
+                                   _sequence,
+                                   [this](bool const ok) {
+                                       QMetaObject::invokeMethod(
+                                           this,
+                                           [this, ok]() { onCompactionFinished(ok); },
+                                           Qt::QueuedConnection);
+                                   }));
+}
+
+void AutosaveJournal::waitForCompaction()
+{
+    _pool.waitForDone();
+
+    // Delivers the queued completion.
+    QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+}
+
+void AutosaveJournal::capture()
+{
+    _createdNodes.clear();
+    _batchRecords.clear();
+    _movedNodes.clear();
+    _changedNodes.clear();
+
+    _nodes.clear();
+    _connections.clear();
+
+    for (NodeId const nodeId : _model.allNodeIds()) {
+        _nodes.insert(nodeId, _model.saveNode(nodeId));
+    }
+
+    _model.forEachGraphConnection(
+        [this](ConnectionId const &connectionId) { _connections.insert(connectionId); });
+}
+
+void AutosaveJournal::append(QJsonObject record)
+{
+    // Delegates may be loaded after all the nodes of a batch were created.
+    if (_model.batchInProgress()) {
+        _batchRecords.push_back(std::move(record));
+        return;
+    }
+
+    writeCreatedNodes();
+
+    record["seq"] = static_cast<qint64>(++_sequence);
+
+    QByteArray const line = QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n';
+
+    _buffer += line;
+
+    if (_compacting)
+        _sinceCompaction += line;
+
+    ++_recordsSinceCompaction;
+}
+
+void AutosaveJournal::writeCreatedNodes()
+{
+    if (_createdNodes.empty() || _model.batchInProgress())
+        return;
+
+    std::vector<NodeId> const created = std::move(_createdNodes);
+    _createdNodes.clear();
+
+    for (NodeId const nodeId : created) {
+        if (!_model.nodeExists(nodeId))
+            continue;
+
+        QJsonObject const nodeJson = _model.saveNode(nodeId);
+
+        _nodes.insert(nodeId, nodeJson);
+
+        // The saved node already has them.
+        _movedNodes.erase(nodeId);
+        _changedNodes.erase(nodeId);
+
+        QJsonObject record;
+        record["op"] = QStringLiteral("add-node");
+        record["node"] = nodeJson;
+
+        append(std::move(record));
+    }
+}
+
+void AutosaveJournal::writeCoalescedUpdates()
+{
+    for (NodeId const nodeId : _movedNodes) {
+        auto it = _nodes.find(nodeId);
+
+        if (it == _nodes.end())
+            continue;
+
+        QJsonObject const posJson = positionJson(
+            _model.nodeData<QPointF>(nodeId, NodeRole::Position));
+
+        it.value()["position"] = posJson;
+
+        QJsonObject record;
+        record["op"] = QStringLiteral("move-node");
+        record["id"] = static_cast<qint64>(nodeId);
+        record["position"] = posJson;
+
+        append(std::move(record));
+    }
+
+    _movedNodes.clear();
+
+    for (NodeId const nodeId : _changedNodes) {
+        auto it = _nodes.find(nodeId);
+
+        if (it == _nodes.end())
+            continue;
+
+        QJsonValue const internalData = _model.saveNode(nodeId)["internal-data"];
+
+        it.value()["internal-data"] = internalData;
+
+        QJsonObject record;
+        record["op"] = QStringLiteral("node-data");
+        record["id"] = static_cast<qint64>(nodeId);
+        record["internal-data"] = internalData;
+
+        append(std::move(record));
+    }
+
+    _changedNodes.clear();
+}
+
+void AutosaveJournal::onCompactionFinished(bool const ok)
+{
+    if (ok) {
+        // Still collected into `_sinceCompaction`.
+        writeCreatedNodes();
+        writeCoalescedUpdates();
+        writeBuffer();
+
+        _journal.close();
+
+        // Only the records past the snapshot are left. The first line keeps
+        // the sequence of the snapshot for the next session.
+        QJsonObject base;
+        base["op"] = QStringLiteral("base");
+        base["seq"] = static_cast<qint64>(_compactionSequence);
+
+        QSaveFile file(journalFileName(_directory));
+
+        if (file.open(QIODevice::WriteOnly)) {
+            file.write(QJsonDocument(base).toJson(QJsonDocument::Compact) + '\n');
+            file.write(_sinceCompaction);
+            file.commit();
+        }
+
+        _recordsSinceCompaction = static_cast<std::size_t>(_sinceCompaction.count('\n'));
+
+        openJournal();
+    }
+
+    _compacting = false;
+    _sinceCompaction.clear();
+
+    Q_EMIT compacted(ok);
+}
+
+bool AutosaveJournal::openJournal()
+{
+    _journal.setFileName(journalFileName(_directory));
+
+    return _journal.open(QIODevice::WriteOnly | QIODevice::Append);
+}
+
+} // namespace QtNodes
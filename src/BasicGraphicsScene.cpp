@@ -1,19 +1,29 @@
 #include "BasicGraphicsScene.hpp"
 
 #include "AbstractNodeGeometry.hpp"
+#include "ConnectionBatchLayer.hpp"
 #include "ConnectionGraphicsObject.hpp"
 #include "ConnectionIdUtils.hpp"
+#include "ConnectionPicker.hpp"
 #include "DefaultConnectionPainter.hpp"
 #include "DefaultHorizontalNodeGeometry.hpp"
 #include "DefaultNodePainter.hpp"
 #include "DefaultVerticalNodeGeometry.hpp"
 #include "GraphicsView.hpp"
+#include "LayeredLayout.hpp"
 #include "NodeGraphicsObject.hpp"
+#include "SharedSceneCache.hpp"
+#include "StyleCollection.hpp"
+#include "TemplatePicker.hpp"
+#include "UndoCommands.hpp"
 #include "qdebug.h"
 
 #include <QUndoStack>
 
+#include <QtGui/QPainter>
+#include <QtGui/QPen>
 #include <QtWidgets/QFileDialog>
+#include <QtWidgets/QGraphicsProxyWidget>
 #include <QtWidgets/QGraphicsSceneMoveEvent>
 
 #include <QtCore/QBuffer>
@@ -23,8 +33,13 @@
 #include <QtCore/QJsonArray>
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
+#include <QtCore/QLineF>
+#include <QtCore/QStringListModel>
+#include <QtCore/QTimer>
 #include <QtCore/QtGlobal>
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <stdexcept>
 #include <unordered_set>
@@ -33,15 +48,52 @@
 
 namespace QtNodes {
 
+namespace {
+
+/// Repaints the strips and forgets them.
+void updateStrips(QGraphicsScene &scene, std::vector<QRectF> &strips)
+{
+    for (QRectF const &strip : strips) {
+        scene.update(strip);
+    }
+
+    strips.clear();
+}
+
+} // namespace
+
 BasicGraphicsScene::BasicGraphicsScene(AbstractGraphModel &graphModel, QObject *parent)
     : QGraphicsScene(parent)
     , _graphModel(graphModel)
+    , _graphicsObjectPoolCapacity(512)
     , _nodeGeometry(std::make_unique<DefaultHorizontalNodeGeometry>(_graphModel))
     , _nodePainter(std::make_unique<DefaultNodePainter>())
     , _connectionPainter(std::make_unique<DefaultConnectionPainter>())
     , _nodeDrag(false)
+    , _batchMoveInProgress(false)
+    , _applyingBatch(false)
+    , _nodeUpdatePolicy(NodeUpdatePolicy::Immediate)
+    , _nodeUpdatesScheduled(false)
     , _undoStack(new QUndoStack(this))
+    , _undoMemoryBudget(64 * 1024 * 1024)
+    , _virtualized(false)
+    , _aggregated(false)
+    , _virtualizedNodeLimit(2000)
+    , _nodeRenderCacheEnabled(false)
+    , _widgetSnapshotsEnabled(false)
+    , _nodeShadowMode(NodeShadowMode::Effect)
+    , _computeHeatScale(0.0)
+    , _draftConnectionOverlay(false)
+    , _hoverOverlay(false)
+    , _overlayNode(InvalidNodeId)
+    , _overlayConnection{InvalidNodeId, InvalidPortIndex, InvalidNodeId, InvalidPortIndex}
+    , _connectionBatchLayer(nullptr)
+    , _connectionRouter(nullptr)
+    , _raisedNode(InvalidNodeId)
     , _orientation(Qt::Horizontal)
+    , _spatialIndexMode(SpatialIndexMode::NoIndex)
+    , _templateHeaders(new QStringListModel(this))
+    , _templatePickerConnection{InvalidNodeId, InvalidPortIndex, InvalidNodeId, InvalidPortIndex}
 {
     setItemIndexMethod(QGraphicsScene::NoIndex);
 
@@ -55,6 +107,11 @@ BasicGraphicsScene::BasicGraphicsScene(AbstractGraphModel &graphModel, QObject *
             this,
             &BasicGraphicsScene::onConnectionDeleted);
 
+    connect(&_graphModel,
+            &AbstractGraphModel::connectionsRemapped,
+            this,
+            &BasicGraphicsScene::onConnectionsRemapped);
+
     connect(&_graphModel,
             &AbstractGraphModel::nodeCreated,
             this,
@@ -70,19 +127,45 @@ BasicGraphicsScene::BasicGraphicsScene(AbstractGraphModel &graphModel, QObject *
             this,
             &BasicGraphicsScene::onNodePositionUpdated);
 
+    connect(&_graphModel,
+            &AbstractGraphModel::nodePositionsUpdated,
+            this,
+            &BasicGraphicsScene::onNodePositionsUpdated);
+
     connect(&_graphModel,
             &AbstractGraphModel::nodeUpdated,
             this,
             &BasicGraphicsScene::onNodeUpdated);
 
+    connect(&_graphModel,
+            &AbstractGraphModel::nodeFlagsUpdated,
+            this,
+            &BasicGraphicsScene::onNodeFlagsUpdated);
+
     connect(this, &BasicGraphicsScene::nodeClicked, this, &BasicGraphicsScene::onNodeClicked);
 
     connect(&_graphModel, &AbstractGraphModel::modelReset, this, &BasicGraphicsScene::onModelReset);
 
+    connect(&_graphModel,
+            &AbstractGraphModel::batchFinished,
+            this,
+            &BasicGraphicsScene::onBatchFinished);
+
+    connect(_undoStack, &QUndoStack::indexChanged, this, [this](int) {
+        enforceUndoMemoryBudget();
+    });
+
     traverseGraphAndPopulateGraphicsObjects();
 }
 
-BasicGraphicsScene::~BasicGraphicsScene() = default;
+BasicGraphicsScene::~BasicGraphicsScene()
+{
+    // No routes may arrive for connection items being destroyed.
+    setConnectionRouting(false);
+
+    // The connection items report to the layer while they are destroyed.
+    setConnectionBatching(false);
+}
 
 AbstractGraphModel const &BasicGraphicsScene::graphModel() const
 {
@@ -96,6 +179,9 @@ AbstractGraphModel &BasicGraphicsScene::graphModel()
 
 AbstractNodeGeometry &BasicGraphicsScene::nodeGeometry()
 {
+    if (_sharedCache)
+        return _sharedCache->nodeGeometry(_orientation);
+
     return *_nodeGeometry;
 }
 
@@ -124,11 +210,168 @@ QUndoStack &BasicGraphicsScene::undoStack()
     return *_undoStack;
 }
 
+void BasicGraphicsScene::setUndoMemoryBudget(std::size_t const bytes)
+{
+    _undoMemoryBudget = bytes;
+
+    enforceUndoMemoryBudget();
+}
+
+std::size_t BasicGraphicsScene::undoMemoryUsage() const
+{
+    std::size_t usage = 0;
+
+    for (int i = 0; i < _undoStack->count(); ++i) {
+        if (auto c = dynamic_cast<SnapshotCommand const *>(_undoStack->command(i)))
+            usage += c->memoryUsage();
+    }
+
+    return usage;
+}
+
+MemoryReport BasicGraphicsScene::memoryReport() const
+{
+    MemoryReport report;
+
+    std::size_t renderCacheCount = 0;
+    std::size_t renderCacheBytes = 0;
+
+    std::size_t widgetCount = 0;
+    std::size_t widgetBytes = 0;
+
+    for (auto const &entry : _nodeGraphicsObjects) {
+        NodeGraphicsObject const &ngo = *entry.second;
+
+        if (std::size_t const bytes = ngo.renderCacheBytes()) {
+            ++renderCacheCount;
+            renderCacheBytes += bytes;
+        }
+
+        if (auto proxy = ngo.proxyWidget()) {
+            QSize const size = proxy->widget() ? proxy->widget()->size() : QSize();
+
+            ++widgetCount;
+            widgetBytes += sizeof(QGraphicsProxyWidget) + sizeof(QWidget)
+                           + static_cast<std::size_t>(size.width()) * size.height() * 4;
+        }
+    }
+
+    report.add(QStringLiteral("nodeObjects"),
+               _nodeGraphicsObjects.size(),
+               MemoryReport::hashBytes(_nodeGraphicsObjects)
+                   + _nodeGraphicsObjects.size() * sizeof(NodeGraphicsObject));
+    report.add(QStringLiteral("nodeRenderCaches"), renderCacheCount, renderCacheBytes);
+
+    // Counted by every scene sharing them.
+    if (_sharedCache) {
+        report.add(QStringLiteral("sharedNodeImages"),
+                   _sharedCache->imageCount(),
+                   _sharedCache->imageBytes());
+    }
+    report.add(QStringLiteral("embeddedWidgets"), widgetCount, widgetBytes);
+
+    std::size_t labelCount = 0;
+    std::size_t labelBytes = 0;
+
+    for (auto const &entry : _connectionGraphicsObjects) {
+        QString const &label = entry.second->label();
+
+        if (!label.isEmpty()) {
+            ++labelCount;
+            labelBytes += static_cast<std::size_t>(label.capacity()) * sizeof(QChar);
+        }
+    }
+
+    report.add(QStringLiteral("connectionObjects"),
+               _connectionGraphicsObjects.size(),
+               MemoryReport::flatHashBytes(_connectionGraphicsObjects)
+                   + _connectionGraphicsObjects.size() * sizeof(ConnectionGraphicsObject));
+    report.add(QStringLiteral("connectionLabels"), labelCount, labelBytes);
+
+    std::size_t templateBytes = 0;
+
+    for (auto const &entry : _connectionTemplates) {
+        templateBytes += sizeof(entry) + 3 * sizeof(void *)
+                         + static_cast<std::size_t>(entry.second.capacity()) * sizeof(QChar);
+    }
+
+    report.add(QStringLiteral("connectionTemplates"), _connectionTemplates.size(), templateBytes);
+
+    std::size_t pickerBytes = 0;
+
+    for (QString const &header : _templateHeaders->stringList()) {
+        pickerBytes += sizeof(QString)
+                       + static_cast<std::size_t>(header.capacity()) * sizeof(QChar);
+    }
+
+    if (_templatePicker)
+        pickerBytes += sizeof(TemplatePicker);
+
+    report.add(QStringLiteral("templatePicker"), _templatePicker ? 1 : 0, pickerBytes);
+
+    report.add(QStringLiteral("undoStack"),
+               static_cast<std::size_t>(_undoStack->count()),
+               undoMemoryUsage());
+
+    return report;
+}
+
+void BasicGraphicsScene::enforceUndoMemoryBudget()
+{
+    if (_undoMemoryBudget == 0)
+        return;
+
+    std::size_t usage = undoMemoryUsage();
+
+    // The stack owns the commands but only hands out const pointers.
+    auto snapshotCommand = [this](int const i) {
+        return dynamic_cast<SnapshotCommand *>(const_cast<QUndoCommand *>(_undoStack->command(i)));
+    };
+
+    for (int i = 0; i < _undoStack->count() && usage > _undoMemoryBudget; ++i) {
+        SnapshotCommand *c = snapshotCommand(i);
+
+        if (!c || c->compressed() || c->isObsolete())
+            continue;
+
+        usage -= c->memoryUsage();
+        c->compress();
+        usage += c->memoryUsage();
+    }
+
+    // Evicting a command invalidates everything older, so whole prefixes of
+    // the done commands go. Commands that can still be redone are kept.
+    for (int i = 0; i < _undoStack->index() && usage > _undoMemoryBudget; ++i) {
+        auto c = const_cast<QUndoCommand *>(_undoStack->command(i));
+
+        if (c->isObsolete())
+            continue;
+
+        if (SnapshotCommand *snapshot = snapshotCommand(i)) {
+            usage -= snapshot->memoryUsage();
+            snapshot->evict();
+            usage += snapshot->memoryUsage();
+        } else {
+            c->setObsolete(true);
+        }
+    }
+}
+
 std::unique_ptr<ConnectionGraphicsObject> const &BasicGraphicsScene::makeDraftConnection(
     ConnectionId const incompleteConnectionId)
 {
+    clearDraftOverlay();
+
     _draftConnection = std::make_unique<ConnectionGraphicsObject>(*this, incompleteConnectionId);
 
+    _draftCompatibility.clear();
+
+    if (_draftConnectionOverlay) {
+        _draftConnection->setOverlaid(true);
+
+        updateDraftOverlay();
+    }
+
     _draftConnection->grabMouse();
 
     return _draftConnection;
@@ -136,351 +379,1788 @@ std::unique_ptr<ConnectionGraphicsObject> const &BasicGraphicsScene::makeDraftCo
 
 void BasicGraphicsScene::getRecordTemplates(std::vector<FcpDRC::cesgrouprecord> inputRecordVector)
 {
-    for (const auto &headerRecord : inputRecordVector)
+    for (auto &headerRecord : inputRecordVector)
     {
-        m_record.push_back(headerRecord);
+        QStringList const headers = headerRecord.getColumnHeaders();
+        QList<QColor> const colors = headerRecord.getColumnColors();
+
+        bool const known = std::any_of(m_record.begin(),
+                                       m_record.end(),
+                                       [&headers](FcpDRC::cesgrouprecord const &record) {
+                                           return record.getColumnHeaders() == headers;
+                                       });
+
+        if (known)
+            continue;
+
+        std::size_t const index = m_record.size();
+
+        m_record.push_back(std::move(headerRecord));
+
+        for (int i = 0; i < headers.size(); ++i)
+        {
+            if (_headerIndex.contains(headers[i]))
+                continue;
+
+            _headerIndex.insert(headers[i], HeaderEntry{colors.value(i), index});
+
+            int const row = _templateHeaders->rowCount();
+            _templateHeaders->insertRows(row, 1);
+            _templateHeaders->setData(_templateHeaders->index(row), headers[i]);
+        }
     }
 }
 
-void BasicGraphicsScene::resetDraftConnection()
+QColor BasicGraphicsScene::getColorForHeader(const QString &header) const
 {
-    _draftConnection.reset();
+    auto it = _headerIndex.constFind(header);
+
+    return it != _headerIndex.constEnd() ? it->color : QColor();
 }
 
-void BasicGraphicsScene::clearScene()
+FcpDRC::cesgrouprecord const *BasicGraphicsScene::recordForHeader(QString const &header) const
 {
-    auto const &allNodeIds = graphModel().allNodeIds();
+    auto it = _headerIndex.constFind(header);
 
-    for (auto nodeId : allNodeIds) {
-        graphModel().deleteNode(nodeId);
-    }
+    return it != _headerIndex.constEnd() ? &m_record[it->record] : nullptr;
 }
 
-NodeGraphicsObject *BasicGraphicsScene::nodeGraphicsObject(NodeId nodeId)
+void BasicGraphicsScene::resetDraftConnection()
 {
-    NodeGraphicsObject *ngo = nullptr;
-    auto it = _nodeGraphicsObjects.find(nodeId);
-    if (it != _nodeGraphicsObjects.end()) {
-        ngo = it->second.get();
-    }
+    clearDraftOverlay();
 
-    return ngo;
+    _draftConnection.reset();
+
+    _draftCompatibility.clear();
 }
 
-ConnectionGraphicsObject *BasicGraphicsScene::connectionGraphicsObject(ConnectionId connectionId)
+void BasicGraphicsScene::updateDraftOverlay()
 {
-    ConnectionGraphicsObject *cgo = nullptr;
-    auto it = _connectionGraphicsObjects.find(connectionId);
-    if (it != _connectionGraphicsObjects.end()) {
-        cgo = it->second.get();
-    }
+    if (!_draftConnection || !_draftConnection->overlaid())
+        return;
 
-    return cgo;
-}
+    ConnectionGraphicsObject const &cgo = *_draftConnection;
 
-std::vector<BasicGraphicsScene::ConnectionInfo> BasicGraphicsScene::getConnections() const {
-    std::vector<ConnectionInfo> connections;
+    PortType const requiredPort = cgo.connectionState().requiredPort();
 
-    for (const auto& [connectionId, dialogPair] : _dialogs) {
-        ConnectionInfo connectionInfo;
-        connectionInfo.connectionId = connectionId;
-        connectionInfo.nodeIdOut = connectionId.outNodeId;
-        connectionInfo.nodeIdIn = connectionId.inNodeId;
-        connectionInfo.portTypeIn = PortType::In;
-        connectionInfo.portTypeOut = PortType::Out;
-        connectionInfo.templateName = dialogPair.second; // Store the saved template name
+    QRectF rect = cgo.sceneTransform().mapRect(cgo.paintBounds());
 
-        connections.push_back(connectionInfo);
-    }
+    _draftHighlight = DraftHighlight();
 
-    return connections;
-}
+    NodeId const nodeId = cgo.connectionState().lastHoveredNode();
+    NodeGraphicsObject const *ngo = nodeGraphicsObject(nodeId);
 
+    if (ngo && requiredPort != PortType::None) {
+        QPointF const end = cgo.sceneTransform().map(cgo.endPoint(requiredPort));
 
-void BasicGraphicsScene::setOrientation(Qt::Orientation const orientation)
-{
-    if (_orientation != orientation) {
-        _orientation = orientation;
+        unsigned int const portCount = _graphModel
+                                           .nodeData(nodeId,
+                                                     requiredPort == PortType::Out
+                                                         ? NodeRole::OutPortCount
+                                                         : NodeRole::InPortCount)
+                                           .toUInt();
 
-        switch (_orientation) {
-        case Qt::Horizontal:
-            _nodeGeometry = std::make_unique<DefaultHorizontalNodeGeometry>(_graphModel);
-            break;
+        // Where the default painter starts growing the port under the end.
+        double nearest = 40.0;
 
-        case Qt::Vertical:
-            _nodeGeometry = std::make_unique<DefaultVerticalNodeGeometry>(_graphModel);
-            break;
+        for (PortIndex portIndex = 0; portIndex < portCount; ++portIndex) {
+            QPointF const p = nodeGeometry().portScenePosition(nodeId,
+                                                               requiredPort,
+                                                               portIndex,
+                                                               ngo->sceneTransform());
+
+            double const distance = QLineF(end, p).length();
+
+            if (distance >= nearest)
+                continue;
+
+            nearest = distance;
+
+            _draftHighlight.valid = true;
+            _draftHighlight.center = p;
+            _draftHighlight.possible = draftConnectionPossible(
+                makeCompleteConnectionId(cgo.connectionId(), nodeId, portIndex));
         }
+    }
 
-        onModelReset();
+    if (_draftHighlight.valid) {
+        qreal const radius = styleContext().nodeStyle().ConnectionPointDiameter + 2.0;
+
+        rect |= QRectF(_draftHighlight.center - QPointF(radius, radius),
+                       QSizeF(2.0 * radius, 2.0 * radius));
     }
+
+    QRectF const dirty = _draftOverlayRect | rect;
+
+    _draftOverlayRect = rect;
+
+    if (!dirty.isEmpty())
+        update(dirty);
 }
 
-QMenu *BasicGraphicsScene::createSceneMenu(QPointF const scenePos)
+void BasicGraphicsScene::clearDraftOverlay()
 {
-    Q_UNUSED(scenePos);
-    return nullptr;
+    if (!_draftOverlayRect.isEmpty())
+        update(_draftOverlayRect);
+
+    _draftOverlayRect = QRectF();
+    _draftHighlight = DraftHighlight();
 }
 
-void BasicGraphicsScene::traverseGraphAndPopulateGraphicsObjects()
+void BasicGraphicsScene::setHoverOverlay(bool const enabled)
 {
-    auto allNodeIds = _graphModel.allNodeIds();
+    if (_hoverOverlay == enabled)
+        return;
 
-    // First create all the nodes.
-    for (NodeId const nodeId : allNodeIds) {
-        _nodeGraphicsObjects[nodeId] = std::make_unique<NodeGraphicsObject>(*this, nodeId);
-    }
+    _hoverOverlay = enabled;
 
-    // Then for each node check output connections and insert them.
-    for (NodeId const nodeId : allNodeIds) {
-        auto nOutPorts = _graphModel.nodeData<PortCount>(nodeId, NodeRole::OutPortCount);
+    updateStrips(*this, _overlayNodeStrips);
+    updateStrips(*this, _overlayConnectionStrips);
 
-        for (PortIndex index = 0; index < nOutPorts; ++index) {
-            auto const &outConnectionIds = _graphModel.connections(nodeId, PortType::Out, index);
+    _overlayNode = InvalidNodeId;
+    _overlayConnection
+        = ConnectionId{InvalidNodeId, InvalidPortIndex, InvalidNodeId, InvalidPortIndex};
 
-            for (auto cid : outConnectionIds) {
-                _connectionGraphicsObjects[cid] = std::make_unique<ConnectionGraphicsObject>(*this,
-                                                                                             cid);
-            }
+    // The hovered items switch between painting the feedback and leaving it to the overlay.
+    for (auto &node : _nodeGraphicsObjects) {
+        if (node.second->nodeState().hovered()) {
+            node.second->invalidateRenderCache();
+            node.second->update();
+            updateHoverOverlay(*node.second);
         }
     }
-}
 
-void BasicGraphicsScene::updateAttachedNodes(ConnectionId const connectionId,
-                                             PortType const portType)
-{
-    auto node = nodeGraphicsObject(getNodeId(portType, connectionId));
-
-    if (node) {
-        node->update();
-    }
-}
+    for (auto &connection : _connectionGraphicsObjects) {
+        if (connection.second->connectionState().hovered()) {
+            connection.second->update();
 
-void BasicGraphicsScene::removeDialog(ConnectionId const connectionId) {
-    auto it = _dialogs.find(connectionId);
-    if (it != _dialogs.end()) {
-        // Закрываем диалог, если он открыт
-        it->second.first->close();
-        //it->second->close();
-        // Удаляем диалог из контейнера
-        _dialogs.erase(it);
-    }
-}
+            if (_connectionBatchLayer)
+                _connectionBatchLayer->markDirty(connection.first, connection.second.get());
 
-void BasicGraphicsScene::addTextUnderConnection(ConnectionId connectionId, const QString& templateText) {
-    // Получаем соединение по его идентификатору
-    auto connection = _connectionGraphicsObjects.find(connectionId);
-    if (connection != _connectionGraphicsObjects.end()) {
-        // Получаем объект соединения
-        ConnectionGraphicsObject* connectionObject = connection->second.get();
-
-        // Получаем конечные точки соединения
-        //QPointF outPoint = connectionObject->out();
-        QPointF inPoint = connectionObject->in();
-
-        // Рассчитываем среднюю точку для размещения текста
-        QPointF textPosition = inPoint;
-        textPosition.setX(textPosition.x() - 50);
-        textPosition.setY(textPosition.y() + 1); // Сдвигаем немного вниз
-
-        // Создаем текстовый элемент
-        QGraphicsTextItem* textItem = new QGraphicsTextItem(templateText);
-        textItem->setPos(textPosition);
-        textItem->setDefaultTextColor(Qt::white); // Устанавливаем цвет текста
-        textItem->setFont(QFont("Arial", 10)); // Установливаем шрифт и размер
-
-        // Добавляем текстовый элемент на сцену
-        this->addItem(textItem);
-
-        // Сохраняем текстовый элемент в структуре
-        _textItems[connectionId] = textItem; // Сохраняем текст под соединением
-
-        // Подключаем сигнал перемещения соединения к обновлению текста
-        QPointer<QGraphicsTextItem> textItemPtr(textItem);
-        connect(connectionObject, &ConnectionGraphicsObject::positionChanged, this, [textItemPtr, connectionObject]() {
-            if (textItemPtr) { // Проверяем, существует ли текстовый элемент
-                QPointF inPoint = connectionObject->in();
-                QPointF textPosition = inPoint;
-                textPosition.setX(textPosition.x() - 50);
-                textPosition.setY(textPosition.y() + 1); // Сдвигаем немного вниз
-                textItemPtr->setPos(textPosition);
-            }
-        });
+            updateHoverOverlay(*connection.second);
+        }
     }
 }
 
-void BasicGraphicsScene::onConnectionDeleted(ConnectionId const connectionId)
+void BasicGraphicsScene::updateHoverOverlay(NodeGraphicsObject const &ngo)
 {
-    auto it = _connectionGraphicsObjects.find(connectionId);
-    if (it != _connectionGraphicsObjects.end()) {
-        _connectionGraphicsObjects.erase(it);
-    }
+    if (!_hoverOverlay)
+        return;
 
-    // Удаляем текстовый элемент, если он существует
-    auto textIt = _textItems.find(connectionId);
-    if (textIt != _textItems.end()) {
-        QGraphicsTextItem* textItem = textIt.value();
-        this->removeItem(textItem); // Удаляем текстовый элемент из сцены
-        delete textItem; // Освобождаем память
-        _textItems.erase(textIt); // Удаляем из структуры
-    }
+    bool const hovered = ngo.nodeState().hovered();
 
-    // TODO: do we need it?
-    if (_draftConnection && _draftConnection->connectionId() == connectionId) {
-        _draftConnection.reset();
-    }
+    // Leaving a node after entering the next one.
+    if (!hovered && ngo.nodeId() != _overlayNode)
+        return;
 
-    updateAttachedNodes(connectionId, PortType::Out);
-    updateAttachedNodes(connectionId, PortType::In);
+    updateStrips(*this, _overlayNodeStrips);
 
-    // Удаляем диалоговое окно, если оно существует
-    removeDialog(connectionId);
+    _overlayNode = hovered ? ngo.nodeId() : InvalidNodeId;
 
-    Q_EMIT modified(this);
-}
+    if (!hovered)
+        return;
 
-void BasicGraphicsScene::onConnectionCreated(ConnectionId const connectionId)
-{
-    // Создаем объект соединения
-    auto connectionObject = std::make_unique<ConnectionGraphicsObject>(*this, connectionId);
+    QRectF const outline = ngo.sceneTransform().mapRect(
+        QRectF(QPointF(0.0, 0.0), QSizeF(nodeGeometry().size(ngo.nodeId()))));
 
-    // Устанавливаем обработчик двойного клика
-    connect(connectionObject.get(), &ConnectionGraphicsObject::doubleClicked, this, [this, connectionId]() {
-        openDialog(connectionId);
-    });
+    // Half the pen and the antialiasing on either side of the outline.
+    qreal const margin = ngo.nodeStyle().HoveredPenWidth / 2.0 + 2.0;
 
-    _connectionGraphicsObjects[connectionId] = std::move(connectionObject);
+    QRectF const outer = outline.adjusted(-margin, -margin, margin, margin);
+    qreal const width = 2.0 * margin;
 
-    updateAttachedNodes(connectionId, PortType::Out);
-    updateAttachedNodes(connectionId, PortType::In);
+    _overlayNodeStrips = {QRectF(outer.left(), outer.top(), outer.width(), width),
+                          QRectF(outer.left(), outer.bottom() - width, outer.width(), width),
+                          QRectF(outer.left(), outer.top(), width, outer.height()),
+                          QRectF(outer.right() - width, outer.top(), width, outer.height())};
+
+    for (QRectF const &strip : _overlayNodeStrips) {
+        update(strip);
+    }
 }
 
-void BasicGraphicsScene::openDialog(ConnectionId const connectionId)
+void BasicGraphicsScene::updateHoverOverlay(ConnectionGraphicsObject const &cgo)
 {
-    if (_dialogs.find(connectionId) == _dialogs.end())
-    {
-        // Если диалог не существует, создаем его
-        auto dialog = std::make_unique<QDialog>();
-        dialog->setWindowTitle("Select template");
-        dialog->setModal(true);
+    if (!_hoverOverlay)
+        return;
 
-        QVBoxLayout *layout = new QVBoxLayout(dialog.get());
-        QLabel *label = new QLabel("Select template:");
-        layout->addWidget(label);
+    bool const hovered = cgo.connectionState().hovered();
 
-        QListWidget *listWidget = new QListWidget();
-        layout->addWidget(listWidget);
+    if (!hovered && cgo.connectionId() != _overlayConnection)
+        return;
 
-        QStringList headers;
-        for (const auto &headerRecord : m_record)
-        {
-            headers = headerRecord.getColumnHeaders();
-            for (int i = 0; i < headers.size(); ++i)
-            {
-                listWidget->addItem(headers[i]);
-            }
-        }
+    updateStrips(*this, _overlayConnectionStrips);
 
-        QPushButton *okButton = new QPushButton("OK");
-        layout->addWidget(okButton);
+    _overlayConnection = hovered ? cgo.connectionId()
+                                 : ConnectionId{InvalidNodeId,
+                                                InvalidPortIndex,
+                                                InvalidNodeId,
+                                                InvalidPortIndex};
 
-        // Подключаем сигнал кнопки OK к слоту, который будет обрабатывать выбор
-        connect(okButton, &QPushButton::clicked, [this, connectionId, dialog = dialog.get(), listWidget]()
-        {
-            // Получаем выбранный элемент из listWidget
-            QListWidgetItem *selectedItem = listWidget->currentItem();
-            if (selectedItem) {
-                QString selectedTemplate = selectedItem->text();
-                // Сохраняем выбранный шаблон в _dialogs
-                _dialogs[connectionId].second = selectedTemplate;
-                //qDebug() << "Selected template for connection" << connectionId << ":" << selectedTemplate;
-
-                // Получаем цвет для выбранного заголовка
-                QColor selectedColor = getColorForHeader(selectedTemplate);
-
-                // Устанавливаем цвет соединения
-                if (auto connectionObject = connectionGraphicsObject(connectionId)) {
-                    connectionObject->setConnectionColor(selectedColor); // Устанавливаем цвет
-                    connectionObject->update(); // Обновляем отображение
-                }
-
-                // Обновляем соединение, чтобы использовать новый цвет
-                if (auto connectionObject = connectionGraphicsObject(connectionId)) {
-                    connectionObject->update();
-                }
-
-                addTextUnderConnection(connectionId, selectedTemplate);
-            }
-            dialog->accept(); // Закрываем диалог
-        });
-        // Сохраняем диалог в контейнер
-        _dialogs[connectionId] = std::make_pair(std::move(dialog), QString());
+    if (!hovered)
+        return;
+
+    // The halo is twice the line wide, as drawn by the connection painter.
+    qreal const margin = styleContext().connectionStyle().lineWidth() + 2.0;
+
+    // One strip per chord of the flattened curve.
+    for (QPolygonF const &polygon : cgo.cubicPath().toSubpathPolygons(cgo.sceneTransform())) {
+        for (int i = 1; i < polygon.size(); ++i) {
+            QRectF const chord = QRectF(polygon[i - 1], polygon[i]).normalized();
+
+            _overlayConnectionStrips.push_back(chord.adjusted(-margin, -margin, margin, margin));
+        }
     }
-    // Показываем диалоговое окно для данного соединения
-    _dialogs[connectionId].first->show();
 
-    Q_EMIT modified(this);
+    for (QRectF const &strip : _overlayConnectionStrips) {
+        update(strip);
+    }
 }
 
-void BasicGraphicsScene::onNodeDeleted(NodeId const nodeId)
+bool BasicGraphicsScene::draftConnectionPossible(ConnectionId const connectionId) const
 {
-    auto it = _nodeGraphicsObjects.find(nodeId);
-    if (it != _nodeGraphicsObjects.end()) {
-        _nodeGraphicsObjects.erase(it);
+    auto it = _draftCompatibility.find(connectionId);
 
-        Q_EMIT modified(this);
-    }
+    if (it != _draftCompatibility.end())
+        return it->second;
+
+    bool const possible = _graphModel.connectionPossible(connectionId);
+
+    _draftCompatibility.emplace(connectionId, possible);
+
+    return possible;
 }
 
-void BasicGraphicsScene::onNodeCreated(NodeId const nodeId)
+void BasicGraphicsScene::clearScene()
 {
-    _nodeGraphicsObjects[nodeId] = std::make_unique<NodeGraphicsObject>(*this, nodeId);
-
-    Q_EMIT modified(this);
+    graphModel().clear();
 }
 
-void BasicGraphicsScene::onNodePositionUpdated(NodeId const nodeId)
+void BasicGraphicsScene::reserve(std::size_t const nodes, std::size_t const connections)
 {
-    auto node = nodeGraphicsObject(nodeId);
-    if (node) {
-        node->setPos(_graphModel.nodeData(nodeId, NodeRole::Position).value<QPointF>());
-        node->update();
-        _nodeDrag = true;
-    }
+    _graphModel.reserve(nodes, connections);
+
+    _nodeGraphicsObjects.reserve(_nodeGraphicsObjects.size() + nodes);
+    _connectionGraphicsObjects.reserve(_connectionGraphicsObjects.size() + connections);
 }
 
-void BasicGraphicsScene::onNodeUpdated(NodeId const nodeId)
+void BasicGraphicsScene::autoLayout(std::unordered_set<NodeId> const &nodeIds)
 {
-    auto node = nodeGraphicsObject(nodeId);
+    LayeredLayout::Options options;
+    options.orientation = _orientation;
 
-    if (node) {
-        node->setGeometryChanged();
+    LayeredLayout layout(options);
 
-        _nodeGeometry->recomputeSize(nodeId);
+    std::unordered_set<NodeId> const laidOut = nodeIds.empty() ? _graphModel.allNodeIds()
+                                                               : nodeIds;
 
-        node->updateQWidgetEmbedPos();
-        node->update();
-        node->moveConnections();
+    std::unordered_map<NodeId, QSize> sizes;
+    sizes.reserve(laidOut.size());
+
+    for (NodeId const nodeId : laidOut) {
+        sizes.emplace(nodeId, nodeGeometry().size(nodeId));
     }
+
+    layout.setNodeSizes(std::move(sizes));
+
+    layout.apply(_graphModel, nodeIds);
 }
 
-void BasicGraphicsScene::onNodeClicked(NodeId const nodeId)
+void BasicGraphicsScene::dragSelectedNodes(QPointF const &delta)
 {
-    if (_nodeDrag) {
-        Q_EMIT nodeMoved(nodeId, _graphModel.nodeData(nodeId, NodeRole::Position).value<QPointF>());
-        Q_EMIT modified(this);
+    if (!_dragSession.active) {
+        _dragSession.active = true;
+        _dragSession.nodeSet.clear();
+        _dragSession.nodes.clear();
+        _dragSession.totalDelta = QPointF();
+
+        _dragSession.nodeSet = _selectedNodeIds;
+        _dragSession.nodes.assign(_selectedNodeIds.begin(), _selectedNodeIds.end());
     }
-    _nodeDrag = false;
+
+    if (_dragSession.nodes.empty())
+        return;
+
+    _graphModel.moveNodes(_dragSession.nodes, delta);
+
+    _dragSession.totalDelta += delta;
 }
 
-void BasicGraphicsScene::onModelReset()
+void BasicGraphicsScene::finishNodeDrag()
 {
-    _connectionGraphicsObjects.clear();
-    _nodeGraphicsObjects.clear();
+    if (!_dragSession.active)
+        return;
 
-    clear();
+    _dragSession.active = false;
 
-    traverseGraphAndPopulateGraphicsObjects();
+    if (_dragSession.nodes.empty() || _dragSession.totalDelta.isNull())
+        return;
+
+    _undoStack->push(new MoveNodeCommand(this,
+                                         std::move(_dragSession.nodeSet),
+                                         _dragSession.totalDelta,
+                                         true));
+
+    _dragSession.nodeSet.clear();
+    _dragSession.nodes.clear();
+}
+
+NodeGraphicsObject *BasicGraphicsScene::nodeGraphicsObject(NodeId nodeId)
+{
+    NodeGraphicsObject *ngo = nullptr;
+    auto it = _nodeGraphicsObjects.find(nodeId);
+    if (it != _nodeGraphicsObjects.end()) {
+        ngo = it->second.get();
+    }
+
+    return ngo;
+}
+
+ConnectionGraphicsObject *BasicGraphicsScene::connectionGraphicsObject(ConnectionId connectionId)
+{
+    ConnectionGraphicsObject *cgo = nullptr;
+    auto it = _connectionGraphicsObjects.find(connectionId);
+    if (it != _connectionGraphicsObjects.end()) {
+        cgo = it->second.get();
+    }
+
+    return cgo;
+}
+
+std::vector<BasicGraphicsScene::ConnectionInfo> BasicGraphicsScene::getConnections() const {
+    std::vector<ConnectionInfo> connections;
+
+    getConnections(connections);
+
+    return connections;
+}
+
+void BasicGraphicsScene::getConnections(std::vector<ConnectionInfo> &connections) const
+{
+    connections.clear();
+    connections.reserve(_connectionTemplates.size());
+
+    for (const auto& [connectionId, templateName] : _connectionTemplates) {
+        ConnectionInfo connectionInfo;
+        connectionInfo.connectionId = connectionId;
+        connectionInfo.nodeIdOut = connectionId.outNodeId;
+        connectionInfo.nodeIdIn = connectionId.inNodeId;
+        connectionInfo.portTypeIn = PortType::In;
+        connectionInfo.portTypeOut = PortType::Out;
+        connectionInfo.templateName = templateName; // Store the saved template name
+
+        connections.push_back(std::move(connectionInfo));
+    }
+}
+
+
+void BasicGraphicsScene::setOrientation(Qt::Orientation const orientation)
+{
+    if (_orientation != orientation) {
+        _orientation = orientation;
+
+        switch (_orientation) {
+        case Qt::Horizontal:
+            _nodeGeometry = std::make_unique<DefaultHorizontalNodeGeometry>(_graphModel);
+            break;
+
+        case Qt::Vertical:
+            _nodeGeometry = std::make_unique<DefaultVerticalNodeGeometry>(_graphModel);
+            break;
+        }
+
+        _nodeGeometry->setStyleContext(_styleContext);
+
+        onModelReset();
+
+        // The stubs leave the ports in the other direction now.
+        if (_connectionRouter)
+            _connectionRouter->rerouteAll();
+    }
+}
+
+void BasicGraphicsScene::setSpatialIndexMode(SpatialIndexMode const mode, qreal const cellSize)
+{
+    _spatialIndexMode = mode;
+
+    setItemIndexMethod(mode == SpatialIndexMode::BspTree ? QGraphicsScene::BspTreeIndex
+                                                         : QGraphicsScene::NoIndex);
+
+    _nodeIndex.setCellSize(cellSize);
+    _connectionIndex.setCellSize(cellSize);
+
+    rebuildSpatialIndex();
+}
+
+void BasicGraphicsScene::setVirtualized(bool const virtualized)
+{
+    if (_virtualized == virtualized)
+        return;
+
+    _virtualized = virtualized;
+    _aggregated = false;
+
+    if (_virtualized && _visibleSceneRect.isEmpty() && !views().isEmpty()) {
+        QGraphicsView const *view = views().first();
+
+        _visibleSceneRect = view->mapToScene(view->viewport()->rect()).boundingRect();
+    }
+
+    onModelReset();
+
+    update();
+}
+
+void BasicGraphicsScene::setVisibleSceneRect(QRectF const &rect)
+{
+    if (_visibleSceneRect == rect)
+        return;
+
+    _visibleSceneRect = rect;
+
+    updateVirtualizedItems();
+
+    Q_EMIT visibleSceneRectChanged(rect);
+}
+
+void BasicGraphicsScene::setVirtualizedNodeLimit(std::size_t const limit)
+{
+    _virtualizedNodeLimit = limit;
+
+    updateVirtualizedItems();
+}
+
+void BasicGraphicsScene::setGraphicsObjectPoolCapacity(std::size_t const capacity)
+{
+    _graphicsObjectPoolCapacity = capacity;
+
+    if (_nodeObjectPool.size() > capacity)
+        _nodeObjectPool.resize(capacity);
+
+    if (_connectionObjectPool.size() > capacity)
+        _connectionObjectPool.resize(capacity);
+}
+
+void BasicGraphicsScene::setNodeRenderCacheEnabled(bool const enabled)
+{
+    if (_nodeRenderCacheEnabled == enabled)
+        return;
+
+    _nodeRenderCacheEnabled = enabled;
+
+    for (auto &node : _nodeGraphicsObjects) {
+        node.second->invalidateRenderCache();
+        node.second->update();
+    }
+}
+
+void BasicGraphicsScene::setSharedCache(std::shared_ptr<SharedSceneCache> cache)
+{
+    if (cache == _sharedCache)
+        return;
+
+    if (cache && &cache->graphModel() != &_graphModel)
+        throw std::invalid_argument("The shared cache belongs to another graph model");
+
+    _sharedCache = std::move(cache);
+
+    updateGeometryStyles();
+
+    // The objects were laid out by the previous geometry.
+    onModelReset();
+}
+
+void BasicGraphicsScene::setStyleContext(std::shared_ptr<StyleContext const> context)
+{
+    if (context == _styleContext)
+        return;
+
+    _styleContext = std::move(context);
+
+    updateGeometryStyles();
+
+    for (QGraphicsView *view : views()) {
+        view->setBackgroundBrush(styleContext().viewStyle().BackgroundColor);
+    }
+
+    // Sizes, node styles and rendered images all follow the styles.
+    onModelReset();
+}
+
+StyleContext const &BasicGraphicsScene::styleContext() const
+{
+    return _styleContext ? *_styleContext : StyleCollection::current();
+}
+
+void BasicGraphicsScene::updateGeometryStyles()
+{
+    _nodeGeometry->setStyleContext(_styleContext);
+
+    // Scenes sharing a cache are expected to share the context as well.
+    if (_sharedCache && _styleContext) {
+        for (Qt::Orientation const orientation : {Qt::Horizontal, Qt::Vertical}) {
+            _sharedCache->nodeGeometry(orientation).setStyleContext(_styleContext);
+        }
+    }
+}
+
+void BasicGraphicsScene::setWidgetSnapshotsEnabled(bool const enabled)
+{
+    if (_widgetSnapshotsEnabled == enabled)
+        return;
+
+    _widgetSnapshotsEnabled = enabled;
+
+    for (auto &node : _nodeGraphicsObjects) {
+        node.second->updateWidgetActivation();
+    }
+}
+
+void BasicGraphicsScene::setNodeShadowMode(NodeShadowMode const mode)
+{
+    if (_nodeShadowMode == mode)
+        return;
+
+    _nodeShadowMode = mode;
+
+    for (auto &node : _nodeGraphicsObjects) {
+        node.second->updateShadow();
+        node.second->invalidateRenderCache();
+        node.second->update();
+    }
+}
+
+void BasicGraphicsScene::setComputeHeatScale(double const milliseconds)
+{
+    if (_computeHeatScale == milliseconds)
+        return;
+
+    _computeHeatScale = milliseconds;
+
+    for (auto &node : _nodeGraphicsObjects) {
+        node.second->invalidateRenderCache();
+        node.second->update();
+    }
+}
+
+void BasicGraphicsScene::setConnectionBatching(bool const enabled)
+{
+    if (connectionBatching() == enabled)
+        return;
+
+    if (enabled) {
+        _connectionBatchLayer = new ConnectionBatchLayer(*this);
+
+        for (auto &connection : _connectionGraphicsObjects) {
+            _connectionBatchLayer->markDirty(connection.first, connection.second.get());
+        }
+    } else {
+        delete _connectionBatchLayer;
+        _connectionBatchLayer = nullptr;
+    }
+
+    for (auto &connection : _connectionGraphicsObjects) {
+        connection.second->update();
+    }
+}
+
+void BasicGraphicsScene::setConnectionPicking(bool const enabled)
+{
+    if (connectionPicking() == enabled)
+        return;
+
+    if (!enabled) {
+        _connectionPicker.reset();
+        return;
+    }
+
+    _connectionPicker = std::make_unique<ConnectionPicker>();
+
+    for (auto const &connection : _connectionGraphicsObjects) {
+        updateConnectionPicker(*connection.second);
+    }
+}
+
+ConnectionGraphicsObject *BasicGraphicsScene::connectionAt(QPointF const &scenePoint,
+                                                           QTransform const &viewTransform)
+{
+    if (_connectionPicker) {
+        ConnectionId connectionId;
+
+        if (_connectionPicker->pick(scenePoint, connectionId))
+            return connectionGraphicsObject(connectionId);
+    }
+
+    QList<QGraphicsItem *> const candidates = items(scenePoint,
+                                                    Qt::IntersectsItemBoundingRect,
+                                                    Qt::DescendingOrder,
+                                                    viewTransform);
+
+    for (QGraphicsItem *item : candidates) {
+        auto cgo = qgraphicsitem_cast<ConnectionGraphicsObject *>(item);
+
+        // Picked ones were tested above; the rest are routed or drafts.
+        if (!cgo || (_connectionPicker && _connectionPicker->contains(cgo->connectionId())))
+            continue;
+
+        if (cgo->shape().contains(cgo->mapFromScene(scenePoint)))
+            return cgo;
+    }
+
+    return nullptr;
+}
+
+void BasicGraphicsScene::setConnectionRouting(bool const enabled,
+                                              ConnectionRouter::Style const style)
+{
+    if (enabled && _connectionRouter) {
+        _connectionRouter->setStyle(style);
+        return;
+    }
+
+    if (connectionRouting() == enabled)
+        return;
+
+    if (enabled) {
+        _connectionRouter = new ConnectionRouter(*this, style);
+    } else {
+        delete _connectionRouter;
+        _connectionRouter = nullptr;
+
+        for (auto &connection : _connectionGraphicsObjects) {
+            connection.second->updateRoute();
+        }
+    }
+}
+
+void BasicGraphicsScene::drawForeground(QPainter *painter, QRectF const &rect)
+{
+    QGraphicsScene::drawForeground(painter, rect);
+
+    if (_virtualized && _aggregated)
+        drawNodeDensity(painter, rect);
+
+    drawHoverOverlay(painter, rect);
+
+    drawDraftOverlay(painter, rect);
+}
+
+void BasicGraphicsScene::drawHoverOverlay(QPainter *painter, QRectF const &rect)
+{
+    if (!_hoverOverlay)
+        return;
+
+    auto exposed = [&rect](std::vector<QRectF> const &strips) {
+        return std::any_of(strips.begin(), strips.end(), [&rect](QRectF const &strip) {
+            return strip.intersects(rect);
+        });
+    };
+
+    ConnectionGraphicsObject const *cgo = connectionGraphicsObject(_overlayConnection);
+
+    if (cgo && exposed(_overlayConnectionStrips)) {
+        auto const &connectionStyle = styleContext().connectionStyle();
+
+        painter->save();
+
+        painter->setTransform(cgo->sceneTransform(), true);
+
+        painter->setPen(QPen(connectionStyle.hoveredColor(), 2.0 * connectionStyle.lineWidth()));
+        painter->setBrush(Qt::NoBrush);
+        painter->drawPath(cgo->cubicPath());
+
+        // The halo goes under the line, so the line is drawn again on top.
+        connectionPainter().paint(painter, *cgo);
+
+        painter->restore();
+    }
+
+    NodeGraphicsObject const *ngo = nodeGraphicsObject(_overlayNode);
+
+    if (ngo && exposed(_overlayNodeStrips)) {
+        NodeStyle const &nodeStyle = ngo->nodeStyle();
+
+        QColor const color = ngo->isSelected() ? nodeStyle.SelectedBoundaryColor
+                                               : nodeStyle.NormalBoundaryColor;
+
+        painter->save();
+
+        painter->setTransform(ngo->sceneTransform(), true);
+
+        painter->setPen(QPen(color, nodeStyle.HoveredPenWidth));
+        painter->setBrush(Qt::NoBrush);
+        QRectF const boundary(QPointF(0.0, 0.0), QSizeF(nodeGeometry().size(_overlayNode)));
+
+        // As the outline of the default node painter.
+        painter->drawRoundedRect(boundary, 3.0, 3.0);
+
+        painter->restore();
+    }
+}
+
+void BasicGraphicsScene::drawDraftOverlay(QPainter *painter, QRectF const &rect)
+{
+    if (!_draftConnection || !_draftConnection->overlaid() || !rect.intersects(_draftOverlayRect))
+        return;
+
+    painter->save();
+
+    painter->setTransform(_draftConnection->sceneTransform(), true);
+
+    connectionPainter().paint(painter, *_draftConnection);
+
+    painter->restore();
+
+    if (!_draftHighlight.valid)
+        return;
+
+    QColor const color = _draftHighlight.possible ? styleContext().connectionStyle().hoveredColor()
+                                                  : styleContext().nodeStyle().ErrorColor;
+
+    qreal const radius = styleContext().nodeStyle().ConnectionPointDiameter;
+
+    painter->save();
+
+    painter->setPen(QPen(color, 2.0));
+    painter->setBrush(Qt::NoBrush);
+    painter->drawEllipse(_draftHighlight.center, radius, radius);
+
+    painter->restore();
+}
+
+void BasicGraphicsScene::drawNodeDensity(QPainter *painter, QRectF const &rect)
+{
+
+    // Coarsen the cells until a few thousand of them cover the area.
+    qreal cellSize = _modelNodeIndex.cellSize();
+
+    while (rect.width() / cellSize > 64.0 || rect.height() / cellSize > 64.0) {
+        cellSize *= 2.0;
+    }
+
+    std::unordered_map<quint64, int> counts;
+    int maxCount = 0;
+
+    _modelNodeIndex.query(rect, [&](NodeId const, QRectF const &nodeRect) {
+        QPointF const center = nodeRect.center();
+
+        auto const x = static_cast<qint32>(std::floor(center.x() / cellSize));
+        auto const y = static_cast<qint32>(std::floor(center.y() / cellSize));
+
+        int &count = counts[(static_cast<quint64>(static_cast<quint32>(x)) << 32)
+                            | static_cast<quint32>(y)];
+
+        maxCount = std::max(maxCount, ++count);
+    });
+
+    QColor color = styleContext().nodeStyle().GradientColor1;
+
+    for (auto const &cell : counts) {
+        auto const x = static_cast<qint32>(cell.first >> 32);
+        auto const y = static_cast<qint32>(cell.first & 0xffffffffu);
+
+        color.setAlphaF(0.25 + 0.75 * cell.second / maxCount);
+
+        painter->fillRect(QRectF(x * cellSize, y * cellSize, cellSize, cellSize), color);
+    }
+}
+
+QRectF BasicGraphicsScene::modelNodeRect(NodeId const nodeId) const
+{
+    return modelNodeRect(_graphModel.nodeData<QPointF>(nodeId, NodeRole::Position),
+                         _graphModel.nodeData<QSize>(nodeId, NodeRole::Size));
+}
+
+QRectF BasicGraphicsScene::modelNodeRect(QPointF const &pos, QSize size)
+{
+    // The size is only computed when a graphics object is first created.
+    if (size.isEmpty())
+        size = QSize(150, 100);
+
+    return QRectF(pos, QSizeF(size));
+}
+
+void BasicGraphicsScene::updateVirtualizedItems()
+{
+    if (!_virtualized || _visibleSceneRect.isEmpty())
+        return;
+
+    qreal const dx = _visibleSceneRect.width() / 2.0;
+    qreal const dy = _visibleSceneRect.height() / 2.0;
+
+    QRectF const loadRect = _visibleSceneRect.adjusted(-dx, -dy, dx, dy);
+    QRectF const keepRect = _visibleSceneRect.adjusted(-2.0 * dx, -2.0 * dy, 2.0 * dx, 2.0 * dy);
+
+    std::vector<NodeId> inView;
+
+    _modelNodeIndex.query(loadRect, [&inView](NodeId const nodeId, QRectF const &) {
+        inView.push_back(nodeId);
+    });
+
+    bool const aggregated = inView.size() > _virtualizedNodeLimit;
+
+    if (aggregated != _aggregated) {
+        _aggregated = aggregated;
+        update();
+    }
+
+    std::vector<NodeId> released;
+
+    for (auto const &entry : _nodeGraphicsObjects) {
+        NodeGraphicsObject const &ngo = *entry.second;
+
+        if (ngo.isSelected() || mouseGrabberItem() == &ngo)
+            continue;
+
+        if (aggregated || !keepRect.intersects(ngo.sceneBoundingRect()))
+            released.push_back(entry.first);
+    }
+
+    for (NodeId const nodeId : released) {
+        releaseNodeGraphicsObject(nodeId);
+    }
+
+    if (aggregated)
+        return;
+
+    for (NodeId const nodeId : inView) {
+        if (_nodeGraphicsObjects.count(nodeId) == 0)
+            createNodeGraphicsObject(nodeId);
+    }
+}
+
+void BasicGraphicsScene::createNodeGraphicsObject(NodeId const nodeId)
+{
+    auto &ngo = _nodeGraphicsObjects[nodeId];
+    ngo = makeNodeGraphicsObject(nodeId);
+
+    updateSpatialIndex(*ngo);
+
+    if (!_virtualized)
+        return;
+
+    // The size is known now that the geometry was computed.
+    _modelNodeIndex.insert(nodeId, ngo->sceneBoundingRect());
+
+    std::vector<ConnectionId> connections;
+
+    _graphModel.forEachNodeConnection(nodeId, [&connections](ConnectionId const &cid) {
+        connections.push_back(cid);
+    });
+
+    for (auto const &cid : connections) {
+        if (auto cgo = connectionGraphicsObject(cid))
+            cgo->move();
+        else
+            createConnectionGraphicsObject(cid);
+    }
+}
+
+void BasicGraphicsScene::releaseNodeGraphicsObject(NodeId const nodeId)
+{
+    auto it = _nodeGraphicsObjects.find(nodeId);
+    if (it != _nodeGraphicsObjects.end()) {
+        recycleGraphicsObject(std::move(it->second));
+        _nodeGraphicsObjects.erase(it);
+    }
+
+    _nodeIndex.remove(nodeId);
+
+    std::vector<ConnectionId> orphans;
+
+    _graphModel.forEachNodeConnection(nodeId, [&](ConnectionId const &cid) {
+        NodeId const otherId = cid.outNodeId == nodeId ? cid.inNodeId : cid.outNodeId;
+
+        if (!nodeGraphicsObject(otherId))
+            orphans.push_back(cid);
+    });
+
+    for (auto const &cid : orphans) {
+        auto orphan = _connectionGraphicsObjects.find(cid);
+        if (orphan != _connectionGraphicsObjects.end()) {
+            recycleGraphicsObject(std::move(orphan->second));
+            _connectionGraphicsObjects.erase(orphan);
+        }
+
+        _connectionIndex.remove(cid);
+
+        if (_connectionPicker)
+            _connectionPicker->remove(cid);
+    }
+}
+
+BasicGraphicsScene::UniqueNodeGraphicsObject BasicGraphicsScene::makeNodeGraphicsObject(
+    NodeId const nodeId)
+{
+    if (_nodeObjectPool.empty())
+        return std::make_unique<NodeGraphicsObject>(*this, nodeId);
+
+    UniqueNodeGraphicsObject ngo = std::move(_nodeObjectPool.back());
+    _nodeObjectPool.pop_back();
+
+    ngo->reuse(*this, nodeId);
+
+    return ngo;
+}
+
+BasicGraphicsScene::UniqueConnectionGraphicsObject BasicGraphicsScene::makeConnectionGraphicsObject(
+    ConnectionId const connectionId)
+{
+    if (_connectionObjectPool.empty())
+        return std::make_unique<ConnectionGraphicsObject>(*this, connectionId);
+
+    UniqueConnectionGraphicsObject cgo = std::move(_connectionObjectPool.back());
+    _connectionObjectPool.pop_back();
+
+    cgo->reuse(*this, connectionId);
+
+    return cgo;
+}
+
+void BasicGraphicsScene::recycleGraphicsObject(UniqueNodeGraphicsObject object)
+{
+    if (!object || _nodeObjectPool.size() >= _graphicsObjectPoolCapacity)
+        return;
+
+    object->recycle();
+    _nodeObjectPool.push_back(std::move(object));
+}
+
+void BasicGraphicsScene::recycleGraphicsObject(UniqueConnectionGraphicsObject object)
+{
+    if (!object || _connectionObjectPool.size() >= _graphicsObjectPoolCapacity)
+        return;
+
+    object->recycle();
+    _connectionObjectPool.push_back(std::move(object));
+}
+
+ConnectionGraphicsObject &BasicGraphicsScene::createConnectionGraphicsObject(
+    ConnectionId const connectionId)
+{
+    // Создаем объект соединения
+    auto connectionObject = makeConnectionGraphicsObject(connectionId);
+
+    // Устанавливаем обработчик двойного клика; адрес читается при клике,
+    // соединение могло быть перенумеровано
+    ConnectionGraphicsObject *object = connectionObject.get();
+    connect(object, &ConnectionGraphicsObject::doubleClicked, this, [this, object]() {
+        openDialog(object->connectionId());
+    });
+
+    // Объекты соединений пересоздаются при виртуализации, шаблон хранится в сцене
+    auto templateIt = _connectionTemplates.find(connectionId);
+    if (templateIt != _connectionTemplates.end()) {
+        connectionObject->setConnectionColor(getColorForHeader(templateIt->second));
+        connectionObject->setLabel(templateIt->second);
+    }
+
+    updateSpatialIndex(*connectionObject);
+
+    auto &cgo = _connectionGraphicsObjects[connectionId];
+    cgo = std::move(connectionObject);
+
+    return *cgo;
+}
+
+NodeGraphicsObject *BasicGraphicsScene::nodeAt(QPointF const &scenePoint,
+                                               QTransform const &viewTransform)
+{
+    if (_spatialIndexMode != SpatialIndexMode::UniformGrid) {
+        // Bounding rectangles only: the exact shapes of the connections
+        // under the point are stroked paths and would be thrown away anyway.
+        QList<QGraphicsItem *> const candidates = items(scenePoint,
+                                                        Qt::IntersectsItemBoundingRect,
+                                                        Qt::DescendingOrder,
+                                                        viewTransform);
+
+        for (QGraphicsItem *item : candidates) {
+            auto ngo = qgraphicsitem_cast<NodeGraphicsObject *>(item);
+
+            if (ngo && ngo->shape().contains(ngo->mapFromScene(scenePoint)))
+                return ngo;
+        }
+
+        return nullptr;
+    }
+
+    NodeGraphicsObject *result = nullptr;
+
+    _nodeIndex.query(scenePoint, [&](NodeId const nodeId, QRectF const &) {
+        NodeGraphicsObject *ngo = nodeGraphicsObject(nodeId);
+
+        if (!ngo || !ngo->isVisible())
+            return;
+
+        if (!ngo->shape().contains(ngo->mapFromScene(scenePoint)))
+            return;
+
+        if (!result || ngo->zValue() > result->zValue())
+            result = ngo;
+    });
+
+    return result;
+}
+
+std::vector<NodeGraphicsObject *> BasicGraphicsScene::nodesInRect(QRectF const &sceneRect)
+{
+    std::vector<NodeGraphicsObject *> result;
+
+    if (_spatialIndexMode != SpatialIndexMode::UniformGrid) {
+        for (QGraphicsItem *item : items(sceneRect, Qt::IntersectsItemBoundingRect)) {
+            if (auto ngo = qgraphicsitem_cast<NodeGraphicsObject *>(item))
+                result.push_back(ngo);
+        }
+
+        return result;
+    }
+
+    _nodeIndex.query(sceneRect, [&](NodeId const nodeId, QRectF const &) {
+        if (auto ngo = nodeGraphicsObject(nodeId))
+            result.push_back(ngo);
+    });
+
+    return result;
+}
+
+void BasicGraphicsScene::raiseNode(NodeId const nodeId)
+{
+    if (_raisedNode != nodeId)
+        lowerNode(_raisedNode);
+
+    _raisedNode = nodeId;
+
+    if (auto ngo = nodeGraphicsObject(nodeId))
+        ngo->setZValue(1.0);
+}
+
+void BasicGraphicsScene::lowerNode(NodeId const nodeId)
+{
+    if (nodeId == InvalidNodeId || nodeId != _raisedNode)
+        return;
+
+    _raisedNode = InvalidNodeId;
+
+    if (auto ngo = nodeGraphicsObject(nodeId))
+        ngo->setZValue(0.0);
+}
+
+std::vector<ConnectionGraphicsObject *> BasicGraphicsScene::connectionsInRect(
+    QRectF const &sceneRect)
+{
+    std::vector<ConnectionGraphicsObject *> result;
+
+    if (_spatialIndexMode != SpatialIndexMode::UniformGrid) {
+        for (QGraphicsItem *item : items(sceneRect, Qt::IntersectsItemBoundingRect)) {
+            if (auto cgo = qgraphicsitem_cast<ConnectionGraphicsObject *>(item))
+                result.push_back(cgo);
+        }
+
+        return result;
+    }
+
+    _connectionIndex.query(sceneRect, [&](ConnectionId const &connectionId, QRectF const &) {
+        if (auto cgo = connectionGraphicsObject(connectionId))
+            result.push_back(cgo);
+    });
+
+    return result;
+}
+
+void BasicGraphicsScene::updateSpatialIndex(NodeGraphicsObject const &ngo)
+{
+    updateContentBounds(ngo.nodeId(), ngo.sceneBoundingRect());
+
+    if (_spatialIndexMode != SpatialIndexMode::UniformGrid)
+        return;
+
+    _nodeIndex.insert(ngo.nodeId(), ngo.sceneBoundingRect());
+}
+
+void BasicGraphicsScene::updateContentBounds(NodeId const nodeId, QRectF const &rect)
+{
+    _contentBounds.insert(nodeId, rect);
+
+    QRectF const bounds = _contentBounds.bounds();
+
+    if (_contentSceneRect.contains(bounds))
+        return;
+
+    // Grows in whole cells, so dragging a node outwards seldom lands here.
+    _contentSceneRect |= bounds;
+
+    setSceneRect(_contentSceneRect);
+}
+
+void BasicGraphicsScene::fitSceneRectToContent()
+{
+    _contentSceneRect = _contentBounds.bounds();
+
+    setSceneRect(_contentSceneRect);
+}
+
+void BasicGraphicsScene::updateSpatialIndex(ConnectionGraphicsObject const &cgo)
+{
+    ConnectionId const connectionId = cgo.connectionId();
+
+    // Draft connections are never looked up through the indices.
+    if (connectionId.inNodeId == InvalidNodeId || connectionId.outNodeId == InvalidNodeId)
+        return;
+
+    if (_connectionPicker)
+        updateConnectionPicker(cgo);
+
+    if (_spatialIndexMode != SpatialIndexMode::UniformGrid)
+        return;
+
+    _connectionIndex.insert(connectionId, cgo.sceneBoundingRect());
+}
+
+void BasicGraphicsScene::updateConnectionPicker(ConnectionGraphicsObject const &cgo)
+{
+    if (cgo.routed()) {
+        _connectionPicker->remove(cgo.connectionId());
+        return;
+    }
+
+    QTransform const toScene = cgo.sceneTransform();
+
+    auto const c1c2 = cgo.pointsC1C2();
+
+    _connectionPicker->insert(cgo.connectionId(),
+                              toScene.map(cgo.out()),
+                              toScene.map(c1c2.first),
+                              toScene.map(c1c2.second),
+                              toScene.map(cgo.in()));
+}
+
+void BasicGraphicsScene::rebuildSpatialIndex()
+{
+    _nodeIndex.clear();
+    _connectionIndex.clear();
+
+    if (_spatialIndexMode != SpatialIndexMode::UniformGrid)
+        return;
+
+    for (auto const &entry : _nodeGraphicsObjects) {
+        updateSpatialIndex(*entry.second);
+    }
+
+    for (auto const &entry : _connectionGraphicsObjects) {
+        updateSpatialIndex(*entry.second);
+    }
+}
+
+QMenu *BasicGraphicsScene::createSceneMenu(QPointF const scenePos)
+{
+    Q_UNUSED(scenePos);
+    return nullptr;
+}
+
+void BasicGraphicsScene::traverseGraphAndPopulateGraphicsObjects()
+{
+    if (_virtualized) {
+        _graphModel.forEachNodeGeometry(
+            [this](NodeId const nodeId, QPointF const &pos, QSize const &size) {
+                QRectF const rect = modelNodeRect(pos, size);
+
+                _modelNodeIndex.insert(nodeId, rect);
+                updateContentBounds(nodeId, rect);
+            });
+
+        updateVirtualizedItems();
+        return;
+    }
+
+    auto allNodeIds = _graphModel.allNodeIds();
+
+    // Items are added with the BSP index suspended; restoring the index
+    // method builds the tree once for the whole scene.
+    QGraphicsScene::ItemIndexMethod const indexMethod = itemIndexMethod();
+    setItemIndexMethod(QGraphicsScene::NoIndex);
+
+    // First create all the nodes.
+    _nodeGraphicsObjects.reserve(allNodeIds.size());
+
+    for (NodeId const nodeId : allNodeIds) {
+        auto &ngo = _nodeGraphicsObjects[nodeId];
+        ngo = makeNodeGraphicsObject(nodeId);
+
+        updateContentBounds(nodeId, ngo->sceneBoundingRect());
+    }
+
+    // Then all the connections, in a single pass over the model.
+    _graphModel.forEachGraphConnection([this](ConnectionId const &cid) {
+        _connectionGraphicsObjects[cid] = makeConnectionGraphicsObject(cid);
+    });
+
+    setItemIndexMethod(indexMethod);
+
+    rebuildSpatialIndex();
+}
+
+void BasicGraphicsScene::updateAttachedNodes(ConnectionId const connectionId,
+                                             PortType const portType)
+{
+    auto node = nodeGraphicsObject(getNodeId(portType, connectionId));
+
+    if (node) {
+        node->nodeState().updateConnectionCount(portType, getPortIndex(portType, connectionId));
+
+        node->invalidateRenderCache();
+        node->update();
+    }
+}
+
+void BasicGraphicsScene::removeDialog(ConnectionId const connectionId) {
+    _connectionTemplates.erase(connectionId);
+
+    // Закрываем диалог, если он открыт для этого соединения
+    if (_templatePicker && _templatePicker->isVisible()
+        && _templatePickerConnection == connectionId) {
+        _templatePicker->reject();
+    }
+}
+
+void BasicGraphicsScene::setConnectionTemplate(ConnectionId const connectionId,
+                                               QString const &templateName)
+{
+    _connectionTemplates[connectionId] = templateName;
+
+    // Получаем цвет для выбранного заголовка
+    QColor selectedColor = getColorForHeader(templateName);
+
+    // Устанавливаем цвет соединения
+    if (auto connectionObject = connectionGraphicsObject(connectionId)) {
+        connectionObject->setConnectionColor(selectedColor); // Устанавливаем цвет
+        connectionObject->update(); // Обновляем отображение
+    }
+
+    addTextUnderConnection(connectionId, templateName);
+
+    Q_EMIT modified(this);
+}
+
+void BasicGraphicsScene::setConnectionTemplates(
+    std::unordered_set<ConnectionId> const &connectionIds, QString const &templateName)
+{
+    if (connectionIds.empty())
+        return;
+
+    QColor const color = getColorForHeader(templateName);
+
+    QRectF dirty;
+
+    for (ConnectionId const &connectionId : connectionIds) {
+        _connectionTemplates[connectionId] = templateName;
+
+        // Connections without an object get theirs in createConnectionGraphicsObject().
+        auto connectionObject = connectionGraphicsObject(connectionId);
+
+        if (!connectionObject)
+            continue;
+
+        dirty |= connectionObject->sceneBoundingRect();
+
+        connectionObject->setConnectionColor(color);
+        connectionObject->setLabel(templateName);
+
+        dirty |= connectionObject->sceneBoundingRect();
+    }
+
+    if (!dirty.isEmpty())
+        update(dirty);
+
+    Q_EMIT modified(this);
+}
+
+std::unordered_set<ConnectionId> BasicGraphicsScene::selectedConnections() const
+{
+    return _selectedConnectionIds;
+}
+
+void BasicGraphicsScene::updateNodeSelection(NodeId const nodeId, bool const selected)
+{
+    if (selected)
+        _selectedNodeIds.insert(nodeId);
+    else
+        _selectedNodeIds.erase(nodeId);
+}
+
+void BasicGraphicsScene::updateConnectionSelection(ConnectionId const connectionId,
+                                                   bool const selected)
+{
+    if (selected)
+        _selectedConnectionIds.insert(connectionId);
+    else
+        _selectedConnectionIds.erase(connectionId);
+}
+
+void BasicGraphicsScene::addTextUnderConnection(ConnectionId connectionId, const QString& templateText) {
+    // Подпись рисует сам объект соединения, под его входным концом
+    if (auto connectionObject = connectionGraphicsObject(connectionId))
+        connectionObject->setLabel(templateText);
+}
+
+void BasicGraphicsScene::onConnectionDeleted(ConnectionId const connectionId)
+{
+    _draftCompatibility.clear();
+
+    if (_graphModel.batchInProgress())
+        return;
+
+    auto it = _connectionGraphicsObjects.find(connectionId);
+    if (it != _connectionGraphicsObjects.end()) {
+        recycleGraphicsObject(std::move(it->second));
+        _connectionGraphicsObjects.erase(it);
+    }
+
+    _connectionIndex.remove(connectionId);
+
+    if (_connectionPicker)
+        _connectionPicker->remove(connectionId);
+
+    // TODO: do we need it?
+    if (_draftConnection && _draftConnection->connectionId() == connectionId) {
+        clearDraftOverlay();
+        _draftConnection.reset();
+    }
+
+    updateAttachedNodes(connectionId, PortType::Out);
+    updateAttachedNodes(connectionId, PortType::In);
+
+    // Удаляем диалоговое окно, если оно существует
+    removeDialog(connectionId);
+
+    if (!_applyingBatch)
+        Q_EMIT modified(this);
+}
+
+void BasicGraphicsScene::onConnectionCreated(ConnectionId const connectionId)
+{
+    _draftCompatibility.clear();
+
+    if (_graphModel.batchInProgress())
+        return;
+
+    // A virtualized scene shows connections of the nodes it shows.
+    if (_virtualized && !nodeGraphicsObject(connectionId.outNodeId)
+        && !nodeGraphicsObject(connectionId.inNodeId))
+        return;
+
+    createConnectionGraphicsObject(connectionId);
+
+    updateAttachedNodes(connectionId, PortType::Out);
+    updateAttachedNodes(connectionId, PortType::In);
+}
+
+void BasicGraphicsScene::onConnectionsRemapped(ConnectionRemap const &remap)
+{
+    _draftCompatibility.clear();
+
+    // The change set of the batch has them as deletions and creations.
+    if (_graphModel.batchInProgress())
+        return;
+
+    std::vector<UniqueConnectionGraphicsObject> objects(remap.size());
+    std::vector<std::pair<bool, QString>> templates(remap.size());
+    std::vector<bool> selected(remap.size());
+
+    // Everything is taken out first, a new address may still be an old one.
+    for (std::size_t i = 0; i < remap.size(); ++i) {
+        ConnectionId const &from = remap[i].first;
+
+        auto it = _connectionGraphicsObjects.find(from);
+        if (it != _connectionGraphicsObjects.end()) {
+            objects[i] = std::move(it->second);
+            _connectionGraphicsObjects.erase(it);
+        }
+
+        _connectionIndex.remove(from);
+
+        if (_connectionPicker)
+            _connectionPicker->remove(from);
+
+        auto templateIt = _connectionTemplates.find(from);
+        if (templateIt != _connectionTemplates.end()) {
+            templates[i] = {true, templateIt->second};
+            _connectionTemplates.erase(templateIt);
+        }
+
+        selected[i] = _selectedConnectionIds.erase(from) > 0;
+    }
+
+    for (std::size_t i = 0; i < remap.size(); ++i) {
+        ConnectionId const &from = remap[i].first;
+        ConnectionId const &to = remap[i].second;
+
+        if (templates[i].first)
+            _connectionTemplates[to] = templates[i].second;
+
+        if (_templatePickerConnection == from)
+            _templatePickerConnection = to;
+
+        if (selected[i])
+            _selectedConnectionIds.insert(to);
+
+        if (objects[i]) {
+            objects[i]->setConnectionId(to);
+            _connectionGraphicsObjects[to] = std::move(objects[i]);
+        }
+
+        // The ports left behind lost a connection.
+        updateAttachedNodes(from, PortType::Out);
+        updateAttachedNodes(from, PortType::In);
+
+        updateAttachedNodes(to, PortType::Out);
+        updateAttachedNodes(to, PortType::In);
+    }
+
+    if (!_applyingBatch)
+        Q_EMIT modified(this);
+}
+
+void BasicGraphicsScene::openDialog(ConnectionId const connectionId)
+{
+    if (!_templatePicker) {
+        _templatePicker = std::make_unique<TemplatePicker>(_templateHeaders);
+
+        // Подключаем сигнал принятия к обработке выбора
+        connect(_templatePicker.get(), &QDialog::accepted, this, [this]() {
+            QString const selectedTemplate = _templatePicker->selectedTemplate();
+
+            if (!selectedTemplate.isEmpty()
+                && _graphModel.connectionExists(_templatePickerConnection))
+                setConnectionTemplate(_templatePickerConnection, selectedTemplate);
+        });
+    }
+
+    _templatePickerConnection = connectionId;
+
+    auto it = _connectionTemplates.find(connectionId);
+
+    _templatePicker->reset(it != _connectionTemplates.end() ? it->second : QString());
+
+    // Показываем диалоговое окно для данного соединения
+    _templatePicker->show();
+    _templatePicker->raise();
+}
+
+void BasicGraphicsScene::onNodeDeleted(NodeId const nodeId)
+{
+    nodeGeometry().invalidateLayout(nodeId);
+
+    _draftCompatibility.clear();
+
+    if (_graphModel.batchInProgress())
+        return;
+
+    _deferredNodeUpdates.erase(nodeId);
+
+    _modelNodeIndex.remove(nodeId);
+    _contentBounds.remove(nodeId);
+
+    auto it = _nodeGraphicsObjects.find(nodeId);
+    if (it != _nodeGraphicsObjects.end()) {
+        recycleGraphicsObject(std::move(it->second));
+        _nodeGraphicsObjects.erase(it);
+
+        _nodeIndex.remove(nodeId);
+
+        if (!_applyingBatch)
+            Q_EMIT modified(this);
+    } else if (_virtualized && !_applyingBatch) {
+        Q_EMIT modified(this);
+    }
+}
+
+void BasicGraphicsScene::onNodeCreated(NodeId const nodeId)
+{
+    if (_graphModel.batchInProgress())
+        return;
+
+    if (_virtualized) {
+        QRectF const rect = modelNodeRect(nodeId);
+
+        _modelNodeIndex.insert(nodeId, rect);
+        updateContentBounds(nodeId, rect);
+
+        qreal const dx = _visibleSceneRect.width() / 2.0;
+        qreal const dy = _visibleSceneRect.height() / 2.0;
+
+        if (_aggregated || !_visibleSceneRect.adjusted(-dx, -dy, dx, dy).intersects(rect)) {
+            if (!_applyingBatch)
+                Q_EMIT modified(this);
+            return;
+        }
+    }
+
+    createNodeGraphicsObject(nodeId);
+
+    if (!_applyingBatch)
+        Q_EMIT modified(this);
+}
+
+void BasicGraphicsScene::onNodePositionUpdated(NodeId const nodeId)
+{
+    if (_graphModel.batchInProgress())
+        return;
+
+    auto node = nodeGraphicsObject(nodeId);
+    if (node) {
+        node->setPos(_graphModel.nodeData(nodeId, NodeRole::Position).value<QPointF>());
+        node->update();
+        _nodeDrag = true;
+    }
+
+    // Locked nodes do not report their scene position changes.
+    QRectF const rect = node ? node->sceneBoundingRect() : modelNodeRect(nodeId);
+
+    updateContentBounds(nodeId, rect);
+
+    if (_virtualized)
+        _modelNodeIndex.insert(nodeId, rect);
+}
+
+void BasicGraphicsScene::onNodePositionsUpdated(std::vector<NodeId> const &nodeIds)
+{
+    if (_graphModel.batchInProgress())
+        return;
+
+    _batchMovedConnections.clear();
+
+    _batchMoveInProgress = true;
+
+    std::vector<QPointF> positions;
+    _graphModel.nodePositions(nodeIds, positions);
+
+    for (std::size_t i = 0; i < nodeIds.size(); ++i) {
+        NodeId const nodeId = nodeIds[i];
+
+        auto node = nodeGraphicsObject(nodeId);
+
+        if (!node) {
+            QRectF const rect = modelNodeRect(nodeId);
+
+            updateContentBounds(nodeId, rect);
+
+            if (_virtualized)
+                _modelNodeIndex.insert(nodeId, rect);
+
+            continue;
+        }
+
+        node->setPos(positions[i]);
+        node->update();
+
+        updateContentBounds(nodeId, node->sceneBoundingRect());
+
+        if (_virtualized)
+            _modelNodeIndex.insert(nodeId, node->sceneBoundingRect());
+
+        _graphModel.forEachNodeConnection(nodeId, [this](ConnectionId const &cid) {
+            _batchMovedConnections.insert(cid);
+        });
+    }
+
+    _batchMoveInProgress = false;
+
+    for (auto const &cid : _batchMovedConnections) {
+        if (auto cgo = connectionGraphicsObject(cid))
+            cgo->move();
+    }
+
+    _nodeDrag = true;
+}
+
+void BasicGraphicsScene::onNodeUpdated(NodeId const nodeId)
+{
+    // Also for nodes without a graphics object, their layout would be stale.
+    nodeGeometry().invalidateLayout(nodeId);
+
+    _draftCompatibility.clear();
+
+    if (_graphModel.batchInProgress()) {
+        _deferredNodeUpdates.insert(nodeId);
+        return;
+    }
+
+    if (_nodeUpdatePolicy != NodeUpdatePolicy::Immediate) {
+        _deferredNodeUpdates.insert(nodeId);
+        scheduleNodeUpdates();
+        return;
+    }
+
+    applyNodeUpdate(nodeId);
+}
+
+void BasicGraphicsScene::applyNodeUpdate(NodeId const nodeId)
+{
+    auto node = nodeGraphicsObject(nodeId);
+
+    if (node) {
+        node->updateNodeStyle();
+
+        // Ports may have been inserted or removed.
+        node->nodeState().updateConnectionCounts();
+
+        node->setGeometryChanged();
+
+        nodeGeometry().recomputeSize(nodeId);
+
+        updateSpatialIndex(*node);
+
+        if (_virtualized)
+            _modelNodeIndex.insert(nodeId, node->sceneBoundingRect());
+
+        node->updateQWidgetEmbedPos();
+        node->update();
+        node->moveConnections();
+    }
+}
+
+void BasicGraphicsScene::onNodeDataChanged(NodeId const nodeId)
+{
+    if (auto node = nodeGraphicsObject(nodeId)) {
+        node->invalidateRenderCache();
+        node->update();
+    }
+}
+
+void BasicGraphicsScene::onNodeFlagsUpdated(NodeId const nodeId)
+{
+    // Objects created later read the flags themselves.
+    if (auto node = nodeGraphicsObject(nodeId))
+        node->setLockedState();
+}
+
+void BasicGraphicsScene::setNodeUpdatePolicy(NodeUpdatePolicy const policy)
+{
+    if (_nodeUpdatePolicy == policy)
+        return;
+
+    _nodeUpdatePolicy = policy;
+
+    if (_nodeUpdatePolicy == NodeUpdatePolicy::Immediate)
+        processPendingNodeUpdates();
+}
+
+void BasicGraphicsScene::scheduleNodeUpdates()
+{
+    if (_nodeUpdatesScheduled)
+        return;
+
+    _nodeUpdatesScheduled = true;
+
+    int const interval = _nodeUpdatePolicy == NodeUpdatePolicy::Frame ? NodeUpdateFrameInterval
+                                                                       : 0;
+
+    QTimer::singleShot(interval, this, [this]() { processPendingNodeUpdates(); });
+}
+
+void BasicGraphicsScene::processPendingNodeUpdates()
+{
+    _nodeUpdatesScheduled = false;
+
+    // The closing batch applies them together with its own changes.
+    if (_graphModel.batchInProgress())
+        return;
+
+    std::unordered_set<NodeId> const updated = std::move(_deferredNodeUpdates);
+    _deferredNodeUpdates.clear();
+
+    for (NodeId const nodeId : updated) {
+        applyNodeUpdate(nodeId);
+    }
+}
+
+void BasicGraphicsScene::onNodeClicked(NodeId const nodeId)
+{
+    if (_nodeDrag) {
+        Q_EMIT nodeMoved(nodeId, _graphModel.nodeData(nodeId, NodeRole::Position).value<QPointF>());
+        Q_EMIT modified(this);
+    }
+    _nodeDrag = false;
+}
+
+void BasicGraphicsScene::onModelReset()
+{
+    nodeGeometry().invalidateLayouts();
+
+    if (_graphModel.batchInProgress())
+        return;
+
+    _deferredNodeUpdates.clear();
+
+    // Connections first, they report to the nodes and the batch layer.
+    for (auto &entry : _connectionGraphicsObjects) {
+        recycleGraphicsObject(std::move(entry.second));
+    }
+
+    for (auto &entry : _nodeGraphicsObjects) {
+        recycleGraphicsObject(std::move(entry.second));
+    }
+
+    _connectionGraphicsObjects.clear();
+    _nodeGraphicsObjects.clear();
+    _modelNodeIndex.clear();
+    _contentBounds.clear();
+    _contentSceneRect = QRectF();
+
+    clear();
+
+    traverseGraphAndPopulateGraphicsObjects();
+}
+
+void BasicGraphicsScene::onBatchFinished(GraphChangeSet const &changes)
+{
+    if (changes.reset) {
+        onModelReset();
+
+        Q_EMIT modified(this);
+        return;
+    }
+
+    if (changes.empty() && _deferredNodeUpdates.empty())
+        return;
+
+    _applyingBatch = true;
+
+    for (auto const &connectionId : changes.deletedConnections) {
+        onConnectionDeleted(connectionId);
+    }
+
+    for (NodeId const nodeId : changes.deletedNodes) {
+        onNodeDeleted(nodeId);
+    }
+
+    for (NodeId const nodeId : changes.createdNodes) {
+        if (_graphModel.nodeExists(nodeId))
+            onNodeCreated(nodeId);
+    }
+
+    for (auto const &connectionId : changes.createdConnections) {
+        if (_graphModel.connectionExists(connectionId))
+            onConnectionCreated(connectionId);
+    }
+
+    if (!changes.movedNodes.empty()) {
+        onNodePositionsUpdated(
+            std::vector<NodeId>(changes.movedNodes.begin(), changes.movedNodes.end()));
+    }
+
+    std::unordered_set<NodeId> updated = std::move(_deferredNodeUpdates);
+    _deferredNodeUpdates.clear();
+
+    updated.insert(changes.updatedNodes.begin(), changes.updatedNodes.end());
+
+    for (NodeId const nodeId : updated) {
+        applyNodeUpdate(nodeId);
+    }
+
+    _applyingBatch = false;
+
+    Q_EMIT modified(this);
 }
 
 } // namespace QtNodes
@@ -0,0 +1,131 @@
+#include "BatchEvaluator.hpp"
+
+#include "DataFlowGraphModel.hpp"
+#include "NodeDelegateModelRegistry.hpp"
+
+#include <QtCore/QVariant>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace QtNodes {
+
+BatchEvaluator::BatchEvaluator(std::shared_ptr<NodeDelegateModelRegistry> registry,
+                               QJsonObject scene)
+    : _registry(std::move(registry))
+    , _scene(std::move(scene))
+    , _threadCount(0)
+{}
+
+std::vector<BatchEvaluator::Values> BatchEvaluator::run(std::vector<Values> const &inputSets) const
+{
+    std::vector<Values> results(inputSets.size());
+
+    if (inputSets.empty())
+        return results;
+
+    unsigned int threadCount = _threadCount;
+
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    threadCount = static_cast<unsigned int>(
+        std::min<std::size_t>(threadCount, inputSets.size()));
+
+    std::atomic<std::size_t> nextSet(0);
+    std::atomic<bool> failed(false);
+
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    auto worker = [&]() {
+        try {
+            DataFlowGraphModel model(_registry);
+            model.load(_scene);
+
+            for (;;) {
+                std::size_t const index = nextSet++;
+
+                if (index >= inputSets.size() || failed.load())
+                    return;
+
+                applyInputs(model, _inputPorts, inputSets[index]);
+
+                model.processPendingPropagation();
+
+                results[index] = readOutputs(model, _outputPorts);
+            }
+        } catch (...) {
+            failed = true;
+
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error)
+                error = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+
+    return results;
+}
+
+void BatchEvaluator::applyInputs(DataFlowGraphModel &model,
+                                 std::vector<Port> const &ports,
+                                 Values const &inputs)
+{
+    std::size_t const n = std::min(inputs.size(), ports.size());
+
+    for (std::size_t i = 0; i < n; ++i) {
+        Port const &port = ports[i];
+
+        if (port.portType == PortType::Out)
+            model.setOutPortData(port.nodeId, port.portIndex, inputs[i]);
+        else
+            model.setPortData(port.nodeId,
+                              PortType::In,
+                              port.portIndex,
+                              QVariant::fromValue(inputs[i]));
+    }
+}
+
+BatchEvaluator::Values BatchEvaluator::readOutputs(DataFlowGraphModel const &model,
+                                                   std::vector<Port> const &ports)
+{
+    Values outputs;
+    outputs.reserve(ports.size());
+
+    for (Port const &port : ports) {
+        if (port.portType == PortType::Out) {
+            outputs.push_back(model.outPortData(port.nodeId, port.portIndex));
+            continue;
+        }
+
+        auto const connected = model.connections(port.nodeId, PortType::In, port.portIndex);
+
+        if (connected.empty()) {
+            outputs.push_back(nullptr);
+        } else {
+            ConnectionId const &connectionId = *connected.begin();
+            outputs.push_back(model.outPortData(connectionId.outNodeId, connectionId.outPortIndex));
+        }
+    }
+
+    return outputs;
+}
+
+} // namespace QtNodes
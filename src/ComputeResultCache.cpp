@@ -0,0 +1,110 @@
+#include "ComputeResultCache.hpp"
+
+#include "MemoryReport.hpp"
+
+#include <functional>
+
+namespace QtNodes {
+
+constexpr std::size_t ComputeResultCache::EmptyInputHash;
+
+ComputeResultCache::ComputeResultCache(std::size_t capacity)
+    : _capacity(capacity)
+{}
+
+void ComputeResultCache::setCapacity(std::size_t const capacity)
+{
+    _capacity = capacity;
+
+    evict();
+}
+
+ComputeResultCache::Results const *ComputeResultCache::find(NodeId const nodeId,
+                                                           InputHashes const &inputHashes)
+{
+    auto it = _index.find(keyOf(nodeId, inputHashes));
+
+    if (it == _index.end())
+        return nullptr;
+
+    Entry const &entry = *it->second;
+
+    // A different state hashing to the same key.
+    if (entry.nodeId != nodeId || entry.inputHashes != inputHashes)
+        return nullptr;
+
+    _entries.splice(_entries.begin(), _entries, it->second);
+
+    return &_entries.front().results;
+}
+
+void ComputeResultCache::insert(NodeId const nodeId, InputHashes inputHashes, Results results)
+{
+    if (_capacity == 0)
+        return;
+
+    std::size_t const key = keyOf(nodeId, inputHashes);
+
+    auto it = _index.find(key);
+
+    if (it != _index.end())
+        _entries.erase(it->second);
+
+    _entries.push_front(Entry{nodeId, std::move(inputHashes), std::move(results)});
+    _index[key] = _entries.begin();
+
+    evict();
+}
+
+void ComputeResultCache::removeNode(NodeId const nodeId)
+{
+    for (auto it = _entries.begin(); it != _entries.end();) {
+        if (it->nodeId == nodeId) {
+            _index.erase(keyOf(it->nodeId, it->inputHashes));
+            it = _entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+std::size_t ComputeResultCache::memoryUsage() const
+{
+    std::size_t usage = MemoryReport::hashBytes(_index);
+
+    for (Entry const &entry : _entries) {
+        usage += sizeof(Entry) + 2 * sizeof(void *) + MemoryReport::vectorBytes(entry.inputHashes)
+                 + MemoryReport::vectorBytes(entry.results);
+    }
+
+    return usage;
+}
+
+void ComputeResultCache::clear()
+{
+    _entries.clear();
+    _index.clear();
+}
+
+std::size_t ComputeResultCache::keyOf(NodeId const nodeId, InputHashes const &inputHashes)
+{
+    std::size_t key = std::hash<NodeId>()(nodeId);
+
+    for (std::size_t const hash : inputHashes) {
+        key ^= hash + 0x9e3779b9 + (key << 6) + (key >> 2);
+    }
+
+    return key;
+}
+
+void ComputeResultCache::evict()
+{
+    while (_entries.size() > _capacity) {
+        Entry const &oldest = _entries.back();
+
+        _index.erase(keyOf(oldest.nodeId, oldest.inputHashes));
+        _entries.pop_back();
+    }
+}
+
+} // namespace QtNodes
@@ -0,0 +1,239 @@
+#include "ConnectionBatchLayer.hpp"
+
+#include <QtGui/QPainter>
+#include <QtWidgets/QStyleOptionGraphicsItem>
+
+#include "AbstractGraphModel.hpp"
+#include "BasicGraphicsScene.hpp"
+#include "ConnectionGraphicsObject.hpp"
+#include "ConnectionState.hpp"
+#include "PaintStatistics.hpp"
+#include "StyleCollection.hpp"
+
+namespace QtNodes {
+
+namespace {
+
+/// Connections between different data types get two colors and an icon.
+bool converts(ConnectionGraphicsObject const &cgo)
+{
+    if (!cgo.nodeScene()->styleContext().connectionStyle().useDataDefinedColors())
+        return false;
+
+    AbstractGraphModel const &graphModel = cgo.graphModel();
+
+    ConnectionId const cId = cgo.connectionId();
+
+    return graphModel.portDataTypeId(cId.outNodeId, PortType::Out, cId.outPortIndex)
+           != graphModel.portDataTypeId(cId.inNodeId, PortType::In, cId.inPortIndex);
+}
+
+/// Connections the layer keeps an entry for, whatever their state.
+bool stored(ConnectionGraphicsObject const &cgo)
+{
+    return !cgo.connectionState().requiresPort() && !converts(cgo);
+}
+
+} // namespace
+
+constexpr int ConnectionBatchLayer::CubicSegments;
+
+ConnectionBatchLayer::ConnectionBatchLayer(BasicGraphicsScene &scene)
+    : _scene(scene)
+    , _styleRevision(scene.styleContext().revision())
+{
+    setAcceptedMouseButtons(Qt::NoButton);
+    setAcceptHoverEvents(false);
+
+    // Below the connection items, which paint over it when hovered or selected.
+    setZValue(-1.5);
+
+    scene.addItem(this);
+}
+
+bool ConnectionBatchLayer::batchable(ConnectionGraphicsObject const &cgo)
+{
+    // The hover overlay of the scene draws over batched connections.
+    bool const hovered = cgo.connectionState().hovered() && !cgo.nodeScene()->hoverOverlay();
+
+    return !cgo.isSelected() && !hovered && cgo.label().isEmpty() && stored(cgo);
+}
+
+void ConnectionBatchLayer::markDirty(ConnectionId const connectionId,
+                                     ConnectionGraphicsObject const *cgo)
+{
+    _dirty.insert(connectionId);
+
+    QRectF area;
+
+    auto it = _entries.find(connectionId);
+
+    if (it != _entries.end())
+        area = it->second.bounds;
+
+    if (cgo) {
+        QRectF const bounds = cgo->sceneBoundingRect();
+
+        // Grows only; a stale larger rectangle just costs some culling.
+        if (!_bounds.contains(bounds)) {
+            prepareGeometryChange();
+            _bounds |= bounds;
+        }
+
+        area |= bounds;
+    }
+
+    update(area);
+}
+
+void ConnectionBatchLayer::markAllDirty()
+{
+    for (auto const &entry : _entries) {
+        _dirty.insert(entry.first);
+    }
+
+    update();
+}
+
+QRectF ConnectionBatchLayer::boundingRect() const
+{
+    return _bounds;
+}
+
+QPainterPath ConnectionBatchLayer::shape() const
+{
+    return QPainterPath();
+}
+
+void ConnectionBatchLayer::paint(QPainter *painter, QStyleOptionGraphicsItem const *, QWidget *)
+{
+    PaintStatistics::Scope scope(PaintStatistics::ConnectionPaint);
+
+    rebuild();
+
+    auto const &connectionStyle = _scene.styleContext().connectionStyle();
+
+    qreal const lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+        painter->worldTransform());
+
+    bool const straight = lod < connectionStyle.straightLevelOfDetail();
+
+    QPen pen;
+    pen.setWidth(static_cast<int>(connectionStyle.lineWidth()));
+
+    painter->setBrush(Qt::NoBrush);
+
+    for (auto const &batch : _batches) {
+        pen.setColor(QColor::fromRgba(batch.first));
+        painter->setPen(pen);
+
+        painter->drawLines(straight ? batch.second.straight : batch.second.segments);
+    }
+}
+
+void ConnectionBatchLayer::rebuild()
+{
+    unsigned int const revision = _scene.styleContext().revision();
+
+    if (_styleRevision != revision) {
+        _styleRevision = revision;
+
+        for (auto const &entry : _entries) {
+            _dirty.insert(entry.first);
+        }
+    }
+
+    if (_dirty.empty())
+        return;
+
+    for (ConnectionId const &connectionId : _dirty) {
+        ConnectionGraphicsObject const *cgo = _scene.connectionGraphicsObject(connectionId);
+
+        if (cgo && stored(*cgo))
+            _entries[connectionId] = tessellate(*cgo);
+        else
+            _entries.erase(connectionId);
+    }
+
+    _dirty.clear();
+
+    // Concatenating is a copy per segment, tessellating is the expensive part.
+    for (auto &batch : _batches) {
+        batch.second.segments.clear();
+        batch.second.straight.clear();
+    }
+
+    for (auto const &entry : _entries) {
+        Batch &batch = _batches[entry.second.color];
+
+        batch.segments += entry.second.segments;
+        batch.straight.push_back(entry.second.straight);
+    }
+
+    for (auto it = _batches.begin(); it != _batches.end();) {
+        if (it->second.straight.isEmpty())
+            it = _batches.erase(it);
+        else
+            ++it;
+    }
+}
+
+ConnectionBatchLayer::Entry ConnectionBatchLayer::tessellate(ConnectionGraphicsObject const &cgo)
+{
+    QTransform const transform = cgo.sceneTransform();
+
+    QPointF const p0 = transform.map(cgo.endPoint(PortType::Out));
+    QPointF const p3 = transform.map(cgo.endPoint(PortType::In));
+
+    auto const c1c2 = cgo.pointsC1C2();
+    QPointF const c1 = transform.map(c1c2.first);
+    QPointF const c2 = transform.map(c1c2.second);
+
+    Entry entry;
+    entry.segments.reserve(CubicSegments);
+    entry.straight = QLineF(p0, p3);
+    entry.bounds = cgo.sceneBoundingRect();
+
+    if (cgo.routed()) {
+        // Routes are polylines already, rounded corners get flattened by Qt.
+        for (QPolygonF const &polygon : cgo.cubicPath().toSubpathPolygons(transform)) {
+            for (int i = 1; i < polygon.size(); ++i) {
+                entry.segments.push_back(QLineF(polygon[i - 1], polygon[i]));
+            }
+        }
+    } else {
+        QPointF previous = p0;
+
+        for (int i = 1; i <= CubicSegments; ++i) {
+            double const t = double(i) / CubicSegments;
+            double const u = 1.0 - t;
+
+            QPointF const point = u * u * u * p0 + 3.0 * u * u * t * c1 + 3.0 * u * t * t * c2
+                                  + t * t * t * p3;
+
+            entry.segments.push_back(QLineF(previous, point));
+            previous = point;
+        }
+    }
+
+    auto const &connectionStyle = _scene.styleContext().connectionStyle();
+
+    QColor color = cgo.getConnectionColor();
+
+    if (!color.isValid()) {
+        if (connectionStyle.useDataDefinedColors()) {
+            ConnectionId const cId = cgo.connectionId();
+
+            color = connectionStyle.normalColor(
+                cgo.graphModel().portDataTypeId(cId.outNodeId, PortType::Out, cId.outPortIndex));
+        } else {
+            color = connectionStyle.normalColor();
+        }
+    }
+
+    entry.color = color.rgba();
+
+    return entry;
+}
+
+} // namespace QtNodes
@@ -4,12 +4,17 @@
 #include "AbstractGraphModel.hpp"
 #include "AbstractNodeGeometry.hpp"
 #include "BasicGraphicsScene.hpp"
+#include "ConnectionBatchLayer.hpp"
 #include "ConnectionIdUtils.hpp"
+#include "ConnectionPicker.hpp"
+#include "ConnectionRouter.hpp"
 #include "ConnectionState.hpp"
 #include "ConnectionStyle.hpp"
 #include "NodeConnectionInteraction.hpp"
 #include "NodeGraphicsObject.hpp"
+#include "PaintStatistics.hpp"
 #include "StyleCollection.hpp"
+#include "TextCache.hpp"
 #include "locateNode.hpp"
 
 #include <QtWidgets/QGraphicsBlurEffect>
@@ -31,6 +36,12 @@ ConnectionGraphicsObject::ConnectionGraphicsObject(BasicGraphicsScene &scene,
     , _connectionState(*this)
     , _out{0, 0}
     , _in{0, 0}
+    , _overlaid(false)
+{
+    initialize(scene);
+}
+
+void ConnectionGraphicsObject::initialize(BasicGraphicsScene &scene)
 {
     scene.addItem(this);
 
@@ -45,6 +56,58 @@ ConnectionGraphicsObject::ConnectionGraphicsObject(BasicGraphicsScene &scene,
     setZValue(-1.0);
 
     initializePosition();
+
+    if (auto layer = scene.connectionBatchLayer())
+        layer->markDirty(_connectionId, this);
+}
+
+ConnectionGraphicsObject::~ConnectionGraphicsObject()
+{
+    if (auto scene = nodeScene()) {
+        if (auto layer = scene->connectionBatchLayer())
+            layer->markDirty(_connectionId, nullptr);
+
+        // Items leaving the scene do not report their deselection.
+        if (isSelected())
+            scene->updateConnectionSelection(_connectionId, false);
+    }
+}
+
+void ConnectionGraphicsObject::recycle()
+{
+    if (auto scene = nodeScene()) {
+        if (auto layer = scene->connectionBatchLayer())
+            layer->markDirty(_connectionId, nullptr);
+
+        if (isSelected())
+            scene->updateConnectionSelection(_connectionId, false);
+
+        scene->removeItem(this);
+    }
+
+    setSelected(false);
+
+    _connectionState.reset();
+
+    _out = QPointF(0, 0);
+    _in = QPointF(0, 0);
+    setPos(0, 0);
+
+    _geometry = GeometryCache();
+
+    connectionColor = QColor();
+    _label.clear();
+
+    disconnect();
+
+    _connectionId = ConnectionId{InvalidNodeId, InvalidPortIndex, InvalidNodeId, InvalidPortIndex};
+}
+
+void ConnectionGraphicsObject::reuse(BasicGraphicsScene &scene, ConnectionId const connectionId)
+{
+    _connectionId = connectionId;
+
+    initialize(scene);
 }
 
 void ConnectionGraphicsObject::initializePosition()
@@ -96,9 +159,70 @@ ConnectionId const &ConnectionGraphicsObject::connectionId() const
     return _connectionId;
 }
 
+void ConnectionGraphicsObject::setConnectionId(ConnectionId const &connectionId)
+{
+    if (auto layer = nodeScene()->connectionBatchLayer())
+        layer->markDirty(_connectionId, nullptr);
+
+    _connectionId = connectionId;
+
+    // Indexes and marks the new address.
+    move();
+}
+
 QRectF ConnectionGraphicsObject::boundingRect() const
 {
-    auto points = pointsC1C2();
+    if (_overlaid)
+        return QRectF();
+
+    updateGeometryCache();
+
+    return _geometry.bounds;
+}
+
+QRectF ConnectionGraphicsObject::paintBounds() const
+{
+    updateGeometryCache();
+
+    return _geometry.bounds;
+}
+
+void ConnectionGraphicsObject::setOverlaid(bool const overlaid)
+{
+    if (_overlaid == overlaid)
+        return;
+
+    prepareGeometryChange();
+
+    _overlaid = overlaid;
+}
+
+void ConnectionGraphicsObject::updateGeometryCache() const
+{
+    if (_geometry.valid)
+        return;
+
+    _geometry.c1c2 = pointsC1C2(_out, _in, nodeScene()->orientation());
+
+    auto const &points = _geometry.c1c2;
+
+    QPainterPath const *route = nullptr;
+
+    if (ConnectionRouter const *router = nodeScene()->connectionRouter()) {
+        QTransform const toScene = sceneTransform();
+
+        route = router->route(_connectionId, toScene.map(_out), toScene.map(_in));
+
+        if (route)
+            _geometry.cubic = toScene.inverted().map(*route);
+    }
+
+    _geometry.routed = route != nullptr;
+
+    if (!route) {
+        _geometry.cubic = QPainterPath(_out);
+        _geometry.cubic.cubicTo(points.first, points.second, _in);
+    }
 
     // `normalized()` fixes inverted rects.
     QRectF basicRect = QRectF(_out, _in).normalized();
@@ -107,7 +231,13 @@ QRectF ConnectionGraphicsObject::boundingRect() const
 
     QRectF commonRect = basicRect.united(c1c2Rect);
 
-    auto const &connectionStyle = StyleCollection::connectionStyle();
+    if (route)
+        commonRect |= _geometry.cubic.controlPointRect();
+
+    BasicGraphicsScene const *scene = nodeScene();
+
+    auto const &connectionStyle = scene ? scene->styleContext().connectionStyle()
+                                        : StyleCollection::connectionStyle();
     float const diam = connectionStyle.pointDiameter();
     QPointF const cornerOffset(diam, diam);
 
@@ -115,7 +245,52 @@ QRectF ConnectionGraphicsObject::boundingRect() const
     commonRect.setTopLeft(commonRect.topLeft() - cornerOffset);
     commonRect.setBottomRight(commonRect.bottomRight() + 2 * cornerOffset);
 
-    return commonRect;
+    _geometry.label = QRectF();
+
+    if (!_label.isEmpty()) {
+        // Where the text items used for labels put their text.
+        QPointF const topLeft = _in + QPointF(-46.0, 5.0);
+
+        TextCache &textCache = TextCache::instance();
+
+        _geometry.label = QRectF(topLeft,
+                                 QSizeF(textCache.horizontalAdvance(labelFont(), _label),
+                                        textCache.height(labelFont())));
+
+        commonRect |= _geometry.label;
+    }
+
+    _geometry.bounds = commonRect;
+    _geometry.strokeValid = false;
+    _geometry.valid = true;
+}
+
+QPainterPath const &ConnectionGraphicsObject::cubicPath() const
+{
+    updateGeometryCache();
+
+    return _geometry.cubic;
+}
+
+bool ConnectionGraphicsObject::routed() const
+{
+    updateGeometryCache();
+
+    return _geometry.routed;
+}
+
+void ConnectionGraphicsObject::updateRoute()
+{
+    prepareGeometryChange();
+
+    _geometry.valid = false;
+
+    update();
+
+    nodeScene()->updateSpatialIndex(*this);
+
+    if (auto layer = nodeScene()->connectionBatchLayer())
+        layer->markDirty(_connectionId, this);
 }
 
 QPainterPath ConnectionGraphicsObject::shape() const
@@ -128,10 +303,34 @@ QPainterPath ConnectionGraphicsObject::shape() const
     //return path;
 
 #else
-    return nodeScene()->connectionPainter().getPainterStroke(*this);
+    PaintStatistics::Scope scope(PaintStatistics::Shape);
+
+    if (_overlaid)
+        return QPainterPath();
+
+    updateGeometryCache();
+
+    if (!_geometry.strokeValid) {
+        _geometry.stroke = nodeScene()->connectionPainter().getPainterStroke(*this);
+        _geometry.strokeValid = true;
+    }
+
+    return _geometry.stroke;
 #endif
 }
 
+bool ConnectionGraphicsObject::contains(QPointF const &point) const
+{
+    BasicGraphicsScene const *scene = nodeScene();
+
+    ConnectionPicker const *picker = scene ? scene->connectionPicker() : nullptr;
+
+    if (picker && picker->contains(_connectionId))
+        return picker->hits(_connectionId, mapToScene(point));
+
+    return QGraphicsObject::contains(point);
+}
+
 QPointF const &ConnectionGraphicsObject::endPoint(PortType portType) const
 {
     Q_ASSERT(portType != PortType::None);
@@ -141,10 +340,18 @@ QPointF const &ConnectionGraphicsObject::endPoint(PortType portType) const
 
 void ConnectionGraphicsObject::setEndPoint(PortType portType, QPointF const &point)
 {
-    if (portType == PortType::In)
-        _in = point;
-    else
-        _out = point;
+    QPointF &end = (portType == PortType::In) ? _in : _out;
+
+    if (end == point)
+        return;
+
+    // Lets the scene see the old, still cached bounds; overlaid ones have none.
+    if (!_overlaid)
+        prepareGeometryChange();
+
+    end = point;
+
+    _geometry.valid = false;
 }
 
 void ConnectionGraphicsObject::move()
@@ -157,27 +364,42 @@ void ConnectionGraphicsObject::move()
 
         NodeGraphicsObject *ngo = nodeScene()->nodeGraphicsObject(nodeId);
 
+        // Nodes of a virtualized scene may have no object; their transform is
+        // the plain translation to the model position.
+        QTransform nodeSceneTransform;
+
         if (ngo) {
-            AbstractNodeGeometry &geometry = nodeScene()->nodeGeometry();
+            nodeSceneTransform = ngo->sceneTransform();
+        } else {
+            QPointF const pos = graphModel().nodeData<QPointF>(nodeId, NodeRole::Position);
+            nodeSceneTransform = QTransform::fromTranslate(pos.x(), pos.y());
+        }
 
-            QPointF scenePos = geometry.portScenePosition(nodeId,
-                                                          portType,
-                                                          getPortIndex(portType, cId),
-                                                          ngo->sceneTransform());
+        AbstractNodeGeometry &geometry = nodeScene()->nodeGeometry();
 
-            QPointF connectionPos = sceneTransform().inverted().map(scenePos);
+        QPointF scenePos = geometry.portScenePosition(nodeId,
+                                                      portType,
+                                                      getPortIndex(portType, cId),
+                                                      nodeSceneTransform);
 
-            setEndPoint(portType, connectionPos);
-        }
+        QPointF connectionPos = sceneTransform().inverted().map(scenePos);
+
+        setEndPoint(portType, connectionPos);
     };
 
     moveEnd(_connectionId, PortType::Out);
     moveEnd(_connectionId, PortType::In);
 
-    prepareGeometryChange();
-
     update();
 
+    nodeScene()->updateSpatialIndex(*this);
+
+    if (auto layer = nodeScene()->connectionBatchLayer())
+        layer->markDirty(_connectionId, this);
+
+    if (_connectionState.hovered())
+        nodeScene()->updateHoverOverlay(*this);
+
     Q_EMIT positionChanged();
 }
 
@@ -198,15 +420,61 @@ void ConnectionGraphicsObject::paint(QPainter *painter,
     if (!scene())
         return;
 
+    PaintStatistics::Scope scope(PaintStatistics::ConnectionPaint);
+
+    if (_overlaid)
+        return;
+
+    if (nodeScene()->connectionBatchLayer() && ConnectionBatchLayer::batchable(*this))
+        return;
+
     painter->setClipRect(option->exposedRect);
 
     QPen pen;
-    pen.setColor(StyleCollection::connectionStyle().normalColor());
+    pen.setColor(nodeScene()->styleContext().connectionStyle().normalColor());
     painter->setPen(pen);
 
     nodeScene()->connectionPainter().paint(painter, *this);
 }
 
+void ConnectionGraphicsObject::setConnectionColor(const QColor &color)
+{
+    connectionColor = color;
+
+    if (auto layer = nodeScene()->connectionBatchLayer())
+        layer->markDirty(_connectionId, this);
+}
+
+void ConnectionGraphicsObject::setLabel(QString const &label)
+{
+    if (_label == label)
+        return;
+
+    prepareGeometryChange();
+
+    _label = label;
+    _geometry.valid = false;
+
+    nodeScene()->updateSpatialIndex(*this);
+
+    if (auto layer = nodeScene()->connectionBatchLayer())
+        layer->markDirty(_connectionId, this);
+}
+
+QRectF ConnectionGraphicsObject::labelRect() const
+{
+    updateGeometryCache();
+
+    return _geometry.label;
+}
+
+QFont const &ConnectionGraphicsObject::labelFont()
+{
+    static QFont const font("Arial", 10);
+
+    return font;
+}
+
 void ConnectionGraphicsObject::mousePressEvent(QGraphicsSceneMouseEvent *event)
 {
     // Проверка, является ли порт входным
@@ -220,8 +488,6 @@ void ConnectionGraphicsObject::mousePressEvent(QGraphicsSceneMouseEvent *event)
 
 void ConnectionGraphicsObject::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
 {
-    prepareGeometryChange();
-
     // Проверка, является ли порт входным
         if (_connectionState.requiredPort() == PortType::Out) {
             event->ignore(); // Игнорировать событие, если порт входной
@@ -231,7 +497,9 @@ void ConnectionGraphicsObject::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
     auto view = static_cast<QGraphicsView *>(event->widget());
     auto ngo = locateNodeAt(event->scenePos(), *nodeScene(), view->transform());
     if (ngo) {
-        ngo->reactToConnection(this);
+        // The overlay draws the port highlight, the node stays as it is.
+        if (!_overlaid)
+            ngo->reactToConnection(this);
 
         _connectionState.setLastHoveredNode(ngo->nodeId());
     } else {
@@ -248,7 +516,10 @@ void ConnectionGraphicsObject::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
 
     //-------------------
 
-    update();
+    if (_overlaid)
+        nodeScene()->updateDraftOverlay();
+    else
+        update();
 
     event->accept();
 }
@@ -290,7 +561,10 @@ void ConnectionGraphicsObject::hoverEnterEvent(QGraphicsSceneHoverEvent *event)
 {
     _connectionState.setHovered(true);
 
-    update();
+    if (nodeScene()->hoverOverlay())
+        nodeScene()->updateHoverOverlay(*this);
+    else
+        update();
 
     // Signal
     nodeScene()->connectionHovered(connectionId(), event->screenPos());
@@ -302,7 +576,10 @@ void ConnectionGraphicsObject::hoverLeaveEvent(QGraphicsSceneHoverEvent *event)
 {
     _connectionState.setHovered(false);
 
-    update();
+    if (nodeScene()->hoverOverlay())
+        nodeScene()->updateHoverOverlay(*this);
+    else
+        update();
 
     // Signal
     nodeScene()->connectionHoverLeft(connectionId());
@@ -310,19 +587,26 @@ void ConnectionGraphicsObject::hoverLeaveEvent(QGraphicsSceneHoverEvent *event)
     event->accept();
 }
 
-std::pair<QPointF, QPointF> ConnectionGraphicsObject::pointsC1C2() const
+QVariant ConnectionGraphicsObject::itemChange(GraphicsItemChange change, QVariant const &value)
 {
-    switch (nodeScene()->orientation()) {
-    case Qt::Horizontal:
-        return pointsC1C2Horizontal();
-        break;
+    if (change == ItemSelectedHasChanged) {
+        if (auto scene = nodeScene()) {
+            scene->updateConnectionSelection(_connectionId, value.toBool());
 
-    case Qt::Vertical:
-        return pointsC1C2Vertical();
-        break;
+            // Selected connections paint themselves instead of the layer.
+            if (auto layer = scene->connectionBatchLayer())
+                layer->markDirty(_connectionId, this);
+        }
     }
 
-    throw std::logic_error("Unreachable code after switch statement");
+    return QGraphicsObject::itemChange(change, value);
+}
+
+std::pair<QPointF, QPointF> ConnectionGraphicsObject::pointsC1C2() const
+{
+    updateGeometryCache();
+
+    return _geometry.c1c2;
 }
 
 void ConnectionGraphicsObject::addGraphicsEffect()
@@ -338,11 +622,22 @@ void ConnectionGraphicsObject::addGraphicsEffect()
     //effect->setColor(QColor(Qt::gray).darker(800));
 }
 
-std::pair<QPointF, QPointF> ConnectionGraphicsObject::pointsC1C2Horizontal() const
+std::pair<QPointF, QPointF> ConnectionGraphicsObject::pointsC1C2(QPointF const &out,
+                                                                 QPointF const &in,
+                                                                 Qt::Orientation const orientation)
+{
+    if (orientation == Qt::Vertical)
+        return pointsC1C2Vertical(out, in);
+
+    return pointsC1C2Horizontal(out, in);
+}
+
+std::pair<QPointF, QPointF> ConnectionGraphicsObject::pointsC1C2Horizontal(QPointF const &out,
+                                                                           QPointF const &in)
 {
     double const defaultOffset = 200;
 
-    double xDistance = _in.x() - _out.x();
+    double xDistance = in.x() - out.x();
 
     double horizontalOffset = qMin(defaultOffset, std::abs(xDistance));
 
@@ -351,7 +646,7 @@ std::pair<QPointF, QPointF> ConnectionGraphicsObject::pointsC1C2Horizontal() con
     double ratioX = 0.5;
 
     if (xDistance <= 0) {
-        double yDistance = _in.y() - _out.y() + 20;
+        double yDistance = in.y() - out.y() + 20;
 
         double vector = yDistance < 0 ? -1.0 : 1.0;
 
@@ -362,18 +657,19 @@ std::pair<QPointF, QPointF> ConnectionGraphicsObject::pointsC1C2Horizontal() con
 
     horizontalOffset *= ratioX;
 
-    QPointF c1(_out.x() + horizontalOffset, _out.y() + verticalOffset);
+    QPointF c1(out.x() + horizontalOffset, out.y() + verticalOffset);
 
-    QPointF c2(_in.x() - horizontalOffset, _in.y() - verticalOffset);
+    QPointF c2(in.x() - horizontalOffset, in.y() - verticalOffset);
 
     return std::make_pair(c1, c2);
 }
 
-std::pair<QPointF, QPointF> ConnectionGraphicsObject::pointsC1C2Vertical() const
+std::pair<QPointF, QPointF> ConnectionGraphicsObject::pointsC1C2Vertical(QPointF const &out,
+                                                                         QPointF const &in)
 {
     double const defaultOffset = 200;
 
-    double yDistance = _in.y() - _out.y();
+    double yDistance = in.y() - out.y();
 
     double verticalOffset = qMin(defaultOffset, std::abs(yDistance));
 
@@ -382,7 +678,7 @@ std::pair<QPointF, QPointF> ConnectionGraphicsObject::pointsC1C2Vertical() const
     double ratioY = 0.5;
 
     if (yDistance <= 0) {
-        double xDistance = _in.x() - _out.x() + 20;
+        double xDistance = in.x() - out.x() + 20;
 
         double vector = xDistance < 0 ? -1.0 : 1.0;
 
@@ -393,9 +689,9 @@ std::pair<QPointF, QPointF> ConnectionGraphicsObject::pointsC1C2Vertical() const
 
     verticalOffset *= ratioY;
 
-    QPointF c1(_out.x() + horizontalOffset, _out.y() + verticalOffset);
+    QPointF c1(out.x() + horizontalOffset, out.y() + verticalOffset);
 
-    QPointF c2(_in.x() - horizontalOffset, _in.y() - verticalOffset);
+    QPointF c2(in.x() - horizontalOffset, in.y() - verticalOffset);
 
     return std::make_pair(c1, c2);
 }
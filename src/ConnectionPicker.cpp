@@ -0,0 +1,305 @@
+#include "ConnectionPicker.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NODE_EDITOR_PICKER_SSE2
+#endif
+
+namespace QtNodes {
+
+namespace {
+
+constexpr std::size_t BlockSize = 4;
+
+constexpr float Infinity = std::numeric_limits<float>::infinity();
+
+} // namespace
+
+constexpr int ConnectionPicker::CurveSegments;
+
+ConnectionPicker::ConnectionPicker()
+    : _tolerance(5.0)
+    , _scanned(false)
+{}
+
+void ConnectionPicker::setTolerance(qreal const tolerance)
+{
+    _tolerance = tolerance;
+    _scanned = false;
+}
+
+void ConnectionPicker::insert(ConnectionId const &connectionId,
+                              QPointF const &out,
+                              QPointF const &c1,
+                              QPointF const &c2,
+                              QPointF const &in)
+{
+    auto it = _slots.find(connectionId);
+
+    std::size_t slot;
+
+    if (it != _slots.end()) {
+        slot = it->second;
+    } else {
+        slot = _ids.size();
+
+        _ids.push_back(connectionId);
+        _slots.emplace(connectionId, slot);
+
+        // Pads with curves no point is inside the bounds of.
+        if (_ax.size() < _ids.size()) {
+            std::size_t const size = _ax.size() + BlockSize;
+
+            for (auto *column : {&_ax, &_ay, &_bx, &_by, &_cx, &_cy, &_dx, &_dy}) {
+                column->resize(size, 0.0f);
+            }
+
+            _minX.resize(size, Infinity);
+            _minY.resize(size, Infinity);
+            _maxX.resize(size, -Infinity);
+            _maxY.resize(size, -Infinity);
+        }
+    }
+
+    // Power basis of the Bernstein form.
+    _dx[slot] = float(out.x());
+    _dy[slot] = float(out.y());
+    _cx[slot] = float(3.0 * (c1.x() - out.x()));
+    _cy[slot] = float(3.0 * (c1.y() - out.y()));
+    _bx[slot] = float(3.0 * (c2.x() - 2.0 * c1.x() + out.x()));
+    _by[slot] = float(3.0 * (c2.y() - 2.0 * c1.y() + out.y()));
+    _ax[slot] = float(in.x() - out.x() + 3.0 * (c1.x() - c2.x()));
+    _ay[slot] = float(in.y() - out.y() + 3.0 * (c1.y() - c2.y()));
+
+    _minX[slot] = float(std::min({out.x(), c1.x(), c2.x(), in.x()}));
+    _minY[slot] = float(std::min({out.y(), c1.y(), c2.y(), in.y()}));
+    _maxX[slot] = float(std::max({out.x(), c1.x(), c2.x(), in.x()}));
+    _maxY[slot] = float(std::max({out.y(), c1.y(), c2.y(), in.y()}));
+
+    _scanned = false;
+}
+
+void ConnectionPicker::remove(ConnectionId const &connectionId)
+{
+    auto it = _slots.find(connectionId);
+
+    if (it == _slots.end())
+        return;
+
+    std::size_t const slot = it->second;
+    std::size_t const last = _ids.size() - 1;
+
+    _slots.erase(it);
+
+    // The last curve fills the gap, the arrays stay dense.
+    if (slot != last) {
+        _ids[slot] = _ids[last];
+        _slots[_ids[slot]] = slot;
+
+        for (auto *column : {&_ax, &_ay, &_bx, &_by, &_cx, &_cy, &_dx, &_dy,
+                             &_minX, &_minY, &_maxX, &_maxY}) {
+            (*column)[slot] = (*column)[last];
+        }
+    }
+
+    _ids.pop_back();
+
+    _minX[last] = Infinity;
+    _minY[last] = Infinity;
+    _maxX[last] = -Infinity;
+    _maxY[last] = -Infinity;
+
+    _scanned = false;
+}
+
+void ConnectionPicker::clear()
+{
+    _ids.clear();
+    _slots.clear();
+
+    for (auto *column : {&_ax, &_ay, &_bx, &_by, &_cx, &_cy, &_dx, &_dy,
+                         &_minX, &_minY, &_maxX, &_maxY}) {
+        column->clear();
+    }
+
+    _scanned = false;
+}
+
+bool ConnectionPicker::pick(QPointF const &scenePoint, ConnectionId &connectionId) const
+{
+    scan(scenePoint);
+
+    auto const nearest = std::min_element(_hits.begin(), _hits.end(), [](auto const &a, auto const &b) {
+        return a.second < b.second;
+    });
+
+    if (nearest == _hits.end())
+        return false;
+
+    connectionId = nearest->first;
+
+    return true;
+}
+
+bool ConnectionPicker::hits(ConnectionId const &connectionId, QPointF const &scenePoint) const
+{
+    scan(scenePoint);
+
+    return _hits.find(connectionId) != _hits.end();
+}
+
+void ConnectionPicker::scan(QPointF const &scenePoint) const
+{
+    if (_scanned && _scannedPoint == scenePoint)
+        return;
+
+    _hits.clear();
+
+    float const px = float(scenePoint.x());
+    float const py = float(scenePoint.y());
+
+    float const limit = float(_tolerance * _tolerance);
+
+    float distances[BlockSize];
+
+    for (std::size_t first = 0; first < _ids.size(); first += BlockSize) {
+        scanBlock(first, px, py, distances);
+
+        for (std::size_t lane = 0; lane < BlockSize; ++lane) {
+            if (distances[lane] <= limit)
+                _hits.emplace(_ids[first + lane], distances[lane]);
+        }
+    }
+
+    _scanned = true;
+    _scannedPoint = scenePoint;
+}
+
+#ifdef NODE_EDITOR_PICKER_SSE2
+
+void ConnectionPicker::scanBlock(std::size_t const first,
+                                 float const px,
+                                 float const py,
+                                 float *result) const
+{
+    float const tolerance = float(_tolerance);
+
+    __m128 const x = _mm_set1_ps(px);
+    __m128 const y = _mm_set1_ps(py);
+
+    __m128 const inside = _mm_and_ps(
+        _mm_and_ps(_mm_cmpge_ps(x, _mm_sub_ps(_mm_loadu_ps(&_minX[first]), _mm_set1_ps(tolerance))),
+                   _mm_cmple_ps(x, _mm_add_ps(_mm_loadu_ps(&_maxX[first]), _mm_set1_ps(tolerance)))),
+        _mm_and_ps(_mm_cmpge_ps(y, _mm_sub_ps(_mm_loadu_ps(&_minY[first]), _mm_set1_ps(tolerance))),
+                   _mm_cmple_ps(y, _mm_add_ps(_mm_loadu_ps(&_maxY[first]), _mm_set1_ps(tolerance)))));
+
+    if (_mm_movemask_ps(inside) == 0) {
+        _mm_storeu_ps(result, _mm_set1_ps(Infinity));
+        return;
+    }
+
+    __m128 const ax = _mm_loadu_ps(&_ax[first]);
+    __m128 const ay = _mm_loadu_ps(&_ay[first]);
+    __m128 const bx = _mm_loadu_ps(&_bx[first]);
+    __m128 const by = _mm_loadu_ps(&_by[first]);
+    __m128 const cx = _mm_loadu_ps(&_cx[first]);
+    __m128 const cy = _mm_loadu_ps(&_cy[first]);
+    __m128 const dx = _mm_loadu_ps(&_dx[first]);
+    __m128 const dy = _mm_loadu_ps(&_dy[first]);
+
+    __m128 const zero = _mm_setzero_ps();
+    __m128 const one = _mm_set1_ps(1.0f);
+    __m128 const epsilon = _mm_set1_ps(1e-12f);
+
+    __m128 previousX = dx;
+    __m128 previousY = dy;
+
+    __m128 nearest = _mm_set1_ps(Infinity);
+
+    for (int i = 1; i <= CurveSegments; ++i) {
+        __m128 const t = _mm_set1_ps(float(i) / CurveSegments);
+
+        __m128 const qx = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(ax, t), bx), t), cx), t), dx);
+        __m128 const qy = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(ay, t), by), t), cy), t), dy);
+
+        // Distance to the chord from the previous point.
+        __m128 const vx = _mm_sub_ps(qx, previousX);
+        __m128 const vy = _mm_sub_ps(qy, previousY);
+        __m128 const wx = _mm_sub_ps(x, previousX);
+        __m128 const wy = _mm_sub_ps(y, previousY);
+
+        __m128 const length = _mm_max_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), epsilon);
+
+        __m128 const s = _mm_min_ps(
+            one,
+            _mm_max_ps(zero,
+                       _mm_div_ps(_mm_add_ps(_mm_mul_ps(wx, vx), _mm_mul_ps(wy, vy)), length)));
+
+        __m128 const ex = _mm_sub_ps(wx, _mm_mul_ps(s, vx));
+        __m128 const ey = _mm_sub_ps(wy, _mm_mul_ps(s, vy));
+
+        nearest = _mm_min_ps(nearest, _mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)));
+
+        previousX = qx;
+        previousY = qy;
+    }
+
+    // Lanes outside their bounds, padding included, report no distance.
+    nearest = _mm_or_ps(_mm_and_ps(inside, nearest),
+                        _mm_andnot_ps(inside, _mm_set1_ps(Infinity)));
+
+    _mm_storeu_ps(result, nearest);
+}
+
+#else
+
+void ConnectionPicker::scanBlock(std::size_t const first,
+                                 float const px,
+                                 float const py,
+                                 float *result) const
+{
+    float const tolerance = float(_tolerance);
+
+    for (std::size_t lane = 0; lane < BlockSize; ++lane) {
+        std::size_t const slot = first + lane;
+
+        result[lane] = Infinity;
+
+        if (px < _minX[slot] - tolerance || px > _maxX[slot] + tolerance
+            || py < _minY[slot] - tolerance || py > _maxY[slot] + tolerance)
+            continue;
+
+        float previousX = _dx[slot];
+        float previousY = _dy[slot];
+
+        for (int i = 1; i <= CurveSegments; ++i) {
+            float const t = float(i) / CurveSegments;
+
+            float const qx = ((_ax[slot] * t + _bx[slot]) * t + _cx[slot]) * t + _dx[slot];
+            float const qy = ((_ay[slot] * t + _by[slot]) * t + _cy[slot]) * t + _dy[slot];
+
+            float const vx = qx - previousX;
+            float const vy = qy - previousY;
+            float const wx = px - previousX;
+            float const wy = py - previousY;
+
+            float const length = std::max(vx * vx + vy * vy, 1e-12f);
+            float const s = std::min(1.0f, std::max(0.0f, (wx * vx + wy * vy) / length));
+
+            float const ex = wx - s * vx;
+            float const ey = wy - s * vy;
+
+            result[lane] = std::min(result[lane], ex * ex + ey * ey);
+
+            previousX = qx;
+            previousY = qy;
+        }
+    }
+}
+
+#endif
+
+} // namespace QtNodes
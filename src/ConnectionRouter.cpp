@@ -0,0 +1,750 @@
+#include "ConnectionRouter.hpp"
+
+#include "AbstractGraphModel.hpp"
+#include "AbstractNodeGeometry.hpp"
+#include "BasicGraphicsScene.hpp"
+#include "ConnectionGraphicsObject.hpp"
+#include "ConnectionIdUtils.hpp"
+
+#include <QtCore/QRunnable>
+#include <QtCore/QThread>
+#include <QtCore/QTimer>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <queue>
+#include <utility>
+
+namespace QtNodes {
+
+namespace {
+
+/// Straight piece leaving and entering a port before the route may turn.
+constexpr double Stub = 20.0;
+
+/// Free room kept around every node.
+constexpr double Clearance = 10.0;
+
+/// Room around both ends the search may use for detours.
+constexpr double WindowMargin = 160.0;
+
+constexpr double MinCellSize = 10.0;
+
+/// Larger windows get coarser cells.
+constexpr double MaxCells = 40000.0;
+
+/// Cost of a bend in cell steps.
+constexpr float BendPenalty = 3.0f;
+
+constexpr double CornerRadius = 12.0;
+
+/// Fewer connections per worker do not pay for the thread.
+constexpr std::size_t MinChunk = 64;
+
+constexpr double ObstacleCellSize = 256.0;
+
+constexpr double EndTolerance = 0.5;
+
+bool crosses(QPointF const &a, QPointF const &b, QRectF const &rect)
+{
+    // Segments are horizontal or vertical, their bounds are the segment.
+    return std::max(a.x(), b.x()) >= rect.left() && std::min(a.x(), b.x()) <= rect.right()
+           && std::max(a.y(), b.y()) >= rect.top() && std::min(a.y(), b.y()) <= rect.bottom();
+}
+
+/// Drops repeated points and those in the middle of a straight run.
+std::vector<QPointF> simplified(std::vector<QPointF> const &points)
+{
+    std::vector<QPointF> result;
+    result.reserve(points.size());
+
+    for (QPointF const &point : points) {
+        if (!result.empty() && (point - result.back()).manhattanLength() < 1e-6)
+            continue;
+
+        if (result.size() >= 2) {
+            QPointF const &a = result[result.size() - 2];
+            QPointF const &b = result.back();
+
+            bool const sameX = std::abs(a.x() - b.x()) < 1e-6 && std::abs(b.x() - point.x()) < 1e-6;
+            bool const sameY = std::abs(a.y() - b.y()) < 1e-6 && std::abs(b.y() - point.y()) < 1e-6;
+
+            if (sameX || sameY)
+                result.back() = point;
+            else
+                result.push_back(point);
+        } else {
+            result.push_back(point);
+        }
+    }
+
+    return result;
+}
+
+/// A* on a grid around both ends; the state is a cell and the direction it was entered with.
+std::vector<QPointF> findRoute(ConnectionRouter::Obstacles const &obstacles,
+                               ConnectionRouter::Request const &request,
+                               Qt::Orientation const orientation)
+{
+    bool const horizontal = orientation == Qt::Horizontal;
+
+    QPointF const direction = horizontal ? QPointF(1, 0) : QPointF(0, 1);
+    QPointF const start = request.out + Stub * direction;
+    QPointF const goal = request.in - Stub * direction;
+
+    QRectF const window = QRectF(start, goal).normalized().adjusted(-WindowMargin,
+                                                                    -WindowMargin,
+                                                                    WindowMargin,
+                                                                    WindowMargin);
+
+    double const cell = std::max(MinCellSize,
+                                 std::sqrt(window.width() * window.height() / MaxCells));
+
+    int const columns = std::max(1, static_cast<int>(std::ceil(window.width() / cell)));
+    int const rows = std::max(1, static_cast<int>(std::ceil(window.height() / cell)));
+
+    std::size_t const cells = static_cast<std::size_t>(columns) * rows;
+
+    auto column = [&](double const x) {
+        return std::clamp(static_cast<int>(std::floor((x - window.left()) / cell)), 0, columns - 1);
+    };
+
+    auto row = [&](double const y) {
+        return std::clamp(static_cast<int>(std::floor((y - window.top()) / cell)), 0, rows - 1);
+    };
+
+    std::vector<char> blocked(cells, 0);
+
+    obstacles.query(window, [&](NodeId const, QRectF const &rect) {
+        QRectF const inflated = rect.adjusted(-Clearance, -Clearance, Clearance, Clearance);
+
+        if (!inflated.intersects(window))
+            return;
+
+        for (int y = row(inflated.top()); y <= row(inflated.bottom()); ++y) {
+            for (int x = column(inflated.left()); x <= column(inflated.right()); ++x) {
+                blocked[static_cast<std::size_t>(y) * columns + x] = 1;
+            }
+        }
+    });
+
+    int const startX = column(start.x());
+    int const startY = row(start.y());
+    int const goalX = column(goal.x());
+    int const goalY = row(goal.y());
+
+    std::size_t const startCell = static_cast<std::size_t>(startY) * columns + startX;
+    std::size_t const goalCell = static_cast<std::size_t>(goalY) * columns + goalX;
+
+    // The stubs end next to their own node.
+    blocked[startCell] = 0;
+    blocked[goalCell] = 0;
+
+    static int const dx[4] = {1, 0, -1, 0};
+    static int const dy[4] = {0, 1, 0, -1};
+
+    int const forward = horizontal ? 0 : 1;
+
+    auto heuristic = [&](int const x, int const y) {
+        return static_cast<float>(std::abs(x - goalX) + std::abs(y - goalY));
+    };
+
+    float const infinity = std::numeric_limits<float>::infinity();
+    std::size_t const none = std::numeric_limits<std::size_t>::max();
+
+    std::vector<float> cost(cells * 4, infinity);
+    std::vector<std::size_t> from(cells * 4, none);
+
+    using Entry = std::pair<float, std::size_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+    std::size_t const first = startCell * 4 + forward;
+    cost[first] = 0.0f;
+    open.emplace(heuristic(startX, startY), first);
+
+    // Arriving against the flow costs a bend, so the search goes on past the first arrival.
+    float best = infinity;
+    std::size_t reached = none;
+
+    while (!open.empty() && open.top().first < best) {
+        auto const [estimate, state] = open.top();
+        open.pop();
+
+        std::size_t const index = state / 4;
+        int const d = static_cast<int>(state % 4);
+        int const x = static_cast<int>(index % columns);
+        int const y = static_cast<int>(index / columns);
+
+        if (estimate > cost[state] + heuristic(x, y))
+            continue;
+
+        if (index == goalCell) {
+            float const total = cost[state] + (d == forward ? 0.0f : BendPenalty);
+
+            if (total < best) {
+                best = total;
+                reached = state;
+            }
+
+            continue;
+        }
+
+        for (int nd = 0; nd < 4; ++nd) {
+            if (nd == (d + 2) % 4)
+                continue;
+
+            int const nx = x + dx[nd];
+            int const ny = y + dy[nd];
+
+            if (nx < 0 || ny < 0 || nx >= columns || ny >= rows)
+                continue;
+
+            std::size_t const next = static_cast<std::size_t>(ny) * columns + nx;
+
+            if (blocked[next])
+                continue;
+
+            float const g = cost[state] + 1.0f + (nd == d ? 0.0f : BendPenalty);
+            std::size_t const nextState = next * 4 + nd;
+
+            if (g < cost[nextState]) {
+                cost[nextState] = g;
+                from[nextState] = state;
+                open.emplace(g + heuristic(nx, ny), nextState);
+            }
+        }
+    }
+
+    if (reached == none)
+        return {};
+
+    std::vector<std::size_t> states;
+
+    for (std::size_t state = reached; state != none; state = from[state]) {
+        states.push_back(state);
+    }
+
+    std::reverse(states.begin(), states.end());
+
+    auto center = [&](std::size_t const index) {
+        return QPointF(window.left() + (static_cast<double>(index % columns) + 0.5) * cell,
+                       window.top() + (static_cast<double>(index / columns) + 0.5) * cell);
+    };
+
+    // Corners are the cells where the direction changes. Each one takes the
+    // coordinate across its incoming run from the point before, so the runs
+    // stay straight although the ends lie off the cell centers.
+    std::vector<QPointF> points{request.out, start};
+
+    auto runIsHorizontal = [](std::size_t const state) {
+        return state % 4 == 0 || state % 4 == 2;
+    };
+
+    for (std::size_t i = 1; i + 1 < states.size(); ++i) {
+        if (states[i] % 4 == states[i + 1] % 4)
+            continue;
+
+        QPointF corner = center(states[i] / 4);
+
+        if (runIsHorizontal(states[i]))
+            corner.setY(points.back().y());
+        else
+            corner.setX(points.back().x());
+
+        points.push_back(corner);
+    }
+
+    bool const lastHorizontal = runIsHorizontal(states.back());
+
+    if (points.size() > 2) {
+        if (lastHorizontal)
+            points.back().setY(goal.y());
+        else
+            points.back().setX(goal.x());
+    } else if (lastHorizontal ? std::abs(start.y() - goal.y()) > 1e-6
+                              : std::abs(start.x() - goal.x()) > 1e-6) {
+        // A straight run between ends that do not line up gets a jog halfway.
+        if (lastHorizontal) {
+            double const middle = (start.x() + goal.x()) / 2;
+            points.push_back(QPointF(middle, start.y()));
+            points.push_back(QPointF(middle, goal.y()));
+        } else {
+            double const middle = (start.y() + goal.y()) / 2;
+            points.push_back(QPointF(start.x(), middle));
+            points.push_back(QPointF(goal.x(), middle));
+        }
+    }
+
+    points.push_back(goal);
+    points.push_back(request.in);
+
+    return simplified(points);
+}
+
+QPainterPath makePath(std::vector<QPointF> const &points, ConnectionRouter::Style const style)
+{
+    QPainterPath path(points.front());
+
+    for (std::size_t i = 1; i + 1 < points.size(); ++i) {
+        QPointF const &corner = points[i];
+
+        if (style == ConnectionRouter::Style::Orthogonal) {
+            path.lineTo(corner);
+            continue;
+        }
+
+        QPointF const toPrevious = points[i - 1] - corner;
+        QPointF const toNext = points[i + 1] - corner;
+
+        double const previousLength = toPrevious.manhattanLength();
+        double const nextLength = toNext.manhattanLength();
+
+        double const radius = std::min({CornerRadius, previousLength / 2, nextLength / 2});
+
+        path.lineTo(corner + toPrevious * (radius / previousLength));
+        path.quadTo(corner, corner + toNext * (radius / nextLength));
+    }
+
+    path.lineTo(points.back());
+
+    return path;
+}
+
+/// Routes a chunk of connections against a snapshot of the obstacles.
+class RouteTask : public QRunnable
+{
+public:
+    /// Corners per request, empty where no route was found.
+    using Results = std::vector<std::pair<ConnectionRouter::Request, std::vector<QPointF>>>;
+
+    using Done = std::function<void(Results)>;
+
+    RouteTask(std::shared_ptr<ConnectionRouter::Obstacles const> obstacles,
+              std::vector<ConnectionRouter::Request> requests,
+              Qt::Orientation const orientation,
+              CancellationToken token,
+              Done done)
+        : _obstacles(std::move(obstacles))
+        , _requests(std::move(requests))
+        , _orientation(orientation)
+        , _token(std::move(token))
+        , _done(std::move(done))
+    {}
+
+    void run() override
+    {
+        Results results;
+        results.reserve(_requests.size());
+
+        for (ConnectionRouter::Request const &request : _requests) {
+            if (_token.isCancelled())
+                return;
+
+            results.emplace_back(request, findRoute(*_obstacles, request, _orientation));
+        }
+
+        _done(std::move(results));
+    }
+
+private:
+    std::shared_ptr<ConnectionRouter::Obstacles const> _obstacles;
+
+    std::vector<ConnectionRouter::Request> _requests;
+
+    Qt::Orientation _orientation;
+
+    CancellationToken _token;
+
+    Done _done;
+};
+
+} // namespace
+
+ConnectionRouter::ConnectionRouter(BasicGraphicsScene &scene, Style const style)
+    : QObject(&scene)
+    , _scene(scene)
+    , _style(style)
+    , _obstacles(std::make_shared<Obstacles>(ObstacleCellSize))
+    , _routeIndex(ObstacleCellSize)
+    , _scheduled(false)
+    , _pendingChunks(0)
+    , _generation(0)
+{
+    connectModel();
+
+    rerouteAll();
+}
+
+ConnectionRouter::~ConnectionRouter()
+{
+    _roundToken.cancel();
+
+    // Finished chunks post their results to `this`; none may outlive it.
+    _pool.waitForDone();
+}
+
+void ConnectionRouter::setStyle(Style const style)
+{
+    if (_style == style)
+        return;
+
+    _style = style;
+
+    rerouteAll();
+}
+
+QPainterPath const *ConnectionRouter::route(ConnectionId const &connectionId,
+                                            QPointF const &out,
+                                            QPointF const &in) const
+{
+    auto it = _routes.find(connectionId);
+
+    if (it == _routes.end())
+        return nullptr;
+
+    Route const &route = it->second;
+
+    if ((route.out - out).manhattanLength() > EndTolerance
+        || (route.in - in).manhattanLength() > EndTolerance)
+        return nullptr;
+
+    return &route.path;
+}
+
+void ConnectionRouter::rerouteAll()
+{
+    _roundToken.cancel();
+    _roundToken = CancellationToken();
+
+    ++_generation;
+    _pendingChunks = 0;
+
+    std::vector<ConnectionId> routed;
+    routed.reserve(_routes.size());
+
+    for (auto const &entry : _routes) {
+        routed.push_back(entry.first);
+    }
+
+    _routes.clear();
+    _routeIndex.clear();
+
+    for (ConnectionId const &connectionId : routed) {
+        if (auto cgo = _scene.connectionGraphicsObject(connectionId))
+            cgo->updateRoute();
+    }
+
+    // The rounds cancelled above may still read the old rectangles.
+    _obstacles = std::make_shared<Obstacles>(ObstacleCellSize);
+
+    _changedNodes.clear();
+    _dirtyConnections.clear();
+
+    AbstractGraphModel &model = _scene.graphModel();
+
+    for (NodeId const nodeId : model.allNodeIds()) {
+        _obstacles->insert(nodeId, nodeRect(nodeId));
+
+    }
+
+    model.forEachGraphConnection([this](ConnectionId const &connectionId) {
+        _dirtyConnections.insert(connectionId);
+    });
+
+    schedule();
+}
+
+void ConnectionRouter::connectModel()
+{
+    AbstractGraphModel *model = &_scene.graphModel();
+
+    auto onNode = [this](NodeId const nodeId) {
+        if (!batching())
+            onNodeChanged(nodeId);
+    };
+
+    connect(model, &AbstractGraphModel::nodeCreated, this, onNode);
+    connect(model, &AbstractGraphModel::nodeUpdated, this, onNode);
+    connect(model, &AbstractGraphModel::nodePositionUpdated, this, onNode);
+    connect(model, &AbstractGraphModel::nodeDeleted, this, onNode);
+
+    connect(model,
+            &AbstractGraphModel::nodePositionsUpdated,
+            this,
+            [this](std::vector<NodeId> const &nodeIds) {
+                if (batching())
+                    return;
+
+                for (NodeId const nodeId : nodeIds) {
+                    onNodeChanged(nodeId);
+                }
+            });
+
+    connect(model,
+            &AbstractGraphModel::connectionCreated,
+            this,
+            [this](ConnectionId const connectionId) {
+                if (!batching())
+                    onConnectionCreated(connectionId);
+            });
+
+    connect(model,
+            &AbstractGraphModel::connectionDeleted,
+            this,
+            [this](ConnectionId const connectionId) {
+                if (!batching())
+                    onConnectionDeleted(connectionId);
+            });
+
+    connect(model, &AbstractGraphModel::modelReset, this, [this]() {
+        if (!batching())
+            rerouteAll();
+    });
+
+    connect(model, &AbstractGraphModel::batchFinished, this, &ConnectionRouter::onBatchFinished);
+}
+
+bool ConnectionRouter::batching() const
+{
+    return _scene.graphModel().batchInProgress();
+}
+
+void ConnectionRouter::onNodeChanged(NodeId const nodeId)
+{
+    _changedNodes.insert(nodeId);
+
+    schedule();
+}
+
+void ConnectionRouter::onConnectionCreated(ConnectionId const connectionId)
+{
+    _dirtyConnections.insert(connectionId);
+
+    schedule();
+}
+
+void ConnectionRouter::onConnectionDeleted(ConnectionId const connectionId)
+{
+    _dirtyConnections.erase(connectionId);
+
+    _routes.erase(connectionId);
+    _routeIndex.remove(connectionId);
+}
+
+void ConnectionRouter::onBatchFinished(GraphChangeSet const &changes)
+{
+    if (changes.reset) {
+        rerouteAll();
+        return;
+    }
+
+    for (ConnectionId const &connectionId : changes.deletedConnections) {
+        onConnectionDeleted(connectionId);
+    }
+
+    for (ConnectionId const &connectionId : changes.createdConnections) {
+        _dirtyConnections.insert(connectionId);
+    }
+
+    _changedNodes.insert(changes.deletedNodes.begin(), changes.deletedNodes.end());
+    _changedNodes.insert(changes.createdNodes.begin(), changes.createdNodes.end());
+    _changedNodes.insert(changes.movedNodes.begin(), changes.movedNodes.end());
+    _changedNodes.insert(changes.updatedNodes.begin(), changes.updatedNodes.end());
+
+    schedule();
+}
+
+void ConnectionRouter::markCorridor(QRectF const &rect)
+{
+    _routeIndex.query(rect, [&](ConnectionId const &connectionId, QRectF const &) {
+        std::vector<QPointF> const &points = _routes.at(connectionId).points;
+
+        for (std::size_t i = 1; i < points.size(); ++i) {
+            if (crosses(points[i - 1], points[i], rect)) {
+                _dirtyConnections.insert(connectionId);
+                return;
+            }
+        }
+    });
+}
+
+ConnectionRouter::Obstacles &ConnectionRouter::writableObstacles()
+{
+    if (_obstacles.use_count() > 1)
+        _obstacles = std::make_shared<Obstacles>(*_obstacles);
+
+    return *_obstacles;
+}
+
+QRectF ConnectionRouter::nodeRect(NodeId const nodeId) const
+{
+    QPointF const position = _scene.graphModel().nodeData<QPointF>(nodeId, NodeRole::Position);
+
+    return QRectF(position, QSizeF(_scene.nodeGeometry().size(nodeId)));
+}
+
+void ConnectionRouter::schedule()
+{
+    if (_scheduled || _pendingChunks > 0)
+        return;
+
+    if (_changedNodes.empty() && _dirtyConnections.empty())
+        return;
+
+    _scheduled = true;
+
+    QTimer::singleShot(0, this, [this]() {
+        _scheduled = false;
+        startRound();
+    });
+}
+
+void ConnectionRouter::startRound()
+{
+    AbstractGraphModel &model = _scene.graphModel();
+
+    for (NodeId const nodeId : _changedNodes) {
+        QRectF const *previous = _obstacles->rect(nodeId);
+
+        if (previous)
+            markCorridor(*previous);
+
+        if (!model.nodeExists(nodeId)) {
+            if (previous)
+                writableObstacles().remove(nodeId);
+
+            continue;
+        }
+
+        QRectF const rect = nodeRect(nodeId);
+
+        if (!previous || *previous != rect) {
+            writableObstacles().insert(nodeId, rect);
+            markCorridor(rect);
+        }
+
+        model.forEachNodeConnection(nodeId, [this](ConnectionId const &connectionId) {
+            _dirtyConnections.insert(connectionId);
+        });
+    }
+
+    _changedNodes.clear();
+
+    std::vector<Request> requests;
+    requests.reserve(_dirtyConnections.size());
+
+    for (ConnectionId const &connectionId : _dirtyConnections) {
+        if (!model.connectionExists(connectionId))
+            continue;
+
+        requests.push_back(Request{connectionId,
+                                   portPosition(connectionId, PortType::Out),
+                                   portPosition(connectionId, PortType::In)});
+    }
+
+    _dirtyConnections.clear();
+
+    if (requests.empty())
+        return;
+
+    std::size_t const threads = static_cast<std::size_t>(std::max(1, QThread::idealThreadCount()));
+    std::size_t const chunks = std::min(threads, (requests.size() + MinChunk - 1) / MinChunk);
+    std::size_t const chunkSize = (requests.size() + chunks - 1) / chunks;
+
+    std::shared_ptr<Obstacles const> const obstacles = _obstacles;
+    Qt::Orientation const orientation = _scene.orientation();
+    std::uint64_t const generation = _generation;
+
+    for (std::size_t begin = 0; begin < requests.size(); begin += chunkSize) {
+        std::size_t const end = std::min(requests.size(), begin + chunkSize);
+
+        std::vector<Request> chunk(std::make_move_iterator(requests.begin() + begin),
+                                   std::make_move_iterator(requests.begin() + end));
+
+        ++_pendingChunks;
+
+        _pool.start(new RouteTask(
+            obstacles,
+            std::move(chunk),
+            orientation,
+            _roundToken,
+            [this, generation](RouteTask::Results found) {
+                std::vector<Result> results;
+                results.reserve(found.size());
+
+                for (auto &entry : found) {
+                    Request const &request = entry.first;
+
+                    results.push_back(
+                        Result{request.connectionId,
+                               Route{request.out, request.in, std::move(entry.second), {}}});
+                }
+
+                QMetaObject::invokeMethod(
+                    this,
+                    [this, generation, results]() { onResults(generation, results); },
+                    Qt::QueuedConnection);
+            }));
+    }
+}
+
+void ConnectionRouter::onResults(std::uint64_t const generation, std::vector<Result> const &results)
+{
+    if (generation != _generation)
+        return;
+
+    --_pendingChunks;
+
+    AbstractGraphModel &model = _scene.graphModel();
+
+    for (Result const &result : results) {
+        // Deleted while it was routed.
+        if (!model.connectionExists(result.connectionId))
+            continue;
+
+        setRoute(result.connectionId, result.route);
+    }
+
+    Q_EMIT routesUpdated();
+
+    schedule();
+}
+
+QPointF ConnectionRouter::portPosition(ConnectionId const &connectionId,
+                                       PortType const portType) const
+{
+    NodeId const nodeId = getNodeId(portType, connectionId);
+
+    QPointF const position = _scene.graphModel().nodeData<QPointF>(nodeId, NodeRole::Position);
+
+    return _scene.nodeGeometry().portScenePosition(nodeId,
+                                                   portType,
+                                                   getPortIndex(portType, connectionId),
+                                                   QTransform::fromTranslate(position.x(),
+                                                                             position.y()));
+}
+
+void ConnectionRouter::setRoute(ConnectionId const &connectionId, Route route)
+{
+    if (route.points.size() < 2) {
+        if (_routes.erase(connectionId) == 0)
+            return;
+
+        _routeIndex.remove(connectionId);
+    } else {
+        route.path = makePath(route.points, _style);
+
+        // Straight routes have no area; the index needs some to find them.
+        _routeIndex.insert(connectionId, route.path.controlPointRect().adjusted(-1, -1, 1, 1));
+
+        _routes[connectionId] = std::move(route);
+    }
+
+    if (auto cgo = _scene.connectionGraphicsObject(connectionId))
+        cgo->updateRoute();
+}
+
+} // namespace QtNodes
@@ -1,5 +1,6 @@
 #include "ConnectionStyle.hpp"
 
+#include "NodeDataTypeRegistry.hpp"
 #include "StyleCollection.hpp"
 
 #include <QtCore/QJsonArray>
@@ -8,8 +9,6 @@
 
 #include <QDebug>
 
-#include <random>
-
 using QtNodes::ConnectionStyle;
 
 inline void initResources()
@@ -18,19 +17,37 @@ inline void initResources()
 }
 
 ConnectionStyle::ConnectionStyle()
+    : ConnectionStyle(defaultStyle())
+{}
+
+ConnectionStyle::ConnectionStyle(QString jsonText)
+    : ConnectionStyle(defaultStyle())
 {
-    // Explicit resources inialization for preventing the static initialization
-    // order fiasco: https://isocpp.org/wiki/faq/ctors#static-init-order
-    initResources();
+    loadJsonText(jsonText);
+}
 
-    // This configuration is stored inside the compiled unit and is loaded statically
-    loadJsonFile(":DefaultStyle.json");
+ConnectionStyle::ConnectionStyle(QJsonObject const &json)
+{
+    loadJson(json);
 }
 
-ConnectionStyle::ConnectionStyle(QString jsonText)
+ConnectionStyle const &ConnectionStyle::defaultStyle()
 {
-    loadJsonFile(":DefaultStyle.json");
-    loadJsonText(jsonText);
+    static ConnectionStyle const style = []() {
+        // Explicit resources inialization for preventing the static initialization
+        // order fiasco: https://isocpp.org/wiki/faq/ctors#static-init-order
+        initResources();
+
+        // This configuration is stored inside the compiled unit and is loaded statically
+        QFile file(":DefaultStyle.json");
+
+        if (!file.open(QIODevice::ReadOnly))
+            qWarning() << "Couldn't open file " << file.fileName();
+
+        return ConnectionStyle(QJsonDocument::fromJson(file.readAll()).object());
+    }();
+
+    return style;
 }
 
 void ConnectionStyle::setConnectionStyle(QString jsonText)
@@ -119,6 +136,10 @@ void ConnectionStyle::loadJson(QJsonObject const &json)
     CONNECTION_STYLE_READ_FLOAT(obj, ConstructionLineWidth);
     CONNECTION_STYLE_READ_FLOAT(obj, PointDiameter);
 
+    CONNECTION_STYLE_READ_FLOAT(obj, DetailsLevelOfDetail);
+    CONNECTION_STYLE_READ_FLOAT(obj, PolylineLevelOfDetail);
+    CONNECTION_STYLE_READ_FLOAT(obj, StraightLevelOfDetail);
+
     CONNECTION_STYLE_READ_BOOL(obj, UseDataDefinedColors);
 }
 
@@ -136,6 +157,10 @@ QJsonObject ConnectionStyle::toJson() const
     CONNECTION_STYLE_WRITE_FLOAT(obj, ConstructionLineWidth);
     CONNECTION_STYLE_WRITE_FLOAT(obj, PointDiameter);
 
+    CONNECTION_STYLE_WRITE_FLOAT(obj, DetailsLevelOfDetail);
+    CONNECTION_STYLE_WRITE_FLOAT(obj, PolylineLevelOfDetail);
+    CONNECTION_STYLE_WRITE_FLOAT(obj, StraightLevelOfDetail);
+
     CONNECTION_STYLE_WRITE_BOOL(obj, UseDataDefinedColors);
 
     QJsonObject root;
@@ -156,17 +181,12 @@ QColor ConnectionStyle::normalColor() const
 
 QColor ConnectionStyle::normalColor(QString typeId) const
 {
-    std::size_t hash = qHash(typeId);
-
-    std::size_t const hue_range = 0xFF;
-
-    std::mt19937 gen(static_cast<unsigned int>(hash));
-    std::uniform_int_distribution<int> distrib(0, hue_range);
-
-    int hue = distrib(gen);
-    int sat = 120 + hash % 129;
+    return normalColor(NodeDataTypeRegistry::intern(typeId));
+}
 
-    return QColor::fromHsl(hue, sat, 160);
+QColor ConnectionStyle::normalColor(NodeDataTypeId typeId) const
+{
+    return NodeDataTypeRegistry::color(typeId);
 }
 
 QColor ConnectionStyle::selectedColor() const
@@ -199,6 +219,21 @@ float ConnectionStyle::pointDiameter() const
     return PointDiameter;
 }
 
+float ConnectionStyle::detailsLevelOfDetail() const
+{
+    return DetailsLevelOfDetail;
+}
+
+float ConnectionStyle::polylineLevelOfDetail() const
+{
+    return PolylineLevelOfDetail;
+}
+
+float ConnectionStyle::straightLevelOfDetail() const
+{
+    return StraightLevelOfDetail;
+}
+
 bool ConnectionStyle::useDataDefinedColors() const
 {
     return UseDataDefinedColors;
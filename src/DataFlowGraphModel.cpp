@@ -1,532 +1,3686 @@
 #include "DataFlowGraphModel.hpp"
 #include "ConnectionIdHash.hpp"
+#include "NodeDataCodec.hpp"
+#include "PropagationTracer.hpp"
+#include "SceneJson.hpp"
+#include "WorkStealingExecutor.hpp"
 
 #include <QJsonArray>
-
+#include <QtCore/QDataStream>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QRunnable>
+#include <QtCore/QTimer>
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <limits>
 #include <stdexcept>
+#include <unordered_map>
 
 namespace QtNodes {
 
+namespace {
+
+/// "QNFB", first bytes of a binary scene.
+constexpr quint32 BinarySceneMagic = 0x514E4642;
+
+/// 1: internal data only. 2: the model name precedes the internal data.
+constexpr quint16 BinarySceneVersion = 2;
+
+/// Room for `extra` more elements; repeated hints keep the growth geometric.
+template<typename Vector>
+void reserveMore(Vector &vector, std::size_t const extra)
+{
+    std::size_t const needed = vector.size() + extra;
+
+    if (needed > vector.capacity())
+        vector.reserve(std::max(needed, 2 * vector.capacity()));
+}
+
+/// The data as the input receives it; empty data passes unconverted.
+std::shared_ptr<NodeData> convert(NodeDelegateModelRegistry::TypeConverter const *converter,
+                                  std::shared_ptr<NodeData> const &data)
+{
+    if (!converter || !data)
+        return data;
+
+    return (*converter)(data);
+}
+
+/// Runs a compute job and hands its results to `done`, still on the worker.
+class ComputeTask : public QRunnable
+{
+public:
+    using Done = std::function<void(NodeDelegateModel::ComputeResults)>;
+
+    ComputeTask(NodeDelegateModel::ComputeJob job, CancellationToken token, Done done)
+        : _job(std::move(job))
+        , _token(std::move(token))
+        , _done(std::move(done))
+    {}
+
+    void run() override
+    {
+        NodeDelegateModel::ComputeResults results;
+
+        // Jobs superseded while queued are not started at all.
+        if (!_token.isCancelled()) {
+            try {
+                results = _job(_token);
+            } catch (...) {
+                // A failed job delivers no outputs; the node only leaves its busy state.
+            }
+        }
+
+        _done(std::move(results));
+    }
+
+private:
+    NodeDelegateModel::ComputeJob _job;
+    CancellationToken _token;
+    Done _done;
+};
+
+unsigned int portCount(NodeDelegateModel const &delegate, PortType const portType)
+{
+    if (PortTable const *table = delegate.portTable())
+        return static_cast<unsigned int>(table->ports(portType).size());
+
+    return delegate.nPorts(portType);
+}
+
+/// The port in the static table of the delegate, `nullptr` without one.
+PortSpec const *staticPortSpec(NodeDelegateModel const &delegate,
+                               PortType const portType,
+                               PortIndex const portIndex)
+{
+    PortTable const *table = delegate.portTable();
+    if (!table || portType == PortType::None)
+        return nullptr;
+
+    std::vector<PortSpec> const &ports = table->ports(portType);
+
+    return portIndex < ports.size() ? &ports[portIndex] : nullptr;
+}
+
+/// Merges the tasks of every evaluation unit into one task.
+/**
+ * `nodeIds[i]` is the node of `tasks[i]`, in propagation order. Returns
+ * nothing if no unit has two tasks or if merging would close a cycle.
+ */
+std::vector<WorkStealingExecutor::Task> mergeEvaluationUnits(
+    std::vector<NodeId> const &nodeIds,
+    std::vector<WorkStealingExecutor::Task> &tasks,
+    std::unordered_map<NodeId, NodeId> const &units)
+{
+    std::vector<std::size_t> mergedOf(tasks.size());
+    std::vector<std::vector<std::size_t>> members;
+    std::unordered_map<NodeId, std::size_t> unitTask;
+
+    for (std::size_t i = 0; i < tasks.size(); ++i) {
+        auto unit = units.find(nodeIds[i]);
+
+        if (unit == units.end()) {
+            mergedOf[i] = members.size();
+            members.emplace_back(1, i);
+            continue;
+        }
+
+        auto it = unitTask.emplace(unit->second, members.size()).first;
+        if (it->second == members.size())
+            members.emplace_back();
+
+        mergedOf[i] = it->second;
+        members[it->second].push_back(i);
+    }
+
+    if (members.size() == tasks.size())
+        return {};
+
+    std::vector<WorkStealingExecutor::Task> merged(members.size());
+
+    for (std::size_t m = 0; m < members.size(); ++m) {
+        for (std::size_t const i : members[m]) {
+            merged[m].mainThreadOnly = merged[m].mainThreadOnly || tasks[i].mainThreadOnly;
+
+            for (std::size_t const successor : tasks[i].successors) {
+                std::size_t const target = mergedOf[successor];
+                if (target == m)
+                    continue;
+
+                merged[m].successors.push_back(target);
+                ++merged[target].dependencies;
+            }
+        }
+
+        // Members come in propagation order, which orders them among themselves.
+        merged[m].run = [&tasks, indices = members[m]]() {
+            for (std::size_t const i : indices) {
+                tasks[i].run();
+            }
+        };
+    }
+
+    // A path leaving a unit and coming back makes the merged graph cyclic.
+    std::vector<unsigned int> dependencies(merged.size());
+    std::vector<std::size_t> ready;
+
+    for (std::size_t m = 0; m < merged.size(); ++m) {
+        dependencies[m] = merged[m].dependencies;
+        if (dependencies[m] == 0)
+            ready.push_back(m);
+    }
+
+    std::size_t visited = 0;
+
+    while (!ready.empty()) {
+        std::size_t const m = ready.back();
+        ready.pop_back();
+        ++visited;
+
+        for (std::size_t const target : merged[m].successors) {
+            if (--dependencies[target] == 0)
+                ready.push_back(target);
+        }
+    }
+
+    if (visited != merged.size())
+        return {};
+
+    return merged;
+}
+
+} // namespace
+
 DataFlowGraphModel::DataFlowGraphModel(std::shared_ptr<NodeDelegateModelRegistry> registry)
     : _registry(std::move(registry))
     , _nextNodeId{0}
-{}
+    , _captionIndexEnabled(false)
+    , _nextTopologicalRank(0)
+    , _topologyRevision(1)
+    , _propagationMode(PropagationMode::Immediate)
+    , _propagationScheduled(false)
+    , _propagating(false)
+    , _propagationBudget(0)
+    , _bulkLoading(false)
+    , _computeDrainScheduled(false)
+    , _delegatePoolCapacity(64)
+    , _parallelEvaluation(false)
+    , _parallelSerialization(false)
+    , _lazyInternalData(false)
+    , _saveNodeSizes(false)
+    , _incrementalSave(false)
+    , _compactJson(false)
+    , _savedConnectionsRevision(0)
+    , _parallelPass(false)
+    , _tracer(nullptr)
+    , _nodeStatisticsEnabled(false)
+    , _nestedEvaluationTime(0)
+    , _releaseIntermediateData(false)
+    , _intermediateMemoryBudget(0)
+    , _spillThreshold(-1.0)
+    , _deliveryDepth(0)
+    , _retainedBytes(0)
+    , _restoringData(0)
+{
+    // Delegates may have changed their caption with any of these.
+    auto const refreshCaption = [this](NodeId const nodeId) { updateCaptionIndex(nodeId); };
 
-std::unordered_set<NodeId> DataFlowGraphModel::allNodeIds() const
+    connect(this, &AbstractGraphModel::nodeCreated, this, refreshCaption);
+    connect(this, &AbstractGraphModel::nodeUpdated, this, refreshCaption);
+    connect(this, &DataFlowGraphModel::nodeInternalDataChanged, this, refreshCaption);
+
+    auto const invalidateSaved = [this](NodeId const nodeId) { invalidateSavedNode(nodeId); };
+
+    connect(this, &AbstractGraphModel::nodeUpdated, this, invalidateSaved);
+    connect(this, &DataFlowGraphModel::nodeInternalDataChanged, this, invalidateSaved);
+}
+
+DataFlowGraphModel::~DataFlowGraphModel()
 {
-    std::unordered_set<NodeId> nodeIds;
-    for_each(_models.begin(), _models.end(), [&nodeIds](auto const &p) { nodeIds.insert(p.first); });
+    for (auto const &record : _nodes) {
+        record.computeToken.cancel();
+    }
 
-    return nodeIds;
+    // Finished jobs post their results to `this`; none may outlive it.
+    _computePool.waitForDone();
 }
 
-std::unordered_set<ConnectionId> DataFlowGraphModel::allConnectionIds(NodeId const nodeId) const
+void DataFlowGraphModel::setPropagationMode(PropagationMode const mode)
 {
-    std::unordered_set<ConnectionId> result;
+    if (_propagationMode == mode)
+        return;
 
-    std::copy_if(_connectivity.begin(),
-                 _connectivity.end(),
-                 std::inserter(result, std::end(result)),
-                 [&nodeId](ConnectionId const &cid) {
-                     return cid.inNodeId == nodeId || cid.outNodeId == nodeId;
-                 });
+    _propagationMode = mode;
 
-    return result;
+    if (_propagationMode == PropagationMode::Immediate)
+        processPendingPropagation();
 }
 
-std::unordered_set<ConnectionId> DataFlowGraphModel::connections(NodeId nodeId,
-                                                                 PortType portType,
-                                                                 PortIndex portIndex) const
+void DataFlowGraphModel::processPendingPropagation()
 {
-    std::unordered_set<ConnectionId> result;
+    flushPropagation(0);
+}
+
+void DataFlowGraphModel::flushPropagation(int const budget)
+{
+    _propagationScheduled = false;
 
-    std::copy_if(_connectivity.begin(),
-                 _connectivity.end(),
-                 std::inserter(result, std::end(result)),
-                 [&portType, &portIndex, &nodeId](ConnectionId const &cid) {
-                     return (getNodeId(portType, cid) == nodeId
-                             && getPortIndex(portType, cid) == portIndex);
-                 });
+    // Updates raised while flushing are picked up by the running loop.
+    if (_propagating || _dirtyOutPorts.empty())
+        return;
 
-    return result;
+    _propagating = true;
+
+    PropagationTracer::Span span(_tracer, "flush");
+
+    std::size_t delivered = 0;
+    std::size_t remaining = 0;
+
+    if (_parallelEvaluation) {
+        propagateInParallel(propagationOrder());
+    } else {
+        std::vector<NodeId> const order = propagationOrder();
+
+        QElapsedTimer clock;
+        clock.start();
+
+        for (std::size_t i = 0; i < order.size(); ++i) {
+            // The rest stays dirty; the next slice orders it anew.
+            if (budget > 0 && delivered > 0 && clock.elapsed() >= budget) {
+                remaining = order.size() - i;
+                break;
+            }
+
+            auto it = _dirtyOutPorts.find(order[i]);
+
+            if (it == _dirtyOutPorts.end())
+                continue;
+
+            std::unordered_set<PortIndex> const ports = std::move(it->second);
+            _dirtyOutPorts.erase(it);
+
+            // The node counts as delivered once all of its ports are.
+            ++_deliveryDepth;
+
+            for (PortIndex const portIndex : ports) {
+                deliverOutPortData(order[i], portIndex);
+            }
+
+            --_deliveryDepth;
+
+            retainDeliveredNodes();
+
+            ++delivered;
+        }
+    }
+
+    _propagating = false;
+
+    if (budget > 0)
+        Q_EMIT propagationProgress(delivered, remaining);
+
+    // Ports dirtied again after their node was processed, e.g. by cycles.
+    if (!_dirtyOutPorts.empty())
+        schedulePropagation();
+}
+
+void DataFlowGraphModel::setPriorityNodes(std::unordered_set<NodeId> nodeIds)
+{
+    _priorityNodes = std::move(nodeIds);
+}
+
+void DataFlowGraphModel::setNodeStatisticsEnabled(bool const enabled)
+{
+    if (_nodeStatisticsEnabled == enabled)
+        return;
+
+    _nodeStatisticsEnabled = enabled;
+
+    resetNodeStatistics();
+
+    if (enabled)
+        _statisticsClock.start();
+
+    // The heat map of the scene follows `NodeRole::ComputeTime`.
+    for (auto const &record : _nodes) {
+        Q_EMIT nodeUpdated(record.id);
+    }
+}
+
+DataFlowGraphModel::NodeStatistics DataFlowGraphModel::nodeStatistics(NodeId const nodeId) const
+{
+    NodeRecord const *record = peekNode(nodeId);
+
+    if (!record || !_nodeStatisticsEnabled)
+        return NodeStatistics();
+
+    return record->statistics;
+}
+
+void DataFlowGraphModel::resetNodeStatistics()
+{
+    for (auto &record : _nodes) {
+        record.statistics = NodeStatistics();
+        record.lastEvaluation = -1;
+    }
+}
+
+void DataFlowGraphModel::recordEvaluation(NodeRecord &record,
+                                          std::int64_t const start,
+                                          std::int64_t const duration)
+{
+    // Roughly the last ten samples make up an average; the first one starts it.
+    auto const average = [](double const current, double const sample, bool const first) {
+        return first ? sample : current + 0.2 * (sample - current);
+    };
+
+    NodeStatistics &statistics = record.statistics;
+
+    statistics.lastMilliseconds = duration / 1e6;
+    statistics.averageMilliseconds = average(statistics.averageMilliseconds,
+                                             statistics.lastMilliseconds,
+                                             statistics.evaluations == 0);
+
+    if (record.lastEvaluation >= 0 && start > record.lastEvaluation) {
+        statistics.evaluationsPerSecond = average(statistics.evaluationsPerSecond,
+                                                  1e9 / (start - record.lastEvaluation),
+                                                  statistics.evaluations == 1);
+    }
+
+    record.lastEvaluation = start;
+
+    ++statistics.evaluations;
+}
+
+void DataFlowGraphModel::schedulePropagation()
+{
+    if (_propagationScheduled)
+        return;
+
+    _propagationScheduled = true;
+
+    QTimer::singleShot(0, this, [this]() { flushPropagation(_propagationBudget); });
+}
+
+void DataFlowGraphModel::propagateInParallel(std::vector<NodeId> const &order)
+{
+    struct Input
+    {
+        std::size_t source;
+        PortIndex outPortIndex;
+        PortIndex inPortIndex;
+        NodeDelegateModelRegistry::TypeConverter const *converter;
+    };
+
+    // Everything a task touches is resolved here, on the calling thread.
+    struct Slot
+    {
+        NodeId nodeId;
+        NodeRecord *record;
+        NodeDelegateModel *delegate;
+        std::vector<Input> inputs;
+        std::vector<std::pair<PortIndex, std::shared_ptr<NodeData>>> outputs;
+        std::vector<PortIndex> receivedPorts;
+        std::int64_t start;
+        std::int64_t duration;
+    };
+
+    std::unordered_map<NodeId, std::size_t> position;
+    std::vector<Slot> slots;
+    slots.reserve(order.size());
+
+    for (NodeId const nodeId : order) {
+        NodeRecord *record = findNode(nodeId);
+        if (!record)
+            continue;
+
+        // Tasks only see the inputs of the flush; a released node needs all of them.
+        if (record->released)
+            refeedInputs(*record, InvalidPortIndex);
+
+        if (!_spills.empty())
+            _spills.erase(nodeId);
+
+        // Tasks do not touch the saved JSON; any node of the flush may change.
+        invalidateSavedNode(nodeId);
+
+        position[nodeId] = slots.size();
+        slots.push_back(Slot{nodeId, record, record->model.get(), {}, {}, {}, 0, 0});
+    }
+
+    std::vector<WorkStealingExecutor::Task> tasks(slots.size());
+
+    // Connections against the order close cycles; they are left for the next flush.
+    std::vector<ConnectionId> backEdges;
+
+    for (std::size_t i = 0; i < slots.size(); ++i) {
+        forEachNodeConnection(slots[i].nodeId, [&](ConnectionId const &cid) {
+            if (cid.outNodeId != slots[i].nodeId)
+                return;
+
+            auto it = position.find(cid.inNodeId);
+            if (it == position.end())
+                return;
+
+            std::size_t const target = it->second;
+
+            if (target <= i) {
+                backEdges.push_back(cid);
+                return;
+            }
+
+            tasks[i].successors.push_back(target);
+            ++tasks[target].dependencies;
+            slots[target].inputs.push_back(
+                Input{i, cid.outPortIndex, cid.inPortIndex, connectionConverter(cid)});
+        });
+    }
+
+    for (std::size_t i = 0; i < slots.size(); ++i) {
+        tasks[i].mainThreadOnly = !slots[i].delegate->threadSafe();
+
+        tasks[i].run = [this, &slots, i]() {
+            Slot &slot = slots[i];
+
+            if (_nodeStatisticsEnabled)
+                slot.start = _statisticsClock.nsecsElapsed();
+
+            for (Input const &input : slot.inputs) {
+                for (auto const &output : slots[input.source].outputs) {
+                    if (output.first != input.outPortIndex)
+                        continue;
+
+                    invalidateOutData(slot.nodeId);
+
+                    std::shared_ptr<NodeData> const data = convert(input.converter,
+                                                                   output.second);
+
+                    // Before the call, which may request a compute on this thread.
+                    if (slot.delegate->deterministic())
+                        updateInputHash(*slot.record, input.inPortIndex, data);
+
+                    PropagationTracer::Span span(_tracer,
+                                                 "setInData",
+                                                 slot.nodeId,
+                                                 slot.delegate,
+                                                 PortType::In,
+                                                 input.inPortIndex);
+
+                    NodeDelegateProfiler::Scope profile(slot.delegate,
+                                                        NodeDelegateProfiler::Call::SetInData,
+                                                        input.inPortIndex);
+
+                    slot.delegate->setInData(data, input.inPortIndex);
+                    slot.receivedPorts.push_back(input.inPortIndex);
+                }
+            }
+
+            if (_nodeStatisticsEnabled)
+                slot.duration = _statisticsClock.nsecsElapsed() - slot.start;
+
+            // Source ports plus whatever the inputs above made dirty.
+            std::vector<PortIndex> dirtyPorts;
+            {
+                std::lock_guard<std::mutex> lock(_dirtyMutex);
+
+                auto it = _dirtyOutPorts.find(slot.nodeId);
+                if (it != _dirtyOutPorts.end())
+                    dirtyPorts.assign(it->second.begin(), it->second.end());
+            }
+
+            for (PortIndex const portIndex : dirtyPorts) {
+                slot.outputs.emplace_back(portIndex, cachedOutData(*slot.record, portIndex));
+            }
+        };
+    }
+
+    if (!_executor)
+        _executor = std::make_unique<WorkStealingExecutor>();
+
+    std::vector<NodeId> nodeIds;
+    std::vector<WorkStealingExecutor::Task> merged;
+
+    if (!_evaluationUnits.empty()) {
+        nodeIds.reserve(slots.size());
+
+        for (Slot const &slot : slots) {
+            nodeIds.push_back(slot.nodeId);
+        }
+
+        merged = mergeEvaluationUnits(nodeIds, tasks, _evaluationUnits);
+    }
+
+    _parallelPass = true;
+
+    try {
+        _executor->run(merged.empty() ? tasks : merged);
+    } catch (...) {
+        _parallelPass = false;
+        throw;
+    }
+
+    _parallelPass = false;
+
+    std::unordered_set<NodeId> keepDirty;
+
+    for (auto const &cid : backEdges) {
+        auto it = _dirtyOutPorts.find(cid.outNodeId);
+        if (it != _dirtyOutPorts.end() && it->second.count(cid.outPortIndex) > 0)
+            keepDirty.insert(cid.outNodeId);
+    }
+
+    for (Slot const &slot : slots) {
+        if (keepDirty.count(slot.nodeId) == 0)
+            _dirtyOutPorts.erase(slot.nodeId);
+    }
+
+    if (_nodeStatisticsEnabled) {
+        for (Slot const &slot : slots) {
+            if (slot.receivedPorts.empty())
+                continue;
+
+            if (NodeRecord *record = peekNode(slot.nodeId))
+                recordEvaluation(*record, slot.start, slot.duration);
+        }
+    }
+
+    // Repaints are requested on the model thread once everything is done.
+    for (Slot const &slot : slots) {
+        for (PortIndex const portIndex : slot.receivedPorts) {
+            Q_EMIT inPortDataWasSet(slot.nodeId, PortType::In, portIndex);
+        }
+    }
+
+    if (_releaseIntermediateData) {
+        for (Slot const &slot : slots) {
+            if (!slot.outputs.empty())
+                _deliveredNodes.push_back(slot.nodeId);
+        }
+
+        retainDeliveredNodes();
+    }
+}
+
+DataFlowGraphModel::ExecutionPlan const &DataFlowGraphModel::executionPlan() const
+{
+    if (_plan.revision == _topologyRevision && _plan.registryRevision == _registry->revision())
+        return _plan;
+
+    ExecutionPlan &plan = _plan;
+    std::size_t const n = _nodes.size();
+
+    // Out connections per node position; the only hash lookups of the build.
+    std::vector<std::vector<ConnectionId>> outConnections(n);
+    std::vector<unsigned int> inDegree(n, 0);
+
+    for (auto const &cid : _connectivity) {
+        auto out = _nodeIndex.find(cid.outNodeId);
+        auto in = _nodeIndex.find(cid.inNodeId);
+        if (out == _nodeIndex.end() || in == _nodeIndex.end())
+            continue;
+
+        outConnections[out->second].push_back(cid);
+        ++inDegree[in->second];
+    }
+
+    // Kahn's algorithm over node positions.
+    std::vector<std::size_t> sorted;
+    sorted.reserve(n);
+
+    for (std::size_t i = 0; i < n; ++i) {
+        if (inDegree[i] == 0)
+            sorted.push_back(i);
+    }
+
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+        for (auto const &cid : outConnections[sorted[i]]) {
+            std::size_t const target = _nodeIndex.find(cid.inNodeId)->second;
+
+            if (--inDegree[target] == 0)
+                sorted.push_back(target);
+        }
+    }
+
+    // Nodes on cycles never reach zero, they are appended in arbitrary order.
+    if (sorted.size() < n) {
+        for (std::size_t i = 0; i < n; ++i) {
+            if (inDegree[i] > 0)
+                sorted.push_back(i);
+        }
+    }
+
+    plan.order.clear();
+    plan.order.reserve(n);
+
+    for (std::size_t slot = 0; slot < n; ++slot) {
+        NodeRecord const &record = _nodes[sorted[slot]];
+        record.planSlot = slot;
+        plan.order.push_back(record.id);
+    }
+
+    plan.fanoutBegin.assign(1, 0);
+    plan.fanouts.clear();
+    plan.targets.clear();
+
+    std::vector<std::vector<ExecutionPlan::Input>> inputsPerSlot(n);
+
+    for (std::size_t slot = 0; slot < n; ++slot) {
+        auto &connections = outConnections[sorted[slot]];
+
+        std::sort(connections.begin(), connections.end(), [](auto const &l, auto const &r) {
+            return l.outPortIndex < r.outPortIndex;
+        });
+
+        for (auto const &cid : connections) {
+            if (plan.fanouts.size() == plan.fanoutBegin.back()
+                || plan.fanouts.back().outPortIndex != cid.outPortIndex) {
+                std::size_t const begin = plan.targets.size();
+                plan.fanouts.push_back(ExecutionPlan::Fanout{cid.outPortIndex, begin, begin});
+            }
+
+            std::size_t const nodeIndex = _nodeIndex.find(cid.inNodeId)->second;
+            std::size_t const targetSlot = _nodes[nodeIndex].planSlot;
+
+            plan.targets.push_back(ExecutionPlan::Target{cid.inNodeId,
+                                                         targetSlot,
+                                                         nodeIndex,
+                                                         cid.inPortIndex,
+                                                         connectionConverter(cid)});
+            plan.fanouts.back().targetsEnd = plan.targets.size();
+
+            inputsPerSlot[targetSlot].push_back(
+                ExecutionPlan::Input{slot, cid.outPortIndex, cid.inPortIndex});
+        }
+
+        plan.fanoutBegin.push_back(plan.fanouts.size());
+    }
+
+    plan.inputBegin.assign(1, 0);
+    plan.inputs.clear();
+
+    for (auto const &inputs : inputsPerSlot) {
+        plan.inputs.insert(plan.inputs.end(), inputs.begin(), inputs.end());
+        plan.inputBegin.push_back(plan.inputs.size());
+    }
+
+    plan.revision = _topologyRevision;
+    plan.registryRevision = _registry->revision();
+
+    return plan;
 }
 
-bool DataFlowGraphModel::connectionExists(ConnectionId const connectionId) const
-{
-    return (_connectivity.find(connectionId) != _connectivity.end());
-}
+std::vector<NodeId> DataFlowGraphModel::propagationOrder() const
+{
+    ExecutionPlan const &plan = executionPlan();
+
+    // Slots reachable from the dirty nodes.
+    std::vector<char> affected(plan.order.size(), 0);
+    std::vector<std::size_t> stack;
+
+    for (auto const &entry : _dirtyOutPorts) {
+        auto it = _nodeIndex.find(entry.first);
+        if (it != _nodeIndex.end())
+            stack.push_back(_nodes[it->second].planSlot);
+    }
+
+    while (!stack.empty()) {
+        std::size_t const slot = stack.back();
+        stack.pop_back();
+
+        if (affected[slot])
+            continue;
+
+        affected[slot] = 1;
+
+        for (std::size_t f = plan.fanoutBegin[slot]; f < plan.fanoutBegin[slot + 1]; ++f) {
+            ExecutionPlan::Fanout const &fanout = plan.fanouts[f];
+
+            for (std::size_t t = fanout.targetsBegin; t < fanout.targetsEnd; ++t) {
+                stack.push_back(plan.targets[t].slot);
+            }
+        }
+    }
+
+    // Slots are topologically sorted already.
+    std::vector<NodeId> order;
+
+    if (_priorityNodes.empty()) {
+        for (std::size_t slot = 0; slot < plan.order.size(); ++slot) {
+            if (affected[slot])
+                order.push_back(plan.order[slot]);
+        }
+
+        return order;
+    }
+
+    // Everything a priority node depends on. Its inputs are all in the same
+    // part, so both parts may run in topological order one after the other.
+    std::vector<char> upstream(plan.order.size(), 0);
+
+    for (NodeId const nodeId : _priorityNodes) {
+        auto it = _nodeIndex.find(nodeId);
+        if (it != _nodeIndex.end())
+            stack.push_back(_nodes[it->second].planSlot);
+    }
+
+    while (!stack.empty()) {
+        std::size_t const slot = stack.back();
+        stack.pop_back();
+
+        if (upstream[slot])
+            continue;
+
+        upstream[slot] = 1;
+
+        for (std::size_t i = plan.inputBegin[slot]; i < plan.inputBegin[slot + 1]; ++i) {
+            stack.push_back(plan.inputs[i].sourceSlot);
+        }
+    }
+
+    for (bool const prioritized : {true, false}) {
+        for (std::size_t slot = 0; slot < plan.order.size(); ++slot) {
+            if (affected[slot] && (upstream[slot] != 0) == prioritized)
+                order.push_back(plan.order[slot]);
+        }
+    }
+
+    return order;
+}
+
+void DataFlowGraphModel::startCompute(NodeId const nodeId)
+{
+    NodeRecord *record = findNode(nodeId);
+    if (!record)
+        return;
+
+    NodeDelegateModel *delegate = record->model.get();
+
+    bool const memoize = delegate->deterministic() && _resultCache.capacity() > 0
+                         && std::find(record->unhashableInputs.begin(),
+                                      record->unhashableInputs.end(),
+                                      true)
+                                == record->unhashableInputs.end();
+
+    if (memoize) {
+        resizeInputHashes(*record, delegate->nPorts(PortType::In));
+
+        if (auto const *cached = _resultCache.find(nodeId, record->inputHashes)) {
+            // A job still running for older inputs is superseded as well.
+            record->computeToken.cancel();
+            record->computeToken = CancellationToken();
+            ++record->computeGeneration;
+            record->memoizeCompute = false;
+
+            // A copy: propagating downstream may evict the entry.
+            NodeDelegateModel::ComputeResults const results = *cached;
+
+            delegate->setComputeResults(results);
+
+            for (PortIndex portIndex = 0; portIndex < results.size(); ++portIndex) {
+                onOutPortDataUpdated(nodeId, portIndex);
+            }
+
+            return;
+        }
+    }
+
+    NodeDelegateModel::ComputeJob job = delegate->computeJob();
+    if (!job)
+        return;
+
+    // The job must not touch the delegate, so it reports under the name taken here.
+    if (NodeDelegateProfiler *profiler = delegate->profiler()) {
+        job = [job = std::move(job), profiler, name = delegate->name()](
+                  CancellationToken const &token) {
+            auto const start = std::chrono::steady_clock::now();
+
+            NodeDelegateModel::ComputeResults results = job(token);
+
+            auto const elapsed = std::chrono::steady_clock::now() - start;
+
+            profiler->record(name,
+                             NodeDelegateProfiler::Call::Compute,
+                             InvalidPortIndex,
+                             std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+
+            return results;
+        };
+    }
+
+    // The running job, if any, is obsolete now.
+    record->computeToken.cancel();
+    record->computeToken = CancellationToken();
+
+    std::uint64_t const generation = ++record->computeGeneration;
+
+    record->memoizeCompute = memoize;
+    if (memoize)
+        record->computeInputHashes = record->inputHashes;
+
+    if (_nodeStatisticsEnabled)
+        record->computeStart = _statisticsClock.nsecsElapsed();
+
+    if (record->computeJobs++ == 0) {
+        Q_EMIT record->model->computingStarted();
+        Q_EMIT nodeUpdated(nodeId);
+    }
+
+    _computePool.start(new ComputeTask(
+        std::move(job),
+        record->computeToken,
+        [this, nodeId, generation](NodeDelegateModel::ComputeResults results) {
+            postComputeResult(CompletedCompute{nodeId, generation, std::move(results)});
+        }));
+}
+
+void DataFlowGraphModel::postComputeResult(CompletedCompute completed)
+{
+    if (!_completedComputes.tryPush(std::move(completed))) {
+        std::lock_guard<std::mutex> lock(_computeOverflowMutex);
+
+        _computeOverflow.push_back(std::move(completed));
+    }
+
+    if (_computeDrainScheduled.exchange(true))
+        return;
+
+    QMetaObject::invokeMethod(this, [this]() { drainComputeResults(); }, Qt::QueuedConnection);
+}
+
+void DataFlowGraphModel::drainComputeResults()
+{
+    // Cleared before popping: a result pushed after the last pop posts anew.
+    _computeDrainScheduled.exchange(false);
+
+    std::vector<CompletedCompute> completed;
+
+    CompletedCompute next;
+
+    while (_completedComputes.tryPop(next)) {
+        completed.push_back(std::move(next));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_computeOverflowMutex);
+
+        std::move(_computeOverflow.begin(), _computeOverflow.end(), std::back_inserter(completed));
+        _computeOverflow.clear();
+    }
+
+    if (completed.empty())
+        return;
+
+    // The scene applies the node updates of all results at once.
+    GraphTransaction transaction(*this);
+
+    for (CompletedCompute const &entry : completed) {
+        onComputeFinished(entry.nodeId, entry.generation, entry.results);
+    }
+}
+
+void DataFlowGraphModel::onComputeFinished(NodeId const nodeId,
+                                           std::uint64_t const generation,
+                                           NodeDelegateModel::ComputeResults const &results)
+{
+    // The node may have been deleted while its job was running.
+    NodeRecord *record = findNode(nodeId);
+    if (!record)
+        return;
+
+    NodeDelegateModel *delegate = record->model.get();
+
+    if (record->computeJobs > 0)
+        --record->computeJobs;
+
+    bool const finished = (record->computeJobs == 0);
+    bool const stale = (generation != record->computeGeneration);
+
+    if (!stale) {
+        if (record->memoizeCompute && !results.empty()) {
+            _resultCache.insert(nodeId, std::move(record->computeInputHashes), results);
+            record->memoizeCompute = false;
+        }
+
+        delegate->setComputeResults(results);
+
+        if (_nodeStatisticsEnabled) {
+            std::int64_t const now = _statisticsClock.nsecsElapsed();
+
+            recordEvaluation(*record, record->computeStart, now - record->computeStart);
+        }
+    }
+
+    if (finished) {
+        Q_EMIT delegate->computingFinished();
+        Q_EMIT nodeUpdated(nodeId);
+    }
+
+    if (stale)
+        return;
+
+    for (PortIndex portIndex = 0; portIndex < results.size(); ++portIndex) {
+        onOutPortDataUpdated(nodeId, portIndex);
+    }
+}
+
+void DataFlowGraphModel::updateInputHash(NodeRecord &record,
+                                         PortIndex const portIndex,
+                                         std::shared_ptr<NodeData> const &data)
+{
+    resizeInputHashes(record, std::max<std::size_t>(portIndex + 1, record.inputHashes.size()));
+
+    bool const hashable = !data || data->hasContentHash();
+
+    record.unhashableInputs[portIndex] = !hashable;
+    record.inputHashes[portIndex] = !data ? ComputeResultCache::EmptyInputHash
+                                   : hashable ? data->contentHash()
+                                              : 0;
+}
+
+void DataFlowGraphModel::resizeInputHashes(NodeRecord &record, std::size_t const size)
+{
+    if (record.inputHashes.size() >= size)
+        return;
+
+    record.inputHashes.resize(size, ComputeResultCache::EmptyInputHash);
+    record.unhashableInputs.resize(size, false);
+}
+
+void DataFlowGraphModel::resetResultCache(NodeId const nodeId)
+{
+    _resultCache.removeNode(nodeId);
+
+    NodeRecord *record = peekNode(nodeId);
+    if (!record)
+        return;
+
+    // Shifted ports count as unknown until they receive data again.
+    record->inputHashes.clear();
+    record->unhashableInputs.assign(record->model->nPorts(PortType::In), true);
+    record->inputHashes.resize(record->unhashableInputs.size(), 0);
+}
+
+void DataFlowGraphModel::setResultCacheCapacity(std::size_t const capacity)
+{
+    _resultCache.setCapacity(capacity);
+}
+
+std::shared_ptr<NodeData> DataFlowGraphModel::cachedOutData(NodeRecord const &record,
+                                                            PortIndex const portIndex) const
+{
+    if (record.released
+        && (portIndex >= record.outDataCache.size() || !record.outDataCache[portIndex].valid))
+        restoreReleasedData(record);
+
+    if (portIndex >= record.outDataCache.size())
+        record.outDataCache.resize(portIndex + 1);
+
+    OutDataCacheEntry &entry = record.outDataCache[portIndex];
+
+    if (!entry.valid) {
+        NodeDelegateProfiler::Scope profile(record.model.get(),
+                                            NodeDelegateProfiler::Call::OutData,
+                                            portIndex);
+
+        entry.data = record.model->outData(portIndex);
+        entry.valid = true;
+    }
+
+    return entry.data;
+}
+
+void DataFlowGraphModel::invalidateOutData(NodeId const nodeId, PortIndex const portIndex)
+{
+    NodeRecord const *record = peekNode(nodeId);
+    if (!record)
+        return;
+
+    if (portIndex == InvalidPortIndex) {
+        record->outDataCache.clear();
+    } else if (portIndex < record->outDataCache.size()) {
+        record->outDataCache[portIndex] = OutDataCacheEntry();
+    }
+}
+
+void DataFlowGraphModel::setReleaseIntermediateData(bool const enabled)
+{
+    _releaseIntermediateData = enabled;
+
+    // Released nodes stay released until they are needed.
+    if (!enabled) {
+        _deliveredNodes.clear();
+        _retainedOrder.clear();
+        _retainedNodes.clear();
+        _retainedBytes = 0;
+    }
+}
+
+void DataFlowGraphModel::setIntermediateMemoryBudget(std::size_t const bytes)
+{
+    _intermediateMemoryBudget = bytes;
+
+    releaseOverBudget();
+}
+
+void DataFlowGraphModel::restoreReleasedData(NodeRecord const &record) const
+{
+    if (!loadSpill(record))
+        refeedInputs(record, InvalidPortIndex);
+}
+
+void DataFlowGraphModel::refeedInputs(NodeRecord const &record, PortIndex const except) const
+{
+    NodeId const nodeId = record.id;
+
+    // Cleared first, a cycle back to the node ends here.
+    record.released = false;
+
+    ++_restoringData;
+
+    std::vector<std::pair<PortIndex, std::shared_ptr<NodeData>>> inputs;
+
+    auto it = _nodeConnections.find(nodeId);
+
+    if (it != _nodeConnections.end()) {
+        for (ConnectionId const &cid : it->second) {
+            if (cid.inNodeId != nodeId || cid.inPortIndex == except)
+                continue;
+
+            NodeRecord const *source = findNode(cid.outNodeId);
+            if (!source)
+                continue;
+
+            inputs.emplace_back(cid.inPortIndex,
+                                convert(connectionConverter(cid),
+                                        cachedOutData(*source, cid.outPortIndex)));
+        }
+    }
+
+    for (auto const &input : inputs) {
+        NodeDelegateProfiler::Scope profile(record.model.get(),
+                                            NodeDelegateProfiler::Call::SetInData,
+                                            input.first);
+
+        record.model->setInData(input.second, input.first);
+    }
+
+    record.outDataCache.clear();
+
+    --_restoringData;
+}
+
+bool DataFlowGraphModel::loadSpill(NodeRecord const &record) const
+{
+    auto it = _spills.find(record.id);
+
+    if (it == _spills.end() || !it->second->open())
+        return false;
+
+    QByteArray const bytes = it->second->readAll();
+    it->second->close();
+
+    QDataStream in(bytes);
+    in.setVersion(QDataStream::Qt_5_11);
+
+    quint32 count = 0;
+    in >> count;
+
+    std::vector<OutDataCacheEntry> entries;
+
+    try {
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+            OutDataCacheEntry entry;
+            entry.valid = true;
+
+            bool present = false;
+            in >> present;
+
+            if (present) {
+                QString typeId;
+                QByteArray data;
+
+                in >> typeId >> data;
+
+                entry.data = NodeDataCodec::decode(typeId, data);
+            }
+
+            entries.push_back(std::move(entry));
+        }
+    } catch (std::exception const &) {
+        return false;
+    }
+
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    record.outDataCache = std::move(entries);
+
+    return true;
+}
+
+bool DataFlowGraphModel::spillOutputs(NodeRecord const &record)
+{
+    unsigned int const count = record.model->nPorts(PortType::Out);
+
+    QByteArray bytes;
+
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_11);
+
+    out << static_cast<quint32>(count);
+
+    for (PortIndex portIndex = 0; portIndex < count; ++portIndex) {
+        std::shared_ptr<NodeData> const data = cachedOutData(record, portIndex);
+
+        out << static_cast<bool>(data);
+
+        if (!data)
+            continue;
+
+        QString const typeId = data->type().id;
+
+        if (!NodeDataCodec::contains(typeId))
+            return false;
+
+        out << typeId << NodeDataCodec::encode(*data);
+    }
+
+    auto file = std::make_unique<QTemporaryFile>();
+
+    if (!file->open() || file->write(bytes) != bytes.size())
+        return false;
+
+    // Reopened by `loadSpill()`; the file lives as long as the object.
+    file->close();
+
+    _spills[record.id] = std::move(file);
+
+    return true;
+}
+
+void DataFlowGraphModel::retainDeliveredNodes()
+{
+    if (_deliveryDepth > 0 || _deliveredNodes.empty())
+        return;
+
+    std::vector<NodeId> const delivered = std::move(_deliveredNodes);
+    _deliveredNodes.clear();
+
+    for (NodeId const nodeId : delivered) {
+        auto retained = _retainedNodes.find(nodeId);
+
+        if (retained != _retainedNodes.end()) {
+            _retainedBytes -= retained->second.bytes;
+            _retainedOrder.erase(retained->second.position);
+            _retainedNodes.erase(retained);
+        }
+
+        NodeRecord const *record = peekNode(nodeId);
+
+        if (!record || record->released || !record->model->releasable() || record->computeJobs > 0
+            || _priorityNodes.count(nodeId) > 0)
+            continue;
+
+        auto connections = _nodeConnections.find(nodeId);
+
+        bool const intermediate
+            = connections != _nodeConnections.end()
+              && std::any_of(connections->second.begin(),
+                             connections->second.end(),
+                             [nodeId](ConnectionId const &cid) { return cid.outNodeId == nodeId; });
+
+        if (!intermediate)
+            continue;
+
+        std::size_t bytes = 0;
+
+        for (OutDataCacheEntry const &entry : record->outDataCache) {
+            if (entry.valid && entry.data)
+                bytes += entry.data->memoryUsage();
+        }
+
+        _retainedOrder.push_back(nodeId);
+        _retainedNodes[nodeId] = RetainedNode{std::prev(_retainedOrder.end()), bytes};
+        _retainedBytes += bytes;
+    }
+
+    releaseOverBudget();
+}
+
+void DataFlowGraphModel::releaseOverBudget()
+{
+    while (!_retainedOrder.empty()
+           && (_intermediateMemoryBudget == 0 || _retainedBytes > _intermediateMemoryBudget)) {
+        NodeId const nodeId = _retainedOrder.front();
+
+        _retainedOrder.pop_front();
+        _retainedBytes -= _retainedNodes[nodeId].bytes;
+        _retainedNodes.erase(nodeId);
+
+        if (NodeRecord *record = peekNode(nodeId))
+            releaseNodeData(*record);
+    }
+}
+
+void DataFlowGraphModel::releaseNodeData(NodeRecord &record)
+{
+    if (record.released || record.computeJobs > 0)
+        return;
+
+    if (_spillThreshold >= 0.0 && _nodeStatisticsEnabled
+        && record.statistics.averageMilliseconds >= _spillThreshold)
+        spillOutputs(record);
+
+    record.model->releaseData();
+    record.outDataCache.clear();
+    record.released = true;
+}
+
+void DataFlowGraphModel::forgetIntermediate(NodeId const nodeId)
+{
+    auto retained = _retainedNodes.find(nodeId);
+
+    if (retained != _retainedNodes.end()) {
+        _retainedBytes -= retained->second.bytes;
+        _retainedOrder.erase(retained->second.position);
+        _retainedNodes.erase(retained);
+    }
+
+    _spills.erase(nodeId);
+}
+
+std::uint64_t DataFlowGraphModel::computeGeneration(NodeId const nodeId) const
+{
+    NodeRecord const *record = peekNode(nodeId);
+
+    return record ? record->computeGeneration : 0;
+}
+
+DataFlowGraphModel::NodeRecord *DataFlowGraphModel::findNode(NodeId const nodeId)
+{
+    auto it = _nodeIndex.find(nodeId);
+    if (it == _nodeIndex.end())
+        return nullptr;
+
+    NodeRecord &record = _nodes[it->second];
+
+    decodePendingData(record);
+
+    return &record;
+}
+
+DataFlowGraphModel::NodeRecord const *DataFlowGraphModel::findNode(NodeId const nodeId) const
+{
+    NodeRecord const *record = peekNode(nodeId);
+
+    if (record)
+        decodePendingData(*record);
+
+    return record;
+}
+
+DataFlowGraphModel::NodeRecord const *DataFlowGraphModel::peekNode(NodeId const nodeId) const
+{
+    auto it = _nodeIndex.find(nodeId);
+    if (it == _nodeIndex.end())
+        return nullptr;
+
+    return &_nodes[it->second];
+}
+
+DataFlowGraphModel::NodeRecord *DataFlowGraphModel::peekNode(NodeId const nodeId)
+{
+    auto it = _nodeIndex.find(nodeId);
+    if (it == _nodeIndex.end())
+        return nullptr;
+
+    return &_nodes[it->second];
+}
+
+void DataFlowGraphModel::decodePendingData(NodeRecord const &record) const
+{
+    if (!record.hasPendingData())
+        return;
+
+    // Cleared before loading: the delegate may call back into the model.
+    QJsonObject const data = pendingData(record);
+    record.pendingInternalData.clear();
+    record.pendingInternalObject = QJsonObject();
+
+    QString const caption = record.model->caption();
+
+    record.model->load(data);
+
+    updateCaptionIndex(record.id);
+
+    // Views may have shown the node before; the update waits for the running paint or flush.
+    if (record.model->caption() != caption) {
+        auto *self = const_cast<DataFlowGraphModel *>(this);
+        NodeId const nodeId = record.id;
+
+        QMetaObject::invokeMethod(
+            self, [self, nodeId]() { Q_EMIT self->nodeUpdated(nodeId); }, Qt::QueuedConnection);
+    }
+}
+
+QJsonObject DataFlowGraphModel::pendingData(NodeRecord const &record)
+{
+    if (!record.pendingInternalObject.isEmpty())
+        return record.pendingInternalObject;
+
+    return QJsonDocument::fromJson(record.pendingInternalData).object();
+}
+
+DataFlowGraphModel::NodeRecord &DataFlowGraphModel::insertNode(
+    NodeId const nodeId, std::unique_ptr<NodeDelegateModel> model)
+{
+    // The replaced delegate and its pending data are dropped, nothing needs decoding.
+    if (NodeRecord *existing = peekNode(nodeId)) {
+        _resultCache.removeNode(nodeId);
+
+        connectTracing(nodeId, *model);
+
+        unindexNode(*existing);
+
+        existing->computeToken.cancel();
+        recycleDelegate(std::move(existing->model));
+
+        existing->model = std::move(model);
+        existing->geometry = NodeGeometryData();
+        existing->pendingInternalData.clear();
+        existing->pendingInternalObject = QJsonObject();
+
+        indexNodeType(*existing);
+        updateCaptionIndex(nodeId);
+
+        return *existing;
+    }
+
+    invalidateExecutionPlan();
+
+    connectTracing(nodeId, *model);
+
+    _nodeIndex[nodeId] = _nodes.size();
+    _nodes.push_back(NodeRecord{nodeId, std::move(model), NodeGeometryData()});
+
+    // Without connections any rank is valid; appending keeps ranks unique.
+    _nodes.back().topologicalRank = _nextTopologicalRank++;
+
+    indexNodeType(_nodes.back());
+    updateCaptionIndex(nodeId);
+
+    return _nodes.back();
+}
+
+void DataFlowGraphModel::connectDelegate(NodeId const nodeId, NodeDelegateModel &model)
+{
+    // Direct, tasks of a parallel flush emit from worker threads.
+    connect(&model,
+            &NodeDelegateModel::dataUpdated,
+            this,
+            [nodeId, this](PortIndex const portIndex) { onOutPortDataUpdated(nodeId, portIndex); },
+            Qt::DirectConnection);
+
+    connect(&model,
+            &NodeDelegateModel::dataInvalidated,
+            this,
+            [nodeId, this](PortIndex const portIndex) { invalidateOutData(nodeId, portIndex); });
+
+    connect(&model, &NodeDelegateModel::computeRequested, this, [nodeId, this]() {
+        startCompute(nodeId);
+    });
+
+    connect(&model, &NodeDelegateModel::embeddedWidgetSizeUpdated, this, [nodeId, this]() {
+        Q_EMIT nodeUpdated(nodeId);
+    });
+
+    connect(&model, &NodeDelegateModel::internalDataChanged, this, [nodeId, this]() {
+        Q_EMIT nodeInternalDataChanged(nodeId);
+    });
+
+    connect(&model,
+            &NodeDelegateModel::portsAboutToBeDeleted,
+            this,
+            [nodeId, this](PortType const portType, PortIndex const first, PortIndex const last) {
+                _portTypeIds.erase(nodeId);
+                invalidateOutData(nodeId);
+                invalidateExecutionPlan();
+                portsAboutToBeDeleted(nodeId, portType, first, last);
+            });
+
+    connect(&model, &NodeDelegateModel::portsDeleted, this, [nodeId, this]() {
+        _portTypeIds.erase(nodeId);
+        invalidateOutData(nodeId);
+        invalidateExecutionPlan();
+        resetResultCache(nodeId);
+        portsDeleted();
+
+        // The node size and port layout depend on the ports.
+        Q_EMIT nodeUpdated(nodeId);
+    });
+
+    connect(&model,
+            &NodeDelegateModel::portsAboutToBeInserted,
+            this,
+            [nodeId, this](PortType const portType, PortIndex const first, PortIndex const last) {
+                _portTypeIds.erase(nodeId);
+                invalidateOutData(nodeId);
+                invalidateExecutionPlan();
+                portsAboutToBeInserted(nodeId, portType, first, last);
+            });
+
+    connect(&model, &NodeDelegateModel::portsInserted, this, [nodeId, this]() {
+        _portTypeIds.erase(nodeId);
+        invalidateOutData(nodeId);
+        invalidateExecutionPlan();
+        resetResultCache(nodeId);
+        portsInserted();
+
+        // The node size and port layout depend on the ports.
+        Q_EMIT nodeUpdated(nodeId);
+    });
+}
+
+void DataFlowGraphModel::connectTracing(NodeId const nodeId, NodeDelegateModel &model)
+{
+    // Delegates may emit these themselves, not only around compute jobs.
+    connect(&model, &NodeDelegateModel::computingStarted, this, [this, nodeId, &model]() {
+        if (_tracer)
+            _tracer->recordAsync(PropagationTracer::Phase::AsyncBegin, "compute", nodeId, &model);
+    });
+
+    connect(&model, &NodeDelegateModel::computingFinished, this, [this, nodeId, &model]() {
+        if (_tracer)
+            _tracer->recordAsync(PropagationTracer::Phase::AsyncEnd, "compute", nodeId, &model);
+    });
+}
+
+std::unique_ptr<NodeDelegateModel> DataFlowGraphModel::createDelegate(QString const &modelName)
+{
+    auto it = _delegatePool.find(modelName);
+
+    if (it != _delegatePool.end() && !it->second.empty()) {
+        std::unique_ptr<NodeDelegateModel> model = std::move(it->second.back());
+        it->second.pop_back();
+        return model;
+    }
+
+    return _registry->create(modelName);
+}
+
+void DataFlowGraphModel::recycleDelegate(std::unique_ptr<NodeDelegateModel> model)
+{
+    if (!model || !model->recyclable())
+        return;
+
+    auto &pool = _delegatePool[model->name()];
+
+    if (pool.size() >= _delegatePoolCapacity)
+        return;
+
+    // The connections made for the deleted node must not fire for the next one.
+    // Those the delegate made itself, e.g. to its widget, stay.
+    QObject::disconnect(model.get(), nullptr, this, nullptr);
+
+    model->prepareForReuse();
+
+    pool.push_back(std::move(model));
+}
+
+void DataFlowGraphModel::setDelegatePoolCapacity(std::size_t const capacity)
+{
+    _delegatePoolCapacity = capacity;
+
+    for (auto &entry : _delegatePool) {
+        if (entry.second.size() > capacity)
+            entry.second.resize(capacity);
+    }
+}
+
+void DataFlowGraphModel::removeNode(NodeId const nodeId)
+{
+    auto it = _nodeIndex.find(nodeId);
+    if (it == _nodeIndex.end())
+        return;
+
+    invalidateExecutionPlan();
+
+    _resultCache.removeNode(nodeId);
+
+    forgetIntermediate(nodeId);
+
+    std::size_t const index = it->second;
+
+    unindexNode(_nodes[index]);
+
+    _nodeIndex.erase(it);
+
+    if (index + 1 != _nodes.size()) {
+        _nodes[index] = std::move(_nodes.back());
+        _nodeIndex[_nodes[index].id] = index;
+    }
+
+    _nodes.pop_back();
+}
+
+void DataFlowGraphModel::indexNodeType(NodeRecord &record)
+{
+    record.typeName = record.model->name();
+
+    std::vector<NodeId> &nodes = _nodesByType[record.typeName];
+
+    record.typeSlot = nodes.size();
+    nodes.push_back(record.id);
+}
+
+void DataFlowGraphModel::unindexNode(NodeRecord const &record)
+{
+    auto typeIt = _nodesByType.find(record.typeName);
+
+    if (typeIt != _nodesByType.end()) {
+        std::vector<NodeId> &nodes = typeIt->second;
+
+        NodeId const moved = nodes.back();
+
+        nodes[record.typeSlot] = moved;
+        nodes.pop_back();
+
+        if (moved != record.id)
+            peekNode(moved)->typeSlot = record.typeSlot;
+
+        if (nodes.empty())
+            _nodesByType.erase(typeIt);
+    }
+
+    auto captionIt = _captionEntries.find(record.id);
+
+    if (captionIt != _captionEntries.end()) {
+        _captionIndex.erase(captionIt->second);
+        _captionEntries.erase(captionIt);
+    }
+}
+
+void DataFlowGraphModel::updateCaptionIndex(NodeId const nodeId) const
+{
+    if (!_captionIndexEnabled)
+        return;
+
+    NodeRecord const *record = peekNode(nodeId);
+    if (!record || !record->model)
+        return;
+
+    QString const key = record->model->caption().toCaseFolded();
+
+    auto it = _captionEntries.find(nodeId);
+
+    if (it == _captionEntries.end()) {
+        _captionEntries.emplace(nodeId, _captionIndex.emplace(key, nodeId));
+    } else if (it->second->first != key) {
+        _captionIndex.erase(it->second);
+        it->second = _captionIndex.emplace(key, nodeId);
+    }
+}
+
+std::vector<NodeId> const &DataFlowGraphModel::nodesOfType(QString const &type) const
+{
+    static std::vector<NodeId> const none;
+
+    auto it = _nodesByType.find(type);
+
+    return it != _nodesByType.end() ? it->second : none;
+}
+
+void DataFlowGraphModel::setCaptionIndexEnabled(bool const enabled)
+{
+    if (_captionIndexEnabled == enabled)
+        return;
+
+    _captionIndexEnabled = enabled;
+
+    _captionIndex.clear();
+    _captionEntries.clear();
+
+    if (!enabled)
+        return;
+
+    _captionEntries.reserve(_nodes.size());
+
+    for (NodeRecord const &record : _nodes) {
+        updateCaptionIndex(record.id);
+    }
+}
+
+std::vector<NodeId> DataFlowGraphModel::nodesWithCaption(QString const &caption) const
+{
+    std::vector<NodeId> result;
+
+    QString const key = caption.toCaseFolded();
+
+    if (_captionIndexEnabled) {
+        auto const range = _captionIndex.equal_range(key);
+
+        for (auto it = range.first; it != range.second; ++it) {
+            result.push_back(it->second);
+        }
+
+        return result;
+    }
+
+    for (NodeRecord const &record : _nodes) {
+        if (record.model->caption().toCaseFolded() == key)
+            result.push_back(record.id);
+    }
+
+    return result;
+}
+
+std::vector<NodeId> DataFlowGraphModel::nodesWithCaptionPrefix(QString const &prefix,
+                                                               std::size_t const limit) const
+{
+    std::vector<NodeId> result;
+
+    QString const key = prefix.toCaseFolded();
+
+    if (_captionIndexEnabled) {
+        for (auto it = _captionIndex.lower_bound(key);
+             it != _captionIndex.end() && it->first.startsWith(key) && result.size() < limit;
+             ++it) {
+            result.push_back(it->second);
+        }
+
+        return result;
+    }
+
+    std::vector<std::pair<QString, NodeId>> matches;
+
+    for (NodeRecord const &record : _nodes) {
+        QString folded = record.model->caption().toCaseFolded();
+
+        if (folded.startsWith(key))
+            matches.emplace_back(std::move(folded), record.id);
+    }
+
+    std::sort(matches.begin(), matches.end());
+
+    matches.resize(std::min(matches.size(), limit));
+
+    for (auto const &match : matches) {
+        result.push_back(match.second);
+    }
+
+    return result;
+}
+
+std::unordered_set<NodeId> DataFlowGraphModel::allNodeIds() const
+{
+    std::unordered_set<NodeId> nodeIds;
+    nodeIds.reserve(_nodes.size());
+
+    for (auto const &record : _nodes) {
+        nodeIds.insert(record.id);
+    }
+
+    return nodeIds;
+}
+
+std::unordered_set<ConnectionId> DataFlowGraphModel::allConnectionIds(NodeId const nodeId) const
+{
+    auto it = _nodeConnections.find(nodeId);
+
+    if (it == _nodeConnections.end())
+        return {};
+
+    return it->second;
+}
+
+std::unordered_set<ConnectionId> DataFlowGraphModel::connections(NodeId nodeId,
+                                                                 PortType portType,
+                                                                 PortIndex portIndex) const
+{
+    auto it = _portConnections.find(PortKey{nodeId, portType, portIndex});
+
+    if (it == _portConnections.end())
+        return {};
+
+    return it->second;
+}
+
+void DataFlowGraphModel::forEachConnection(NodeId nodeId,
+                                           PortType portType,
+                                           PortIndex portIndex,
+                                           ConnectionVisitor const &visitor) const
+{
+    auto it = _portConnections.find(PortKey{nodeId, portType, portIndex});
+
+    if (it == _portConnections.end())
+        return;
+
+    for (auto const &cid : it->second) {
+        visitor(cid);
+    }
+}
+
+void DataFlowGraphModel::forEachNodeConnection(NodeId nodeId,
+                                               ConnectionVisitor const &visitor) const
+{
+    auto it = _nodeConnections.find(nodeId);
+
+    if (it == _nodeConnections.end())
+        return;
+
+    for (auto const &cid : it->second) {
+        visitor(cid);
+    }
+}
+
+void DataFlowGraphModel::forEachGraphConnection(ConnectionVisitor const &visitor) const
+{
+    for (auto const &cid : _connectivity) {
+        visitor(cid);
+    }
+}
+
+std::size_t DataFlowGraphModel::connectionCount(NodeId nodeId,
+                                                PortType portType,
+                                                PortIndex portIndex) const
+{
+    auto it = _portConnections.find(PortKey{nodeId, portType, portIndex});
+
+    if (it == _portConnections.end())
+        return 0;
+
+    return it->second.size();
+}
+
+bool DataFlowGraphModel::connectionExists(ConnectionId const connectionId) const
+{
+    return (_connectivity.find(connectionId) != _connectivity.end());
+}
+
+NodeId DataFlowGraphModel::reserveNodeIds(std::size_t const count)
+{
+    if (count == 0)
+        return InvalidNodeId;
+
+    NodeId const first = _nextNodeId;
+
+    _nextNodeId += static_cast<NodeId>(count);
+
+    return first;
+}
+
+void DataFlowGraphModel::reserve(std::size_t const nodes, std::size_t const connections)
+{
+    reserveMore(_nodes, nodes);
+
+    _nodeIndex.reserve(_nodeIndex.size() + nodes);
+    _nodeConnections.reserve(_nodeConnections.size() + nodes);
+
+    _connectivity.reserve(_connectivity.size() + connections);
+
+    // An entry per port end.
+    _portConnections.reserve(_portConnections.size() + 2 * connections);
+}
+
+NodeId DataFlowGraphModel::addNode(QString const nodeType)
+{
+    std::unique_ptr<NodeDelegateModel> model = createDelegate(nodeType);
+
+    if (model) {
+        NodeId newId = newNodeId();
+
+        connectDelegate(newId, *model);
+
+        insertNode(newId, std::move(model));
+
+        Q_EMIT nodeCreated(newId);
+
+        return newId;
+    }
+
+    return InvalidNodeId;
+}
+
+bool DataFlowGraphModel::connectionPossible(ConnectionId const connectionId) const
+{
+    auto getDataType = [&](PortType const portType) {
+        return portDataTypeId(getNodeId(portType, connectionId),
+                              portType,
+                              getPortIndex(portType, connectionId));
+    };
+
+    auto portVacant = [&](PortType const portType) {
+        NodeId const nodeId = getNodeId(portType, connectionId);
+        PortIndex const portIndex = getPortIndex(portType, connectionId);
+        if (connectionCount(nodeId, portType, portIndex) == 0)
+            return true;
+
+        auto policy = portData(nodeId, portType, portIndex, PortRole::ConnectionPolicyRole)
+                          .value<ConnectionPolicy>();
+
+        return policy == ConnectionPolicy::Many;
+    };
+
+    // Static delegates declaring different tagged classes never connect.
+    auto getTypeTag = [&](PortType const portType) -> void const * {
+        NodeRecord const *record = peekNode(getNodeId(portType, connectionId));
+        if (!record)
+            return nullptr;
+
+        PortSpec const *spec = staticPortSpec(*record->model,
+                                              portType,
+                                              getPortIndex(portType, connectionId));
+
+        return spec ? spec->typeTag : nullptr;
+    };
+
+    auto tagsMatch = [&]() {
+        void const *outTag = getTypeTag(PortType::Out);
+        void const *inTag = getTypeTag(PortType::In);
+
+        return !outTag || !inTag || outTag == inTag;
+    };
+
+    // A registered converter stands in for a converter node between different types.
+    auto typesMatch = [&]() {
+        NodeDataTypeId const outType = getDataType(PortType::Out);
+        NodeDataTypeId const inType = getDataType(PortType::In);
+
+        if (outType == inType)
+            return tagsMatch();
+
+        return _registry->typeConverter(outType, inType) != nullptr;
+    };
+
+    return typesMatch() && portVacant(PortType::Out) && portVacant(PortType::In)
+           && !createsCycle(connectionId);
+}
+
+NodeDelegateModelRegistry::TypeConverter const *DataFlowGraphModel::connectionConverter(
+    ConnectionId const connectionId) const
+{
+    if (_registry->registeredTypeConverters().empty())
+        return nullptr;
+
+    NodeDataTypeId const outType = portDataTypeId(connectionId.outNodeId,
+                                                  PortType::Out,
+                                                  connectionId.outPortIndex);
+    NodeDataTypeId const inType = portDataTypeId(connectionId.inNodeId,
+                                                 PortType::In,
+                                                 connectionId.inPortIndex);
+
+    if (outType == inType)
+        return nullptr;
+
+    return _registry->typeConverter(outType, inType);
+}
+
+bool DataFlowGraphModel::createsCycle(ConnectionId const connectionId) const
+{
+    NodeId const from = connectionId.outNodeId;
+    NodeId const to = connectionId.inNodeId;
+
+    if (from == to)
+        return true;
+
+    NodeRecord const *source = peekNode(from);
+    NodeRecord const *target = peekNode(to);
+    if (!source || !target)
+        return false;
+
+    // Ranks only bound the search while every connection follows them.
+    bool const ordered = _unorderedConnections.empty();
+
+    if (ordered && source->topologicalRank < target->topologicalRank)
+        return false;
+
+    std::uint64_t const bound = source->topologicalRank;
+
+    // Is `from` reachable from `to`?
+    std::vector<NodeId> stack{to};
+    std::unordered_set<NodeId> visited{to};
+
+    while (!stack.empty()) {
+        NodeId const nodeId = stack.back();
+        stack.pop_back();
+
+        if (nodeId == from)
+            return true;
+
+        forEachNodeConnection(nodeId, [&](ConnectionId const &cid) {
+            if (cid.outNodeId != nodeId)
+                return;
+
+            if (ordered) {
+                NodeRecord const *next = peekNode(cid.inNodeId);
+                if (!next || next->topologicalRank > bound)
+                    return;
+            }
+
+            if (visited.insert(cid.inNodeId).second)
+                stack.push_back(cid.inNodeId);
+        });
+    }
+
+    return false;
+}
+
+void DataFlowGraphModel::updateTopologicalOrder(ConnectionId const connectionId)
+{
+    NodeRecord *source = peekNode(connectionId.outNodeId);
+    NodeRecord *target = peekNode(connectionId.inNodeId);
+    if (!source || !target)
+        return;
+
+    std::uint64_t const lower = target->topologicalRank;
+    std::uint64_t const upper = source->topologicalRank;
+
+    if (lower > upper)
+        return;
+
+    auto ordered = [this](ConnectionId const &cid) {
+        return _unorderedConnections.empty() || _unorderedConnections.count(cid) == 0;
+    };
+
+    // Nodes reachable from the target and ranked up to the source.
+    std::vector<NodeRecord *> forward;
+    std::unordered_set<NodeId> visited{target->id};
+    std::vector<NodeRecord *> stack{target};
+
+    while (!stack.empty()) {
+        NodeRecord *record = stack.back();
+        stack.pop_back();
+
+        if (record == source) {
+            _unorderedConnections.insert(connectionId);
+            return;
+        }
+
+        forward.push_back(record);
+
+        forEachNodeConnection(record->id, [&](ConnectionId const &cid) {
+            if (cid.outNodeId != record->id || cid == connectionId || !ordered(cid))
+                return;
+
+            NodeRecord *next = peekNode(cid.inNodeId);
+            if (next && next->topologicalRank <= upper && visited.insert(next->id).second)
+                stack.push_back(next);
+        });
+    }
+
+    // Nodes reaching the source and ranked from the target on.
+    std::vector<NodeRecord *> backward;
+    visited = {source->id};
+    stack = {source};
+
+    while (!stack.empty()) {
+        NodeRecord *record = stack.back();
+        stack.pop_back();
+
+        backward.push_back(record);
+
+        forEachNodeConnection(record->id, [&](ConnectionId const &cid) {
+            if (cid.inNodeId != record->id || cid == connectionId || !ordered(cid))
+                return;
+
+            NodeRecord *previous = peekNode(cid.outNodeId);
+            if (previous && previous->topologicalRank >= lower
+                && visited.insert(previous->id).second)
+                stack.push_back(previous);
+        });
+    }
+
+    auto byRank = [](NodeRecord const *l, NodeRecord const *r) {
+        return l->topologicalRank < r->topologicalRank;
+    };
+
+    std::sort(forward.begin(), forward.end(), byRank);
+    std::sort(backward.begin(), backward.end(), byRank);
+
+    // The affected nodes reuse their own ranks: the backward set first.
+    std::vector<std::uint64_t> ranks;
+    ranks.reserve(forward.size() + backward.size());
+
+    for (NodeRecord const *record : backward) {
+        ranks.push_back(record->topologicalRank);
+    }
+
+    for (NodeRecord const *record : forward) {
+        ranks.push_back(record->topologicalRank);
+    }
+
+    std::sort(ranks.begin(), ranks.end());
+
+    std::size_t next = 0;
+
+    for (NodeRecord *record : backward) {
+        record->topologicalRank = ranks[next++];
+    }
+
+    for (NodeRecord *record : forward) {
+        record->topologicalRank = ranks[next++];
+    }
+}
+
+void DataFlowGraphModel::addConnection(ConnectionId const connectionId)
+{
+    _connectivity.insert(connectionId);
+
+    indexConnection(connectionId);
+
+    updateTopologicalOrder(connectionId);
+
+    sendConnectionCreation(connectionId);
+
+    if (_bulkLoading) {
+        _dirtyOutPorts[connectionId.outNodeId].insert(connectionId.outPortIndex);
+        return;
+    }
+
+    NodeRecord const *source = findNode(connectionId.outNodeId);
+    if (!source)
+        return;
+
+    deliverInData(connectionId.inNodeId,
+                  connectionId.inPortIndex,
+                  convert(connectionConverter(connectionId),
+                          cachedOutData(*source, connectionId.outPortIndex)));
+}
+
+void DataFlowGraphModel::indexConnection(ConnectionId const connectionId)
+{
+    invalidateExecutionPlan();
+
+    _portConnections[PortKey{connectionId.outNodeId, PortType::Out, connectionId.outPortIndex}]
+        .insert(connectionId);
+    _portConnections[PortKey{connectionId.inNodeId, PortType::In, connectionId.inPortIndex}]
+        .insert(connectionId);
+
+    _nodeConnections[connectionId.outNodeId].insert(connectionId);
+    _nodeConnections[connectionId.inNodeId].insert(connectionId);
+}
+
+void DataFlowGraphModel::unindexConnection(ConnectionId const connectionId)
+{
+    invalidateExecutionPlan();
+
+    auto erasePort = [&](PortKey const &key) {
+        auto it = _portConnections.find(key);
+        if (it != _portConnections.end()) {
+            it->second.erase(connectionId);
+            if (it->second.empty())
+                _portConnections.erase(it);
+        }
+    };
+
+    erasePort(PortKey{connectionId.outNodeId, PortType::Out, connectionId.outPortIndex});
+    erasePort(PortKey{connectionId.inNodeId, PortType::In, connectionId.inPortIndex});
+
+    auto eraseNode = [&](NodeId const nodeId) {
+        auto it = _nodeConnections.find(nodeId);
+        if (it != _nodeConnections.end()) {
+            it->second.erase(connectionId);
+            if (it->second.empty())
+                _nodeConnections.erase(it);
+        }
+    };
+
+    eraseNode(connectionId.outNodeId);
+    eraseNode(connectionId.inNodeId);
+}
+
+void DataFlowGraphModel::sendConnectionCreation(ConnectionId const connectionId)
+{
+    Q_EMIT connectionCreated(connectionId);
+
+    NodeRecord *recordIn = findNode(connectionId.inNodeId);
+    NodeRecord *recordOut = findNode(connectionId.outNodeId);
+    if (recordIn && recordOut) {
+        auto &modeli = recordIn->model;
+        auto &modelo = recordOut->model;
+        modeli->inputConnectionCreated(connectionId);
+        modelo->outputConnectionCreated(connectionId);
+    }
+}
+
+void DataFlowGraphModel::sendConnectionDeletion(ConnectionId const connectionId)
+{
+    Q_EMIT connectionDeleted(connectionId);
+
+    NodeRecord *recordIn = findNode(connectionId.inNodeId);
+    NodeRecord *recordOut = findNode(connectionId.outNodeId);
+    if (recordIn && recordOut) {
+        auto &modeli = recordIn->model;
+        auto &modelo = recordOut->model;
+        modeli->inputConnectionDeleted(connectionId);
+        modelo->outputConnectionDeleted(connectionId);
+    }
+}
+
+bool DataFlowGraphModel::nodeExists(NodeId const nodeId) const
+{
+    return _nodeIndex.find(nodeId) != _nodeIndex.end();
+}
+
+void DataFlowGraphModel::forEachNodeGeometry(NodeGeometryVisitor const &visitor) const
+{
+    for (NodeRecord const &record : _nodes) {
+        visitor(record.id, record.geometry.pos, record.geometry.size);
+    }
+}
+
+void DataFlowGraphModel::nodePositions(std::vector<NodeId> const &nodeIds,
+                                       std::vector<QPointF> &positions) const
+{
+    positions.resize(nodeIds.size());
+
+    for (std::size_t i = 0; i < nodeIds.size(); ++i) {
+        NodeRecord const *record = peekNode(nodeIds[i]);
+        positions[i] = record ? record->geometry.pos : QPointF();
+    }
+}
+
+void DataFlowGraphModel::nodeSizes(std::vector<NodeId> const &nodeIds,
+                                   std::vector<QSize> &sizes) const
+{
+    sizes.resize(nodeIds.size());
+
+    for (std::size_t i = 0; i < nodeIds.size(); ++i) {
+        NodeRecord const *record = peekNode(nodeIds[i]);
+        sizes[i] = record ? record->geometry.size : QSize();
+    }
+}
+
+QVariant DataFlowGraphModel::nodeData(NodeId nodeId, NodeRole role) const
+{
+    QVariant result;
+
+    // Building a scene reads every node, the internal data waits for the roles needing it.
+    NodeRecord const *record = peekNode(nodeId);
+    if (!record)
+        return result;
+
+    auto &model = record->model;
+
+    switch (role) {
+    case NodeRole::InPortCount:
+    case NodeRole::OutPortCount:
+        if (!model->portTable())
+            decodePendingData(*record);
+        break;
+
+    case NodeRole::Widget:
+    case NodeRole::WidgetSizeHint:
+        decodePendingData(*record);
+        break;
+
+    default:
+        break;
+    }
+
+    switch (role) {
+    case NodeRole::Type:
+        result = model->name();
+        break;
+
+    case NodeRole::Position:
+        result = record->geometry.pos;
+        break;
+
+    case NodeRole::Size:
+        result = record->geometry.size;
+        break;
+
+    case NodeRole::CaptionVisible:
+        result = model->captionVisible();
+        break;
+
+    case NodeRole::Caption:
+        result = model->caption();
+        break;
+
+    case NodeRole::Style:
+        result = model->nodeStyle().toJson().toVariantMap();
+        break;
+
+    case NodeRole::StylePtr:
+        result = QVariant::fromValue(model->sharedNodeStyle());
+        break;
+
+    case NodeRole::Computing:
+        result = record->computeJobs > 0;
+        break;
+
+    case NodeRole::InternalData: {
+        QJsonObject nodeJson;
+
+        nodeJson["internal-data"] = record->hasPendingData() ? pendingData(*record) : model->save();
+
+        result = nodeJson.toVariantMap();
+        break;
+    }
+
+    case NodeRole::InPortCount:
+        result = portCount(*model, PortType::In);
+        break;
+
+    case NodeRole::OutPortCount:
+        result = portCount(*model, PortType::Out);
+        break;
+
+    case NodeRole::Widget: {
+        record->widgetRequested = true;
+
+        auto w = model->embeddedWidget();
+        result = QVariant::fromValue(w);
+    } break;
+
+    case NodeRole::WidgetSizeHint:
+        if (!record->widgetRequested)
+            result = model->embeddedWidgetSizeHint();
+        break;
+
+    case NodeRole::ComputeTime:
+        if (_nodeStatisticsEnabled && record->statistics.evaluations > 0)
+            result = record->statistics.averageMilliseconds;
+        break;
+
+    case NodeRole::LayoutKey:
+        // Measured sizes need no key, the scene only asks about saved ones.
+        if (record->sizeRestored)
+            result = record->layoutKey;
+        break;
+    }
+
+    return result;
+}
+
+NodeFlags DataFlowGraphModel::nodeFlags(NodeId nodeId) const
+{
+    NodeRecord const *record = peekNode(nodeId);
+
+    if (record && record->model->resizable())
+        return NodeFlag::Resizable;
+
+    return NodeFlag::NoFlags;
+}
+
+bool DataFlowGraphModel::setNodeData(NodeId nodeId, NodeRole role, QVariant value)
+{
+    Q_UNUSED(nodeId);
+    Q_UNUSED(role);
+    Q_UNUSED(value);
+
+    bool result = false;
+
+    NodeRecord *record = peekNode(nodeId);
+    if (!record)
+        return result;
+
+    // The geometry is kept by the model, everything else goes to the loaded delegate.
+    if (role != NodeRole::Position && role != NodeRole::Size && role != NodeRole::LayoutKey)
+        decodePendingData(*record);
+
+    switch (role) {
+    case NodeRole::Type:
+        break;
+    case NodeRole::Position: {
+        record->geometry.pos = value.value<QPointF>();
+        record->savedGeometryOutdated = true;
+
+        Q_EMIT nodePositionUpdated(nodeId);
+
+        result = true;
+    } break;
+
+    case NodeRole::Size: {
+        record->geometry.size = value.value<QSize>();
+        record->layoutKey = 0;
+        record->sizeRestored = false;
+        record->savedGeometryOutdated = true;
+        result = true;
+    } break;
+
+    case NodeRole::CaptionVisible:
+        break;
+
+    case NodeRole::Caption:
+        break;
+
+    case NodeRole::Style: {
+        QJsonObject const styleJson = QJsonObject::fromVariantMap(value.toMap());
+
+        record->model->setNodeStyle(NodeStyle(styleJson));
+
+        Q_EMIT nodeUpdated(nodeId);
+
+        result = true;
+    } break;
+
+    case NodeRole::StylePtr:
+        record->model->setSharedNodeStyle(value.value<std::shared_ptr<NodeStyle const>>());
+
+        Q_EMIT nodeUpdated(nodeId);
+
+        result = true;
+        break;
+
+    case NodeRole::Computing:
+        break;
+
+    case NodeRole::InternalData: {
+        // The layout `nodeData()` returns, as replicas of the model send it.
+        QJsonObject const nodeJson = QJsonObject::fromVariantMap(value.toMap());
+
+        record->model->load(nodeJson["internal-data"].toObject());
+
+        Q_EMIT nodeUpdated(nodeId);
+
+        result = true;
+    } break;
+
+    case NodeRole::InPortCount:
+        break;
+
+    case NodeRole::OutPortCount:
+        break;
+
+    case NodeRole::Widget:
+        break;
+
+    case NodeRole::WidgetSizeHint:
+        break;
+
+    case NodeRole::ComputeTime:
+        break;
+
+    case NodeRole::LayoutKey:
+        record->layoutKey = value.value<quint64>();
+        record->sizeRestored = false;
+        record->savedGeometryOutdated = true;
+        result = true;
+        break;
+    }
+
+    return result;
+}
+
+void DataFlowGraphModel::moveNodes(std::vector<NodeId> const &nodeIds, QPointF const &delta)
+{
+    std::vector<NodeId> moved;
+    moved.reserve(nodeIds.size());
+
+    for (NodeId const nodeId : nodeIds) {
+        NodeRecord *record = peekNode(nodeId);
+        if (!record)
+            continue;
+
+        record->geometry.pos += delta;
+        record->savedGeometryOutdated = true;
+
+        moved.push_back(nodeId);
+    }
+
+    if (!moved.empty())
+        Q_EMIT nodePositionsUpdated(moved);
+}
+
+void DataFlowGraphModel::setNodePositions(std::vector<std::pair<NodeId, QPointF>> const &positions)
+{
+    std::vector<NodeId> moved;
+    moved.reserve(positions.size());
+
+    for (auto const &position : positions) {
+        NodeRecord *record = peekNode(position.first);
+        if (!record)
+            continue;
+
+        record->geometry.pos = position.second;
+        record->savedGeometryOutdated = true;
+
+        moved.push_back(position.first);
+    }
+
+    if (!moved.empty())
+        Q_EMIT nodePositionsUpdated(moved);
+}
+
+QVariant DataFlowGraphModel::portData(NodeId nodeId,
+                                      PortType portType,
+                                      PortIndex portIndex,
+                                      PortRole role) const
+{
+    QVariant result;
+
+    NodeRecord const *record = peekNode(nodeId);
+    if (!record)
+        return result;
+
+    auto &model = record->model;
+
+    // Ports declared in a table do not depend on the internal data.
+    if (!model->portTable() || role == PortRole::Data || role == PortRole::Required)
+        decodePendingData(*record);
+
+    PortSpec const *spec = staticPortSpec(*model, portType, portIndex);
+
+    switch (role) {
+    case PortRole::Data:
+        if (portType == PortType::Out)
+            result = QVariant::fromValue(cachedOutData(*record, portIndex));
+        break;
+
+    case PortRole::DataType:
+        result = QVariant::fromValue(spec ? spec->type : model->dataType(portType, portIndex));
+        break;
+
+    case PortRole::ConnectionPolicyRole:
+        result = QVariant::fromValue(spec ? spec->policy
+                                          : model->portConnectionPolicy(portType, portIndex));
+        break;
+
+    case PortRole::CaptionVisible:
+        result = model->portCaptionVisible(portType, portIndex);
+        break;
+
+    case PortRole::Caption:
+        result = model->portCaption(portType, portIndex);
+
+        break;
+
+    case PortRole::DataTypeId: {
+        if (portType == PortType::None)
+            break;
+
+        if (model->portTable()) {
+            if (spec)
+                result = QVariant::fromValue(spec->typeId);
+            break;
+        }
+
+        PortTypeIds &ids = _portTypeIds[nodeId];
+        auto &table = (portType == PortType::In) ? ids.in : ids.out;
+
+        if (table.empty()) {
+            unsigned int const n = model->nPorts(portType);
+            table.reserve(n);
+            for (PortIndex i = 0; i < n; ++i) {
+                table.push_back(model->dataType(portType, i).typeId());
+            }
+        }
+
+        if (portIndex < table.size())
+            result = QVariant::fromValue(table[portIndex]);
+    } break;
+
+    case PortRole::Required:
+        if (portType == PortType::In)
+            result = model->inputRequired(portIndex);
+        break;
+    }
+
+    return result;
+}
+
+bool DataFlowGraphModel::setPortData(
+    NodeId nodeId, PortType portType, PortIndex portIndex, QVariant const &value, PortRole role)
+{
+    Q_UNUSED(nodeId);
+
+    QVariant result;
+
+    if (!findNode(nodeId))
+        return false;
+
+    switch (role) {
+    case PortRole::Data:
+        if (portType == PortType::In)
+            deliverInData(nodeId, portIndex, value.value<std::shared_ptr<NodeData>>());
+        break;
+
+    default:
+        break;
+    }
+
+    return false;
+}
+
+bool DataFlowGraphModel::deleteConnection(ConnectionId const connectionId)
+{
+    bool disconnected = false;
+
+    auto it = _connectivity.find(connectionId);
+
+    if (it != _connectivity.end()) {
+        disconnected = true;
+
+        _connectivity.erase(it);
+
+        unindexConnection(connectionId);
+
+        // Removing a connection never breaks the order.
+        _unorderedConnections.erase(connectionId);
+    }
+
+    if (disconnected) {
+        sendConnectionDeletion(connectionId);
+
+        propagateEmptyDataTo(getNodeId(PortType::In, connectionId),
+                             getPortIndex(PortType::In, connectionId));
+    }
+
+    return disconnected;
+}
+
+void DataFlowGraphModel::remapConnections(ConnectionRemap const &remap)
+{
+    ConnectionRemap applied;
+    applied.reserve(remap.size());
+
+    std::vector<bool> unordered;
+    unordered.reserve(remap.size());
+
+    // All old addresses go first, a shifted connection may take the place of another one.
+    for (auto const &shift : remap) {
+        if (_connectivity.erase(shift.first) == 0)
+            continue;
+
+        unindexConnection(shift.first);
+
+        // The nodes stay the same, and so does their order.
+        unordered.push_back(_unorderedConnections.erase(shift.first) > 0);
+
+        applied.push_back(shift);
+    }
+
+    for (std::size_t i = 0; i < applied.size(); ++i) {
+        ConnectionId const &connectionId = applied[i].second;
+
+        _connectivity.insert(connectionId);
+
+        indexConnection(connectionId);
+
+        if (unordered[i])
+            _unorderedConnections.insert(connectionId);
+    }
+
+    if (!applied.empty())
+        Q_EMIT connectionsRemapped(applied);
+}
+
+bool DataFlowGraphModel::deleteNode(NodeId const nodeId)
+{
+    // Delete connections to this node first.
+    auto connectionIds = allConnectionIds(nodeId);
+    for (auto &cId : connectionIds) {
+        deleteConnection(cId);
+    }
+
+    releaseNode(nodeId);
+
+    Q_EMIT nodeDeleted(nodeId);
+
+    return true;
+}
+
+void DataFlowGraphModel::deleteConnections(std::vector<ConnectionId> const &connectionIds)
+{
+    GraphTransaction transaction(*this);
+
+    auto const emptied = removeConnections(connectionIds, std::unordered_set<NodeId>());
+
+    for (auto const &input : emptied) {
+        propagateEmptyDataTo(input.first, input.second);
+    }
+}
+
+void DataFlowGraphModel::deleteNodes(std::vector<NodeId> const &nodeIds)
+{
+    GraphTransaction transaction(*this);
+
+    std::unordered_set<NodeId> deleted;
+    deleted.reserve(nodeIds.size());
+
+    std::vector<NodeId> order;
+    order.reserve(nodeIds.size());
+
+    for (NodeId const nodeId : nodeIds) {
+        if (nodeExists(nodeId) && deleted.insert(nodeId).second)
+            order.push_back(nodeId);
+    }
+
+    // A connection between two deleted nodes is listed by both.
+    std::unordered_set<ConnectionId> attached;
+
+    for (NodeId const nodeId : order) {
+        auto it = _nodeConnections.find(nodeId);
+        if (it != _nodeConnections.end())
+            attached.insert(it->second.begin(), it->second.end());
+    }
+
+    auto const emptied = removeConnections(std::vector<ConnectionId>(attached.begin(),
+                                                                     attached.end()),
+                                           deleted);
+
+    for (NodeId const nodeId : order) {
+        releaseNode(nodeId);
+
+        Q_EMIT nodeDeleted(nodeId);
+    }
+
+    // No connection leads to the deleted nodes any more, propagation stops short of them.
+    for (auto const &input : emptied) {
+        propagateEmptyDataTo(input.first, input.second);
+    }
+}
+
+void DataFlowGraphModel::setEvaluationUnit(NodeId const unitId,
+                                           std::unordered_set<NodeId> const &nodeIds)
+{
+    for (auto it = _evaluationUnits.begin(); it != _evaluationUnits.end();) {
+        if (it->second == unitId)
+            it = _evaluationUnits.erase(it);
+        else
+            ++it;
+    }
+
+    for (NodeId const nodeId : nodeIds) {
+        _evaluationUnits[nodeId] = unitId;
+    }
+}
+
+void DataFlowGraphModel::clear()
+{
+    _connectivity.clear();
+    _portConnections.clear();
+    _nodeConnections.clear();
+    _unorderedConnections.clear();
+
+    _portTypeIds.clear();
+    _dirtyOutPorts.clear();
+    _updateThrottles.clear();
+
+    _nodesByType.clear();
+    _captionEntries.clear();
+    _captionIndex.clear();
+
+    _resultCache.clear();
+
+    _deliveredNodes.clear();
+    _retainedOrder.clear();
+    _retainedNodes.clear();
+    _retainedBytes = 0;
+    _spills.clear();
+
+    for (NodeRecord &record : _nodes) {
+        record.computeToken.cancel();
+        recycleDelegate(std::move(record.model));
+    }
+
+    _nodeIndex.clear();
+    _nodes.clear();
+    _evaluationUnits.clear();
+
+    invalidateExecutionPlan();
+
+    Q_EMIT modelReset();
+}
+
+std::vector<std::pair<NodeId, PortIndex>> DataFlowGraphModel::removeConnections(
+    std::vector<ConnectionId> const &connectionIds, std::unordered_set<NodeId> const &deletedNodes)
+{
+    std::vector<ConnectionId> removed;
+    removed.reserve(connectionIds.size());
+
+    for (ConnectionId const &connectionId : connectionIds) {
+        if (_connectivity.erase(connectionId) == 0)
+            continue;
+
+        unindexConnection(connectionId);
+
+        _unorderedConnections.erase(connectionId);
+
+        removed.push_back(connectionId);
+    }
+
+    std::vector<std::pair<NodeId, PortIndex>> emptied;
+    std::unordered_set<std::pair<NodeId, PortIndex>> seen;
+
+    for (ConnectionId const &connectionId : removed) {
+        Q_EMIT connectionDeleted(connectionId);
+
+        bool const inKept = deletedNodes.count(connectionId.inNodeId) == 0;
+        bool const outKept = deletedNodes.count(connectionId.outNodeId) == 0;
+
+        if (inKept) {
+            if (NodeRecord *record = findNode(connectionId.inNodeId))
+                record->model->inputConnectionDeleted(connectionId);
+
+            std::pair<NodeId, PortIndex> const input(connectionId.inNodeId,
+                                                     connectionId.inPortIndex);
+
+            if (seen.insert(input).second)
+                emptied.push_back(input);
+        }
+
+        if (outKept) {
+            if (NodeRecord *record = findNode(connectionId.outNodeId))
+                record->model->outputConnectionDeleted(connectionId);
+        }
+    }
+
+    return emptied;
+}
+
+void DataFlowGraphModel::releaseNode(NodeId const nodeId)
+{
+    _nodeConnections.erase(nodeId);
+    _portTypeIds.erase(nodeId);
+    _dirtyOutPorts.erase(nodeId);
+    _updateThrottles.erase(nodeId);
+
+    if (NodeRecord *record = peekNode(nodeId)) {
+        record->computeToken.cancel();
+        recycleDelegate(std::move(record->model));
+    }
+
+    removeNode(nodeId);
+}
+
+MemoryReport DataFlowGraphModel::memoryReport() const
+{
+    MemoryReport report;
+
+    std::size_t recordBytes = MemoryReport::vectorBytes(_nodes)
+                              + MemoryReport::flatHashBytes(_nodeIndex);
+
+    std::size_t pendingCount = 0;
+    std::size_t pendingBytes = 0;
+
+    std::size_t payloadBytes = 0;
+
+    for (NodeRecord const &record : _nodes) {
+        recordBytes += MemoryReport::vectorBytes(record.outDataCache)
+                       + MemoryReport::vectorBytes(record.inputHashes)
+                       + MemoryReport::vectorBytes(record.computeInputHashes)
+                       + record.unhashableInputs.capacity() / 8;
+
+        if (record.hasPendingData()) {
+            ++pendingCount;
+
+            // Pending objects share the loaded document and are not counted.
+            pendingBytes += static_cast<std::size_t>(record.pendingInternalData.capacity());
+        } else {
+            payloadBytes += record.model->memoryUsage();
+        }
+    }
+
+    report.add(QStringLiteral("nodes"), _nodes.size(), recordBytes);
+    report.add(QStringLiteral("delegatePayload"), _nodes.size() - pendingCount, payloadBytes);
+    report.add(QStringLiteral("pendingInternalData"), pendingCount, pendingBytes);
+
+    std::size_t connectionBytes = MemoryReport::flatHashBytes(_connectivity)
+                                  + MemoryReport::hashBytes(_portConnections)
+                                  + MemoryReport::hashBytes(_nodeConnections)
+                                  + MemoryReport::hashBytes(_unorderedConnections);
+
+    for (auto const &entry : _portConnections) {
+        connectionBytes += MemoryReport::hashBytes(entry.second);
+    }
+
+    for (auto const &entry : _nodeConnections) {
+        connectionBytes += MemoryReport::hashBytes(entry.second);
+    }
+
+    report.add(QStringLiteral("connections"), _connectivity.size(), connectionBytes);
+
+    std::size_t portTypeBytes = MemoryReport::hashBytes(_portTypeIds);
+
+    for (auto const &entry : _portTypeIds) {
+        portTypeBytes += MemoryReport::vectorBytes(entry.second.in)
+                         + MemoryReport::vectorBytes(entry.second.out);
+    }
+
+    report.add(QStringLiteral("portTypeIds"), _portTypeIds.size(), portTypeBytes);
+
+    report.add(QStringLiteral("retainedIntermediates"), _retainedNodes.size(), _retainedBytes);
+
+    std::size_t searchBytes = MemoryReport::hashBytes(_nodesByType)
+                              + MemoryReport::hashBytes(_captionEntries);
+
+    for (auto const &entry : _nodesByType) {
+        searchBytes += MemoryReport::vectorBytes(entry.second);
+    }
+
+    // A red-black tree node: the value plus three links and the color.
+    searchBytes += _captionIndex.size() * (sizeof(CaptionIndex::value_type) + 4 * sizeof(void *));
+
+    report.add(QStringLiteral("searchIndex"), _captionIndex.size(), searchBytes);
+
+    report.add(QStringLiteral("executionPlan"),
+               _plan.order.size(),
+               MemoryReport::vectorBytes(_plan.order) + MemoryReport::vectorBytes(_plan.fanoutBegin)
+                   + MemoryReport::vectorBytes(_plan.fanouts)
+                   + MemoryReport::vectorBytes(_plan.targets)
+                   + MemoryReport::vectorBytes(_plan.inputBegin)
+                   + MemoryReport::vectorBytes(_plan.inputs));
+
+    report.add(QStringLiteral("resultCache"), _resultCache.size(), _resultCache.memoryUsage());
+
+    std::size_t pooledCount = 0;
+    std::size_t pooledBytes = 0;
+
+    for (auto const &entry : _delegatePool) {
+        for (auto const &delegate : entry.second) {
+            ++pooledCount;
+            pooledBytes += delegate->memoryUsage();
+        }
+    }
+
+    report.add(QStringLiteral("delegatePool"), pooledCount, pooledBytes);
+
+    return report;
+}
+
+QJsonObject DataFlowGraphModel::saveNode(NodeId const nodeId) const
+{
+    NodeRecord const *record = peekNode(nodeId);
+    if (!record)
+        return QJsonObject();
+
+    return cachedNodeJson(*record, nullptr);
+}
+
+QJsonObject DataFlowGraphModel::cachedNodeJson(NodeRecord const &record,
+                                               QJsonObject const *internalData) const
+{
+    if (_incrementalSave && !record.savedJson.isEmpty()) {
+        if (record.savedGeometryOutdated) {
+            record.savedJson = nodeJson(record, record.savedJson["internal-data"].toObject());
+            record.savedGeometryOutdated = false;
+        }
+
+        return record.savedJson;
+    }
+
+    QJsonObject json;
+
+    if (internalData)
+        json = nodeJson(record, *internalData);
+    else if (!record.hasPendingData())
+        json = nodeJson(record, record.model->save());
+    else
+        json = nodeJson(record, pendingData(record));
+
+    if (_incrementalSave) {
+        record.savedJson = json;
+        record.savedGeometryOutdated = false;
+    }
+
+    return json;
+}
+
+void DataFlowGraphModel::invalidateSavedNode(NodeId const nodeId)
+{
+    if (!_incrementalSave)
+        return;
+
+    if (NodeRecord const *record = peekNode(nodeId))
+        record->savedJson = QJsonObject();
+}
+
+void DataFlowGraphModel::setIncrementalSave(bool const enabled)
+{
+    _incrementalSave = enabled;
+
+    // Nothing is tracked while off.
+    if (!enabled) {
+        for (NodeRecord const &record : _nodes) {
+            record.savedJson = QJsonObject();
+        }
+
+        _savedConnections = QJsonArray();
+        _savedConnectionsRevision = 0;
+    }
+}
+
+void DataFlowGraphModel::setSaveNodeSizes(bool const enabled)
+{
+    _saveNodeSizes = enabled;
+
+    for (NodeRecord const &record : _nodes) {
+        record.savedGeometryOutdated = true;
+    }
+}
+
+void DataFlowGraphModel::setCompactJson(bool const enabled)
+{
+    _compactJson = enabled;
+
+    for (NodeRecord const &record : _nodes) {
+        record.savedGeometryOutdated = true;
+    }
+
+    _savedConnections = QJsonArray();
+    _savedConnectionsRevision = 0;
+}
+
+QJsonObject DataFlowGraphModel::nodeJson(NodeRecord const &record,
+                                         QJsonObject const &internalData) const
+{
+    QJsonObject nodeJson;
+
+    nodeJson["id"] = static_cast<qint64>(record.id);
+
+    nodeJson["internal-data"] = internalData;
+
+    nodeJson["position"] = pointToJson(record.geometry.pos, _compactJson);
+
+    if (_saveNodeSizes && record.layoutKey != 0) {
+        QSize const size = record.geometry.size;
+
+        QJsonObject sizeJson;
+        sizeJson["width"] = size.width();
+        sizeJson["height"] = size.height();
+        nodeJson["size"] = sizeJson;
+
+        // JSON numbers are doubles, which cannot hold every 64-bit key.
+        nodeJson["layout-key"] = QString::number(record.layoutKey);
+    }
+
+    return nodeJson;
+}
+
+void DataFlowGraphModel::restoreSize(NodeId const nodeId, QJsonObject const &nodeJson)
+{
+    bool ok = false;
+
+    quint64 const layoutKey = nodeJson["layout-key"].toString().toULongLong(&ok);
+
+    if (!ok || layoutKey == 0 || !nodeJson.contains("size"))
+        return;
+
+    NodeRecord *record = peekNode(nodeId);
+
+    if (!record)
+        return;
+
+    QJsonObject const sizeJson = nodeJson["size"].toObject();
+
+    record->geometry.size = QSize(sizeJson["width"].toInt(), sizeJson["height"].toInt());
+    record->layoutKey = layoutKey;
+    record->savedGeometryOutdated = true;
+    record->sizeRestored = true;
+}
+
+std::vector<QJsonObject> DataFlowGraphModel::saveInternalData() const
+{
+    std::vector<QJsonObject> internalData(_nodes.size());
+
+    auto saveRecord = [this, &internalData](std::size_t const i) {
+        NodeRecord const &record = _nodes[i];
+
+        // `save()` takes the cached JSON as a whole.
+        if (_incrementalSave && !record.savedJson.isEmpty())
+            return;
+
+        if (!record.hasPendingData())
+            internalData[i] = record.model->save();
+        else
+            internalData[i] = pendingData(record);
+    };
+
+    if (!_parallelSerialization) {
+        for (std::size_t i = 0; i < _nodes.size(); ++i) {
+            saveRecord(i);
+        }
+
+        return internalData;
+    }
+
+    std::vector<WorkStealingExecutor::Task> tasks(_nodes.size());
+
+    for (std::size_t i = 0; i < _nodes.size(); ++i) {
+        NodeRecord const &record = _nodes[i];
+
+        bool const cached = _incrementalSave && !record.savedJson.isEmpty();
+
+        // Pending blobs are only parsed, that needs no delegate.
+        tasks[i].mainThreadOnly = !cached && !record.hasPendingData()
+                                  && !record.model->threadSafeSerialization();
+
+        tasks[i].run = [&saveRecord, i]() { saveRecord(i); };
+    }
+
+    if (!_executor)
+        _executor = std::make_unique<WorkStealingExecutor>();
+
+    _executor->run(tasks);
+
+    return internalData;
+}
+
+QJsonObject DataFlowGraphModel::save() const
+{
+    QJsonObject sceneJson;
+
+    std::vector<QJsonObject> const internalData = saveInternalData();
+
+    QJsonArray nodesJsonArray;
+    for (std::size_t i = 0; i < _nodes.size(); ++i) {
+        nodesJsonArray.append(cachedNodeJson(_nodes[i], &internalData[i]));
+    }
+    sceneJson["nodes"] = nodesJsonArray;
+
+    if (_incrementalSave && _savedConnectionsRevision == _topologyRevision) {
+        sceneJson["connections"] = _savedConnections;
+        return sceneJson;
+    }
+
+    QJsonArray connJsonArray;
+    for (auto const &cid : _connectivity) {
+        appendConnectionJson(connJsonArray, cid, _compactJson);
+    }
+    sceneJson["connections"] = connJsonArray;
+
+    if (_incrementalSave) {
+        _savedConnections = connJsonArray;
+        _savedConnectionsRevision = _topologyRevision;
+    }
+
+    return sceneJson;
+}
+
+void DataFlowGraphModel::loadNode(QJsonObject const &nodeJson)
+{
+    // Possibility of the id clash when reading it from json and not generating a
+    // new value.
+    // 1. When restoring a scene from a file.
+    // Conflict is not possible because the scene must be cleared by the time of
+    // loading.
+    // 2. When undoing the deletion command.  Conflict is not possible
+    // because all the new ids were created past the removed nodes.
+    NodeId restoredNodeId = nodeJson["id"].toInt();
+
+    QPointF const pos = pointFromJson(nodeJson["position"]);
+
+    QJsonObject const internalDataJson = nodeJson["internal-data"].toObject();
+
+    NodeDelegateModel *delegate = restoreNode(restoredNodeId,
+                                              pos,
+                                              internalDataJson["model-name"].toString());
+
+    restoreSize(restoredNodeId, nodeJson);
+
+    if (_lazyInternalData) {
+        // Loaded by the first `findNode()` touching the node.
+        peekNode(restoredNodeId)->pendingInternalObject = internalDataJson;
+        return;
+    }
+
+    delegate->load(internalDataJson);
+}
+
+NodeDelegateModel *DataFlowGraphModel::restoreNode(NodeId const restoredNodeId,
+                                                   QPointF const &pos,
+                                                   QString const &delegateModelName)
+{
+    _nextNodeId = std::max(_nextNodeId, restoredNodeId + 1);
+
+    std::unique_ptr<NodeDelegateModel> model = createDelegate(delegateModelName);
+
+    if (model) {
+        connectDelegate(restoredNodeId, *model);
+
+        NodeDelegateModel *delegate = insertNode(restoredNodeId, std::move(model)).model.get();
+
+        Q_EMIT nodeCreated(restoredNodeId);
+
+        setNodeData(restoredNodeId, NodeRole::Position, pos);
+
+        return delegate;
+    }
+
+    throw std::logic_error(std::string("No registered model with name ")
+                           + delegateModelName.toLocal8Bit().data());
+}
+
+void DataFlowGraphModel::bulkLoad(std::function<void()> const &body)
+{
+    GraphTransaction transaction(*this);
+
+    _bulkLoading = true;
+
+    try {
+        body();
+
+        // One ordered pass over everything marked dirty while loading.
+        processPendingPropagation();
+    } catch (...) {
+        _bulkLoading = false;
+        throw;
+    }
+
+    _bulkLoading = false;
+}
+
+void DataFlowGraphModel::loadInParallel(QJsonArray const &nodesJsonArray)
+{
+    std::vector<NodeDelegateModel *> delegates;
+    std::vector<QJsonObject> internalData;
+
+    delegates.reserve(nodesJsonArray.size());
+    internalData.reserve(nodesJsonArray.size());
+
+    // Creation and its signals stay on this thread.
+    for (QJsonValue const nodeValue : nodesJsonArray) {
+        QJsonObject const nodeJson = nodeValue.toObject();
+
+        QPointF const pos = pointFromJson(nodeJson["position"]);
+
+        NodeId const nodeId = static_cast<NodeId>(nodeJson["id"].toInt());
+        QJsonObject internalDataJson = nodeJson["internal-data"].toObject();
+
+        NodeDelegateModel *delegate = restoreNode(nodeId,
+                                                  pos,
+                                                  internalDataJson["model-name"].toString());
 
-NodeId DataFlowGraphModel::addNode(QString const nodeType)
-{
-    std::unique_ptr<NodeDelegateModel> model = _registry->create(nodeType);
+        restoreSize(nodeId, nodeJson);
 
-    if (model) {
-        NodeId newId = newNodeId();
+        // Nothing to spread over the workers, see `loadNode()`.
+        if (_lazyInternalData) {
+            peekNode(nodeId)->pendingInternalObject = std::move(internalDataJson);
+            continue;
+        }
 
-        connect(model.get(),
-                &NodeDelegateModel::dataUpdated,
-                [newId, this](PortIndex const portIndex) {
-                    onOutPortDataUpdated(newId, portIndex);
-                });
-
-        connect(model.get(),
-                &NodeDelegateModel::portsAboutToBeDeleted,
-                this,
-                [newId, this](PortType const portType, PortIndex const first, PortIndex const last) {
-                    portsAboutToBeDeleted(newId, portType, first, last);
-                });
-
-        connect(model.get(),
-                &NodeDelegateModel::portsDeleted,
-                this,
-                &DataFlowGraphModel::portsDeleted);
-
-        connect(model.get(),
-                &NodeDelegateModel::portsAboutToBeInserted,
-                this,
-                [newId, this](PortType const portType, PortIndex const first, PortIndex const last) {
-                    portsAboutToBeInserted(newId, portType, first, last);
-                });
-
-        connect(model.get(),
-                &NodeDelegateModel::portsInserted,
-                this,
-                &DataFlowGraphModel::portsInserted);
-
-        _models[newId] = std::move(model);
+        internalData.push_back(std::move(internalDataJson));
+        delegates.push_back(delegate);
+    }
 
-        Q_EMIT nodeCreated(newId);
+    std::vector<WorkStealingExecutor::Task> tasks(delegates.size());
 
-        return newId;
+    for (std::size_t i = 0; i < delegates.size(); ++i) {
+        tasks[i].mainThreadOnly = !delegates[i]->threadSafeSerialization();
+
+        tasks[i].run = [&delegates, &internalData, i]() { delegates[i]->load(internalData[i]); };
     }
 
-    return InvalidNodeId;
+    if (!_executor)
+        _executor = std::make_unique<WorkStealingExecutor>();
+
+    _executor->run(tasks);
 }
 
-bool DataFlowGraphModel::connectionPossible(ConnectionId const connectionId) const
+void DataFlowGraphModel::load(QJsonObject const &jsonDocument)
 {
-    auto getDataType = [&](PortType const portType) {
-        return portData(getNodeId(portType, connectionId),
-                        portType,
-                        getPortIndex(portType, connectionId),
-                        PortRole::DataType)
-            .value<NodeDataType>();
-    };
+    bulkLoad([&]() {
+        QJsonArray nodesJsonArray = jsonDocument["nodes"].toArray();
+        QJsonArray connectionJsonArray = jsonDocument["connections"].toArray();
 
-    auto portVacant = [&](PortType const portType) {
-        NodeId const nodeId = getNodeId(portType, connectionId);
-        PortIndex const portIndex = getPortIndex(portType, connectionId);
-        auto const connected = connections(nodeId, portType, portIndex);
+        std::vector<ConnectionId> const connectionIds = connectionsFromJson(connectionJsonArray);
 
-        auto policy = portData(nodeId, portType, portIndex, PortRole::ConnectionPolicyRole)
-                          .value<ConnectionPolicy>();
+        // Grows geometrically when graphs are loaded in many parts, see ProjectLoader.
+        reserve(nodesJsonArray.size(), connectionIds.size());
 
-        return connected.empty() || (policy == ConnectionPolicy::Many);
-    };
+        if (_parallelSerialization) {
+            loadInParallel(nodesJsonArray);
+        } else {
+            for (QJsonValueRef nodeJson : nodesJsonArray) {
+                loadNode(nodeJson.toObject());
+            }
+        }
 
-    return getDataType(PortType::Out).id == getDataType(PortType::In).id
-           && portVacant(PortType::Out) && portVacant(PortType::In);
+        for (ConnectionId const &connId : connectionIds) {
+            // Restore the connection
+            addConnection(connId);
+        }
+    });
 }
 
-void DataFlowGraphModel::addConnection(ConnectionId const connectionId)
+bool DataFlowGraphModel::saveBinary(QIODevice &device) const
 {
-    _connectivity.insert(connectionId);
+    QDataStream out(&device);
+    out.setVersion(QDataStream::Qt_5_11);
 
-    sendConnectionCreation(connectionId);
+    out << BinarySceneMagic << BinarySceneVersion;
 
-    QVariant const portDataToPropagate = portData(connectionId.outNodeId,
-                                                  PortType::Out,
-                                                  connectionId.outPortIndex,
-                                                  PortRole::Data);
+    out << static_cast<quint32>(_nodes.size());
 
-    setPortData(connectionId.inNodeId,
-                PortType::In,
-                connectionId.inPortIndex,
-                portDataToPropagate,
-                PortRole::Data);
-}
+    for (auto const &record : _nodes) {
+        QPointF const pos = record.geometry.pos;
 
-void DataFlowGraphModel::sendConnectionCreation(ConnectionId const connectionId)
-{
-    Q_EMIT connectionCreated(connectionId);
+        out << static_cast<quint32>(record.id) << pos.x() << pos.y() << record.model->name();
 
-    auto iti = _models.find(connectionId.inNodeId);
-    auto ito = _models.find(connectionId.outNodeId);
-    if (iti != _models.end() && ito != _models.end()) {
-        auto &modeli = iti->second;
-        auto &modelo = ito->second;
-        modeli->inputConnectionCreated(connectionId);
-        modelo->outputConnectionCreated(connectionId);
+        // Lazily loaded nodes are written back without decoding them.
+        if (!record.pendingInternalData.isEmpty())
+            out << record.pendingInternalData;
+        else if (!record.pendingInternalObject.isEmpty())
+            out << QJsonDocument(record.pendingInternalObject).toJson(QJsonDocument::Compact);
+        else
+            out << QJsonDocument(record.model->save()).toJson(QJsonDocument::Compact);
     }
-}
 
-void DataFlowGraphModel::sendConnectionDeletion(ConnectionId const connectionId)
-{
-    Q_EMIT connectionDeleted(connectionId);
+    out << static_cast<quint32>(_connectivity.size());
 
-    auto iti = _models.find(connectionId.inNodeId);
-    auto ito = _models.find(connectionId.outNodeId);
-    if (iti != _models.end() && ito != _models.end()) {
-        auto &modeli = iti->second;
-        auto &modelo = ito->second;
-        modeli->inputConnectionDeleted(connectionId);
-        modelo->outputConnectionDeleted(connectionId);
+    for (auto const &cid : _connectivity) {
+        out << static_cast<quint32>(cid.outNodeId) << static_cast<quint32>(cid.outPortIndex)
+            << static_cast<quint32>(cid.inNodeId) << static_cast<quint32>(cid.inPortIndex);
     }
+
+    return out.status() == QDataStream::Ok;
 }
 
-bool DataFlowGraphModel::nodeExists(NodeId const nodeId) const
+bool DataFlowGraphModel::loadBinary(QIODevice &device)
 {
-    return (_models.find(nodeId) != _models.end());
+    QDataStream in(&device);
+
+    return readBinary(in);
 }
 
-QVariant DataFlowGraphModel::nodeData(NodeId nodeId, NodeRole role) const
+bool DataFlowGraphModel::loadBinaryFile(QString const &fileName)
 {
-    QVariant result;
+    QFile file(fileName);
 
-    auto it = _models.find(nodeId);
-    if (it == _models.end())
-        return result;
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
 
-    auto &model = it->second;
+    qint64 const size = file.size();
 
-    switch (role) {
-    case NodeRole::Type:
-        result = model->name();
-        break;
+    uchar *mapped = nullptr;
+    if (size > 0 && size <= std::numeric_limits<int>::max())
+        mapped = file.map(0, size);
 
-    case NodeRole::Position:
-        result = _nodeGeometryData[nodeId].pos;
-        break;
+    if (!mapped)
+        return loadBinary(file);
 
-    case NodeRole::Size:
-        result = _nodeGeometryData[nodeId].size;
-        break;
+    // Wraps the mapping without copying; QFile unmaps it when destroyed.
+    QByteArray const raw = QByteArray::fromRawData(reinterpret_cast<char const *>(mapped),
+                                                   static_cast<int>(size));
 
-    case NodeRole::CaptionVisible:
-        result = model->captionVisible();
-        break;
+    QDataStream in(raw);
 
-    case NodeRole::Caption:
-        result = model->caption();
-        break;
+    return readBinary(in);
+}
 
-    case NodeRole::Style: {
-        auto style = StyleCollection::nodeStyle();
-        result = style.toJson().toVariantMap();
-    } break;
+bool DataFlowGraphModel::readBinary(QDataStream &in)
+{
+    in.setVersion(QDataStream::Qt_5_11);
 
-    case NodeRole::InternalData: {
-        QJsonObject nodeJson;
+    quint32 magic = 0;
+    quint16 version = 0;
 
-        nodeJson["internal-data"] = _models.at(nodeId)->save();
+    in >> magic >> version;
 
-        result = nodeJson.toVariantMap();
-        break;
-    }
+    if (in.status() != QDataStream::Ok || magic != BinarySceneMagic
+        || version > BinarySceneVersion)
+        return false;
 
-    case NodeRole::InPortCount:
-        result = model->nPorts(PortType::In);
-        break;
+    bulkLoad([&]() {
+        quint32 nodeCount = 0;
+        in >> nodeCount;
 
-    case NodeRole::OutPortCount:
-        result = model->nPorts(PortType::Out);
-        break;
+        // A node takes 24 bytes at least; corrupt counts reserve no more than the stream holds.
+        if (QIODevice *device = in.device())
+            reserve(static_cast<std::size_t>(std::min<qint64>(nodeCount, device->bytesAvailable() / 24)),
+                    0);
 
-    case NodeRole::Widget: {
-        auto w = model->embeddedWidget();
-        result = QVariant::fromValue(w);
-    } break;
-    }
+        for (quint32 i = 0; i < nodeCount && in.status() == QDataStream::Ok; ++i) {
+            quint32 nodeId = InvalidNodeId;
+            double x = 0.0;
+            double y = 0.0;
+            QString modelName;
+            QByteArray internalData;
 
-    return result;
-}
+            in >> nodeId >> x >> y;
 
-NodeFlags DataFlowGraphModel::nodeFlags(NodeId nodeId) const
-{
-    auto it = _models.find(nodeId);
+            if (version >= 2)
+                in >> modelName;
 
-    if (it != _models.end() && it->second->resizable())
-        return NodeFlag::Resizable;
+            in >> internalData;
 
-    return NodeFlag::NoFlags;
-}
+            if (in.status() != QDataStream::Ok)
+                break;
 
-bool DataFlowGraphModel::setNodeData(NodeId nodeId, NodeRole role, QVariant value)
-{
-    Q_UNUSED(nodeId);
-    Q_UNUSED(role);
-    Q_UNUSED(value);
+            if (version < 2) {
+                QJsonObject const internalDataJson = QJsonDocument::fromJson(internalData).object();
 
-    bool result = false;
+                restoreNode(nodeId, QPointF(x, y), internalDataJson["model-name"].toString())
+                    ->load(internalDataJson);
+                continue;
+            }
 
-    switch (role) {
-    case NodeRole::Type:
-        break;
-    case NodeRole::Position: {
-        _nodeGeometryData[nodeId].pos = value.value<QPointF>();
+            restoreNode(nodeId, QPointF(x, y), modelName);
 
-        Q_EMIT nodePositionUpdated(nodeId);
+            // Decoded by the first `findNode()` touching the node.
+            peekNode(nodeId)->pendingInternalData = std::move(internalData);
+        }
 
-        result = true;
-    } break;
+        quint32 connectionCount = 0;
+        in >> connectionCount;
 
-    case NodeRole::Size: {
-        _nodeGeometryData[nodeId].size = value.value<QSize>();
-        result = true;
-    } break;
+        if (QIODevice *device = in.device())
+            reserve(0,
+                    static_cast<std::size_t>(
+                        std::min<qint64>(connectionCount, device->bytesAvailable() / 16)));
 
-    case NodeRole::CaptionVisible:
-        break;
+        for (quint32 i = 0; i < connectionCount && in.status() == QDataStream::Ok; ++i) {
+            quint32 outNodeId, outPortIndex, inNodeId, inPortIndex;
 
-    case NodeRole::Caption:
-        break;
+            in >> outNodeId >> outPortIndex >> inNodeId >> inPortIndex;
 
-    case NodeRole::Style:
-        break;
+            if (in.status() != QDataStream::Ok)
+                break;
 
-    case NodeRole::InternalData:
-        break;
+            addConnection(ConnectionId{outNodeId, outPortIndex, inNodeId, inPortIndex});
+        }
+    });
 
-    case NodeRole::InPortCount:
-        break;
+    return in.status() == QDataStream::Ok;
+}
 
-    case NodeRole::OutPortCount:
-        break;
+bool DataFlowGraphModel::isBinaryScene(QByteArray const &header)
+{
+    if (header.size() < static_cast<int>(sizeof(quint32)))
+        return false;
 
-    case NodeRole::Widget:
-        break;
-    }
+    QDataStream in(header);
+    in.setVersion(QDataStream::Qt_5_11);
 
-    return result;
+    quint32 magic = 0;
+    in >> magic;
+
+    return magic == BinarySceneMagic;
 }
 
-QVariant DataFlowGraphModel::portData(NodeId nodeId,
-                                      PortType portType,
-                                      PortIndex portIndex,
-                                      PortRole role) const
+void DataFlowGraphModel::onOutPortDataUpdated(NodeId const nodeId, PortIndex const portIndex)
 {
-    QVariant result;
-
-    auto it = _models.find(nodeId);
-    if (it == _models.end())
-        return result;
+    invalidateOutData(nodeId, portIndex);
 
-    auto &model = it->second;
+    // A restored node reproduces outputs its consumers already have.
+    if (_restoringData > 0)
+        return;
 
-    switch (role) {
-    case PortRole::Data:
-        if (portType == PortType::Out)
-            result = QVariant::fromValue(model->outData(portIndex));
-        break;
+    // The saved JSON of the nodes of a parallel flush was dropped before it started.
+    if (_incrementalSave && !_parallelPass)
+        invalidateSavedNode(nodeId);
 
-    case PortRole::DataType:
-        result = QVariant::fromValue(model->dataType(portType, portIndex));
-        break;
+    // Spills of the nodes of a parallel flush were dropped before it started.
+    if (!_spills.empty() && !_parallelPass)
+        _spills.erase(nodeId);
 
-    case PortRole::ConnectionPolicyRole:
-        result = QVariant::fromValue(model->portConnectionPolicy(portType, portIndex));
-        break;
+    propagateOutPort(nodeId, portIndex);
+}
 
-    case PortRole::CaptionVisible:
-        result = model->portCaptionVisible(portType, portIndex);
-        break;
+void DataFlowGraphModel::setOutPortData(NodeId const nodeId,
+                                        PortIndex const portIndex,
+                                        std::shared_ptr<NodeData> data)
+{
+    NodeRecord const *record = findNode(nodeId);
+    if (!record)
+        return;
 
-    case PortRole::Caption:
-        result = model->portCaption(portType, portIndex);
+    if (portIndex >= record->outDataCache.size())
+        record->outDataCache.resize(portIndex + 1);
 
-        break;
-    }
+    OutDataCacheEntry &entry = record->outDataCache[portIndex];
+    entry.data = std::move(data);
+    entry.valid = true;
 
-    return result;
+    propagateOutPort(nodeId, portIndex);
 }
 
-bool DataFlowGraphModel::setPortData(
-    NodeId nodeId, PortType portType, PortIndex portIndex, QVariant const &value, PortRole role)
+std::shared_ptr<NodeData> DataFlowGraphModel::outPortData(NodeId const nodeId,
+                                                          PortIndex const portIndex) const
 {
-    Q_UNUSED(nodeId);
+    NodeRecord const *record = findNode(nodeId);
+    if (!record)
+        return nullptr;
 
-    QVariant result;
+    return cachedOutData(*record, portIndex);
+}
 
-    auto it = _models.find(nodeId);
-    if (it == _models.end())
-        return false;
+void DataFlowGraphModel::propagateOutPort(NodeId const nodeId, PortIndex const portIndex)
+{
+    // Emitted from the executor threads during a parallel flush.
+    if (_parallelPass) {
+        std::lock_guard<std::mutex> lock(_dirtyMutex);
+        _dirtyOutPorts[nodeId].insert(portIndex);
+        return;
+    }
 
-    auto &model = it->second;
+    if (!_updateThrottles.empty() && !_bulkLoading && throttleOutPort(nodeId, portIndex))
+        return;
 
-    switch (role) {
-    case PortRole::Data:
-        if (portType == PortType::In) {
-            model->setInData(value.value<std::shared_ptr<NodeData>>(), portIndex);
+    if (_propagationMode == PropagationMode::Scheduled || _bulkLoading) {
+        _dirtyOutPorts[nodeId].insert(portIndex);
 
-            // Triggers repainting on the scene.
-            Q_EMIT inPortDataWasSet(nodeId, portType, portIndex);
-        }
-        break;
+        if (!_propagating && !_bulkLoading)
+            schedulePropagation();
 
-    default:
-        break;
+        return;
     }
 
-    return false;
+    deliverOutPortData(nodeId, portIndex);
 }
 
-bool DataFlowGraphModel::deleteConnection(ConnectionId const connectionId)
+bool DataFlowGraphModel::throttleOutPort(NodeId const nodeId, PortIndex const portIndex)
 {
-    bool disconnected = false;
-
-    auto it = _connectivity.find(connectionId);
+    auto it = _updateThrottles.find(nodeId);
 
-    if (it != _connectivity.end()) {
-        disconnected = true;
+    if (it == _updateThrottles.end())
+        return false;
 
-        _connectivity.erase(it);
-    }
+    UpdateThrottle &throttle = it->second;
 
-    if (disconnected) {
-        sendConnectionDeletion(connectionId);
+    qint64 const now = _updateClock.elapsed();
+    qint64 const due = throttle.lastDelivery + throttle.interval;
 
-        propagateEmptyDataTo(getNodeId(PortType::In, connectionId),
-                             getPortIndex(PortType::In, connectionId));
+    if (throttle.heldPorts.empty() && now >= due) {
+        throttle.lastDelivery = now;
+        return false;
     }
 
-    return disconnected;
-}
-
-bool DataFlowGraphModel::deleteNode(NodeId const nodeId)
-{
-    // Delete connections to this node first.
-    auto connectionIds = allConnectionIds(nodeId);
-    for (auto &cId : connectionIds) {
-        deleteConnection(cId);
+    // The first held port arms the release, later ones just join it.
+    if (throttle.heldPorts.empty()) {
+        QTimer::singleShot(static_cast<int>(due - now), this, [this, nodeId]() {
+            releaseThrottledPorts(nodeId);
+        });
     }
 
-    _nodeGeometryData.erase(nodeId);
-    _models.erase(nodeId);
-
-    Q_EMIT nodeDeleted(nodeId);
+    throttle.heldPorts.insert(portIndex);
 
     return true;
 }
 
-QJsonObject DataFlowGraphModel::saveNode(NodeId const nodeId) const
+void DataFlowGraphModel::releaseThrottledPorts(NodeId const nodeId)
 {
-    QJsonObject nodeJson;
+    auto it = _updateThrottles.find(nodeId);
 
-    nodeJson["id"] = static_cast<qint64>(nodeId);
+    if (it == _updateThrottles.end() || it->second.heldPorts.empty())
+        return;
 
-    nodeJson["internal-data"] = _models.at(nodeId)->save();
+    std::unordered_set<PortIndex> const ports = std::move(it->second.heldPorts);
+    it->second.heldPorts.clear();
+    it->second.lastDelivery = _updateClock.elapsed();
 
-    {
-        QPointF const pos = nodeData(nodeId, NodeRole::Position).value<QPointF>();
+    // Past the throttle: the ports go out per propagation mode.
+    for (PortIndex const portIndex : ports) {
+        if (_propagationMode == PropagationMode::Scheduled) {
+            _dirtyOutPorts[nodeId].insert(portIndex);
 
-        QJsonObject posJson;
-        posJson["x"] = pos.x();
-        posJson["y"] = pos.y();
-        nodeJson["position"] = posJson;
+            if (!_propagating)
+                schedulePropagation();
+        } else {
+            deliverOutPortData(nodeId, portIndex);
+        }
     }
-
-    return nodeJson;
 }
 
-QJsonObject DataFlowGraphModel::save() const
+void DataFlowGraphModel::setNodeUpdateInterval(NodeId const nodeId, int const milliseconds)
 {
-    QJsonObject sceneJson;
+    if (milliseconds <= 0) {
+        auto it = _updateThrottles.find(nodeId);
 
-    QJsonArray nodesJsonArray;
-    for (auto const nodeId : allNodeIds()) {
-        nodesJsonArray.append(saveNode(nodeId));
-    }
-    sceneJson["nodes"] = nodesJsonArray;
+        if (it == _updateThrottles.end())
+            return;
 
-    QJsonArray connJsonArray;
-    for (auto const &cid : _connectivity) {
-        connJsonArray.append(toJson(cid));
+        // Nothing stays held once the limit is gone.
+        it->second.interval = 0;
+        releaseThrottledPorts(nodeId);
+
+        _updateThrottles.erase(nodeId);
+        return;
     }
-    sceneJson["connections"] = connJsonArray;
 
-    return sceneJson;
+    if (!nodeExists(nodeId))
+        return;
+
+    if (!_updateClock.isValid())
+        _updateClock.start();
+
+    UpdateThrottle &throttle = _updateThrottles[nodeId];
+    throttle.interval = milliseconds;
+    throttle.lastDelivery = _updateClock.elapsed() - milliseconds;
 }
 
-void DataFlowGraphModel::loadNode(QJsonObject const &nodeJson)
+int DataFlowGraphModel::nodeUpdateInterval(NodeId const nodeId) const
 {
-    // Possibility of the id clash when reading it from json and not generating a
-    // new value.
-    // 1. When restoring a scene from a file.
-    // Conflict is not possible because the scene must be cleared by the time of
-    // loading.
-    // 2. When undoing the deletion command.  Conflict is not possible
-    // because all the new ids were created past the removed nodes.
-    NodeId restoredNodeId = nodeJson["id"].toInt();
+    auto it = _updateThrottles.find(nodeId);
 
-    _nextNodeId = std::max(_nextNodeId, restoredNodeId + 1);
+    return it != _updateThrottles.end() ? it->second.interval : 0;
+}
 
-    QJsonObject const internalDataJson = nodeJson["internal-data"].toObject();
+void DataFlowGraphModel::deliverOutPortData(NodeId const nodeId, PortIndex const portIndex)
+{
+    NodeRecord const *record = findNode(nodeId);
+    if (!record)
+        return;
 
-    QString delegateModelName = internalDataJson["model-name"].toString();
+    ExecutionPlan const &plan = executionPlan();
+    std::size_t const slot = record->planSlot;
 
-    std::unique_ptr<NodeDelegateModel> model = _registry->create(delegateModelName);
+    ExecutionPlan::Fanout const *fanout = nullptr;
 
-    if (model) {
-        connect(model.get(),
-                &NodeDelegateModel::dataUpdated,
-                [restoredNodeId, this](PortIndex const portIndex) {
-                    onOutPortDataUpdated(restoredNodeId, portIndex);
-                });
+    for (std::size_t f = plan.fanoutBegin[slot]; f < plan.fanoutBegin[slot + 1]; ++f) {
+        if (plan.fanouts[f].outPortIndex == portIndex) {
+            fanout = &plan.fanouts[f];
+            break;
+        }
+    }
 
-        _models[restoredNodeId] = std::move(model);
+    if (!fanout)
+        return;
 
-        Q_EMIT nodeCreated(restoredNodeId);
+    PropagationTracer::Span span(_tracer,
+                                 "propagate",
+                                 nodeId,
+                                 record->model.get(),
+                                 PortType::Out,
+                                 portIndex);
 
-        QJsonObject posJson = nodeJson["position"].toObject();
-        QPointF const pos(posJson["x"].toDouble(), posJson["y"].toDouble());
+    // A copy: receivers may change their ports and thus the plan.
+    std::vector<ExecutionPlan::Target> const targets(plan.targets.begin() + fanout->targetsBegin,
+                                                     plan.targets.begin() + fanout->targetsEnd);
 
-        setNodeData(restoredNodeId, NodeRole::Position, pos);
+    std::uint64_t const revision = _topologyRevision;
 
-        _models[restoredNodeId]->load(internalDataJson);
-    } else {
-        throw std::logic_error(std::string("No registered model with name ")
-                               + delegateModelName.toLocal8Bit().data());
-    }
-}
+    std::shared_ptr<NodeData> const data = cachedOutData(*record, portIndex);
 
-void DataFlowGraphModel::load(QJsonObject const &jsonDocument)
-{
-    QJsonArray nodesJsonArray = jsonDocument["nodes"].toArray();
+    ++_deliveryDepth;
 
-    for (QJsonValueRef nodeJson : nodesJsonArray) {
-        loadNode(nodeJson.toObject());
-    }
+    for (auto const &target : targets) {
+        std::shared_ptr<NodeData> const converted = convert(target.converter, data);
 
-    QJsonArray connectionJsonArray = jsonDocument["connections"].toArray();
+        if (revision == _topologyRevision)
+            deliverInData(_nodes[target.nodeIndex], target.inPortIndex, converted);
+        else
+            deliverInData(target.nodeId, target.inPortIndex, converted);
+    }
 
-    for (QJsonValueRef connection : connectionJsonArray) {
-        QJsonObject connJson = connection.toObject();
+    --_deliveryDepth;
 
-        ConnectionId connId = fromJson(connJson);
+    if (_releaseIntermediateData) {
+        _deliveredNodes.push_back(nodeId);
 
-        // Restore the connection
-        addConnection(connId);
+        retainDeliveredNodes();
     }
 }
 
-void DataFlowGraphModel::onOutPortDataUpdated(NodeId const nodeId, PortIndex const portIndex)
+void DataFlowGraphModel::deliverInData(NodeId const nodeId,
+                                       PortIndex const portIndex,
+                                       std::shared_ptr<NodeData> const &data)
+{
+    NodeRecord *record = findNode(nodeId);
+    if (!record)
+        return;
+
+    deliverInData(*record, portIndex, data);
+}
+
+void DataFlowGraphModel::deliverInData(NodeRecord &record,
+                                       PortIndex const portIndex,
+                                       std::shared_ptr<NodeData> const &data)
 {
-    std::unordered_set<ConnectionId> const &connected = connections(nodeId,
-                                                                    PortType::Out,
-                                                                    portIndex);
+    // Plan targets bypass `findNode()`, which would have decoded the node.
+    decodePendingData(record);
+
+    // The other inputs were dropped with the rest of the data.
+    if (record.released)
+        refeedInputs(record, portIndex);
+
+    if (!_spills.empty())
+        _spills.erase(record.id);
+
+    // Delegates may derive `outData()` from the inputs without notifying.
+    record.outDataCache.clear();
+
+    if (record.model->deterministic())
+        updateInputHash(record, portIndex, data);
+
+    PropagationTracer::Span span(_tracer,
+                                 "setInData",
+                                 record.id,
+                                 record.model.get(),
+                                 PortType::In,
+                                 portIndex);
+
+    NodeId const nodeId = record.id;
 
-    QVariant const portDataToPropagate = portData(nodeId, PortType::Out, portIndex, PortRole::Data);
+    NodeDelegateProfiler::Scope profile(record.model.get(),
+                                        NodeDelegateProfiler::Call::SetInData,
+                                        portIndex);
 
-    for (auto const &cn : connected) {
-        setPortData(cn.inNodeId, PortType::In, cn.inPortIndex, portDataToPropagate, PortRole::Data);
+    if (!_nodeStatisticsEnabled) {
+        record.model->setInData(data, portIndex);
+    } else {
+        // In Immediate mode the call covers the whole cascade below the node.
+        std::int64_t const outerNested = _nestedEvaluationTime;
+        _nestedEvaluationTime = 0;
+
+        std::int64_t const start = _statisticsClock.nsecsElapsed();
+
+        record.model->setInData(data, portIndex);
+
+        std::int64_t const total = _statisticsClock.nsecsElapsed() - start;
+
+        // `record` may have moved if the call created nodes.
+        if (NodeRecord *current = peekNode(nodeId))
+            recordEvaluation(*current, start, total - _nestedEvaluationTime);
+
+        _nestedEvaluationTime = outerNested + total;
     }
+
+    // Triggers repainting on the scene.
+    Q_EMIT inPortDataWasSet(nodeId, PortType::In, portIndex);
 }
 
 void DataFlowGraphModel::propagateEmptyDataTo(NodeId const nodeId, PortIndex const portIndex)
 {
-    QVariant emptyData{};
-
-    setPortData(nodeId, PortType::In, portIndex, emptyData, PortRole::Data);
+    deliverInData(nodeId, portIndex, nullptr);
 }
 
 } // namespace QtNodes
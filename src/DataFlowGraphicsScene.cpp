@@ -2,6 +2,7 @@
 
 #include "ConnectionGraphicsObject.hpp"
 #include "GraphicsView.hpp"
+#include "ModelSearchIndex.hpp"
 #include "NodeDelegateModelRegistry.hpp"
 #include "NodeGraphicsObject.hpp"
 #include "UndoCommands.hpp"
@@ -10,9 +11,11 @@
 #include <QtWidgets/QGraphicsSceneMoveEvent>
 #include <QtWidgets/QHeaderView>
 #include <QtWidgets/QLineEdit>
-#include <QtWidgets/QTreeWidget>
+#include <QtWidgets/QTreeView>
 #include <QtWidgets/QWidgetAction>
 
+#include <QtGui/QStandardItemModel>
+
 #include <QtCore/QBuffer>
 #include <QtCore/QByteArray>
 #include <QtCore/QDataStream>
@@ -21,6 +24,7 @@
 #include <QtCore/QJsonArray>
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
+#include <QtCore/QStringList>
 #include <QtCore/QtGlobal>
 
 #include <stdexcept>
@@ -32,33 +36,128 @@ DataFlowGraphicsScene::DataFlowGraphicsScene(DataFlowGraphModel &graphModel, QOb
     : BasicGraphicsScene(graphModel, parent)
     , _graphModel(graphModel)
 {
+    // New input data changes what the node shows, not its layout.
     connect(&_graphModel,
             &DataFlowGraphModel::inPortDataWasSet,
-            [this](NodeId const nodeId, PortType const, PortIndex const) { onNodeUpdated(nodeId); });
+            this,
+            [this](NodeId const nodeId, PortType const, PortIndex const) {
+                onNodeDataChanged(nodeId);
+            });
+
+    connect(this, &BasicGraphicsScene::visibleSceneRectChanged, this, [this]() {
+        if (_visibleFirstEvaluation)
+            updatePriorityNodes();
+    });
 }
 
+DataFlowGraphicsScene::~DataFlowGraphicsScene() = default;
+
 // TODO constructor for an empyt scene?
 
 std::vector<NodeId> DataFlowGraphicsScene::selectedNodes() const
 {
-    QList<QGraphicsItem *> graphicsItems = selectedItems();
+    return std::vector<NodeId>(selectedNodeIds().begin(), selectedNodeIds().end());
+}
+
+void DataFlowGraphicsScene::setVisibleFirstEvaluation(bool const enabled)
+{
+    _visibleFirstEvaluation = enabled;
+
+    if (_visibleFirstEvaluation)
+        updatePriorityNodes();
+    else
+        _graphModel.setPriorityNodes({});
+}
+
+void DataFlowGraphicsScene::updatePriorityNodes()
+{
+    std::unordered_set<NodeId> visible;
+
+    if (!visibleSceneRect().isEmpty()) {
+        for (NodeGraphicsObject *ngo : nodesInRect(visibleSceneRect())) {
+            visible.insert(ngo->nodeId());
+        }
+    }
+
+    _graphModel.setPriorityNodes(std::move(visible));
+}
+
+namespace {
+
+/// Number of matches listed while filtering the scene menu.
+constexpr std::size_t MenuSearchLimit = 100;
+
+QString menuToolTip(NodeDelegateModelDescriptor const &descriptor)
+{
+    auto portNames = [](std::vector<NodeDataType> const &ports) {
+        QStringList names;
+        for (auto const &port : ports) {
+            names << port.name;
+        }
+        return names.join(QStringLiteral(", "));
+    };
+
+    return QStringLiteral("%1\n(%2) -> (%3)")
+        .arg(descriptor.caption, portNames(descriptor.inPorts), portNames(descriptor.outPorts));
+}
+
+QStandardItem *menuModelItem(NodeDelegateModelRegistry const &registry, QString const &modelName)
+{
+    auto item = new QStandardItem(modelName);
+    item->setData(modelName, Qt::UserRole);
+    item->setEditable(false);
+
+    // Read from the descriptor, no delegate is instantiated for the menu.
+    if (auto const *descriptor = registry.descriptor(modelName))
+        item->setToolTip(menuToolTip(*descriptor));
+
+    return item;
+}
+
+} // namespace
+
+void DataFlowGraphicsScene::updateMenuModel()
+{
+    auto registry = _graphModel.dataModelRegistry();
+
+    if (_menuModel && _menuRegistry == registry.get() && _menuRevision == registry->revision())
+        return;
 
-    std::vector<NodeId> result;
-    result.reserve(graphicsItems.size());
+    _menuRegistry = registry.get();
+    _menuRevision = registry->revision();
+    auto menuIndex = std::make_shared<ModelSearchIndex>(*registry);
+    auto menuModel = std::make_shared<QStandardItemModel>();
 
-    for (QGraphicsItem *item : graphicsItems) {
-        auto ngo = qgraphicsitem_cast<NodeGraphicsObject *>(item);
+    // Entries are sorted by category, so each category is one contiguous run.
+    QStandardItem *category = nullptr;
 
-        if (ngo != nullptr) {
-            result.push_back(ngo->nodeId());
+    for (auto const &entry : menuIndex->entries()) {
+        if (!category || category->text() != entry.category) {
+            category = new QStandardItem(entry.category);
+            category->setFlags(Qt::ItemIsEnabled);
+            menuModel->appendRow(category);
         }
+
+        category->appendRow(menuModelItem(*registry, entry.name));
     }
 
-    return result;
+    _menuIndex = std::move(menuIndex);
+    _menuModel = std::move(menuModel);
+}
+
+MemoryReport DataFlowGraphicsScene::memoryReport() const
+{
+    MemoryReport report = BasicGraphicsScene::memoryReport();
+
+    report.append(QStringLiteral("model"), _graphModel.memoryReport());
+
+    return report;
 }
 
 QMenu *DataFlowGraphicsScene::createSceneMenu(QPointF const scenePos)
 {
+    updateMenuModel();
+
     QMenu *modelMenu = new QMenu();
 
     // Add filterbox to the context menu
@@ -73,8 +172,11 @@ QMenu *DataFlowGraphicsScene::createSceneMenu(QPointF const scenePos)
     modelMenu->addAction(txtBoxAction);
 
     // Add result treeview to the context menu
-    QTreeWidget *treeView = new QTreeWidget(modelMenu);
-    treeView->header()->close();
+    auto *treeView = new QTreeView(modelMenu);
+    treeView->setHeaderHidden(true);
+    treeView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    treeView->setModel(_menuModel.get());
+    treeView->expandAll();
 
     auto *treeViewAction = new QWidgetAction(modelMenu);
     treeViewAction->setDefaultWidget(treeView);
@@ -82,57 +184,55 @@ QMenu *DataFlowGraphicsScene::createSceneMenu(QPointF const scenePos)
     // 2.
     modelMenu->addAction(treeViewAction);
 
-    auto registry = _graphModel.dataModelRegistry();
-
-    for (auto const &cat : registry->categories()) {
-        auto item = new QTreeWidgetItem(treeView);
-        item->setText(0, cat);
-        item->setFlags(item->flags() & ~Qt::ItemIsSelectable);
-    }
+    // Flat list of the matches, only populated while filtering.
+    auto *resultsModel = new QStandardItemModel(modelMenu);
 
-    for (auto const &assoc : registry->registeredModelsCategoryAssociation()) {
-        QList<QTreeWidgetItem *> parent = treeView->findItems(assoc.second, Qt::MatchExactly);
+    auto createNode = [this, modelMenu, scenePos](QString const &modelName) {
+        if (modelName.isEmpty())
+            return;
 
-        if (parent.count() <= 0)
-            continue;
+        this->undoStack().push(new CreateCommand(this, modelName, scenePos));
 
-        auto item = new QTreeWidgetItem(parent.first());
-        item->setText(0, assoc.first);
-    }
+        modelMenu->close();
+    };
 
-    treeView->expandAll();
+    connect(treeView, &QTreeView::clicked, [createNode](QModelIndex const &index) {
+        createNode(index.data(Qt::UserRole).toString());
+    });
 
-    connect(treeView,
-            &QTreeWidget::itemClicked,
-            [this, modelMenu, scenePos](QTreeWidgetItem *item, int) {
-                if (!(item->flags() & (Qt::ItemIsSelectable))) {
+    //Setup filtering
+    // Shared, the cached model and index may be replaced while the menu is open.
+    auto registry = _graphModel.dataModelRegistry();
+    std::shared_ptr<ModelSearchIndex const> searchIndex = _menuIndex;
+    std::shared_ptr<QStandardItemModel> menuModel = _menuModel;
+
+    connect(txtBox,
+            &QLineEdit::textChanged,
+            [treeView, resultsModel, menuModel, searchIndex, registry](QString const &text) {
+                if (text.trimmed().isEmpty()) {
+                    treeView->setModel(menuModel.get());
+                    treeView->setRootIsDecorated(true);
+                    treeView->expandAll();
                     return;
                 }
 
-                this->undoStack().push(new CreateCommand(this, item->text(0), scenePos));
+                resultsModel->clear();
+
+                for (std::size_t const i : searchIndex->search(text, MenuSearchLimit)) {
+                    resultsModel->appendRow(
+                        menuModelItem(*registry, searchIndex->entries()[i].name));
+                }
 
-                modelMenu->close();
+                treeView->setModel(resultsModel);
+                treeView->setRootIsDecorated(false);
             });
 
-    //Setup filtering
-    connect(txtBox, &QLineEdit::textChanged, [treeView](const QString &text) {
-        QTreeWidgetItemIterator categoryIt(treeView, QTreeWidgetItemIterator::HasChildren);
-        while (*categoryIt)
-            (*categoryIt++)->setHidden(true);
-        QTreeWidgetItemIterator it(treeView, QTreeWidgetItemIterator::NoChildren);
-        while (*it) {
-            auto modelName = (*it)->text(0);
-            const bool match = (modelName.contains(text, Qt::CaseInsensitive));
-            (*it)->setHidden(!match);
-            if (match) {
-                QTreeWidgetItem *parent = (*it)->parent();
-                while (parent) {
-                    parent->setHidden(false);
-                    parent = parent->parent();
-                }
-            }
-            ++it;
-        }
+    // Enter creates the best match.
+    connect(txtBox, &QLineEdit::returnPressed, [txtBox, searchIndex, createNode]() {
+        auto const matches = searchIndex->search(txtBox->text(), 1);
+
+        if (!txtBox->text().trimmed().isEmpty() && !matches.empty())
+            createNode(searchIndex->entries()[matches.front()].name);
     });
 
     // make sure the text box gets focus so the user doesn't have to click on it
@@ -149,14 +249,20 @@ bool DataFlowGraphicsScene::save() const
     QString fileName = QFileDialog::getSaveFileName(nullptr,
                                                     tr("Open Flow Scene"),
                                                     QDir::homePath(),
-                                                    tr("Flow Scene Files (*.flow)"));
+                                                    tr("Flow Scene Files (*.flow);;"
+                                                       "Binary Flow Scene Files (*.flowb)"));
 
     if (!fileName.isEmpty()) {
-        if (!fileName.endsWith("flow", Qt::CaseInsensitive))
+        bool const binary = fileName.endsWith(".flowb", Qt::CaseInsensitive);
+
+        if (!binary && !fileName.endsWith("flow", Qt::CaseInsensitive))
             fileName += ".flow";
 
         QFile file(fileName);
         if (file.open(QIODevice::WriteOnly)) {
+            if (binary)
+                return _graphModel.saveBinary(file);
+
             file.write(QJsonDocument(_graphModel.save()).toJson());
             return true;
         }
@@ -169,7 +275,7 @@ bool DataFlowGraphicsScene::load()
     QString fileName = QFileDialog::getOpenFileName(nullptr,
                                                     tr("Open Flow Scene"),
                                                     QDir::homePath(),
-                                                    tr("Flow Scene Files (*.flow)"));
+                                                    tr("Flow Scene Files (*.flow *.flowb)"));
 
     if (!QFileInfo::exists(fileName))
         return false;
@@ -181,9 +287,17 @@ bool DataFlowGraphicsScene::load()
 
     clearScene();
 
-    QByteArray const wholeFile = file.readAll();
+    // The format is detected from the content, not from the extension.
+    if (DataFlowGraphModel::isBinaryScene(file.peek(sizeof(quint32)))) {
+        file.close();
+
+        if (!_graphModel.loadBinaryFile(fileName))
+            return false;
+    } else {
+        QByteArray const wholeFile = file.readAll();
 
-    _graphModel.load(QJsonDocument::fromJson(wholeFile).object());
+        _graphModel.load(QJsonDocument::fromJson(wholeFile).object());
+    }
 
     Q_EMIT sceneLoaded();
 
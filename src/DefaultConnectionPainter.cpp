@@ -1,6 +1,11 @@
 #include "DefaultConnectionPainter.hpp"
 
+#include <QtCore/QLineF>
 #include <QtGui/QIcon>
+#include <QtWidgets/QStyleOptionGraphicsItem>
+
+#include <algorithm>
+#include <cmath>
 
 #include "AbstractGraphModel.hpp"
 #include "BasicGraphicsScene.hpp"
@@ -9,22 +14,14 @@
 #include "Definitions.hpp"
 #include "NodeData.hpp"
 #include "StyleCollection.hpp"
+#include "TextCache.hpp"
 
 namespace QtNodes {
 
-QPainterPath DefaultConnectionPainter::cubicPath(ConnectionGraphicsObject const &connection) const
+QPainterPath const &DefaultConnectionPainter::cubicPath(
+    ConnectionGraphicsObject const &connection) const
 {
-    QPointF const &in = connection.endPoint(PortType::In);
-    QPointF const &out = connection.endPoint(PortType::Out);
-
-    auto const c1c2 = connection.pointsC1C2();
-
-    // cubic spline
-    QPainterPath cubic(out);
-
-    cubic.cubicTo(c1c2.first, c1c2.second, in);
-
-    return cubic;
+    return connection.cubicPath();
 }
 
 void DefaultConnectionPainter::drawSketchLine(QPainter *painter, ConnectionGraphicsObject const &cgo) const
@@ -32,7 +29,7 @@ void DefaultConnectionPainter::drawSketchLine(QPainter *painter, ConnectionGraph
     ConnectionState const &state = cgo.connectionState();
 
     if (state.requiresPort()) {
-        auto const &connectionStyle = QtNodes::StyleCollection::connectionStyle();
+        auto const &connectionStyle = cgo.nodeScene()->styleContext().connectionStyle();
 
         QPen pen;
         pen.setWidth(static_cast<int>(connectionStyle.constructionLineWidth()));
@@ -42,21 +39,22 @@ void DefaultConnectionPainter::drawSketchLine(QPainter *painter, ConnectionGraph
         painter->setPen(pen);
         painter->setBrush(Qt::NoBrush);
 
-        auto cubic = cubicPath(cgo);
+        auto const &cubic = cubicPath(cgo);
 
         // cubic spline
         painter->drawPath(cubic);
     }
 }
 
-void DefaultConnectionPainter::drawHoveredOrSelected(QPainter *painter, ConnectionGraphicsObject const &cgo) const
+void DefaultConnectionPainter::drawHoveredOrSelected(QPainter *painter,
+                                                     ConnectionPaintContext const &context) const
 {
-    bool const hovered = cgo.connectionState().hovered();
-    bool const selected = cgo.isSelected();
+    bool const hovered = context.hovered;
+    bool const selected = context.selected;
 
     // drawn as a fat background
     if (hovered || selected) {
-        auto const &connectionStyle = QtNodes::StyleCollection::connectionStyle();
+        auto const &connectionStyle = context.styleContext().connectionStyle();
 
         double const lineWidth = connectionStyle.lineWidth();
 
@@ -69,21 +67,52 @@ void DefaultConnectionPainter::drawHoveredOrSelected(QPainter *painter, Connecti
         painter->setBrush(Qt::NoBrush);
 
         // cubic spline
-        auto const cubic = cubicPath(cgo);
-        painter->drawPath(cubic);
+        painter->drawPath(context.path);
     }
 }
 
-void DefaultConnectionPainter::drawNormalLine(QPainter *painter, ConnectionGraphicsObject const &cgo) const
+void DefaultConnectionPainter::validateCache(StyleContext const &styles) const
 {
-    ConnectionState const &state = cgo.connectionState();
+    unsigned int const revision = styles.revision();
 
-    if (state.requiresPort())
+    if (_cacheValid && _styleRevision == revision)
         return;
 
-    // colors
+    _penCache.clear();
+    _converterPixmap = QPixmap();
+    _converterImage = QImage();
+    _styleRevision = revision;
+    _cacheValid = true;
+}
+
+DefaultConnectionPainter::CachedPens const &DefaultConnectionPainter::cachedPens(
+    ConnectionPaintContext const &context) const
+{
+    auto const &connectionStyle = context.styleContext().connectionStyle();
 
-    auto const &connectionStyle = QtNodes::StyleCollection::connectionStyle();
+    QColor const connectionColor = context.color;
+
+    PenKey key{InvalidNodeDataTypeId,
+               InvalidNodeDataTypeId,
+               context.selected,
+               connectionColor.isValid(),
+               connectionColor.isValid() ? connectionColor.rgba() : 0u};
+
+    if (connectionStyle.useDataDefinedColors()) {
+        AbstractGraphModel const &graphModel = context.model;
+
+        auto const cId = context.connectionId;
+
+        key.outType = graphModel.portDataTypeId(cId.outNodeId, PortType::Out, cId.outPortIndex);
+        key.inType = graphModel.portDataTypeId(cId.inNodeId, PortType::In, cId.inPortIndex);
+    }
+
+    auto it = _penCache.find(key);
+
+    if (it != _penCache.end())
+        return it->second;
+
+    // colors
 
     QColor normalColorOut = connectionStyle.normalColor();
     QColor normalColorIn = connectionStyle.normalColor();
@@ -91,122 +120,245 @@ void DefaultConnectionPainter::drawNormalLine(QPainter *painter, ConnectionGraph
 
     bool useGradientColor = false;
 
-    AbstractGraphModel const &graphModel = cgo.graphModel();
-
     if (connectionStyle.useDataDefinedColors()) {
-        using QtNodes::PortType;
+        useGradientColor = (key.outType != key.inType);
 
-        auto const cId = cgo.connectionId();
+        normalColorOut = connectionStyle.normalColor(key.outType);
+        normalColorIn = connectionStyle.normalColor(key.inType);
+        selectedColor = normalColorOut.darker(200);
+    }
 
-        auto dataTypeOut = graphModel
-                               .portData(cId.outNodeId,
-                                         PortType::Out,
-                                         cId.outPortIndex,
-                                         PortRole::DataType)
-                               .value<NodeDataType>();
+    double const lineWidth = connectionStyle.lineWidth();
 
-        auto dataTypeIn
-            = graphModel.portData(cId.inNodeId, PortType::In, cId.inPortIndex, PortRole::DataType)
-                  .value<NodeDataType>();
+    CachedPens pens;
+    pens.converter = useGradientColor;
+    pens.out.setWidth(static_cast<int>(lineWidth));
+    pens.in.setWidth(static_cast<int>(lineWidth));
 
-        useGradientColor = (dataTypeOut.id != dataTypeIn.id);
+    if (useGradientColor) {
+        pens.out.setColor(key.selected ? normalColorOut.darker(200) : normalColorOut);
+        pens.in.setColor(key.selected ? normalColorIn.darker(200) : normalColorIn);
+    } else if (key.selected) {
+        pens.out.setColor(selectedColor);
+    } else {
+        pens.out.setColor(connectionColor.isValid() ? connectionColor : normalColorOut);
+    }
 
-        normalColorOut = connectionStyle.normalColor(dataTypeOut.id);
-        normalColorIn = connectionStyle.normalColor(dataTypeIn.id);
-        selectedColor = normalColorOut.darker(200);
+    return _penCache.emplace(key, pens).first->second;
+}
+
+QPixmap const &DefaultConnectionPainter::converterPixmap() const
+{
+    if (_converterPixmap.isNull()) {
+        QIcon icon(":convert.png");
+
+        _converterPixmap = icon.pixmap(QSize(22, 22));
     }
 
-    // geometry
+    return _converterPixmap;
+}
 
-    double const lineWidth = connectionStyle.lineWidth();
+QImage const &DefaultConnectionPainter::converterImage() const
+{
+    if (_converterImage.isNull()) {
+        _converterImage = QImage(":convert.png").scaled(22,
+                                                        22,
+                                                        Qt::KeepAspectRatio,
+                                                        Qt::SmoothTransformation);
+    }
 
-    // draw normal line
-    QPen p;
+    return _converterImage;
+}
 
-    p.setWidth(lineWidth);
+QPolygonF DefaultConnectionPainter::flattenCubic(ConnectionPaintContext const &context,
+                                                unsigned int const segments)
+{
+    QPointF const p0 = context.out;
+    QPointF const p3 = context.in;
 
-    bool const selected = cgo.isSelected();
+    auto const &c1c2 = context.c1c2;
 
-    auto cubic = cubicPath(cgo);
-    if (useGradientColor) {
-        painter->setBrush(Qt::NoBrush);
+    QPolygonF polygon;
+    polygon.reserve(static_cast<int>(segments) + 1);
 
-        QColor cOut = normalColorOut;
-        if (selected)
-            cOut = cOut.darker(200);
-        p.setColor(cOut);
-        painter->setPen(p);
+    for (unsigned int i = 0; i <= segments; ++i) {
+        double const t = double(i) / segments;
+        double const u = 1.0 - t;
 
-        unsigned int constexpr segments = 60;
+        polygon << u * u * u * p0 + 3.0 * u * u * t * c1c2.first + 3.0 * u * t * t * c1c2.second
+                       + t * t * t * p3;
+    }
 
-        for (unsigned int i = 0ul; i < segments; ++i) {
-            double ratioPrev = double(i) / segments;
-            double ratio = double(i + 1) / segments;
+    return polygon;
+}
 
-            if (i == segments / 2) {
-                QColor cIn = normalColorIn;
-                if (selected)
-                    cIn = cIn.darker(200);
+unsigned int DefaultConnectionPainter::cubicSegments(ConnectionPaintContext const &context,
+                                                    qreal const lod)
+{
+    auto const &c1c2 = context.c1c2;
 
-                p.setColor(cIn);
-                painter->setPen(p);
-            }
-            painter->drawLine(cubic.pointAtPercent(ratioPrev), cubic.pointAtPercent(ratio));
-        }
+    qreal const length = QLineF(context.out, c1c2.first).length()
+                         + QLineF(c1c2.first, c1c2.second).length()
+                         + QLineF(c1c2.second, context.in).length();
 
-        {
-            QIcon icon(":convert.png");
+    qreal const pixelsPerSegment = 8.0;
 
-            QPixmap pixmap = icon.pixmap(QSize(22, 22));
-            painter->drawPixmap(cubic.pointAtPercent(0.50)
-                                    - QPoint(pixmap.width() / 2, pixmap.height() / 2),
+    auto const segments = static_cast<unsigned int>(std::ceil(length * lod / pixelsPerSegment));
+
+    return std::min(64u, std::max(4u, (segments + 1) & ~1u));
+}
+
+void DefaultConnectionPainter::drawNormalLine(QPainter *painter,
+                                              ConnectionPaintContext const &context,
+                                              qreal const lod,
+                                              bool const headless) const
+{
+    StyleContext const &styles = context.styleContext();
+
+    validateCache(styles);
+
+    CachedPens const &pens = cachedPens(context);
+
+    auto const &connectionStyle = styles.connectionStyle();
+
+    painter->setBrush(Qt::NoBrush);
+
+    if (lod < connectionStyle.straightLevelOfDetail()) {
+        painter->setPen(pens.out);
+        painter->drawLine(context.out, context.in);
+        return;
+    }
+
+    bool const polyline = lod < connectionStyle.polylineLevelOfDetail();
+
+    if (pens.converter) {
+        // Each half gets the color of its port type, one polyline per half
+        // with as many segments as the curve needs on screen.
+        unsigned int const segments = polyline ? std::min(8u, cubicSegments(context, lod))
+                                               : cubicSegments(context, lod);
+
+        QPolygonF const points = flattenCubic(context, segments);
+
+        int const half = static_cast<int>(segments / 2);
+
+        painter->setPen(pens.out);
+        painter->drawPolyline(points.constData(), half + 1);
+
+        painter->setPen(pens.in);
+        painter->drawPolyline(points.constData() + half, points.size() - half);
+
+        if (lod >= connectionStyle.detailsLevelOfDetail() && headless) {
+            QImage const &image = converterImage();
+            painter->drawImage(points[half] - QPoint(image.width() / 2, image.height() / 2), image);
+        } else if (lod >= connectionStyle.detailsLevelOfDetail()) {
+            QPixmap const &pixmap = converterPixmap();
+            painter->drawPixmap(points[half] - QPoint(pixmap.width() / 2, pixmap.height() / 2),
                                 pixmap);
         }
-    }
-    else
-    {
-        p.setColor(normalColorOut);
-        QColor connectionColor = cgo.getConnectionColor();
-        if (selected) {
-                p.setColor(selectedColor);
-            } else {
-                p.setColor(connectionColor.isValid() ? connectionColor : normalColorOut);
-            }
-
-        painter->setPen(p);
-        painter->setBrush(Qt::NoBrush);
+    } else if (polyline) {
+        painter->setPen(pens.out);
 
-        painter->drawPath(cubic);
+        painter->drawPolyline(flattenCubic(context, std::min(8u, cubicSegments(context, lod))));
+    } else {
+        painter->setPen(pens.out);
+
+        painter->drawPath(context.path);
     }
 }
 
 void DefaultConnectionPainter::paint(QPainter *painter, ConnectionGraphicsObject const &cgo) const
 {
-    drawHoveredOrSelected(painter, cgo);
+    qreal const lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+        painter->worldTransform());
+
+    // Connections shorter than a pixel on screen are not worth a draw call.
+    QRectF const bounds = cgo.boundingRect();
+
+    if (std::max(bounds.width(), bounds.height()) * lod < 1.0)
+        return;
+
+    ConnectionPaintContext const context{cgo.graphModel(),
+                                         cgo.connectionId(),
+                                         cgo.out(),
+                                         cgo.in(),
+                                         cgo.pointsC1C2(),
+                                         cubicPath(cgo),
+                                         cgo.isSelected(),
+                                         cgo.connectionState().hovered()
+                                             && !cgo.nodeScene()->hoverOverlay(),
+                                         cgo.getConnectionColor(),
+                                         cgo.label(),
+                                         cgo.labelRect(),
+                                         &cgo.nodeScene()->styleContext()};
+
+    paintLayers(painter, context, lod, &cgo);
+}
+
+void DefaultConnectionPainter::paintHeadless(QPainter *painter,
+                                             ConnectionPaintContext const &context) const
+{
+    qreal const lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+        painter->worldTransform());
 
-    drawSketchLine(painter, cgo);
+    paintLayers(painter, context, lod, nullptr);
+}
+
+void DefaultConnectionPainter::paintLayers(QPainter *painter,
+                                           ConnectionPaintContext const &context,
+                                           qreal const lod,
+                                           ConnectionGraphicsObject const *cgo) const
+{
+    auto const &connectionStyle = context.styleContext().connectionStyle();
 
-    drawNormalLine(painter, cgo);
+    bool const details = lod >= connectionStyle.detailsLevelOfDetail();
+
+    if (details)
+        drawHoveredOrSelected(painter, context);
+
+    // Only the draft connection of a scene requires a port.
+    if (cgo && cgo->connectionState().requiresPort())
+        drawSketchLine(painter, *cgo);
+    else
+        drawNormalLine(painter, context, lod, cgo == nullptr);
 
 #ifdef NODE_DEBUG_DRAWING
-    debugDrawing(painter, cgo);
+    if (cgo)
+        debugDrawing(painter, *cgo);
 #endif
 
-    // draw end points
-    auto const &connectionStyle = QtNodes::StyleCollection::connectionStyle();
+    if (!details)
+        return;
 
+    // draw end points
     double const pointDiameter = connectionStyle.pointDiameter();
 
     painter->setPen(connectionStyle.constructionColor());
     painter->setBrush(connectionStyle.constructionColor());
     double const pointRadius = pointDiameter / 2.0;
-    painter->drawEllipse(cgo.out(), pointRadius, pointRadius);
-    painter->drawEllipse(cgo.in(), pointRadius, pointRadius);
+    painter->drawEllipse(context.out, pointRadius, pointRadius);
+    painter->drawEllipse(context.in, pointRadius, pointRadius);
+
+    drawLabel(painter, context);
+}
+
+void DefaultConnectionPainter::drawLabel(QPainter *painter,
+                                         ConnectionPaintContext const &context) const
+{
+    if (context.label.isEmpty())
+        return;
+
+    QFont const &font = ConnectionGraphicsObject::labelFont();
+
+    painter->setFont(font);
+    painter->setPen(Qt::white);
+
+    painter->drawStaticText(context.labelRect.topLeft(),
+                            TextCache::instance().staticText(font, context.label));
 }
 
 QPainterPath DefaultConnectionPainter::getPainterStroke(ConnectionGraphicsObject const &connection) const
 {
-    auto cubic = cubicPath(connection);
+    auto const &cubic = cubicPath(connection);
 
     QPointF const &out = connection.endPoint(PortType::Out);
     QPainterPath result(out);
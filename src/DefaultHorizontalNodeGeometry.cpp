@@ -2,6 +2,7 @@
 
 #include "AbstractGraphModel.hpp"
 #include "NodeData.hpp"
+#include "TextCache.hpp"
 
 #include <QPoint>
 #include <QRect>
@@ -16,9 +17,8 @@ DefaultHorizontalNodeGeometry::DefaultHorizontalNodeGeometry(AbstractGraphModel
     , _fontMetrics(QFont())
     , _boldFontMetrics(QFont())
 {
-    QFont f;
-    f.setBold(true);
-    _boldFontMetrics = QFontMetrics(f);
+    _boldFont.setBold(true);
+    _boldFontMetrics = QFontMetrics(_boldFont);
 
     _portSize = _fontMetrics.height();
 }
@@ -30,26 +30,32 @@ QSize DefaultHorizontalNodeGeometry::size(NodeId const nodeId) const
 
 void DefaultHorizontalNodeGeometry::recomputeSize(NodeId const nodeId) const
 {
+    invalidateLayout(nodeId);
+
+    NodeLayout const &measured = measuredLayout(nodeId);
+
     unsigned int height = maxVerticalPortsExtent(nodeId);
 
-    if (auto w = _graphModel.nodeData<QWidget *>(nodeId, NodeRole::Widget)) {
-        height = std::max(height, static_cast<unsigned int>(w->height()));
+    QSize const widget = widgetSize(nodeId);
+
+    if (widget.isValid()) {
+        height = std::max(height, static_cast<unsigned int>(widget.height()));
     }
 
-    QRectF const capRect = captionRect(nodeId);
+    QRectF const capRect = measured.captionRect;
 
     height += capRect.height();
 
     height += _portSpasing; // space above caption
     height += _portSpasing; // space below caption
 
-    unsigned int inPortWidth = maxPortsTextAdvance(nodeId, PortType::In);
-    unsigned int outPortWidth = maxPortsTextAdvance(nodeId, PortType::Out);
+    unsigned int inPortWidth = measured.portTextAdvance[static_cast<int>(PortType::In)];
+    unsigned int outPortWidth = measured.portTextAdvance[static_cast<int>(PortType::Out)];
 
     unsigned int width = inPortWidth + outPortWidth + 4 * _portSpasing;
 
-    if (auto w = _graphModel.nodeData<QWidget *>(nodeId, NodeRole::Widget)) {
-        width += w->width();
+    if (widget.isValid()) {
+        width += widget.width();
     }
 
     width = std::max(width, static_cast<unsigned int>(capRect.width()) + 2 * _portSpasing);
@@ -57,11 +63,135 @@ void DefaultHorizontalNodeGeometry::recomputeSize(NodeId const nodeId) const
     QSize size(width, height);
 
     _graphModel.setNodeData(nodeId, NodeRole::Size, size);
+    _graphModel.setNodeData(nodeId, NodeRole::LayoutKey, layoutKey());
 }
 
 QPointF DefaultHorizontalNodeGeometry::portPosition(NodeId const nodeId,
                                                     PortType const portType,
                                                     PortIndex const portIndex) const
+{
+    if (portType == PortType::None)
+        return QPointF();
+
+    NodeLayout const &l = layout(nodeId);
+
+    auto const &positions = l.portPositions[static_cast<int>(portType)];
+
+    if (portIndex < positions.size())
+        return positions[portIndex];
+
+    return placePort(l, portType, portIndex);
+}
+
+QPointF DefaultHorizontalNodeGeometry::portTextPosition(NodeId const nodeId,
+                                                        PortType const portType,
+                                                        PortIndex const portIndex) const
+{
+    if (portType == PortType::None)
+        return QPointF();
+
+    NodeLayout const &l = layout(nodeId);
+
+    auto const &positions = l.portTextPositions[static_cast<int>(portType)];
+
+    if (portIndex < positions.size())
+        return positions[portIndex];
+
+    // Ports inserted since the last `nodeUpdated`.
+    return placePortText(nodeId,
+                         l,
+                         portType,
+                         portIndex,
+                         portTextRect(nodeId, portType, portIndex));
+}
+
+QRectF DefaultHorizontalNodeGeometry::captionRect(NodeId const nodeId) const
+{
+    return measuredLayout(nodeId).captionRect;
+}
+
+QPointF DefaultHorizontalNodeGeometry::captionPosition(NodeId const nodeId) const
+{
+    return layout(nodeId).captionPosition;
+}
+
+QPointF DefaultHorizontalNodeGeometry::widgetPosition(NodeId const nodeId) const
+{
+    return layout(nodeId).widgetPosition;
+}
+
+void DefaultHorizontalNodeGeometry::measureLayout(NodeId const nodeId, NodeLayout &layout) const
+{
+    layout.captionRect = measureCaptionRect(nodeId);
+
+    for (PortType const portType : {PortType::In, PortType::Out}) {
+        int const side = static_cast<int>(portType);
+
+        PortCount const n = _graphModel.nodeData<PortCount>(nodeId,
+                                                            (portType == PortType::Out)
+                                                                ? NodeRole::OutPortCount
+                                                                : NodeRole::InPortCount);
+
+        layout.portTextRects[side].clear();
+
+        for (PortIndex portIndex = 0; portIndex < n; ++portIndex) {
+            layout.portTextRects[side].push_back(portTextRect(nodeId, portType, portIndex));
+        }
+
+        layout.portTextAdvance[side] = maxPortsTextAdvance(nodeId, portType);
+    }
+}
+
+void DefaultHorizontalNodeGeometry::placeLayout(NodeId const nodeId, NodeLayout &layout) const
+{
+    QSize const size = layout.size;
+
+    QRectF const capRect = layout.captionRect;
+
+    layout.captionPosition = QPointF(0.5 * (size.width() - capRect.width()),
+                                     0.5 * _portSpasing + capRect.height());
+
+    for (PortType const portType : {PortType::In, PortType::Out}) {
+        int const side = static_cast<int>(portType);
+
+        auto const &textRects = layout.portTextRects[side];
+
+        layout.portPositions[side].clear();
+        layout.portTextPositions[side].clear();
+
+        for (PortIndex portIndex = 0; portIndex < textRects.size(); ++portIndex) {
+            layout.portPositions[side].push_back(placePort(layout, portType, portIndex));
+            layout.portTextPositions[side].push_back(
+                placePortText(nodeId, layout, portType, portIndex, textRects[portIndex]));
+        }
+    }
+
+    layout.widgetPosition = QPointF();
+
+    unsigned int captionHeight = capRect.height();
+
+    unsigned int const inPortWidth = layout.portTextAdvance[static_cast<int>(PortType::In)];
+
+    QSize const widget = widgetSize(nodeId);
+
+    if (widget.isValid()) {
+        auto w = createdWidget(nodeId);
+
+        // If the widget wants to use as much vertical space as possible,
+        // place it immediately after the caption.
+        if (w && (w->sizePolicy().verticalPolicy() & QSizePolicy::ExpandFlag)) {
+            layout.widgetPosition = QPointF(2.0 * _portSpasing + inPortWidth, captionHeight);
+        } else {
+            layout.widgetPosition = QPointF(2.0 * _portSpasing + inPortWidth,
+                                            (captionHeight + size.height() - widget.height())
+                                                / 2.0);
+        }
+    }
+}
+
+QPointF DefaultHorizontalNodeGeometry::placePort(NodeLayout const &layout,
+                                                 PortType const portType,
+                                                 PortIndex const portIndex) const
 {
     unsigned int const step = _portSize + _portSpasing;
 
@@ -69,14 +199,12 @@ QPointF DefaultHorizontalNodeGeometry::portPosition(NodeId const nodeId,
 
     double totalHeight = 0.0;
 
-    totalHeight += captionRect(nodeId).height();
+    totalHeight += layout.captionRect.height();
     totalHeight += _portSpasing;
 
     totalHeight += step * portIndex;
     totalHeight += step / 2.0;
 
-    QSize size = _graphModel.nodeData<QSize>(nodeId, NodeRole::Size);
-
     switch (portType) {
     case PortType::In: {
         double x = 0.0;
@@ -86,7 +214,7 @@ QPointF DefaultHorizontalNodeGeometry::portPosition(NodeId const nodeId,
     }
 
     case PortType::Out: {
-        double x = size.width();
+        double x = layout.size.width();
 
         result = QPointF(x, totalHeight);
         break;
@@ -99,15 +227,15 @@ QPointF DefaultHorizontalNodeGeometry::portPosition(NodeId const nodeId,
     return result;
 }
 
-QPointF DefaultHorizontalNodeGeometry::portTextPosition(NodeId const nodeId,
-                                                        PortType const portType,
-                                                        PortIndex const portIndex) const
+QPointF DefaultHorizontalNodeGeometry::placePortText(NodeId const nodeId,
+                                                     NodeLayout const &layout,
+                                                     PortType const portType,
+                                                     PortIndex const portIndex,
+                                                     QRectF const &textRect) const
 {
-    QPointF p = portPosition(nodeId, portType, portIndex);
+    QPointF p = placePort(layout, portType, portIndex);
 
-    QRectF rect = portTextRect(nodeId, portType, portIndex);
-
-    p.setY(p.y() + rect.height() / 4.0);
+    p.setY(p.y() + textRect.height() / 4.0);
 
     switch (portType) {
     case PortType::In:
@@ -130,41 +258,14 @@ QPointF DefaultHorizontalNodeGeometry::portTextPosition(NodeId const nodeId,
     return p;
 }
 
-QRectF DefaultHorizontalNodeGeometry::captionRect(NodeId const nodeId) const
+QRectF DefaultHorizontalNodeGeometry::measureCaptionRect(NodeId const nodeId) const
 {
     if (!_graphModel.nodeData<bool>(nodeId, NodeRole::CaptionVisible))
         return QRect();
 
     QString name = _graphModel.nodeData<QString>(nodeId, NodeRole::Caption);
 
-    return _boldFontMetrics.boundingRect(name);
-}
-
-QPointF DefaultHorizontalNodeGeometry::captionPosition(NodeId const nodeId) const
-{
-    QSize size = _graphModel.nodeData<QSize>(nodeId, NodeRole::Size);
-    return QPointF(0.5 * (size.width() - captionRect(nodeId).width()),
-                   0.5 * _portSpasing + captionRect(nodeId).height());
-}
-
-QPointF DefaultHorizontalNodeGeometry::widgetPosition(NodeId const nodeId) const
-{
-    QSize size = _graphModel.nodeData<QSize>(nodeId, NodeRole::Size);
-
-    unsigned int captionHeight = captionRect(nodeId).height();
-
-    if (auto w = _graphModel.nodeData<QWidget *>(nodeId, NodeRole::Widget)) {
-        // If the widget wants to use as much vertical space as possible,
-        // place it immediately after the caption.
-        if (w->sizePolicy().verticalPolicy() & QSizePolicy::ExpandFlag) {
-            return QPointF(2.0 * _portSpasing + maxPortsTextAdvance(nodeId, PortType::In),
-                           captionHeight);
-        } else {
-            return QPointF(2.0 * _portSpasing + maxPortsTextAdvance(nodeId, PortType::In),
-                           (captionHeight + size.height() - w->height()) / 2.0);
-        }
-    }
-    return QPointF();
+    return TextCache::instance().boundingRect(_boldFont, name);
 }
 
 QRect DefaultHorizontalNodeGeometry::resizeHandleRect(NodeId const nodeId) const
@@ -189,7 +290,7 @@ QRectF DefaultHorizontalNodeGeometry::portTextRect(NodeId const nodeId,
         s = portData.value<NodeDataType>().name;
     }
 
-    return _fontMetrics.boundingRect(s);
+    return TextCache::instance().boundingRect(_font, s);
 }
 
 unsigned int DefaultHorizontalNodeGeometry::maxVerticalPortsExtent(NodeId const nodeId) const
@@ -229,11 +330,7 @@ unsigned int DefaultHorizontalNodeGeometry::maxPortsTextAdvance(NodeId const nod
             name = portData.name;
         }
 
-#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
-        width = std::max(unsigned(_fontMetrics.horizontalAdvance(name)), width);
-#else
-        width = std::max(unsigned(_fontMetrics.width(name)), width);
-#endif
+        width = std::max(unsigned(TextCache::instance().horizontalAdvance(_font, name)), width);
     }
 
     return width;
@@ -1,8 +1,13 @@
 #include "DefaultNodePainter.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
 #include <QtCore/QMargins>
+#include <QtGui/QImage>
+#include <QtWidgets/QStyleOptionGraphicsItem>
+#include <QtWidgets/qdrawutil.h>
 
 #include "AbstractGraphModel.hpp"
 #include "AbstractNodeGeometry.hpp"
@@ -12,45 +17,224 @@
 #include "NodeGraphicsObject.hpp"
 #include "NodeState.hpp"
 #include "StyleCollection.hpp"
+#include "TextCache.hpp"
 
 namespace QtNodes {
 
+namespace {
+
+/// Extent of the shadow blur around the node, matching the margins most
+/// nodes get from `AbstractNodeGeometry::boundingRect`.
+constexpr int ShadowBlur = 12;
+
+constexpr int ShadowOffset = 4;
+
+/// Rounding of the node rectangle.
+constexpr int ShadowCorner = 3;
+
+/// Slice size of the shadow texture: blur plus rounding.
+constexpr int ShadowMargin = ShadowBlur + ShadowCorner;
+
+/// Three passes of a box blur, close to a Gaussian, along one axis.
+void blurAlpha(std::vector<float> &alpha, int const size, int const radius, bool const rows)
+{
+    std::vector<float> line(size);
+
+    for (int pass = 0; pass < 3; ++pass) {
+        for (int l = 0; l < size; ++l) {
+            auto at = [&](int i) -> float & {
+                return rows ? alpha[l * size + i] : alpha[i * size + l];
+            };
+
+            float sum = 0.0f;
+
+            for (int i = -radius; i <= radius; ++i) {
+                if (i >= 0 && i < size)
+                    sum += at(i);
+            }
+
+            for (int i = 0; i < size; ++i) {
+                line[i] = sum / (2 * radius + 1);
+
+                if (i + radius + 1 < size)
+                    sum += at(i + radius + 1);
+
+                if (i - radius >= 0)
+                    sum -= at(i - radius);
+            }
+
+            for (int i = 0; i < size; ++i) {
+                at(i) = line[i];
+            }
+        }
+    }
+}
+
+} // namespace
+
+NodePaintContext DefaultNodePainter::paintContext(NodeGraphicsObject &ngo)
+{
+    return NodePaintContext{ngo.graphModel(),
+                            ngo.nodeScene()->nodeGeometry(),
+                            ngo.nodeId(),
+                            ngo.nodeStyle(),
+                            ngo.isSelected(),
+                            ngo.nodeState().hovered() && !ngo.nodeScene()->hoverOverlay(),
+                            ngo.nodeScene()->computeHeatScale(),
+                            &ngo.nodeScene()->styleContext(),
+                            &ngo.nodeState()};
+}
+
 void DefaultNodePainter::paint(QPainter *painter, NodeGraphicsObject &ngo) const
 {
     // TODO?
     //AbstractNodeGeometry & geometry = ngo.nodeScene()->nodeGeometry();
     //geometry.recomputeSizeIfFontChanged(painter->font());
 
-    drawNodeRect(painter, ngo);
+    paintLayers(painter, paintContext(ngo), &ngo);
+}
+
+void DefaultNodePainter::paintHeadless(QPainter *painter, NodePaintContext const &context) const
+{
+    paintLayers(painter, context, nullptr);
+}
 
-    drawConnectionPoints(painter, ngo);
+void DefaultNodePainter::paintLayers(QPainter *painter,
+                                     NodePaintContext const &context,
+                                     NodeGraphicsObject *ngo) const
+{
+    NodeStyle const &nodeStyle = context.style;
+
+    qreal const lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+        painter->worldTransform());
+
+    if (lod < nodeStyle.DotLevelOfDetail) {
+        drawNodeDot(painter, context);
+        return;
+    }
 
-    drawFilledConnectionPoints(painter, ngo);
+    if (lod < nodeStyle.FlatLevelOfDetail) {
+        drawComputeHeat(painter, context);
 
-    drawNodeCaption(painter, ngo);
+        drawFlatNodeRect(painter, context);
 
-    drawEntryLabels(painter, ngo);
+        drawComputingState(painter, context);
+        return;
+    }
+
+    // The texture is a QPixmap, for the GUI thread only.
+    if (ngo)
+        drawNodeShadow(painter, *ngo);
+
+    drawComputeHeat(painter, context);
+
+    drawNodeRect(painter, context);
+
+    drawPortPoints(painter, context, ngo);
+
+    drawFilledConnectionPoints(painter, context);
+
+    // Texts are unreadable and the most expensive part at low zoom.
+    if (lod >= nodeStyle.LabelsLevelOfDetail) {
+        drawNodeCaption(painter, context);
+
+        drawEntryLabels(painter, context);
+    }
 
-    drawResizeRect(painter, ngo);
+    drawResizeRect(painter, context);
+
+    drawComputingState(painter, context);
 }
 
-void DefaultNodePainter::drawNodeRect(QPainter *painter, NodeGraphicsObject &ngo) const
+void DefaultNodePainter::drawNodeShadow(QPainter *painter, NodeGraphicsObject &ngo) const
 {
-    AbstractGraphModel &model = ngo.graphModel();
-
-    NodeId const nodeId = ngo.nodeId();
+    if (ngo.nodeScene()->nodeShadowMode() != BasicGraphicsScene::NodeShadowMode::Texture)
+        return;
 
     AbstractNodeGeometry &geometry = ngo.nodeScene()->nodeGeometry();
 
-    QSize size = geometry.size(nodeId);
+    QRectF const node(QPointF(ShadowOffset, ShadowOffset), geometry.size(ngo.nodeId()));
+
+    QPixmap const &texture = shadowTexture(ngo.nodeStyle().ShadowColor);
+
+    QMargins const margins(ShadowMargin, ShadowMargin, ShadowMargin, ShadowMargin);
+
+    qDrawBorderPixmap(painter,
+                      node.adjusted(-ShadowBlur, -ShadowBlur, ShadowBlur, ShadowBlur).toRect(),
+                      margins,
+                      texture,
+                      texture.rect(),
+                      margins,
+                      QTileRules(Qt::StretchTile));
+}
+
+QPixmap const &DefaultNodePainter::shadowTexture(QColor const &color) const
+{
+    QRgb const key = color.rgba();
+
+    auto it = _shadowTextures.find(key);
+
+    if (it != _shadowTextures.end())
+        return it->second;
+
+    // The rounded rectangle shrinks to its corners plus one stretched pixel.
+    int const size = 2 * ShadowMargin + 1;
+
+    QImage mask(size, size, QImage::Format_Alpha8);
+    mask.fill(Qt::transparent);
+
+    {
+        QPainter p(&mask);
+        p.setRenderHint(QPainter::Antialiasing);
+        p.setPen(Qt::NoPen);
+        p.setBrush(Qt::black);
+        p.drawRoundedRect(QRectF(ShadowBlur, ShadowBlur, size - 2 * ShadowBlur, size - 2 * ShadowBlur),
+                          ShadowCorner,
+                          ShadowCorner);
+    }
+
+    std::vector<float> alpha(size * size);
+
+    for (int y = 0; y < size; ++y) {
+        uchar const *line = mask.constScanLine(y);
+
+        for (int x = 0; x < size; ++x) {
+            alpha[y * size + x] = line[x] / 255.0f;
+        }
+    }
+
+    blurAlpha(alpha, size, ShadowBlur / 3, true);
+    blurAlpha(alpha, size, ShadowBlur / 3, false);
+
+    QImage image(size, size, QImage::Format_ARGB32_Premultiplied);
 
-    QJsonDocument json = QJsonDocument::fromVariant(model.nodeData(nodeId, NodeRole::Style));
+    for (int y = 0; y < size; ++y) {
+        auto line = reinterpret_cast<QRgb *>(image.scanLine(y));
 
-    NodeStyle nodeStyle(json.object());
+        for (int x = 0; x < size; ++x) {
+            int const a = qRound(alpha[y * size + x] * color.alpha());
+
+            line[x] = qPremultiply(qRgba(color.red(), color.green(), color.blue(), a));
+        }
+    }
 
-    auto color = ngo.isSelected() ? nodeStyle.SelectedBoundaryColor : nodeStyle.NormalBoundaryColor;
+    return _shadowTextures.emplace(key, QPixmap::fromImage(image)).first->second;
+}
+
+void DefaultNodePainter::drawNodeRect(QPainter *painter, NodeGraphicsObject &ngo) const
+{
+    drawNodeRect(painter, paintContext(ngo));
+}
 
-    if (ngo.nodeState().hovered()) {
+void DefaultNodePainter::drawNodeRect(QPainter *painter, NodePaintContext const &context) const
+{
+    QSize size = context.geometry.size(context.nodeId);
+
+    NodeStyle const &nodeStyle = context.style;
+
+    auto color = context.selected ? nodeStyle.SelectedBoundaryColor : nodeStyle.NormalBoundaryColor;
+
+    if (context.hovered) {
         QPen p(color, nodeStyle.HoveredPenWidth);
         painter->setPen(p);
     } else {
@@ -74,20 +258,71 @@ void DefaultNodePainter::drawNodeRect(QPainter *painter, NodeGraphicsObject &ngo
     painter->drawRoundedRect(boundary, radius, radius);
 }
 
+void DefaultNodePainter::drawFlatNodeRect(QPainter *painter, NodeGraphicsObject &ngo) const
+{
+    drawFlatNodeRect(painter, paintContext(ngo));
+}
+
+void DefaultNodePainter::drawFlatNodeRect(QPainter *painter, NodePaintContext const &context) const
+{
+    QSize const size = context.geometry.size(context.nodeId);
+
+    NodeStyle const &nodeStyle = context.style;
+
+    QPen pen(context.selected ? nodeStyle.SelectedBoundaryColor : nodeStyle.NormalBoundaryColor);
+    pen.setCosmetic(true);
+
+    painter->setPen(pen);
+    painter->setBrush(nodeStyle.GradientColor1);
+
+    painter->drawRect(QRectF(0, 0, size.width(), size.height()));
+}
+
+void DefaultNodePainter::drawNodeDot(QPainter *painter, NodeGraphicsObject &ngo) const
+{
+    drawNodeDot(painter, paintContext(ngo));
+}
+
+void DefaultNodePainter::drawNodeDot(QPainter *painter, NodePaintContext const &context) const
+{
+    QSize const size = context.geometry.size(context.nodeId);
+
+    NodeStyle const &nodeStyle = context.style;
+
+    painter->fillRect(QRectF(0, 0, size.width(), size.height()),
+                      context.selected ? nodeStyle.SelectedBoundaryColor
+                                       : nodeStyle.GradientColor0);
+}
+
 void DefaultNodePainter::drawConnectionPoints(QPainter *painter, NodeGraphicsObject &ngo) const
 {
-    AbstractGraphModel &model = ngo.graphModel();
-    NodeId const nodeId = ngo.nodeId();
-    AbstractNodeGeometry &geometry = ngo.nodeScene()->nodeGeometry();
+    drawPortPoints(painter, paintContext(ngo), &ngo);
+}
+
+void DefaultNodePainter::drawConnectionPoints(QPainter *painter,
+                                              NodePaintContext const &context) const
+{
+    drawPortPoints(painter, context, nullptr);
+}
+
+void DefaultNodePainter::drawPortPoints(QPainter *painter,
+                                        NodePaintContext const &context,
+                                        NodeGraphicsObject *ngo) const
+{
+    AbstractGraphModel &model = context.model;
+    NodeId const nodeId = context.nodeId;
+    AbstractNodeGeometry &geometry = context.geometry;
 
-    QJsonDocument json = QJsonDocument::fromVariant(model.nodeData(nodeId, NodeRole::Style));
-    NodeStyle nodeStyle(json.object());
+    NodeStyle const &nodeStyle = context.style;
 
-    auto const &connectionStyle = StyleCollection::connectionStyle();
+    auto const &connectionStyle = context.styleContext().connectionStyle();
 
     float diameter = nodeStyle.ConnectionPointDiameter;
     auto reducedDiameter = diameter * 0.6;
 
+    ConnectionGraphicsObject const *reaction = ngo ? ngo->nodeState().connectionForReaction()
+                                                   : nullptr;
+
     for (PortType portType : {PortType::Out, PortType::In}) {
         size_t const n = model
                              .nodeData(nodeId,
@@ -98,14 +333,11 @@ void DefaultNodePainter::drawConnectionPoints(QPainter *painter, NodeGraphicsObj
         for (PortIndex portIndex = 0; portIndex < n; ++portIndex) {
             QPointF p = geometry.portPosition(nodeId, portType, portIndex);
 
-            auto const &dataType = model.portData(nodeId, portType, portIndex, PortRole::DataType)
-                                       .value<NodeDataType>();
+            NodeDataTypeId const dataTypeId = model.portDataTypeId(nodeId, portType, portIndex);
 
             double r = 1.0;
 
-            NodeState const &state = ngo.nodeState();
-
-            if (auto const *cgo = state.connectionForReaction()) {
+            if (auto const *cgo = reaction) {
                 PortType requiredPort = cgo->connectionState().requiredPort();
 
                 if (requiredPort == portType) {
@@ -113,10 +345,11 @@ void DefaultNodePainter::drawConnectionPoints(QPainter *painter, NodeGraphicsObj
                                                                                  nodeId,
                                                                                  portIndex);
 
-                    bool const possible = model.connectionPossible(possibleConnectionId);
+                    bool const possible = ngo->nodeScene()->draftConnectionPossible(
+                        possibleConnectionId);
 
                     auto cp = cgo->sceneTransform().map(cgo->endPoint(requiredPort));
-                    cp = ngo.sceneTransform().inverted().map(cp);
+                    cp = ngo->sceneTransform().inverted().map(cp);
 
                     auto diff = cp - p;
                     double dist = std::sqrt(QPointF::dotProduct(diff, diff));
@@ -132,7 +365,7 @@ void DefaultNodePainter::drawConnectionPoints(QPainter *painter, NodeGraphicsObj
             }
 
             if (connectionStyle.useDataDefinedColors()) {
-                painter->setBrush(connectionStyle.normalColor(dataType.id));
+                painter->setBrush(connectionStyle.normalColor(dataTypeId));
             } else {
                 painter->setBrush(nodeStyle.ConnectionPointColor);
             }
@@ -141,19 +374,24 @@ void DefaultNodePainter::drawConnectionPoints(QPainter *painter, NodeGraphicsObj
         }
     }
 
-    if (ngo.nodeState().connectionForReaction()) {
-        ngo.nodeState().resetConnectionForReaction();
+    if (reaction) {
+        ngo->nodeState().resetConnectionForReaction();
     }
 }
 
 void DefaultNodePainter::drawFilledConnectionPoints(QPainter *painter, NodeGraphicsObject &ngo) const
 {
-    AbstractGraphModel &model = ngo.graphModel();
-    NodeId const nodeId = ngo.nodeId();
-    AbstractNodeGeometry &geometry = ngo.nodeScene()->nodeGeometry();
+    drawFilledConnectionPoints(painter, paintContext(ngo));
+}
+
+void DefaultNodePainter::drawFilledConnectionPoints(QPainter *painter,
+                                                    NodePaintContext const &context) const
+{
+    AbstractGraphModel &model = context.model;
+    NodeId const nodeId = context.nodeId;
+    AbstractNodeGeometry &geometry = context.geometry;
 
-    QJsonDocument json = QJsonDocument::fromVariant(model.nodeData(nodeId, NodeRole::Style));
-    NodeStyle nodeStyle(json.object());
+    NodeStyle const &nodeStyle = context.style;
 
     auto diameter = nodeStyle.ConnectionPointDiameter;
 
@@ -167,16 +405,13 @@ void DefaultNodePainter::drawFilledConnectionPoints(QPainter *painter, NodeGraph
         for (PortIndex portIndex = 0; portIndex < n; ++portIndex) {
             QPointF p = geometry.portPosition(nodeId, portType, portIndex);
 
-            auto const &connected = model.connections(nodeId, portType, portIndex);
-
-            if (!connected.empty()) {
-                auto const &dataType = model
-                                           .portData(nodeId, portType, portIndex, PortRole::DataType)
-                                           .value<NodeDataType>();
-
-                auto const &connectionStyle = StyleCollection::connectionStyle();
+            if (context.connectionCount(portType, portIndex) > 0) {
+                auto const &connectionStyle = context.styleContext().connectionStyle();
                 if (connectionStyle.useDataDefinedColors()) {
-                    QColor const c = connectionStyle.normalColor(dataType.id);
+                    NodeDataTypeId const dataTypeId = model.portDataTypeId(nodeId,
+                                                                           portType,
+                                                                           portIndex);
+                    QColor const c = connectionStyle.normalColor(dataTypeId);
                     painter->setPen(c);
                     painter->setBrush(c);
                 } else {
@@ -192,9 +427,14 @@ void DefaultNodePainter::drawFilledConnectionPoints(QPainter *painter, NodeGraph
 
 void DefaultNodePainter::drawNodeCaption(QPainter *painter, NodeGraphicsObject &ngo) const
 {
-    AbstractGraphModel &model = ngo.graphModel();
-    NodeId const nodeId = ngo.nodeId();
-    AbstractNodeGeometry &geometry = ngo.nodeScene()->nodeGeometry();
+    drawNodeCaption(painter, paintContext(ngo));
+}
+
+void DefaultNodePainter::drawNodeCaption(QPainter *painter, NodePaintContext const &context) const
+{
+    AbstractGraphModel &model = context.model;
+    NodeId const nodeId = context.nodeId;
+    AbstractNodeGeometry &geometry = context.geometry;
 
     if (!model.nodeData(nodeId, NodeRole::CaptionVisible).toBool())
         return;
@@ -207,19 +447,22 @@ void DefaultNodePainter::drawNodeCaption(QPainter *painter, NodeGraphicsObject &
 
     QPointF position = geometry.captionPosition(nodeId);
 
-    QJsonDocument json = QJsonDocument::fromVariant(model.nodeData(nodeId, NodeRole::Style));
-    NodeStyle nodeStyle(json.object());
+    NodeStyle const &nodeStyle = context.style;
+
+    TextCache &textCache = TextCache::instance();
 
     // Вычисляем ширину текста
-    QFontMetrics fontMetrics(f);
-    int textWidth = fontMetrics.width(name);
+    int textWidth = textCache.horizontalAdvance(f, name);
 
     position.setX(position.x() - textWidth / 2);
 
     painter->setFont(f);
     painter->setPen(nodeStyle.FontColor);
     position.setY(position.y() -25);
-    painter->drawText(position, name);
+
+    // Static text is placed by its top left corner, not the baseline.
+    position.setY(position.y() - textCache.ascent(f));
+    painter->drawStaticText(position, textCache.staticText(f, name));
 
     f.setBold(false);
     painter->setFont(f);
@@ -227,12 +470,22 @@ void DefaultNodePainter::drawNodeCaption(QPainter *painter, NodeGraphicsObject &
 
 void DefaultNodePainter::drawEntryLabels(QPainter *painter, NodeGraphicsObject &ngo) const
 {
-    AbstractGraphModel &model = ngo.graphModel();
-    NodeId const nodeId = ngo.nodeId();
-    AbstractNodeGeometry &geometry = ngo.nodeScene()->nodeGeometry();
+    drawEntryLabels(painter, paintContext(ngo));
+}
+
+void DefaultNodePainter::drawEntryLabels(QPainter *painter, NodePaintContext const &context) const
+{
+    AbstractGraphModel &model = context.model;
+    NodeId const nodeId = context.nodeId;
+    AbstractNodeGeometry &geometry = context.geometry;
 
-    QJsonDocument json = QJsonDocument::fromVariant(model.nodeData(nodeId, NodeRole::Style));
-    NodeStyle nodeStyle(json.object());
+    NodeStyle const &nodeStyle = context.style;
+
+    TextCache &textCache = TextCache::instance();
+
+    QFont const font = painter->font();
+
+    int const ascent = textCache.ascent(font);
 
     for (PortType portType : {PortType::Out, PortType::In}) {
         unsigned int n = model.nodeData<unsigned int>(nodeId,
@@ -241,11 +494,9 @@ void DefaultNodePainter::drawEntryLabels(QPainter *painter, NodeGraphicsObject &
                                                           : NodeRole::InPortCount);
 
         for (PortIndex portIndex = 0; portIndex < n; ++portIndex) {
-            auto const &connected = model.connections(nodeId, portType, portIndex);
-
             QPointF p = geometry.portTextPosition(nodeId, portType, portIndex);
 
-            if (connected.empty())
+            if (context.connectionCount(portType, portIndex) == 0)
                 painter->setPen(nodeStyle.FontColorFaded);
             else
                 painter->setPen(nodeStyle.FontColor);
@@ -260,16 +511,21 @@ void DefaultNodePainter::drawEntryLabels(QPainter *painter, NodeGraphicsObject &
                 s = portData.value<NodeDataType>().name;
             }
 
-            painter->drawText(p, s);
+            painter->drawStaticText(p - QPointF(0, ascent), textCache.staticText(font, s));
         }
     }
 }
 
 void DefaultNodePainter::drawResizeRect(QPainter *painter, NodeGraphicsObject &ngo) const
 {
-    AbstractGraphModel &model = ngo.graphModel();
-    NodeId const nodeId = ngo.nodeId();
-    AbstractNodeGeometry &geometry = ngo.nodeScene()->nodeGeometry();
+    drawResizeRect(painter, paintContext(ngo));
+}
+
+void DefaultNodePainter::drawResizeRect(QPainter *painter, NodePaintContext const &context) const
+{
+    AbstractGraphModel &model = context.model;
+    NodeId const nodeId = context.nodeId;
+    AbstractNodeGeometry &geometry = context.geometry;
 
     if (model.nodeFlags(nodeId) & NodeFlag::Resizable) {
         painter->setBrush(Qt::gray);
@@ -278,4 +534,75 @@ void DefaultNodePainter::drawResizeRect(QPainter *painter, NodeGraphicsObject &n
     }
 }
 
+void DefaultNodePainter::drawComputeHeat(QPainter *painter, NodeGraphicsObject &ngo) const
+{
+    drawComputeHeat(painter, paintContext(ngo));
+}
+
+void DefaultNodePainter::drawComputeHeat(QPainter *painter, NodePaintContext const &context) const
+{
+    if (context.heatScale <= 0.0)
+        return;
+
+    QVariant const time = context.model.nodeData(context.nodeId, NodeRole::ComputeTime);
+
+    if (!time.isValid())
+        return;
+
+    // Logarithmic, so that a tenth of a millisecond still differs from nothing.
+    double const heat = std::min(1.0,
+                                 std::log1p(std::max(0.0, time.toDouble()))
+                                     / std::log1p(context.heatScale));
+
+    // Hue from green through yellow to red.
+    QColor const color = QColor::fromHsvF((1.0 - heat) / 3.0, 1.0, 1.0, 0.75);
+
+    QSize const size = context.geometry.size(context.nodeId);
+
+    double const width = 6.0;
+
+    // The node covers the inner half of the stroke.
+    painter->setPen(QPen(color, width));
+    painter->setBrush(Qt::NoBrush);
+
+    double const half = width / 2.0;
+
+    QRectF const boundary(-half, -half, size.width() + width, size.height() + width);
+
+    double const radius = 3.0 + half;
+
+    painter->drawRoundedRect(boundary, radius, radius);
+}
+
+void DefaultNodePainter::drawComputingState(QPainter *painter, NodeGraphicsObject &ngo) const
+{
+    drawComputingState(painter, paintContext(ngo));
+}
+
+void DefaultNodePainter::drawComputingState(QPainter *painter,
+                                            NodePaintContext const &context) const
+{
+    AbstractGraphModel &model = context.model;
+    NodeId const nodeId = context.nodeId;
+
+    if (!model.nodeData(nodeId, NodeRole::Computing).toBool())
+        return;
+
+    AbstractNodeGeometry &geometry = context.geometry;
+
+    QSize size = geometry.size(nodeId);
+
+    NodeStyle const &nodeStyle = context.style;
+
+    QPen p(nodeStyle.WarningColor, nodeStyle.HoveredPenWidth, Qt::DashLine);
+    painter->setPen(p);
+    painter->setBrush(Qt::NoBrush);
+
+    QRectF boundary(0, 0, size.width(), size.height());
+
+    double const radius = 3.0;
+
+    painter->drawRoundedRect(boundary, radius, radius);
+}
+
 } // namespace QtNodes
@@ -2,6 +2,7 @@
 
 #include "AbstractGraphModel.hpp"
 #include "NodeData.hpp"
+#include "TextCache.hpp"
 
 #include <QPoint>
 #include <QRect>
@@ -16,9 +17,8 @@ DefaultVerticalNodeGeometry::DefaultVerticalNodeGeometry(AbstractGraphModel &gra
     , _fontMetrics(QFont())
     , _boldFontMetrics(QFont())
 {
-    QFont f;
-    f.setBold(true);
-    _boldFontMetrics = QFontMetrics(f);
+    _boldFont.setBold(true);
+    _boldFontMetrics = QFontMetrics(_boldFont);
 
     _portSize = _fontMetrics.height();
 }
@@ -30,13 +30,19 @@ QSize DefaultVerticalNodeGeometry::size(NodeId const nodeId) const
 
 void DefaultVerticalNodeGeometry::recomputeSize(NodeId const nodeId) const
 {
+    invalidateLayout(nodeId);
+
+    NodeLayout const &measured = measuredLayout(nodeId);
+
     unsigned int height = _portSpasing; // maxHorizontalPortsExtent(nodeId);
 
-    if (auto w = _graphModel.nodeData<QWidget *>(nodeId, NodeRole::Widget)) {
-        height = std::max(height, static_cast<unsigned int>(w->height()));
+    QSize const widget = widgetSize(nodeId);
+
+    if (widget.isValid()) {
+        height = std::max(height, static_cast<unsigned int>(widget.height()));
     }
 
-    QRectF const capRect = captionRect(nodeId);
+    QRectF const capRect = measured.captionRect;
 
     height += capRect.height();
 
@@ -51,8 +57,8 @@ void DefaultVerticalNodeGeometry::recomputeSize(NodeId const nodeId) const
     height += portCaptionsHeight(nodeId, PortType::In);
     height += portCaptionsHeight(nodeId, PortType::Out);
 
-    unsigned int inPortWidth = maxPortsTextAdvance(nodeId, PortType::In);
-    unsigned int outPortWidth = maxPortsTextAdvance(nodeId, PortType::Out);
+    unsigned int inPortWidth = measured.portTextAdvance[static_cast<int>(PortType::In)];
+    unsigned int outPortWidth = measured.portTextAdvance[static_cast<int>(PortType::Out)];
 
     unsigned int totalInPortsWidth = nInPorts > 0
                                          ? inPortWidth * nInPorts + _portSpasing * (nInPorts - 1)
@@ -64,8 +70,8 @@ void DefaultVerticalNodeGeometry::recomputeSize(NodeId const nodeId) const
 
     unsigned int width = std::max(totalInPortsWidth, totalOutPortsWidth);
 
-    if (auto w = _graphModel.nodeData<QWidget *>(nodeId, NodeRole::Widget)) {
-        width = std::max(width, static_cast<unsigned int>(w->width()));
+    if (widget.isValid()) {
+        width = std::max(width, static_cast<unsigned int>(widget.width()));
     }
 
     width = std::max(width, static_cast<unsigned int>(capRect.width()));
@@ -76,21 +82,146 @@ void DefaultVerticalNodeGeometry::recomputeSize(NodeId const nodeId) const
     QSize size(width, height);
 
     _graphModel.setNodeData(nodeId, NodeRole::Size, size);
+    _graphModel.setNodeData(nodeId, NodeRole::LayoutKey, layoutKey());
 }
 
 QPointF DefaultVerticalNodeGeometry::portPosition(NodeId const nodeId,
                                                   PortType const portType,
                                                   PortIndex const portIndex) const
+{
+    if (portType == PortType::None)
+        return QPointF();
+
+    NodeLayout const &l = layout(nodeId);
+
+    auto const &positions = l.portPositions[static_cast<int>(portType)];
+
+    if (portIndex < positions.size())
+        return positions[portIndex];
+
+    return placePort(l, portType, portIndex);
+}
+
+QPointF DefaultVerticalNodeGeometry::portTextPosition(NodeId const nodeId,
+                                                      PortType const portType,
+                                                      PortIndex const portIndex) const
+{
+    if (portType == PortType::None)
+        return QPointF();
+
+    NodeLayout const &l = layout(nodeId);
+
+    auto const &positions = l.portTextPositions[static_cast<int>(portType)];
+
+    if (portIndex < positions.size())
+        return positions[portIndex];
+
+    // Ports inserted since the last `nodeUpdated`.
+    return placePortText(l, portType, portIndex, portTextRect(nodeId, portType, portIndex));
+}
+
+QRectF DefaultVerticalNodeGeometry::captionRect(NodeId const nodeId) const
+{
+    return measuredLayout(nodeId).captionRect;
+}
+
+QPointF DefaultVerticalNodeGeometry::captionPosition(NodeId const nodeId) const
+{
+    return layout(nodeId).captionPosition;
+}
+
+QPointF DefaultVerticalNodeGeometry::widgetPosition(NodeId const nodeId) const
+{
+    return layout(nodeId).widgetPosition;
+}
+
+void DefaultVerticalNodeGeometry::measureLayout(NodeId const nodeId, NodeLayout &layout) const
+{
+    layout.captionRect = measureCaptionRect(nodeId);
+
+    for (PortType const portType : {PortType::In, PortType::Out}) {
+        int const side = static_cast<int>(portType);
+
+        PortCount const n = _graphModel.nodeData<PortCount>(nodeId,
+                                                            (portType == PortType::Out)
+                                                                ? NodeRole::OutPortCount
+                                                                : NodeRole::InPortCount);
+
+        layout.portTextRects[side].clear();
+
+        for (PortIndex portIndex = 0; portIndex < n; ++portIndex) {
+            layout.portTextRects[side].push_back(portTextRect(nodeId, portType, portIndex));
+        }
+
+        layout.portTextAdvance[side] = maxPortsTextAdvance(nodeId, portType);
+    }
+}
+
+void DefaultVerticalNodeGeometry::placeLayout(NodeId const nodeId, NodeLayout &layout) const
+{
+    QSize const size = layout.size;
+
+    QRectF const capRect = layout.captionRect;
+
+    unsigned int step = portCaptionsHeight(nodeId, PortType::In);
+    step += _portSpasing;
+
+    layout.captionPosition = QPointF(0.5 * (size.width() - capRect.width()),
+                                     step + capRect.height());
+
+    for (PortType const portType : {PortType::In, PortType::Out}) {
+        int const side = static_cast<int>(portType);
+
+        auto const &textRects = layout.portTextRects[side];
+
+        layout.portPositions[side].clear();
+        layout.portTextPositions[side].clear();
+
+        for (PortIndex portIndex = 0; portIndex < textRects.size(); ++portIndex) {
+            layout.portPositions[side].push_back(placePort(layout, portType, portIndex));
+            layout.portTextPositions[side].push_back(
+                placePortText(layout, portType, portIndex, textRects[portIndex]));
+        }
+    }
+
+    layout.widgetPosition = QPointF();
+
+    unsigned int captionHeight = capRect.height();
+
+    unsigned int const inPortWidth = layout.portTextAdvance[static_cast<int>(PortType::In)];
+
+    QSize const widget = widgetSize(nodeId);
+
+    if (widget.isValid()) {
+        auto w = createdWidget(nodeId);
+
+        // If the widget wants to use as much vertical space as possible,
+        // place it immediately after the caption.
+        if (w && (w->sizePolicy().verticalPolicy() & QSizePolicy::ExpandFlag)) {
+            layout.widgetPosition = QPointF(_portSpasing + inPortWidth, captionHeight);
+        } else {
+            layout.widgetPosition = QPointF(_portSpasing + inPortWidth,
+                                            (captionHeight + size.height() - widget.height())
+                                                / 2.0);
+        }
+    }
+}
+
+QPointF DefaultVerticalNodeGeometry::placePort(NodeLayout const &layout,
+                                               PortType const portType,
+                                               PortIndex const portIndex) const
 {
     QPointF result;
 
-    QSize size = _graphModel.nodeData<QSize>(nodeId, NodeRole::Size);
+    QSize const size = layout.size;
 
     switch (portType) {
     case PortType::In: {
-        unsigned int inPortWidth = maxPortsTextAdvance(nodeId, PortType::In) + _portSpasing;
+        unsigned int inPortWidth = layout.portTextAdvance[static_cast<int>(PortType::In)]
+                                   + _portSpasing;
 
-        PortCount nInPorts = _graphModel.nodeData<PortCount>(nodeId, NodeRole::InPortCount);
+        PortCount nInPorts = static_cast<PortCount>(
+            layout.portTextRects[static_cast<int>(PortType::In)].size());
 
         double x = (size.width() - (nInPorts - 1) * inPortWidth) / 2.0 + portIndex * inPortWidth;
 
@@ -102,8 +233,10 @@ QPointF DefaultVerticalNodeGeometry::portPosition(NodeId const nodeId,
     }
 
     case PortType::Out: {
-        unsigned int outPortWidth = maxPortsTextAdvance(nodeId, PortType::Out) + _portSpasing;
-        PortCount nOutPorts = _graphModel.nodeData<PortCount>(nodeId, NodeRole::OutPortCount);
+        unsigned int outPortWidth = layout.portTextAdvance[static_cast<int>(PortType::Out)]
+                                    + _portSpasing;
+        PortCount nOutPorts = static_cast<PortCount>(
+            layout.portTextRects[static_cast<int>(PortType::Out)].size());
 
         double x = (size.width() - (nOutPorts - 1) * outPortWidth) / 2.0 + portIndex * outPortWidth;
 
@@ -121,25 +254,22 @@ QPointF DefaultVerticalNodeGeometry::portPosition(NodeId const nodeId,
     return result;
 }
 
-QPointF DefaultVerticalNodeGeometry::portTextPosition(NodeId const nodeId,
-                                                      PortType const portType,
-                                                      PortIndex const portIndex) const
+QPointF DefaultVerticalNodeGeometry::placePortText(NodeLayout const &layout,
+                                                   PortType const portType,
+                                                   PortIndex const portIndex,
+                                                   QRectF const &textRect) const
 {
-    QPointF p = portPosition(nodeId, portType, portIndex);
-
-    QRectF rect = portTextRect(nodeId, portType, portIndex);
+    QPointF p = placePort(layout, portType, portIndex);
 
-    p.setX(p.x() - rect.width() / 2.0);
-
-    QSize size = _graphModel.nodeData<QSize>(nodeId, NodeRole::Size);
+    p.setX(p.x() - textRect.width() / 2.0);
 
     switch (portType) {
     case PortType::In:
-        p.setY(5.0 + rect.height());
+        p.setY(5.0 + textRect.height());
         break;
 
     case PortType::Out:
-        p.setY(size.height() - 5.0);
+        p.setY(layout.size.height() - 5.0);
         break;
 
     default:
@@ -149,45 +279,14 @@ QPointF DefaultVerticalNodeGeometry::portTextPosition(NodeId const nodeId,
     return p;
 }
 
-QRectF DefaultVerticalNodeGeometry::captionRect(NodeId const nodeId) const
+QRectF DefaultVerticalNodeGeometry::measureCaptionRect(NodeId const nodeId) const
 {
     if (!_graphModel.nodeData<bool>(nodeId, NodeRole::CaptionVisible))
         return QRect();
 
     QString name = _graphModel.nodeData<QString>(nodeId, NodeRole::Caption);
 
-    return _boldFontMetrics.boundingRect(name);
-}
-
-QPointF DefaultVerticalNodeGeometry::captionPosition(NodeId const nodeId) const
-{
-    QSize size = _graphModel.nodeData<QSize>(nodeId, NodeRole::Size);
-
-    unsigned int step = portCaptionsHeight(nodeId, PortType::In);
-    step += _portSpasing;
-
-    auto rect = captionRect(nodeId);
-
-    return QPointF(0.5 * (size.width() - rect.width()), step + rect.height());
-}
-
-QPointF DefaultVerticalNodeGeometry::widgetPosition(NodeId const nodeId) const
-{
-    QSize size = _graphModel.nodeData<QSize>(nodeId, NodeRole::Size);
-
-    unsigned int captionHeight = captionRect(nodeId).height();
-
-    if (auto w = _graphModel.nodeData<QWidget *>(nodeId, NodeRole::Widget)) {
-        // If the widget wants to use as much vertical space as possible,
-        // place it immediately after the caption.
-        if (w->sizePolicy().verticalPolicy() & QSizePolicy::ExpandFlag) {
-            return QPointF(_portSpasing + maxPortsTextAdvance(nodeId, PortType::In), captionHeight);
-        } else {
-            return QPointF(_portSpasing + maxPortsTextAdvance(nodeId, PortType::In),
-                           (captionHeight + size.height() - w->height()) / 2.0);
-        }
-    }
-    return QPointF();
+    return TextCache::instance().boundingRect(_boldFont, name);
 }
 
 QRect DefaultVerticalNodeGeometry::resizeHandleRect(NodeId const nodeId) const
@@ -212,7 +311,7 @@ QRectF DefaultVerticalNodeGeometry::portTextRect(NodeId const nodeId,
         s = portData.value<NodeDataType>().name;
     }
 
-    return _fontMetrics.boundingRect(s);
+    return TextCache::instance().boundingRect(_font, s);
 }
 
 unsigned int DefaultVerticalNodeGeometry::maxHorizontalPortsExtent(NodeId const nodeId) const
@@ -252,11 +351,7 @@ unsigned int DefaultVerticalNodeGeometry::maxPortsTextAdvance(NodeId const nodeI
             name = portData.name;
         }
 
-#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
-        width = std::max(unsigned(_fontMetrics.horizontalAdvance(name)), width);
-#else
-        width = std::max(unsigned(_fontMetrics.width(name)), width);
-#endif
+        width = std::max(unsigned(TextCache::instance().horizontalAdvance(_font, name)), width);
     }
 
     return width;
@@ -0,0 +1,1026 @@
+#include "DenseGraphModel.hpp"
+
+#include "ConnectionIdUtils.hpp"
+#include "NodeStyle.hpp"
+#include "StyleCollection.hpp"
+
+#include <QtCore/QJsonArray>
+
+#include <algorithm>
+#include <numeric>
+
+namespace QtNodes {
+
+namespace {
+
+/// Changes kept aside before the adjacency is rebuilt, at least.
+constexpr std::size_t MinPendingChanges = 256;
+
+template<typename T>
+void moveLastInto(std::vector<T> &column, std::size_t const row)
+{
+    if (row + 1 != column.size())
+        column[row] = std::move(column.back());
+
+    column.pop_back();
+}
+
+} // namespace
+
+DenseGraphModel::DenseGraphModel(QObject *parent)
+    : AbstractGraphModel(parent)
+    , _nextNodeId(0)
+    , _adjacencyStale(true)
+    , _addedCount(0)
+{}
+
+DenseGraphModel::~DenseGraphModel() = default;
+
+void DenseGraphModel::reserve(std::size_t const nodes, std::size_t const connections)
+{
+    std::size_t const rows = _ids.size() + nodes;
+
+    // Grows geometrically, repeated small batches stay amortized.
+    if (rows > _ids.capacity()) {
+        std::size_t const capacity = std::max(rows, 2 * _ids.capacity());
+
+        _ids.reserve(capacity);
+        _types.reserve(capacity);
+        _captions.reserve(capacity);
+        _positions.reserve(capacity);
+        _sizes.reserve(capacity);
+        _inPortCounts.reserve(capacity);
+        _outPortCounts.reserve(capacity);
+        _adjacencySlots.reserve(capacity);
+        _rows.reserve(capacity);
+    }
+
+    _connections.reserve(_connections.size() + connections);
+}
+
+NodeId DenseGraphModel::reserveNodeIds(std::size_t const count)
+{
+    if (count == 0)
+        return InvalidNodeId;
+
+    NodeId const first = _nextNodeId;
+
+    _nextNodeId += static_cast<NodeId>(count);
+
+    return first;
+}
+
+std::vector<NodeId> DenseGraphModel::addNodes(std::size_t const count,
+                                              QString const &nodeType,
+                                              unsigned int const inPorts,
+                                              unsigned int const outPorts)
+{
+    GraphTransaction transaction(*this);
+
+    reserve(count, 0);
+
+    std::vector<NodeId> nodeIds;
+    nodeIds.reserve(count);
+
+    NodeId const firstId = reserveNodeIds(count);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        NodeId const nodeId = firstId + static_cast<NodeId>(i);
+
+        appendRow(nodeId, nodeType, inPorts, outPorts);
+
+        nodeIds.push_back(nodeId);
+    }
+
+    for (NodeId const nodeId : nodeIds) {
+        Q_EMIT nodeCreated(nodeId);
+    }
+
+    return nodeIds;
+}
+
+void DenseGraphModel::addConnections(std::vector<ConnectionId> const &connectionIds)
+{
+    GraphTransaction transaction(*this);
+
+    _connections.reserve(_connections.size() + connectionIds.size());
+
+    std::vector<ConnectionId> added;
+    added.reserve(connectionIds.size());
+
+    for (ConnectionId const &connectionId : connectionIds) {
+        if (insertConnection(connectionId))
+            added.push_back(connectionId);
+    }
+
+    for (ConnectionId const &connectionId : added) {
+        Q_EMIT connectionCreated(connectionId);
+    }
+}
+
+void DenseGraphModel::deleteConnections(std::vector<ConnectionId> const &connectionIds)
+{
+    GraphTransaction transaction(*this);
+
+    std::vector<ConnectionId> deleted;
+    deleted.reserve(connectionIds.size());
+
+    for (ConnectionId const &connectionId : connectionIds) {
+        if (eraseConnection(connectionId))
+            deleted.push_back(connectionId);
+    }
+
+    for (ConnectionId const &connectionId : deleted) {
+        Q_EMIT connectionDeleted(connectionId);
+    }
+}
+
+void DenseGraphModel::deleteNodes(std::vector<NodeId> const &nodeIds)
+{
+    GraphTransaction transaction(*this);
+
+    std::unordered_set<ConnectionId> attached;
+
+    for (NodeId const nodeId : nodeIds) {
+        forEachNodeConnection(nodeId,
+                              [&attached](ConnectionId const &connectionId) {
+                                  attached.insert(connectionId);
+                              });
+    }
+
+    for (ConnectionId const &connectionId : attached) {
+        eraseConnection(connectionId);
+    }
+
+    std::vector<NodeId> deleted;
+    deleted.reserve(nodeIds.size());
+
+    for (NodeId const nodeId : nodeIds) {
+        std::size_t const row = nodeRow(nodeId);
+        if (row == InvalidRow)
+            continue;
+
+        removeRow(row);
+
+        deleted.push_back(nodeId);
+    }
+
+    for (ConnectionId const &connectionId : attached) {
+        Q_EMIT connectionDeleted(connectionId);
+    }
+
+    for (NodeId const nodeId : deleted) {
+        Q_EMIT nodeDeleted(nodeId);
+    }
+}
+
+void DenseGraphModel::clear()
+{
+    _ids.clear();
+    _types.clear();
+    _captions.clear();
+    _positions.clear();
+    _sizes.clear();
+    _inPortCounts.clear();
+    _outPortCounts.clear();
+    _adjacencySlots.clear();
+    _rows.clear();
+
+    _connections.clear();
+
+    invalidateAdjacency();
+
+    Q_EMIT modelReset();
+}
+
+QJsonObject DenseGraphModel::save() const
+{
+    QJsonArray nodesJson;
+    for (NodeId const nodeId : _ids) {
+        nodesJson.append(saveNode(nodeId));
+    }
+
+    QJsonArray connectionsJson;
+    for (ConnectionId const &connectionId : _connections) {
+        connectionsJson.append(toJson(connectionId));
+    }
+
+    QJsonObject json;
+    json["nodes"] = nodesJson;
+    json["connections"] = connectionsJson;
+
+    return json;
+}
+
+void DenseGraphModel::load(QJsonObject const &json)
+{
+    GraphTransaction transaction(*this);
+
+    QJsonArray const nodesJson = json["nodes"].toArray();
+    QJsonArray const connectionsJson = json["connections"].toArray();
+
+    reserve(nodesJson.size(), connectionsJson.size());
+
+    for (QJsonValue const nodeJson : nodesJson) {
+        loadNode(nodeJson.toObject());
+    }
+
+    std::vector<ConnectionId> connectionIds;
+    connectionIds.reserve(connectionsJson.size());
+
+    for (QJsonValue const connectionJson : connectionsJson) {
+        connectionIds.push_back(fromJson(connectionJson.toObject()));
+    }
+
+    addConnections(connectionIds);
+}
+
+MemoryReport DenseGraphModel::memoryReport() const
+{
+    MemoryReport report;
+
+    std::size_t const nodeBytes = MemoryReport::vectorBytes(_ids)
+                                  + MemoryReport::vectorBytes(_types)
+                                  + MemoryReport::vectorBytes(_captions)
+                                  + MemoryReport::vectorBytes(_positions)
+                                  + MemoryReport::vectorBytes(_sizes)
+                                  + MemoryReport::vectorBytes(_inPortCounts)
+                                  + MemoryReport::vectorBytes(_outPortCounts)
+                                  + MemoryReport::vectorBytes(_adjacencySlots)
+                                  + MemoryReport::hashBytes(_rows);
+
+    report.add(QStringLiteral("nodes"), _ids.size(), nodeBytes);
+
+    report.add(QStringLiteral("connections"),
+               _connections.size(),
+               MemoryReport::flatHashBytes(_connections));
+
+    std::size_t const adjacencyBytes = MemoryReport::vectorBytes(_adjacency.outFirst)
+                                       + MemoryReport::vectorBytes(_adjacency.out)
+                                       + MemoryReport::vectorBytes(_adjacency.inFirst)
+                                       + MemoryReport::vectorBytes(_adjacency.in);
+
+    report.add(QStringLiteral("adjacency"), _adjacency.out.size(), adjacencyBytes);
+
+    std::size_t pendingBytes = MemoryReport::hashBytes(_addedConnections)
+                               + MemoryReport::hashBytes(_deletedConnections);
+
+    for (auto const &entry : _addedConnections) {
+        pendingBytes += MemoryReport::vectorBytes(entry.second);
+    }
+
+    report.add(QStringLiteral("pendingConnections"),
+               _addedCount + _deletedConnections.size(),
+               pendingBytes);
+
+    return report;
+}
+
+std::unordered_set<NodeId> DenseGraphModel::allNodeIds() const
+{
+    return std::unordered_set<NodeId>(_ids.begin(), _ids.end());
+}
+
+std::unordered_set<ConnectionId> DenseGraphModel::allConnectionIds(NodeId const nodeId) const
+{
+    std::unordered_set<ConnectionId> result;
+
+    forEachNodeConnection(nodeId,
+                          [&result](ConnectionId const &connectionId) {
+                              result.insert(connectionId);
+                          });
+
+    return result;
+}
+
+std::unordered_set<ConnectionId> DenseGraphModel::connections(NodeId nodeId,
+                                                              PortType portType,
+                                                              PortIndex portIndex) const
+{
+    std::unordered_set<ConnectionId> result;
+
+    visit(nodeId, portType, portIndex, [&result](ConnectionId const &connectionId) {
+        result.insert(connectionId);
+    });
+
+    return result;
+}
+
+void DenseGraphModel::forEachConnection(NodeId nodeId,
+                                        PortType portType,
+                                        PortIndex portIndex,
+                                        ConnectionVisitor const &visitor) const
+{
+    visit(nodeId, portType, portIndex, visitor);
+}
+
+void DenseGraphModel::forEachNodeConnection(NodeId nodeId, ConnectionVisitor const &visitor) const
+{
+    visit(nodeId, PortType::In, InvalidPortIndex, visitor);
+
+    // A connection of the node to itself was visited as an input already.
+    visit(nodeId, PortType::Out, InvalidPortIndex, [&](ConnectionId const &connectionId) {
+        if (connectionId.inNodeId != nodeId)
+            visitor(connectionId);
+    });
+}
+
+void DenseGraphModel::forEachGraphConnection(ConnectionVisitor const &visitor) const
+{
+    for (ConnectionId const &connectionId : _connections) {
+        visitor(connectionId);
+    }
+}
+
+std::size_t DenseGraphModel::connectionCount(NodeId nodeId,
+                                             PortType portType,
+                                             PortIndex portIndex) const
+{
+    std::size_t count = 0;
+
+    visit(nodeId, portType, portIndex, [&count](ConnectionId const &) { ++count; });
+
+    return count;
+}
+
+bool DenseGraphModel::connectionExists(ConnectionId const connectionId) const
+{
+    return _connections.find(connectionId) != _connections.end();
+}
+
+NodeId DenseGraphModel::addNode(QString const nodeType)
+{
+    NodeId const nodeId = newNodeId();
+
+    appendRow(nodeId, nodeType, 1, 1);
+
+    Q_EMIT nodeCreated(nodeId);
+
+    return nodeId;
+}
+
+bool DenseGraphModel::connectionPossible(ConnectionId const connectionId) const
+{
+    std::size_t const outRow = nodeRow(connectionId.outNodeId);
+    std::size_t const inRow = nodeRow(connectionId.inNodeId);
+
+    if (outRow == InvalidRow || inRow == InvalidRow || outRow == inRow)
+        return false;
+
+    if (connectionId.outPortIndex >= _outPortCounts[outRow]
+        || connectionId.inPortIndex >= _inPortCounts[inRow])
+        return false;
+
+    return connectionCount(connectionId.inNodeId, PortType::In, connectionId.inPortIndex) == 0;
+}
+
+void DenseGraphModel::addConnection(ConnectionId const connectionId)
+{
+    if (insertConnection(connectionId))
+        Q_EMIT connectionCreated(connectionId);
+}
+
+bool DenseGraphModel::nodeExists(NodeId const nodeId) const
+{
+    return _rows.find(nodeId) != _rows.end();
+}
+
+void DenseGraphModel::forEachNodeGeometry(NodeGeometryVisitor const &visitor) const
+{
+    for (std::size_t row = 0; row < _ids.size(); ++row) {
+        visitor(_ids[row], _positions[row], _sizes[row]);
+    }
+}
+
+void DenseGraphModel::nodePositions(std::vector<NodeId> const &nodeIds,
+                                    std::vector<QPointF> &positions) const
+{
+    positions.resize(nodeIds.size());
+
+    for (std::size_t i = 0; i < nodeIds.size(); ++i) {
+        std::size_t const row = nodeRow(nodeIds[i]);
+        positions[i] = row != InvalidRow ? _positions[row] : QPointF();
+    }
+}
+
+void DenseGraphModel::nodeSizes(std::vector<NodeId> const &nodeIds,
+                                std::vector<QSize> &sizes) const
+{
+    sizes.resize(nodeIds.size());
+
+    for (std::size_t i = 0; i < nodeIds.size(); ++i) {
+        std::size_t const row = nodeRow(nodeIds[i]);
+        sizes[i] = row != InvalidRow ? _sizes[row] : QSize();
+    }
+}
+
+QVariant DenseGraphModel::nodeData(NodeId nodeId, NodeRole role) const
+{
+    QVariant result;
+
+    std::size_t const row = nodeRow(nodeId);
+    if (row == InvalidRow)
+        return result;
+
+    switch (role) {
+    case NodeRole::Type:
+        result = _types[row];
+        break;
+
+    case NodeRole::Position:
+        result = _positions[row];
+        break;
+
+    case NodeRole::Size:
+        result = _sizes[row];
+        break;
+
+    case NodeRole::CaptionVisible:
+        result = !_captions[row].isEmpty();
+        break;
+
+    case NodeRole::Caption:
+        result = _captions[row];
+        break;
+
+    case NodeRole::Style: {
+        auto style = StyleCollection::nodeStyle();
+        result = style.toJson().toVariantMap();
+    } break;
+
+    case NodeRole::StylePtr:
+        result = QVariant::fromValue(StyleCollection::sharedNodeStyle());
+        break;
+
+    case NodeRole::Computing:
+        result = false;
+        break;
+
+    case NodeRole::InternalData:
+        break;
+
+    case NodeRole::InPortCount:
+        result = _inPortCounts[row];
+        break;
+
+    case NodeRole::OutPortCount:
+        result = _outPortCounts[row];
+        break;
+
+    case NodeRole::Widget:
+        break;
+
+    case NodeRole::WidgetSizeHint:
+        break;
+
+    case NodeRole::ComputeTime:
+        break;
+
+    case NodeRole::LayoutKey:
+        break;
+    }
+
+    return result;
+}
+
+bool DenseGraphModel::setNodeData(NodeId nodeId, NodeRole role, QVariant value)
+{
+    std::size_t const row = nodeRow(nodeId);
+    if (row == InvalidRow)
+        return false;
+
+    bool result = false;
+
+    switch (role) {
+    case NodeRole::Type:
+        break;
+
+    case NodeRole::Position:
+        _positions[row] = value.value<QPointF>();
+
+        Q_EMIT nodePositionUpdated(nodeId);
+
+        result = true;
+        break;
+
+    case NodeRole::Size:
+        _sizes[row] = value.value<QSize>();
+        result = true;
+        break;
+
+    case NodeRole::CaptionVisible:
+        break;
+
+    case NodeRole::Caption:
+        _captions[row] = value.toString();
+
+        Q_EMIT nodeUpdated(nodeId);
+
+        result = true;
+        break;
+
+    case NodeRole::Style:
+        break;
+
+    case NodeRole::StylePtr:
+        break;
+
+    case NodeRole::Computing:
+        break;
+
+    case NodeRole::InternalData:
+        break;
+
+    case NodeRole::InPortCount:
+        result = setPortCount(nodeId, PortType::In, value.toUInt());
+        break;
+
+    case NodeRole::OutPortCount:
+        result = setPortCount(nodeId, PortType::Out, value.toUInt());
+        break;
+
+    case NodeRole::Widget:
+        break;
+
+    case NodeRole::WidgetSizeHint:
+        break;
+
+    case NodeRole::ComputeTime:
+        break;
+
+    case NodeRole::LayoutKey:
+        break;
+    }
+
+    return result;
+}
+
+void DenseGraphModel::moveNodes(std::vector<NodeId> const &nodeIds, QPointF const &delta)
+{
+    std::vector<NodeId> moved;
+    moved.reserve(nodeIds.size());
+
+    for (NodeId const nodeId : nodeIds) {
+        std::size_t const row = nodeRow(nodeId);
+        if (row == InvalidRow)
+            continue;
+
+        _positions[row] += delta;
+
+        moved.push_back(nodeId);
+    }
+
+    if (!moved.empty())
+        Q_EMIT nodePositionsUpdated(moved);
+}
+
+void DenseGraphModel::setNodePositions(std::vector<std::pair<NodeId, QPointF>> const &positions)
+{
+    std::vector<NodeId> moved;
+    moved.reserve(positions.size());
+
+    for (auto const &position : positions) {
+        std::size_t const row = nodeRow(position.first);
+        if (row == InvalidRow)
+            continue;
+
+        _positions[row] = position.second;
+
+        moved.push_back(position.first);
+    }
+
+    if (!moved.empty())
+        Q_EMIT nodePositionsUpdated(moved);
+}
+
+QVariant DenseGraphModel::portData(NodeId nodeId,
+                                   PortType portType,
+                                   PortIndex portIndex,
+                                   PortRole role) const
+{
+    Q_UNUSED(portIndex);
+
+    QVariant result;
+
+    if (!nodeExists(nodeId))
+        return result;
+
+    switch (role) {
+    case PortRole::Data:
+        break;
+
+    case PortRole::DataType:
+        break;
+
+    case PortRole::ConnectionPolicyRole:
+        result = QVariant::fromValue(portType == PortType::In ? ConnectionPolicy::One
+                                                              : ConnectionPolicy::Many);
+        break;
+
+    case PortRole::CaptionVisible:
+        result = false;
+        break;
+
+    case PortRole::Caption:
+        result = QString();
+        break;
+
+    case PortRole::DataTypeId:
+        break;
+
+    case PortRole::Required:
+        break;
+    }
+
+    return result;
+}
+
+bool DenseGraphModel::setPortData(
+    NodeId nodeId, PortType portType, PortIndex portIndex, QVariant const &value, PortRole role)
+{
+    Q_UNUSED(nodeId);
+    Q_UNUSED(portType);
+    Q_UNUSED(portIndex);
+    Q_UNUSED(value);
+    Q_UNUSED(role);
+
+    return false;
+}
+
+bool DenseGraphModel::deleteConnection(ConnectionId const connectionId)
+{
+    if (!eraseConnection(connectionId))
+        return false;
+
+    Q_EMIT connectionDeleted(connectionId);
+
+    return true;
+}
+
+void DenseGraphModel::remapConnections(ConnectionRemap const &remap)
+{
+    ConnectionRemap applied;
+    applied.reserve(remap.size());
+
+    // All old addresses go first, a shifted connection may take the place of another one.
+    for (auto const &shift : remap) {
+        if (eraseConnection(shift.first))
+            applied.push_back(shift);
+    }
+
+    for (auto const &shift : applied) {
+        insertConnection(shift.second);
+    }
+
+    if (!applied.empty())
+        Q_EMIT connectionsRemapped(applied);
+}
+
+bool DenseGraphModel::deleteNode(NodeId const nodeId)
+{
+    if (!nodeExists(nodeId))
+        return false;
+
+    std::vector<ConnectionId> attached;
+
+    forEachNodeConnection(nodeId, [&attached](ConnectionId const &connectionId) {
+        attached.push_back(connectionId);
+    });
+
+    for (ConnectionId const &connectionId : attached) {
+        deleteConnection(connectionId);
+    }
+
+    removeRow(nodeRow(nodeId));
+
+    Q_EMIT nodeDeleted(nodeId);
+
+    return true;
+}
+
+QJsonObject DenseGraphModel::saveNode(NodeId const nodeId) const
+{
+    QJsonObject nodeJson;
+
+    std::size_t const row = nodeRow(nodeId);
+    if (row == InvalidRow)
+        return nodeJson;
+
+    nodeJson["id"] = static_cast<qint64>(nodeId);
+    nodeJson["type"] = _types[row];
+    nodeJson["caption"] = _captions[row];
+    nodeJson["in-ports"] = static_cast<qint64>(_inPortCounts[row]);
+    nodeJson["out-ports"] = static_cast<qint64>(_outPortCounts[row]);
+
+    QJsonObject posJson;
+    posJson["x"] = _positions[row].x();
+    posJson["y"] = _positions[row].y();
+    nodeJson["position"] = posJson;
+
+    return nodeJson;
+}
+
+void DenseGraphModel::loadNode(QJsonObject const &nodeJson)
+{
+    NodeId const restoredNodeId = static_cast<NodeId>(nodeJson["id"].toInt());
+
+    if (nodeExists(restoredNodeId))
+        return;
+
+    // Next NodeId must be larger that any id existing in the graph
+    _nextNodeId = std::max(_nextNodeId, restoredNodeId + 1);
+
+    std::size_t const row = appendRow(restoredNodeId,
+                                      nodeJson["type"].toString(),
+                                      static_cast<unsigned int>(nodeJson["in-ports"].toInt(1)),
+                                      static_cast<unsigned int>(nodeJson["out-ports"].toInt(1)));
+
+    if (nodeJson.contains("caption"))
+        _captions[row] = nodeJson["caption"].toString();
+
+    QJsonObject const posJson = nodeJson["position"].toObject();
+    _positions[row] = QPointF(posJson["x"].toDouble(), posJson["y"].toDouble());
+
+    Q_EMIT nodeCreated(restoredNodeId);
+}
+
+std::size_t DenseGraphModel::nodeRow(NodeId const nodeId) const
+{
+    auto it = _rows.find(nodeId);
+
+    return it != _rows.end() ? it->second : InvalidRow;
+}
+
+std::size_t DenseGraphModel::appendRow(NodeId const nodeId,
+                                       QString const &nodeType,
+                                       unsigned int const inPorts,
+                                       unsigned int const outPorts)
+{
+    std::size_t const row = _ids.size();
+
+    _ids.push_back(nodeId);
+    _types.push_back(nodeType);
+    _captions.push_back(nodeType);
+    _positions.emplace_back();
+    _sizes.emplace_back();
+    _inPortCounts.push_back(inPorts);
+    _outPortCounts.push_back(outPorts);
+
+    // Served from the connections kept aside until the next rebuild.
+    _adjacencySlots.push_back(InvalidRow);
+
+    _rows[nodeId] = row;
+
+    return row;
+}
+
+void DenseGraphModel::removeRow(std::size_t const row)
+{
+    _rows.erase(_ids[row]);
+
+    moveLastInto(_ids, row);
+    moveLastInto(_types, row);
+    moveLastInto(_captions, row);
+    moveLastInto(_positions, row);
+    moveLastInto(_sizes, row);
+    moveLastInto(_inPortCounts, row);
+    moveLastInto(_outPortCounts, row);
+
+    // The adjacency slot moves along, the arrays stay valid.
+    moveLastInto(_adjacencySlots, row);
+
+    if (row < _ids.size())
+        _rows[_ids[row]] = row;
+}
+
+bool DenseGraphModel::insertConnection(ConnectionId const &connectionId)
+{
+    if (!nodeExists(connectionId.outNodeId) || !nodeExists(connectionId.inNodeId))
+        return false;
+
+    if (!_connections.insert(connectionId).second)
+        return false;
+
+    if (_adjacencyStale)
+        return true;
+
+    _addedConnections[connectionId.outNodeId].push_back(connectionId);
+
+    if (connectionId.inNodeId != connectionId.outNodeId)
+        _addedConnections[connectionId.inNodeId].push_back(connectionId);
+
+    ++_addedCount;
+
+    limitPendingChanges();
+
+    return true;
+}
+
+bool DenseGraphModel::eraseConnection(ConnectionId const &connectionId)
+{
+    if (_connections.erase(connectionId) == 0)
+        return false;
+
+    if (_adjacencyStale)
+        return true;
+
+    bool keptAside = false;
+
+    auto const forget = [&](NodeId const nodeId) {
+        auto it = _addedConnections.find(nodeId);
+        if (it == _addedConnections.end())
+            return;
+
+        std::vector<ConnectionId> &added = it->second;
+
+        auto position = std::find(added.begin(), added.end(), connectionId);
+        if (position == added.end())
+            return;
+
+        *position = added.back();
+        added.pop_back();
+
+        if (added.empty())
+            _addedConnections.erase(it);
+
+        keptAside = true;
+    };
+
+    forget(connectionId.outNodeId);
+
+    if (connectionId.inNodeId != connectionId.outNodeId)
+        forget(connectionId.inNodeId);
+
+    // Only what the arrays still hold has to be filtered out.
+    if (keptAside)
+        --_addedCount;
+    else
+        _deletedConnections.insert(connectionId);
+
+    limitPendingChanges();
+
+    return true;
+}
+
+bool DenseGraphModel::setPortCount(NodeId const nodeId,
+                                   PortType const portType,
+                                   unsigned int const count)
+{
+    std::size_t const row = nodeRow(nodeId);
+    if (row == InvalidRow)
+        return false;
+
+    std::vector<unsigned int> &counts = portType == PortType::In ? _inPortCounts : _outPortCounts;
+
+    unsigned int const current = counts[row];
+
+    if (count == current)
+        return true;
+
+    if (count < current) {
+        portsAboutToBeDeleted(nodeId, portType, count, current - 1);
+        counts[row] = count;
+        portsDeleted();
+    } else {
+        portsAboutToBeInserted(nodeId, portType, current, count - 1);
+        counts[row] = count;
+        portsInserted();
+    }
+
+    Q_EMIT nodeUpdated(nodeId);
+
+    return true;
+}
+
+void DenseGraphModel::visit(NodeId const nodeId,
+                            PortType const portType,
+                            PortIndex const portIndex,
+                            ConnectionVisitor const &visitor) const
+{
+    if (portType == PortType::None)
+        return;
+
+    std::size_t const row = nodeRow(nodeId);
+    if (row == InvalidRow)
+        return;
+
+    updateAdjacency();
+
+    bool const anyPort = portIndex == InvalidPortIndex;
+
+    std::size_t const slot = _adjacencySlots[row];
+
+    if (slot != InvalidRow) {
+        bool const in = portType == PortType::In;
+
+        std::vector<std::size_t> const &first = in ? _adjacency.inFirst : _adjacency.outFirst;
+        std::vector<ConnectionId> const &list = in ? _adjacency.in : _adjacency.out;
+
+        auto begin = list.begin() + first[slot];
+        auto end = list.begin() + first[slot + 1];
+
+        if (!anyPort) {
+            begin = std::lower_bound(begin,
+                                     end,
+                                     portIndex,
+                                     [portType](ConnectionId const &c, PortIndex const index) {
+                                         return getPortIndex(portType, c) < index;
+                                     });
+
+            end = std::upper_bound(begin,
+                                   end,
+                                   portIndex,
+                                   [portType](PortIndex const index, ConnectionId const &c) {
+                                       return index < getPortIndex(portType, c);
+                                   });
+        }
+
+        for (auto it = begin; it != end; ++it) {
+            if (_deletedConnections.empty() || _deletedConnections.count(*it) == 0)
+                visitor(*it);
+        }
+    }
+
+    auto added = _addedConnections.find(nodeId);
+    if (added == _addedConnections.end())
+        return;
+
+    for (ConnectionId const &connectionId : added->second) {
+        if (getNodeId(portType, connectionId) != nodeId)
+            continue;
+
+        if (anyPort || getPortIndex(portType, connectionId) == portIndex)
+            visitor(connectionId);
+    }
+}
+
+void DenseGraphModel::invalidateAdjacency()
+{
+    _adjacencyStale = true;
+
+    _addedConnections.clear();
+    _addedCount = 0;
+    _deletedConnections.clear();
+}
+
+void DenseGraphModel::updateAdjacency() const
+{
+    if (!_adjacencyStale)
+        return;
+
+    std::size_t const rows = _ids.size();
+
+    std::iota(_adjacencySlots.begin(), _adjacencySlots.end(), std::size_t(0));
+
+    std::vector<ConnectionId> const all(_connections.begin(), _connections.end());
+
+    auto const build = [&](PortType const portType,
+                           std::vector<std::size_t> &first,
+                           std::vector<ConnectionId> &list) {
+        std::vector<std::size_t> connectionRows;
+        connectionRows.reserve(all.size());
+
+        first.assign(rows + 1, 0);
+
+        for (ConnectionId const &connectionId : all) {
+            std::size_t const row = _rows.at(getNodeId(portType, connectionId));
+
+            connectionRows.push_back(row);
+
+            ++first[row + 1];
+        }
+
+        std::partial_sum(first.begin(), first.end(), first.begin());
+
+        list.resize(all.size());
+
+        std::vector<std::size_t> next(first.begin(), first.end() - 1);
+
+        for (std::size_t i = 0; i < all.size(); ++i) {
+            list[next[connectionRows[i]]++] = all[i];
+        }
+
+        auto const byPort = [portType](ConnectionId const &a, ConnectionId const &b) {
+            return getPortIndex(portType, a) < getPortIndex(portType, b);
+        };
+
+        for (std::size_t row = 0; row < rows; ++row) {
+            std::sort(list.begin() + first[row], list.begin() + first[row + 1], byPort);
+        }
+    };
+
+    build(PortType::Out, _adjacency.outFirst, _adjacency.out);
+    build(PortType::In, _adjacency.inFirst, _adjacency.in);
+
+    _adjacencyStale = false;
+}
+
+void DenseGraphModel::limitPendingChanges()
+{
+    std::size_t const pending = _addedCount + _deletedConnections.size();
+
+    if (pending > std::max(MinPendingChanges, _adjacency.out.size() / 2))
+        invalidateAdjacency();
+}
+
+} // namespace QtNodes
@@ -0,0 +1,542 @@
+#include "GraphChangeStream.hpp"
+
+#include "AbstractGraphModel.hpp"
+#include "DataFlowGraphModel.hpp"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QHash>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QVariant>
+
+#include <algorithm>
+
+namespace QtNodes {
+
+namespace {
+
+/// "QNCS", first bytes of a change packet.
+constexpr quint32 ChangePacketMagic = 0x514E4353;
+
+constexpr quint16 ChangePacketVersion = 1;
+
+QDataStream &operator<<(QDataStream &out, ConnectionId const &connectionId)
+{
+    return out << static_cast<quint32>(connectionId.outNodeId)
+               << static_cast<quint32>(connectionId.outPortIndex)
+               << static_cast<quint32>(connectionId.inNodeId)
+               << static_cast<quint32>(connectionId.inPortIndex);
+}
+
+QDataStream &operator>>(QDataStream &in, ConnectionId &connectionId)
+{
+    quint32 outNodeId, outPortIndex, inNodeId, inPortIndex;
+
+    in >> outNodeId >> outPortIndex >> inNodeId >> inPortIndex;
+
+    connectionId = ConnectionId{outNodeId, outPortIndex, inNodeId, inPortIndex};
+
+    return in;
+}
+
+GraphChange nodeChange(GraphChange::Type const type, NodeId const nodeId, QByteArray data = {})
+{
+    GraphChange change;
+    change.type = type;
+    change.nodeId = nodeId;
+    change.data = std::move(data);
+
+    return change;
+}
+
+GraphChange connectionChange(GraphChange::Type const type, ConnectionId const connectionId)
+{
+    GraphChange change;
+    change.type = type;
+    change.connectionId = connectionId;
+
+    return change;
+}
+
+/// Node ids in ascending order, so that equal graphs encode equally.
+std::vector<NodeId> sortedNodeIds(AbstractGraphModel const &model)
+{
+    std::unordered_set<NodeId> const ids = model.allNodeIds();
+
+    std::vector<NodeId> sorted(ids.begin(), ids.end());
+    std::sort(sorted.begin(), sorted.end());
+
+    return sorted;
+}
+
+} // namespace
+
+GraphChangeStream::GraphChangeStream(AbstractGraphModel &model, QObject *parent)
+    : QObject(parent)
+    , _model(model)
+    , _pendingSignalled(false)
+{
+    connect(&_model, &AbstractGraphModel::nodeCreated, this, [this](NodeId const nodeId) {
+        writeCreatedNodes();
+
+        _createdNodes.push_back(nodeId);
+
+        notifyPending();
+    });
+
+    connect(&_model, &AbstractGraphModel::nodeDeleted, this, [this](NodeId const nodeId) {
+        _movedNodes.erase(nodeId);
+        _changedNodes.erase(nodeId);
+        _sentData.erase(nodeId);
+
+        auto created = std::find(_createdNodes.begin(), _createdNodes.end(), nodeId);
+
+        // Never sent, the replicas do not know it.
+        if (created != _createdNodes.end()) {
+            _createdNodes.erase(created);
+            return;
+        }
+
+        append(nodeChange(GraphChange::Type::DeleteNode, nodeId));
+    });
+
+    connect(&_model, &AbstractGraphModel::nodePositionUpdated, this, [this](NodeId const nodeId) {
+        _movedNodes.insert(nodeId);
+
+        notifyPending();
+    });
+
+    connect(&_model,
+            &AbstractGraphModel::nodePositionsUpdated,
+            this,
+            [this](std::vector<NodeId> const &nodeIds) {
+                _movedNodes.insert(nodeIds.begin(), nodeIds.end());
+
+                notifyPending();
+            });
+
+    auto const onDataChanged = [this](NodeId const nodeId) {
+        _changedNodes.insert(nodeId);
+
+        notifyPending();
+    };
+
+    // Other models report internal-data changes as node updates; unchanged
+    // data is filtered by its hash when the packet is taken.
+    if (auto dataFlowModel = qobject_cast<DataFlowGraphModel *>(&_model))
+        connect(dataFlowModel, &DataFlowGraphModel::nodeInternalDataChanged, this, onDataChanged);
+    else
+        connect(&_model, &AbstractGraphModel::nodeUpdated, this, onDataChanged);
+
+    connect(&_model,
+            &AbstractGraphModel::connectionCreated,
+            this,
+            [this](ConnectionId const connectionId) {
+                append(connectionChange(GraphChange::Type::CreateConnection, connectionId));
+            });
+
+    connect(&_model,
+            &AbstractGraphModel::connectionDeleted,
+            this,
+            [this](ConnectionId const connectionId) {
+                append(connectionChange(GraphChange::Type::DeleteConnection, connectionId));
+            });
+
+    connect(&_model,
+            &AbstractGraphModel::connectionsRemapped,
+            this,
+            [this](ConnectionRemap const &remap) {
+                for (auto const &entry : remap) {
+                    append(connectionChange(GraphChange::Type::DeleteConnection, entry.first));
+                }
+
+                for (auto const &entry : remap) {
+                    append(connectionChange(GraphChange::Type::CreateConnection, entry.second));
+                }
+            });
+
+    connect(&_model, &AbstractGraphModel::batchFinished, this, [this](GraphChangeSet const &) {
+        writeCreatedNodes();
+
+        std::vector<GraphChange> changes = std::move(_batchChanges);
+        _batchChanges.clear();
+
+        for (GraphChange &change : changes) {
+            append(std::move(change));
+        }
+
+        if (hasPendingChanges())
+            notifyPending();
+    });
+
+    connect(&_model, &AbstractGraphModel::modelReset, this, [this]() {
+        _createdNodes.clear();
+        _batchChanges.clear();
+        _movedNodes.clear();
+        _changedNodes.clear();
+        _sentData.clear();
+
+        // Whatever was pending is part of the new graph or gone with the old one.
+        _changes = snapshotChanges();
+
+        notifyPending();
+    });
+}
+
+GraphChangeStream::~GraphChangeStream() = default;
+
+bool GraphChangeStream::hasPendingChanges() const
+{
+    return !_changes.empty() || !_createdNodes.empty() || !_batchChanges.empty()
+           || !_movedNodes.empty() || !_changedNodes.empty();
+}
+
+QByteArray GraphChangeStream::takePacket()
+{
+    // The batch end records them.
+    if (_model.batchInProgress())
+        return QByteArray();
+
+    writeCreatedNodes();
+    writeCoalescedUpdates();
+
+    _pendingSignalled = false;
+
+    if (_changes.empty())
+        return QByteArray();
+
+    QByteArray const packet = encode(_changes);
+
+    _changes.clear();
+
+    return packet;
+}
+
+QByteArray GraphChangeStream::snapshotPacket() const
+{
+    return encode(snapshotChanges());
+}
+
+std::vector<GraphChange> GraphChangeStream::snapshotChanges() const
+{
+    std::vector<GraphChange> changes;
+
+    changes.push_back(GraphChange());
+
+    for (NodeId const nodeId : sortedNodeIds(_model)) {
+        QByteArray nodeJson = QJsonDocument(_model.saveNode(nodeId)).toJson(QJsonDocument::Compact);
+
+        changes.push_back(nodeChange(GraphChange::Type::CreateNode, nodeId, std::move(nodeJson)));
+    }
+
+    _model.forEachGraphConnection([&](ConnectionId const &connectionId) {
+        changes.push_back(connectionChange(GraphChange::Type::CreateConnection, connectionId));
+    });
+
+    return changes;
+}
+
+QByteArray GraphChangeStream::encode(std::vector<GraphChange> const &changes)
+{
+    QByteArray packet;
+
+    QDataStream out(&packet, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_11);
+
+    out << ChangePacketMagic << ChangePacketVersion << static_cast<quint32>(changes.size());
+
+    for (GraphChange const &change : changes) {
+        out << static_cast<quint8>(change.type);
+
+        switch (change.type) {
+        case GraphChange::Type::Reset:
+            break;
+
+        case GraphChange::Type::CreateNode:
+        case GraphChange::Type::InternalData:
+            out << static_cast<quint32>(change.nodeId) << change.data;
+            break;
+
+        case GraphChange::Type::DeleteNode:
+            out << static_cast<quint32>(change.nodeId);
+            break;
+
+        case GraphChange::Type::MoveNodes:
+            out << static_cast<quint32>(change.positions.size());
+
+            for (auto const &entry : change.positions) {
+                out << static_cast<quint32>(entry.first) << entry.second.x() << entry.second.y();
+            }
+            break;
+
+        case GraphChange::Type::CreateConnection:
+        case GraphChange::Type::DeleteConnection:
+            out << change.connectionId;
+            break;
+        }
+    }
+
+    return packet;
+}
+
+bool GraphChangeStream::decode(QByteArray const &packet, std::vector<GraphChange> &changes)
+{
+    changes.clear();
+
+    QDataStream in(packet);
+    in.setVersion(QDataStream::Qt_5_11);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 count = 0;
+
+    in >> magic >> version >> count;
+
+    if (in.status() != QDataStream::Ok || magic != ChangePacketMagic
+        || version > ChangePacketVersion)
+        return false;
+
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        quint8 type = 0;
+        in >> type;
+
+        GraphChange change;
+        change.type = static_cast<GraphChange::Type>(type);
+
+        switch (change.type) {
+        case GraphChange::Type::Reset:
+            break;
+
+        case GraphChange::Type::CreateNode:
+        case GraphChange::Type::InternalData: {
+            quint32 nodeId = InvalidNodeId;
+            in >> nodeId >> change.data;
+            change.nodeId = nodeId;
+        } break;
+
+        case GraphChange::Type::DeleteNode: {
+            quint32 nodeId = InvalidNodeId;
+            in >> nodeId;
+            change.nodeId = nodeId;
+        } break;
+
+        case GraphChange::Type::MoveNodes: {
+            quint32 positionCount = 0;
+            in >> positionCount;
+
+            for (quint32 j = 0; j < positionCount && in.status() == QDataStream::Ok; ++j) {
+                quint32 nodeId = InvalidNodeId;
+                double x = 0.0;
+                double y = 0.0;
+
+                in >> nodeId >> x >> y;
+
+                change.positions.emplace_back(nodeId, QPointF(x, y));
+            }
+        } break;
+
+        case GraphChange::Type::CreateConnection:
+        case GraphChange::Type::DeleteConnection:
+            in >> change.connectionId;
+            break;
+
+        default:
+            // Written by a newer version, the rest cannot be parsed.
+            changes.clear();
+            return false;
+        }
+
+        changes.push_back(std::move(change));
+    }
+
+    if (in.status() != QDataStream::Ok || changes.size() != count) {
+        changes.clear();
+        return false;
+    }
+
+    return true;
+}
+
+void GraphChangeStream::apply(AbstractGraphModel &replica, std::vector<GraphChange> const &changes)
+{
+    GraphTransaction transaction(replica);
+
+    for (GraphChange const &change : changes) {
+        switch (change.type) {
+        case GraphChange::Type::Reset:
+            replica.clear();
+            break;
+
+        case GraphChange::Type::CreateNode:
+            if (!replica.nodeExists(change.nodeId))
+                replica.loadNode(QJsonDocument::fromJson(change.data).object());
+            break;
+
+        case GraphChange::Type::DeleteNode:
+            if (replica.nodeExists(change.nodeId))
+                replica.deleteNode(change.nodeId);
+            break;
+
+        case GraphChange::Type::MoveNodes: {
+            std::vector<std::pair<NodeId, QPointF>> positions;
+            positions.reserve(change.positions.size());
+
+            for (auto const &entry : change.positions) {
+                if (replica.nodeExists(entry.first))
+                    positions.push_back(entry);
+            }
+
+            replica.setNodePositions(positions);
+        } break;
+
+        case GraphChange::Type::CreateConnection: {
+            ConnectionId const &connectionId = change.connectionId;
+
+            if (replica.nodeExists(connectionId.outNodeId)
+                && replica.nodeExists(connectionId.inNodeId)
+                && !replica.connectionExists(connectionId))
+                replica.addConnection(connectionId);
+        } break;
+
+        case GraphChange::Type::DeleteConnection:
+            if (replica.connectionExists(change.connectionId))
+                replica.deleteConnection(change.connectionId);
+            break;
+
+        case GraphChange::Type::InternalData:
+            if (replica.nodeExists(change.nodeId)) {
+                QVariantMap const internalData = QJsonDocument::fromJson(change.data)
+                                                     .object()
+                                                     .toVariantMap();
+
+                replica.setNodeData(change.nodeId, NodeRole::InternalData, internalData);
+            }
+            break;
+        }
+    }
+}
+
+bool GraphChangeStream::apply(AbstractGraphModel &replica, QByteArray const &packet)
+{
+    std::vector<GraphChange> changes;
+
+    if (!decode(packet, changes))
+        return false;
+
+    apply(replica, changes);
+
+    return true;
+}
+
+void GraphChangeStream::append(GraphChange change)
+{
+    // Delegates may be loaded after all the nodes of a batch were created.
+    if (_model.batchInProgress()) {
+        _batchChanges.push_back(std::move(change));
+        return;
+    }
+
+    writeCreatedNodes();
+
+    _changes.push_back(std::move(change));
+
+    notifyPending();
+}
+
+void GraphChangeStream::writeCreatedNodes()
+{
+    if (_createdNodes.empty() || _model.batchInProgress())
+        return;
+
+    std::vector<NodeId> const created = std::move(_createdNodes);
+    _createdNodes.clear();
+
+    for (NodeId const nodeId : created) {
+        if (!_model.nodeExists(nodeId))
+            continue;
+
+        QByteArray nodeJson = QJsonDocument(_model.saveNode(nodeId)).toJson(QJsonDocument::Compact);
+
+        _sentData[nodeId] = qHash(internalData(nodeId));
+
+        // The saved node already has them.
+        _movedNodes.erase(nodeId);
+        _changedNodes.erase(nodeId);
+
+        _changes.push_back(nodeChange(GraphChange::Type::CreateNode, nodeId, std::move(nodeJson)));
+    }
+}
+
+void GraphChangeStream::writeCoalescedUpdates()
+{
+    if (!_movedNodes.empty()) {
+        GraphChange change;
+        change.type = GraphChange::Type::MoveNodes;
+
+        for (NodeId const nodeId : _movedNodes) {
+            if (_model.nodeExists(nodeId))
+                change.positions.emplace_back(nodeId,
+                                              _model.nodeData<QPointF>(nodeId, NodeRole::Position));
+        }
+
+        _movedNodes.clear();
+
+        std::sort(change.positions.begin(),
+                  change.positions.end(),
+                  [](auto const &a, auto const &b) { return a.first < b.first; });
+
+        if (!change.positions.empty())
+            _changes.push_back(std::move(change));
+    }
+
+    for (NodeId const nodeId : _changedNodes) {
+        if (!_model.nodeExists(nodeId))
+            continue;
+
+        QByteArray data = internalData(nodeId);
+
+        if (data.isEmpty())
+            continue;
+
+        std::size_t const hash = qHash(data);
+
+        auto sent = _sentData.find(nodeId);
+
+        if (sent != _sentData.end() && sent->second == hash)
+            continue;
+
+        _sentData[nodeId] = hash;
+
+        _changes.push_back(nodeChange(GraphChange::Type::InternalData, nodeId, std::move(data)));
+    }
+
+    _changedNodes.clear();
+}
+
+QByteArray GraphChangeStream::internalData(NodeId const nodeId) const
+{
+    QVariant const value = _model.nodeData(nodeId, NodeRole::InternalData);
+
+    if (!value.isValid())
+        return QByteArray();
+
+    QJsonObject const json = QJsonObject::fromVariantMap(value.toMap());
+
+    if (json.isEmpty())
+        return QByteArray();
+
+    return QJsonDocument(json).toJson(QJsonDocument::Compact);
+}
+
+void GraphChangeStream::notifyPending()
+{
+    // The batch end signals once for the whole batch.
+    if (_pendingSignalled || _model.batchInProgress())
+        return;
+
+    _pendingSignalled = true;
+
+    Q_EMIT changesPending();
+}
+
+} // namespace QtNodes
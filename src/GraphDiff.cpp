@@ -0,0 +1,377 @@
+#include "GraphDiff.hpp"
+
+#include "AbstractGraphModel.hpp"
+#include "ConnectionIdUtils.hpp"
+#include "SceneJson.hpp"
+
+#include <QtCore/QHash>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <utility>
+
+namespace QtNodes {
+
+namespace {
+
+using Node = GraphDiff::State::Node;
+
+bool sameContent(Node const &a, Node const &b)
+{
+    return a.type == b.type && a.contentHash == b.contentHash && a.content == b.content;
+}
+
+template<typename Map>
+std::vector<typename Map::key_type> sortedKeys(Map const &map)
+{
+    std::vector<typename Map::key_type> keys;
+    keys.reserve(map.size());
+
+    for (auto const &entry : map) {
+        keys.push_back(entry.first);
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    return keys;
+}
+
+std::vector<ConnectionId> sorted(std::unordered_set<ConnectionId> const &set)
+{
+    std::vector<ConnectionId> connections(set.begin(), set.end());
+
+    std::sort(connections.begin(), connections.end());
+
+    return connections;
+}
+
+Node const *find(GraphDiff::State const &state, NodeId const nodeId)
+{
+    auto it = state.nodes.find(nodeId);
+
+    return it != state.nodes.end() ? &it->second : nullptr;
+}
+
+/// The `saveNode()` JSON of the node at its compared position.
+QByteArray creationData(NodeId const nodeId, Node const &node)
+{
+    QJsonObject json = node.json;
+
+    json["id"] = static_cast<qint64>(nodeId);
+
+    QJsonObject position;
+    position["x"] = node.position.x();
+    position["y"] = node.position.y();
+    json["position"] = position;
+
+    return QJsonDocument(json).toJson(QJsonDocument::Compact);
+}
+
+} // namespace
+
+GraphDiff::State GraphDiff::State::capture(AbstractGraphModel const &model)
+{
+    State state;
+
+    std::unordered_set<NodeId> const nodeIds = model.allNodeIds();
+
+    state.nodes.reserve(nodeIds.size());
+
+    for (NodeId const nodeId : nodeIds) {
+        state.insertNode(model.saveNode(nodeId), model.nodeData(nodeId, NodeRole::Type).toString());
+    }
+
+    model.forEachGraphConnection(
+        [&state](ConnectionId const &connectionId) { state.connections.insert(connectionId); });
+
+    return state;
+}
+
+GraphDiff::State GraphDiff::State::fromJson(QJsonObject const &sceneJson)
+{
+    State state;
+
+    QJsonArray const nodesJson = sceneJson["nodes"].toArray();
+
+    state.nodes.reserve(nodesJson.size());
+
+    for (QJsonValue const nodeJson : nodesJson) {
+        state.insertNode(nodeJson.toObject());
+    }
+
+    forEachConnectionJson(sceneJson["connections"].toArray(),
+                          [&state](ConnectionId const &connectionId) {
+                              state.connections.insert(connectionId);
+                          });
+
+    return state;
+}
+
+void GraphDiff::State::insertNode(QJsonObject const &nodeJson, QString type)
+{
+    NodeId const nodeId = static_cast<NodeId>(nodeJson["id"].toInt(InvalidNodeId));
+
+    if (nodeId == InvalidNodeId)
+        return;
+
+    QJsonObject const internalData = nodeJson["internal-data"].toObject();
+
+    if (type.isEmpty())
+        type = internalData["model-name"].toString();
+
+    // The layout of `NodeRole::InternalData`, as GraphChangeStream sends it.
+    QJsonObject roleJson;
+    roleJson["internal-data"] = internalData;
+
+    Node node;
+    node.type = std::move(type);
+    node.position = pointFromJson(nodeJson["position"]);
+    node.content = QJsonDocument(roleJson).toJson(QJsonDocument::Compact);
+    node.contentHash = qHash(node.content);
+    node.json = nodeJson;
+
+    nodes[nodeId] = std::move(node);
+}
+
+std::vector<GraphChange> GraphDiff::diff(State const &from, State const &to)
+{
+    std::vector<GraphChange> changes;
+
+    // Nodes of another type are created again, with all of their connections.
+    std::unordered_set<NodeId> recreated;
+
+    for (auto const &entry : from.nodes) {
+        Node const *target = find(to, entry.first);
+
+        if (target && target->type != entry.second.type)
+            recreated.insert(entry.first);
+    }
+
+    auto touchesRecreated = [&recreated](ConnectionId const &connectionId) {
+        return recreated.count(connectionId.outNodeId) > 0
+               || recreated.count(connectionId.inNodeId) > 0;
+    };
+
+    for (ConnectionId const &connectionId : sorted(from.connections)) {
+        if (to.connections.count(connectionId) == 0 || touchesRecreated(connectionId)) {
+            GraphChange change;
+            change.type = GraphChange::Type::DeleteConnection;
+            change.connectionId = connectionId;
+
+            changes.push_back(std::move(change));
+        }
+    }
+
+    std::vector<NodeId> const fromIds = sortedKeys(from.nodes);
+    std::vector<NodeId> const toIds = sortedKeys(to.nodes);
+
+    for (NodeId const nodeId : fromIds) {
+        if (to.nodes.count(nodeId) > 0 && recreated.count(nodeId) == 0)
+            continue;
+
+        GraphChange change;
+        change.type = GraphChange::Type::DeleteNode;
+        change.nodeId = nodeId;
+
+        changes.push_back(std::move(change));
+    }
+
+    std::vector<GraphChange> updates;
+
+    GraphChange moves;
+    moves.type = GraphChange::Type::MoveNodes;
+
+    for (NodeId const nodeId : toIds) {
+        Node const &node = to.nodes.at(nodeId);
+        Node const *source = find(from, nodeId);
+
+        if (!source || recreated.count(nodeId) > 0) {
+            GraphChange change;
+            change.type = GraphChange::Type::CreateNode;
+            change.nodeId = nodeId;
+            change.data = creationData(nodeId, node);
+
+            changes.push_back(std::move(change));
+            continue;
+        }
+
+        if (!sameContent(*source, node)) {
+            GraphChange change;
+            change.type = GraphChange::Type::InternalData;
+            change.nodeId = nodeId;
+            change.data = node.content;
+
+            updates.push_back(std::move(change));
+        }
+
+        if (source->position != node.position)
+            moves.positions.emplace_back(nodeId, node.position);
+    }
+
+    std::move(updates.begin(), updates.end(), std::back_inserter(changes));
+
+    if (!moves.positions.empty())
+        changes.push_back(std::move(moves));
+
+    for (ConnectionId const &connectionId : sorted(to.connections)) {
+        if (from.connections.count(connectionId) == 0 || touchesRecreated(connectionId)) {
+            GraphChange change;
+            change.type = GraphChange::Type::CreateConnection;
+            change.connectionId = connectionId;
+
+            changes.push_back(std::move(change));
+        }
+    }
+
+    return changes;
+}
+
+GraphDiff::MergeResult GraphDiff::merge(State const &base, State const &ours, State const &theirs)
+{
+    MergeResult result;
+
+    State const merged = mergedState(base, ours, theirs, &result.conflicts);
+
+    result.changes = diff(ours, merged);
+
+    return result;
+}
+
+GraphDiff::State GraphDiff::mergedState(State const &base,
+                                        State const &ours,
+                                        State const &theirs,
+                                        std::vector<Conflict> *conflicts)
+{
+    State merged = ours;
+
+    std::vector<Conflict> found;
+
+    auto conflict = [&found](Conflict::Kind const kind, NodeId const nodeId) {
+        Conflict c;
+        c.kind = kind;
+        c.nodeId = nodeId;
+
+        found.push_back(c);
+    };
+
+    // Nodes of base, changed or deleted on either side.
+    for (NodeId const nodeId : sortedKeys(base.nodes)) {
+        Node const &original = base.nodes.at(nodeId);
+        Node const *our = find(ours, nodeId);
+        Node const *their = find(theirs, nodeId);
+
+        if (!their) {
+            if (our && !sameContent(original, *our))
+                conflict(Conflict::Kind::ModifiedDeleted, nodeId);
+            else if (our)
+                merged.nodes.erase(nodeId);
+
+            continue;
+        }
+
+        if (!our) {
+            if (!sameContent(original, *their))
+                conflict(Conflict::Kind::DeletedModified, nodeId);
+
+            continue;
+        }
+
+        Node &node = merged.nodes.at(nodeId);
+
+        if (!sameContent(original, *their) && !sameContent(*our, *their)) {
+            if (sameContent(original, *our)) {
+                node.type = their->type;
+                node.content = their->content;
+                node.contentHash = their->contentHash;
+                node.json = their->json;
+            } else {
+                conflict(Conflict::Kind::Content, nodeId);
+            }
+        }
+
+        if (their->position != original.position && their->position != our->position) {
+            if (our->position == original.position)
+                node.position = their->position;
+            else
+                conflict(Conflict::Kind::Position, nodeId);
+        }
+    }
+
+    // Nodes new in theirs.
+    for (NodeId const nodeId : sortedKeys(theirs.nodes)) {
+        if (base.nodes.count(nodeId) > 0)
+            continue;
+
+        Node const &their = theirs.nodes.at(nodeId);
+        Node const *our = find(ours, nodeId);
+
+        if (!our)
+            merged.nodes.emplace(nodeId, their);
+        else if (!sameContent(*our, their))
+            conflict(Conflict::Kind::AddedBoth, nodeId);
+    }
+
+    // Connections of deleted nodes go with them.
+    for (auto it = merged.connections.begin(); it != merged.connections.end();) {
+        if (merged.nodes.count(it->outNodeId) > 0 && merged.nodes.count(it->inNodeId) > 0) {
+            ++it;
+            continue;
+        }
+
+        if (base.connections.count(*it) == 0) {
+            Conflict c;
+            c.kind = Conflict::Kind::Connection;
+            c.connectionId = *it;
+
+            found.push_back(c);
+        }
+
+        it = merged.connections.erase(it);
+    }
+
+    for (ConnectionId const &connectionId : sorted(base.connections)) {
+        if (theirs.connections.count(connectionId) == 0)
+            merged.connections.erase(connectionId);
+    }
+
+    // Inputs ours connected since base, which their new connections must not share.
+    std::map<std::pair<NodeId, PortIndex>, ConnectionId> ourInputs;
+
+    for (ConnectionId const &connectionId : ours.connections) {
+        if (base.connections.count(connectionId) == 0)
+            ourInputs.emplace(std::make_pair(connectionId.inNodeId, connectionId.inPortIndex),
+                              connectionId);
+    }
+
+    for (ConnectionId const &connectionId : sorted(theirs.connections)) {
+        if (base.connections.count(connectionId) > 0 || merged.connections.count(connectionId) > 0)
+            continue;
+
+        bool const nodesExist = merged.nodes.count(connectionId.outNodeId) > 0
+                                && merged.nodes.count(connectionId.inNodeId) > 0;
+
+        auto const input = ourInputs.find(
+            std::make_pair(connectionId.inNodeId, connectionId.inPortIndex));
+
+        if (!nodesExist || input != ourInputs.end()) {
+            Conflict c;
+            c.kind = Conflict::Kind::Connection;
+            c.connectionId = connectionId;
+
+            found.push_back(c);
+            continue;
+        }
+
+        merged.connections.insert(connectionId);
+    }
+
+    if (conflicts)
+        *conflicts = std::move(found);
+
+    return merged;
+}
+
+} // namespace QtNodes
@@ -0,0 +1,230 @@
+#include "GraphImageExporter.hpp"
+
+#include "AbstractGraphModel.hpp"
+#include "AbstractNodeGeometry.hpp"
+#include "ConnectionGraphicsObject.hpp"
+#include "DefaultConnectionPainter.hpp"
+#include "DefaultNodePainter.hpp"
+#include "GraphicsViewStyle.hpp"
+#include "NodeStyle.hpp"
+#include "StyleCollection.hpp"
+
+#include <QtCore/QJsonDocument>
+#include <QtGui/QPainter>
+#include <QtGui/QPainterPath>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+namespace QtNodes {
+
+namespace {
+
+struct NodeEntry
+{
+    NodeId nodeId;
+    QPointF position;
+};
+
+/// Node positions ordered by id, so that every export of a graph is the same.
+std::vector<NodeEntry> sortedNodes(AbstractGraphModel const &model)
+{
+    std::vector<NodeEntry> nodes;
+
+    model.forEachNodeGeometry([&](NodeId const nodeId, QPointF const &pos, QSize const &) {
+        nodes.push_back(NodeEntry{nodeId, pos});
+    });
+
+    std::sort(nodes.begin(), nodes.end(), [](NodeEntry const &a, NodeEntry const &b) {
+        return a.nodeId < b.nodeId;
+    });
+
+    return nodes;
+}
+
+std::shared_ptr<NodeStyle const> nodeStyle(AbstractGraphModel &model,
+                                           NodeId const nodeId,
+                                           StyleContext const &styles)
+{
+    auto style = model.nodeData(nodeId, NodeRole::StylePtr)
+                     .value<std::shared_ptr<NodeStyle const>>();
+
+    // The default style gives way to the one of the exporter.
+    if (style && style == StyleCollection::sharedNodeStyle())
+        return styles.sharedNodeStyle();
+
+    if (style)
+        return style;
+
+    QJsonDocument json = QJsonDocument::fromVariant(model.nodeData(nodeId, NodeRole::Style));
+
+    return std::make_shared<NodeStyle const>(json.object());
+}
+
+} // namespace
+
+GraphImageExporter::GraphImageExporter(AbstractGraphModel &model,
+                                       AbstractNodeGeometry &geometry,
+                                       Qt::Orientation const orientation)
+    : _model(model)
+    , _geometry(geometry)
+    , _orientation(orientation)
+    , _nodePainter(std::make_unique<DefaultNodePainter>())
+    , _connectionPainter(std::make_unique<DefaultConnectionPainter>())
+    , _styleContext(StyleCollection::context())
+    , _backgroundColor(_styleContext->viewStyle().BackgroundColor)
+{
+    measureNodes();
+}
+
+GraphImageExporter::~GraphImageExporter() = default;
+
+void GraphImageExporter::setNodePainter(std::unique_ptr<AbstractNodePainter> newPainter)
+{
+    _nodePainter = std::move(newPainter);
+}
+
+void GraphImageExporter::setConnectionPainter(std::unique_ptr<AbstractConnectionPainter> newPainter)
+{
+    _connectionPainter = std::move(newPainter);
+}
+
+void GraphImageExporter::setStyleContext(std::shared_ptr<StyleContext const> context)
+{
+    _styleContext = context ? std::move(context) : StyleCollection::context();
+
+    _backgroundColor = _styleContext->viewStyle().BackgroundColor;
+}
+
+void GraphImageExporter::measureNodes()
+{
+    for (NodeId const nodeId : _model.allNodeIds()) {
+        _geometry.recomputeSize(nodeId);
+    }
+}
+
+QRectF GraphImageExporter::sceneRect() const
+{
+    QRectF bounds;
+
+    _model.forEachNodeGeometry([&](NodeId const nodeId, QPointF const &pos, QSize const &) {
+        bounds |= _geometry.boundingRect(nodeId).translated(pos);
+    });
+
+    return bounds.adjusted(-_margin, -_margin, _margin, _margin);
+}
+
+void GraphImageExporter::render(QPainter *painter) const
+{
+    std::vector<NodeEntry> const nodes = sortedNodes(_model);
+
+    std::unordered_map<NodeId, QPointF> positions;
+    positions.reserve(nodes.size());
+
+    for (NodeEntry const &node : nodes) {
+        positions.emplace(node.nodeId, node.position);
+    }
+
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+
+    if (_backgroundColor.alpha() > 0)
+        painter->fillRect(sceneRect(), _backgroundColor);
+
+    // Connections below the nodes, as in the scene.
+    _model.forEachGraphConnection([&](ConnectionId const &connectionId) {
+        auto out = positions.find(connectionId.outNodeId);
+        auto in = positions.find(connectionId.inNodeId);
+
+        if (out == positions.end() || in == positions.end())
+            return;
+
+        QPointF const outPoint = out->second
+                                 + _geometry.portPosition(connectionId.outNodeId,
+                                                          PortType::Out,
+                                                          connectionId.outPortIndex);
+        QPointF const inPoint = in->second
+                                + _geometry.portPosition(connectionId.inNodeId,
+                                                         PortType::In,
+                                                         connectionId.inPortIndex);
+
+        auto const c1c2 = ConnectionGraphicsObject::pointsC1C2(outPoint, inPoint, _orientation);
+
+        QPainterPath path(outPoint);
+        path.cubicTo(c1c2.first, c1c2.second, inPoint);
+
+        ConnectionPaintContext context{_model, connectionId, outPoint, inPoint, c1c2, path};
+        context.styles = _styleContext.get();
+
+        _connectionPainter->paintHeadless(painter, context);
+    });
+
+    for (NodeEntry const &node : nodes) {
+        std::shared_ptr<NodeStyle const> const style = nodeStyle(_model,
+                                                                 node.nodeId,
+                                                                 *_styleContext);
+
+        painter->save();
+        painter->translate(node.position);
+        painter->setOpacity(style->Opacity);
+
+        NodePaintContext context{_model, _geometry, node.nodeId, *style};
+        context.styles = _styleContext.get();
+
+        _nodePainter->paintHeadless(painter, context);
+
+        painter->restore();
+    }
+
+    painter->restore();
+}
+
+void GraphImageExporter::render(QPainter *painter, QRectF const &target) const
+{
+    QRectF const source = sceneRect();
+
+    if (source.isEmpty() || target.isEmpty())
+        return;
+
+    qreal const scale = std::min(target.width() / source.width(),
+                                 target.height() / source.height());
+
+    QSizeF const scaled = source.size() * scale;
+
+    painter->save();
+
+    // Centered in `target`.
+    painter->translate(target.center() - QPointF(scaled.width(), scaled.height()) / 2.0);
+    painter->scale(scale, scale);
+    painter->translate(-source.topLeft());
+
+    render(painter);
+
+    painter->restore();
+}
+
+QImage GraphImageExporter::toImage(qreal const scale) const
+{
+    QRectF const source = sceneRect();
+
+    QSize const size(static_cast<int>(std::ceil(source.width() * scale)),
+                     static_cast<int>(std::ceil(source.height() * scale)));
+
+    if (size.isEmpty())
+        return QImage();
+
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    painter.scale(scale, scale);
+    painter.translate(-source.topLeft());
+
+    render(&painter);
+
+    return image;
+}
+
+} // namespace QtNodes
@@ -0,0 +1,362 @@
+#include "GraphMinimap.hpp"
+
+#include "AbstractGraphModel.hpp"
+#include "AbstractNodeGeometry.hpp"
+#include "BasicGraphicsScene.hpp"
+#include "GraphicsView.hpp"
+#include "StyleCollection.hpp"
+
+#include <QtGui/QMouseEvent>
+#include <QtGui/QPainter>
+#include <QtWidgets/QScrollBar>
+
+#include <algorithm>
+
+namespace QtNodes {
+
+namespace {
+
+/// Beyond this many separate rectangles one full repaint is cheaper.
+constexpr int MaxDirtyRects = 64;
+
+StyleContext const &styleContext(GraphicsView *view)
+{
+    BasicGraphicsScene *scene = view ? view->nodeScene() : nullptr;
+
+    return scene ? scene->styleContext() : StyleCollection::current();
+}
+
+} // namespace
+
+GraphMinimap::GraphMinimap(QWidget *parent)
+    : QWidget(parent)
+    , _index(512.0)
+    , _imageStale(true)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+GraphMinimap::~GraphMinimap() = default;
+
+void GraphMinimap::setView(GraphicsView *view)
+{
+    for (auto const &connection : _connections) {
+        disconnect(connection);
+    }
+
+    _connections.clear();
+
+    if (_view)
+        _view->viewport()->removeEventFilter(this);
+
+    _view = view;
+    _scene = view ? dynamic_cast<BasicGraphicsScene *>(view->scene()) : nullptr;
+
+    if (_view) {
+        _view->viewport()->installEventFilter(this);
+
+        auto repaint = [this]() { update(); };
+
+        _connections.push_back(
+            connect(_view->horizontalScrollBar(), &QScrollBar::valueChanged, this, repaint));
+        _connections.push_back(
+            connect(_view->verticalScrollBar(), &QScrollBar::valueChanged, this, repaint));
+        _connections.push_back(connect(_view, &GraphicsView::scaleChanged, this, repaint));
+    }
+
+    if (_scene) {
+        AbstractGraphModel *model = &_scene->graphModel();
+
+        auto onNode = [this](NodeId const nodeId) {
+            if (!batching())
+                updateNode(nodeId);
+        };
+
+        _connections.push_back(connect(model, &AbstractGraphModel::nodeCreated, this, onNode));
+        _connections.push_back(connect(model, &AbstractGraphModel::nodeUpdated, this, onNode));
+        _connections.push_back(
+            connect(model, &AbstractGraphModel::nodePositionUpdated, this, onNode));
+
+        _connections.push_back(connect(model,
+                                       &AbstractGraphModel::nodePositionsUpdated,
+                                       this,
+                                       [this](std::vector<NodeId> const &nodeIds) {
+                                           if (batching())
+                                               return;
+
+                                           for (NodeId const nodeId : nodeIds) {
+                                               updateNode(nodeId);
+                                           }
+                                       }));
+
+        _connections.push_back(connect(model,
+                                       &AbstractGraphModel::nodeDeleted,
+                                       this,
+                                       [this](NodeId const nodeId) {
+                                           if (!batching())
+                                               removeNode(nodeId);
+                                       }));
+
+        _connections.push_back(connect(model, &AbstractGraphModel::modelReset, this, [this]() {
+            if (!batching())
+                reindex();
+        }));
+
+        _connections.push_back(connect(model,
+                                       &AbstractGraphModel::batchFinished,
+                                       this,
+                                       &GraphMinimap::applyChanges));
+    }
+
+    reindex();
+}
+
+void GraphMinimap::setNodeColor(NodeColor nodeColor)
+{
+    _nodeColor = std::move(nodeColor);
+
+    _imageStale = true;
+    update();
+}
+
+QSize GraphMinimap::sizeHint() const
+{
+    return QSize(240, 160);
+}
+
+void GraphMinimap::paintEvent(QPaintEvent *)
+{
+    if (_imageStale) {
+        renderAll();
+    } else {
+        for (QRect const &area : _dirty) {
+            render(area);
+        }
+    }
+
+    _dirty = QRegion();
+
+    QPainter painter(this);
+
+    if (_image.isNull()) {
+        painter.fillRect(rect(), styleContext(_view).viewStyle().BackgroundColor);
+        return;
+    }
+
+    painter.drawImage(0, 0, _image);
+
+    if (!_view)
+        return;
+
+    QRectF const visible = _view->mapToScene(_view->viewport()->rect()).boundingRect();
+
+    painter.setPen(QPen(palette().color(QPalette::Highlight), 1.5));
+    painter.setBrush(Qt::NoBrush);
+
+    QRectF const inside = QRectF(rect()).adjusted(1, 1, -1, -1);
+
+    painter.drawRect(_toWidget.mapRect(visible).intersected(inside));
+}
+
+void GraphMinimap::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+
+    _imageStale = true;
+}
+
+void GraphMinimap::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton)
+        centerView(event->pos());
+}
+
+void GraphMinimap::mouseMoveEvent(QMouseEvent *event)
+{
+    if (event->buttons() & Qt::LeftButton)
+        centerView(event->pos());
+}
+
+bool GraphMinimap::eventFilter(QObject *watched, QEvent *event)
+{
+    if (_view && watched == _view->viewport() && event->type() == QEvent::Resize)
+        update();
+
+    return QWidget::eventFilter(watched, event);
+}
+
+bool GraphMinimap::batching() const
+{
+    return _scene && _scene->graphModel().batchInProgress();
+}
+
+void GraphMinimap::reindex()
+{
+    _index.clear();
+    _bounds = QRectF();
+
+    _imageStale = true;
+    _dirty = QRegion();
+
+    if (_scene) {
+        for (NodeId const nodeId : _scene->graphModel().allNodeIds()) {
+            updateNode(nodeId);
+        }
+    }
+
+    update();
+}
+
+void GraphMinimap::updateNode(NodeId const nodeId)
+{
+    AbstractGraphModel &model = _scene->graphModel();
+
+    if (!model.nodeExists(nodeId)) {
+        removeNode(nodeId);
+        return;
+    }
+
+    QPointF const position = model.nodeData<QPointF>(nodeId, NodeRole::Position);
+
+    QRectF const nodeRect(position, QSizeF(_scene->nodeGeometry().size(nodeId)));
+
+    if (QRectF const *previous = _index.rect(nodeId))
+        markDirty(*previous);
+
+    _index.insert(nodeId, nodeRect);
+
+    _bounds = _bounds.isNull() ? nodeRect : _bounds.united(nodeRect);
+
+    // The image has to be fitted to the new bounds.
+    if (!_shownRect.contains(nodeRect))
+        _imageStale = true;
+
+    markDirty(nodeRect);
+
+    update();
+}
+
+void GraphMinimap::removeNode(NodeId const nodeId)
+{
+    if (QRectF const *previous = _index.rect(nodeId)) {
+        markDirty(*previous);
+
+        _index.remove(nodeId);
+
+        update();
+    }
+}
+
+void GraphMinimap::applyChanges(GraphChangeSet const &changes)
+{
+    if (!_scene)
+        return;
+
+    if (changes.reset) {
+        reindex();
+        return;
+    }
+
+    for (NodeId const nodeId : changes.deletedNodes) {
+        removeNode(nodeId);
+    }
+
+    for (NodeId const nodeId : changes.createdNodes) {
+        updateNode(nodeId);
+    }
+
+    for (NodeId const nodeId : changes.movedNodes) {
+        updateNode(nodeId);
+    }
+
+    for (NodeId const nodeId : changes.updatedNodes) {
+        updateNode(nodeId);
+    }
+}
+
+void GraphMinimap::markDirty(QRectF const &sceneRect)
+{
+    if (_imageStale)
+        return;
+
+    _dirty += _toWidget.mapRect(sceneRect).toAlignedRect().adjusted(-1, -1, 1, 1);
+
+    if (_dirty.rectCount() > MaxDirtyRects) {
+        _imageStale = true;
+        _dirty = QRegion();
+    }
+}
+
+void GraphMinimap::renderAll()
+{
+    _imageStale = false;
+
+    if (width() <= 0 || height() <= 0) {
+        _image = QImage();
+        return;
+    }
+
+    qreal const ratio = devicePixelRatioF();
+
+    if (_image.size() != size() * ratio) {
+        _image = QImage(size() * ratio, QImage::Format_ARGB32_Premultiplied);
+        _image.setDevicePixelRatio(ratio);
+    }
+
+    QRectF bounds = _bounds.isNull() ? QRectF(-500, -500, 1000, 1000) : _bounds;
+
+    qreal const margin = 0.05 * std::max(bounds.width(), bounds.height()) + 20;
+    bounds.adjust(-margin, -margin, margin, margin);
+
+    // Keeps the aspect ratio, the spare room goes to both sides.
+    qreal const scale = std::min(width() / bounds.width(), height() / bounds.height());
+
+    QSizeF const shownSize(width() / scale, height() / scale);
+
+    _shownRect = QRectF(bounds.center() - QPointF(shownSize.width(), shownSize.height()) / 2,
+                        shownSize);
+
+    _toWidget = QTransform(scale,
+                           0,
+                           0,
+                           scale,
+                           -_shownRect.left() * scale,
+                           -_shownRect.top() * scale);
+
+    render(rect());
+}
+
+void GraphMinimap::render(QRect const &area)
+{
+    if (_image.isNull())
+        return;
+
+    QPainter painter(&_image);
+
+    painter.setClipRect(area);
+    StyleContext const &styles = styleContext(_view);
+
+    painter.fillRect(area, styles.viewStyle().BackgroundColor);
+
+    QColor const defaultColor = styles.nodeStyle().GradientColor1;
+
+    QRectF const sceneArea = _toWidget.inverted().mapRect(QRectF(area));
+
+    _index.query(sceneArea, [&](NodeId const nodeId, QRectF const &nodeRect) {
+        QRectF shown = _toWidget.mapRect(nodeRect);
+
+        // Every node stays visible as at least a pixel.
+        shown.setWidth(std::max<qreal>(shown.width(), 1));
+        shown.setHeight(std::max<qreal>(shown.height(), 1));
+
+        painter.fillRect(shown, _nodeColor ? _nodeColor(nodeId) : defaultColor);
+    });
+}
+
+void GraphMinimap::centerView(QPoint const &position)
+{
+    if (_view && !_image.isNull())
+        _view->centerOn(_toWidget.inverted().map(QPointF(position)));
+}
+
+} // namespace QtNodes
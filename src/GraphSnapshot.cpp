@@ -0,0 +1,111 @@
+#include "GraphSnapshot.hpp"
+
+#include "AbstractGraphModel.hpp"
+#include "ConnectionIdUtils.hpp"
+
+#include <algorithm>
+
+namespace QtNodes {
+
+namespace {
+
+bool lessByInNode(ConnectionId const &a, ConnectionId const &b)
+{
+    if (a.inNodeId != b.inNodeId)
+        return a.inNodeId < b.inNodeId;
+
+    return a < b;
+}
+
+} // namespace
+
+GraphSnapshot::GraphSnapshot()
+    : GraphSnapshot(std::make_shared<NodeTable const>(), std::make_shared<ConnectionTable const>())
+{}
+
+GraphSnapshot::GraphSnapshot(std::shared_ptr<NodeTable const> nodes,
+                             std::shared_ptr<ConnectionTable const> connections)
+    : _nodes(std::move(nodes))
+    , _connections(std::move(connections))
+{}
+
+std::shared_ptr<GraphSnapshot::NodeTable const> GraphSnapshot::makeNodeTable(
+    AbstractGraphModel const &model)
+{
+    auto table = std::make_shared<NodeTable>();
+
+    model.forEachNodeGeometry([&](NodeId const nodeId, QPointF const &pos, QSize const &size) {
+        table->nodes.push_back(
+            Node{nodeId, model.nodeData<QString>(nodeId, NodeRole::Type), pos, size});
+    });
+
+    std::sort(table->nodes.begin(), table->nodes.end(), [](Node const &a, Node const &b) {
+        return a.id < b.id;
+    });
+
+    return table;
+}
+
+std::shared_ptr<GraphSnapshot::ConnectionTable const> GraphSnapshot::makeConnectionTable(
+    AbstractGraphModel const &model)
+{
+    auto table = std::make_shared<ConnectionTable>();
+
+    model.forEachGraphConnection(
+        [&](ConnectionId const &connectionId) { table->byOutNode.push_back(connectionId); });
+
+    std::sort(table->byOutNode.begin(), table->byOutNode.end());
+
+    table->byInNode = table->byOutNode;
+
+    std::sort(table->byInNode.begin(), table->byInNode.end(), lessByInNode);
+
+    return table;
+}
+
+GraphSnapshot::Node const *GraphSnapshot::node(NodeId const nodeId) const
+{
+    auto const &nodes = _nodes->nodes;
+
+    auto it = std::lower_bound(nodes.begin(), nodes.end(), nodeId, [](Node const &n, NodeId id) {
+        return n.id < id;
+    });
+
+    if (it == nodes.end() || it->id != nodeId)
+        return nullptr;
+
+    return &*it;
+}
+
+bool GraphSnapshot::connectionExists(ConnectionId const connectionId) const
+{
+    return std::binary_search(_connections->byOutNode.begin(),
+                              _connections->byOutNode.end(),
+                              connectionId);
+}
+
+GraphSnapshot::ConnectionRange GraphSnapshot::connections(NodeId const nodeId,
+                                                          PortType const portType) const
+{
+    auto const &table = portType == PortType::Out ? _connections->byOutNode
+                                                  : _connections->byInNode;
+
+    if (portType == PortType::None)
+        return {table.end(), table.end()};
+
+    auto key = [portType](ConnectionId const &c) { return getNodeId(portType, c); };
+
+    auto first = std::lower_bound(table.begin(),
+                                  table.end(),
+                                  nodeId,
+                                  [&](ConnectionId const &c, NodeId id) { return key(c) < id; });
+
+    auto last = std::upper_bound(first,
+                                 table.end(),
+                                 nodeId,
+                                 [&](NodeId id, ConnectionId const &c) { return id < key(c); });
+
+    return {first, last};
+}
+
+} // namespace QtNodes
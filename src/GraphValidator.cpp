@@ -0,0 +1,538 @@
+#include "GraphValidator.hpp"
+
+#include "AbstractGraphModel.hpp"
+#include "ConnectionIdUtils.hpp"
+#include "DataFlowGraphModel.hpp"
+#include "NodeDelegateModel.hpp"
+
+#include <QtCore/QRunnable>
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+namespace QtNodes {
+
+using Diagnostic = GraphValidator::Diagnostic;
+
+struct GraphValidator::Job
+{
+    GraphSnapshot snapshot;
+
+    PortTables ports;
+
+    CancellationToken token;
+};
+
+namespace {
+
+/// Runs one chunk of a validation and hands its diagnostics to `done`.
+class ChunkTask : public QRunnable
+{
+public:
+    using Work = std::function<std::vector<Diagnostic>()>;
+    using Done = std::function<void(std::vector<Diagnostic>)>;
+
+    ChunkTask(Work work, Done done)
+        : _work(std::move(work))
+        , _done(std::move(done))
+    {}
+
+    void run() override { _done(_work()); }
+
+private:
+    Work _work;
+    Done _done;
+};
+
+GraphValidator::PortInfo const *findPort(GraphValidator::PortTables const &ports,
+                                         NodeId const nodeId,
+                                         PortType const portType,
+                                         PortIndex const portIndex)
+{
+    auto it = ports.find(nodeId);
+
+    if (it == ports.end())
+        return nullptr;
+
+    auto const &list = it->second->ports(portType);
+
+    return portIndex < list.size() ? &list[portIndex] : nullptr;
+}
+
+Diagnostic connectionDiagnostic(Diagnostic::Kind const kind,
+                                ConnectionId const &connectionId,
+                                QString message)
+{
+    Diagnostic d;
+    d.kind = kind;
+    d.nodeId = connectionId.inNodeId;
+    d.portType = PortType::In;
+    d.portIndex = connectionId.inPortIndex;
+    d.connectionId = connectionId;
+    d.message = std::move(message);
+
+    return d;
+}
+
+std::vector<Diagnostic> checkConnections(GraphSnapshot const &snapshot,
+                                         GraphValidator::PortTables const &ports,
+                                         std::size_t const first,
+                                         std::size_t const last,
+                                         CancellationToken const &token)
+{
+    std::vector<Diagnostic> result;
+
+    std::vector<ConnectionId> const &connections = snapshot.connections();
+
+    for (std::size_t i = first; i < last && !token.isCancelled(); ++i) {
+        ConnectionId const &c = connections[i];
+
+        auto out = findPort(ports, c.outNodeId, PortType::Out, c.outPortIndex);
+        auto in = findPort(ports, c.inNodeId, PortType::In, c.inPortIndex);
+
+        if (!out || !in) {
+            result.push_back(
+                connectionDiagnostic(Diagnostic::Kind::DanglingConnection,
+                                     c,
+                                     GraphValidator::tr("Connection %1:%2 -> %3:%4 "
+                                                        "refers to a missing node or port")
+                                         .arg(c.outNodeId)
+                                         .arg(c.outPortIndex)
+                                         .arg(c.inNodeId)
+                                         .arg(c.inPortIndex)));
+            continue;
+        }
+
+        if (out->typeId != in->typeId) {
+            result.push_back(
+                connectionDiagnostic(Diagnostic::Kind::TypeMismatch,
+                                     c,
+                                     GraphValidator::tr("Connection %1:%2 -> %3:%4 "
+                                                        "joins ports of different data types")
+                                         .arg(c.outNodeId)
+                                         .arg(c.outPortIndex)
+                                         .arg(c.inNodeId)
+                                         .arg(c.inPortIndex)));
+        }
+    }
+
+    return result;
+}
+
+/// Policy and required-input checks of the ports of one node.
+void checkNodePorts(GraphSnapshot const &snapshot,
+                    NodeId const nodeId,
+                    GraphValidator::NodePorts const &nodePorts,
+                    PortType const portType,
+                    std::vector<std::size_t> &counts,
+                    std::vector<Diagnostic> &result)
+{
+    std::vector<GraphValidator::PortInfo> const &list = nodePorts.ports(portType);
+
+    counts.assign(list.size(), 0);
+
+    auto const range = snapshot.connections(nodeId, portType);
+
+    for (auto it = range.first; it != range.second; ++it) {
+        PortIndex const portIndex = getPortIndex(portType, *it);
+
+        if (portIndex < counts.size())
+            ++counts[portIndex];
+    }
+
+    for (PortIndex portIndex = 0; portIndex < list.size(); ++portIndex) {
+        Diagnostic d;
+        d.nodeId = nodeId;
+        d.portType = portType;
+        d.portIndex = portIndex;
+
+        if (list[portIndex].policy == ConnectionPolicy::One && counts[portIndex] > 1) {
+            d.kind = Diagnostic::Kind::PolicyViolation;
+            d.message = GraphValidator::tr("Port %1 of node %2 accepts one connection but has %3")
+                            .arg(portIndex)
+                            .arg(nodeId)
+                            .arg(counts[portIndex]);
+
+            result.push_back(std::move(d));
+        } else if (list[portIndex].required && counts[portIndex] == 0) {
+            d.kind = Diagnostic::Kind::MissingInput;
+            d.message = GraphValidator::tr("Required input %1 of node %2 is not connected")
+                            .arg(portIndex)
+                            .arg(nodeId);
+
+            result.push_back(std::move(d));
+        }
+    }
+}
+
+std::vector<Diagnostic> checkNodes(GraphSnapshot const &snapshot,
+                                   GraphValidator::PortTables const &ports,
+                                   std::size_t const first,
+                                   std::size_t const last,
+                                   CancellationToken const &token)
+{
+    std::vector<Diagnostic> result;
+
+    std::vector<GraphSnapshot::Node> const &nodes = snapshot.nodes();
+
+    std::vector<std::size_t> counts;
+
+    for (std::size_t i = first; i < last && !token.isCancelled(); ++i) {
+        NodeId const nodeId = nodes[i].id;
+
+        auto it = ports.find(nodeId);
+
+        if (it == ports.end())
+            continue;
+
+        checkNodePorts(snapshot, nodeId, *it->second, PortType::In, counts, result);
+        checkNodePorts(snapshot, nodeId, *it->second, PortType::Out, counts, result);
+    }
+
+    return result;
+}
+
+/// Strongly connected components with more than one node or a loop, by Tarjan's algorithm.
+/**
+ * Iterative, so that long chains do not exhaust the stack of a worker thread.
+ */
+std::vector<Diagnostic> findCycles(GraphSnapshot const &snapshot, CancellationToken const &token)
+{
+    std::vector<Diagnostic> result;
+
+    std::vector<GraphSnapshot::Node> const &nodes = snapshot.nodes();
+
+    auto slotOf = [&nodes](NodeId const nodeId) -> std::size_t {
+        auto it = std::lower_bound(nodes.begin(),
+                                   nodes.end(),
+                                   nodeId,
+                                   [](GraphSnapshot::Node const &node, NodeId const id) {
+                                       return node.id < id;
+                                   });
+
+        if (it == nodes.end() || it->id != nodeId)
+            return nodes.size();
+
+        return static_cast<std::size_t>(it - nodes.begin());
+    };
+
+    std::size_t const unvisited = nodes.size();
+
+    std::vector<std::size_t> index(nodes.size(), unvisited);
+    std::vector<std::size_t> lowLink(nodes.size(), 0);
+    std::vector<bool> onStack(nodes.size(), false);
+    std::vector<std::size_t> stack;
+
+    struct Frame
+    {
+        std::size_t slot;
+        GraphSnapshot::ConnectionRange edges;
+    };
+
+    std::vector<Frame> frames;
+    std::size_t nextIndex = 0;
+
+    auto enter = [&](std::size_t const slot) {
+        index[slot] = lowLink[slot] = nextIndex++;
+        stack.push_back(slot);
+        onStack[slot] = true;
+        frames.push_back(Frame{slot, snapshot.connections(nodes[slot].id, PortType::Out)});
+    };
+
+    for (std::size_t root = 0; root < nodes.size() && !token.isCancelled(); ++root) {
+        if (index[root] != unvisited)
+            continue;
+
+        enter(root);
+
+        while (!frames.empty()) {
+            Frame &frame = frames.back();
+
+            if (frame.edges.first != frame.edges.second) {
+                std::size_t const next = slotOf((frame.edges.first++)->inNodeId);
+
+                if (next == nodes.size())
+                    continue;
+
+                if (index[next] == unvisited)
+                    enter(next);
+                else if (onStack[next])
+                    lowLink[frame.slot] = std::min(lowLink[frame.slot], index[next]);
+
+                continue;
+            }
+
+            std::size_t const slot = frame.slot;
+            frames.pop_back();
+
+            if (!frames.empty())
+                lowLink[frames.back().slot] = std::min(lowLink[frames.back().slot], lowLink[slot]);
+
+            if (lowLink[slot] != index[slot])
+                continue;
+
+            std::vector<NodeId> component;
+
+            std::size_t member;
+            do {
+                member = stack.back();
+                stack.pop_back();
+                onStack[member] = false;
+                component.push_back(nodes[member].id);
+            } while (member != slot);
+
+            if (component.size() == 1) {
+                NodeId const nodeId = component.front();
+                auto const range = snapshot.connections(nodeId, PortType::Out);
+
+                bool const loop = std::any_of(range.first,
+                                              range.second,
+                                              [nodeId](ConnectionId const &c) {
+                                                  return c.inNodeId == nodeId;
+                                              });
+
+                if (!loop)
+                    continue;
+            }
+
+            std::sort(component.begin(), component.end());
+
+            Diagnostic d;
+            d.kind = Diagnostic::Kind::Cycle;
+            d.nodeId = component.front();
+            d.message = GraphValidator::tr("Node %1 and %2 other nodes form a cycle")
+                            .arg(component.front())
+                            .arg(component.size() - 1);
+            d.cycle = std::move(component);
+
+            result.push_back(std::move(d));
+        }
+    }
+
+    return result;
+}
+
+std::shared_ptr<GraphValidator::NodePorts const> readPorts(AbstractGraphModel const &model,
+                                                           NodeId const nodeId)
+{
+    auto ports = std::make_shared<GraphValidator::NodePorts>();
+
+    for (PortType const portType : {PortType::In, PortType::Out}) {
+        NodeRole const countRole = portType == PortType::In ? NodeRole::InPortCount
+                                                            : NodeRole::OutPortCount;
+
+        unsigned int const count = model.nodeData(nodeId, countRole).toUInt();
+
+        std::vector<GraphValidator::PortInfo> &list = portType == PortType::In ? ports->in
+                                                                               : ports->out;
+        list.resize(count);
+
+        for (PortIndex portIndex = 0; portIndex < count; ++portIndex) {
+            GraphValidator::PortInfo &info = list[portIndex];
+
+            info.typeId = model.portDataTypeId(nodeId, portType, portIndex);
+
+            QVariant const policy = model.portData(nodeId,
+                                                   portType,
+                                                   portIndex,
+                                                   PortRole::ConnectionPolicyRole);
+
+            info.policy = policy.isValid() ? policy.value<ConnectionPolicy>()
+                                           : (portType == PortType::In ? ConnectionPolicy::One
+                                                                       : ConnectionPolicy::Many);
+
+            if (portType == PortType::In)
+                info.required = model.portData(nodeId, portType, portIndex, PortRole::Required)
+                                    .toBool();
+        }
+    }
+
+    return ports;
+}
+
+std::shared_ptr<GraphValidator::NodePorts const> tablePorts(PortTable const &table)
+{
+    auto ports = std::make_shared<GraphValidator::NodePorts>();
+
+    for (PortType const portType : {PortType::In, PortType::Out}) {
+        std::vector<GraphValidator::PortInfo> &list = portType == PortType::In ? ports->in
+                                                                               : ports->out;
+
+        for (PortSpec const &spec : table.ports(portType)) {
+            GraphValidator::PortInfo info;
+            info.typeId = spec.typeId;
+            info.policy = spec.policy;
+
+            list.push_back(info);
+        }
+    }
+
+    return ports;
+}
+
+} // namespace
+
+GraphValidator::GraphValidator(AbstractGraphModel const &model, QObject *parent)
+    : QObject(parent)
+    , _model(model)
+    , _chunkSize(4096)
+    , _pendingChunks(0)
+{}
+
+GraphValidator::~GraphValidator()
+{
+    cancel();
+
+    _pool.waitForDone();
+}
+
+void GraphValidator::start()
+{
+    cancel();
+
+    _diagnostics.clear();
+
+    auto job = std::make_shared<Job>();
+    job->snapshot = _model.snapshot();
+    job->ports = capturePorts(_model, job->snapshot);
+
+    _job = job;
+
+    auto schedule = [this, job](std::function<std::vector<Diagnostic>()> work) {
+        ++_pendingChunks;
+
+        _pool.start(new ChunkTask(std::move(work), [this, job](std::vector<Diagnostic> found) {
+            QMetaObject::invokeMethod(
+                this,
+                [this, job, found = std::move(found)]() mutable {
+                    onChunkFinished(job, std::move(found));
+                },
+                Qt::QueuedConnection);
+        }));
+    };
+
+    // The cycle search needs the whole graph and runs alongside the chunks.
+    schedule([job]() { return findCycles(job->snapshot, job->token); });
+
+    std::size_t const connectionCount = job->snapshot.connections().size();
+
+    for (std::size_t first = 0; first < connectionCount; first += _chunkSize) {
+        std::size_t const last = std::min(connectionCount, first + _chunkSize);
+
+        schedule([job, first, last]() {
+            return checkConnections(job->snapshot, job->ports, first, last, job->token);
+        });
+    }
+
+    std::size_t const nodeCount = job->snapshot.nodes().size();
+
+    for (std::size_t first = 0; first < nodeCount; first += _chunkSize) {
+        std::size_t const last = std::min(nodeCount, first + _chunkSize);
+
+        schedule([job, first, last]() {
+            return checkNodes(job->snapshot, job->ports, first, last, job->token);
+        });
+    }
+}
+
+void GraphValidator::cancel()
+{
+    if (_job)
+        _job->token.cancel();
+
+    _job.reset();
+    _pendingChunks = 0;
+}
+
+void GraphValidator::onChunkFinished(std::shared_ptr<Job const> const &job,
+                                     std::vector<Diagnostic> diagnostics)
+{
+    if (job != _job)
+        return;
+
+    if (!diagnostics.empty()) {
+        _diagnostics.insert(_diagnostics.end(), diagnostics.begin(), diagnostics.end());
+
+        Q_EMIT diagnosticsFound(diagnostics);
+    }
+
+    if (--_pendingChunks == 0) {
+        _job.reset();
+
+        Q_EMIT finished();
+    }
+}
+
+GraphValidator::PortTables GraphValidator::capturePorts(AbstractGraphModel const &model,
+                                                        GraphSnapshot const &snapshot)
+{
+    PortTables result;
+    result.reserve(snapshot.nodes().size());
+
+    auto dataFlowModel = qobject_cast<DataFlowGraphModel *>(
+        const_cast<AbstractGraphModel *>(&model));
+
+    std::unordered_map<PortTable const *, std::shared_ptr<NodePorts const>> shared;
+
+    for (GraphSnapshot::Node const &node : snapshot.nodes()) {
+        NodeDelegateModel *delegate = dataFlowModel
+                                          ? dataFlowModel->delegateModel<NodeDelegateModel>(node.id)
+                                          : nullptr;
+
+        PortTable const *table = delegate ? delegate->portTable() : nullptr;
+
+        if (!table) {
+            result.emplace(node.id, readPorts(model, node.id));
+            continue;
+        }
+
+        std::shared_ptr<NodePorts const> &ports = shared[table];
+
+        if (!ports)
+            ports = tablePorts(*table);
+
+        // Whether an input is required may differ between nodes of one type.
+        std::shared_ptr<NodePorts> own;
+
+        for (PortIndex portIndex = 0; portIndex < table->in.size(); ++portIndex) {
+            if (!delegate->inputRequired(portIndex))
+                continue;
+
+            if (!own)
+                own = std::make_shared<NodePorts>(*ports);
+
+            own->in[portIndex].required = true;
+        }
+
+        if (own)
+            result.emplace(node.id, std::move(own));
+        else
+            result.emplace(node.id, ports);
+    }
+
+    return result;
+}
+
+std::vector<Diagnostic> GraphValidator::validate(GraphSnapshot const &snapshot,
+                                                 PortTables const &ports)
+{
+    CancellationToken const token;
+
+    std::vector<Diagnostic> result = findCycles(snapshot, token);
+
+    std::vector<Diagnostic> connections = checkConnections(snapshot,
+                                                           ports,
+                                                           0,
+                                                           snapshot.connections().size(),
+                                                           token);
+
+    std::vector<Diagnostic> nodes = checkNodes(snapshot, ports, 0, snapshot.nodes().size(), token);
+
+    result.insert(result.end(), connections.begin(), connections.end());
+    result.insert(result.end(), nodes.begin(), nodes.end());
+
+    return result;
+}
+
+} // namespace QtNodes
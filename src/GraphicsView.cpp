@@ -2,6 +2,7 @@
 
 #include "BasicGraphicsScene.hpp"
 #include "ConnectionGraphicsObject.hpp"
+#include "DataFlowGraphModel.hpp"
 #include "NodeGraphicsObject.hpp"
 #include "StyleCollection.hpp"
 #include "UndoCommands.hpp"
@@ -12,6 +13,7 @@
 #include <QtGui/QPen>
 
 #include <QtWidgets/QMenu>
+#include <QtWidgets/QScrollBar>
 
 #include <QtCore/QDebug>
 #include <QtCore/QPointF>
@@ -20,6 +22,13 @@
 #include <QtOpenGL>
 #include <QtWidgets>
 
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <QtOpenGLWidgets/QOpenGLWidget>
+#else
+#include <QtWidgets/QOpenGLWidget>
+#endif
+
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
@@ -77,6 +86,9 @@ void GraphicsView::setScene(BasicGraphicsScene *scene)
 {
     QGraphicsView::setScene(scene);
 
+    if (scene)
+        setBackgroundBrush(scene->styleContext().viewStyle().BackgroundColor);
+
     {
         // setup actions
         delete _clearSelectionAction;
@@ -144,12 +156,26 @@ void GraphicsView::setScene(BasicGraphicsScene *scene)
     auto redoAction = scene->undoStack().createRedoAction(this, tr("&Redo"));
     redoAction->setShortcuts(QKeySequence::Redo);
     addAction(redoAction);
+
+    if (_viewportUpdatePolicy == ViewportUpdatePolicy::Adaptive) {
+        disconnect(_sceneChangedConnection);
+        _sceneChangedConnection = connect(scene,
+                                          &QGraphicsScene::changed,
+                                          this,
+                                          &GraphicsView::onSceneChanged);
+    }
+
+    updateVisibleSceneRect();
 }
 
 void GraphicsView::centerScene()
 {
     if (scene()) {
-        scene()->setSceneRect(QRectF());
+        // A node scene tracks its bounds, others scan all of their items.
+        if (auto basicScene = nodeScene())
+            basicScene->fitSceneRectToContent();
+        else
+            scene()->setSceneRect(QRectF());
 
         QRectF sceneRect = scene()->sceneRect();
 
@@ -231,6 +257,7 @@ void GraphicsView::scaleUp()
     }
 
     scale(factor, factor);
+    updateVisibleSceneRect();
     Q_EMIT scaleChanged(transform().m11());
 }
 
@@ -249,6 +276,7 @@ void GraphicsView::scaleDown()
     }
 
     scale(factor, factor);
+    updateVisibleSceneRect();
     Q_EMIT scaleChanged(transform().m11());
 }
 
@@ -265,6 +293,7 @@ void GraphicsView::setupScale(double scale)
     QTransform matrix;
     matrix.scale(scale, scale);
     setTransform(matrix, false);
+    updateVisibleSceneRect();
 
     Q_EMIT scaleChanged(scale);
 }
@@ -276,10 +305,7 @@ void GraphicsView::onDeleteSelectedObjects()
 
 void GraphicsView::onDuplicateSelectedObjects()
 {
-    QPointF const pastePosition = scenePastePosition();
-
-    nodeScene()->undoStack().push(new CopyCommand(nodeScene()));
-    nodeScene()->undoStack().push(new PasteCommand(nodeScene(), pastePosition));
+    nodeScene()->undoStack().push(new DuplicateCommand(nodeScene(), scenePastePosition()));
 }
 
 void GraphicsView::onCopySelectedObjects()
@@ -324,7 +350,7 @@ void GraphicsView::mousePressEvent(QMouseEvent *event)
 {
     QGraphicsView::mousePressEvent(event);
     if (event->button() == Qt::RightButton) {
-        _clickPos = mapToScene(event->pos());
+        _panPos = event->pos();
     }
 }
 
@@ -334,51 +360,309 @@ void GraphicsView::mouseMoveEvent(QMouseEvent *event)
     if (scene()->mouseGrabberItem() == nullptr && event->buttons() == Qt::RightButton) {
         // Make sure shift is not being pressed
         if ((event->modifiers() & Qt::ShiftModifier) == 0) {
-            QPointF difference = _clickPos - mapToScene(event->pos());
-            setSceneRect(sceneRect().translated(difference.x(), difference.y()));
+            QPoint const delta = event->pos() - _panPos;
+
+            // Scrolling lets the viewport blit what is already painted and
+            // only draw the exposed strip, moving the scene rect repaints all.
+            horizontalScrollBar()->setValue(horizontalScrollBar()->value() - delta.x());
+            verticalScrollBar()->setValue(verticalScrollBar()->value() - delta.y());
         }
+
+        _panPos = event->pos();
     }
 }
 
+namespace {
+
+constexpr double FineGridStep = 15.0;
+
+constexpr double CoarseGridStep = 150.0;
+
+/// Fine lines closer than this on screen, in pixels, are left out.
+constexpr double MinFineGridSpacing = 5.0;
+
+} // namespace
+
 void GraphicsView::drawBackground(QPainter *painter, const QRectF &r)
 {
+    QtNodes::PaintStatistics::Scope scope(QtNodes::PaintStatistics::Background);
+
     QGraphicsView::drawBackground(painter, r);
 
-    auto drawGrid = [&](double gridStep) {
-        QRect windowRect = rect();
-        QPointF tl = mapToScene(windowRect.topLeft());
-        QPointF br = mapToScene(windowRect.bottomRight());
+    qreal const deviceScale = getScale()
+                              * (painter->device() ? painter->device()->devicePixelRatioF() : 1.0);
 
-        double left = std::floor(tl.x() / gridStep - 0.5);
-        double right = std::floor(br.x() / gridStep + 1.0);
-        double bottom = std::floor(tl.y() / gridStep - 0.5);
-        double top = std::floor(br.y() / gridStep + 1.0);
+    QPixmap const &tile = gridTile(deviceScale);
 
-        // vertical lines
-        for (int xi = int(left); xi <= int(right); ++xi) {
-            QLineF line(xi * gridStep, bottom * gridStep, xi * gridStep, top * gridStep);
+    // The tile spans exactly one coarse cell in scene units, anchored at the
+    // scene origin like the grid lines were.
+    QBrush brush(tile);
+    brush.setTransform(QTransform::fromScale(CoarseGridStep / tile.width(),
+                                             CoarseGridStep / tile.height()));
 
-            painter->drawLine(line);
-        }
+    painter->fillRect(r, brush);
+}
+
+void GraphicsView::drawForeground(QPainter *painter, const QRectF &r)
+{
+    QGraphicsView::drawForeground(painter, r);
+
+    if (!_paintStatistics || !_paintStatisticsOverlay)
+        return;
+
+    QStringList const lines = _paintStatistics->summary();
+
+    QFontMetrics const metrics(font());
+
+    int width = 0;
+
+    for (QString const &line : lines) {
+        width = std::max(width, metrics.horizontalAdvance(line));
+    }
+
+    int const margin = 6;
+
+    _paintStatisticsOverlayRect = QRect(8,
+                                        8,
+                                        width + 2 * margin,
+                                        lines.size() * metrics.lineSpacing() + 2 * margin);
+
+    painter->save();
+    painter->resetTransform();
+
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(QColor(0, 0, 0, 160));
+    painter->drawRect(_paintStatisticsOverlayRect);
+
+    painter->setPen(Qt::white);
+    painter->setFont(font());
+
+    int y = _paintStatisticsOverlayRect.top() + margin + metrics.ascent();
+
+    for (QString const &line : lines) {
+        painter->drawText(_paintStatisticsOverlayRect.left() + margin, y, line);
+        y += metrics.lineSpacing();
+    }
+
+    painter->restore();
+}
+
+bool GraphicsView::viewportEvent(QEvent *event)
+{
+    if (!_paintStatistics)
+        return QGraphicsView::viewportEvent(event);
+
+    QtNodes::PaintStatistics::Activation activation(_paintStatistics.get());
+
+    if (event->type() != QEvent::Paint)
+        return QGraphicsView::viewportEvent(event);
+
+    // Repaints of the overlay alone would keep refreshing it forever.
+    auto const paintEvent = static_cast<QPaintEvent *>(event);
+
+    if (_paintStatisticsOverlay && _paintStatisticsOverlayRect.contains(paintEvent->rect()))
+        return QGraphicsView::viewportEvent(event);
+
+    _paintStatistics->beginFrame();
+
+    bool const result = QGraphicsView::viewportEvent(event);
+
+    _paintStatistics->endFrame();
+
+    if (_paintStatisticsOverlay)
+        viewport()->update(_paintStatisticsOverlayRect);
+
+    return result;
+}
+
+void GraphicsView::setPaintStatisticsEnabled(bool const enabled, bool const overlay)
+{
+    if (enabled) {
+        if (!_paintStatistics)
+            _paintStatistics = std::make_unique<QtNodes::PaintStatistics>();
+    } else {
+        _paintStatistics.reset();
+    }
+
+    _paintStatisticsOverlay = enabled && overlay;
+
+    viewport()->update();
+}
+
+void GraphicsView::setComputeHeatMapEnabled(bool const enabled)
+{
+    auto scene = nodeScene();
+
+    if (!scene)
+        return;
+
+    if (enabled) {
+        if (auto model = qobject_cast<DataFlowGraphModel *>(&scene->graphModel()))
+            model->setNodeStatisticsEnabled(true);
+    }
+
+    scene->setComputeHeatScale(enabled ? 16.0 : 0.0);
+}
+
+bool GraphicsView::computeHeatMapEnabled() const
+{
+    auto scene = dynamic_cast<BasicGraphicsScene *>(this->scene());
+
+    return scene && scene->computeHeatScale() > 0.0;
+}
+
+QPixmap const &GraphicsView::gridTile(qreal const deviceScale)
+{
+    // Zoom steps are coarse enough that this bucketing only merges
+    // indistinguishable scales.
+    qreal const scale = std::round(deviceScale * 64.0) / 64.0;
+
+    BasicGraphicsScene *scene = nodeScene();
 
-        // horizontal lines
-        for (int yi = int(bottom); yi <= int(top); ++yi) {
-            QLineF line(left * gridStep, yi * gridStep, right * gridStep, yi * gridStep);
-            painter->drawLine(line);
+    StyleContext const &styles = scene ? scene->styleContext() : StyleCollection::current();
+
+    unsigned int const revision = styles.revision();
+
+    if (!_gridTile.isNull() && _gridTileScale == scale && _gridTileStyleRevision == revision)
+        return _gridTile;
+
+    _gridTileScale = scale;
+    _gridTileStyleRevision = revision;
+
+    auto const &flowViewStyle = styles.viewStyle();
+
+    int const size = std::max(1, qRound(CoarseGridStep * scale));
+
+    qreal const pixelsPerUnit = size / CoarseGridStep;
+
+    _gridTile = QPixmap(size, size);
+    _gridTile.fill(Qt::transparent);
+
+    QPainter painter(&_gridTile);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    // Lines lie on the tile edges, each edge gets half of their width and
+    // neighbouring tiles complete them.
+    auto drawLines = [&](double const step, QColor const &color) {
+        painter.setPen(QPen(color, pixelsPerUnit));
+
+        for (double position = 0.0; position <= CoarseGridStep + 0.5; position += step) {
+            qreal const p = position * pixelsPerUnit;
+
+            painter.drawLine(QLineF(p, 0, p, size));
+            painter.drawLine(QLineF(0, p, size, p));
         }
     };
 
-    auto const &flowViewStyle = StyleCollection::flowViewStyle();
+    if (FineGridStep * pixelsPerUnit >= MinFineGridSpacing)
+        drawLines(FineGridStep, flowViewStyle.FineGridColor);
+
+    drawLines(CoarseGridStep, flowViewStyle.CoarseGridColor);
+
+    return _gridTile;
+}
+
+void GraphicsView::setOpenGLViewport(bool const enabled, int const samples)
+{
+    if (enabled) {
+        auto widget = new QOpenGLWidget;
+
+        QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+        format.setSamples(samples);
+        widget->setFormat(format);
 
-    QPen pfine(flowViewStyle.FineGridColor, 1.0);
+        setViewport(widget);
 
-    painter->setPen(pfine);
-    drawGrid(15);
+        setViewportUpdateMode(QGraphicsView::FullViewportUpdate);
+    } else if (openGLViewport()) {
+        setViewport(new QWidget);
 
-    QPen p(flowViewStyle.CoarseGridColor, 1.0);
+        setViewportUpdateMode(QGraphicsView::BoundingRectViewportUpdate);
+    }
+}
+
+bool GraphicsView::openGLViewport() const
+{
+    return qobject_cast<QOpenGLWidget *>(viewport()) != nullptr;
+}
+
+void GraphicsView::setViewportUpdatePolicy(ViewportUpdatePolicy const policy)
+{
+    if (_viewportUpdatePolicy == policy)
+        return;
+
+    _viewportUpdatePolicy = policy;
 
-    painter->setPen(p);
-    drawGrid(150);
+    disconnect(_sceneChangedConnection);
+
+    if (policy == ViewportUpdatePolicy::Adaptive && scene()) {
+        _sceneChangedConnection = connect(scene(),
+                                          &QGraphicsScene::changed,
+                                          this,
+                                          &GraphicsView::onSceneChanged);
+    }
+
+    if (policy == ViewportUpdatePolicy::Fixed && !openGLViewport())
+        setViewportUpdateMode(QGraphicsView::BoundingRectViewportUpdate);
+}
+
+void GraphicsView::resetViewportUpdateStatistics()
+{
+    _viewportUpdateStatistics = ViewportUpdateStatistics();
+}
+
+void GraphicsView::onSceneChanged(QList<QRectF> const &region)
+{
+    // More rectangles than this cost more to clip to than repainting all.
+    int const maxDirtyRects = 64;
+
+    double const fullUpdateCoverage = 0.5;
+
+    QRect const viewportRect = viewport()->rect();
+
+    double const viewportArea = double(viewportRect.width()) * viewportRect.height();
+
+    if (viewportArea <= 0)
+        return;
+
+    double dirtyArea = 0;
+    int dirtyRects = 0;
+
+    for (QRectF const &rect : region) {
+        QRect const dirty = mapFromScene(rect).boundingRect().intersected(viewportRect);
+
+        if (dirty.isEmpty())
+            continue;
+
+        dirtyArea += double(dirty.width()) * dirty.height();
+        ++dirtyRects;
+    }
+
+    // Overlapping rectangles may add up past the viewport.
+    double const coverage = std::min(1.0, dirtyArea / viewportArea);
+
+    auto &statistics = _viewportUpdateStatistics;
+
+    if (dirtyRects == 0)
+        return;
+
+    ++statistics.frames;
+    statistics.lastCoverage = coverage;
+    statistics.lastDirtyRectCount = dirtyRects;
+    statistics.averageCoverage = statistics.frames == 1
+                                     ? coverage
+                                     : 0.9 * statistics.averageCoverage + 0.1 * coverage;
+
+    bool const full = coverage > fullUpdateCoverage || dirtyRects > maxDirtyRects;
+
+    if (full)
+        ++statistics.fullUpdateFrames;
+
+    if (openGLViewport())
+        return;
+
+    setViewportUpdateMode(full ? QGraphicsView::FullViewportUpdate
+                               : QGraphicsView::SmartViewportUpdate);
 }
 
 void GraphicsView::showEvent(QShowEvent *event)
@@ -386,6 +670,22 @@ void GraphicsView::showEvent(QShowEvent *event)
     QGraphicsView::showEvent(event);
 
     centerScene();
+
+    updateVisibleSceneRect();
+}
+
+void GraphicsView::resizeEvent(QResizeEvent *event)
+{
+    QGraphicsView::resizeEvent(event);
+
+    updateVisibleSceneRect();
+}
+
+void GraphicsView::scrollContentsBy(int dx, int dy)
+{
+    QGraphicsView::scrollContentsBy(dx, dy);
+
+    updateVisibleSceneRect();
 }
 
 BasicGraphicsScene *GraphicsView::nodeScene()
@@ -403,3 +703,13 @@ QPointF GraphicsView::scenePastePosition()
 
     return mapToScene(origin);
 }
+
+void GraphicsView::updateVisibleSceneRect()
+{
+    auto scene = nodeScene();
+
+    if (!scene)
+        return;
+
+    scene->setVisibleSceneRect(mapToScene(viewport()->rect()).boundingRect());
+}
@@ -15,13 +15,31 @@ inline void initResources()
 }
 
 GraphicsViewStyle::GraphicsViewStyle()
+    : GraphicsViewStyle(defaultStyle())
+{}
+
+GraphicsViewStyle::GraphicsViewStyle(QJsonObject const &json)
+{
+    loadJson(json);
+}
+
+GraphicsViewStyle const &GraphicsViewStyle::defaultStyle()
 {
-    // Explicit resources inialization for preventing the static initialization
-    // order fiasco: https://isocpp.org/wiki/faq/ctors#static-init-order
-    initResources();
+    static GraphicsViewStyle const style = []() {
+        // Explicit resources inialization for preventing the static initialization
+        // order fiasco: https://isocpp.org/wiki/faq/ctors#static-init-order
+        initResources();
+
+        // This configuration is stored inside the compiled unit and is loaded statically
+        QFile file(":DefaultStyle.json");
+
+        if (!file.open(QIODevice::ReadOnly))
+            qWarning() << "Couldn't open file " << file.fileName();
+
+        return GraphicsViewStyle(QJsonDocument::fromJson(file.readAll()).object());
+    }();
 
-    // This configuration is stored inside the compiled unit and is loaded statically
-    loadJsonFile(":DefaultStyle.json");
+    return style;
 }
 
 GraphicsViewStyle::GraphicsViewStyle(QString jsonText)
@@ -0,0 +1,1120 @@
+#include "GroupedGraphModel.hpp"
+
+#include "ConnectionIdUtils.hpp"
+#include "DataFlowGraphModel.hpp"
+#include "SceneJson.hpp"
+#include "StyleCollection.hpp"
+
+#include <QtCore/QJsonArray>
+
+#include <algorithm>
+#include <limits>
+
+namespace QtNodes {
+
+namespace {
+
+QString const GroupKey = QStringLiteral("group");
+
+std::uint64_t portKey(NodeId const nodeId, PortIndex const portIndex)
+{
+    return (static_cast<std::uint64_t>(nodeId) << 32) | portIndex;
+}
+
+QJsonObject pointJson(QPointF const &point)
+{
+    QJsonObject json;
+    json["x"] = point.x();
+    json["y"] = point.y();
+    return json;
+}
+
+QPointF jsonPoint(QJsonValue const &value)
+{
+    return pointFromJson(value);
+}
+
+/// Replaces the node and port of one end of `connectionId`.
+void setEnd(ConnectionId &connectionId,
+            PortType const portType,
+            NodeId const nodeId,
+            PortIndex const portIndex)
+{
+    if (portType == PortType::Out) {
+        connectionId.outNodeId = nodeId;
+        connectionId.outPortIndex = portIndex;
+    } else {
+        connectionId.inNodeId = nodeId;
+        connectionId.inPortIndex = portIndex;
+    }
+}
+
+} // namespace
+
+PortIndex GroupedGraphModel::Group::find(PortType const portType,
+                                         NodeId const nodeId,
+                                         PortIndex const index) const
+{
+    auto const &lookup = portType == PortType::In ? inPortIndex : outPortIndex;
+
+    auto it = lookup.find(portKey(nodeId, index));
+
+    return it != lookup.end() ? it->second : InvalidPortIndex;
+}
+
+PortIndex GroupedGraphModel::Group::add(PortType const portType,
+                                        NodeId const nodeId,
+                                        PortIndex const index)
+{
+    PortIndex const existing = find(portType, nodeId, index);
+    if (existing != InvalidPortIndex)
+        return existing;
+
+    std::vector<PortRef> &refs = ports(portType);
+
+    PortIndex const port = static_cast<PortIndex>(refs.size());
+    refs.push_back(PortRef{nodeId, index});
+
+    (portType == PortType::In ? inPortIndex : outPortIndex)[portKey(nodeId, index)] = port;
+
+    return port;
+}
+
+GroupedGraphModel::GroupedGraphModel(AbstractGraphModel &sourceModel, QObject *parent)
+    : AbstractGraphModel(parent)
+    , _source(sourceModel)
+{
+    connectSource();
+}
+
+GroupedGraphModel::~GroupedGraphModel()
+{
+    if (auto dataFlow = qobject_cast<DataFlowGraphModel *>(&_source)) {
+        for (auto const &group : _groups) {
+            dataFlow->setEvaluationUnit(group.first, {});
+        }
+    }
+}
+
+NodeId GroupedGraphModel::collapse(std::unordered_set<NodeId> const &nodeIds,
+                                   QString const &caption)
+{
+    std::vector<NodeId> members;
+    members.reserve(nodeIds.size());
+
+    for (NodeId const nodeId : nodeIds) {
+        if (_source.nodeExists(nodeId) && _groupOf.count(nodeId) == 0 && !isGroup(nodeId))
+            members.push_back(nodeId);
+    }
+
+    if (members.empty())
+        return InvalidNodeId;
+
+    // The ports of the group come out in the same order every time.
+    std::sort(members.begin(), members.end());
+
+    std::unordered_set<NodeId> const memberSet(members.begin(), members.end());
+
+    Group group;
+    group.caption = caption.isEmpty() ? QStringLiteral("Group") : caption;
+    group.members = memberSet;
+
+    // Connections the way listeners still know them.
+    std::vector<ConnectionId> hidden;
+    std::vector<ConnectionId> crossing;
+
+    QPointF origin(std::numeric_limits<double>::max(), std::numeric_limits<double>::max());
+
+    for (NodeId const member : members) {
+        QPointF const position = _source.nodeData<QPointF>(member, NodeRole::Position);
+
+        origin.setX(std::min(origin.x(), position.x()));
+        origin.setY(std::min(origin.y(), position.y()));
+
+        _source.forEachNodeConnection(member, [&](ConnectionId const &connectionId) {
+            bool const outInside = memberSet.count(connectionId.outNodeId) > 0;
+            bool const inInside = memberSet.count(connectionId.inNodeId) > 0;
+
+            // Connections among the members are visited from both ends.
+            if (outInside && inInside && connectionId.outNodeId != member)
+                return;
+
+            ConnectionId groupedId;
+            if (toGrouped(connectionId, groupedId))
+                hidden.push_back(groupedId);
+
+            if (outInside && inInside)
+                return;
+
+            if (outInside)
+                group.add(PortType::Out, connectionId.outNodeId, connectionId.outPortIndex);
+            else
+                group.add(PortType::In, connectionId.inNodeId, connectionId.inPortIndex);
+
+            crossing.push_back(connectionId);
+        });
+    }
+
+    group.position = origin;
+    group.origin = origin;
+
+    NodeId const groupId = _source.newNodeId();
+
+    GraphTransaction transaction(*this);
+
+    for (ConnectionId const &connectionId : hidden) {
+        Q_EMIT connectionDeleted(connectionId);
+    }
+
+    for (NodeId const member : members) {
+        Q_EMIT nodeDeleted(member);
+
+        _groupOf[member] = groupId;
+    }
+
+    _groups.emplace(groupId, std::move(group));
+
+    Q_EMIT nodeCreated(groupId);
+
+    for (ConnectionId const &connectionId : crossing) {
+        ConnectionId groupedId;
+        if (toGrouped(connectionId, groupedId))
+            Q_EMIT connectionCreated(groupedId);
+    }
+
+    updateEvaluationUnit(groupId);
+
+    return groupId;
+}
+
+std::unordered_set<NodeId> GroupedGraphModel::expand(NodeId const groupId)
+{
+    auto it = _groups.find(groupId);
+    if (it == _groups.end())
+        return {};
+
+    GraphTransaction transaction(*this);
+
+    for (ConnectionId const &connectionId : allConnectionIds(groupId)) {
+        Q_EMIT connectionDeleted(connectionId);
+    }
+
+    std::unordered_set<NodeId> const members = it->second.members;
+
+    // Still hidden, so the moves are not reported for nodes not shown yet.
+    QPointF const delta = it->second.position - it->second.origin;
+
+    if (!delta.isNull())
+        _source.moveNodes(std::vector<NodeId>(members.begin(), members.end()), delta);
+
+    _groups.erase(it);
+
+    for (NodeId const member : members) {
+        _groupOf.erase(member);
+    }
+
+    updateEvaluationUnit(groupId);
+
+    Q_EMIT nodeDeleted(groupId);
+
+    for (NodeId const member : members) {
+        Q_EMIT nodeCreated(member);
+    }
+
+    for (NodeId const member : members) {
+        auto create = [&](ConnectionId const &connectionId) {
+            // Connections among the members are created once, from their output.
+            if (connectionId.outNodeId == member || members.count(connectionId.outNodeId) == 0)
+                Q_EMIT connectionCreated(connectionId);
+        };
+
+        visitSource(member, PortType::None, InvalidPortIndex, create);
+    }
+
+    return members;
+}
+
+std::unordered_set<NodeId> GroupedGraphModel::groupMembers(NodeId const groupId) const
+{
+    Group const *group = findGroup(groupId);
+
+    return group ? group->members : std::unordered_set<NodeId>();
+}
+
+NodeId GroupedGraphModel::groupOf(NodeId const sourceNodeId) const
+{
+    auto it = _groupOf.find(sourceNodeId);
+
+    return it != _groupOf.end() ? it->second : InvalidNodeId;
+}
+
+std::pair<NodeId, PortIndex> GroupedGraphModel::sourcePort(NodeId const nodeId,
+                                                           PortType const portType,
+                                                           PortIndex const portIndex) const
+{
+    std::pair<NodeId, PortIndex> const invalid(InvalidNodeId, InvalidPortIndex);
+
+    if (Group const *group = findGroup(nodeId)) {
+        std::vector<PortRef> const &refs = group->ports(portType);
+
+        if (portIndex >= refs.size() || refs[portIndex].nodeId == InvalidNodeId)
+            return invalid;
+
+        return std::make_pair(refs[portIndex].nodeId, refs[portIndex].portIndex);
+    }
+
+    if (_groupOf.count(nodeId) > 0)
+        return invalid;
+
+    return std::make_pair(nodeId, portIndex);
+}
+
+NodeId GroupedGraphModel::newNodeId()
+{
+    return _source.newNodeId();
+}
+
+NodeId GroupedGraphModel::reserveNodeIds(std::size_t const count)
+{
+    return _source.reserveNodeIds(count);
+}
+
+void GroupedGraphModel::reserve(std::size_t const nodes, std::size_t const connections)
+{
+    _source.reserve(nodes, connections);
+}
+
+std::unordered_set<NodeId> GroupedGraphModel::allNodeIds() const
+{
+    std::unordered_set<NodeId> nodeIds = _source.allNodeIds();
+
+    for (auto const &hidden : _groupOf) {
+        nodeIds.erase(hidden.first);
+    }
+
+    for (auto const &group : _groups) {
+        nodeIds.insert(group.first);
+    }
+
+    return nodeIds;
+}
+
+std::unordered_set<ConnectionId> GroupedGraphModel::allConnectionIds(NodeId const nodeId) const
+{
+    std::unordered_set<ConnectionId> result;
+
+    auto collect = [&result](ConnectionId const &connectionId) { result.insert(connectionId); };
+
+    if (Group const *group = findGroup(nodeId)) {
+        for (NodeId const member : group->members) {
+            visitSource(member, PortType::None, InvalidPortIndex, collect);
+        }
+    } else if (_groupOf.count(nodeId) == 0) {
+        visitSource(nodeId, PortType::None, InvalidPortIndex, collect);
+    }
+
+    return result;
+}
+
+std::unordered_set<ConnectionId> GroupedGraphModel::connections(NodeId nodeId,
+                                                                PortType portType,
+                                                                PortIndex portIndex) const
+{
+    std::unordered_set<ConnectionId> result;
+
+    std::pair<NodeId, PortIndex> const port = sourcePort(nodeId, portType, portIndex);
+
+    if (port.first != InvalidNodeId) {
+        visitSource(port.first, portType, port.second, [&result](ConnectionId const &connectionId) {
+            result.insert(connectionId);
+        });
+    }
+
+    return result;
+}
+
+bool GroupedGraphModel::connectionExists(ConnectionId const connectionId) const
+{
+    ConnectionId sourceId;
+
+    return toSource(connectionId, sourceId) && _source.connectionExists(sourceId);
+}
+
+NodeId GroupedGraphModel::addNode(QString const nodeType)
+{
+    return _source.addNode(nodeType);
+}
+
+bool GroupedGraphModel::connectionPossible(ConnectionId const connectionId) const
+{
+    ConnectionId sourceId;
+
+    return toSource(connectionId, sourceId) && _source.connectionPossible(sourceId);
+}
+
+bool GroupedGraphModel::detachPossible(ConnectionId const connectionId) const
+{
+    ConnectionId sourceId;
+
+    return toSource(connectionId, sourceId) && _source.detachPossible(sourceId);
+}
+
+void GroupedGraphModel::addConnection(ConnectionId const connectionId)
+{
+    ConnectionId sourceId;
+
+    if (toSource(connectionId, sourceId))
+        _source.addConnection(sourceId);
+}
+
+bool GroupedGraphModel::nodeExists(NodeId const nodeId) const
+{
+    if (isGroup(nodeId))
+        return true;
+
+    return _groupOf.count(nodeId) == 0 && _source.nodeExists(nodeId);
+}
+
+QVariant GroupedGraphModel::nodeData(NodeId nodeId, NodeRole role) const
+{
+    Group const *group = findGroup(nodeId);
+
+    if (!group) {
+        if (_groupOf.count(nodeId) > 0)
+            return QVariant();
+
+        return _source.nodeData(nodeId, role);
+    }
+
+    QVariant result;
+
+    switch (role) {
+    case NodeRole::Type:
+        result = GroupKey;
+        break;
+
+    case NodeRole::Position:
+        result = group->position;
+        break;
+
+    case NodeRole::Size:
+        result = group->size;
+        break;
+
+    case NodeRole::CaptionVisible:
+        result = true;
+        break;
+
+    case NodeRole::Caption:
+        result = group->caption;
+        break;
+
+    case NodeRole::Style: {
+        auto style = StyleCollection::nodeStyle();
+        result = style.toJson().toVariantMap();
+    } break;
+
+    case NodeRole::StylePtr:
+        result = QVariant::fromValue(StyleCollection::sharedNodeStyle());
+        break;
+
+    case NodeRole::Computing:
+        result = std::any_of(group->members.begin(),
+                             group->members.end(),
+                             [this](NodeId const member) {
+                                 return _source.nodeData<bool>(member, NodeRole::Computing);
+                             });
+        break;
+
+    case NodeRole::InternalData:
+        break;
+
+    case NodeRole::InPortCount:
+        result = static_cast<unsigned int>(group->inPorts.size());
+        break;
+
+    case NodeRole::OutPortCount:
+        result = static_cast<unsigned int>(group->outPorts.size());
+        break;
+
+    case NodeRole::Widget:
+        break;
+
+    case NodeRole::WidgetSizeHint:
+        break;
+
+    case NodeRole::ComputeTime: {
+        // The members run one after the other.
+        double total = 0.0;
+        bool known = false;
+
+        for (NodeId const member : group->members) {
+            QVariant const time = _source.nodeData(member, NodeRole::ComputeTime);
+
+            if (time.isValid()) {
+                total += time.toDouble();
+                known = true;
+            }
+        }
+
+        if (known)
+            result = total;
+    } break;
+
+    case NodeRole::LayoutKey:
+        break;
+    }
+
+    return result;
+}
+
+NodeFlags GroupedGraphModel::nodeFlags(NodeId nodeId) const
+{
+    if (isGroup(nodeId) || _groupOf.count(nodeId) > 0)
+        return NodeFlag::NoFlags;
+
+    return _source.nodeFlags(nodeId);
+}
+
+bool GroupedGraphModel::setNodeData(NodeId nodeId, NodeRole role, QVariant value)
+{
+    Group *group = findGroup(nodeId);
+
+    if (!group) {
+        if (_groupOf.count(nodeId) > 0)
+            return false;
+
+        return _source.setNodeData(nodeId, role, std::move(value));
+    }
+
+    switch (role) {
+    case NodeRole::Position:
+        group->position = value.value<QPointF>();
+        Q_EMIT nodePositionUpdated(nodeId);
+        return true;
+
+    case NodeRole::Size:
+        group->size = value.value<QSize>();
+        return true;
+
+    case NodeRole::Caption:
+        group->caption = value.toString();
+        Q_EMIT nodeUpdated(nodeId);
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+void GroupedGraphModel::moveNodes(std::vector<NodeId> const &nodeIds, QPointF const &delta)
+{
+    std::vector<NodeId> groups;
+    std::vector<NodeId> others;
+
+    for (NodeId const nodeId : nodeIds) {
+        if (Group *group = findGroup(nodeId)) {
+            group->position += delta;
+            groups.push_back(nodeId);
+        } else if (_groupOf.count(nodeId) == 0) {
+            others.push_back(nodeId);
+        }
+    }
+
+    if (!others.empty())
+        _source.moveNodes(others, delta);
+
+    if (!groups.empty())
+        Q_EMIT nodePositionsUpdated(groups);
+}
+
+void GroupedGraphModel::setNodePositions(std::vector<std::pair<NodeId, QPointF>> const &positions)
+{
+    std::vector<NodeId> groups;
+    std::vector<std::pair<NodeId, QPointF>> others;
+
+    for (auto const &position : positions) {
+        if (Group *group = findGroup(position.first)) {
+            group->position = position.second;
+            groups.push_back(position.first);
+        } else if (_groupOf.count(position.first) == 0) {
+            others.push_back(position);
+        }
+    }
+
+    if (!others.empty())
+        _source.setNodePositions(others);
+
+    if (!groups.empty())
+        Q_EMIT nodePositionsUpdated(groups);
+}
+
+QVariant GroupedGraphModel::portData(NodeId nodeId,
+                                     PortType portType,
+                                     PortIndex portIndex,
+                                     PortRole role) const
+{
+    std::pair<NodeId, PortIndex> const port = sourcePort(nodeId, portType, portIndex);
+
+    if (port.first == InvalidNodeId)
+        return QVariant();
+
+    if (!isGroup(nodeId))
+        return _source.portData(nodeId, portType, portIndex, role);
+
+    // The ports of a group tell which member they belong to.
+    switch (role) {
+    case PortRole::CaptionVisible:
+        return true;
+
+    case PortRole::Caption: {
+        QString const nodeCaption = _source.nodeData<QString>(port.first, NodeRole::Caption);
+        QString const portCaption = _source.portData<bool>(port.first,
+                                                           portType,
+                                                           port.second,
+                                                           PortRole::CaptionVisible)
+                                        ? _source.portData<QString>(port.first,
+                                                                    portType,
+                                                                    port.second,
+                                                                    PortRole::Caption)
+                                        : QString();
+
+        if (portCaption.isEmpty())
+            return nodeCaption;
+
+        return nodeCaption + QStringLiteral(": ") + portCaption;
+    }
+
+    default:
+        return _source.portData(port.first, portType, port.second, role);
+    }
+}
+
+bool GroupedGraphModel::setPortData(NodeId nodeId,
+                                    PortType portType,
+                                    PortIndex portIndex,
+                                    QVariant const &value,
+                                    PortRole role)
+{
+    std::pair<NodeId, PortIndex> const port = sourcePort(nodeId, portType, portIndex);
+
+    if (port.first == InvalidNodeId)
+        return false;
+
+    return _source.setPortData(port.first, portType, port.second, value, role);
+}
+
+bool GroupedGraphModel::deleteConnection(ConnectionId const connectionId)
+{
+    ConnectionId sourceId;
+
+    return toSource(connectionId, sourceId) && _source.deleteConnection(sourceId);
+}
+
+bool GroupedGraphModel::deleteNode(NodeId const nodeId)
+{
+    if (Group const *group = findGroup(nodeId)) {
+        // The group goes with its last member, see `onSourceNodeDeleted()`.
+        _source.deleteNodes(std::vector<NodeId>(group->members.begin(), group->members.end()));
+
+        return !isGroup(nodeId);
+    }
+
+    if (_groupOf.count(nodeId) > 0)
+        return false;
+
+    return _source.deleteNode(nodeId);
+}
+
+QJsonObject GroupedGraphModel::saveNode(NodeId const nodeId) const
+{
+    Group const *group = findGroup(nodeId);
+
+    if (!group) {
+        if (_groupOf.count(nodeId) > 0)
+            return QJsonObject();
+
+        return _source.saveNode(nodeId);
+    }
+
+    std::vector<NodeId> members(group->members.begin(), group->members.end());
+    std::sort(members.begin(), members.end());
+
+    QJsonArray nodesJson;
+    QJsonArray connectionsJson;
+
+    for (NodeId const member : members) {
+        nodesJson.append(_source.saveNode(member));
+
+        _source.forEachNodeConnection(member, [&](ConnectionId const &connectionId) {
+            if (connectionId.outNodeId == member && group->members.count(connectionId.inNodeId))
+                connectionsJson.append(toJson(connectionId));
+        });
+    }
+
+    auto portsJson = [&](PortType const portType) {
+        QJsonArray json;
+
+        for (PortRef const &ref : group->ports(portType)) {
+            QJsonObject refJson;
+            refJson["node"] = static_cast<qint64>(ref.nodeId);
+            refJson["port"] = static_cast<qint64>(ref.portIndex);
+            json.append(refJson);
+        }
+
+        return json;
+    };
+
+    QJsonObject groupJson;
+    groupJson["caption"] = group->caption;
+    groupJson["origin"] = pointJson(group->origin);
+    groupJson["nodes"] = nodesJson;
+    groupJson["connections"] = connectionsJson;
+    groupJson["in-ports"] = portsJson(PortType::In);
+    groupJson["out-ports"] = portsJson(PortType::Out);
+
+    QJsonObject nodeJson;
+    nodeJson["id"] = static_cast<qint64>(nodeId);
+    nodeJson["position"] = pointJson(group->position);
+    nodeJson[GroupKey] = groupJson;
+
+    return nodeJson;
+}
+
+void GroupedGraphModel::loadNode(QJsonObject const &nodeJson)
+{
+    if (!nodeJson.contains(GroupKey)) {
+        _source.loadNode(nodeJson);
+        return;
+    }
+
+    NodeId const groupId = static_cast<NodeId>(nodeJson["id"].toInt());
+    QJsonObject const groupJson = nodeJson[GroupKey].toObject();
+
+    QJsonArray nodesJson = groupJson["nodes"].toArray();
+
+    // Pasted copies of a group meet their originals in the source.
+    std::unordered_map<NodeId, NodeId> newIds;
+
+    for (QJsonValueRef value : nodesJson) {
+        QJsonObject memberJson = value.toObject();
+
+        NodeId const memberId = static_cast<NodeId>(memberJson["id"].toInt());
+        NodeId const newId = _source.nodeExists(memberId) ? _source.newNodeId() : memberId;
+
+        newIds[memberId] = newId;
+
+        memberJson["id"] = static_cast<qint64>(newId);
+        value = memberJson;
+    }
+
+    auto mapped = [&newIds](NodeId const nodeId) {
+        auto it = newIds.find(nodeId);
+        return it != newIds.end() ? it->second : InvalidNodeId;
+    };
+
+    Group group;
+    group.caption = groupJson["caption"].toString();
+    group.position = jsonPoint(nodeJson["position"]);
+    group.origin = jsonPoint(groupJson["origin"]);
+
+    for (auto const &ids : newIds) {
+        group.members.insert(ids.second);
+    }
+
+    for (PortType const portType : {PortType::In, PortType::Out}) {
+        QString const key = portType == PortType::In ? QStringLiteral("in-ports")
+                                                     : QStringLiteral("out-ports");
+
+        for (QJsonValue const value : groupJson[key].toArray()) {
+            QJsonObject const refJson = value.toObject();
+
+            NodeId const nodeId = mapped(static_cast<NodeId>(refJson["node"].toInt()));
+            PortIndex const portIndex = static_cast<PortIndex>(refJson["port"].toInt());
+
+            std::vector<PortRef> &refs = group.ports(portType);
+
+            // Empty slots are kept so the other ports keep their indices.
+            if (nodeId == InvalidNodeId) {
+                refs.push_back(PortRef{InvalidNodeId, InvalidPortIndex});
+                continue;
+            }
+
+            auto &lookup = portType == PortType::In ? group.inPortIndex : group.outPortIndex;
+            lookup[portKey(nodeId, portIndex)] = static_cast<PortIndex>(refs.size());
+
+            refs.push_back(PortRef{nodeId, portIndex});
+        }
+    }
+
+    GraphTransaction transaction(*this);
+
+    // Hidden before they exist, the members never show up here.
+    for (NodeId const member : group.members) {
+        _groupOf[member] = groupId;
+    }
+
+    _groups.emplace(groupId, std::move(group));
+
+    Q_EMIT nodeCreated(groupId);
+
+    for (QJsonValue const value : nodesJson) {
+        _source.loadNode(value.toObject());
+    }
+
+    for (QJsonValue const value : groupJson["connections"].toArray()) {
+        ConnectionId connectionId = fromJson(value.toObject());
+
+        connectionId.outNodeId = mapped(connectionId.outNodeId);
+        connectionId.inNodeId = mapped(connectionId.inNodeId);
+
+        if (connectionId.outNodeId != InvalidNodeId && connectionId.inNodeId != InvalidNodeId)
+            _source.addConnection(connectionId);
+    }
+
+    updateEvaluationUnit(groupId);
+}
+
+void GroupedGraphModel::connectSource()
+{
+    AbstractGraphModel *source = &_source;
+
+    connect(source, &AbstractGraphModel::nodeCreated, this, [this](NodeId const nodeId) {
+        if (_groupOf.count(nodeId) == 0)
+            Q_EMIT nodeCreated(nodeId);
+    });
+
+    connect(source,
+            &AbstractGraphModel::nodeDeleted,
+            this,
+            &GroupedGraphModel::onSourceNodeDeleted);
+
+    // A member changing is the group changing.
+    connect(source, &AbstractGraphModel::nodeUpdated, this, [this](NodeId const nodeId) {
+        auto it = _groupOf.find(nodeId);
+        Q_EMIT nodeUpdated(it != _groupOf.end() ? it->second : nodeId);
+    });
+
+    connect(source, &AbstractGraphModel::nodeFlagsUpdated, this, [this](NodeId const nodeId) {
+        if (_groupOf.count(nodeId) == 0)
+            Q_EMIT nodeFlagsUpdated(nodeId);
+    });
+
+    connect(source, &AbstractGraphModel::nodePositionUpdated, this, [this](NodeId const nodeId) {
+        if (_groupOf.count(nodeId) == 0)
+            Q_EMIT nodePositionUpdated(nodeId);
+    });
+
+    connect(source,
+            &AbstractGraphModel::nodePositionsUpdated,
+            this,
+            [this](std::vector<NodeId> const &nodeIds) {
+                std::vector<NodeId> visible;
+                visible.reserve(nodeIds.size());
+
+                for (NodeId const nodeId : nodeIds) {
+                    if (_groupOf.count(nodeId) == 0)
+                        visible.push_back(nodeId);
+                }
+
+                if (!visible.empty())
+                    Q_EMIT nodePositionsUpdated(visible);
+            });
+
+    connect(source,
+            &AbstractGraphModel::connectionCreated,
+            this,
+            &GroupedGraphModel::onSourceConnectionCreated);
+
+    connect(source,
+            &AbstractGraphModel::connectionDeleted,
+            this,
+            &GroupedGraphModel::onSourceConnectionDeleted);
+
+    connect(source,
+            &AbstractGraphModel::connectionsRemapped,
+            this,
+            &GroupedGraphModel::onSourceConnectionsRemapped);
+
+    connect(source, &AbstractGraphModel::modelReset, this, &GroupedGraphModel::onSourceReset);
+
+    // Listeners of this model get the batches of the source as their own.
+    connect(source, &AbstractGraphModel::batchStarted, this, [this]() { beginBatch(); });
+
+    connect(source, &AbstractGraphModel::batchFinished, this, [this]() { endBatch(); });
+}
+
+GroupedGraphModel::Group *GroupedGraphModel::findGroup(NodeId const nodeId)
+{
+    auto it = _groups.find(nodeId);
+
+    return it != _groups.end() ? &it->second : nullptr;
+}
+
+GroupedGraphModel::Group const *GroupedGraphModel::findGroup(NodeId const nodeId) const
+{
+    auto it = _groups.find(nodeId);
+
+    return it != _groups.end() ? &it->second : nullptr;
+}
+
+void GroupedGraphModel::addGroupPorts(ConnectionId const &sourceId)
+{
+    NodeId const outGroup = groupOf(sourceId.outNodeId);
+    NodeId const inGroup = groupOf(sourceId.inNodeId);
+
+    if (outGroup == inGroup)
+        return;
+
+    for (PortType const portType : {PortType::Out, PortType::In}) {
+        NodeId const groupId = portType == PortType::Out ? outGroup : inGroup;
+
+        if (groupId == InvalidNodeId)
+            continue;
+
+        Group &group = _groups.at(groupId);
+
+        std::size_t const count = group.ports(portType).size();
+
+        group.add(portType, getNodeId(portType, sourceId), getPortIndex(portType, sourceId));
+
+        if (group.ports(portType).size() != count)
+            Q_EMIT nodeUpdated(groupId);
+    }
+}
+
+bool GroupedGraphModel::toGrouped(ConnectionId const &sourceId, ConnectionId &groupedId) const
+{
+    NodeId const outGroup = groupOf(sourceId.outNodeId);
+    NodeId const inGroup = groupOf(sourceId.inNodeId);
+
+    if (outGroup != InvalidNodeId && outGroup == inGroup)
+        return false;
+
+    groupedId = sourceId;
+
+    for (PortType const portType : {PortType::Out, PortType::In}) {
+        NodeId const groupId = portType == PortType::Out ? outGroup : inGroup;
+
+        if (groupId == InvalidNodeId)
+            continue;
+
+        PortIndex const port = _groups.at(groupId).find(portType,
+                                                        getNodeId(portType, sourceId),
+                                                        getPortIndex(portType, sourceId));
+
+        if (port == InvalidPortIndex)
+            return false;
+
+        setEnd(groupedId, portType, groupId, port);
+    }
+
+    return true;
+}
+
+bool GroupedGraphModel::toSource(ConnectionId const &groupedId, ConnectionId &sourceId) const
+{
+    sourceId = groupedId;
+
+    for (PortType const portType : {PortType::Out, PortType::In}) {
+        NodeId const nodeId = getNodeId(portType, groupedId);
+
+        std::pair<NodeId, PortIndex> const port
+            = sourcePort(nodeId, portType, getPortIndex(portType, groupedId));
+
+        if (port.first == InvalidNodeId)
+            return false;
+
+        setEnd(sourceId, portType, port.first, port.second);
+    }
+
+    return true;
+}
+
+void GroupedGraphModel::visitSource(NodeId const sourceNodeId,
+                                    PortType const portType,
+                                    PortIndex const portIndex,
+                                    ConnectionVisitor const &visitor) const
+{
+    auto forward = [this, &visitor](ConnectionId const &connectionId) {
+        ConnectionId groupedId;
+        if (toGrouped(connectionId, groupedId))
+            visitor(groupedId);
+    };
+
+    if (portType == PortType::None)
+        _source.forEachNodeConnection(sourceNodeId, forward);
+    else
+        _source.forEachConnection(sourceNodeId, portType, portIndex, forward);
+}
+
+void GroupedGraphModel::onSourceNodeDeleted(NodeId const nodeId)
+{
+    auto it = _groupOf.find(nodeId);
+
+    if (it == _groupOf.end()) {
+        Q_EMIT nodeDeleted(nodeId);
+        return;
+    }
+
+    NodeId const groupId = it->second;
+    _groupOf.erase(it);
+
+    Group &group = _groups.at(groupId);
+    group.members.erase(nodeId);
+
+    // Empty slots keep the other ports of the group, and their connections, in place.
+    for (PortType const portType : {PortType::In, PortType::Out}) {
+        auto &lookup = portType == PortType::In ? group.inPortIndex : group.outPortIndex;
+
+        for (PortRef &ref : group.ports(portType)) {
+            if (ref.nodeId != nodeId)
+                continue;
+
+            lookup.erase(portKey(ref.nodeId, ref.portIndex));
+            ref = PortRef{InvalidNodeId, InvalidPortIndex};
+        }
+    }
+
+    bool const empty = group.members.empty();
+
+    if (empty)
+        _groups.erase(groupId);
+
+    updateEvaluationUnit(groupId);
+
+    if (empty)
+        Q_EMIT nodeDeleted(groupId);
+    else
+        Q_EMIT nodeUpdated(groupId);
+}
+
+void GroupedGraphModel::onSourceConnectionCreated(ConnectionId const connectionId)
+{
+    addGroupPorts(connectionId);
+
+    ConnectionId groupedId;
+    if (toGrouped(connectionId, groupedId))
+        Q_EMIT connectionCreated(groupedId);
+}
+
+void GroupedGraphModel::onSourceConnectionDeleted(ConnectionId const connectionId)
+{
+    ConnectionId groupedId;
+    if (toGrouped(connectionId, groupedId))
+        Q_EMIT connectionDeleted(groupedId);
+}
+
+void GroupedGraphModel::onSourceConnectionsRemapped(ConnectionRemap const &remap)
+{
+    struct Move
+    {
+        Group *group;
+        PortType portType;
+        PortIndex port;
+        PortRef to;
+    };
+
+    std::vector<std::pair<bool, ConnectionId>> from;
+    std::vector<Move> moves;
+
+    from.reserve(remap.size());
+
+    // Read against the old ports of the groups.
+    for (auto const &shift : remap) {
+        ConnectionId groupedId;
+        bool const visible = toGrouped(shift.first, groupedId);
+
+        from.emplace_back(visible, groupedId);
+
+        for (PortType const portType : {PortType::Out, PortType::In}) {
+            Group *group = findGroup(groupOf(getNodeId(portType, shift.first)));
+
+            if (!group)
+                continue;
+
+            PortIndex const port = group->find(portType,
+                                               getNodeId(portType, shift.first),
+                                               getPortIndex(portType, shift.first));
+
+            if (port != InvalidPortIndex) {
+                moves.push_back(Move{group,
+                                     portType,
+                                     port,
+                                     PortRef{getNodeId(portType, shift.second),
+                                             getPortIndex(portType, shift.second)}});
+            }
+        }
+    }
+
+    // The group ports follow the member ports they stand for.
+    for (Move const &move : moves) {
+        PortRef const &ref = move.group->ports(move.portType)[move.port];
+
+        auto &lookup = move.portType == PortType::In ? move.group->inPortIndex
+                                                     : move.group->outPortIndex;
+
+        lookup.erase(portKey(ref.nodeId, ref.portIndex));
+    }
+
+    for (Move const &move : moves) {
+        move.group->ports(move.portType)[move.port] = move.to;
+
+        auto &lookup = move.portType == PortType::In ? move.group->inPortIndex
+                                                     : move.group->outPortIndex;
+
+        lookup[portKey(move.to.nodeId, move.to.portIndex)] = move.port;
+    }
+
+    ConnectionRemap groupedRemap;
+    groupedRemap.reserve(remap.size());
+
+    for (std::size_t i = 0; i < remap.size(); ++i) {
+        addGroupPorts(remap[i].second);
+
+        ConnectionId groupedId;
+        bool const visible = toGrouped(remap[i].second, groupedId);
+
+        if (from[i].first && visible)
+            groupedRemap.emplace_back(from[i].second, groupedId);
+        else if (from[i].first)
+            Q_EMIT connectionDeleted(from[i].second);
+        else if (visible)
+            Q_EMIT connectionCreated(groupedId);
+    }
+
+    if (!groupedRemap.empty())
+        Q_EMIT connectionsRemapped(groupedRemap);
+}
+
+void GroupedGraphModel::onSourceReset()
+{
+    std::vector<NodeId> groupIds;
+    groupIds.reserve(_groups.size());
+
+    for (auto const &group : _groups) {
+        groupIds.push_back(group.first);
+    }
+
+    _groups.clear();
+    _groupOf.clear();
+
+    for (NodeId const groupId : groupIds) {
+        updateEvaluationUnit(groupId);
+    }
+
+    Q_EMIT modelReset();
+}
+
+void GroupedGraphModel::updateEvaluationUnit(NodeId const groupId)
+{
+    auto dataFlow = qobject_cast<DataFlowGraphModel *>(&_source);
+    if (!dataFlow)
+        return;
+
+    Group const *group = findGroup(groupId);
+
+    dataFlow->setEvaluationUnit(groupId, group ? group->members : std::unordered_set<NodeId>());
+}
+
+} // namespace QtNodes
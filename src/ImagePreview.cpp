@@ -0,0 +1,177 @@
+#include "ImagePreview.hpp"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QPointer>
+#include <QtCore/QRunnable>
+#include <QtCore/QThreadPool>
+#include <QtGui/QPainter>
+
+#include <functional>
+
+namespace QtNodes {
+
+namespace {
+
+class ScaleTask : public QRunnable
+{
+public:
+    using Done = std::function<void(QImage const &)>;
+
+    ScaleTask(QImage image,
+              std::shared_ptr<TiledImageData const> tiledImage,
+              QSize const target,
+              CancellationToken token,
+              Done done)
+        : _image(std::move(image))
+        , _tiledImage(std::move(tiledImage))
+        , _target(target)
+        , _token(std::move(token))
+        , _done(std::move(done))
+    {}
+
+    void run() override
+    {
+        if (_token.isCancelled())
+            return;
+
+        QImage const source = _tiledImage ? _tiledImage->thumbnail(_target) : _image;
+
+        if (_token.isCancelled())
+            return;
+
+        QImage const scaled = source.scaled(_target, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+        if (!_token.isCancelled())
+            _done(scaled);
+    }
+
+private:
+    QImage _image;
+
+    std::shared_ptr<TiledImageData const> _tiledImage;
+
+    QSize _target;
+
+    CancellationToken _token;
+
+    Done _done;
+};
+
+} // namespace
+
+ImagePreview::ImagePreview(QObject *parent)
+    : QObject(parent)
+    , _generation(0)
+    , _cache(8)
+{}
+
+ImagePreview::~ImagePreview()
+{
+    _pendingToken.cancel();
+}
+
+void ImagePreview::setImage(QImage const &image)
+{
+    clear();
+
+    _image = image;
+}
+
+void ImagePreview::setImage(std::shared_ptr<TiledImageData const> image)
+{
+    clear();
+
+    _tiledImage = std::move(image);
+}
+
+void ImagePreview::clear()
+{
+    _pendingToken.cancel();
+    _pendingTarget = QSize();
+
+    ++_generation;
+
+    _image = QImage();
+    _tiledImage.reset();
+    _cache.clear();
+    _lastPreview = QImage();
+}
+
+QImage ImagePreview::preview(QSize const &target)
+{
+    if ((_image.isNull() && !_tiledImage) || target.isEmpty())
+        return QImage();
+
+    if (QImage const *cached = _cache.object(SizeKey(target.width(), target.height()))) {
+        _lastPreview = *cached;
+        return *cached;
+    }
+
+    if (_pendingTarget != target)
+        request(target);
+
+    return placeholder(target);
+}
+
+void ImagePreview::request(QSize const &target)
+{
+    // The size requested before is stale now.
+    _pendingToken.cancel();
+    _pendingToken = CancellationToken();
+    _pendingTarget = target;
+
+    QPointer<ImagePreview> guard(this);
+
+    std::uint64_t const generation = _generation;
+
+    auto done = [guard, generation, target](QImage const &image) {
+        // The preview may be gone once the event loop runs the result.
+        QMetaObject::invokeMethod(
+            QCoreApplication::instance(),
+            [guard, generation, target, image]() {
+                if (guard)
+                    guard->onScaled(generation, target, image);
+            },
+            Qt::QueuedConnection);
+    };
+
+    QThreadPool::globalInstance()->start(
+        new ScaleTask(_image, _tiledImage, target, _pendingToken, std::move(done)));
+}
+
+void ImagePreview::onScaled(std::uint64_t const generation,
+                            QSize const target,
+                            QImage const &image)
+{
+    if (generation != _generation)
+        return;
+
+    if (_pendingTarget == target)
+        _pendingTarget = QSize();
+
+    _cache.insert(SizeKey(target.width(), target.height()), new QImage(image), 1);
+
+    Q_EMIT previewReady(target);
+}
+
+QImage ImagePreview::placeholder(QSize const &target) const
+{
+    QImage result;
+
+    if (!_lastPreview.isNull()) {
+        result = _lastPreview.scaled(target, Qt::KeepAspectRatio, Qt::FastTransformation)
+                     .convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    } else {
+        result = QImage(target, QImage::Format_ARGB32_Premultiplied);
+        result.fill(Qt::transparent);
+    }
+
+    QPainter painter(&result);
+    painter.setOpacity(0.6);
+    painter.setPen(Qt::gray);
+    painter.drawText(result.rect(), Qt::AlignCenter, tr("Scaling..."));
+
+    return result;
+}
+
+} // namespace QtNodes
@@ -0,0 +1,650 @@
+#include "LayeredLayout.hpp"
+
+#include "AbstractGraphModel.hpp"
+#include "WorkStealingExecutor.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace QtNodes {
+
+namespace {
+
+/// Layouts of fewer vertices, dummies included, are computed on the calling thread.
+constexpr std::size_t ParallelThreshold = 4096;
+
+/// Vertices per task of the loops within a layer.
+constexpr std::size_t Grain = 1024;
+
+/// Calls `body(begin, end)` for chunks of `[0, count)` of at least `grain` items.
+template<typename Body>
+void parallelFor(WorkStealingExecutor *executor,
+                 std::size_t const count,
+                 std::size_t const grain,
+                 Body const &body)
+{
+    if (count == 0)
+        return;
+
+    if (!executor || count <= grain) {
+        body(std::size_t(0), count);
+        return;
+    }
+
+    std::size_t const chunks = std::min((count + grain - 1) / grain,
+                                        std::size_t(executor->workerCount() + 1) * 4);
+
+    std::size_t const step = (count + chunks - 1) / chunks;
+
+    std::vector<WorkStealingExecutor::Task> tasks;
+    tasks.reserve(chunks);
+
+    for (std::size_t begin = 0; begin < count; begin += step) {
+        std::size_t const end = std::min(begin + step, count);
+
+        WorkStealingExecutor::Task task;
+        task.run = [&body, begin, end]() { body(begin, end); };
+
+        tasks.push_back(std::move(task));
+    }
+
+    executor->run(tasks);
+}
+
+/// Adjacency lists in compressed rows: `targets[first[v]]` to `targets[first[v + 1]]`.
+struct Adjacency
+{
+    std::vector<std::size_t> first;
+    std::vector<std::size_t> targets;
+
+    Adjacency(std::size_t const count,
+              std::vector<std::pair<std::size_t, std::size_t>> const &edges)
+        : first(count + 1, 0)
+        , targets(edges.size())
+    {
+        for (auto const &edge : edges) {
+            ++first[edge.first + 1];
+        }
+
+        std::partial_sum(first.begin(), first.end(), first.begin());
+
+        std::vector<std::size_t> next(first.begin(), first.end() - 1);
+
+        for (auto const &edge : edges) {
+            targets[next[edge.first]++] = edge.second;
+        }
+    }
+
+    std::size_t degree(std::size_t const v) const { return first[v + 1] - first[v]; }
+};
+
+/// A run of vertices of one component within a layer.
+struct Block
+{
+    std::size_t begin;
+    std::size_t end;
+};
+
+} // namespace
+
+LayeredLayout::LayeredLayout(Options const &options)
+    : _options(options)
+{}
+
+LayeredLayout::~LayeredLayout() = default;
+
+void LayeredLayout::setOptions(Options const &options)
+{
+    if (options.threads != _options.threads)
+        _executor.reset();
+
+    _options = options;
+}
+
+LayeredLayout::Positions LayeredLayout::compute(GraphSnapshot const &snapshot)
+{
+    std::vector<GraphSnapshot::Node const *> nodes;
+    nodes.reserve(snapshot.nodes().size());
+
+    for (GraphSnapshot::Node const &node : snapshot.nodes()) {
+        nodes.push_back(&node);
+    }
+
+    return layout(snapshot, nodes);
+}
+
+LayeredLayout::Positions LayeredLayout::compute(GraphSnapshot const &snapshot,
+                                                std::unordered_set<NodeId> const &nodeIds)
+{
+    std::vector<GraphSnapshot::Node const *> nodes;
+    nodes.reserve(nodeIds.size());
+
+    for (GraphSnapshot::Node const &node : snapshot.nodes()) {
+        if (nodeIds.count(node.id) > 0)
+            nodes.push_back(&node);
+    }
+
+    return layout(snapshot, nodes);
+}
+
+void LayeredLayout::apply(AbstractGraphModel &model, std::unordered_set<NodeId> const &nodeIds)
+{
+    GraphSnapshot const snapshot = model.snapshot();
+
+    Positions const positions = nodeIds.empty() ? compute(snapshot) : compute(snapshot, nodeIds);
+
+    model.setNodePositions(positions);
+}
+
+QSize LayeredLayout::nodeSize(GraphSnapshot::Node const &node) const
+{
+    auto it = _sizes.find(node.id);
+
+    QSize const size = it != _sizes.end() ? it->second : node.size;
+
+    return QSize(std::max(size.width(), 0), std::max(size.height(), 0));
+}
+
+WorkStealingExecutor *LayeredLayout::executor()
+{
+    if (_options.threads == 1)
+        return nullptr;
+
+    if (!_executor) {
+        unsigned int const workers = _options.threads > 1 ? _options.threads - 1 : 0;
+
+        _executor = std::make_unique<WorkStealingExecutor>(workers);
+    }
+
+    return _executor.get();
+}
+
+LayeredLayout::Positions LayeredLayout::layout(
+    GraphSnapshot const &snapshot, std::vector<GraphSnapshot::Node const *> const &nodes)
+{
+    std::size_t const n = nodes.size();
+
+    if (n == 0)
+        return Positions();
+
+    bool const horizontal = _options.orientation == Qt::Horizontal;
+
+    std::unordered_map<NodeId, std::size_t> index;
+    index.reserve(n);
+
+    // Extents along the layers (depth) and across them, the previous order across them.
+    std::vector<double> depth(n);
+    std::vector<double> extent(n);
+    std::vector<double> key(n);
+
+    QPointF origin(std::numeric_limits<double>::max(), std::numeric_limits<double>::max());
+
+    for (std::size_t i = 0; i < n; ++i) {
+        GraphSnapshot::Node const &node = *nodes[i];
+
+        index.emplace(node.id, i);
+
+        QSize const size = nodeSize(node);
+
+        depth[i] = horizontal ? size.width() : size.height();
+        extent[i] = horizontal ? size.height() : size.width();
+        key[i] = horizontal ? node.position.y() : node.position.x();
+
+        origin.setX(std::min(origin.x(), node.position.x()));
+        origin.setY(std::min(origin.y(), node.position.y()));
+    }
+
+    // Connections among the nodes, each pair of nodes once.
+    std::vector<std::pair<std::size_t, std::size_t>> edges;
+
+    for (ConnectionId const &connectionId : snapshot.connections()) {
+        auto outIt = index.find(connectionId.outNodeId);
+        auto inIt = index.find(connectionId.inNodeId);
+
+        if (outIt != index.end() && inIt != index.end() && outIt->second != inIt->second)
+            edges.emplace_back(outIt->second, inIt->second);
+    }
+
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    // Connected components, numbered by their previous position.
+    std::vector<std::size_t> component(n);
+    std::size_t componentCount = 0;
+
+    {
+        std::vector<std::size_t> parent(n);
+        std::iota(parent.begin(), parent.end(), std::size_t(0));
+
+        auto find = [&parent](std::size_t v) {
+            while (parent[v] != v) {
+                parent[v] = parent[parent[v]];
+                v = parent[v];
+            }
+
+            return v;
+        };
+
+        for (auto const &edge : edges) {
+            parent[find(edge.first)] = find(edge.second);
+        }
+
+        std::vector<double> rootKey(n, std::numeric_limits<double>::max());
+
+        for (std::size_t i = 0; i < n; ++i) {
+            std::size_t const root = find(i);
+
+            parent[i] = root;
+            rootKey[root] = std::min(rootKey[root], key[i]);
+        }
+
+        std::vector<std::size_t> roots;
+
+        for (std::size_t i = 0; i < n; ++i) {
+            if (parent[i] == i)
+                roots.push_back(i);
+        }
+
+        std::stable_sort(roots.begin(), roots.end(), [&rootKey](std::size_t a, std::size_t b) {
+            return rootKey[a] < rootKey[b];
+        });
+
+        std::vector<std::size_t> number(n);
+
+        for (std::size_t c = 0; c < roots.size(); ++c) {
+            number[roots[c]] = c;
+        }
+
+        for (std::size_t i = 0; i < n; ++i) {
+            component[i] = number[parent[i]];
+        }
+
+        componentCount = roots.size();
+    }
+
+    // Cycles: the edges leading back into the depth-first search path are reversed.
+    {
+        Adjacency const out(n, edges);
+
+        // `Adjacency` keeps the order of the sorted edges, so row slots equal edge indices.
+        std::vector<char> state(n, 0);
+        std::vector<char> reversed(edges.size(), 0);
+
+        std::vector<std::pair<std::size_t, std::size_t>> stack;
+
+        for (std::size_t root = 0; root < n; ++root) {
+            if (state[root] != 0)
+                continue;
+
+            state[root] = 1;
+            stack.emplace_back(root, out.first[root]);
+
+            while (!stack.empty()) {
+                std::size_t const v = stack.back().first;
+                std::size_t const slot = stack.back().second;
+
+                if (slot == out.first[v + 1]) {
+                    state[v] = 2;
+                    stack.pop_back();
+                    continue;
+                }
+
+                ++stack.back().second;
+
+                std::size_t const w = out.targets[slot];
+
+                if (state[w] == 1) {
+                    reversed[slot] = 1;
+                } else if (state[w] == 0) {
+                    state[w] = 1;
+                    stack.emplace_back(w, out.first[w]);
+                }
+            }
+        }
+
+        for (std::size_t e = 0; e < edges.size(); ++e) {
+            if (reversed[e])
+                std::swap(edges[e].first, edges[e].second);
+        }
+
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    }
+
+    // Layers by the longest path from the sources.
+    std::vector<std::size_t> layer(n, 0);
+    std::size_t layerCount = 1;
+
+    {
+        Adjacency const out(n, edges);
+
+        std::vector<std::size_t> pending(n, 0);
+
+        for (auto const &edge : edges) {
+            ++pending[edge.second];
+        }
+
+        std::vector<std::size_t> order;
+        order.reserve(n);
+
+        for (std::size_t v = 0; v < n; ++v) {
+            if (pending[v] == 0)
+                order.push_back(v);
+        }
+
+        for (std::size_t i = 0; i < order.size(); ++i) {
+            std::size_t const v = order[i];
+
+            for (std::size_t k = out.first[v]; k < out.first[v + 1]; ++k) {
+                std::size_t const w = out.targets[k];
+
+                layer[w] = std::max(layer[w], layer[v] + 1);
+
+                if (--pending[w] == 0)
+                    order.push_back(w);
+            }
+        }
+
+        // Sources move right in front of their nearest successor.
+        std::vector<char> hasPredecessor(n, 0);
+
+        for (auto const &edge : edges) {
+            hasPredecessor[edge.second] = 1;
+        }
+
+        for (std::size_t v = 0; v < n; ++v) {
+            if (hasPredecessor[v] || out.degree(v) == 0)
+                continue;
+
+            std::size_t nearest = std::numeric_limits<std::size_t>::max();
+
+            for (std::size_t k = out.first[v]; k < out.first[v + 1]; ++k) {
+                nearest = std::min(nearest, layer[out.targets[k]]);
+            }
+
+            layer[v] = nearest - 1;
+        }
+
+        for (std::size_t v = 0; v < n; ++v) {
+            layerCount = std::max(layerCount, layer[v] + 1);
+        }
+    }
+
+    // Vertices: the nodes followed by the dummies of the connections spanning several layers.
+    std::vector<std::pair<std::size_t, std::size_t>> segments;
+    segments.reserve(edges.size());
+
+    for (auto const &edge : edges) {
+        std::size_t previous = edge.first;
+
+        for (std::size_t l = layer[edge.first] + 1; l < layer[edge.second]; ++l) {
+            std::size_t const dummy = layer.size();
+
+            layer.push_back(l);
+            component.push_back(component[edge.first]);
+            depth.push_back(0);
+            extent.push_back(0);
+            key.push_back(key[edge.first]);
+
+            segments.emplace_back(previous, dummy);
+            previous = dummy;
+        }
+
+        segments.emplace_back(previous, edge.second);
+    }
+
+    std::size_t const m = layer.size();
+
+    WorkStealingExecutor *pool = m >= ParallelThreshold ? executor() : nullptr;
+
+    std::vector<std::pair<std::size_t, std::size_t>> upward;
+    upward.reserve(segments.size());
+
+    for (auto const &segment : segments) {
+        upward.emplace_back(segment.second, segment.first);
+    }
+
+    Adjacency const down(m, segments);
+    Adjacency const up(m, upward);
+
+    std::vector<std::vector<std::size_t>> layers(layerCount);
+
+    for (std::size_t v = 0; v < m; ++v) {
+        layers[layer[v]].push_back(v);
+    }
+
+    // Layers handled per task, so that a task gets about `Grain` vertices.
+    std::size_t const layerGrain = std::max<std::size_t>(1, Grain * layerCount / m);
+
+    // Components stay contiguous in every layer; the previous order starts the sweeps.
+    parallelFor(pool, layerCount, layerGrain, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t l = begin; l < end; ++l) {
+            std::sort(layers[l].begin(), layers[l].end(), [&](std::size_t a, std::size_t b) {
+                if (component[a] != component[b])
+                    return component[a] < component[b];
+
+                if (key[a] != key[b])
+                    return key[a] < key[b];
+
+                return a < b;
+            });
+        }
+    });
+
+    std::vector<double> position(m);
+
+    for (auto const &vertices : layers) {
+        for (std::size_t i = 0; i < vertices.size(); ++i) {
+            position[vertices[i]] = static_cast<double>(i);
+        }
+    }
+
+    // Crossing reduction by barycenters of the neighbours in the layer swept from.
+    std::vector<double> weight(m);
+
+    auto reorder = [&](std::vector<std::size_t> &vertices, Adjacency const &neighbours) {
+        parallelFor(pool, vertices.size(), Grain, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                std::size_t const v = vertices[i];
+
+                std::size_t const degree = neighbours.degree(v);
+
+                if (degree == 0) {
+                    weight[v] = position[v];
+                    continue;
+                }
+
+                double sum = 0;
+
+                for (std::size_t k = neighbours.first[v]; k < neighbours.first[v + 1]; ++k) {
+                    sum += position[neighbours.targets[k]];
+                }
+
+                weight[v] = sum / degree;
+            }
+        });
+
+        std::stable_sort(vertices.begin(), vertices.end(), [&](std::size_t a, std::size_t b) {
+            if (component[a] != component[b])
+                return component[a] < component[b];
+
+            return weight[a] < weight[b];
+        });
+
+        for (std::size_t i = 0; i < vertices.size(); ++i) {
+            position[vertices[i]] = static_cast<double>(i);
+        }
+    };
+
+    for (unsigned int sweep = 0; sweep < _options.sweeps; ++sweep) {
+        for (std::size_t l = 1; l < layerCount; ++l) {
+            reorder(layers[l], up);
+        }
+
+        for (std::size_t l = layerCount - 1; l-- > 0;) {
+            reorder(layers[l], down);
+        }
+    }
+
+    // Offsets of the layers from the thickest node of each.
+    std::vector<double> layerOffset(layerCount + 1, 0);
+
+    parallelFor(pool, layerCount, layerGrain, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t l = begin; l < end; ++l) {
+            double thickness = 0;
+
+            for (std::size_t v : layers[l]) {
+                thickness = std::max(thickness, depth[v]);
+            }
+
+            layerOffset[l + 1] = thickness + _options.layerSpacing;
+        }
+    });
+
+    std::partial_sum(layerOffset.begin(), layerOffset.end(), layerOffset.begin());
+
+    // Coordinates across the layers, per component, packed first.
+    std::vector<std::vector<Block>> blocks(layerCount);
+
+    std::vector<double> &coordinate = position;
+
+    parallelFor(pool, layerCount, layerGrain, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t l = begin; l < end; ++l) {
+            std::vector<std::size_t> const &vertices = layers[l];
+
+            double cursor = 0;
+
+            for (std::size_t i = 0; i < vertices.size(); ++i) {
+                std::size_t const v = vertices[i];
+
+                if (i == 0 || component[v] != component[vertices[i - 1]]) {
+                    blocks[l].push_back(Block{i, i});
+                    cursor = 0;
+                }
+
+                blocks[l].back().end = i + 1;
+
+                coordinate[v] = cursor;
+                cursor += extent[v] + _options.nodeSpacing;
+            }
+        }
+    });
+
+    // Balancing: every vertex is pulled to the mean center of its neighbours in
+    // the layer swept from. A pass from either side keeps the gaps; their mean
+    // keeps them as well.
+    std::vector<double> low(m);
+    std::vector<double> high(m);
+
+    double const spacing = _options.nodeSpacing;
+
+    auto balance = [&](std::size_t const l, Adjacency const &neighbours) {
+        std::vector<std::size_t> const &vertices = layers[l];
+
+        parallelFor(pool, vertices.size(), Grain, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                std::size_t const v = vertices[i];
+
+                std::size_t const degree = neighbours.degree(v);
+
+                if (degree == 0) {
+                    weight[v] = coordinate[v];
+                    continue;
+                }
+
+                double sum = 0;
+
+                for (std::size_t k = neighbours.first[v]; k < neighbours.first[v + 1]; ++k) {
+                    std::size_t const w = neighbours.targets[k];
+
+                    sum += coordinate[w] + extent[w] / 2;
+                }
+
+                weight[v] = sum / degree - extent[v] / 2;
+            }
+        });
+
+        std::vector<Block> const &runs = blocks[l];
+
+        std::size_t const blockGrain = std::max<std::size_t>(
+            1, Grain * runs.size() / std::max<std::size_t>(vertices.size(), 1));
+
+        parallelFor(pool, runs.size(), blockGrain, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t b = begin; b < end; ++b) {
+                Block const &block = runs[b];
+
+                double cursor = std::numeric_limits<double>::lowest();
+
+                for (std::size_t i = block.begin; i < block.end; ++i) {
+                    std::size_t const v = vertices[i];
+
+                    low[v] = std::max(weight[v], cursor);
+                    cursor = low[v] + extent[v] + spacing;
+                }
+
+                cursor = std::numeric_limits<double>::max();
+
+                for (std::size_t i = block.end; i-- > block.begin;) {
+                    std::size_t const v = vertices[i];
+
+                    high[v] = std::min(weight[v], cursor - extent[v]);
+                    cursor = high[v] - spacing;
+                }
+
+                for (std::size_t i = block.begin; i < block.end; ++i) {
+                    std::size_t const v = vertices[i];
+
+                    coordinate[v] = (low[v] + high[v]) / 2;
+                }
+            }
+        });
+    };
+
+    for (unsigned int sweep = 0; sweep < _options.sweeps; ++sweep) {
+        for (std::size_t l = 1; l < layerCount; ++l) {
+            balance(l, up);
+        }
+
+        for (std::size_t l = layerCount - 1; l-- > 0;) {
+            balance(l, down);
+        }
+    }
+
+    // Components side by side, in their previous order.
+    std::vector<double> componentLow(componentCount, std::numeric_limits<double>::max());
+    std::vector<double> componentHigh(componentCount, std::numeric_limits<double>::lowest());
+
+    for (std::size_t v = 0; v < m; ++v) {
+        std::size_t const c = component[v];
+
+        componentLow[c] = std::min(componentLow[c], coordinate[v]);
+        componentHigh[c] = std::max(componentHigh[c], coordinate[v] + extent[v]);
+    }
+
+    std::vector<double> componentOffset(componentCount, 0);
+
+    double offset = 0;
+
+    for (std::size_t c = 0; c < componentCount; ++c) {
+        componentOffset[c] = offset - componentLow[c];
+
+        offset += componentHigh[c] - componentLow[c] + _options.componentSpacing;
+    }
+
+    Positions positions;
+    positions.reserve(n);
+
+    for (std::size_t i = 0; i < n; ++i) {
+        double const along = layerOffset[layer[i]];
+        double const across = componentOffset[component[i]] + coordinate[i];
+
+        QPointF const shift = horizontal ? QPointF(along, across) : QPointF(across, along);
+
+        positions.emplace_back(nodes[i]->id, origin + shift);
+    }
+
+    return positions;
+}
+
+} // namespace QtNodes
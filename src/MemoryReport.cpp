@@ -0,0 +1,47 @@
+#include "MemoryReport.hpp"
+
+namespace QtNodes {
+
+void MemoryReport::add(QString const &name, std::size_t const count, std::size_t const bytes)
+{
+    entries.push_back(Entry{name, count, bytes});
+}
+
+void MemoryReport::append(QString const &prefix, MemoryReport const &other)
+{
+    for (Entry const &entry : other.entries) {
+        add(prefix + '/' + entry.name, entry.count, entry.bytes);
+    }
+}
+
+std::size_t MemoryReport::totalBytes() const
+{
+    std::size_t total = 0;
+
+    for (Entry const &entry : entries) {
+        total += entry.bytes;
+    }
+
+    return total;
+}
+
+QJsonObject MemoryReport::toJson() const
+{
+    QJsonObject entriesJson;
+
+    for (Entry const &entry : entries) {
+        QJsonObject entryJson;
+        entryJson["count"] = static_cast<double>(entry.count);
+        entryJson["bytes"] = static_cast<double>(entry.bytes);
+
+        entriesJson[entry.name] = entryJson;
+    }
+
+    QJsonObject json;
+    json["total"] = static_cast<double>(totalBytes());
+    json["entries"] = entriesJson;
+
+    return json;
+}
+
+} // namespace QtNodes
@@ -0,0 +1,138 @@
+#include "ModelSearchIndex.hpp"
+
+#include "NodeDelegateModelRegistry.hpp"
+
+#include <algorithm>
+
+namespace QtNodes {
+
+namespace {
+
+/// @returns `true` if `name[i]` starts a word, `name[0]` excluded.
+bool startsWord(QString const &name, int const i)
+{
+    QChar const previous = name[i - 1];
+    QChar const current = name[i];
+
+    if (!current.isLetterOrNumber())
+        return false;
+
+    if (!previous.isLetterOrNumber())
+        return true;
+
+    if (current.isUpper() && previous.isLower())
+        return true;
+
+    return current.isDigit() != previous.isDigit();
+}
+
+bool isSubsequence(QString const &needle, QString const &haystack)
+{
+    int n = 0;
+
+    for (int h = 0; h < haystack.size() && n < needle.size(); ++h) {
+        if (haystack[h] == needle[n])
+            ++n;
+    }
+
+    return n == needle.size();
+}
+
+} // namespace
+
+ModelSearchIndex::ModelSearchIndex(NodeDelegateModelRegistry const &registry)
+{
+    for (auto const &entry : registry.registeredModelDescriptors()) {
+        auto const &descriptor = entry.second;
+        _entries.push_back(Entry{descriptor.name, descriptor.caption, descriptor.category});
+    }
+
+    std::sort(_entries.begin(), _entries.end(), [](Entry const &l, Entry const &r) {
+        return l.category != r.category ? l.category < r.category : l.name < r.name;
+    });
+
+    _keys.reserve(_entries.size());
+    _byKey.reserve(_entries.size());
+
+    for (std::size_t i = 0; i < _entries.size(); ++i) {
+        QString const &name = _entries[i].name;
+        QString const key = name.toCaseFolded();
+
+        _keys.push_back(key);
+        _byKey.push_back(i);
+
+        for (int c = 1; c < name.size(); ++c) {
+            if (startsWord(name, c))
+                _words.emplace_back(key.mid(c), i);
+        }
+    }
+
+    std::sort(_byKey.begin(), _byKey.end(), [this](std::size_t l, std::size_t r) {
+        return _keys[l] < _keys[r];
+    });
+
+    std::sort(_words.begin(), _words.end());
+}
+
+std::vector<std::size_t> ModelSearchIndex::search(QString const &text,
+                                                  std::size_t const limit) const
+{
+    std::vector<std::size_t> result;
+
+    QString const needle = text.trimmed().toCaseFolded();
+
+    if (needle.isEmpty()) {
+        for (std::size_t i = 0; i < _entries.size() && result.size() < limit; ++i) {
+            result.push_back(i);
+        }
+        return result;
+    }
+
+    std::vector<char> taken(_entries.size(), 0);
+
+    auto take = [&](std::size_t const i) {
+        if (taken[i] || result.size() >= limit)
+            return;
+
+        taken[i] = 1;
+        result.push_back(i);
+    };
+
+    // 1. Name prefixes.
+    auto key = std::lower_bound(_byKey.begin(),
+                                _byKey.end(),
+                                needle,
+                                [this](std::size_t i, QString const &value) {
+                                    return _keys[i] < value;
+                                });
+
+    for (; key != _byKey.end() && _keys[*key].startsWith(needle); ++key) {
+        take(*key);
+    }
+
+    // 2. Word prefixes.
+    auto word = std::lower_bound(_words.begin(),
+                                 _words.end(),
+                                 needle,
+                                 [](std::pair<QString, std::size_t> const &w,
+                                    QString const &value) { return w.first < value; });
+
+    for (; word != _words.end() && word->first.startsWith(needle); ++word) {
+        take(word->second);
+    }
+
+    // 3. Substrings, 4. subsequences.
+    for (std::size_t i = 0; i < _keys.size() && result.size() < limit; ++i) {
+        if (_keys[i].contains(needle))
+            take(i);
+    }
+
+    for (std::size_t i = 0; i < _keys.size() && result.size() < limit; ++i) {
+        if (isSubsequence(needle, _keys[i]))
+            take(i);
+    }
+
+    return result;
+}
+
+} // namespace QtNodes
@@ -106,11 +106,14 @@ bool NodeConnectionInteraction::disconnect(PortType portToDisconnect) const
     draftConnection->setEndPoint(portToDisconnect, looseEndPos);
 
     // Repaint connection points.
+    // A virtualized scene may have no object for the far node.
     NodeId connectedNodeId = getNodeId(oppositePort(portToDisconnect), connectionId);
-    _scene.nodeGraphicsObject(connectedNodeId)->update();
+    if (auto ngo = _scene.nodeGraphicsObject(connectedNodeId))
+        ngo->update();
 
     NodeId disconnectedNodeId = getNodeId(portToDisconnect, connectionId);
-    _scene.nodeGraphicsObject(disconnectedNodeId)->update();
+    if (auto ngo = _scene.nodeGraphicsObject(disconnectedNodeId))
+        ngo->update();
 
     return true;
 }
@@ -0,0 +1,76 @@
+#include "NodeDataCodec.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace QtNodes {
+
+void NodeDataCodec::registerType(QString const &typeId, Encoder encoder, Decoder decoder)
+{
+    auto &codec = instance();
+
+    std::lock_guard<std::mutex> lock(codec._mutex);
+
+    codec._functions[typeId] = Functions{std::move(encoder), std::move(decoder)};
+}
+
+bool NodeDataCodec::contains(QString const &typeId)
+{
+    auto &codec = instance();
+
+    std::lock_guard<std::mutex> lock(codec._mutex);
+
+    return codec._functions.count(typeId) > 0;
+}
+
+QByteArray NodeDataCodec::encode(NodeData const &data)
+{
+    QString const typeId = data.type().id;
+
+    Encoder encoder;
+
+    {
+        auto &codec = instance();
+
+        std::lock_guard<std::mutex> lock(codec._mutex);
+
+        auto it = codec._functions.find(typeId);
+        if (it == codec._functions.end())
+            throw std::logic_error("No codec registered for the data type "
+                                   + typeId.toStdString());
+
+        encoder = it->second.encoder;
+    }
+
+    return encoder(data);
+}
+
+std::shared_ptr<NodeData> NodeDataCodec::decode(QString const &typeId, QByteArray const &bytes)
+{
+    Decoder decoder;
+
+    {
+        auto &codec = instance();
+
+        std::lock_guard<std::mutex> lock(codec._mutex);
+
+        auto it = codec._functions.find(typeId);
+        if (it == codec._functions.end())
+            throw std::logic_error("No codec registered for the data type "
+                                   + typeId.toStdString());
+
+        decoder = it->second.decoder;
+    }
+
+    return decoder(bytes);
+}
+
+NodeDataCodec &NodeDataCodec::instance()
+{
+    static NodeDataCodec codec;
+
+    return codec;
+}
+
+} // namespace QtNodes
@@ -0,0 +1,125 @@
+#include "NodeDataTypeRegistry.hpp"
+
+#include "NodeData.hpp"
+
+#include <random>
+#include <stdexcept>
+
+namespace QtNodes {
+
+NodeDataTypeId NodeDataType::typeId() const
+{
+    return NodeDataTypeRegistry::intern(id);
+}
+
+constexpr std::size_t NodeDataTypeRegistry::BlockBits;
+constexpr std::size_t NodeDataTypeRegistry::BlockSize;
+constexpr std::size_t NodeDataTypeRegistry::MaxBlocks;
+
+NodeDataTypeRegistry::NodeDataTypeRegistry()
+    : _size(0)
+{
+    append(QString());
+}
+
+NodeDataTypeId NodeDataTypeRegistry::intern(QString const &typeId)
+{
+    // Ids never change, a thread asks the shared table once per type.
+    thread_local std::unordered_map<QString, NodeDataTypeId> known;
+
+    auto cached = known.find(typeId);
+
+    if (cached != known.end())
+        return cached->second;
+
+    auto &registry = instance();
+
+    NodeDataTypeId id;
+
+    {
+        std::lock_guard<std::mutex> lock(registry._mutex);
+
+        auto it = registry._ids.find(typeId);
+
+        id = it != registry._ids.end() ? it->second : registry.append(typeId);
+    }
+
+    known.emplace(typeId, id);
+
+    return id;
+}
+
+QString NodeDataTypeRegistry::typeIdString(NodeDataTypeId const id)
+{
+    auto &registry = instance();
+
+    if (id >= registry._size.load(std::memory_order_acquire))
+        return QString();
+
+    return registry._blocks[id >> BlockBits][id & (BlockSize - 1)].typeId;
+}
+
+QColor NodeDataTypeRegistry::color(NodeDataTypeId const id)
+{
+    auto &registry = instance();
+
+    std::size_t const index = id < registry._size.load(std::memory_order_acquire)
+                                  ? id
+                                  : InvalidNodeDataTypeId;
+
+    return registry._blocks[index >> BlockBits][index & (BlockSize - 1)].color;
+}
+
+std::size_t NodeDataTypeRegistry::size()
+{
+    return instance()._size.load(std::memory_order_acquire);
+}
+
+NodeDataTypeId NodeDataTypeRegistry::append(QString const &typeId)
+{
+    std::size_t const index = _size.load(std::memory_order_relaxed);
+    std::size_t const block = index >> BlockBits;
+
+    if (block >= MaxBlocks)
+        throw std::runtime_error("Too many node data types");
+
+    if (!_blocks[block])
+        _blocks[block].reset(new Entry[BlockSize]);
+
+    Entry &entry = _blocks[block][index & (BlockSize - 1)];
+    entry.typeId = typeId;
+    entry.color = computeColor(typeId);
+
+    auto const id = static_cast<NodeDataTypeId>(index);
+
+    _ids[typeId] = id;
+
+    // Publishes the entry to the lock-free readers.
+    _size.store(index + 1, std::memory_order_release);
+
+    return id;
+}
+
+NodeDataTypeRegistry &NodeDataTypeRegistry::instance()
+{
+    static NodeDataTypeRegistry registry;
+
+    return registry;
+}
+
+QColor NodeDataTypeRegistry::computeColor(QString const &typeId)
+{
+    std::size_t hash = qHash(typeId);
+
+    std::size_t const hue_range = 0xFF;
+
+    std::mt19937 gen(static_cast<unsigned int>(hash));
+    std::uniform_int_distribution<int> distrib(0, hue_range);
+
+    int hue = distrib(gen);
+    int sat = 120 + hash % 129;
+
+    return QColor::fromHsl(hue, sat, 160);
+}
+
+} // namespace QtNodes
@@ -4,8 +4,34 @@
 
 namespace QtNodes {
 
+NodeDelegateProfiler::Scope::Scope(NodeDelegateModel const *delegate,
+                                   Call const call,
+                                   PortIndex const portIndex)
+    : _delegate(delegate)
+    , _profiler(delegate ? delegate->profiler() : nullptr)
+    , _call(call)
+    , _portIndex(portIndex)
+{
+    if (_profiler)
+        _start = std::chrono::steady_clock::now();
+}
+
+NodeDelegateProfiler::Scope::~Scope()
+{
+    if (!_profiler)
+        return;
+
+    auto const elapsed = std::chrono::steady_clock::now() - _start;
+
+    _profiler->record(_delegate->name(),
+                      _call,
+                      _portIndex,
+                      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
 NodeDelegateModel::NodeDelegateModel()
-    : _nodeStyle(StyleCollection::nodeStyle())
+    : _portTable(nullptr)
+    , _profiler(nullptr)
 {
     // Derived classes can initialize specific style here
 }
@@ -43,12 +69,22 @@ ConnectionPolicy NodeDelegateModel::portConnectionPolicy(PortType portType, Port
 
 NodeStyle const &NodeDelegateModel::nodeStyle() const
 {
-    return _nodeStyle;
+    return _nodeStyle ? *_nodeStyle : StyleCollection::nodeStyle();
+}
+
+std::shared_ptr<NodeStyle const> NodeDelegateModel::sharedNodeStyle() const
+{
+    return _nodeStyle ? _nodeStyle : StyleCollection::sharedNodeStyle();
 }
 
 void NodeDelegateModel::setNodeStyle(NodeStyle const &style)
 {
-    _nodeStyle = style;
+    _nodeStyle = std::make_shared<NodeStyle const>(style);
+}
+
+void NodeDelegateModel::setSharedNodeStyle(std::shared_ptr<NodeStyle const> style)
+{
+    _nodeStyle = std::move(style);
 }
 
 } // namespace QtNodes
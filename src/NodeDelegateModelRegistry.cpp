@@ -1,11 +1,108 @@
 #include "NodeDelegateModelRegistry.hpp"
 
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
 #include <QtCore/QFile>
-#include <QtWidgets/QMessageBox>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QLibrary>
+
+#include <mutex>
 
 using QtNodes::NodeDataType;
 using QtNodes::NodeDelegateModel;
+using QtNodes::NodeDelegateModelDescriptor;
 using QtNodes::NodeDelegateModelRegistry;
+using QtNodes::PortIndex;
+using QtNodes::PortType;
+
+/// A plugin library, opened when the first of its models is created.
+struct NodeDelegateModelRegistry::PluginLibrary
+{
+    explicit PluginLibrary(QString const &fileName)
+        : library(fileName)
+    {}
+
+    /// Resolves the factory once, a failure included; safe from concurrent `create()` calls.
+    PluginModelFactory factory()
+    {
+        std::call_once(resolved, [this]() {
+            // Loads the library as needed.
+            resolvedFactory = reinterpret_cast<PluginModelFactory>(
+                library.resolve(PluginFactorySymbol));
+
+            if (!resolvedFactory)
+                qWarning() << "Cannot load node plugin" << library.fileName()
+                           << library.errorString();
+        });
+
+        return resolvedFactory;
+    }
+
+    QLibrary library;
+
+    std::once_flag resolved;
+
+    PluginModelFactory resolvedFactory = nullptr;
+};
+
+namespace {
+
+std::vector<NodeDataType> readPorts(QJsonArray const &portsJson)
+{
+    std::vector<NodeDataType> ports;
+    ports.reserve(static_cast<std::size_t>(portsJson.size()));
+
+    for (QJsonValue const portJson : portsJson) {
+        QJsonObject const port = portJson.toObject();
+
+        QString const id = port["id"].toString();
+
+        ports.push_back(NodeDataType{id, port["name"].toString(id)});
+    }
+
+    return ports;
+}
+
+} // namespace
+
+void NodeDelegateModelRegistry::registerModel(NodeDelegateModelDescriptor descriptor,
+                                              RegistryItemCreator creator)
+{
+    QString const name = descriptor.name;
+
+    if (_registeredItemCreators.count(name))
+        return;
+
+    if (descriptor.category.isEmpty())
+        descriptor.category = QStringLiteral("Nodes");
+
+    _registeredItemCreators[name] = std::move(creator);
+    _categories.insert(descriptor.category);
+    _registeredModelsCategory[name] = descriptor.category;
+    _registeredDescriptors[name] = std::move(descriptor);
+
+    ++_revision;
+}
+
+void NodeDelegateModelRegistry::registerTypeConverter(NodeDataType const &from,
+                                                      NodeDataType const &to,
+                                                      TypeConverter converter)
+{
+    _registeredTypeConverters[typeConverterKey(from.typeId(), to.typeId())] = std::move(converter);
+
+    ++_revision;
+}
+
+NodeDelegateModelRegistry::TypeConverter NodeDelegateModelRegistry::getTypeConverter(
+    NodeDataType const &from, NodeDataType const &to) const
+{
+    TypeConverter const *converter = typeConverter(from.typeId(), to.typeId());
+
+    return converter ? *converter : TypeConverter();
+}
 
 std::unique_ptr<NodeDelegateModel> NodeDelegateModelRegistry::create(QString const &modelName)
 {
@@ -18,6 +115,78 @@ std::unique_ptr<NodeDelegateModel> NodeDelegateModelRegistry::create(QString con
     return nullptr;
 }
 
+void NodeDelegateModelRegistry::registerPluginModel(NodeDelegateModelDescriptor descriptor,
+                                                    QString const &libraryPath)
+{
+    QString const fileName = QFileInfo(libraryPath).absoluteFilePath();
+
+    std::shared_ptr<PluginLibrary> &library = _pluginLibraries[fileName];
+
+    if (!library)
+        library = std::make_shared<PluginLibrary>(fileName);
+
+    QByteArray const modelName = descriptor.name.toUtf8();
+
+    registerModel(std::move(descriptor), [library, modelName]() -> RegistryItemPtr {
+        PluginModelFactory const factory = library->factory();
+
+        if (!factory)
+            return nullptr;
+
+        return RegistryItemPtr(factory(modelName.constData()));
+    });
+}
+
+std::size_t NodeDelegateModelRegistry::registerPluginManifest(QString const &fileName)
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly))
+        return 0;
+
+    QJsonObject const manifest = QJsonDocument::fromJson(file.readAll()).object();
+
+    QString const libraryName = manifest["library"].toString();
+
+    if (libraryName.isEmpty())
+        return 0;
+
+    QString const libraryPath = QFileInfo(fileName).absoluteDir().absoluteFilePath(libraryName);
+
+    std::size_t registered = 0;
+
+    for (QJsonValue const modelJson : manifest["models"].toArray()) {
+        QJsonObject const model = modelJson.toObject();
+
+        NodeDelegateModelDescriptor descriptor;
+        descriptor.name = model["name"].toString();
+        descriptor.caption = model["caption"].toString(descriptor.name);
+        descriptor.category = model["category"].toString();
+        descriptor.inPorts = readPorts(model["in"].toArray());
+        descriptor.outPorts = readPorts(model["out"].toArray());
+
+        if (descriptor.name.isEmpty() || _registeredItemCreators.count(descriptor.name))
+            continue;
+
+        registerPluginModel(std::move(descriptor), libraryPath);
+
+        ++registered;
+    }
+
+    return registered;
+}
+
+void NodeDelegateModelRegistry::registerPrototype(std::unique_ptr<NodeDelegateModel> prototype,
+                                                  QString const &category)
+{
+    NodeDelegateModelDescriptor descriptor = describe(*prototype);
+    descriptor.category = category;
+
+    std::shared_ptr<NodeDelegateModel const> const shared(std::move(prototype));
+
+    registerModel(std::move(descriptor), [shared]() { return shared->clone(); });
+}
+
 NodeDelegateModelRegistry::RegisteredModelCreatorsMap const &
 NodeDelegateModelRegistry::registeredModelCreators() const
 {
@@ -34,3 +203,37 @@ NodeDelegateModelRegistry::CategoriesSet const &NodeDelegateModelRegistry::categ
 {
     return _categories;
 }
+
+NodeDelegateModelRegistry::RegisteredModelDescriptorsMap const &
+NodeDelegateModelRegistry::registeredModelDescriptors() const
+{
+    return _registeredDescriptors;
+}
+
+NodeDelegateModelDescriptor const *NodeDelegateModelRegistry::descriptor(
+    QString const &modelName) const
+{
+    auto it = _registeredDescriptors.find(modelName);
+
+    if (it == _registeredDescriptors.end())
+        return nullptr;
+
+    return &it->second;
+}
+
+NodeDelegateModelDescriptor NodeDelegateModelRegistry::describe(NodeDelegateModel const &model)
+{
+    NodeDelegateModelDescriptor descriptor;
+    descriptor.name = model.name();
+    descriptor.caption = model.caption();
+
+    for (PortIndex i = 0; i < model.nPorts(PortType::In); ++i) {
+        descriptor.inPorts.push_back(model.dataType(PortType::In, i));
+    }
+
+    for (PortIndex i = 0; i < model.nPorts(PortType::Out); ++i) {
+        descriptor.outPorts.push_back(model.dataType(PortType::Out, i));
+    }
+
+    return descriptor;
+}
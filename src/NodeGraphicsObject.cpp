@@ -1,7 +1,9 @@
 #include "NodeGraphicsObject.hpp"
 
+#include <cmath>
 #include <cstdlib>
 #include <iostream>
+#include <typeinfo>
 
 #include <QtWidgets/QGraphicsEffect>
 #include <QtWidgets/QtWidgets>
@@ -13,6 +15,8 @@
 #include "ConnectionGraphicsObject.hpp"
 #include "ConnectionIdUtils.hpp"
 #include "NodeConnectionInteraction.hpp"
+#include "PaintStatistics.hpp"
+#include "SharedSceneCache.hpp"
 #include "StyleCollection.hpp"
 #include "UndoCommands.hpp"
 
@@ -23,6 +27,15 @@ NodeGraphicsObject::NodeGraphicsObject(BasicGraphicsScene &scene, NodeId nodeId)
     , _graphModel(scene.graphModel())
     , _nodeState(*this)
     , _proxyWidget(nullptr)
+    , _widgetDeferred(false)
+    , _resizeCursor(false)
+    , _nodeStyleRevision(0)
+    , _generation(0)
+{
+    initialize(scene);
+}
+
+void NodeGraphicsObject::initialize(BasicGraphicsScene &scene)
 {
     scene.addItem(this);
 
@@ -33,37 +46,33 @@ NodeGraphicsObject::NodeGraphicsObject(BasicGraphicsScene &scene, NodeId nodeId)
 
     //setCacheMode(QGraphicsItem::DeviceCoordinateCache); при приближении сцены, элементы обрезаются
 
-    QJsonObject nodeStyleJson = _graphModel.nodeData(_nodeId, NodeRole::Style).toJsonObject();
+    updateShadow();
 
-    NodeStyle nodeStyle(nodeStyleJson);
+    setOpacity(nodeStyle().Opacity);
 
-    {
-        auto effect = new QGraphicsDropShadowEffect;
-        effect->setOffset(4, 4);
-        effect->setBlurRadius(20);
-        effect->setColor(nodeStyle.ShadowColor);
+    setAcceptHoverEvents(true);
 
-        setGraphicsEffect(effect);
-    }
+    setZValue(0);
 
-    setOpacity(nodeStyle.Opacity);
+    _nodeState.updateConnectionCounts();
 
-    setAcceptHoverEvents(true);
+    // Nodes never shown in a view never build their widget.
+    _widgetDeferred = _graphModel.nodeData<QSize>(_nodeId, NodeRole::WidgetSizeHint).isValid();
 
-    setZValue(0);
+    AbstractNodeGeometry &geometry = nodeScene()->nodeGeometry();
 
-    embedQWidget();
+    // A size saved with the scene spares measuring the caption and the port labels.
+    bool const restored = geometry.restoreSavedSize(_nodeId);
 
-    nodeScene()->nodeGeometry().recomputeSize(_nodeId);
+    if (!_widgetDeferred)
+        embedQWidget(restored);
+
+    if (!restored)
+        geometry.recomputeSize(_nodeId);
 
     QPointF const pos = _graphModel.nodeData<QPointF>(_nodeId, NodeRole::Position);
 
     setPos(pos);
-
-    connect(&_graphModel, &AbstractGraphModel::nodeFlagsUpdated, [this](NodeId const nodeId) {
-        if (_nodeId == nodeId)
-            setLockedState();
-    });
 }
 
 AbstractGraphModel &NodeGraphicsObject::graphModel() const
@@ -71,20 +80,161 @@ AbstractGraphModel &NodeGraphicsObject::graphModel() const
     return _graphModel;
 }
 
+NodeGraphicsObject::~NodeGraphicsObject()
+{
+    // Items leaving the scene do not report their deselection.
+    if (isSelected()) {
+        if (auto scene = nodeScene())
+            scene->updateNodeSelection(_nodeId, false);
+    }
+}
+
+void NodeGraphicsObject::recycle()
+{
+    if (auto scene = nodeScene()) {
+        if (isSelected())
+            scene->updateNodeSelection(_nodeId, false);
+
+        scene->removeItem(this);
+    }
+
+    setSelected(false);
+
+    // The proxy takes the widget along, as when the node is destroyed.
+    delete _proxyWidget;
+    _proxyWidget = nullptr;
+
+    _inactiveWidget.clear();
+    _widgetSnapshot = QPixmap();
+    _widgetDeferred = false;
+
+    _nodeStyle.reset();
+    _nodeStyleRevision = 0;
+
+    _renderCache = QPixmap();
+    _renderCacheKey = NodeRenderKey();
+
+    _nodeState.reset();
+
+    disconnect();
+    unsetCursor();
+    _resizeCursor = false;
+
+    ++_generation;
+    _nodeId = InvalidNodeId;
+}
+
+void NodeGraphicsObject::reuse(BasicGraphicsScene &scene, NodeId const nodeId)
+{
+    _nodeId = nodeId;
+
+    initialize(scene);
+}
+
 BasicGraphicsScene *NodeGraphicsObject::nodeScene() const
 {
     return dynamic_cast<BasicGraphicsScene *>(scene());
 }
 
+NodeStyle const &NodeGraphicsObject::nodeStyle() const
+{
+    BasicGraphicsScene const *scene = nodeScene();
+
+    StyleContext const &styles = scene ? scene->styleContext() : StyleCollection::current();
+
+    unsigned int const revision = styles.revision();
+
+    if (!_nodeStyle || _nodeStyleRevision != revision) {
+        _nodeStyleRevision = revision;
+
+        _nodeStyle = _graphModel.nodeData(_nodeId, NodeRole::StylePtr)
+                         .value<std::shared_ptr<NodeStyle const>>();
+
+        // The default style gives way to the one of the scene.
+        if (_nodeStyle && _nodeStyle == StyleCollection::sharedNodeStyle())
+            _nodeStyle = styles.sharedNodeStyle();
+
+        // The model does not provide a shared style, parse the JSON once.
+        if (!_nodeStyle) {
+            QJsonDocument json = QJsonDocument::fromVariant(
+                _graphModel.nodeData(_nodeId, NodeRole::Style));
+
+            _nodeStyle = std::make_shared<NodeStyle const>(json.object());
+        }
+    }
+
+    return *_nodeStyle;
+}
+
+void NodeGraphicsObject::updateNodeStyle()
+{
+    _nodeStyle.reset();
+
+    invalidateRenderCache();
+}
+
+void NodeGraphicsObject::invalidateRenderCache()
+{
+    // Other scenes invalidating the node for the same change find nothing
+    // left to drop, none of them paints before the event loop runs again.
+    if (BasicGraphicsScene *scene = nodeScene()) {
+        if (SharedSceneCache *shared = scene->sharedCache().get())
+            shared->invalidateNode(_nodeId);
+    }
+
+    _renderCache = QPixmap();
+
+    // The widget may show new data as well.
+    _widgetSnapshot = QPixmap();
+}
+
+std::size_t NodeGraphicsObject::renderCacheBytes() const
+{
+    std::size_t bytes = 0;
+
+    for (QPixmap const *pixmap : {&_renderCache, &_widgetSnapshot}) {
+        if (!pixmap->isNull()) {
+            bytes += static_cast<std::size_t>(pixmap->width()) * pixmap->height()
+                     * pixmap->depth() / 8;
+        }
+    }
+
+    return bytes;
+}
+
+void NodeGraphicsObject::updateShadow()
+{
+    if (nodeScene()->nodeShadowMode() != BasicGraphicsScene::NodeShadowMode::Effect) {
+        // Deletes the current effect.
+        setGraphicsEffect(nullptr);
+        return;
+    }
+
+    auto effect = qobject_cast<QGraphicsDropShadowEffect *>(graphicsEffect());
+
+    if (!effect) {
+        effect = new QGraphicsDropShadowEffect;
+        effect->setOffset(4, 4);
+        effect->setBlurRadius(20);
+
+        setGraphicsEffect(effect);
+    }
+
+    effect->setColor(nodeStyle().ShadowColor);
+}
+
 void NodeGraphicsObject::updateQWidgetEmbedPos()
 {
-    _proxyWidget->setPos(nodeScene()->nodeGeometry().widgetPosition(_nodeId));
+    if (_proxyWidget)
+        _proxyWidget->setPos(nodeScene()->nodeGeometry().widgetPosition(_nodeId));
 }
 
-void NodeGraphicsObject::embedQWidget()
+void NodeGraphicsObject::embedQWidget(bool const sizeRestored)
 {
     AbstractNodeGeometry &geometry = nodeScene()->nodeGeometry();
-    geometry.recomputeSize(_nodeId);
+
+    if (!sizeRestored)
+        geometry.recomputeSize(_nodeId);
 
     if (auto w = _graphModel.nodeData(_nodeId, NodeRole::Widget).value<QWidget *>()) {
         _proxyWidget = new QGraphicsProxyWidget(this);
@@ -110,9 +260,105 @@ void NodeGraphicsObject::embedQWidget()
 
         _proxyWidget->setOpacity(1.0);
         _proxyWidget->setFlag(QGraphicsItem::ItemIgnoresParentOpacity);
+
+        _proxyWidget->installSceneEventFilter(this);
+
+        // Embedded once, the widget keeps the size the proxy gave it.
+        if (!_inactiveWidget)
+            updateWidgetActivation();
     }
 }
 
+void NodeGraphicsObject::embedDeferredWidget()
+{
+    // The widget may be larger than its hint.
+    setGeometryChanged();
+
+    embedQWidget();
+
+    nodeScene()->updateSpatialIndex(*this);
+
+    moveConnections();
+
+    update();
+}
+
+void NodeGraphicsObject::updateWidgetActivation()
+{
+    bool const needed = !nodeScene()->widgetSnapshotsEnabled() || _nodeState.hovered()
+                        || hasFocus() || QApplication::activePopupWidget()
+                        || (_proxyWidget
+                            && (_proxyWidget->hasFocus()
+                                || scene()->mouseGrabberItem() == _proxyWidget));
+
+    if (!needed) {
+        deactivateWidget();
+        return;
+    }
+
+    if (!_inactiveWidget)
+        return;
+
+    QWidget *w = _inactiveWidget;
+
+    _inactiveWidget.clear();
+    _widgetSnapshot = QPixmap();
+
+    embedQWidget();
+
+    // Hidden while it was not embedded, shown again inside the proxy.
+    w->show();
+
+    update();
+}
+
+void NodeGraphicsObject::deactivateWidget()
+{
+    if (!_proxyWidget)
+        return;
+
+    QWidget *w = _proxyWidget->widget();
+
+    if (w) {
+        _widgetSnapshot = w->grab();
+
+        // Unembedded, a visible widget would become a window.
+        w->hide();
+
+        _proxyWidget->setWidget(nullptr);
+    }
+
+    delete _proxyWidget;
+    _proxyWidget = nullptr;
+
+    _inactiveWidget = w;
+
+    update();
+}
+
+void NodeGraphicsObject::scheduleWidgetActivation()
+{
+    if (!nodeScene()->widgetSnapshotsEnabled())
+        return;
+
+    // Not from within the events of the proxy about to be deleted.
+    QTimer::singleShot(0, this, [this, generation = _generation]() {
+        if (generation == _generation)
+            updateWidgetActivation();
+    });
+}
+
+void NodeGraphicsObject::paintWidgetSnapshot(QPainter *painter)
+{
+    if (!_inactiveWidget)
+        return;
+
+    if (_widgetSnapshot.isNull())
+        _widgetSnapshot = _inactiveWidget->grab();
+
+    painter->drawPixmap(nodeScene()->nodeGeometry().widgetPosition(_nodeId), _widgetSnapshot);
+}
+
 void NodeGraphicsObject::setLockedState()
 {
     NodeFlags flags = _graphModel.nodeFlags(_nodeId);
@@ -134,18 +380,23 @@ QRectF NodeGraphicsObject::boundingRect() const
 void NodeGraphicsObject::setGeometryChanged()
 {
     prepareGeometryChange();
+
+    invalidateRenderCache();
+
+    if (_nodeState.hovered())
+        nodeScene()->updateHoverOverlay(*this);
 }
 
 void NodeGraphicsObject::moveConnections() const
 {
-    auto const &connected = _graphModel.allConnectionIds(_nodeId);
+    BasicGraphicsScene *scene = nodeScene();
 
-    for (auto &cnId : connected) {
-        auto cgo = nodeScene()->connectionGraphicsObject(cnId);
+    _graphModel.forEachNodeConnection(_nodeId, [scene](ConnectionId const &cnId) {
+        auto cgo = scene->connectionGraphicsObject(cnId);
 
         if (cgo)
             cgo->move();
-    }
+    });
 }
 
 void NodeGraphicsObject::reactToConnection(ConnectionGraphicsObject const *cgo)
@@ -157,17 +408,124 @@ void NodeGraphicsObject::reactToConnection(ConnectionGraphicsObject const *cgo)
 
 void NodeGraphicsObject::paint(QPainter *painter, QStyleOptionGraphicsItem const *option, QWidget *)
 {
-    painter->setClipRect(option->exposedRect);
+    PaintStatistics::Scope scope(PaintStatistics::NodePaint);
+
+    // Items must not be added while the scene paints.
+    if (_widgetDeferred) {
+        _widgetDeferred = false;
+
+        QTimer::singleShot(0, this, [this, generation = _generation]() {
+            if (generation == _generation)
+                embedDeferredWidget();
+        });
+    }
+
+    if (!nodeScene()->nodeRenderCacheEnabled() || !paintCached(painter)) {
+        // Nodes paint within their bounds anyway; on the GPU every clip change
+        // costs a scissor or stencil update, so only raster gets the clip.
+        if (painter->paintEngine()->type() != QPaintEngine::OpenGL2)
+            painter->setClipRect(option->exposedRect);
+
+        nodeScene()->nodePainter().paint(painter, *this);
+    }
+
+    paintWidgetSnapshot(painter);
+}
+
+NodeRenderKey NodeGraphicsObject::renderCacheKey(QSizeF const &size, qreal const scale) const
+{
+    BasicGraphicsScene *scene = nodeScene();
+
+    NodeRenderKey key;
+    key.size = size;
+    key.scale = scale;
+    key.styleRevision = scene->styleContext().revision();
+    key.selected = isSelected();
+    key.hovered = _nodeState.hovered() && !scene->hoverOverlay();
+    key.computing = _graphModel.nodeData(_nodeId, NodeRole::Computing).toBool();
+
+    key.painterType = typeid(scene->nodePainter()).hash_code();
+    key.shadowMode = static_cast<int>(scene->nodeShadowMode());
+    key.orientation = static_cast<int>(scene->orientation());
+    key.computeHeatScale = scene->computeHeatScale();
+
+    // Shared bits are harmless, the node is invalidated on every connection change anyway.
+    key.connectedPorts = _nodeState.connectedPortsMask();
+
+    return key;
+}
+
+bool NodeGraphicsObject::paintCached(QPainter *painter)
+{
+    // Reacting ports follow the dragged connection, resizing changes the
+    // size on every move: neither is worth an image.
+    if (_nodeState.connectionForReaction() || _nodeState.resizing())
+        return false;
+
+    // Zoomed far in, an image of the whole node is mostly off screen.
+    qreal const maxExtent = 4096;
+
+    qreal const lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+        painter->worldTransform());
+
+    qreal const deviceScale = painter->device() ? painter->device()->devicePixelRatioF() : 1.0;
+
+    QRectF const rect = boundingRect();
+
+    QSizeF const pixels = rect.size() * lod * deviceScale;
+
+    if (pixels.isEmpty() || pixels.width() > maxExtent || pixels.height() > maxExtent)
+        return false;
+
+    NodeRenderKey const key = renderCacheKey(rect.size(), lod * deviceScale);
+
+    if (_renderCache.isNull() || !(key == _renderCacheKey)) {
+        SharedSceneCache *shared = nodeScene()->sharedCache().get();
+
+        QPixmap cache = shared ? shared->nodeImage(_nodeId, key) : QPixmap();
+
+        if (cache.isNull()) {
+            cache = QPixmap(std::ceil(pixels.width()), std::ceil(pixels.height()));
+            cache.setDevicePixelRatio(deviceScale);
+            cache.fill(Qt::transparent);
+
+            QPainter cachePainter(&cache);
+            cachePainter.setRenderHints(painter->renderHints());
+            cachePainter.scale(lod, lod);
+            cachePainter.translate(-rect.topLeft());
 
-    nodeScene()->nodePainter().paint(painter, *this);
+            nodeScene()->nodePainter().paint(&cachePainter, *this);
+
+            cachePainter.end();
+
+            if (shared)
+                shared->insertNodeImage(_nodeId, key, cache);
+        }
+
+        _renderCache = cache;
+        _renderCacheKey = key;
+    }
+
+    painter->drawPixmap(rect, _renderCache, QRectF(QPointF(0, 0), pixels));
+
+    return true;
 }
 
 QVariant NodeGraphicsObject::itemChange(GraphicsItemChange change, const QVariant &value)
 {
     if (change == ItemScenePositionHasChanged && scene()) {
-        moveConnections();
+        nodeScene()->updateSpatialIndex(*this);
+
+        if (!nodeScene()->batchMoveInProgress())
+            moveConnections();
+
+        if (_nodeState.hovered())
+            nodeScene()->updateHoverOverlay(*this);
     }
 
+    if (change == ItemSelectedHasChanged && scene())
+        nodeScene()->updateNodeSelection(_nodeId, value.toBool());
+
     return QGraphicsObject::itemChange(change, value);
 }
 
@@ -276,22 +634,18 @@ void NodeGraphicsObject::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
     } else {
         auto diff = event->pos() - event->lastPos();
 
-        nodeScene()->undoStack().push(new MoveNodeCommand(nodeScene(), diff));
+        nodeScene()->dragSelectedNodes(diff);
 
         event->accept();
     }
-
-    QRectF r = nodeScene()->sceneRect();
-
-    r = r.united(mapToScene(boundingRect()).boundingRect());
-
-    nodeScene()->setSceneRect(r);
 }
 
 void NodeGraphicsObject::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
 {
     _nodeState.setResizing(false);
 
+    nodeScene()->finishNodeDrag();
+
     QGraphicsObject::mouseReleaseEvent(event);
 
     // position connections precisely after fast node move
@@ -302,23 +656,24 @@ void NodeGraphicsObject::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
 
 void NodeGraphicsObject::hoverEnterEvent(QGraphicsSceneHoverEvent *event)
 {
-    // bring all the colliding nodes to background
-    QList<QGraphicsItem *> overlapItems = collidingItems();
+    BasicGraphicsScene *scene = nodeScene();
 
-    for (QGraphicsItem *item : overlapItems) {
-        if (item->zValue() > 0.0) {
-            item->setZValue(0.0);
-        }
+    // Raising repaints the node, with the overlay only done if another node covers part of it.
+    if (!scene->hoverOverlay() || scene->nodesInRect(sceneBoundingRect()).size() > 1) {
+        // bring this node forward, the one raised before goes back
+        scene->raiseNode(_nodeId);
     }
 
-    // bring this node forward
-    setZValue(1.0);
-
     _nodeState.setHovered(true);
 
-    update();
+    updateWidgetActivation();
 
-    Q_EMIT nodeScene()->nodeHovered(_nodeId, event->screenPos());
+    if (scene->hoverOverlay())
+        scene->updateHoverOverlay(*this);
+    else
+        update();
+
+    Q_EMIT scene->nodeHovered(_nodeId, event->screenPos());
 
     event->accept();
 }
@@ -327,9 +682,14 @@ void NodeGraphicsObject::hoverLeaveEvent(QGraphicsSceneHoverEvent *event)
 {
     _nodeState.setHovered(false);
 
-    setZValue(0.0);
+    nodeScene()->lowerNode(_nodeId);
 
-    update();
+    scheduleWidgetActivation();
+
+    if (nodeScene()->hoverOverlay())
+        nodeScene()->updateHoverOverlay(*this);
+    else
+        update();
 
     Q_EMIT nodeScene()->nodeHoverLeft(_nodeId);
 
@@ -343,11 +703,15 @@ void NodeGraphicsObject::hoverMoveEvent(QGraphicsSceneHoverEvent *event)
     //NodeGeometry geometry(_nodeId, _graphModel, nodeScene());
     AbstractNodeGeometry &geometry = nodeScene()->nodeGeometry();
 
-    if ((_graphModel.nodeFlags(_nodeId) | NodeFlag::Resizable)
-        && geometry.resizeHandleRect(_nodeId).contains(QPoint(pos.x(), pos.y()))) {
-        setCursor(QCursor(Qt::SizeFDiagCursor));
-    } else {
-        setCursor(QCursor());
+    bool const resizeCursor = _graphModel.nodeFlags(_nodeId).testFlag(NodeFlag::Resizable)
+                              && geometry.resizeHandleRect(_nodeId).contains(
+                                  QPoint(pos.x(), pos.y()));
+
+    // Every `setCursor()` goes through the views, only transitions are worth it.
+    if (resizeCursor != _resizeCursor) {
+        _resizeCursor = resizeCursor;
+
+        setCursor(resizeCursor ? QCursor(Qt::SizeFDiagCursor) : QCursor());
     }
 
     event->accept();
@@ -360,6 +724,28 @@ void NodeGraphicsObject::mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event)
     Q_EMIT nodeScene()->nodeDoubleClicked(_nodeId);
 }
 
+void NodeGraphicsObject::focusInEvent(QFocusEvent *event)
+{
+    updateWidgetActivation();
+
+    QGraphicsObject::focusInEvent(event);
+}
+
+void NodeGraphicsObject::focusOutEvent(QFocusEvent *event)
+{
+    scheduleWidgetActivation();
+
+    QGraphicsObject::focusOutEvent(event);
+}
+
+bool NodeGraphicsObject::sceneEventFilter(QGraphicsItem *watched, QEvent *event)
+{
+    if (watched == _proxyWidget && event->type() == QEvent::FocusOut)
+        scheduleWidgetActivation();
+
+    return QGraphicsObject::sceneEventFilter(watched, event);
+}
+
 void NodeGraphicsObject::contextMenuEvent(QGraphicsSceneContextMenuEvent *event)
 {
     Q_EMIT nodeScene()->nodeContextMenu(_nodeId, mapToScene(event->pos()));
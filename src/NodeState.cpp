@@ -1,5 +1,6 @@
 #include "NodeState.hpp"
 
+#include "AbstractGraphModel.hpp"
 #include "ConnectionGraphicsObject.hpp"
 #include "NodeGraphicsObject.hpp"
 
@@ -10,9 +11,7 @@ NodeState::NodeState(NodeGraphicsObject &ngo)
     , _hovered(false)
     , _resizing(false)
     , _connectionForReaction{nullptr}
-{
-    Q_UNUSED(_ngo);
-}
+{}
 
 void NodeState::setResizing(bool resizing)
 {
@@ -39,4 +38,71 @@ void NodeState::resetConnectionForReaction()
     _connectionForReaction.clear();
 }
 
+std::size_t NodeState::connectionCount(PortType portType, PortIndex index) const
+{
+    auto const &counts = portType == PortType::In ? _inConnectionCounts : _outConnectionCounts;
+
+    return index < counts.size() ? counts[index] : 0;
+}
+
+quint64 NodeState::connectedPortsMask() const
+{
+    quint64 mask = 0;
+
+    unsigned int bit = 0;
+
+    for (auto const *counts : {&_inConnectionCounts, &_outConnectionCounts}) {
+        for (std::size_t const count : *counts) {
+            if (count > 0)
+                mask ^= quint64(1) << (bit % 64);
+
+            ++bit;
+        }
+    }
+
+    return mask;
+}
+
+void NodeState::updateConnectionCounts()
+{
+    AbstractGraphModel const &model = _ngo.graphModel();
+    NodeId const nodeId = _ngo.nodeId();
+
+    for (PortType portType : {PortType::In, PortType::Out}) {
+        auto &counts = portType == PortType::In ? _inConnectionCounts : _outConnectionCounts;
+
+        auto const countRole = portType == PortType::In ? NodeRole::InPortCount
+                                                        : NodeRole::OutPortCount;
+
+        counts.resize(model.nodeData<unsigned int>(nodeId, countRole));
+
+        for (PortIndex index = 0; index < counts.size(); ++index) {
+            counts[index] = model.connectionCount(nodeId, portType, index);
+        }
+    }
+}
+
+void NodeState::updateConnectionCount(PortType portType, PortIndex index)
+{
+    if (portType == PortType::None)
+        return;
+
+    auto &counts = portType == PortType::In ? _inConnectionCounts : _outConnectionCounts;
+
+    // Ports added since the last full update.
+    if (index >= counts.size())
+        counts.resize(index + 1, 0);
+
+    counts[index] = _ngo.graphModel().connectionCount(_ngo.nodeId(), portType, index);
+}
+
+void NodeState::reset()
+{
+    _hovered = false;
+    _resizing = false;
+    _connectionForReaction.clear();
+    _inConnectionCounts.clear();
+    _outConnectionCounts.clear();
+}
+
 } // namespace QtNodes
@@ -18,14 +18,8 @@ inline void initResources()
 }
 
 NodeStyle::NodeStyle()
-{
-    // Explicit resources inialization for preventing the static initialization
-    // order fiasco: https://isocpp.org/wiki/faq/ctors#static-init-order
-    initResources();
-
-    // This configuration is stored inside the compiled unit and is loaded statically
-    loadJsonFile(":DefaultStyle.json");
-}
+    : NodeStyle(defaultStyle())
+{}
 
 NodeStyle::NodeStyle(QString jsonText)
 {
@@ -37,6 +31,25 @@ NodeStyle::NodeStyle(QJsonObject const &json)
     loadJson(json);
 }
 
+NodeStyle const &NodeStyle::defaultStyle()
+{
+    static NodeStyle const style = []() {
+        // Explicit resources inialization for preventing the static initialization
+        // order fiasco: https://isocpp.org/wiki/faq/ctors#static-init-order
+        initResources();
+
+        // This configuration is stored inside the compiled unit and is loaded statically
+        QFile file(":DefaultStyle.json");
+
+        if (!file.open(QIODevice::ReadOnly))
+            qWarning() << "Couldn't open file " << file.fileName();
+
+        return NodeStyle(QJsonDocument::fromJson(file.readAll()).object());
+    }();
+
+    return style;
+}
+
 void NodeStyle::setNodeStyle(QString jsonText)
 {
     NodeStyle style(jsonText);
@@ -113,6 +126,10 @@ void NodeStyle::loadJson(QJsonObject const &json)
     NODE_STYLE_READ_FLOAT(obj, ConnectionPointDiameter);
 
     NODE_STYLE_READ_FLOAT(obj, Opacity);
+
+    NODE_STYLE_READ_FLOAT(obj, LabelsLevelOfDetail);
+    NODE_STYLE_READ_FLOAT(obj, FlatLevelOfDetail);
+    NODE_STYLE_READ_FLOAT(obj, DotLevelOfDetail);
 }
 
 QJsonObject NodeStyle::toJson() const
@@ -139,6 +156,10 @@ QJsonObject NodeStyle::toJson() const
 
     NODE_STYLE_WRITE_FLOAT(obj, Opacity);
 
+    NODE_STYLE_WRITE_FLOAT(obj, LabelsLevelOfDetail);
+    NODE_STYLE_WRITE_FLOAT(obj, FlatLevelOfDetail);
+    NODE_STYLE_WRITE_FLOAT(obj, DotLevelOfDetail);
+
     QJsonObject root;
     root["NodeStyle"] = obj;
 
@@ -0,0 +1,1068 @@
+#include "PagedGraphModel.hpp"
+
+#include "ConnectionIdUtils.hpp"
+#include "NodeStyle.hpp"
+#include "StyleCollection.hpp"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QTemporaryFile>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace QtNodes {
+
+namespace {
+
+void writeConnections(QDataStream &out, std::vector<ConnectionId> const &connections)
+{
+    out << static_cast<quint32>(connections.size());
+
+    for (ConnectionId const &cid : connections) {
+        out << static_cast<quint32>(cid.outNodeId) << static_cast<quint32>(cid.outPortIndex)
+            << static_cast<quint32>(cid.inNodeId) << static_cast<quint32>(cid.inPortIndex);
+    }
+}
+
+void readConnections(QDataStream &in, std::vector<ConnectionId> &connections)
+{
+    quint32 count = 0;
+    in >> count;
+
+    connections.resize(count);
+
+    for (ConnectionId &cid : connections) {
+        quint32 outNodeId = 0, outPortIndex = 0, inNodeId = 0, inPortIndex = 0;
+        in >> outNodeId >> outPortIndex >> inNodeId >> inPortIndex;
+
+        cid = ConnectionId{outNodeId, outPortIndex, inNodeId, inPortIndex};
+    }
+}
+
+std::vector<ConnectionId> filtered(std::vector<ConnectionId> const &connections,
+                                   PortType const portType,
+                                   PortIndex const portIndex)
+{
+    if (portIndex == InvalidPortIndex)
+        return connections;
+
+    std::vector<ConnectionId> result;
+
+    for (ConnectionId const &cid : connections) {
+        if (getPortIndex(portType, cid) == portIndex)
+            result.push_back(cid);
+    }
+
+    return result;
+}
+
+} // namespace
+
+PagedGraphModel::PagedGraphModel(QString const &storageDirectory, QObject *parent)
+    : AbstractGraphModel(parent)
+    , _nextNodeId(0)
+    , _nodeCount(0)
+    , _connectionCount(0)
+    , _file(std::make_unique<QTemporaryFile>(
+          QDir(storageDirectory.isEmpty() ? QDir::tempPath() : storageDirectory)
+              .filePath(QStringLiteral("qtnodes-XXXXXX.pages"))))
+    , _fileEnd(0)
+    , _residentPageLimit(1024)
+{}
+
+PagedGraphModel::~PagedGraphModel() = default;
+
+void PagedGraphModel::setResidentPageLimit(std::size_t const pages)
+{
+    _residentPageLimit = std::max<std::size_t>(2, pages);
+
+    while (_pages.size() > _residentPageLimit) {
+        evict();
+    }
+}
+
+void PagedGraphModel::flush()
+{
+    for (auto &entry : _pages) {
+        if (entry.second.dirty)
+            writePage(entry.first, entry.second);
+    }
+
+    if (_file->isOpen())
+        _file->flush();
+}
+
+void PagedGraphModel::clear()
+{
+    _pages.clear();
+    _lru.clear();
+    _extents.clear();
+    _fileEnd = 0;
+
+    if (_file->isOpen())
+        _file->resize(0);
+
+    _exists.clear();
+    _positions.clear();
+    _sizes.clear();
+    _pageBounds.clear();
+
+    _nodeCount = 0;
+    _connectionCount = 0;
+
+    Q_EMIT modelReset();
+}
+
+QJsonObject PagedGraphModel::save() const
+{
+    QJsonArray nodesJson;
+    for (NodeId nodeId = 0; nodeId < _exists.size(); ++nodeId) {
+        if (_exists[nodeId])
+            nodesJson.append(saveNode(nodeId));
+    }
+
+    QJsonArray connectionsJson;
+    forEachGraphConnection([&connectionsJson](ConnectionId const &connectionId) {
+        connectionsJson.append(toJson(connectionId));
+    });
+
+    QJsonObject json;
+    json["nodes"] = nodesJson;
+    json["connections"] = connectionsJson;
+
+    return json;
+}
+
+void PagedGraphModel::load(QJsonObject const &json)
+{
+    GraphTransaction transaction(*this);
+
+    for (QJsonValue const nodeJson : json["nodes"].toArray()) {
+        loadNode(nodeJson.toObject());
+    }
+
+    std::vector<ConnectionId> added;
+
+    for (QJsonValue const connectionJson : json["connections"].toArray()) {
+        ConnectionId const connectionId = fromJson(connectionJson.toObject());
+
+        if (insertConnection(connectionId))
+            added.push_back(connectionId);
+    }
+
+    for (ConnectionId const &connectionId : added) {
+        Q_EMIT connectionCreated(connectionId);
+    }
+}
+
+MemoryReport PagedGraphModel::memoryReport() const
+{
+    MemoryReport report;
+
+    std::size_t const columnBytes = _exists.capacity() / 8
+                                    + MemoryReport::vectorBytes(_positions)
+                                    + MemoryReport::vectorBytes(_sizes)
+                                    + MemoryReport::vectorBytes(_pageBounds)
+                                    + MemoryReport::vectorBytes(_extents);
+
+    report.add(QStringLiteral("nodes"), _nodeCount, columnBytes);
+
+    std::size_t pageBytes = MemoryReport::hashBytes(_pages)
+                            + _lru.size() * (sizeof(std::size_t) + 2 * sizeof(void *));
+
+    for (auto const &entry : _pages) {
+        pageBytes += MemoryReport::vectorBytes(entry.second.entries);
+
+        for (NodeEntry const &node : entry.second.entries) {
+            pageBytes += (node.type.capacity() + node.caption.capacity()) * sizeof(QChar)
+                         + MemoryReport::vectorBytes(node.out) + MemoryReport::vectorBytes(node.in)
+                         + static_cast<std::size_t>(node.internalData.capacity());
+        }
+    }
+
+    report.add(QStringLiteral("residentPages"), _pages.size(), pageBytes);
+
+    // On disk, not in memory; reported for the ratio to the resident part.
+    report.add(QStringLiteral("storedPages"), _extents.size(), 0);
+
+    return report;
+}
+
+void PagedGraphModel::prefetch(QRectF const &rect)
+{
+    QPointF const center = rect.center();
+
+    std::vector<std::pair<qreal, std::size_t>> hits;
+
+    for (std::size_t pageIndex = 0; pageIndex < _pageBounds.size(); ++pageIndex) {
+        QRectF const &bounds = _pageBounds[pageIndex];
+
+        if (!bounds.isNull() && bounds.intersects(rect)) {
+            QPointF const delta = bounds.center() - center;
+            hits.emplace_back(QPointF::dotProduct(delta, delta), pageIndex);
+        }
+    }
+
+    std::size_t const limit = std::min(hits.size(), _residentPageLimit / 2);
+
+    std::partial_sort(hits.begin(), hits.begin() + limit, hits.end());
+
+    // The nearest page is read last and stays the most recently used.
+    for (std::size_t i = limit; i-- > 0;) {
+        page(hits[i].second);
+    }
+}
+
+void PagedGraphModel::prefetchNodes(std::vector<NodeId> const &nodeIds)
+{
+    std::vector<std::size_t> pageIndices;
+
+    for (NodeId const nodeId : nodeIds) {
+        if (nodeExists(nodeId))
+            pageIndices.push_back(pageOf(nodeId));
+    }
+
+    std::sort(pageIndices.begin(), pageIndices.end());
+    pageIndices.erase(std::unique(pageIndices.begin(), pageIndices.end()), pageIndices.end());
+
+    pageIndices.resize(std::min(pageIndices.size(), _residentPageLimit / 2));
+
+    for (std::size_t const pageIndex : pageIndices) {
+        page(pageIndex);
+    }
+}
+
+NodeId PagedGraphModel::reserveNodeIds(std::size_t const count)
+{
+    if (count == 0)
+        return InvalidNodeId;
+
+    NodeId const first = _nextNodeId;
+
+    _nextNodeId += static_cast<NodeId>(count);
+
+    return first;
+}
+
+std::unordered_set<NodeId> PagedGraphModel::allNodeIds() const
+{
+    std::unordered_set<NodeId> result;
+    result.reserve(_nodeCount);
+
+    for (NodeId nodeId = 0; nodeId < _exists.size(); ++nodeId) {
+        if (_exists[nodeId])
+            result.insert(nodeId);
+    }
+
+    return result;
+}
+
+std::unordered_set<ConnectionId> PagedGraphModel::allConnectionIds(NodeId const nodeId) const
+{
+    std::unordered_set<ConnectionId> result;
+
+    forEachNodeConnection(nodeId,
+                          [&result](ConnectionId const &connectionId) {
+                              result.insert(connectionId);
+                          });
+
+    return result;
+}
+
+std::unordered_set<ConnectionId> PagedGraphModel::connections(NodeId nodeId,
+                                                              PortType portType,
+                                                              PortIndex portIndex) const
+{
+    std::vector<ConnectionId> const found = portConnections(nodeId, portType, portIndex);
+
+    return std::unordered_set<ConnectionId>(found.begin(), found.end());
+}
+
+void PagedGraphModel::forEachConnection(NodeId nodeId,
+                                        PortType portType,
+                                        PortIndex portIndex,
+                                        ConnectionVisitor const &visitor) const
+{
+    for (ConnectionId const &connectionId : portConnections(nodeId, portType, portIndex)) {
+        visitor(connectionId);
+    }
+}
+
+void PagedGraphModel::forEachNodeConnection(NodeId nodeId, ConnectionVisitor const &visitor) const
+{
+    for (ConnectionId const &connectionId :
+         portConnections(nodeId, PortType::In, InvalidPortIndex)) {
+        visitor(connectionId);
+    }
+
+    // A connection of the node to itself was visited as an input already.
+    for (ConnectionId const &connectionId :
+         portConnections(nodeId, PortType::Out, InvalidPortIndex)) {
+        if (connectionId.inNodeId != nodeId)
+            visitor(connectionId);
+    }
+}
+
+void PagedGraphModel::forEachGraphConnection(ConnectionVisitor const &visitor) const
+{
+    std::vector<ConnectionId> connections;
+
+    for (std::size_t pageIndex = 0; pageIndex < _pageBounds.size(); ++pageIndex) {
+        NodeId const first = static_cast<NodeId>(pageIndex * NodesPerPage);
+        NodeId const last = static_cast<NodeId>(
+            std::min<std::size_t>(first + NodesPerPage, _exists.size()));
+
+        if (std::find(_exists.begin() + first, _exists.begin() + last, true)
+            == _exists.begin() + last)
+            continue;
+
+        connections.clear();
+
+        Page const &p = page(pageIndex);
+
+        for (NodeId nodeId = first; nodeId < last; ++nodeId) {
+            if (_exists[nodeId]) {
+                std::vector<ConnectionId> const &out = p.entries[nodeId - first].out;
+                connections.insert(connections.end(), out.begin(), out.end());
+            }
+        }
+
+        // The visitor may read other pages.
+        for (ConnectionId const &connectionId : connections) {
+            visitor(connectionId);
+        }
+    }
+}
+
+std::size_t PagedGraphModel::connectionCount(NodeId nodeId,
+                                             PortType portType,
+                                             PortIndex portIndex) const
+{
+    if (portType == PortType::None || !nodeExists(nodeId))
+        return 0;
+
+    NodeEntry const &node = entry(nodeId);
+
+    std::vector<ConnectionId> const &list = portType == PortType::In ? node.in : node.out;
+
+    if (portIndex == InvalidPortIndex)
+        return list.size();
+
+    return static_cast<std::size_t>(
+        std::count_if(list.begin(), list.end(), [&](ConnectionId const &cid) {
+            return getPortIndex(portType, cid) == portIndex;
+        }));
+}
+
+bool PagedGraphModel::connectionExists(ConnectionId const connectionId) const
+{
+    if (!nodeExists(connectionId.outNodeId))
+        return false;
+
+    std::vector<ConnectionId> const &out = entry(connectionId.outNodeId).out;
+
+    return std::find(out.begin(), out.end(), connectionId) != out.end();
+}
+
+NodeId PagedGraphModel::addNode(QString const nodeType)
+{
+    NodeId const nodeId = newNodeId();
+
+    insertNode(nodeId, nodeType);
+
+    Q_EMIT nodeCreated(nodeId);
+
+    return nodeId;
+}
+
+bool PagedGraphModel::connectionPossible(ConnectionId const connectionId) const
+{
+    if (!nodeExists(connectionId.outNodeId) || !nodeExists(connectionId.inNodeId)
+        || connectionId.outNodeId == connectionId.inNodeId)
+        return false;
+
+    if (connectionId.outPortIndex >= entry(connectionId.outNodeId).outPorts
+        || connectionId.inPortIndex >= entry(connectionId.inNodeId).inPorts)
+        return false;
+
+    return connectionCount(connectionId.inNodeId, PortType::In, connectionId.inPortIndex) == 0;
+}
+
+void PagedGraphModel::addConnection(ConnectionId const connectionId)
+{
+    if (insertConnection(connectionId))
+        Q_EMIT connectionCreated(connectionId);
+}
+
+bool PagedGraphModel::nodeExists(NodeId const nodeId) const
+{
+    return nodeId < _exists.size() && _exists[nodeId];
+}
+
+void PagedGraphModel::forEachNodeGeometry(NodeGeometryVisitor const &visitor) const
+{
+    for (NodeId nodeId = 0; nodeId < _exists.size(); ++nodeId) {
+        if (_exists[nodeId])
+            visitor(nodeId, _positions[nodeId], _sizes[nodeId]);
+    }
+}
+
+void PagedGraphModel::nodePositions(std::vector<NodeId> const &nodeIds,
+                                    std::vector<QPointF> &positions) const
+{
+    positions.resize(nodeIds.size());
+
+    for (std::size_t i = 0; i < nodeIds.size(); ++i) {
+        positions[i] = nodeExists(nodeIds[i]) ? _positions[nodeIds[i]] : QPointF();
+    }
+}
+
+void PagedGraphModel::nodeSizes(std::vector<NodeId> const &nodeIds,
+                                std::vector<QSize> &sizes) const
+{
+    sizes.resize(nodeIds.size());
+
+    for (std::size_t i = 0; i < nodeIds.size(); ++i) {
+        sizes[i] = nodeExists(nodeIds[i]) ? _sizes[nodeIds[i]] : QSize();
+    }
+}
+
+QVariant PagedGraphModel::nodeData(NodeId nodeId, NodeRole role) const
+{
+    QVariant result;
+
+    if (!nodeExists(nodeId))
+        return result;
+
+    switch (role) {
+    case NodeRole::Type:
+        result = entry(nodeId).type;
+        break;
+
+    case NodeRole::Position:
+        result = _positions[nodeId];
+        break;
+
+    case NodeRole::Size:
+        result = _sizes[nodeId];
+        break;
+
+    case NodeRole::CaptionVisible:
+        result = !entry(nodeId).caption.isEmpty();
+        break;
+
+    case NodeRole::Caption:
+        result = entry(nodeId).caption;
+        break;
+
+    case NodeRole::Style: {
+        auto style = StyleCollection::nodeStyle();
+        result = style.toJson().toVariantMap();
+    } break;
+
+    case NodeRole::StylePtr:
+        result = QVariant::fromValue(StyleCollection::sharedNodeStyle());
+        break;
+
+    case NodeRole::Computing:
+        result = false;
+        break;
+
+    case NodeRole::InternalData: {
+        QByteArray const &internalData = entry(nodeId).internalData;
+
+        if (internalData.isEmpty())
+            break;
+
+        // The layout of DataFlowGraphModel.
+        QJsonObject nodeJson;
+        nodeJson["internal-data"] = QJsonDocument::fromJson(internalData).object();
+
+        result = nodeJson.toVariantMap();
+    } break;
+
+    case NodeRole::InPortCount:
+        result = entry(nodeId).inPorts;
+        break;
+
+    case NodeRole::OutPortCount:
+        result = entry(nodeId).outPorts;
+        break;
+
+    case NodeRole::Widget:
+        break;
+
+    case NodeRole::WidgetSizeHint:
+        break;
+
+    case NodeRole::ComputeTime:
+        break;
+
+    case NodeRole::LayoutKey:
+        break;
+    }
+
+    return result;
+}
+
+bool PagedGraphModel::setNodeData(NodeId nodeId, NodeRole role, QVariant value)
+{
+    if (!nodeExists(nodeId))
+        return false;
+
+    bool result = false;
+
+    switch (role) {
+    case NodeRole::Type:
+        break;
+
+    case NodeRole::Position:
+        _positions[nodeId] = value.value<QPointF>();
+        updatePageBounds(nodeId);
+
+        Q_EMIT nodePositionUpdated(nodeId);
+
+        result = true;
+        break;
+
+    case NodeRole::Size:
+        _sizes[nodeId] = value.value<QSize>();
+        updatePageBounds(nodeId);
+
+        result = true;
+        break;
+
+    case NodeRole::CaptionVisible:
+        break;
+
+    case NodeRole::Caption:
+        writableEntry(nodeId).caption = value.toString();
+
+        Q_EMIT nodeUpdated(nodeId);
+
+        result = true;
+        break;
+
+    case NodeRole::Style:
+        break;
+
+    case NodeRole::StylePtr:
+        break;
+
+    case NodeRole::Computing:
+        break;
+
+    case NodeRole::InternalData: {
+        QJsonObject const nodeJson = QJsonObject::fromVariantMap(value.toMap());
+
+        writableEntry(nodeId).internalData = QJsonDocument(nodeJson["internal-data"].toObject())
+                                                 .toJson(QJsonDocument::Compact);
+
+        Q_EMIT nodeUpdated(nodeId);
+
+        result = true;
+    } break;
+
+    case NodeRole::InPortCount:
+        result = setPortCount(nodeId, PortType::In, value.toUInt());
+        break;
+
+    case NodeRole::OutPortCount:
+        result = setPortCount(nodeId, PortType::Out, value.toUInt());
+        break;
+
+    case NodeRole::Widget:
+        break;
+
+    case NodeRole::WidgetSizeHint:
+        break;
+
+    case NodeRole::ComputeTime:
+        break;
+
+    case NodeRole::LayoutKey:
+        break;
+    }
+
+    return result;
+}
+
+void PagedGraphModel::moveNodes(std::vector<NodeId> const &nodeIds, QPointF const &delta)
+{
+    std::vector<NodeId> moved;
+    moved.reserve(nodeIds.size());
+
+    for (NodeId const nodeId : nodeIds) {
+        if (!nodeExists(nodeId))
+            continue;
+
+        _positions[nodeId] += delta;
+        updatePageBounds(nodeId);
+
+        moved.push_back(nodeId);
+    }
+
+    if (!moved.empty())
+        Q_EMIT nodePositionsUpdated(moved);
+}
+
+void PagedGraphModel::setNodePositions(std::vector<std::pair<NodeId, QPointF>> const &positions)
+{
+    std::vector<NodeId> moved;
+    moved.reserve(positions.size());
+
+    for (auto const &position : positions) {
+        if (!nodeExists(position.first))
+            continue;
+
+        _positions[position.first] = position.second;
+        updatePageBounds(position.first);
+
+        moved.push_back(position.first);
+    }
+
+    if (!moved.empty())
+        Q_EMIT nodePositionsUpdated(moved);
+}
+
+QVariant PagedGraphModel::portData(NodeId nodeId,
+                                   PortType portType,
+                                   PortIndex portIndex,
+                                   PortRole role) const
+{
+    Q_UNUSED(portIndex);
+
+    QVariant result;
+
+    if (!nodeExists(nodeId))
+        return result;
+
+    switch (role) {
+    case PortRole::Data:
+        break;
+
+    case PortRole::DataType:
+        break;
+
+    case PortRole::ConnectionPolicyRole:
+        result = QVariant::fromValue(portType == PortType::In ? ConnectionPolicy::One
+                                                              : ConnectionPolicy::Many);
+        break;
+
+    case PortRole::CaptionVisible:
+        result = false;
+        break;
+
+    case PortRole::Caption:
+        result = QString();
+        break;
+
+    case PortRole::DataTypeId:
+        break;
+
+    case PortRole::Required:
+        break;
+    }
+
+    return result;
+}
+
+bool PagedGraphModel::setPortData(
+    NodeId nodeId, PortType portType, PortIndex portIndex, QVariant const &value, PortRole role)
+{
+    Q_UNUSED(nodeId);
+    Q_UNUSED(portType);
+    Q_UNUSED(portIndex);
+    Q_UNUSED(value);
+    Q_UNUSED(role);
+
+    return false;
+}
+
+bool PagedGraphModel::deleteConnection(ConnectionId const connectionId)
+{
+    if (!eraseConnection(connectionId))
+        return false;
+
+    Q_EMIT connectionDeleted(connectionId);
+
+    return true;
+}
+
+void PagedGraphModel::remapConnections(ConnectionRemap const &remap)
+{
+    ConnectionRemap applied;
+    applied.reserve(remap.size());
+
+    // All old addresses go first, a shifted connection may take the place of another one.
+    for (auto const &shift : remap) {
+        if (eraseConnection(shift.first))
+            applied.push_back(shift);
+    }
+
+    for (auto const &shift : applied) {
+        insertConnection(shift.second);
+    }
+
+    if (!applied.empty())
+        Q_EMIT connectionsRemapped(applied);
+}
+
+bool PagedGraphModel::deleteNode(NodeId const nodeId)
+{
+    if (!nodeExists(nodeId))
+        return false;
+
+    std::vector<ConnectionId> attached;
+
+    forEachNodeConnection(nodeId, [&attached](ConnectionId const &connectionId) {
+        attached.push_back(connectionId);
+    });
+
+    for (ConnectionId const &connectionId : attached) {
+        deleteConnection(connectionId);
+    }
+
+    removeNode(nodeId);
+
+    Q_EMIT nodeDeleted(nodeId);
+
+    return true;
+}
+
+QJsonObject PagedGraphModel::saveNode(NodeId const nodeId) const
+{
+    QJsonObject nodeJson;
+
+    if (!nodeExists(nodeId))
+        return nodeJson;
+
+    NodeEntry const &node = entry(nodeId);
+
+    nodeJson["id"] = static_cast<qint64>(nodeId);
+    nodeJson["type"] = node.type;
+    nodeJson["caption"] = node.caption;
+    nodeJson["in-ports"] = static_cast<qint64>(node.inPorts);
+    nodeJson["out-ports"] = static_cast<qint64>(node.outPorts);
+
+    if (!node.internalData.isEmpty())
+        nodeJson["internal-data"] = QJsonDocument::fromJson(node.internalData).object();
+
+    QJsonObject posJson;
+    posJson["x"] = _positions[nodeId].x();
+    posJson["y"] = _positions[nodeId].y();
+    nodeJson["position"] = posJson;
+
+    return nodeJson;
+}
+
+void PagedGraphModel::loadNode(QJsonObject const &nodeJson)
+{
+    NodeId const restoredNodeId = static_cast<NodeId>(nodeJson["id"].toInt());
+
+    if (nodeExists(restoredNodeId))
+        return;
+
+    insertNode(restoredNodeId, nodeJson["type"].toString());
+
+    NodeEntry &node = writableEntry(restoredNodeId);
+
+    node.inPorts = static_cast<unsigned int>(nodeJson["in-ports"].toInt(1));
+    node.outPorts = static_cast<unsigned int>(nodeJson["out-ports"].toInt(1));
+
+    if (nodeJson.contains("caption"))
+        node.caption = nodeJson["caption"].toString();
+
+    if (nodeJson.contains("internal-data")) {
+        node.internalData = QJsonDocument(nodeJson["internal-data"].toObject())
+                                .toJson(QJsonDocument::Compact);
+    }
+
+    QJsonObject const posJson = nodeJson["position"].toObject();
+    _positions[restoredNodeId] = QPointF(posJson["x"].toDouble(), posJson["y"].toDouble());
+
+    updatePageBounds(restoredNodeId);
+
+    Q_EMIT nodeCreated(restoredNodeId);
+}
+
+PagedGraphModel::Page &PagedGraphModel::page(std::size_t const pageIndex) const
+{
+    auto it = _pages.find(pageIndex);
+
+    if (it != _pages.end()) {
+        _lru.splice(_lru.begin(), _lru, it->second.lru);
+        return it->second;
+    }
+
+    while (_pages.size() >= _residentPageLimit) {
+        evict();
+    }
+
+    Page loaded;
+    loaded.entries.resize(NodesPerPage);
+
+    if (pageIndex < _extents.size() && _extents[pageIndex].size > 0) {
+        PageExtent const &extent = _extents[pageIndex];
+
+        if (!_file->seek(extent.offset))
+            throw std::runtime_error("Cannot seek in the page file");
+
+        QByteArray const blob = _file->read(extent.size);
+
+        if (blob.size() != extent.size)
+            throw std::runtime_error("Cannot read a page of the page file");
+
+        QDataStream in(blob);
+        in.setVersion(QDataStream::Qt_5_11);
+
+        for (NodeEntry &node : loaded.entries) {
+            quint32 inPorts = 0, outPorts = 0;
+
+            in >> node.type >> node.caption >> inPorts >> outPorts;
+
+            node.inPorts = inPorts;
+            node.outPorts = outPorts;
+
+            readConnections(in, node.out);
+            readConnections(in, node.in);
+
+            in >> node.internalData;
+        }
+
+        if (in.status() != QDataStream::Ok)
+            throw std::runtime_error("Corrupt page in the page file");
+    }
+
+    _lru.push_front(pageIndex);
+    loaded.lru = _lru.begin();
+
+    return _pages.emplace(pageIndex, std::move(loaded)).first->second;
+}
+
+PagedGraphModel::NodeEntry const &PagedGraphModel::entry(NodeId const nodeId) const
+{
+    return page(pageOf(nodeId)).entries[nodeId % NodesPerPage];
+}
+
+PagedGraphModel::NodeEntry &PagedGraphModel::writableEntry(NodeId const nodeId)
+{
+    Page &p = page(pageOf(nodeId));
+    p.dirty = true;
+
+    return p.entries[nodeId % NodesPerPage];
+}
+
+void PagedGraphModel::evict() const
+{
+    std::size_t const pageIndex = _lru.back();
+
+    auto it = _pages.find(pageIndex);
+
+    if (it->second.dirty)
+        writePage(pageIndex, it->second);
+
+    _lru.pop_back();
+    _pages.erase(it);
+}
+
+void PagedGraphModel::writePage(std::size_t const pageIndex, Page &p) const
+{
+    if (!_file->isOpen() && !_file->open(QIODevice::ReadWrite))
+        throw std::runtime_error("Cannot create the page file: "
+                                 + _file->errorString().toStdString());
+
+    QByteArray blob;
+
+    {
+        QDataStream out(&blob, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_11);
+
+        for (NodeEntry const &node : p.entries) {
+            out << node.type << node.caption << static_cast<quint32>(node.inPorts)
+                << static_cast<quint32>(node.outPorts);
+
+            writeConnections(out, node.out);
+            writeConnections(out, node.in);
+
+            out << node.internalData;
+        }
+    }
+
+    if (pageIndex >= _extents.size())
+        _extents.resize(pageIndex + 1);
+
+    PageExtent &extent = _extents[pageIndex];
+
+    // Moved to the end with room to grow, the old place is given up.
+    if (blob.size() > extent.capacity) {
+        extent.offset = _fileEnd;
+        extent.capacity = blob.size() + blob.size() / 2;
+
+        _fileEnd += extent.capacity;
+    }
+
+    if (!_file->seek(extent.offset) || _file->write(blob) != blob.size())
+        throw std::runtime_error("Cannot write a page of the page file: "
+                                 + _file->errorString().toStdString());
+
+    extent.size = blob.size();
+
+    p.dirty = false;
+
+    // The bounds only grew while the page was in memory.
+    QRectF bounds;
+
+    NodeId const first = static_cast<NodeId>(pageIndex * NodesPerPage);
+    NodeId const last = static_cast<NodeId>(std::min<std::size_t>(first + NodesPerPage,
+                                                                  _exists.size()));
+
+    for (NodeId nodeId = first; nodeId < last; ++nodeId) {
+        if (_exists[nodeId])
+            bounds |= nodeRect(nodeId);
+    }
+
+    if (pageIndex < _pageBounds.size())
+        _pageBounds[pageIndex] = bounds;
+}
+
+std::vector<ConnectionId> PagedGraphModel::portConnections(NodeId const nodeId,
+                                                           PortType const portType,
+                                                           PortIndex const portIndex) const
+{
+    if (portType == PortType::None || !nodeExists(nodeId))
+        return {};
+
+    NodeEntry const &node = entry(nodeId);
+
+    return filtered(portType == PortType::In ? node.in : node.out, portType, portIndex);
+}
+
+void PagedGraphModel::insertNode(NodeId const nodeId, QString const &nodeType)
+{
+    // Next NodeId must be larger that any id existing in the graph
+    _nextNodeId = std::max(_nextNodeId, nodeId + 1);
+
+    if (nodeId >= _exists.size()) {
+        _exists.resize(nodeId + 1, false);
+        _positions.resize(nodeId + 1);
+        _sizes.resize(nodeId + 1);
+        _pageBounds.resize(pageOf(nodeId) + 1);
+    }
+
+    _exists[nodeId] = true;
+    _positions[nodeId] = QPointF();
+    _sizes[nodeId] = QSize();
+
+    NodeEntry &node = writableEntry(nodeId);
+
+    node = NodeEntry();
+    node.type = nodeType;
+    node.caption = nodeType;
+
+    updatePageBounds(nodeId);
+
+    ++_nodeCount;
+}
+
+void PagedGraphModel::removeNode(NodeId const nodeId)
+{
+    writableEntry(nodeId) = NodeEntry();
+
+    _exists[nodeId] = false;
+
+    --_nodeCount;
+}
+
+bool PagedGraphModel::insertConnection(ConnectionId const &connectionId)
+{
+    if (!nodeExists(connectionId.outNodeId) || !nodeExists(connectionId.inNodeId))
+        return false;
+
+    if (connectionExists(connectionId))
+        return false;
+
+    // The second page read may write the first one back, which is complete by then.
+    writableEntry(connectionId.outNodeId).out.push_back(connectionId);
+    writableEntry(connectionId.inNodeId).in.push_back(connectionId);
+
+    ++_connectionCount;
+
+    return true;
+}
+
+bool PagedGraphModel::eraseConnection(ConnectionId const &connectionId)
+{
+    if (!connectionExists(connectionId))
+        return false;
+
+    auto const erase = [&connectionId](std::vector<ConnectionId> &list) {
+        auto position = std::find(list.begin(), list.end(), connectionId);
+
+        if (position != list.end()) {
+            *position = list.back();
+            list.pop_back();
+        }
+    };
+
+    erase(writableEntry(connectionId.outNodeId).out);
+    erase(writableEntry(connectionId.inNodeId).in);
+
+    --_connectionCount;
+
+    return true;
+}
+
+bool PagedGraphModel::setPortCount(NodeId const nodeId,
+                                   PortType const portType,
+                                   unsigned int const count)
+{
+    if (!nodeExists(nodeId))
+        return false;
+
+    unsigned int const current = portType == PortType::In ? entry(nodeId).inPorts
+                                                          : entry(nodeId).outPorts;
+
+    if (count == current)
+        return true;
+
+    auto const store = [&]() {
+        NodeEntry &node = writableEntry(nodeId);
+        (portType == PortType::In ? node.inPorts : node.outPorts) = count;
+    };
+
+    if (count < current) {
+        portsAboutToBeDeleted(nodeId, portType, count, current - 1);
+        store();
+        portsDeleted();
+    } else {
+        portsAboutToBeInserted(nodeId, portType, current, count - 1);
+        store();
+        portsInserted();
+    }
+
+    Q_EMIT nodeUpdated(nodeId);
+
+    return true;
+}
+
+QRectF PagedGraphModel::nodeRect(NodeId const nodeId) const
+{
+    QSize const size = _sizes[nodeId];
+
+    return QRectF(_positions[nodeId],
+                  QSizeF(std::max(1, size.width()), std::max(1, size.height())));
+}
+
+void PagedGraphModel::updatePageBounds(NodeId const nodeId)
+{
+    QRectF &bounds = _pageBounds[pageOf(nodeId)];
+
+    bounds |= nodeRect(nodeId);
+}
+
+} // namespace QtNodes
@@ -0,0 +1,210 @@
+#include "PaintStatistics.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace QtNodes {
+
+namespace {
+
+thread_local PaintStatistics *activeStatistics = nullptr;
+
+QJsonObject counterToJson(PaintStatistics::Counter const &counter)
+{
+    QJsonObject object;
+    object["calls"] = static_cast<double>(counter.calls);
+    object["ms"] = counter.nanoseconds / 1e6;
+    return object;
+}
+
+} // namespace
+
+constexpr std::size_t PaintStatistics::History;
+
+PaintStatistics::Scope::Scope(Category const category)
+    : _statistics(activeStatistics)
+    , _category(category)
+{
+    if (_statistics)
+        _timer.start();
+}
+
+PaintStatistics::Scope::~Scope()
+{
+    if (_statistics)
+        _statistics->add(_category, _timer.nsecsElapsed());
+}
+
+PaintStatistics::Activation::Activation(PaintStatistics *statistics)
+    : _previous(activeStatistics)
+{
+    activeStatistics = statistics;
+}
+
+PaintStatistics::Activation::~Activation()
+{
+    activeStatistics = _previous;
+}
+
+PaintStatistics::PaintStatistics()
+    : _frameStart(0)
+    , _frames(0)
+    , _frameTimes(History, 0.0)
+    , _frameStarts(History, 0)
+{
+    _clock.start();
+}
+
+PaintStatistics *PaintStatistics::active()
+{
+    return activeStatistics;
+}
+
+void PaintStatistics::beginFrame()
+{
+    _frameStart = _clock.nsecsElapsed();
+}
+
+void PaintStatistics::endFrame()
+{
+    std::size_t const slot = _frames % History;
+
+    _frameTimes[slot] = (_clock.nsecsElapsed() - _frameStart) / 1e6;
+    _frameStarts[slot] = _frameStart;
+
+    ++_frames;
+
+    // Calls made between two frames, like hit tests, count for the next one.
+    _lastFrame = _frame;
+    _frame = Counters();
+}
+
+double PaintStatistics::framesPerSecond() const
+{
+    std::size_t const kept = static_cast<std::size_t>(std::min<std::uint64_t>(_frames, History));
+
+    if (kept < 2)
+        return 0.0;
+
+    std::int64_t const newest = _frameStarts[(_frames - 1) % History];
+    std::int64_t const oldest = _frameStarts[(_frames - kept) % History];
+
+    if (newest <= oldest)
+        return 0.0;
+
+    return (kept - 1) * 1e9 / (newest - oldest);
+}
+
+double PaintStatistics::frameTimePercentile(double const percentile) const
+{
+    std::size_t const kept = static_cast<std::size_t>(std::min<std::uint64_t>(_frames, History));
+
+    if (kept == 0)
+        return 0.0;
+
+    std::vector<double> times(_frameTimes.begin(), _frameTimes.begin() + kept);
+
+    double const clamped = std::max(0.0, std::min(100.0, percentile));
+
+    // Nearest rank.
+    double const position = std::ceil(clamped / 100.0 * kept);
+
+    std::size_t const rank = position < 1.0 ? 0
+                                            : std::min(kept, static_cast<std::size_t>(position)) - 1;
+
+    std::nth_element(times.begin(), times.begin() + rank, times.end());
+
+    return times[rank];
+}
+
+void PaintStatistics::reset()
+{
+    _frame = Counters();
+    _lastFrame = Counters();
+    _total = Counters();
+
+    _frames = 0;
+
+    std::fill(_frameTimes.begin(), _frameTimes.end(), 0.0);
+    std::fill(_frameStarts.begin(), _frameStarts.end(), 0);
+}
+
+QString PaintStatistics::categoryName(Category const category)
+{
+    switch (category) {
+    case NodePaint:
+        return QStringLiteral("nodePaint");
+    case ConnectionPaint:
+        return QStringLiteral("connectionPaint");
+    case Background:
+        return QStringLiteral("background");
+    case Shape:
+        return QStringLiteral("shape");
+    case CategoryCount:
+        break;
+    }
+
+    return QString();
+}
+
+QJsonObject PaintStatistics::toJson() const
+{
+    QJsonObject json;
+
+    json["frames"] = static_cast<double>(_frames);
+    json["fps"] = framesPerSecond();
+
+    QJsonObject percentiles;
+    percentiles["p50"] = frameTimePercentile(50);
+    percentiles["p90"] = frameTimePercentile(90);
+    percentiles["p99"] = frameTimePercentile(99);
+    json["frameTimeMs"] = percentiles;
+
+    QJsonObject lastFrame;
+    QJsonObject total;
+
+    for (int c = 0; c < CategoryCount; ++c) {
+        auto const category = static_cast<Category>(c);
+
+        lastFrame[categoryName(category)] = counterToJson(_lastFrame[c]);
+        total[categoryName(category)] = counterToJson(_total[c]);
+    }
+
+    json["lastFrame"] = lastFrame;
+    json["total"] = total;
+
+    return json;
+}
+
+QStringList PaintStatistics::summary() const
+{
+    QStringList lines;
+
+    lines << QStringLiteral("%1 fps  p50 %2 ms  p90 %3 ms  p99 %4 ms")
+                 .arg(framesPerSecond(), 0, 'f', 1)
+                 .arg(frameTimePercentile(50), 0, 'f', 2)
+                 .arg(frameTimePercentile(90), 0, 'f', 2)
+                 .arg(frameTimePercentile(99), 0, 'f', 2);
+
+    for (int c = 0; c < CategoryCount; ++c) {
+        auto const category = static_cast<Category>(c);
+
+        lines << QStringLiteral("%1: %2 calls, %3 ms")
+                     .arg(categoryName(category))
+                     .arg(_lastFrame[c].calls)
+                     .arg(_lastFrame[c].nanoseconds / 1e6, 0, 'f', 2);
+    }
+
+    return lines;
+}
+
+void PaintStatistics::add(Category const category, std::int64_t const nanoseconds)
+{
+    _frame[category].calls += 1;
+    _frame[category].nanoseconds += nanoseconds;
+
+    _total[category].calls += 1;
+    _total[category].nanoseconds += nanoseconds;
+}
+
+} // namespace QtNodes
@@ -0,0 +1,457 @@
+#include "PartitionedEvaluator.hpp"
+
+#include "ConnectionIdUtils.hpp"
+#include "DataFlowGraphModel.hpp"
+#include "NodeDelegateModelRegistry.hpp"
+#include "SceneJson.hpp"
+
+#include <QtCore/QJsonArray>
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+namespace QtNodes {
+
+using Port = BatchEvaluator::Port;
+using Values = BatchEvaluator::Values;
+
+/// A DataFlowGraphModel living on a thread of its own, evaluating one post at a time.
+class LocalPartitionTransport::Worker
+{
+public:
+    Worker(std::shared_ptr<NodeDelegateModelRegistry> registry, PartitionSpec spec)
+        : _spec(std::move(spec))
+        , _stopping(false)
+        , _posted(false)
+        , _done(false)
+        , _thread([this, registry]() { loop(registry); })
+    {}
+
+    ~Worker()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+
+        _wake.notify_all();
+
+        _thread.join();
+    }
+
+    void post(Values inputs)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            _inputs = std::move(inputs);
+            _posted = true;
+            _done = false;
+        }
+
+        _wake.notify_all();
+    }
+
+    Values wait()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        _wake.wait(lock, [this]() { return _done; });
+
+        if (_error)
+            std::rethrow_exception(_error);
+
+        return std::move(_outputs);
+    }
+
+private:
+    void loop(std::shared_ptr<NodeDelegateModelRegistry> const &registry)
+    {
+        // Created, used and destroyed on this thread only.
+        std::unique_ptr<DataFlowGraphModel> model;
+        std::exception_ptr loadError;
+
+        try {
+            model = std::make_unique<DataFlowGraphModel>(registry);
+            model->load(_spec.scene);
+        } catch (...) {
+            loadError = std::current_exception();
+        }
+
+        for (;;) {
+            Values inputs;
+
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+
+                _wake.wait(lock, [this]() { return _stopping || _posted; });
+
+                if (_stopping)
+                    return;
+
+                _posted = false;
+                inputs = std::move(_inputs);
+            }
+
+            Values outputs;
+            std::exception_ptr error = loadError;
+
+            if (!error) {
+                try {
+                    BatchEvaluator::applyInputs(*model, _spec.inputs, inputs);
+
+                    model->processPendingPropagation();
+
+                    outputs = BatchEvaluator::readOutputs(*model, _spec.outputs);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+
+                _outputs = std::move(outputs);
+                _error = error;
+                _done = true;
+            }
+
+            _wake.notify_all();
+        }
+    }
+
+private:
+    PartitionSpec const _spec;
+
+    std::mutex _mutex;
+
+    std::condition_variable _wake;
+
+    bool _stopping;
+
+    bool _posted;
+
+    bool _done;
+
+    Values _inputs;
+
+    Values _outputs;
+
+    std::exception_ptr _error;
+
+    /// Started last, once everything it reads is initialized.
+    std::thread _thread;
+};
+
+LocalPartitionTransport::LocalPartitionTransport(std::shared_ptr<NodeDelegateModelRegistry> registry)
+    : _registry(std::move(registry))
+{}
+
+LocalPartitionTransport::~LocalPartitionTransport() = default;
+
+void LocalPartitionTransport::open(std::vector<PartitionSpec> const &partitions)
+{
+    _workers.clear();
+    _workers.reserve(partitions.size());
+
+    for (PartitionSpec const &spec : partitions) {
+        _workers.push_back(std::make_unique<Worker>(_registry, spec));
+    }
+}
+
+void LocalPartitionTransport::post(std::size_t const partition, Values const &inputs)
+{
+    _workers.at(partition)->post(inputs);
+}
+
+Values LocalPartitionTransport::wait(std::size_t const partition)
+{
+    return _workers.at(partition)->wait();
+}
+
+PartitionedEvaluator::PartitionedEvaluator(QJsonObject scene, std::size_t const partitionCount)
+    : _scene(std::move(scene))
+    , _model(nullptr)
+    , _prepared(false)
+{
+    split(partitionCount);
+}
+
+PartitionedEvaluator::PartitionedEvaluator(DataFlowGraphModel &model,
+                                           std::size_t const partitionCount)
+    : _scene(model.save())
+    , _model(&model)
+    , _transport(std::make_shared<LocalPartitionTransport>(model.dataModelRegistry()))
+    , _prepared(false)
+{
+    split(partitionCount);
+}
+
+void PartitionedEvaluator::setTransport(std::shared_ptr<PartitionTransport> transport)
+{
+    _transport = std::move(transport);
+    _prepared = false;
+}
+
+void PartitionedEvaluator::setInputPorts(std::vector<Port> ports)
+{
+    _inputPorts = std::move(ports);
+    _prepared = false;
+}
+
+void PartitionedEvaluator::setOutputPorts(std::vector<Port> ports)
+{
+    _outputPorts = std::move(ports);
+    _prepared = false;
+}
+
+void PartitionedEvaluator::split(std::size_t const partitionCount)
+{
+    std::vector<NodeId> nodeIds;
+
+    for (QJsonValue const nodeJson : _scene["nodes"].toArray()) {
+        nodeIds.push_back(static_cast<NodeId>(nodeJson.toObject()["id"].toInt()));
+    }
+
+    std::sort(nodeIds.begin(), nodeIds.end());
+
+    std::unordered_map<NodeId, std::vector<NodeId>> downstream;
+    std::unordered_map<NodeId, std::size_t> indegree;
+
+    std::vector<ConnectionId> connections;
+
+    for (ConnectionId const &connectionId : connectionsFromJson(_scene["connections"].toArray())) {
+        connections.push_back(connectionId);
+
+        downstream[connectionId.outNodeId].push_back(connectionId.inNodeId);
+        ++indegree[connectionId.inNodeId];
+    }
+
+    // Depth first, so a chain of nodes tends to end up in one partition.
+    std::vector<NodeId> ready;
+
+    for (auto it = nodeIds.rbegin(); it != nodeIds.rend(); ++it) {
+        if (indegree[*it] == 0)
+            ready.push_back(*it);
+    }
+
+    std::vector<NodeId> order;
+    order.reserve(nodeIds.size());
+
+    while (!ready.empty()) {
+        NodeId const nodeId = ready.back();
+        ready.pop_back();
+
+        order.push_back(nodeId);
+
+        for (NodeId const next : downstream[nodeId]) {
+            if (--indegree[next] == 0)
+                ready.push_back(next);
+        }
+    }
+
+    if (order.size() != nodeIds.size())
+        throw std::logic_error("A scene with cycles cannot be partitioned");
+
+    std::size_t const count = std::max<std::size_t>(1, std::min(partitionCount, order.size()));
+
+    _nodes.assign(order.empty() ? 0 : count, {});
+    _partitionOf.clear();
+
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        std::size_t const partition = i * count / order.size();
+
+        _nodes[partition].push_back(order[i]);
+        _partitionOf[order[i]] = partition;
+    }
+
+    _cuts.clear();
+
+    for (ConnectionId const &connectionId : connections) {
+        auto const out = _partitionOf.find(connectionId.outNodeId);
+        auto const in = _partitionOf.find(connectionId.inNodeId);
+
+        if (out != _partitionOf.end() && in != _partitionOf.end() && out->second != in->second)
+            _cuts.push_back(connectionId);
+    }
+
+    _prepared = false;
+}
+
+void PartitionedEvaluator::prepare()
+{
+    std::size_t const count = _nodes.size();
+
+    _specs.assign(count, PartitionSpec());
+
+    std::vector<QJsonArray> nodesJson(count);
+    std::vector<QJsonArray> connectionsJson(count);
+
+    for (QJsonValue const nodeJson : _scene["nodes"].toArray()) {
+        NodeId const nodeId = static_cast<NodeId>(nodeJson.toObject()["id"].toInt());
+
+        nodesJson[_partitionOf.at(nodeId)].append(nodeJson);
+    }
+
+    std::map<std::pair<NodeId, PortIndex>, ConnectionId> sources;
+
+    for (ConnectionId const &connectionId : connectionsFromJson(_scene["connections"].toArray())) {
+        sources.emplace(std::make_pair(connectionId.inNodeId, connectionId.inPortIndex),
+                        connectionId);
+
+        auto const out = _partitionOf.find(connectionId.outNodeId);
+        auto const in = _partitionOf.find(connectionId.inNodeId);
+
+        if (out != _partitionOf.end() && in != _partitionOf.end() && out->second == in->second)
+            appendConnectionJson(connectionsJson[out->second], connectionId);
+    }
+
+    for (std::size_t p = 0; p < count; ++p) {
+        _specs[p].scene["nodes"] = nodesJson[p];
+        _specs[p].scene["connections"] = connectionsJson[p];
+    }
+
+    _inputRoutes.clear();
+
+    for (Port const &port : _inputPorts) {
+        std::size_t const p = _partitionOf.at(port.nodeId);
+
+        _inputRoutes.emplace_back(p, _specs[p].inputs.size());
+        _specs[p].inputs.push_back(port);
+    }
+
+    _outputRoutes.clear();
+
+    for (Port port : _outputPorts) {
+        // The connection may be cut, so the value is read at its source.
+        if (port.portType == PortType::In) {
+            auto const source = sources.find(std::make_pair(port.nodeId, port.portIndex));
+
+            if (source != sources.end())
+                port = Port{source->second.outNodeId, PortType::Out, source->second.outPortIndex};
+        }
+
+        std::size_t const p = _partitionOf.at(port.nodeId);
+
+        _outputRoutes.emplace_back(p, _specs[p].outputs.size());
+        _specs[p].outputs.push_back(port);
+    }
+
+    // One output slot per cut source port, however many cuts leave it.
+    std::map<std::pair<NodeId, PortIndex>, std::size_t> sourceSlots;
+
+    _cutRoutes.clear();
+
+    for (ConnectionId const &cut : _cuts) {
+        std::size_t const from = _partitionOf.at(cut.outNodeId);
+        std::size_t const to = _partitionOf.at(cut.inNodeId);
+
+        auto const key = std::make_pair(cut.outNodeId, cut.outPortIndex);
+
+        auto slot = sourceSlots.find(key);
+
+        if (slot == sourceSlots.end()) {
+            slot = sourceSlots.emplace(key, _specs[from].outputs.size()).first;
+            _specs[from].outputs.push_back(Port{cut.outNodeId, PortType::Out, cut.outPortIndex});
+        }
+
+        _cutRoutes.push_back(CutRoute{from, slot->second, to, _specs[to].inputs.size()});
+        _specs[to].inputs.push_back(Port{cut.inNodeId, PortType::In, cut.inPortIndex});
+    }
+
+    _transport->open(_specs);
+
+    _prepared = true;
+}
+
+Values PartitionedEvaluator::run(Values const &inputs)
+{
+    if (!_transport)
+        throw std::logic_error("No transport to run the partitions on");
+
+    if (!_prepared)
+        prepare();
+
+    std::size_t const count = _specs.size();
+
+    std::vector<Values> partitionInputs(count);
+    std::vector<Values> partitionOutputs(count);
+
+    for (std::size_t p = 0; p < count; ++p) {
+        partitionInputs[p].resize(_specs[p].inputs.size());
+    }
+
+    for (std::size_t i = 0; i < std::min(inputs.size(), _inputRoutes.size()); ++i) {
+        partitionInputs[_inputRoutes[i].first][_inputRoutes[i].second] = inputs[i];
+    }
+
+    std::vector<std::set<std::size_t>> upstream(count);
+
+    for (CutRoute const &route : _cutRoutes) {
+        upstream[route.toPartition].insert(route.fromPartition);
+    }
+
+    std::vector<bool> finished(count, false);
+    std::size_t finishedCount = 0;
+
+    while (finishedCount < count) {
+        std::vector<std::size_t> wave;
+
+        for (std::size_t p = 0; p < count; ++p) {
+            if (!finished[p] && upstream[p].empty())
+                wave.push_back(p);
+        }
+
+        // Cuts only lead to later partitions, so a wave is never empty.
+        for (std::size_t const p : wave) {
+            _transport->post(p, partitionInputs[p]);
+        }
+
+        for (std::size_t const p : wave) {
+            partitionOutputs[p] = _transport->wait(p);
+
+            finished[p] = true;
+            ++finishedCount;
+        }
+
+        for (CutRoute const &route : _cutRoutes) {
+            if (!finished[route.fromPartition] || finished[route.toPartition])
+                continue;
+
+            Values const &outputs = partitionOutputs[route.fromPartition];
+
+            if (route.fromSlot < outputs.size())
+                partitionInputs[route.toPartition][route.toSlot] = outputs[route.fromSlot];
+
+            upstream[route.toPartition].erase(route.fromPartition);
+        }
+    }
+
+    Values outputs;
+    outputs.reserve(_outputRoutes.size());
+
+    for (auto const &route : _outputRoutes) {
+        Values const &partitionValues = partitionOutputs[route.first];
+
+        outputs.push_back(route.second < partitionValues.size() ? partitionValues[route.second]
+                                                                : nullptr);
+    }
+
+    return outputs;
+}
+
+void PartitionedEvaluator::collect(Values const &outputs)
+{
+    if (!_model)
+        throw std::logic_error("The evaluator was not made from a model");
+
+    BatchEvaluator::applyInputs(*_model, _outputPorts, outputs);
+}
+
+} // namespace QtNodes
@@ -0,0 +1,458 @@
+#include "ProcessPartitionTransport.hpp"
+
+#include "DataFlowGraphModel.hpp"
+#include "NodeDataCodec.hpp"
+#include "NodeDelegateModelRegistry.hpp"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QProcess>
+#include <QtCore/QSharedMemory>
+#include <QtCore/QUuid>
+#include <QtCore/QtEndian>
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace QtNodes {
+
+using Port = BatchEvaluator::Port;
+using Values = BatchEvaluator::Values;
+
+namespace {
+
+enum class Message : quint8 {
+    Open = 1,
+    Evaluate = 2,
+    Result = 3,
+    Error = 4,
+};
+
+/// Frames larger than this are taken for a broken stream.
+constexpr quint32 MaximumFrameSize = 1u << 30;
+
+/// Reads exactly `size` bytes; a blocking device returns 0 only at its end.
+bool readExactly(QIODevice &device, char *data, qint64 const size, int const timeout)
+{
+    qint64 done = 0;
+
+    while (done < size) {
+        qint64 const read = device.read(data + done, size - done);
+
+        if (read < 0)
+            return false;
+
+        if (read == 0 && !device.waitForReadyRead(timeout))
+            return false;
+
+        done += read;
+    }
+
+    return true;
+}
+
+/// @returns `false` at the end of the stream.
+bool readFrame(QIODevice &device, QByteArray &frame, int const timeout)
+{
+    uchar header[sizeof(quint32)];
+
+    if (!readExactly(device, reinterpret_cast<char *>(header), sizeof(header), timeout))
+        return false;
+
+    quint32 const size = qFromBigEndian<quint32>(header);
+
+    if (size > MaximumFrameSize)
+        throw std::runtime_error("Malformed partition message");
+
+    frame.resize(static_cast<int>(size));
+
+    return readExactly(device, frame.data(), size, timeout);
+}
+
+void writeFrame(QIODevice &device, QByteArray const &frame, int const timeout)
+{
+    uchar header[sizeof(quint32)];
+    qToBigEndian<quint32>(static_cast<quint32>(frame.size()), header);
+
+    if (device.write(reinterpret_cast<char const *>(header), sizeof(header)) < 0
+        || device.write(frame) < 0)
+        throw std::runtime_error("Cannot write a partition message: "
+                                 + device.errorString().toStdString());
+
+    // Hands the bytes to the pipe without waiting for the evaluation.
+    if (auto *process = qobject_cast<QProcess *>(&device))
+        process->waitForBytesWritten(timeout);
+    else if (auto *file = qobject_cast<QFile *>(&device))
+        file->flush();
+}
+
+void writePorts(QDataStream &out, std::vector<Port> const &ports)
+{
+    out << static_cast<quint32>(ports.size());
+
+    for (Port const &port : ports) {
+        out << static_cast<quint32>(port.nodeId) << static_cast<quint8>(port.portType)
+            << static_cast<quint32>(port.portIndex);
+    }
+}
+
+std::vector<Port> readPorts(QDataStream &in)
+{
+    quint32 count = 0;
+    in >> count;
+
+    std::vector<Port> ports;
+
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        quint32 nodeId = 0;
+        quint8 portType = 0;
+        quint32 portIndex = 0;
+
+        in >> nodeId >> portType >> portIndex;
+
+        ports.push_back(Port{static_cast<NodeId>(nodeId),
+                             static_cast<PortType>(portType),
+                             static_cast<PortIndex>(portIndex)});
+    }
+
+    return ports;
+}
+
+/// Writes the encoded values to `memory` while they fit, inline otherwise.
+void writeValues(QDataStream &out, Values const &values, QSharedMemory *memory)
+{
+    out << static_cast<quint32>(values.size());
+
+    quint64 offset = 0;
+
+    if (memory)
+        memory->lock();
+
+    for (auto const &value : values) {
+        out << static_cast<bool>(value);
+
+        if (!value)
+            continue;
+
+        QByteArray const bytes = NodeDataCodec::encode(*value);
+
+        out << value->type().id;
+
+        bool const shared = memory && offset + bytes.size() <= quint64(memory->size());
+
+        out << shared;
+
+        if (shared) {
+            std::memcpy(static_cast<char *>(memory->data()) + offset, bytes.constData(), bytes.size());
+
+            out << offset << static_cast<quint64>(bytes.size());
+
+            offset += bytes.size();
+        } else {
+            out << bytes;
+        }
+    }
+
+    if (memory)
+        memory->unlock();
+}
+
+/// Decodes shared values in place, the segment is only read during the call.
+Values readValues(QDataStream &in, QSharedMemory *memory)
+{
+    quint32 count = 0;
+    in >> count;
+
+    Values values;
+
+    if (memory)
+        memory->lock();
+
+    try {
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+            bool present = false;
+            in >> present;
+
+            if (!present) {
+                values.push_back(nullptr);
+                continue;
+            }
+
+            QString typeId;
+            bool shared = false;
+
+            in >> typeId >> shared;
+
+            if (shared) {
+                quint64 offset = 0;
+                quint64 size = 0;
+
+                in >> offset >> size;
+
+                if (!memory || offset + size > quint64(memory->size()))
+                    throw std::runtime_error("Malformed partition message");
+
+                QByteArray const view = QByteArray::fromRawData(
+                    static_cast<char const *>(memory->constData()) + offset, static_cast<int>(size));
+
+                values.push_back(NodeDataCodec::decode(typeId, view));
+            } else {
+                QByteArray bytes;
+                in >> bytes;
+
+                values.push_back(NodeDataCodec::decode(typeId, bytes));
+            }
+        }
+    } catch (...) {
+        if (memory)
+            memory->unlock();
+
+        throw;
+    }
+
+    if (memory)
+        memory->unlock();
+
+    if (in.status() != QDataStream::Ok)
+        throw std::runtime_error("Malformed partition message");
+
+    return values;
+}
+
+QByteArray errorFrame(QString const &reason)
+{
+    QByteArray frame;
+
+    QDataStream out(&frame, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_11);
+
+    out << static_cast<quint8>(Message::Error) << reason;
+
+    return frame;
+}
+
+} // namespace
+
+struct ProcessPartitionTransport::Worker
+{
+    ~Worker()
+    {
+        process.closeWriteChannel();
+
+        if (!process.waitForFinished(3000))
+            process.kill();
+
+        process.waitForFinished();
+    }
+
+    QProcess process;
+
+    std::unique_ptr<QSharedMemory> memory;
+};
+
+ProcessPartitionTransport::ProcessPartitionTransport(QString program, QStringList arguments)
+    : _program(std::move(program))
+    , _arguments(std::move(arguments))
+    , _sharedMemory(true)
+    , _sharedMemorySize(16 * 1024 * 1024)
+    , _timeout(-1)
+{}
+
+ProcessPartitionTransport::~ProcessPartitionTransport() = default;
+
+void ProcessPartitionTransport::open(std::vector<PartitionSpec> const &partitions)
+{
+    _workers.clear();
+    _workers.reserve(partitions.size());
+
+    for (PartitionSpec const &spec : partitions) {
+        auto worker = std::make_unique<Worker>();
+
+        worker->process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        worker->process.start(_program, _arguments);
+
+        if (!worker->process.waitForStarted(_timeout))
+            throw std::runtime_error("Cannot start the partition worker "
+                                     + _program.toStdString() + ": "
+                                     + worker->process.errorString().toStdString());
+
+        QString key;
+
+        if (_sharedMemory) {
+            key = QStringLiteral("QtNodes-partition-") + QUuid::createUuid().toString();
+
+            worker->memory = std::make_unique<QSharedMemory>(key);
+
+            if (!worker->memory->create(static_cast<int>(_sharedMemorySize)))
+                throw std::runtime_error("Cannot create shared memory for a partition: "
+                                         + worker->memory->errorString().toStdString());
+        }
+
+        QByteArray frame;
+
+        QDataStream out(&frame, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_11);
+
+        out << static_cast<quint8>(Message::Open)
+            << QJsonDocument(spec.scene).toJson(QJsonDocument::Compact);
+
+        writePorts(out, spec.inputs);
+        writePorts(out, spec.outputs);
+
+        out << key;
+
+        writeFrame(worker->process, frame, _timeout);
+
+        _workers.push_back(std::move(worker));
+    }
+}
+
+void ProcessPartitionTransport::post(std::size_t const partition, Values const &inputs)
+{
+    Worker &worker = *_workers.at(partition);
+
+    QByteArray frame;
+
+    QDataStream out(&frame, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_11);
+
+    out << static_cast<quint8>(Message::Evaluate);
+
+    writeValues(out, inputs, worker.memory.get());
+
+    writeFrame(worker.process, frame, _timeout);
+}
+
+Values ProcessPartitionTransport::wait(std::size_t const partition)
+{
+    Worker &worker = *_workers.at(partition);
+
+    QByteArray frame;
+
+    if (!readFrame(worker.process, frame, _timeout))
+        throw std::runtime_error("The partition worker stopped answering: "
+                                 + worker.process.errorString().toStdString());
+
+    QDataStream in(frame);
+    in.setVersion(QDataStream::Qt_5_11);
+
+    quint8 kind = 0;
+    in >> kind;
+
+    if (kind == static_cast<quint8>(Message::Error)) {
+        QString reason;
+        in >> reason;
+
+        throw std::runtime_error(reason.toStdString());
+    }
+
+    if (kind != static_cast<quint8>(Message::Result))
+        throw std::runtime_error("Malformed partition message");
+
+    return readValues(in, worker.memory.get());
+}
+
+int PartitionWorker::exec(std::shared_ptr<NodeDelegateModelRegistry> registry)
+{
+    QFile input;
+    QFile output;
+
+    if (!input.open(stdin, QIODevice::ReadOnly | QIODevice::Unbuffered)
+        || !output.open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered))
+        return 1;
+
+    std::unique_ptr<DataFlowGraphModel> model;
+    std::unique_ptr<QSharedMemory> memory;
+
+    std::vector<Port> inputPorts;
+    std::vector<Port> outputPorts;
+
+    QString openError;
+
+    QByteArray frame;
+
+    try {
+        while (readFrame(input, frame, -1)) {
+            QDataStream in(frame);
+            in.setVersion(QDataStream::Qt_5_11);
+
+            quint8 kind = 0;
+            in >> kind;
+
+            if (kind == static_cast<quint8>(Message::Open)) {
+                QByteArray scene;
+                QString key;
+
+                in >> scene;
+                inputPorts = readPorts(in);
+                outputPorts = readPorts(in);
+                in >> key;
+
+                openError.clear();
+                memory.reset();
+
+                try {
+                    model = std::make_unique<DataFlowGraphModel>(registry);
+                    model->load(QJsonDocument::fromJson(scene).object());
+                } catch (std::exception const &e) {
+                    model.reset();
+                    openError = QString::fromUtf8(e.what());
+                }
+
+                if (!key.isEmpty()) {
+                    memory = std::make_unique<QSharedMemory>(key);
+
+                    if (!memory->attach())
+                        openError = memory->errorString();
+                }
+
+                continue;
+            }
+
+            QByteArray reply;
+
+            try {
+                if (kind != static_cast<quint8>(Message::Evaluate))
+                    throw std::runtime_error("Malformed partition message");
+
+                if (!openError.isEmpty())
+                    throw std::runtime_error(openError.toStdString());
+
+                if (!model)
+                    throw std::runtime_error("No partition opened");
+
+                Values const values = readValues(in, memory.get());
+
+                BatchEvaluator::applyInputs(*model, inputPorts, values);
+
+                model->processPendingPropagation();
+
+                Values const results = BatchEvaluator::readOutputs(*model, outputPorts);
+
+                QDataStream out(&reply, QIODevice::WriteOnly);
+                out.setVersion(QDataStream::Qt_5_11);
+
+                out << static_cast<quint8>(Message::Result);
+
+                writeValues(out, results, memory.get());
+            } catch (std::exception const &e) {
+                reply = errorFrame(QString::fromUtf8(e.what()));
+            }
+
+            writeFrame(output, reply, -1);
+        }
+    } catch (std::exception const &) {
+        // A broken stream, the coordinator sees the worker stop.
+        return 1;
+    }
+
+    return 0;
+}
+
+} // namespace QtNodes
@@ -0,0 +1,359 @@
+#include "ProjectLoader.hpp"
+
+#include "BasicGraphicsScene.hpp"
+#include "ConnectionIdUtils.hpp"
+#include "DataFlowGraphModel.hpp"
+#include "SceneJson.hpp"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QRunnable>
+#include <QtCore/QTimer>
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+
+namespace QtNodes {
+
+namespace {
+
+/// Nodes of the first chunk, before any chunk was timed.
+constexpr std::size_t InitialChunkSize = 64;
+
+class ParseTask : public QRunnable
+{
+public:
+    using Parsed = ProjectLoader::Parsed;
+
+    using Done = std::function<void(std::shared_ptr<Parsed>)>;
+
+    ParseTask(QString fileName, QRectF const &visibleRect, CancellationToken token, Done done)
+        : _fileName(std::move(fileName))
+        , _visibleRect(visibleRect)
+        , _token(std::move(token))
+        , _done(std::move(done))
+    {}
+
+    void run() override
+    {
+        auto parsed = std::make_shared<Parsed>();
+
+        QFile file(_fileName);
+
+        if (!file.open(QIODevice::ReadOnly)) {
+            parsed->error = file.errorString();
+            finish(std::move(parsed));
+            return;
+        }
+
+        if (DataFlowGraphModel::isBinaryScene(file.peek(sizeof(quint32)))) {
+            parsed->binary = true;
+            finish(std::move(parsed));
+            return;
+        }
+
+        QByteArray const wholeFile = file.readAll();
+
+        if (_token.isCancelled())
+            return;
+
+        QJsonParseError error;
+        QJsonObject const json = QJsonDocument::fromJson(wholeFile, &error).object();
+
+        if (error.error != QJsonParseError::NoError) {
+            parsed->error = error.errorString();
+            finish(std::move(parsed));
+            return;
+        }
+
+        if (_token.isCancelled())
+            return;
+
+        order(json, *parsed);
+
+        finish(std::move(parsed));
+    }
+
+private:
+    /// Nodes nearest to the visible area first, connections after their later node.
+    void order(QJsonObject const &json, Parsed &parsed) const
+    {
+        QJsonArray const nodesJsonArray = json["nodes"].toArray();
+
+        parsed.nodes.reserve(nodesJsonArray.size());
+
+        for (QJsonValue const nodeValue : nodesJsonArray) {
+            parsed.nodes.push_back(nodeValue.toObject());
+        }
+
+        if (!_visibleRect.isEmpty()) {
+            QPointF const center = _visibleRect.center();
+
+            std::vector<std::pair<qreal, std::size_t>> distances(parsed.nodes.size());
+
+            for (std::size_t i = 0; i < parsed.nodes.size(); ++i) {
+                QPointF const delta = pointFromJson(parsed.nodes[i]["position"]) - center;
+
+                distances[i] = {QPointF::dotProduct(delta, delta), i};
+            }
+
+            std::stable_sort(distances.begin(),
+                             distances.end(),
+                             [](auto const &a, auto const &b) { return a.first < b.first; });
+
+            std::vector<QJsonObject> ordered;
+            ordered.reserve(parsed.nodes.size());
+
+            for (auto const &entry : distances) {
+                ordered.push_back(std::move(parsed.nodes[entry.second]));
+            }
+
+            parsed.nodes = std::move(ordered);
+        }
+
+        std::unordered_map<NodeId, std::size_t> rank;
+        rank.reserve(parsed.nodes.size());
+
+        for (std::size_t i = 0; i < parsed.nodes.size(); ++i) {
+            rank.emplace(static_cast<NodeId>(parsed.nodes[i]["id"].toInt()), i);
+        }
+
+        std::vector<ConnectionId> const connectionIds = connectionsFromJson(
+            json["connections"].toArray());
+
+        parsed.connections.reserve(connectionIds.size());
+
+        for (ConnectionId const &connId : connectionIds) {
+            auto const outIt = rank.find(connId.outNodeId);
+            auto const inIt = rank.find(connId.inNodeId);
+
+            // Dangling connections are left to `load()` along with the last chunk.
+            std::size_t const later = outIt == rank.end() || inIt == rank.end()
+                                          ? parsed.nodes.size()
+                                          : std::max(outIt->second, inIt->second);
+
+            parsed.connections.emplace_back(later, connId);
+        }
+
+        std::stable_sort(parsed.connections.begin(),
+                         parsed.connections.end(),
+                         [](auto const &a, auto const &b) { return a.first < b.first; });
+    }
+
+    void finish(std::shared_ptr<Parsed> parsed)
+    {
+        if (!_token.isCancelled())
+            _done(std::move(parsed));
+    }
+
+private:
+    QString _fileName;
+
+    QRectF _visibleRect;
+
+    CancellationToken _token;
+
+    Done _done;
+};
+
+} // namespace
+
+ProjectLoader::ProjectLoader(DataFlowGraphModel &model,
+                             BasicGraphicsScene const *scene,
+                             QObject *parent)
+    : QObject(parent)
+    , _model(model)
+    , _scene(scene)
+    , _frameBudget(8)
+    , _running(false)
+    , _generation(0)
+    , _nextNode(0)
+    , _nextConnection(0)
+    , _chunkSize(InitialChunkSize)
+{
+    _pool.setMaxThreadCount(1);
+}
+
+ProjectLoader::~ProjectLoader()
+{
+    _parseToken.cancel();
+
+    // A finished parse posts its result to `this`; none may outlive it.
+    _pool.waitForDone();
+}
+
+void ProjectLoader::start(QString const &fileName)
+{
+    if (_running)
+        cancel();
+
+    _running = true;
+    _fileName = fileName;
+    _parseToken = CancellationToken();
+
+    QRectF const visibleRect = _scene ? _scene->visibleSceneRect() : QRectF();
+
+    QPointer<ProjectLoader> guard(this);
+
+    std::uint64_t const generation = ++_generation;
+
+    auto done = [guard, generation](std::shared_ptr<Parsed> parsed) {
+        QMetaObject::invokeMethod(
+            QCoreApplication::instance(),
+            [guard, generation, parsed]() {
+                if (guard)
+                    guard->onParsed(generation, parsed);
+            },
+            Qt::QueuedConnection);
+    };
+
+    _pool.start(new ParseTask(fileName, visibleRect, _parseToken, std::move(done)));
+}
+
+void ProjectLoader::cancel()
+{
+    if (!_running)
+        return;
+
+    _parseToken.cancel();
+
+    ++_generation;
+
+    _running = false;
+
+    // Only a graph being restored was touched.
+    if (_parsed) {
+        _parsed.reset();
+        _model.clear();
+    }
+
+    Q_EMIT cancelled();
+}
+
+void ProjectLoader::onParsed(std::uint64_t const generation, std::shared_ptr<Parsed> parsed)
+{
+    if (generation != _generation)
+        return;
+
+    if (!parsed->error.isEmpty()) {
+        _running = false;
+
+        Q_EMIT failed(parsed->error);
+        return;
+    }
+
+    _model.clear();
+
+    if (parsed->binary) {
+        _running = false;
+
+        try {
+            if (!_model.loadBinaryFile(_fileName)) {
+                fail(tr("Invalid binary scene"));
+                return;
+            }
+        } catch (std::exception const &e) {
+            fail(QString::fromLocal8Bit(e.what()));
+            return;
+        }
+
+        std::size_t const total = _model.allNodeIds().size() + _model.allConnectionIds().size();
+
+        Q_EMIT progress(total, total);
+        Q_EMIT finished();
+        return;
+    }
+
+    _parsed = std::move(parsed);
+    _nextNode = 0;
+    _nextConnection = 0;
+    _chunkSize = InitialChunkSize;
+
+    restoreChunk();
+}
+
+void ProjectLoader::restoreChunk()
+{
+    if (!_running || !_parsed)
+        return;
+
+    Parsed &parsed = *_parsed;
+
+    std::size_t const nodeEnd = std::min(parsed.nodes.size(), _nextNode + _chunkSize);
+
+    // The last chunk also takes the dangling connections.
+    std::size_t const rankLimit = nodeEnd == parsed.nodes.size()
+                                      ? std::numeric_limits<std::size_t>::max()
+                                      : nodeEnd;
+
+    QJsonArray nodesJsonArray;
+
+    for (std::size_t i = _nextNode; i < nodeEnd; ++i) {
+        nodesJsonArray.append(parsed.nodes[i]);
+    }
+
+    QJsonArray connectionJsonArray;
+
+    while (_nextConnection < parsed.connections.size()
+           && parsed.connections[_nextConnection].first < rankLimit) {
+        appendConnectionJson(connectionJsonArray, parsed.connections[_nextConnection].second);
+        ++_nextConnection;
+    }
+
+    QJsonObject chunk;
+    chunk["nodes"] = nodesJsonArray;
+    chunk["connections"] = connectionJsonArray;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    try {
+        _model.load(chunk);
+    } catch (std::exception const &e) {
+        fail(QString::fromLocal8Bit(e.what()));
+        return;
+    }
+
+    qint64 const elapsed = std::max<qint64>(1, timer.elapsed());
+
+    // Aim the next chunk at the budget, growing at most twofold per turn.
+    std::size_t const chunkNodes = std::max<std::size_t>(1, nodeEnd - _nextNode);
+
+    auto const fitting = static_cast<std::size_t>(chunkNodes * std::max(1, _frameBudget) / elapsed);
+
+    _chunkSize = std::clamp<std::size_t>(fitting, 1, 2 * chunkNodes);
+
+    _nextNode = nodeEnd;
+
+    Q_EMIT progress(_nextNode + _nextConnection, parsed.nodes.size() + parsed.connections.size());
+
+    if (_nextNode == parsed.nodes.size() && _nextConnection == parsed.connections.size()) {
+        _parsed.reset();
+        _running = false;
+
+        Q_EMIT finished();
+        return;
+    }
+
+    // Lets the scene paint the chunk and the user scroll before the next one.
+    QTimer::singleShot(0, this, &ProjectLoader::restoreChunk);
+}
+
+void ProjectLoader::fail(QString const &reason)
+{
+    _parsed.reset();
+    _running = false;
+
+    _model.clear();
+
+    Q_EMIT failed(reason);
+}
+
+} // namespace QtNodes
@@ -0,0 +1,183 @@
+#include "PropagationTracer.hpp"
+
+#include "NodeDelegateModel.hpp"
+
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+
+namespace QtNodes {
+
+PropagationTracer::Span::Span(PropagationTracer *tracer,
+                              char const *name,
+                              NodeId const nodeId,
+                              NodeDelegateModel const *delegate,
+                              PortType const portType,
+                              PortIndex const portIndex)
+    : _tracer(tracer)
+{
+    if (!_tracer)
+        return;
+
+    _event.phase = Phase::Complete;
+    _event.name = name;
+    _event.nodeId = nodeId;
+    _event.typeName = delegate ? delegate->name() : QString();
+    _event.portType = portType;
+    _event.portIndex = portIndex;
+    _event.start = _tracer->now();
+    _event.duration = 0;
+    _event.thread = 0;
+}
+
+PropagationTracer::Span::~Span()
+{
+    if (!_tracer)
+        return;
+
+    _event.duration = _tracer->now() - _event.start;
+
+    _tracer->record(std::move(_event));
+}
+
+PropagationTracer::PropagationTracer(std::size_t const capacity)
+    : _capacity(capacity)
+    , _dropped(0)
+{
+    _clock.start();
+}
+
+void PropagationTracer::record(Event event)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (_events.size() >= _capacity) {
+        ++_dropped;
+        return;
+    }
+
+    event.thread = threadNumber();
+
+    _events.push_back(std::move(event));
+}
+
+void PropagationTracer::recordAsync(Phase const phase,
+                                    char const *name,
+                                    NodeId const nodeId,
+                                    NodeDelegateModel const *delegate)
+{
+    record(Event{phase,
+                 name,
+                 nodeId,
+                 delegate ? delegate->name() : QString(),
+                 PortType::None,
+                 InvalidPortIndex,
+                 now(),
+                 0,
+                 0});
+}
+
+std::vector<PropagationTracer::Event> PropagationTracer::events() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    return _events;
+}
+
+std::size_t PropagationTracer::droppedEvents() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    return _dropped;
+}
+
+void PropagationTracer::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _events.clear();
+    _dropped = 0;
+}
+
+QJsonObject PropagationTracer::toChromeTrace() const
+{
+    QJsonArray traceEvents;
+
+    for (Event const &event : events()) {
+        QJsonObject json;
+        json["name"] = QString::fromLatin1(event.name);
+        json["pid"] = 1;
+        json["tid"] = event.thread;
+
+        // Microseconds, fractions keep the nanosecond resolution.
+        json["ts"] = event.start / 1000.0;
+
+        switch (event.phase) {
+        case Phase::Complete:
+            json["ph"] = QStringLiteral("X");
+            json["cat"] = QStringLiteral("propagation");
+            json["dur"] = event.duration / 1000.0;
+            break;
+
+        case Phase::AsyncBegin:
+        case Phase::AsyncEnd:
+            json["ph"] = event.phase == Phase::AsyncBegin ? QStringLiteral("b")
+                                                          : QStringLiteral("e");
+            json["cat"] = QStringLiteral("compute");
+            json["id"] = QString::number(event.nodeId);
+            break;
+        }
+
+        QJsonObject args;
+
+        if (event.nodeId != InvalidNodeId)
+            args["nodeId"] = static_cast<qint64>(event.nodeId);
+
+        if (!event.typeName.isEmpty())
+            args["type"] = event.typeName;
+
+        if (event.portType != PortType::None) {
+            args["portType"] = event.portType == PortType::In ? QStringLiteral("in")
+                                                              : QStringLiteral("out");
+            args["port"] = static_cast<qint64>(event.portIndex);
+        }
+
+        json["args"] = args;
+
+        traceEvents.append(json);
+    }
+
+    QJsonObject trace;
+    trace["traceEvents"] = traceEvents;
+    trace["displayTimeUnit"] = QStringLiteral("ms");
+
+    return trace;
+}
+
+bool PropagationTracer::writeChromeTrace(QString const &fileName) const
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    return file.write(QJsonDocument(toChromeTrace()).toJson(QJsonDocument::Compact)) >= 0;
+}
+
+int PropagationTracer::threadNumber()
+{
+    auto const id = std::this_thread::get_id();
+
+    auto it = _threads.find(id);
+
+    if (it != _threads.end())
+        return it->second;
+
+    int const number = static_cast<int>(_threads.size()) + 1;
+
+    _threads.emplace(id, number);
+
+    return number;
+}
+
+} // namespace QtNodes
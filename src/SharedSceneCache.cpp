@@ -0,0 +1,134 @@
+#include "SharedSceneCache.hpp"
+
+#include "AbstractGraphModel.hpp"
+#include "DefaultHorizontalNodeGeometry.hpp"
+#include "DefaultVerticalNodeGeometry.hpp"
+
+#include <algorithm>
+
+namespace QtNodes {
+
+bool NodeRenderKey::operator==(NodeRenderKey const &other) const
+{
+    return size == other.size && qFuzzyCompare(scale, other.scale)
+           && styleRevision == other.styleRevision && connectedPorts == other.connectedPorts
+           && selected == other.selected && hovered == other.hovered
+           && computing == other.computing && painterType == other.painterType
+           && shadowMode == other.shadowMode && orientation == other.orientation
+           && computeHeatScale == other.computeHeatScale;
+}
+
+SharedSceneCache::SharedSceneCache(AbstractGraphModel &graphModel, QObject *parent)
+    : QObject(parent)
+    , _graphModel(graphModel)
+{
+    connect(&_graphModel, &AbstractGraphModel::nodeDeleted, this, [this](NodeId const nodeId) {
+        invalidateNode(nodeId);
+
+        for (auto &geometry : _geometries) {
+            if (geometry)
+                geometry->invalidateLayout(nodeId);
+        }
+    });
+
+    connect(&_graphModel, &AbstractGraphModel::modelReset, this, &SharedSceneCache::clear);
+}
+
+SharedSceneCache::~SharedSceneCache() = default;
+
+AbstractNodeGeometry &SharedSceneCache::nodeGeometry(Qt::Orientation const orientation)
+{
+    std::unique_ptr<AbstractNodeGeometry> &geometry
+        = _geometries[orientation == Qt::Horizontal ? 0 : 1];
+
+    if (!geometry) {
+        if (orientation == Qt::Horizontal)
+            geometry = std::make_unique<DefaultHorizontalNodeGeometry>(_graphModel);
+        else
+            geometry = std::make_unique<DefaultVerticalNodeGeometry>(_graphModel);
+    }
+
+    return *geometry;
+}
+
+QPixmap SharedSceneCache::nodeImage(NodeId const nodeId, NodeRenderKey const &key)
+{
+    auto it = _images.find(nodeId);
+
+    if (it == _images.end())
+        return QPixmap();
+
+    Images &images = it->second;
+
+    auto image = std::find_if(images.begin(), images.end(), [&key](auto const &entry) {
+        return entry.first == key;
+    });
+
+    if (image == images.end())
+        return QPixmap();
+
+    std::rotate(images.begin(), image, image + 1);
+
+    return images.front().second;
+}
+
+void SharedSceneCache::insertNodeImage(NodeId const nodeId,
+                                       NodeRenderKey const &key,
+                                       QPixmap const &image)
+{
+    Images &images = _images[nodeId];
+
+    auto it = std::find_if(images.begin(), images.end(), [&key](auto const &entry) {
+        return entry.first == key;
+    });
+
+    if (it != images.end())
+        images.erase(it);
+    else if (images.size() >= ImagesPerNode)
+        images.pop_back();
+
+    images.emplace(images.begin(), key, image);
+}
+
+void SharedSceneCache::invalidateNode(NodeId const nodeId)
+{
+    _images.erase(nodeId);
+}
+
+void SharedSceneCache::clear()
+{
+    _images.clear();
+
+    for (auto &geometry : _geometries) {
+        if (geometry)
+            geometry->invalidateLayouts();
+    }
+}
+
+std::size_t SharedSceneCache::imageCount() const
+{
+    std::size_t count = 0;
+
+    for (auto const &entry : _images)
+        count += entry.second.size();
+
+    return count;
+}
+
+std::size_t SharedSceneCache::imageBytes() const
+{
+    std::size_t bytes = 0;
+
+    for (auto const &entry : _images) {
+        for (auto const &image : entry.second) {
+            QPixmap const &pixmap = image.second;
+
+            bytes += static_cast<std::size_t>(pixmap.width()) * pixmap.height()
+                     * pixmap.depth() / 8;
+        }
+    }
+
+    return bytes;
+}
+
+} // namespace QtNodes
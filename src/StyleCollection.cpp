@@ -1,38 +1,98 @@
 #include "StyleCollection.hpp"
 
+#include <atomic>
+#include <utility>
+
 using QtNodes::ConnectionStyle;
 using QtNodes::GraphicsViewStyle;
 using QtNodes::NodeStyle;
 using QtNodes::StyleCollection;
+using QtNodes::StyleContext;
+
+StyleCollection::StyleCollection()
+    : _context(std::make_shared<StyleContext const>())
+{}
 
 NodeStyle const &StyleCollection::nodeStyle()
 {
-    return instance()._nodeStyle;
+    return current().nodeStyle();
 }
 
 ConnectionStyle const &StyleCollection::connectionStyle()
 {
-    return instance()._connectionStyle;
+    return current().connectionStyle();
 }
 
 GraphicsViewStyle const &StyleCollection::flowViewStyle()
 {
-    return instance()._flowViewStyle;
+    return current().viewStyle();
+}
+
+std::shared_ptr<NodeStyle const> StyleCollection::sharedNodeStyle()
+{
+    return current().sharedNodeStyle();
+}
+
+unsigned int StyleCollection::revision()
+{
+    return current().revision();
+}
+
+std::shared_ptr<StyleContext const> StyleCollection::context()
+{
+    return std::atomic_load(&instance()._context);
+}
+
+StyleContext const &StyleCollection::current()
+{
+    // Still owned by `_context` or `_retired` once the copy is gone.
+    return *context();
 }
 
 void StyleCollection::setNodeStyle(NodeStyle nodeStyle)
 {
-    instance()._nodeStyle = nodeStyle;
+    auto &collection = instance();
+
+    std::lock_guard<std::mutex> lock(collection._mutex);
+
+    collection.swap(collection._context->withNodeStyle(std::move(nodeStyle)));
 }
 
 void StyleCollection::setConnectionStyle(ConnectionStyle connectionStyle)
 {
-    instance()._connectionStyle = connectionStyle;
+    auto &collection = instance();
+
+    std::lock_guard<std::mutex> lock(collection._mutex);
+
+    collection.swap(collection._context->withConnectionStyle(std::move(connectionStyle)));
 }
 
 void StyleCollection::setGraphicsViewStyle(GraphicsViewStyle flowViewStyle)
 {
-    instance()._flowViewStyle = flowViewStyle;
+    auto &collection = instance();
+
+    std::lock_guard<std::mutex> lock(collection._mutex);
+
+    collection.swap(collection._context->withViewStyle(std::move(flowViewStyle)));
+}
+
+void StyleCollection::setContext(std::shared_ptr<StyleContext const> context)
+{
+    if (!context)
+        return;
+
+    auto &collection = instance();
+
+    std::lock_guard<std::mutex> lock(collection._mutex);
+
+    collection.swap(std::move(context));
+}
+
+void StyleCollection::swap(std::shared_ptr<StyleContext const> context)
+{
+    _retired.push_back(std::atomic_load(&_context));
+
+    std::atomic_store(&_context, std::move(context));
 }
 
 StyleCollection &StyleCollection::instance()
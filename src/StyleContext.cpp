@@ -0,0 +1,60 @@
+#include "StyleContext.hpp"
+
+#include <atomic>
+#include <utility>
+
+namespace QtNodes {
+
+namespace {
+
+unsigned int nextRevision()
+{
+    static std::atomic<unsigned int> revision{0};
+
+    return ++revision;
+}
+
+} // namespace
+
+StyleContext::StyleContext()
+    : StyleContext(NodeStyle(), ConnectionStyle(), GraphicsViewStyle())
+{}
+
+StyleContext::StyleContext(NodeStyle nodeStyle,
+                           ConnectionStyle connectionStyle,
+                           GraphicsViewStyle viewStyle)
+    : StyleContext(std::make_shared<NodeStyle const>(std::move(nodeStyle)),
+                   std::move(connectionStyle),
+                   std::move(viewStyle))
+{}
+
+StyleContext::StyleContext(std::shared_ptr<NodeStyle const> nodeStyle,
+                           ConnectionStyle connectionStyle,
+                           GraphicsViewStyle viewStyle)
+    : _nodeStyle(std::move(nodeStyle))
+    , _connectionStyle(std::move(connectionStyle))
+    , _viewStyle(std::move(viewStyle))
+    , _revision(nextRevision())
+{}
+
+std::shared_ptr<StyleContext const> StyleContext::withNodeStyle(NodeStyle nodeStyle) const
+{
+    return std::make_shared<StyleContext const>(std::move(nodeStyle),
+                                                _connectionStyle,
+                                                _viewStyle);
+}
+
+std::shared_ptr<StyleContext const> StyleContext::withConnectionStyle(
+    ConnectionStyle connectionStyle) const
+{
+    return std::shared_ptr<StyleContext const>(
+        new StyleContext(_nodeStyle, std::move(connectionStyle), _viewStyle));
+}
+
+std::shared_ptr<StyleContext const> StyleContext::withViewStyle(GraphicsViewStyle viewStyle) const
+{
+    return std::shared_ptr<StyleContext const>(
+        new StyleContext(_nodeStyle, _connectionStyle, std::move(viewStyle)));
+}
+
+} // namespace QtNodes
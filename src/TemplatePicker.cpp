@@ -0,0 +1,86 @@
+#include "TemplatePicker.hpp"
+
+#include <QtCore/QSortFilterProxyModel>
+#include <QtWidgets/QLabel>
+#include <QtWidgets/QLineEdit>
+#include <QtWidgets/QListView>
+#include <QtWidgets/QPushButton>
+#include <QtWidgets/QVBoxLayout>
+
+namespace QtNodes {
+
+TemplatePicker::TemplatePicker(QAbstractItemModel *templates, QWidget *parent)
+    : QDialog(parent)
+    , _filter(new QLineEdit())
+    , _filteredTemplates(new QSortFilterProxyModel(this))
+    , _list(new QListView())
+{
+    setWindowTitle("Select template");
+    setModal(true);
+
+    _filteredTemplates->setSourceModel(templates);
+    _filteredTemplates->setFilterCaseSensitivity(Qt::CaseInsensitive);
+
+    _filter->setPlaceholderText("Filter");
+    _filter->setClearButtonEnabled(true);
+
+    _list->setModel(_filteredTemplates);
+    _list->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    _list->setSelectionMode(QAbstractItemView::SingleSelection);
+
+    // Thousands of names of one line each.
+    _list->setUniformItemSizes(true);
+
+    auto okButton = new QPushButton("OK");
+    okButton->setDefault(true);
+
+    auto layout = new QVBoxLayout(this);
+    layout->addWidget(new QLabel("Select template:"));
+    layout->addWidget(_filter);
+    layout->addWidget(_list);
+    layout->addWidget(okButton);
+
+    connect(_filter,
+            &QLineEdit::textChanged,
+            _filteredTemplates,
+            &QSortFilterProxyModel::setFilterFixedString);
+
+    connect(_list, &QListView::doubleClicked, this, &QDialog::accept);
+
+    connect(okButton, &QPushButton::clicked, this, &QDialog::accept);
+}
+
+void TemplatePicker::reset(QString const &current)
+{
+    _filter->clear();
+    _filter->setFocus();
+
+    _list->clearSelection();
+    _list->setCurrentIndex(QModelIndex());
+
+    if (current.isEmpty())
+        return;
+
+    QModelIndexList const matches = _filteredTemplates->match(_filteredTemplates->index(0, 0),
+                                                              Qt::DisplayRole,
+                                                              current,
+                                                              1,
+                                                              Qt::MatchExactly);
+
+    if (!matches.isEmpty()) {
+        _list->setCurrentIndex(matches.front());
+        _list->scrollTo(matches.front());
+    }
+}
+
+QString TemplatePicker::selectedTemplate() const
+{
+    QModelIndex const current = _list->currentIndex();
+
+    if (!current.isValid())
+        return QString();
+
+    return current.data(Qt::DisplayRole).toString();
+}
+
+} // namespace QtNodes
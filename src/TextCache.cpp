@@ -0,0 +1,98 @@
+#include "TextCache.hpp"
+
+#include <QtCore/QCoreApplication>
+
+namespace QtNodes {
+
+constexpr std::size_t TextCache::Capacity;
+
+TextCache &TextCache::instance()
+{
+    // Worker threads painting images get caches of their own; theirs go
+    // with the thread.
+    thread_local TextCache cache;
+
+    static bool const cleanedUp = []() {
+        // Fonts must not outlive the application. Post routines run in the
+        // GUI thread, so this clears its cache.
+        qAddPostRoutine([]() { TextCache::instance().clear(); });
+        return true;
+    }();
+
+    Q_UNUSED(cleanedUp);
+
+    return cache;
+}
+
+int TextCache::horizontalAdvance(QFont const &font, QString const &text)
+{
+    return measured(fontEntry(font), text).advance;
+}
+
+QRect TextCache::boundingRect(QFont const &font, QString const &text)
+{
+    return measured(fontEntry(font), text).boundingRect;
+}
+
+int TextCache::ascent(QFont const &font)
+{
+    return fontEntry(font).metrics.ascent();
+}
+
+int TextCache::height(QFont const &font)
+{
+    return fontEntry(font).metrics.height();
+}
+
+QStaticText const &TextCache::staticText(QFont const &font, QString const &text)
+{
+    Entry &entry = measured(fontEntry(font), text);
+
+    if (!entry.prepared) {
+        entry.staticText.setText(text);
+        entry.staticText.setTextFormat(Qt::PlainText);
+        entry.staticText.setPerformanceHint(QStaticText::AggressiveCaching);
+        entry.staticText.prepare(QTransform(), font);
+        entry.prepared = true;
+    }
+
+    return entry.staticText;
+}
+
+void TextCache::clear()
+{
+    _fonts.clear();
+}
+
+TextCache::FontEntry &TextCache::fontEntry(QFont const &font)
+{
+    for (auto const &fontEntry : _fonts) {
+        if (fontEntry->font == font)
+            return *fontEntry;
+    }
+
+    _fonts.push_back(std::make_unique<FontEntry>(font));
+
+    return *_fonts.back();
+}
+
+TextCache::Entry &TextCache::measured(FontEntry &fontEntry, QString const &text)
+{
+    auto it = fontEntry.entries.find(text);
+
+    if (it != fontEntry.entries.end())
+        return it.value();
+
+    // Generated captions could grow it without bound.
+    if (fontEntry.entries.size() >= static_cast<int>(Capacity))
+        fontEntry.entries.clear();
+
+    Entry &entry = fontEntry.entries[text];
+
+    entry.advance = fontEntry.metrics.horizontalAdvance(text);
+    entry.boundingRect = fontEntry.metrics.boundingRect(text);
+
+    return entry;
+}
+
+} // namespace QtNodes
@@ -0,0 +1,205 @@
+#include "TiledImageData.hpp"
+
+#include <QtCore/QCache>
+#include <QtCore/QPair>
+#include <QtGui/QPainter>
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <mutex>
+
+namespace QtNodes {
+
+namespace {
+
+class ImageSource : public TiledImageData::Source
+{
+public:
+    explicit ImageSource(QImage const &image)
+        : _image(image)
+    {}
+
+    QSize size() const override { return _image.size(); }
+
+    QImage read(QRect const &rect, int const) const override { return _image.copy(rect); }
+
+private:
+    QImage _image;
+};
+
+/// Image and `level << 48 | column << 24 | row`.
+using TileKey = QPair<quint64, quint64>;
+
+/// Tiles of every image, the cost is counted in KiB.
+struct TileCache
+{
+    std::mutex mutex;
+
+    QCache<TileKey, QImage> tiles{64 * 1024};
+};
+
+TileCache &tileCache()
+{
+    static TileCache cache;
+    return cache;
+}
+
+std::uint64_t nextCacheId()
+{
+    static std::atomic<std::uint64_t> next{0};
+    return ++next;
+}
+
+} // namespace
+
+TiledImageData::TiledImageData(std::shared_ptr<Source const> source)
+    : _source(std::move(source))
+    , _cacheId(nextCacheId())
+{}
+
+TiledImageData::TiledImageData(QImage const &image)
+    : TiledImageData(std::make_shared<ImageSource>(image))
+{}
+
+QSize TiledImageData::size() const
+{
+    return _source->size();
+}
+
+int TiledImageData::levelCount() const
+{
+    QSize const s = size();
+
+    int levels = 1;
+
+    while (std::max(s.width(), s.height()) > (TileSize << (levels - 1))) {
+        ++levels;
+    }
+
+    return levels;
+}
+
+QSize TiledImageData::levelSize(int const level) const
+{
+    QSize const s = size();
+
+    int const scale = 1 << level;
+
+    return QSize(std::max(1, (s.width() + scale - 1) / scale),
+                 std::max(1, (s.height() + scale - 1) / scale));
+}
+
+int TiledImageData::levelFor(QSize const &target) const
+{
+    int level = 0;
+
+    while (level + 1 < levelCount()) {
+        QSize const next = levelSize(level + 1);
+
+        if (next.width() < target.width() || next.height() < target.height())
+            break;
+
+        ++level;
+    }
+
+    return level;
+}
+
+QImage TiledImageData::region(QRect const &rect, int const level) const
+{
+    QRect const clipped = rect & levelRect(level);
+
+    if (clipped.isEmpty())
+        return QImage();
+
+    int const firstColumn = clipped.left() / TileSize;
+    int const lastColumn = clipped.right() / TileSize;
+    int const firstRow = clipped.top() / TileSize;
+    int const lastRow = clipped.bottom() / TileSize;
+
+    // Exactly one tile, no need to assemble.
+    if (firstColumn == lastColumn && firstRow == lastRow) {
+        QImage const t = tile(level, firstColumn, firstRow);
+
+        QRect const tileRect(firstColumn * TileSize, firstRow * TileSize, t.width(), t.height());
+
+        if (clipped == tileRect)
+            return t;
+
+        return t.copy(clipped.translated(-tileRect.topLeft()));
+    }
+
+    QImage result(clipped.size(), QImage::Format_ARGB32_Premultiplied);
+    result.fill(Qt::transparent);
+
+    QPainter painter(&result);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+
+    for (int row = firstRow; row <= lastRow; ++row) {
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            QPoint const origin(column * TileSize, row * TileSize);
+
+            painter.drawImage(origin - clipped.topLeft(), tile(level, column, row));
+        }
+    }
+
+    return result;
+}
+
+QImage TiledImageData::thumbnail(QSize const &target) const
+{
+    int const level = levelFor(target);
+
+    return region(levelRect(level), level);
+}
+
+void TiledImageData::setTileCacheLimit(std::size_t const bytes)
+{
+    TileCache &cache = tileCache();
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    cache.tiles.setMaxCost(static_cast<int>(std::min<std::size_t>(bytes / 1024, INT_MAX)));
+}
+
+QImage TiledImageData::tile(int const level, int const column, int const row) const
+{
+    TileKey const key(_cacheId,
+                      quint64(level) << 48 | quint64(column) << 24 | quint64(row));
+
+    TileCache &cache = tileCache();
+
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+
+        if (QImage const *cached = cache.tiles.object(key))
+            return *cached;
+    }
+
+    QRect const rect = QRect(column * TileSize, row * TileSize, TileSize, TileSize)
+                       & levelRect(level);
+
+    QImage pixels;
+
+    if (level < _source->levelCount()) {
+        pixels = _source->read(rect, level);
+    } else {
+        // Downscaled from the four tiles below, which are cached in turn.
+        QRect const below(rect.topLeft() * 2, rect.size() * 2);
+
+        pixels = region(below, level - 1)
+                     .scaled(rect.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
+    // Read without the lock, two threads may produce the same tile.
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    int const cost = std::max(1, static_cast<int>(pixels.sizeInBytes() / 1024));
+
+    cache.tiles.insert(key, new QImage(pixels), cost);
+
+    return pixels;
+}
+
+} // namespace QtNodes
@@ -2,123 +2,393 @@
 
 #include "BasicGraphicsScene.hpp"
 #include "ConnectionGraphicsObject.hpp"
+#include "ConnectionIdHash.hpp"
 #include "ConnectionIdUtils.hpp"
 #include "Definitions.hpp"
 #include "NodeGraphicsObject.hpp"
+#include "SceneJson.hpp"
 
+#include <QtCore/QDataStream>
 #include <QtCore/QJsonArray>
 #include <QtCore/QJsonDocument>
 #include <QtCore/QMimeData>
+#include <QtCore/QStringList>
 #include <QtGui/QClipboard>
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QGraphicsObject>
 
+#include <algorithm>
 #include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 namespace QtNodes {
 
-static QJsonObject serializeSelectedItems(BasicGraphicsScene *scene)
+namespace {
+
+constexpr char const *GraphMimeType = "application/qt-nodes-graph";
+
+constexpr quint32 ClipboardMagic = 0x514E4743;
+
+constexpr quint16 ClipboardVersion = 1;
+
+/// Clipboard payload producing its text form only when it is requested.
+class GraphMimeData : public QMimeData
 {
-    QJsonObject serializedScene;
+public:
+    explicit GraphMimeData(SceneSnapshot snapshot)
+        : _snapshot(std::move(snapshot))
+    {
+        setData(GraphMimeType, _snapshot.toBinary());
+    }
 
-    auto &graphModel = scene->graphModel();
+    bool hasFormat(QString const &mimeType) const override
+    {
+        return mimeType == QLatin1String("text/plain") || QMimeData::hasFormat(mimeType);
+    }
 
-    std::unordered_set<NodeId> selectedNodes;
+    QStringList formats() const override
+    {
+        return QMimeData::formats() << QStringLiteral("text/plain");
+    }
 
-    QJsonArray nodesJsonArray;
+protected:
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    QVariant retrieveData(QString const &mimeType, QMetaType type) const override
+#else
+    QVariant retrieveData(QString const &mimeType, QVariant::Type type) const override
+#endif
+    {
+        if (mimeType == QLatin1String("text/plain"))
+            return QString::fromUtf8(QJsonDocument(_snapshot.toJson()).toJson());
+
+        return QMimeData::retrieveData(mimeType, type);
+    }
+
+private:
+    SceneSnapshot _snapshot;
+};
+
+} // namespace
+
+constexpr std::size_t SceneSnapshot::InsertBatchSize;
+
+void SceneSnapshot::addNode(AbstractGraphModel const &graphModel, NodeId const nodeId)
+{
+    addNode(graphModel.saveNode(nodeId));
+}
+
+void SceneSnapshot::addNode(QJsonObject nodeJson)
+{
+    Node node{static_cast<NodeId>(nodeJson["id"].toInt()),
+              pointFromJson(nodeJson["position"]),
+              QByteArray()};
+
+    nodeJson.remove("id");
+    nodeJson.remove("position");
+
+    node.blob = QJsonDocument(nodeJson).toJson(QJsonDocument::Compact);
+
+    if (_compressed)
+        node.blob = qCompress(node.blob);
+
+    _nodes.push_back(std::move(node));
+}
+
+void SceneSnapshot::addConnection(ConnectionId const connectionId)
+{
+    _connections.push_back(connectionId);
+}
+
+void SceneSnapshot::addItems(QJsonObject const &sceneJson)
+{
+    QJsonArray const nodesJsonArray = sceneJson["nodes"].toArray();
+
+    _nodes.reserve(_nodes.size() + nodesJsonArray.size());
+
+    for (QJsonValue node : nodesJsonArray) {
+        addNode(node.toObject());
+    }
+
+    // Either layout of SceneJson.hpp, e.g. copied from a model writing compact JSON.
+    forEachConnectionJson(sceneJson["connections"].toArray(),
+                          [this](ConnectionId const &connectionId) { addConnection(connectionId); });
+}
+
+void SceneSnapshot::assignNewNodeIds(AbstractGraphModel &graphModel)
+{
+    std::unordered_map<NodeId, NodeId> mapNodeIds;
+    mapNodeIds.reserve(_nodes.size());
+
+    NodeId const firstId = graphModel.reserveNodeIds(_nodes.size());
+
+    for (std::size_t i = 0; i < _nodes.size(); ++i) {
+        NodeId const newNodeId = firstId + static_cast<NodeId>(i);
+
+        mapNodeIds[_nodes[i].id] = newNodeId;
+        _nodes[i].id = newNodeId;
+    }
+
+    for (ConnectionId &connId : _connections) {
+        connId.outNodeId = mapNodeIds[connId.outNodeId];
+        connId.inNodeId = mapNodeIds[connId.inNodeId];
+    }
+}
+
+void SceneSnapshot::translate(QPointF const &offset)
+{
+    for (Node &node : _nodes) {
+        node.position += offset;
+    }
+}
+
+QPointF SceneSnapshot::averagePosition() const
+{
+    QPointF averagePos(0, 0);
+
+    if (_nodes.empty())
+        return averagePos;
+
+    for (Node const &node : _nodes) {
+        averagePos += node.position;
+    }
 
-    for (QGraphicsItem *item : scene->selectedItems()) {
-        if (auto n = qgraphicsitem_cast<NodeGraphicsObject *>(item)) {
-            nodesJsonArray.append(graphModel.saveNode(n->nodeId()));
+    return averagePos / static_cast<double>(_nodes.size());
+}
+
+QJsonObject SceneSnapshot::nodeJson(Node const &node) const
+{
+    QJsonObject nodeJson
+        = QJsonDocument::fromJson(_compressed ? qUncompress(node.blob) : node.blob).object();
+
+    QJsonObject positionJson;
+    positionJson["x"] = node.position.x();
+    positionJson["y"] = node.position.y();
+
+    nodeJson["id"] = static_cast<qint64>(node.id);
+    nodeJson["position"] = positionJson;
+
+    return nodeJson;
+}
 
-            selectedNodes.insert(n->nodeId());
+void SceneSnapshot::insert(BasicGraphicsScene *scene) const
+{
+    AbstractGraphModel &graphModel = scene->graphModel();
+
+    scene->reserve(_nodes.size(), _connections.size());
+
+    // Graphics objects only exist once the batch that created them closed.
+    for (std::size_t begin = 0; begin < _nodes.size(); begin += InsertBatchSize) {
+        std::size_t const end = std::min(begin + InsertBatchSize, _nodes.size());
+
+        {
+            GraphTransaction transaction(graphModel);
+
+            for (std::size_t i = begin; i < end; ++i) {
+                graphModel.loadNode(nodeJson(_nodes[i]));
+            }
+        }
+
+        for (std::size_t i = begin; i < end; ++i) {
+            if (auto ngo = scene->nodeGraphicsObject(_nodes[i].id)) {
+                ngo->setZValue(1.0);
+                ngo->setSelected(true);
+            }
         }
     }
 
-    QJsonArray connJsonArray;
+    for (std::size_t begin = 0; begin < _connections.size(); begin += InsertBatchSize) {
+        std::size_t const end = std::min(begin + InsertBatchSize, _connections.size());
 
-    for (QGraphicsItem *item : scene->selectedItems()) {
-        if (auto c = qgraphicsitem_cast<ConnectionGraphicsObject *>(item)) {
-            auto const &cid = c->connectionId();
+        {
+            GraphTransaction transaction(graphModel);
 
-            if (selectedNodes.count(cid.outNodeId) > 0 && selectedNodes.count(cid.inNodeId) > 0) {
-                connJsonArray.append(toJson(cid));
+            for (std::size_t i = begin; i < end; ++i) {
+                // Restore the connection
+                graphModel.addConnection(_connections[i]);
             }
         }
+
+        for (std::size_t i = begin; i < end; ++i) {
+            if (auto cgo = scene->connectionGraphicsObject(_connections[i]))
+                cgo->setSelected(true);
+        }
     }
+}
 
-    serializedScene["nodes"] = nodesJsonArray;
-    serializedScene["connections"] = connJsonArray;
+void SceneSnapshot::remove(AbstractGraphModel &graphModel) const
+{
+    GraphTransaction transaction(graphModel);
+
+    graphModel.deleteConnections(_connections);
+
+    std::vector<NodeId> nodeIds;
+    nodeIds.reserve(_nodes.size());
 
-    return serializedScene;
+    for (Node const &node : _nodes) {
+        nodeIds.push_back(node.id);
+    }
+
+    graphModel.deleteNodes(nodeIds);
 }
 
-static void insertSerializedItems(QJsonObject const &json, BasicGraphicsScene *scene)
+std::size_t SceneSnapshot::memoryUsage() const
 {
-    AbstractGraphModel &graphModel = scene->graphModel();
+    std::size_t usage = sizeof(*this) + _nodes.capacity() * sizeof(Node)
+                        + _connections.capacity() * sizeof(ConnectionId);
 
-    QJsonArray const &nodesJsonArray = json["nodes"].toArray();
+    for (Node const &node : _nodes) {
+        usage += static_cast<std::size_t>(node.blob.capacity());
+    }
 
-    for (QJsonValue node : nodesJsonArray) {
-        QJsonObject obj = node.toObject();
+    return usage;
+}
 
-        graphModel.loadNode(obj);
+void SceneSnapshot::compress()
+{
+    if (_compressed)
+        return;
 
-        auto id = obj["id"].toInt();
-        scene->nodeGraphicsObject(id)->setZValue(1.0);
-        scene->nodeGraphicsObject(id)->setSelected(true);
+    for (Node &node : _nodes) {
+        node.blob = qCompress(node.blob);
     }
 
-    QJsonArray const &connJsonArray = json["connections"].toArray();
+    _compressed = true;
+}
+
+void SceneSnapshot::clear()
+{
+    std::vector<Node>().swap(_nodes);
+    std::vector<ConnectionId>().swap(_connections);
+
+    _compressed = false;
+}
 
-    for (QJsonValue connection : connJsonArray) {
-        QJsonObject connJson = connection.toObject();
+bool SceneSnapshot::isBinary(QByteArray const &data)
+{
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_11);
 
-        ConnectionId connId = fromJson(connJson);
+    quint32 magic = 0;
+    in >> magic;
 
-        // Restore the connection
-        graphModel.addConnection(connId);
+    return in.status() == QDataStream::Ok && magic == ClipboardMagic;
+}
+
+QByteArray SceneSnapshot::toBinary() const
+{
+    QByteArray data;
 
-        scene->connectionGraphicsObject(connId)->setSelected(true);
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_11);
+
+    out << ClipboardMagic << ClipboardVersion;
+
+    out << static_cast<quint32>(_nodes.size());
+
+    for (Node const &node : _nodes) {
+        out << static_cast<quint32>(node.id) << node.position.x() << node.position.y()
+            << (_compressed ? qUncompress(node.blob) : node.blob);
     }
+
+    out << static_cast<quint32>(_connections.size());
+
+    for (ConnectionId const &cid : _connections) {
+        out << static_cast<quint32>(cid.outNodeId) << static_cast<quint32>(cid.outPortIndex)
+            << static_cast<quint32>(cid.inNodeId) << static_cast<quint32>(cid.inPortIndex);
+    }
+
+    return data;
 }
 
-static void deleteSerializedItems(QJsonObject &sceneJson, AbstractGraphModel &graphModel)
+bool SceneSnapshot::fromBinary(QByteArray const &data)
 {
-    QJsonArray connectionJsonArray = sceneJson["connections"].toArray();
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_11);
 
-    for (QJsonValueRef connection : connectionJsonArray) {
-        QJsonObject connJson = connection.toObject();
+    quint32 magic = 0;
+    quint16 version = 0;
 
-        ConnectionId connId = fromJson(connJson);
+    in >> magic >> version;
 
-        graphModel.deleteConnection(connId);
+    if (in.status() != QDataStream::Ok || magic != ClipboardMagic || version > ClipboardVersion)
+        return false;
+
+    SceneSnapshot snapshot;
+
+    quint32 nodeCount = 0;
+    in >> nodeCount;
+
+    for (quint32 i = 0; i < nodeCount && in.status() == QDataStream::Ok; ++i) {
+        quint32 id = 0;
+        double x = 0.0;
+        double y = 0.0;
+        QByteArray blob;
+
+        in >> id >> x >> y >> blob;
+
+        snapshot._nodes.push_back(Node{static_cast<NodeId>(id), QPointF(x, y), std::move(blob)});
     }
 
-    QJsonArray nodesJsonArray = sceneJson["nodes"].toArray();
+    quint32 connectionCount = 0;
+    in >> connectionCount;
+
+    for (quint32 i = 0; i < connectionCount && in.status() == QDataStream::Ok; ++i) {
+        quint32 outNodeId = 0, outPortIndex = 0, inNodeId = 0, inPortIndex = 0;
 
-    for (QJsonValueRef node : nodesJsonArray) {
-        QJsonObject nodeJson = node.toObject();
-        graphModel.deleteNode(nodeJson["id"].toInt());
+        in >> outNodeId >> outPortIndex >> inNodeId >> inPortIndex;
+
+        snapshot._connections.push_back(ConnectionId{outNodeId, outPortIndex, inNodeId, inPortIndex});
     }
+
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    *this = std::move(snapshot);
+
+    return true;
 }
 
-static QPointF computeAverageNodePosition(QJsonObject const &sceneJson)
+QJsonObject SceneSnapshot::toJson() const
 {
-    QPointF averagePos(0, 0);
+    QJsonArray nodesJsonArray;
 
-    QJsonArray nodesJsonArray = sceneJson["nodes"].toArray();
+    for (Node const &node : _nodes) {
+        nodesJsonArray.append(nodeJson(node));
+    }
 
-    for (QJsonValueRef node : nodesJsonArray) {
-        QJsonObject nodeJson = node.toObject();
+    QJsonArray connJsonArray;
 
-        averagePos += QPointF(nodeJson["position"].toObject()["x"].toDouble(),
-                              nodeJson["position"].toObject()["y"].toDouble());
+    for (ConnectionId const &cid : _connections) {
+        connJsonArray.append(QtNodes::toJson(cid));
     }
 
-    averagePos /= static_cast<double>(nodesJsonArray.size());
+    QJsonObject sceneJson;
+    sceneJson["nodes"] = nodesJsonArray;
+    sceneJson["connections"] = connJsonArray;
 
-    return averagePos;
+    return sceneJson;
+}
+
+//-------------------------------------
+
+std::size_t SnapshotCommand::memoryUsage() const
+{
+    return sizeof(*this) + _snapshot.memoryUsage();
+}
+
+void SnapshotCommand::compress()
+{
+    _snapshot.compress();
+}
+
+void SnapshotCommand::evict()
+{
+    _snapshot.clear();
+
+    setObsolete(true);
 }
 
 //-------------------------------------
@@ -127,7 +397,6 @@ CreateCommand::CreateCommand(BasicGraphicsScene *scene,
                              QString const name,
                              QPointF const &mouseScenePos)
     : _scene(scene)
-    , _sceneJson(QJsonObject())
 {
     _nodeId = _scene->graphModel().addNode(name);
     if (_nodeId != InvalidNodeId) {
@@ -139,19 +408,19 @@ CreateCommand::CreateCommand(BasicGraphicsScene *scene,
 
 void CreateCommand::undo()
 {
-    QJsonArray nodesJsonArray;
-    nodesJsonArray.append(_scene->graphModel().saveNode(_nodeId));
-    _sceneJson["nodes"] = nodesJsonArray;
+    _snapshot.clear();
+    _snapshot.addNode(_scene->graphModel(), _nodeId);
 
     _scene->graphModel().deleteNode(_nodeId);
 }
 
 void CreateCommand::redo()
 {
-    if (_sceneJson.empty() || _sceneJson["nodes"].toArray().empty())
+    // The first redo follows the creation done by the constructor.
+    if (_snapshot.empty())
         return;
 
-    insertSerializedItems(_sceneJson, _scene);
+    _snapshot.insert(_scene);
 }
 
 //-------------------------------------
@@ -161,96 +430,70 @@ DeleteCommand::DeleteCommand(BasicGraphicsScene *scene)
 {
     auto &graphModel = _scene->graphModel();
 
-    QJsonArray connJsonArray;
+    std::unordered_set<ConnectionId> connections;
+
+    auto addConnection = [this, &connections](ConnectionId const &cid) {
+        if (connections.insert(cid).second)
+            _snapshot.addConnection(cid);
+    };
+
     // Delete the selected connections first, ensuring that they won't be
     // automatically deleted when selected nodes are deleted (deleting a
     // node deletes some connections as well)
-    for (QGraphicsItem *item : _scene->selectedItems()) {
-        if (auto c = qgraphicsitem_cast<ConnectionGraphicsObject *>(item)) {
-            auto const &cid = c->connectionId();
-
-            connJsonArray.append(toJson(cid));
-        }
+    for (ConnectionId const &connectionId : _scene->selectedConnectionIds()) {
+        addConnection(connectionId);
     }
 
-    QJsonArray nodesJsonArray;
     // Delete the nodes; this will delete many of the connections.
     // Selected connections were already deleted prior to this loop,
-    for (QGraphicsItem *item : _scene->selectedItems()) {
-        if (auto n = qgraphicsitem_cast<NodeGraphicsObject *>(item)) {
-            // saving connections attached to the selected nodes
-            for (auto const &cid : graphModel.allConnectionIds(n->nodeId())) {
-                connJsonArray.append(toJson(cid));
-            }
+    for (NodeId const nodeId : _scene->selectedNodeIds()) {
+        // saving connections attached to the selected nodes
+        graphModel.forEachNodeConnection(nodeId, addConnection);
 
-            nodesJsonArray.append(graphModel.saveNode(n->nodeId()));
-        }
+        _snapshot.addNode(graphModel, nodeId);
     }
 
     // If nothing is deleted, cancel this operation
-    if (connJsonArray.isEmpty() && nodesJsonArray.isEmpty())
+    if (_snapshot.empty())
         setObsolete(true);
-
-    _sceneJson["nodes"] = nodesJsonArray;
-    _sceneJson["connections"] = connJsonArray;
 }
 
 void DeleteCommand::undo()
 {
-    insertSerializedItems(_sceneJson, _scene);
+    _snapshot.insert(_scene);
 }
 
 void DeleteCommand::redo()
 {
-    deleteSerializedItems(_sceneJson, _scene->graphModel());
+    _snapshot.remove(_scene->graphModel());
 }
 
 //-------------------------------------
 
-void offsetNodeGroup(QJsonObject &sceneJson, QPointF const &diff)
+CopyCommand::CopyCommand(BasicGraphicsScene *scene)
 {
-    QJsonArray nodesJsonArray = sceneJson["nodes"].toArray();
-
-    QJsonArray newNodesJsonArray;
-    for (QJsonValueRef node : nodesJsonArray) {
-        QJsonObject obj = node.toObject();
-
-        QPointF oldPos(obj["position"].toObject()["x"].toDouble(),
-                       obj["position"].toObject()["y"].toDouble());
+    auto &graphModel = scene->graphModel();
 
-        oldPos += diff;
+    SceneSnapshot snapshot;
 
-        QJsonObject posJson;
-        posJson["x"] = oldPos.x();
-        posJson["y"] = oldPos.y();
-        obj["position"] = posJson;
+    std::unordered_set<NodeId> const &selectedNodes = scene->selectedNodeIds();
 
-        newNodesJsonArray.append(obj);
+    for (NodeId const nodeId : selectedNodes) {
+        snapshot.addNode(graphModel, nodeId);
     }
 
-    sceneJson["nodes"] = newNodesJsonArray;
-}
-
-//-------------------------------------
-
-CopyCommand::CopyCommand(BasicGraphicsScene *scene)
-{
-    QJsonObject sceneJson = serializeSelectedItems(scene);
-
-    if (sceneJson.empty() || sceneJson["nodes"].toArray().empty()) {
+    if (snapshot.empty()) {
         setObsolete(true);
         return;
     }
 
-    QClipboard *clipboard = QApplication::clipboard();
-
-    QByteArray const data = QJsonDocument(sceneJson).toJson();
-
-    QMimeData *mimeData = new QMimeData();
-    mimeData->setData("application/qt-nodes-graph", data);
-    mimeData->setText(data);
+    for (ConnectionId const &cid : scene->selectedConnectionIds()) {
+        if (selectedNodes.count(cid.outNodeId) > 0 && selectedNodes.count(cid.inNodeId) > 0) {
+            snapshot.addConnection(cid);
+        }
+    }
 
-    clipboard->setMimeData(mimeData);
+    QApplication::clipboard()->setMimeData(new GraphMimeData(std::move(snapshot)));
 
     // Copy command does not have any effective redo/undo operations.
     // It copies the data to the clipboard and could be immediately removed
@@ -264,23 +507,31 @@ PasteCommand::PasteCommand(BasicGraphicsScene *scene, QPointF const &mouseSceneP
     : _scene(scene)
     , _mouseScenePos(mouseScenePos)
 {
-    _newSceneJson = takeSceneJsonFromClipboard();
+    QMimeData const *mimeData = QApplication::clipboard()->mimeData();
+
+    if (mimeData && mimeData->hasFormat(GraphMimeType)) {
+        QByteArray const data = mimeData->data(GraphMimeType);
 
-    if (_newSceneJson.empty() || _newSceneJson["nodes"].toArray().empty()) {
+        // Older versions put the JSON text under the same mime type.
+        if (!SceneSnapshot::isBinary(data) || !_snapshot.fromBinary(data))
+            _snapshot.addItems(QJsonDocument::fromJson(data).object());
+    } else if (mimeData && mimeData->hasText()) {
+        _snapshot.addItems(QJsonDocument::fromJson(mimeData->text().toUtf8()).object());
+    }
+
+    if (_snapshot.nodeCount() == 0) {
         setObsolete(true);
         return;
     }
 
-    _newSceneJson = makeNewNodeIdsInScene(_newSceneJson);
-
-    QPointF averagePos = computeAverageNodePosition(_newSceneJson);
+    _snapshot.assignNewNodeIds(_scene->graphModel());
 
-    offsetNodeGroup(_newSceneJson, _mouseScenePos - averagePos);
+    _snapshot.translate(_mouseScenePos - _snapshot.averagePosition());
 }
 
 void PasteCommand::undo()
 {
-    deleteSerializedItems(_newSceneJson, _scene->graphModel());
+    _snapshot.remove(_scene->graphModel());
 }
 
 void PasteCommand::redo()
@@ -289,84 +540,63 @@ void PasteCommand::redo()
 
     // Ignore if pasted in content does not generate nodes.
     try {
-        insertSerializedItems(_newSceneJson, _scene);
+        _snapshot.insert(_scene);
     } catch (...) {
-        // If the paste does not work, delete all selected nodes and connections
-        // `deleteNode(...)` implicitly removed connections
-        auto &graphModel = _scene->graphModel();
-
-        QJsonArray nodesJsonArray;
-        for (QGraphicsItem *item : _scene->selectedItems()) {
-            if (auto n = qgraphicsitem_cast<NodeGraphicsObject *>(item)) {
-                graphModel.deleteNode(n->nodeId());
-            }
-        }
+        // If the paste does not work, delete whatever was inserted so far,
+        // including nodes of a batch that never got selected.
+        _snapshot.remove(_scene->graphModel());
 
         setObsolete(true);
     }
 }
 
-QJsonObject PasteCommand::takeSceneJsonFromClipboard()
-{
-    QClipboard const *clipboard = QApplication::clipboard();
-    QMimeData const *mimeData = clipboard->mimeData();
-
-    QJsonDocument json;
-    if (mimeData->hasFormat("application/qt-nodes-graph")) {
-        json = QJsonDocument::fromJson(mimeData->data("application/qt-nodes-graph"));
-    } else if (mimeData->hasText()) {
-        json = QJsonDocument::fromJson(mimeData->text().toUtf8());
-    }
-
-    return json.object();
-}
+//-------------------------------------
 
-QJsonObject PasteCommand::makeNewNodeIdsInScene(QJsonObject const &sceneJson)
+DuplicateCommand::DuplicateCommand(BasicGraphicsScene *scene, QPointF const &scenePos)
+    : _scene(scene)
 {
-    AbstractGraphModel &graphModel = _scene->graphModel();
-
-    std::unordered_map<NodeId, NodeId> mapNodeIds;
-
-    QJsonArray nodesJsonArray = sceneJson["nodes"].toArray();
-
-    QJsonArray newNodesJsonArray;
-    for (QJsonValueRef node : nodesJsonArray) {
-        QJsonObject nodeJson = node.toObject();
-
-        NodeId oldNodeId = nodeJson["id"].toInt();
-
-        NodeId newNodeId = graphModel.newNodeId();
-
-        mapNodeIds[oldNodeId] = newNodeId;
+    auto &graphModel = _scene->graphModel();
 
-        // Replace NodeId in json
-        nodeJson["id"] = static_cast<qint64>(newNodeId);
+    std::unordered_set<NodeId> const &selectedNodes = _scene->selectedNodeIds();
 
-        newNodesJsonArray.append(nodeJson);
+    for (NodeId const nodeId : selectedNodes) {
+        _snapshot.addNode(graphModel, nodeId);
     }
 
-    QJsonArray connectionJsonArray = sceneJson["connections"].toArray();
+    if (_snapshot.empty()) {
+        setObsolete(true);
+        return;
+    }
 
-    QJsonArray newConnJsonArray;
-    for (QJsonValueRef connection : connectionJsonArray) {
-        QJsonObject connJson = connection.toObject();
+    // Every connection between two selected nodes, visited from its output end only.
+    for (NodeId const nodeId : selectedNodes) {
+        graphModel.forEachNodeConnection(nodeId, [&](ConnectionId const &cid) {
+            if (cid.outNodeId == nodeId && selectedNodes.count(cid.inNodeId) > 0)
+                _snapshot.addConnection(cid);
+        });
+    }
 
-        ConnectionId connId = fromJson(connJson);
+    _snapshot.assignNewNodeIds(graphModel);
 
-        ConnectionId newConnId{mapNodeIds[connId.outNodeId],
-                               connId.outPortIndex,
-                               mapNodeIds[connId.inNodeId],
-                               connId.inPortIndex};
+    _snapshot.translate(scenePos - _snapshot.averagePosition());
+}
 
-        newConnJsonArray.append(toJson(newConnId));
-    }
+void DuplicateCommand::undo()
+{
+    _snapshot.remove(_scene->graphModel());
+}
 
-    QJsonObject newSceneJson;
+void DuplicateCommand::redo()
+{
+    _scene->clearSelection();
 
-    newSceneJson["nodes"] = newNodesJsonArray;
-    newSceneJson["connections"] = newConnJsonArray;
+    try {
+        _snapshot.insert(_scene);
+    } catch (...) {
+        _snapshot.remove(_scene->graphModel());
 
-    return newSceneJson;
+        setObsolete(true);
+    }
 }
 
 //-------------------------------------
@@ -412,35 +642,37 @@ void ConnectCommand::redo()
 MoveNodeCommand::MoveNodeCommand(BasicGraphicsScene *scene, QPointF const &diff)
     : _scene(scene)
     , _diff(diff)
+    , _skipRedo(false)
 {
-    _selectedNodes.clear();
-    for (QGraphicsItem *item : _scene->selectedItems()) {
-        if (auto n = qgraphicsitem_cast<NodeGraphicsObject *>(item)) {
-            _selectedNodes.insert(n->nodeId());
-        }
-    }
+    _selectedNodes = _scene->selectedNodeIds();
+
+    _nodes.assign(_selectedNodes.begin(), _selectedNodes.end());
 }
 
+MoveNodeCommand::MoveNodeCommand(BasicGraphicsScene *scene,
+                                 std::unordered_set<NodeId> nodes,
+                                 QPointF const &diff,
+                                 bool alreadyApplied)
+    : _scene(scene)
+    , _selectedNodes(std::move(nodes))
+    , _nodes(_selectedNodes.begin(), _selectedNodes.end())
+    , _diff(diff)
+    , _skipRedo(alreadyApplied)
+{}
+
 void MoveNodeCommand::undo()
 {
-    for (auto nodeId : _selectedNodes) {
-        auto oldPos = _scene->graphModel().nodeData(nodeId, NodeRole::Position).value<QPointF>();
-
-        oldPos -= _diff;
-
-        _scene->graphModel().setNodeData(nodeId, NodeRole::Position, oldPos);
-    }
+    _scene->graphModel().moveNodes(_nodes, -_diff);
 }
 
 void MoveNodeCommand::redo()
 {
-    for (auto nodeId : _selectedNodes) {
-        auto oldPos = _scene->graphModel().nodeData(nodeId, NodeRole::Position).value<QPointF>();
-
-        oldPos += _diff;
-
-        _scene->graphModel().setNodeData(nodeId, NodeRole::Position, oldPos);
+    if (_skipRedo) {
+        _skipRedo = false;
+        return;
     }
+
+    _scene->graphModel().moveNodes(_nodes, _diff);
 }
 
 int MoveNodeCommand::id() const
@@ -452,11 +684,38 @@ bool MoveNodeCommand::mergeWith(QUndoCommand const *c)
 {
     auto mc = static_cast<MoveNodeCommand const *>(c);
 
-    if (_selectedNodes == mc->_selectedNodes) {
+    if (_nodes.size() == mc->_nodes.size() && _selectedNodes == mc->_selectedNodes) {
         _diff += mc->_diff;
         return true;
     }
     return false;
 }
 
+//------
+
+ApplyChangesCommand::ApplyChangesCommand(BasicGraphicsScene *scene,
+                                         std::vector<GraphChange> redoChanges,
+                                         std::vector<GraphChange> undoChanges,
+                                         bool alreadyApplied)
+    : _scene(scene)
+    , _redoChanges(std::move(redoChanges))
+    , _undoChanges(std::move(undoChanges))
+    , _skipRedo(alreadyApplied)
+{}
+
+void ApplyChangesCommand::undo()
+{
+    GraphChangeStream::apply(_scene->graphModel(), _undoChanges);
+}
+
+void ApplyChangesCommand::redo()
+{
+    if (_skipRedo) {
+        _skipRedo = false;
+        return;
+    }
+
+    GraphChangeStream::apply(_scene->graphModel(), _redoChanges);
+}
+
 } // namespace QtNodes
@@ -0,0 +1,209 @@
+#include "WorkStealingExecutor.hpp"
+
+namespace QtNodes {
+
+WorkStealingExecutor::WorkStealingExecutor(unsigned int workerCount)
+    : _epoch(0)
+    , _stop(false)
+    , _tasks(nullptr)
+    , _pending(0)
+    , _nextQueue(0)
+{
+    if (workerCount == 0) {
+        unsigned int const hardware = std::thread::hardware_concurrency();
+        workerCount = hardware > 1 ? hardware - 1 : 0;
+    }
+
+    for (unsigned int i = 0; i <= workerCount; ++i) {
+        _queues.push_back(std::make_unique<Queue>());
+    }
+
+    _workers.reserve(workerCount);
+
+    for (unsigned int i = 0; i < workerCount; ++i) {
+        _workers.emplace_back([this, i]() { workerLoop(i); });
+    }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lock(_waitMutex);
+        _stop = true;
+        ++_epoch;
+    }
+
+    _wake.notify_all();
+
+    for (auto &worker : _workers) {
+        worker.join();
+    }
+}
+
+void WorkStealingExecutor::run(std::vector<Task> &tasks)
+{
+    if (tasks.empty())
+        return;
+
+    std::size_t const mainQueue = _queues.size() - 1;
+
+    _tasks = &tasks;
+    _remainingDependencies.reset(new std::atomic<unsigned int>[tasks.size()]);
+    _pending.store(tasks.size());
+    _error = nullptr;
+
+    for (std::size_t i = 0; i < tasks.size(); ++i) {
+        _remainingDependencies[i].store(tasks[i].dependencies);
+    }
+
+    for (std::size_t i = 0; i < tasks.size(); ++i) {
+        if (tasks[i].dependencies != 0)
+            continue;
+
+        if (tasks[i].mainThreadOnly || _workers.empty())
+            push(mainQueue, i);
+        else
+            push(_nextQueue++ % _workers.size(), i);
+    }
+
+    // The calling thread runs its own tasks and steals from the workers.
+    while (_pending.load() > 0) {
+        unsigned long long epoch;
+        {
+            std::lock_guard<std::mutex> lock(_waitMutex);
+            epoch = _epoch;
+        }
+
+        std::size_t taskIndex;
+
+        if (acquireTask(mainQueue, taskIndex)) {
+            execute(mainQueue, taskIndex);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_waitMutex);
+        _wake.wait(lock, [&]() { return _epoch != epoch || _pending.load() == 0; });
+    }
+
+    _tasks = nullptr;
+    _remainingDependencies.reset();
+
+    if (_error) {
+        std::exception_ptr error = _error;
+        _error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void WorkStealingExecutor::workerLoop(std::size_t workerIndex)
+{
+    for (;;) {
+        unsigned long long epoch;
+        {
+            std::lock_guard<std::mutex> lock(_waitMutex);
+
+            if (_stop)
+                return;
+
+            epoch = _epoch;
+        }
+
+        std::size_t taskIndex;
+
+        if (acquireTask(workerIndex, taskIndex)) {
+            execute(workerIndex, taskIndex);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_waitMutex);
+        _wake.wait(lock, [&]() { return _stop || _epoch != epoch; });
+    }
+}
+
+bool WorkStealingExecutor::acquireTask(std::size_t queueIndex, std::size_t &taskIndex)
+{
+    {
+        Queue &own = *_queues[queueIndex];
+        std::lock_guard<std::mutex> lock(own.mutex);
+
+        if (!own.tasks.empty()) {
+            taskIndex = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    // Main-thread tasks are never stolen, so only worker queues are visited.
+    std::size_t const workerCount = _workers.size();
+
+    for (std::size_t offset = 1; offset <= workerCount; ++offset) {
+        std::size_t const victim = (queueIndex + offset) % workerCount;
+
+        if (victim == queueIndex)
+            continue;
+
+        Queue &queue = *_queues[victim];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (!queue.tasks.empty()) {
+            taskIndex = queue.tasks.front();
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WorkStealingExecutor::execute(std::size_t queueIndex, std::size_t taskIndex)
+{
+    Task &task = (*_tasks)[taskIndex];
+
+    try {
+        task.run();
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(_errorMutex);
+        if (!_error)
+            _error = std::current_exception();
+    }
+
+    std::size_t const mainQueue = _queues.size() - 1;
+
+    for (std::size_t const successor : task.successors) {
+        if (--_remainingDependencies[successor] != 0)
+            continue;
+
+        if ((*_tasks)[successor].mainThreadOnly || _workers.empty())
+            push(mainQueue, successor);
+        else if (queueIndex != mainQueue)
+            push(queueIndex, successor);
+        else
+            push(_nextQueue++ % _workers.size(), successor);
+    }
+
+    if (--_pending == 0)
+        wakeUp();
+}
+
+void WorkStealingExecutor::push(std::size_t queueIndex, std::size_t taskIndex)
+{
+    {
+        Queue &queue = *_queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(taskIndex);
+    }
+
+    wakeUp();
+}
+
+void WorkStealingExecutor::wakeUp()
+{
+    {
+        std::lock_guard<std::mutex> lock(_waitMutex);
+        ++_epoch;
+    }
+
+    _wake.notify_all();
+}
+
+} // namespace QtNodes
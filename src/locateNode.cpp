@@ -1,10 +1,9 @@
 #include "locateNode.hpp"
 
-#include <vector>
-
 #include <QtCore/QList>
 #include <QtWidgets/QGraphicsScene>
 
+#include "BasicGraphicsScene.hpp"
 #include "NodeGraphicsObject.hpp"
 
 namespace QtNodes {
@@ -13,30 +12,23 @@ NodeGraphicsObject *locateNodeAt(QPointF scenePoint,
                                  QGraphicsScene &scene,
                                  QTransform const &viewTransform)
 {
-    // items under cursor
+    if (auto basicScene = dynamic_cast<BasicGraphicsScene *>(&scene))
+        return basicScene->nodeAt(scenePoint, viewTransform);
+
+    // items under cursor, by bounding rectangle to skip stroking connection shapes
     QList<QGraphicsItem *> items = scene.items(scenePoint,
-                                               Qt::IntersectsItemShape,
+                                               Qt::IntersectsItemBoundingRect,
                                                Qt::DescendingOrder,
                                                viewTransform);
 
-    // items convertable to NodeGraphicsObject
-    std::vector<QGraphicsItem *> filteredItems;
-
-    std::copy_if(items.begin(),
-                 items.end(),
-                 std::back_inserter(filteredItems),
-                 [](QGraphicsItem *item) {
-                     return (qgraphicsitem_cast<NodeGraphicsObject *>(item) != nullptr);
-                 });
-
-    NodeGraphicsObject *node = nullptr;
+    for (QGraphicsItem *item : items) {
+        auto node = qgraphicsitem_cast<NodeGraphicsObject *>(item);
 
-    if (!filteredItems.empty()) {
-        QGraphicsItem *graphicsItem = filteredItems.front();
-        node = dynamic_cast<NodeGraphicsObject *>(graphicsItem);
+        if (node && node->shape().contains(node->mapFromScene(scenePoint)))
+            return node;
     }
 
-    return node;
+    return nullptr;
 }
 
 } // namespace QtNodes
@@ -0,0 +1,281 @@
+#include "ApplicationSetup.hpp"
+
+#include <QtNodes/DataFlowGraphModel>
+#include <QtNodes/NodeData>
+#include <QtNodes/NodeDelegateModel>
+#include <QtNodes/NodeDelegateModelRegistry>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonObject>
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+using QtNodes::CancellationToken;
+using QtNodes::ConnectionId;
+using QtNodes::DataFlowGraphModel;
+using QtNodes::NodeData;
+using QtNodes::NodeDataType;
+using QtNodes::NodeDelegateModel;
+using QtNodes::NodeDelegateModelRegistry;
+using QtNodes::NodeId;
+using QtNodes::PortIndex;
+using QtNodes::PortType;
+
+namespace {
+
+class NumberData : public NodeData
+{
+public:
+    explicit NumberData(int number)
+        : number(number)
+    {}
+
+    NodeDataType type() const override { return NodeDataType{"number", "Number"}; }
+
+    bool hasContentHash() const override { return true; }
+
+    std::size_t contentHash() const override { return static_cast<std::size_t>(number); }
+
+    int const number;
+};
+
+/// Passes its input on and saves the last number it received.
+class RelayModel : public NodeDelegateModel
+{
+public:
+    static QString Name() { return QStringLiteral("Relay"); }
+
+    QString caption() const override { return Name(); }
+
+    QString name() const override { return Name(); }
+
+    unsigned int nPorts(PortType) const override { return 1; }
+
+    NodeDataType dataType(PortType, PortIndex) const override
+    {
+        return NodeDataType{"number", "Number"};
+    }
+
+    void setInData(std::shared_ptr<NodeData> nodeData, PortIndex const) override
+    {
+        _data = std::dynamic_pointer_cast<NumberData>(nodeData);
+
+        Q_EMIT dataUpdated(0);
+    }
+
+    std::shared_ptr<NodeData> outData(PortIndex const) override { return _data; }
+
+    QObject *embeddedWidget() override { return nullptr; }
+
+    bool threadSafe() const override { return true; }
+
+    QJsonObject save() const override
+    {
+        QJsonObject json = NodeDelegateModel::save();
+        json["number"] = _data ? _data->number : -1;
+
+        return json;
+    }
+
+    void emitNumber(int const number)
+    {
+        _data = std::make_shared<NumberData>(number);
+
+        Q_EMIT dataUpdated(0);
+    }
+
+private:
+    std::shared_ptr<NumberData> _data;
+};
+
+/// Doubles its input in a compute job, a pure function of the input.
+class DoublerModel : public NodeDelegateModel
+{
+public:
+    static QString Name() { return QStringLiteral("Doubler"); }
+
+    QString caption() const override { return Name(); }
+
+    QString name() const override { return Name(); }
+
+    unsigned int nPorts(PortType) const override { return 1; }
+
+    NodeDataType dataType(PortType, PortIndex) const override
+    {
+        return NodeDataType{"number", "Number"};
+    }
+
+    void setInData(std::shared_ptr<NodeData> nodeData, PortIndex const) override
+    {
+        _input = std::dynamic_pointer_cast<NumberData>(nodeData);
+
+        requestCompute();
+    }
+
+    std::shared_ptr<NodeData> outData(PortIndex const) override { return _result; }
+
+    QObject *embeddedWidget() override { return nullptr; }
+
+    bool threadSafe() const override { return true; }
+
+    bool deterministic() const override { return true; }
+
+    ComputeJob computeJob() override
+    {
+        int const number = _input ? _input->number : 0;
+
+        return [number](CancellationToken const &) {
+            // Connecting may compute the missing input, which the tests ignore.
+            if (number != 0)
+                ++jobs;
+
+            return ComputeResults{std::make_shared<NumberData>(2 * number)};
+        };
+    }
+
+    void setComputeResults(ComputeResults const &results) override
+    {
+        _result = std::dynamic_pointer_cast<NumberData>(results.front());
+    }
+
+    int result() const { return _result ? _result->number : -1; }
+
+    static std::atomic<int> jobs;
+
+private:
+    std::shared_ptr<NumberData> _input;
+
+    std::shared_ptr<NumberData> _result;
+};
+
+std::atomic<int> DoublerModel::jobs{0};
+
+/// Runs the event loop until `done` or a few seconds have passed.
+bool waitFor(std::function<bool()> const &done)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    while (!done() && timer.elapsed() < 5000) {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+
+    return done();
+}
+
+int savedNumber(QJsonObject const &sceneJson, NodeId const nodeId)
+{
+    for (QJsonValue const nodeJson : sceneJson["nodes"].toArray()) {
+        QJsonObject const node = nodeJson.toObject();
+
+        if (node["id"].toInt() == static_cast<int>(nodeId))
+            return node["internal-data"].toObject()["number"].toInt();
+    }
+
+    return -2;
+}
+
+} // namespace
+
+TEST_CASE("DataFlowGraphModel incremental save() follows the data", "[interface]")
+{
+    auto setup = applicationSetup();
+
+    auto registry = std::make_shared<NodeDelegateModelRegistry>();
+    registry->registerModel<RelayModel>();
+
+    DataFlowGraphModel model(registry);
+
+    model.setIncrementalSave(true);
+
+    SECTION("immediate propagation") {}
+
+    SECTION("scheduled flush")
+    {
+        model.setPropagationMode(DataFlowGraphModel::PropagationMode::Scheduled);
+    }
+
+    SECTION("parallel flush")
+    {
+        model.setPropagationMode(DataFlowGraphModel::PropagationMode::Scheduled);
+        model.setParallelEvaluation(true);
+    }
+
+    NodeId const source = model.addNode(RelayModel::Name());
+    NodeId const first = model.addNode(RelayModel::Name());
+    NodeId const second = model.addNode(RelayModel::Name());
+
+    model.addConnection(ConnectionId{source, 0, first, 0});
+    model.addConnection(ConnectionId{first, 0, second, 0});
+
+    auto *relay = model.delegateModel<RelayModel>(source);
+
+    relay->emitNumber(1);
+    model.processPendingPropagation();
+
+    QJsonObject const before = model.save();
+
+    CHECK(savedNumber(before, second) == 1);
+
+    relay->emitNumber(2);
+    model.processPendingPropagation();
+
+    QJsonObject const after = model.save();
+
+    CHECK(savedNumber(after, source) == 2);
+    CHECK(savedNumber(after, first) == 2);
+    CHECK(savedNumber(after, second) == 2);
+}
+
+TEST_CASE("DataFlowGraphModel memoizes compute results by the current inputs", "[interface]")
+{
+    auto setup = applicationSetup();
+
+    auto registry = std::make_shared<NodeDelegateModelRegistry>();
+    registry->registerModel<RelayModel>();
+    registry->registerModel<DoublerModel>();
+
+    DataFlowGraphModel model(registry);
+
+    model.setResultCacheCapacity(16);
+
+    SECTION("immediate propagation") {}
+
+    SECTION("parallel flush")
+    {
+        model.setPropagationMode(DataFlowGraphModel::PropagationMode::Scheduled);
+        model.setParallelEvaluation(true);
+    }
+
+    NodeId const source = model.addNode(RelayModel::Name());
+    NodeId const doubler = model.addNode(DoublerModel::Name());
+
+    model.addConnection(ConnectionId{source, 0, doubler, 0});
+
+    auto *relay = model.delegateModel<RelayModel>(source);
+    auto *delegate = model.delegateModel<DoublerModel>(doubler);
+
+    auto evaluate = [&](int const number) {
+        relay->emitNumber(number);
+        model.processPendingPropagation();
+
+        return waitFor([&]() { return delegate->result() == 2 * number; });
+    };
+
+    DoublerModel::jobs = 0;
+
+    CHECK(evaluate(1));
+    CHECK(evaluate(2));
+    CHECK(DoublerModel::jobs == 2);
+
+    // Both inputs are cached now.
+    CHECK(evaluate(1));
+    CHECK(evaluate(2));
+    CHECK(DoublerModel::jobs == 2);
+}